@@ -101,6 +101,8 @@ class AttributeReference : public ExprTree
     	AttributeReference ();
 
   	private:
+		friend class ExprByteCode;
+
 		// private ctor for internal use
 		AttributeReference( ExprTree*, const std::string &, bool );
 		virtual void _SetParentScope( const ClassAd* p );
@@ -824,6 +824,7 @@ class ClassAd : public ExprTree
 		friend 	class AttributeReference;
 		friend 	class ExprTree;
 		friend 	class EvalState;
+		friend 	class ExprByteCode;
 
 
 		bool _GetExternalReferences( const ExprTree *, const ClassAd *, 
@@ -845,6 +846,34 @@ class ClassAd : public ExprTree
 		virtual bool _Flatten( EvalState&, Value&, ExprTree*&, int* ) const;
 	
 		int LookupInScope( const std::string&, ExprTree*&, EvalState& ) const;
+
+			// Lookup() for the bytecode evaluator. own_hint and parent_hint are
+			// the positions the attribute had in this ad and in the chained parent
+			// ad on the previous lookup, they are updated when they miss.
+		ExprTree *LookupHinted( const std::string &name, int &own_hint, int &parent_hint ) const {
+#ifdef USE_CLASSAD_FLAT_MAP
+			AttrList::const_iterator itr = attrList.find_hinted( name, own_hint );
+			if (itr != attrList.end()) {
+				return itr->second;
+			}
+			if (chained_parent_ad == NULL) {
+				return NULL;
+			}
+			const AttrList &parentList = chained_parent_ad->attrList;
+			itr = parentList.find_hinted( name, parent_hint );
+			if (itr != parentList.end()) {
+				return itr->second;
+			}
+			if (chained_parent_ad->chained_parent_ad) {
+				return chained_parent_ad->chained_parent_ad->Lookup( name );
+			}
+			return NULL;
+#else
+			(void)own_hint; (void)parent_hint;
+			return Lookup( name );
+#endif
+		}
+
 		AttrList	  attrList;
 		DirtyAttrList dirtyAttrList;
 		bool          do_dirty_tracking;
@@ -129,6 +129,21 @@ class ClassAdFlatMap {
 			}
 		}
 
+		// find() that first checks the entry at position hint, which is
+		// the position the key was found at in a similar map.  On a miss
+		// hint is set to the position of the key in this map, or to -1 if
+		// the key is not present.
+		const_iterator find_hinted(const std::string &key, int &hint) const {
+			if (hint >= 0 && (size_t)hint < _theVector.size() &&
+				_theVector[hint].first.size() == key.size() &&
+				ClassAdFlatMapEqual(_theVector[hint], key)) {
+				return begin() + hint;
+			}
+			const_iterator it = find(key);
+			hint = (it == end()) ? -1 : (int)(it - begin());
+			return it;
+		}
+
 		// This is the hack for compat with clients who expect the hash interface
 		// Ideally should deprecate this in the future
 		ExprTree *&  operator[](const std::string &key) {
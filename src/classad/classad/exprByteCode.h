@@ -0,0 +1,157 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#ifndef __CLASSAD_EXPR_BYTECODE_H__
+#define __CLASSAD_EXPR_BYTECODE_H__
+
+#include "classad/exprTree.h"
+#include "classad/operators.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace classad {
+
+class ClassAd;
+
+/** An expression tree lowered to a flat, register based bytecode.
+
+	Compile() walks the tree once and emits one instruction for each
+	operator, literal and attribute reference.  Evaluation then runs the
+	instructions in a loop instead of making a virtual call for every node.
+	Short circuit operators and the ternary operator are lowered to jumps.
+	Function calls, nested ads and lists, absolute references (.attr) and
+	any other node that has no instruction of its own are evaluated by
+	the tree walker, as is the expression that an attribute reference
+	resolves to.
+
+	An unscoped attribute that is used as the scope of other references,
+	like TARGET in TARGET.Memory, is looked up only once per evaluation.
+
+	Attribute references remember the position that the attribute had in
+	the ad that it was last found in, so that looking up the same attribute
+	in ads with the same shape (the slot ads in the negotiator, for
+	instance) usually costs a single string compare instead of a search.
+
+	The result of Evaluate() is identical to ExprTree::Evaluate() for the
+	same tree.  When the bytecode cannot reproduce the tree walker exactly
+	(evaluation failure, a reference that resolves to a list, debug
+	evaluation) the whole expression is evaluated again by the tree walker.
+
+	The bytecode keeps pointers into the tree, so the tree must outlive it
+	and must not be modified while it is compiled.  A compiled expression
+	may be evaluated by several threads at the same time.
+*/
+class ExprByteCode
+{
+	public:
+		ExprByteCode();
+		~ExprByteCode();
+
+		ExprByteCode(const ExprByteCode &) = delete;
+		ExprByteCode &operator=(const ExprByteCode &) = delete;
+
+		/** Compile an expression tree, replacing any previous bytecode.
+			@param tree The expression to compile, may be NULL.
+			@return false if tree is NULL.
+		*/
+		bool Compile( const ExprTree *tree );
+
+		/// Discard the bytecode and forget the tree
+		void Clear();
+
+		/// The tree that was compiled
+		const ExprTree *GetTree() const { return m_tree; }
+
+		/** Evaluate the compiled expression.
+			@param state The evaluation state, as for ExprTree::Evaluate()
+			@param result The result of the evaluation
+			@return true if the evaluation succeeded, false otherwise
+		*/
+		bool Evaluate( EvalState &state, Value &result ) const;
+
+		/** Evaluate the compiled expression in the scope of an ad, as
+			ClassAd::EvaluateExpr() does for the tree.
+		*/
+		bool Evaluate( const ClassAd *scope, Value &result ) const;
+
+		/// The number of instructions
+		size_t size() const { return m_code.size(); }
+
+		/// Write a listing of the bytecode, for debugging
+		void Dump( std::string &buffer ) const;
+
+	private:
+		enum OpCode {
+			BC_CONST,        // dst = constant a
+			BC_TREE,         // dst = tree walker evaluation of node
+			BC_ATTR,         // dst = value of unscoped attribute name
+			BC_SCOPED_ATTR,  // dst = value of attribute name in the ad in register a
+			BC_SCOPE,        // dst = value of unscoped attribute name, once per evaluation
+			BC_UNARY,        // dst = op a
+			BC_BINARY,       // dst = a op b
+			BC_OR,           // if a is true, dst = true and jump to target
+			BC_AND,          // if a is false, dst = false and jump to target
+			BC_ELVIS,        // if a is not undefined, dst = a and jump to target
+			BC_TERNARY,      // if a is false jump to target, if a is not boolean jump to b
+			BC_JUMP,         // jump to target
+		};
+
+		struct Instr {
+			OpCode op;
+			Operation::OpKind opKind;
+			int dst;
+			int a;
+			int b;
+			int target;
+			int hint;                  // index into m_hints for attribute references
+			const ExprTree *node;      // the tree node this instruction came from
+			const std::string *name;   // attribute name, points into the tree
+		};
+
+		// Positions of an attribute in the ad and the chained parent ad it
+		// was last found in.  These are only hints, so updates may race.
+		struct Hint {
+			std::atomic<int> own;
+			std::atomic<int> parent;
+		};
+
+		int compileNode( const ExprTree *tree, int dst );
+		int scopeIndex( const std::string &name );
+		int allocReg();
+		int emit( OpCode op, int dst, const ExprTree *node );
+		bool run( EvalState &state, Value *regs ) const;
+		bool lookupAttr( EvalState &state, const ClassAd *current, const Instr &ins,
+						bool unscoped, Value &val ) const;
+
+		const ExprTree *m_tree;
+		std::vector<Instr> m_code;
+		std::vector<Value> m_consts;
+		std::unique_ptr<Hint[]> m_hints;
+		std::vector<const std::string *> m_scopeNames;  // attributes looked up by BC_SCOPE
+		int m_numHints;
+		int m_numRegs;
+		int m_nextReg;     // first free register while compiling
+};
+
+} // classad
+
+#endif//__CLASSAD_EXPR_BYTECODE_H__
@@ -231,6 +231,7 @@ class ExprTree
 		friend class ClassAd;
 		friend class CachedExprEnvelope;
 		friend class Literal;
+		friend class ExprByteCode;
 
 		/// Copy constructor
         ExprTree(const ExprTree &tree);
@@ -226,6 +226,7 @@ class Operation : public ExprTree
 		friend class OperationParens;
 		friend class Operation2;
 		friend class Operation3;
+		friend class ExprByteCode;
 };
 
 
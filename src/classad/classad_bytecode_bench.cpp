@@ -0,0 +1,322 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+/*
+ * Compare the tree walker and the bytecode evaluator on the expressions
+ * that the negotiator evaluates for every job/slot pair: the job's
+ * Requirements and Rank, and the slot's Requirements.
+ *
+ * The ads are read from files in the long format written by
+ * condor_q -long and condor_status -long, one attribute per line with a
+ * blank line between ads.  Every pair is first evaluated both ways and
+ * the results compared, then each evaluator is timed on its own.
+ * The exit status is 1 if any result differs.
+ */
+
+#include "classad/classad_distribution.h"
+#include "classad/exprByteCode.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using namespace classad;
+
+struct BenchAd {
+	ClassAd *ad;
+	ExprTree *requirements;
+	ExprTree *rank;
+	ExprByteCode requirementsCode;
+	ExprByteCode rankCode;
+};
+
+static void usage(const char *name)
+{
+	cerr << "Usage: " << name << " [-iterations <n>] [-dump] <job-ads> <slot-ads>\n"
+		 << "    <job-ads> and <slot-ads> are files in the format written by\n"
+		 << "    condor_q -long and condor_status -long\n";
+	exit(2);
+}
+
+static bool read_ads(const char *filename, vector<BenchAd*> &ads)
+{
+	std::ifstream in(filename);
+	if ( ! in) {
+		cerr << "Can't open " << filename << endl;
+		return false;
+	}
+
+	ClassAdParser parser;
+	ClassAd *ad = NULL;
+	string line;
+	int line_number = 0;
+	while (true) {
+		bool more = (bool)std::getline(in, line);
+		++line_number;
+		size_t start = more ? line.find_first_not_of(" \t\r") : string::npos;
+		if (start == string::npos) {
+			// blank line or end of file ends the current ad
+			if (ad) {
+				BenchAd *bench = new BenchAd;
+				bench->ad = ad;
+				bench->requirements = ad->Lookup("Requirements");
+				bench->rank = ad->Lookup("Rank");
+				ads.push_back(bench);
+				ad = NULL;
+			}
+			if ( ! more) break;
+			continue;
+		}
+		if (line[start] == '#') {
+			continue;
+		}
+
+		size_t eq = line.find('=', start);
+		if (eq == string::npos) {
+			// headers like "-- Schedd: ..."
+			continue;
+		}
+		size_t name_end = line.find_last_not_of(" \t", eq - 1);
+		if (name_end == string::npos || name_end < start) {
+			continue;
+		}
+		string name = line.substr(start, name_end - start + 1);
+		ExprTree *tree = NULL;
+		if ( ! parser.ParseExpression(line.substr(eq + 1), tree, true) || ! tree) {
+			cerr << filename << ":" << line_number << ": can't parse " << name << endl;
+			continue;
+		}
+		if ( ! ad) {
+			ad = new ClassAd;
+		}
+		ad->Insert(name, tree);
+	}
+	return true;
+}
+
+static bool same_value(bool rval1, const Value &v1, bool rval2, const Value &v2)
+{
+	double r1, r2;
+	if (rval1 != rval2 || v1.GetType() != v2.GetType()) {
+		return false;
+	}
+	if (v1.IsRealValue(r1) && v2.IsRealValue(r2)) {
+		return memcmp(&r1, &r2, sizeof(r1)) == 0;
+	}
+	return v1.SameAs(v2);
+}
+
+static bool eval_tree(const ExprTree *tree, const ClassAd *scope, Value &val)
+{
+	if ( ! tree) {
+		val.SetUndefinedValue();
+		return true;
+	}
+	EvalState state;
+	state.SetScopes(scope);
+	return tree->Evaluate(state, val);
+}
+
+static bool eval_code(const ExprByteCode &code, const ClassAd *scope, Value &val)
+{
+	if ( ! code.GetTree()) {
+		val.SetUndefinedValue();
+		return true;
+	}
+	EvalState state;
+	state.SetScopes(scope);
+	return code.Evaluate(state, val);
+}
+
+	// evaluate each pair with one evaluator, returns the number of matches
+template <class EvalFunc>
+static long long run_pairs(MatchClassAd &match, vector<BenchAd*> &jobs, vector<BenchAd*> &slots,
+						   int iterations, EvalFunc eval)
+{
+	long long matches = 0;
+	for (int iter = 0; iter < iterations; ++iter) {
+		for (auto job : jobs) {
+			match.ReplaceLeftAd(job->ad);
+			for (auto slot : slots) {
+				match.ReplaceRightAd(slot->ad);
+				if (eval(job, slot)) {
+					++matches;
+				}
+				match.RemoveRightAd();
+			}
+			match.RemoveLeftAd();
+		}
+	}
+	return matches;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = 1;
+	bool dump = false;
+	const char *job_file = NULL;
+	const char *slot_file = NULL;
+
+	for (int ix = 1; ix < argc; ++ix) {
+		if ( ! strcmp(argv[ix], "-iterations") && ix + 1 < argc) {
+			iterations = atoi(argv[++ix]);
+		} else if ( ! strcmp(argv[ix], "-dump")) {
+			dump = true;
+		} else if (argv[ix][0] == '-') {
+			usage(argv[0]);
+		} else if ( ! job_file) {
+			job_file = argv[ix];
+		} else if ( ! slot_file) {
+			slot_file = argv[ix];
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if ( ! job_file || ! slot_file || iterations < 1) {
+		usage(argv[0]);
+	}
+
+	vector<BenchAd*> jobs, slots;
+	if ( ! read_ads(job_file, jobs) || ! read_ads(slot_file, slots)) {
+		return 2;
+	}
+	if (jobs.empty() || slots.empty()) {
+		cerr << "Need at least one job ad and one slot ad" << endl;
+		return 2;
+	}
+
+	size_t instructions = 0, expressions = 0;
+	for (auto list : { &jobs, &slots }) {
+		for (auto bench : *list) {
+			if (bench->requirements) {
+				bench->requirementsCode.Compile(bench->requirements);
+				instructions += bench->requirementsCode.size();
+				++expressions;
+			}
+			if (bench->rank) {
+				bench->rankCode.Compile(bench->rank);
+				instructions += bench->rankCode.size();
+				++expressions;
+			}
+		}
+	}
+	cout << jobs.size() << " job ads, " << slots.size() << " slot ads, "
+		 << expressions << " expressions compiled to " << instructions << " instructions" << endl;
+	if (dump) {
+		string listing;
+		jobs[0]->requirementsCode.Dump(listing);
+		cout << "Requirements of the first job:\n" << listing;
+	}
+
+	MatchClassAd match;
+
+		// first check that both evaluators agree on every pair
+	long long mismatches = 0;
+	run_pairs(match, jobs, slots, 1, [&](BenchAd *job, BenchAd *slot) {
+		struct { ExprTree *tree; const ExprByteCode *code; ClassAd *scope; const char *what; } exprs[] = {
+			{ job->requirements, &job->requirementsCode, job->ad, "job Requirements" },
+			{ slot->requirements, &slot->requirementsCode, slot->ad, "slot Requirements" },
+			{ job->rank, &job->rankCode, job->ad, "job Rank" },
+		};
+		for (auto & expr : exprs) {
+			Value tree_val, code_val;
+			bool tree_rval = eval_tree(expr.tree, expr.scope, tree_val);
+			bool code_rval = eval_code(*expr.code, expr.scope, code_val);
+			if ( ! same_value(tree_rval, tree_val, code_rval, code_val)) {
+				if (mismatches < 10) {
+					ClassAdUnParser unparser;
+					string tree_str, code_str;
+					unparser.Unparse(tree_str, tree_val);
+					unparser.Unparse(code_str, code_val);
+					cerr << "MISMATCH in " << expr.what << ": tree walker " << tree_str
+						 << (tree_rval ? "" : " (failed)") << ", bytecode " << code_str
+						 << (code_rval ? "" : " (failed)") << endl;
+				}
+				++mismatches;
+			}
+		}
+		return false;
+	});
+
+	auto evaluate_pair = [](bool use_code, BenchAd *job, BenchAd *slot) {
+		Value val;
+		bool job_ok = false, slot_ok = false;
+		if (use_code) {
+			job_ok = eval_code(job->requirementsCode, job->ad, val) && val.IsBooleanValueEquiv(job_ok) && job_ok;
+			slot_ok = eval_code(slot->requirementsCode, slot->ad, val) && val.IsBooleanValueEquiv(slot_ok) && slot_ok;
+		} else {
+			job_ok = eval_tree(job->requirements, job->ad, val) && val.IsBooleanValueEquiv(job_ok) && job_ok;
+			slot_ok = eval_tree(slot->requirements, slot->ad, val) && val.IsBooleanValueEquiv(slot_ok) && slot_ok;
+		}
+		if ( ! job_ok || ! slot_ok) {
+			return false;
+		}
+		if (use_code) {
+			eval_code(job->rankCode, job->ad, val);
+		} else {
+			eval_tree(job->rank, job->ad, val);
+		}
+		return true;
+	};
+
+	auto begin = std::chrono::steady_clock::now();
+	long long tree_matches = run_pairs(match, jobs, slots, iterations,
+		[&](BenchAd *job, BenchAd *slot) { return evaluate_pair(false, job, slot); });
+	double tree_time = seconds_since(begin);
+
+	begin = std::chrono::steady_clock::now();
+	long long code_matches = run_pairs(match, jobs, slots, iterations,
+		[&](BenchAd *job, BenchAd *slot) { return evaluate_pair(true, job, slot); });
+	double code_time = seconds_since(begin);
+
+	double pairs = (double)jobs.size() * (double)slots.size() * iterations;
+	cout << "tree walker: " << tree_time << " s, " << (tree_time * 1e9 / pairs) << " ns/pair, "
+		 << tree_matches << " matches" << endl;
+	cout << "bytecode:    " << code_time << " s, " << (code_time * 1e9 / pairs) << " ns/pair, "
+		 << code_matches << " matches" << endl;
+	if (code_time > 0) {
+		cout << "speedup:     " << (tree_time / code_time) << endl;
+	}
+	if (tree_matches != code_matches) {
+		++mismatches;
+	}
+	cout << mismatches << " mismatches" << endl;
+
+	for (auto list : { &jobs, &slots }) {
+		for (auto bench : *list) {
+			bench->requirementsCode.Clear();
+			bench->rankCode.Clear();
+			delete bench->ad;
+			delete bench;
+		}
+	}
+	return mismatches ? 1 : 0;
+}
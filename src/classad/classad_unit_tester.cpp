@@ -34,6 +34,7 @@
 
 #include "classad/classad_distribution.h"
 #include "classad/lexerSource.h"
+#include "classad/exprByteCode.h"
 #include "classad/xmlSink.h"
 #include <fstream>
 #include <iostream>
@@ -69,6 +70,7 @@ public:
     bool  check_operator;
     bool  check_collection;
     bool  check_utils;
+    bool  check_bytecode;
 	void  ParseCommandLine(int argc, char **argv);
 };
 
@@ -101,6 +103,7 @@ static void test_exprlist(const Parameters &parameters, Results &results);
 static void test_value(const Parameters &parameters, Results &results);
 static void test_collection(const Parameters &parameters, Results &results);
 static void test_utils(const Parameters &parameters, Results &results);
+static void test_bytecode(const Parameters &parameters, Results &results);
 static bool check_in_view(ClassAdCollection *collection, string view_name, string classad_name);
 static void print_version(void);
 
@@ -133,6 +136,7 @@ void Parameters::ParseCommandLine(
     check_operator      = false;
     check_collection    = false;
     check_utils         = false;
+    check_bytecode      = false;
 
 	// Then we parse to see what the user wants. 
 	for (int arg_index = 1; arg_index < argc; arg_index++) {
@@ -179,6 +183,9 @@ void Parameters::ParseCommandLine(
             selected_test       = true;
 		} else if (!strcasecmp(argv[arg_index], "-utils")){
             check_utils         = true;
+            selected_test       = true;
+		} else if (!strcasecmp(argv[arg_index], "-bytecode")){
+            check_bytecode      = true;
             selected_test       = true;
 		} else {
             cout << "Unknown argument: " << argv[arg_index] << endl;
@@ -206,6 +213,7 @@ void Parameters::ParseCommandLine(
         cout << "    -operator:   test the Operator class.\n";
         cout << "    -collection: test the Collection class.\n";
         cout << "    -utils:      test little utilities.\n";
+        cout << "    -bytecode:   test the ExprByteCode class.\n";
         exit(1);
     }
     if (!selected_test) {
@@ -302,6 +310,9 @@ int main(
     if (parameters.check_all || parameters.check_utils) {
         test_utils(parameters, results);
     }
+    if (parameters.check_all || parameters.check_bytecode) {
+        test_bytecode(parameters, results);
+    }
 
     /* ----- Report ----- */
     cout << endl;
@@ -1036,6 +1047,149 @@ static void test_utils(const Parameters &, Results &results)
     return;
 }
 
+/*********************************************************************
+ *
+ * Function: test_bytecode
+ * Purpose:  Test that the ExprByteCode class gives the same results
+ *           as the tree walker.
+ *
+ *********************************************************************/
+static bool same_value(const Value &v1, const Value &v2)
+{
+    double r1, r2;
+    if (v1.GetType() != v2.GetType()) {
+        return false;
+    }
+    if (v1.IsRealValue(r1) && v2.IsRealValue(r2)) {
+        return memcmp(&r1, &r2, sizeof(r1)) == 0;
+    }
+    return v1.SameAs(v2);
+}
+
+static void test_bytecode(const Parameters &, Results &results)
+{
+    cout << "Testing the ExprByteCode class...\n";
+
+    ClassAdParser parser;
+    MatchClassAd  match;
+
+    ClassAd *job = parser.ParseClassAd(
+        "[ Owner = \"alice\"; RequestMemory = 2048; RequestCpus = 2; Rank = TARGET.Mips * 2 + Memory;"
+        "  Requirements = TARGET.Arch == \"X86_64\" && TARGET.Memory >= RequestMemory && TARGET.Cpus >= RequestCpus;"
+        "  JobPrio = 0; Nested = [ x = 3 ]; Items = { [ v = 1 ], [ v = 2 ] } ]");
+    ClassAd *slot = parser.ParseClassAd(
+        "[ Arch = \"X86_64\"; Memory = 4096; Cpus = 4; Mips = 1000.5; KeyboardIdle = 1200;"
+        "  Requirements = MY.Start && (TARGET.RequestMemory ?: 0) <= MY.Memory;"
+        "  Start = KeyboardIdle > 15 * 60 || Owner == \"bob\"; Loop = Loop + 1 ]");
+    TEST("Parsed bytecode job ad", job != NULL);
+    TEST("Parsed bytecode slot ad", slot != NULL);
+    if (!job || !slot) {
+        delete job;
+        delete slot;
+        return;
+    }
+    match.InitMatchClassAd(job, slot);
+
+    const char *slot_exprs[] = {
+        "Requirements",
+        "Start",
+        "TARGET.Requirements",
+        "TARGET.Rank",
+        "Memory - TARGET.RequestMemory",
+        "Mips / 3",
+        "-Memory",
+        "!Start",
+        "~Cpus",
+        "Missing",
+        "Missing ?: Cpus",
+        "Cpus ?: Missing",
+        "Missing =?= undefined",
+        "Missing || true",
+        "Missing && false",
+        "false && Loop",
+        "true || Loop",
+        "Loop",
+        "Cpus > 2 ? \"big\" : \"small\"",
+        "Missing ? 1 : 2",
+        "\"x\" ? 1 : 2",
+        "Memory ? 1 : 2",
+        "TARGET.Nested.x + 1",
+        "TARGET.Items.v",
+        "TARGET.Missing.v",
+        "Arch.foo",
+        "strcat(Arch, \"-\", TARGET.Owner)",
+        "{ Cpus, Memory }[1]",
+        "[ a = Cpus ].a",
+        ".Memory",
+        "1/0",
+        "Cpus % 0",
+        "(((Cpus)))",
+        "MY.Cpus * 1.5 >= 6.0",
+        "Arch == \"x86_64\" && Arch =!= \"x86_64\"",
+        "toUpper(Arch) == \"X86_64\"",
+    };
+
+    for (size_t ix = 0; ix < sizeof(slot_exprs)/sizeof(slot_exprs[0]); ++ix) {
+        ExprTree *tree = NULL;
+        if ( ! parser.ParseExpression(slot_exprs[ix], tree, true)) {
+            TEST(slot_exprs[ix], false);
+            continue;
+        }
+        tree->SetParentScope(slot);
+
+        ExprByteCode code;
+        Value tree_val, code_val, again_val;
+        bool tree_rval, code_rval, again_rval;
+
+        EvalState tree_state;
+        tree_state.SetScopes(slot);
+        tree_rval = tree->Evaluate(tree_state, tree_val);
+
+        code.Compile(tree);
+        EvalState code_state;
+        code_state.SetScopes(slot);
+        code_rval = code.Evaluate(code_state, code_val);
+        TEST(slot_exprs[ix], tree_rval == code_rval && same_value(tree_val, code_val));
+        TEST("Bytecode restores the current scope", code_state.curAd == tree_state.curAd);
+
+            // evaluate again, now that the attribute position hints are set
+        EvalState again_state;
+        again_state.SetScopes(slot);
+        again_rval = code.Evaluate(again_state, again_val);
+        TEST(slot_exprs[ix], tree_rval == again_rval && same_value(tree_val, again_val));
+
+        delete tree;
+    }
+
+        // the hints come from a slot ad with a different layout
+    ClassAd *slot2 = parser.ParseClassAd(
+        "[ A = 1; Arch = \"INTEL\"; Cpus = 1; Memory = 512; Mips = 10; KeyboardIdle = 0;"
+        "  Requirements = MY.Start && (TARGET.RequestMemory ?: 0) <= MY.Memory;"
+        "  Start = KeyboardIdle > 15 * 60 || Owner == \"bob\" ]");
+    ExprByteCode reqs;
+    reqs.Compile(job->Lookup("Requirements"));
+    bool matched = false;
+    Value val;
+    EvalState state;
+    state.SetScopes(job);
+    TEST("Bytecode job requirements match slot", reqs.Evaluate(state, val) && val.IsBooleanValue(matched) && matched);
+    match.RemoveRightAd();
+    match.ReplaceRightAd(slot2);
+    state.SetScopes(job);
+    TEST("Bytecode job requirements don't match slot2", reqs.Evaluate(state, val) && val.IsBooleanValue(matched) && !matched);
+    match.RemoveRightAd();
+    match.ReplaceRightAd(slot);
+    state.SetScopes(job);
+    TEST("Bytecode job requirements match slot again", reqs.Evaluate(state, val) && val.IsBooleanValue(matched) && matched);
+
+    match.RemoveLeftAd();
+    match.RemoveRightAd();
+    delete job;
+    delete slot;
+    delete slot2;
+    return;
+}
+
 /*********************************************************************
  *
  * Function: print_version
@@ -0,0 +1,576 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+
+#include "classad/common.h"
+#include "classad/classad.h"
+#include "classad/attrrefs.h"
+#include "classad/literals.h"
+#include "classad/exprByteCode.h"
+#include "classad/sink.h"
+
+using std::string;
+
+namespace classad {
+
+// registers are allocated on the stack when the bytecode needs no more than this
+static const int LOCAL_REGISTERS = 16;
+
+// the most scope attributes that are looked up once per evaluation, each
+// has a bit in a mask while running
+static const int MAX_SCOPES = 64;
+
+// marks the register of a scope attribute while compiling, the scope
+// registers are placed after the others once their number is known
+static const int SCOPE_REGISTER = 1 << 30;
+
+ExprByteCode::
+ExprByteCode() : m_tree(NULL), m_numHints(0), m_numRegs(0), m_nextReg(0)
+{
+}
+
+ExprByteCode::
+~ExprByteCode()
+{
+}
+
+void ExprByteCode::
+Clear()
+{
+	m_tree = NULL;
+	m_code.clear();
+	m_consts.clear();
+	m_scopeNames.clear();
+	m_hints.reset();
+	m_numHints = 0;
+	m_numRegs = 0;
+	m_nextReg = 0;
+}
+
+bool ExprByteCode::
+Compile( const ExprTree *tree )
+{
+	Clear();
+	if( !tree ) {
+		return false;
+	}
+
+	m_tree = tree;
+	compileNode( tree, allocReg() );
+
+	for( auto &ins : m_code ) {
+		if( ins.dst >= SCOPE_REGISTER ) {
+			ins.dst = m_numRegs + ( ins.dst - SCOPE_REGISTER );
+		}
+		if( ins.op == BC_SCOPED_ATTR && ins.a >= SCOPE_REGISTER ) {
+			ins.a = m_numRegs + ( ins.a - SCOPE_REGISTER );
+		}
+	}
+	m_numRegs += (int)m_scopeNames.size();
+
+	if( m_numHints > 0 ) {
+		m_hints.reset( new Hint[m_numHints] );
+		for( int ix = 0; ix < m_numHints; ++ix ) {
+			m_hints[ix].own.store( -1, std::memory_order_relaxed );
+			m_hints[ix].parent.store( -1, std::memory_order_relaxed );
+		}
+	}
+	return true;
+}
+
+int ExprByteCode::
+scopeIndex( const string &name )
+{
+	for( size_t ix = 0; ix < m_scopeNames.size(); ++ix ) {
+		if( strcasecmp( m_scopeNames[ix]->c_str(), name.c_str() ) == 0 ) {
+			return (int)ix;
+		}
+	}
+	if( (int)m_scopeNames.size() >= MAX_SCOPES ) {
+		return -1;
+	}
+	m_scopeNames.push_back( &name );
+	return (int)m_scopeNames.size() - 1;
+}
+
+int ExprByteCode::
+allocReg()
+{
+	int reg = m_nextReg++;
+	if( m_nextReg > m_numRegs ) {
+		m_numRegs = m_nextReg;
+	}
+	return reg;
+}
+
+int ExprByteCode::
+emit( OpCode op, int dst, const ExprTree *node )
+{
+	Instr ins;
+	ins.op = op;
+	ins.opKind = Operation::__NO_OP__;
+	ins.dst = dst;
+	ins.a = -1;
+	ins.b = -1;
+	ins.target = -1;
+	ins.hint = -1;
+	ins.node = node;
+	ins.name = NULL;
+	m_code.push_back( ins );
+	return (int)m_code.size() - 1;
+}
+
+	// Emit the code that evaluates tree into register dst.  Registers for
+	// operands are allocated above dst and released once the operator that
+	// consumes them has been emitted, so the register file stays small.
+	// Returns the index of the first instruction emitted.
+int ExprByteCode::
+compileNode( const ExprTree *tree, int dst )
+{
+	int start = (int)m_code.size();
+	tree = tree->self();
+
+	switch( tree->GetKind() ) {
+	case ExprTree::ERROR_LITERAL:
+	case ExprTree::UNDEFINED_LITERAL:
+	case ExprTree::BOOLEAN_LITERAL:
+	case ExprTree::INTEGER_LITERAL:
+	case ExprTree::REAL_LITERAL:
+	case ExprTree::RELTIME_LITERAL:
+	case ExprTree::ABSTIME_LITERAL:
+	case ExprTree::STRING_LITERAL: {
+		Value val;
+		((const Literal *)tree)->GetValue( val );
+		m_consts.push_back( val );
+		int ix = emit( BC_CONST, dst, tree );
+		m_code[ix].a = (int)m_consts.size() - 1;
+		return start;
+	}
+
+	case ExprTree::ATTRREF_NODE: {
+		const AttributeReference *ref = (const AttributeReference *)tree;
+		if( ref->absolute ) {
+			break;
+		}
+		int ix;
+		const ExprTree *scopeTree = ref->expr ? ref->expr->self() : NULL;
+		const AttributeReference *scopeRef = NULL;
+		if( scopeTree && scopeTree->GetKind() == ExprTree::ATTRREF_NODE ) {
+			scopeRef = (const AttributeReference *)scopeTree;
+			if( scopeRef->expr || scopeRef->absolute ) {
+				scopeRef = NULL;
+			}
+		}
+		int cached = scopeRef ? scopeIndex( scopeRef->attributeStr ) : -1;
+		if( cached >= 0 ) {
+				// attribute references restore the current scope, so an
+				// unscoped reference gives the same ad every time it is
+				// evaluated. look it up the first time it is needed.
+			int scope = SCOPE_REGISTER + cached;
+			ix = emit( BC_SCOPE, scope, scopeTree );
+			m_code[ix].b = cached;
+			m_code[ix].name = &scopeRef->attributeStr;
+			m_code[ix].hint = m_numHints++;
+			ix = emit( BC_SCOPED_ATTR, dst, tree );
+			m_code[ix].a = scope;
+		} else if( ref->expr ) {
+			int scope = allocReg();
+			compileNode( ref->expr, scope );
+			ix = emit( BC_SCOPED_ATTR, dst, tree );
+			m_code[ix].a = scope;
+			m_nextReg = scope;
+		} else {
+			ix = emit( BC_ATTR, dst, tree );
+		}
+		m_code[ix].name = &ref->attributeStr;
+		m_code[ix].hint = m_numHints++;
+		return start;
+	}
+
+	case ExprTree::OP_NODE: {
+		Operation::OpKind kind = Operation::__NO_OP__;
+		ExprTree *child1 = NULL, *child2 = NULL, *child3 = NULL;
+		((const Operation *)tree)->GetComponents( kind, child1, child2, child3 );
+
+		if( kind == Operation::PARENTHESES_OP && child1 && !child2 && !child3 ) {
+			compileNode( child1, dst );
+			return start;
+		}
+
+		if( kind == Operation::TERNARY_OP ) {
+				// a ternary operator without a middle, or with a condition that
+				// is not boolean, is left to the tree walker
+			if( !child1 || !child2 || !child3 ) {
+				break;
+			}
+			int cond = allocReg();
+			compileNode( child1, cond );
+			int test = emit( BC_TERNARY, dst, tree );
+			m_code[test].a = cond;
+			m_nextReg = cond;
+			compileNode( child2, dst );
+			int skip1 = emit( BC_JUMP, dst, tree );
+			m_code[test].target = (int)m_code.size();
+			compileNode( child3, dst );
+			int skip2 = emit( BC_JUMP, dst, tree );
+			m_code[test].b = emit( BC_TREE, dst, tree );
+			m_code[skip1].target = m_code[skip2].target = (int)m_code.size();
+			return start;
+		}
+
+		if( child1 && !child2 && !child3 &&
+			( kind == Operation::UNARY_PLUS_OP || kind == Operation::UNARY_MINUS_OP ||
+			  kind == Operation::LOGICAL_NOT_OP || kind == Operation::BITWISE_NOT_OP ) ) {
+			int arg1 = allocReg();
+			compileNode( child1, arg1 );
+			int ix = emit( BC_UNARY, dst, tree );
+			m_code[ix].opKind = kind;
+			m_code[ix].a = arg1;
+			m_nextReg = arg1;
+			return start;
+		}
+
+		if( child1 && child2 && !child3 &&
+			kind > Operation::__NO_OP__ && kind != Operation::PARENTHESES_OP &&
+			kind != Operation::TERNARY_OP ) {
+			int arg1 = allocReg();
+			compileNode( child1, arg1 );
+			int shortCircuit = -1;
+			if( kind == Operation::LOGICAL_OR_OP ) {
+				shortCircuit = emit( BC_OR, dst, tree );
+			} else if( kind == Operation::LOGICAL_AND_OP ) {
+				shortCircuit = emit( BC_AND, dst, tree );
+			} else if( kind == Operation::ELVIS_OP ) {
+				shortCircuit = emit( BC_ELVIS, dst, tree );
+			}
+			if( shortCircuit >= 0 ) {
+				m_code[shortCircuit].a = arg1;
+			}
+			int arg2 = allocReg();
+			compileNode( child2, arg2 );
+			int ix = emit( BC_BINARY, dst, tree );
+			m_code[ix].opKind = kind;
+			m_code[ix].a = arg1;
+			m_code[ix].b = arg2;
+			if( shortCircuit >= 0 ) {
+				m_code[shortCircuit].target = (int)m_code.size();
+			}
+			m_nextReg = arg1;
+			return start;
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+		// function calls, nested ads and lists, absolute attribute references
+		// and anything else we don't have an instruction for
+	emit( BC_TREE, dst, tree );
+	return start;
+}
+
+bool ExprByteCode::
+lookupAttr( EvalState &state, const ClassAd *current, const Instr &ins,
+			bool unscoped, Value &val ) const
+{
+	const ClassAd *curAd = state.curAd;
+	ExprTree *tree = NULL;
+	int rc;
+
+		// this follows AttributeReference::FindExpr() and _Evaluate()
+	if( !current ) {
+		val.SetUndefinedValue();
+		return true;
+	}
+
+	Hint &hint = m_hints[ins.hint];
+	int own = hint.own.load( std::memory_order_relaxed );
+	int parent = hint.parent.load( std::memory_order_relaxed );
+	int ownWas = own, parentWas = parent;
+	tree = current->LookupHinted( *ins.name, own, parent );
+	if( own != ownWas && own >= 0 ) {
+		hint.own.store( own, std::memory_order_relaxed );
+	}
+	if( parent != parentWas && parent >= 0 ) {
+		hint.parent.store( parent, std::memory_order_relaxed );
+	}
+
+	if( tree ) {
+			// same as the first step of LookupInScope()
+		state.curAd = current;
+		rc = ExprTree::EVAL_OK;
+	} else {
+		rc = current->LookupInScope( *ins.name, tree, state );
+		if( unscoped && rc == ExprTree::EVAL_UNDEF && current->alternateScope ) {
+			rc = current->alternateScope->LookupInScope( *ins.name, tree, state );
+		}
+	}
+
+	switch( rc ) {
+	case ExprTree::EVAL_ERROR:
+		val.SetErrorValue();
+		state.curAd = curAd;
+		return true;
+
+	case ExprTree::EVAL_UNDEF:
+		val.SetUndefinedValue();
+		state.curAd = curAd;
+		return true;
+
+	case ExprTree::EVAL_OK: {
+		if( state.depth_remaining <= 0 ) {
+			return false;
+		}
+		state.depth_remaining--;
+		bool rval = tree->Evaluate( state, val );
+		state.depth_remaining++;
+		state.curAd = curAd;
+		return rval;
+	}
+
+	default:
+		return false;
+	}
+}
+
+bool ExprByteCode::
+run( EvalState &state, Value *regs ) const
+{
+	const Instr *code = m_code.data();
+	int end = (int)m_code.size();
+	int pc = 0;
+	uint64_t scopesDone = 0;
+	bool b;
+
+	while( pc < end ) {
+		const Instr &ins = code[pc++];
+		Value &dst = regs[ins.dst];
+
+		switch( ins.op ) {
+		case BC_CONST:
+			dst.CopyFrom( m_consts[ins.a] );
+			break;
+
+		case BC_TREE:
+			dst.Clear();
+			if( !ins.node->Evaluate( state, dst ) ) {
+				return false;
+			}
+			break;
+
+		case BC_ATTR:
+			dst.Clear();
+			if( !lookupAttr( state, state.curAd, ins, true, dst ) ) {
+				return false;
+			}
+			break;
+
+		case BC_SCOPE:
+			if( !( scopesDone & ( 1ULL << ins.b ) ) ) {
+				dst.Clear();
+				if( !lookupAttr( state, state.curAd, ins, true, dst ) ) {
+					return false;
+				}
+				scopesDone |= 1ULL << ins.b;
+			}
+			break;
+
+		case BC_SCOPED_ATTR: {
+			const Value &scope = regs[ins.a];
+			const ClassAd *current = NULL;
+			dst.Clear();
+			if( scope.IsUndefinedValue() ) {
+				dst.SetUndefinedValue();
+			} else if( scope.IsErrorValue() ) {
+				dst.SetErrorValue();
+			} else if( scope.IsClassAdValue( current ) ) {
+				if( !lookupAttr( state, current, ins, false, dst ) ) {
+					return false;
+				}
+			} else if( scope.IsListValue() ) {
+					// attribute references into a list of ads build a new
+					// list, let the tree walker do that
+				return false;
+			} else {
+				dst.SetErrorValue();
+			}
+			break;
+		}
+
+		case BC_UNARY: {
+			Value none2, none3;
+			dst.Clear();
+			if( Operation::_doOperation( ins.opKind, regs[ins.a], none2, none3,
+										 true, false, false, dst, &state ) == Operation::SIG_NONE ) {
+				return false;
+			}
+			break;
+		}
+
+		case BC_BINARY: {
+			Value none3;
+			dst.Clear();
+			if( Operation::_doOperation( ins.opKind, regs[ins.a], regs[ins.b], none3,
+										 true, true, false, dst, &state ) == Operation::SIG_NONE ) {
+				return false;
+			}
+			break;
+		}
+
+		case BC_OR:
+			if( regs[ins.a].IsBooleanValueEquiv( b ) && b ) {
+				dst.SetBooleanValue( true );
+				pc = ins.target;
+			}
+			break;
+
+		case BC_AND:
+			if( regs[ins.a].IsBooleanValueEquiv( b ) && !b ) {
+				dst.SetBooleanValue( false );
+				pc = ins.target;
+			}
+			break;
+
+		case BC_ELVIS:
+			if( !regs[ins.a].IsUndefinedValue() ) {
+				dst.CopyFrom( regs[ins.a] );
+				pc = ins.target;
+			}
+			break;
+
+		case BC_TERNARY:
+			if( !regs[ins.a].IsBooleanValueEquiv( b ) ) {
+				pc = ins.b;
+			} else if( !b ) {
+				pc = ins.target;
+			}
+			break;
+
+		case BC_JUMP:
+			pc = ins.target;
+			break;
+		}
+	}
+	return true;
+}
+
+bool ExprByteCode::
+Evaluate( EvalState &state, Value &result ) const
+{
+	if( !m_tree ) {
+		result.SetErrorValue();
+		return false;
+	}
+	if( state.debug ) {
+		return m_tree->Evaluate( state, result );
+	}
+
+	const ClassAd *curAd = state.curAd;
+	int depth = state.depth_remaining;
+
+	Value localRegs[LOCAL_REGISTERS];
+	std::unique_ptr<Value[]> heapRegs;
+	Value *regs = localRegs;
+	if( m_numRegs > LOCAL_REGISTERS ) {
+		heapRegs.reset( new Value[m_numRegs] );
+		regs = heapRegs.get();
+	}
+
+	if( run( state, regs ) ) {
+		result.CopyFrom( regs[0] );
+		return true;
+	}
+
+		// start over with the tree walker so that failures, and the
+		// value that comes with them, are exactly what it would produce
+	state.curAd = curAd;
+	state.depth_remaining = depth;
+	return m_tree->Evaluate( state, result );
+}
+
+bool ExprByteCode::
+Evaluate( const ClassAd *scope, Value &result ) const
+{
+	EvalState state;
+
+	state.SetScopes( scope );
+	if( !Evaluate( state, result ) ) {
+		return false;
+	}
+	return result.SafetyCheck( state, Value::ValueType::SAFE_VALUES );
+}
+
+void ExprByteCode::
+Dump( string &buffer ) const
+{
+	static const char * const names[] = {
+		"CONST", "TREE", "ATTR", "SCOPED_ATTR", "SCOPE", "UNARY", "BINARY",
+		"OR", "AND", "ELVIS", "TERNARY", "JUMP",
+	};
+	ClassAdUnParser unparser;
+	char line[128];
+
+	for( size_t pc = 0; pc < m_code.size(); ++pc ) {
+		const Instr &ins = m_code[pc];
+		snprintf( line, sizeof(line), "%4d %-12s r%d", (int)pc, names[ins.op], ins.dst );
+		buffer += line;
+		switch( ins.op ) {
+		case BC_CONST:
+			buffer += " = ";
+			unparser.Unparse( buffer, m_consts[ins.a] );
+			break;
+		case BC_TREE:
+			buffer += " = ";
+			unparser.Unparse( buffer, ins.node );
+			break;
+		case BC_ATTR:
+		case BC_SCOPE:
+			buffer += " = ";
+			buffer += *ins.name;
+			break;
+		case BC_SCOPED_ATTR:
+			snprintf( line, sizeof(line), " = r%d.", ins.a );
+			buffer += line;
+			buffer += *ins.name;
+			break;
+		case BC_UNARY:
+		case BC_BINARY:
+			snprintf( line, sizeof(line), " = op%d r%d", (int)ins.opKind, ins.a );
+			buffer += line;
+			if( ins.op == BC_BINARY ) {
+				snprintf( line, sizeof(line), " r%d", ins.b );
+				buffer += line;
+			}
+			break;
+		case BC_TERNARY:
+			snprintf( line, sizeof(line), " r%d false:%d other:%d", ins.a, ins.target, ins.b );
+			buffer += line;
+			break;
+		default:
+			snprintf( line, sizeof(line), " r%d -> %d", ins.a, ins.target );
+			buffer += line;
+			break;
+		}
+		buffer += "\n";
+	}
+}
+
+} // classad
@@ -112,6 +112,9 @@ int CollectorDaemon::max_pending_query_workers = 50;
 int CollectorDaemon::max_query_worktime = 0;
 int CollectorDaemon::active_query_workers = 0;
 int CollectorDaemon::pending_query_workers = 0;
+bool CollectorDaemon::query_workers_use_threads = false;
+CollectorQueryPool CollectorDaemon::query_thread_pool;
+std::map<int, double> CollectorDaemon::forked_query_start;
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 bool CollectorDaemon::want_track_queries_by_subsys = false;
@@ -295,6 +298,9 @@ void CollectorDaemon::Init()
 	ad=NULL;
 	UpdateTimerId=-1;
 	collectorsToUpdate = NULL;
+
+	// query workers are either forked processes or threads, this is only checked at startup
+	query_workers_use_threads = param_boolean("COLLECTOR_QUERY_WORKERS_USE_THREADS", false);
 	Config();
 
 	// install command handlers for queries
@@ -374,6 +380,8 @@ void CollectorDaemon::Init()
 	// install command handlers for updates
 	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_AD,"UPDATE_STARTD_AD",
 		receive_update,"receive_update",ADVERTISE_STARTD_PERM);
+	daemonCore->Register_CommandWithPayload(UPDATE_STARTD_AD_DELTA,"UPDATE_STARTD_AD_DELTA",
+		receive_update,"receive_update",ADVERTISE_STARTD_PERM);
 	daemonCore->Register_CommandWithPayload(MERGE_STARTD_AD,"MERGE_STARTD_AD",
 		receive_update,"receive_update",NEGOTIATOR);
 	daemonCore->Register_CommandWithPayload(UPDATE_SCHEDD_AD,"UPDATE_SCHEDD_AD",
@@ -896,6 +904,11 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 			active_query_workers--;
 		}
 		collectorStats.global.ActiveQueryWorkers = active_query_workers;
+		auto it = forked_query_start.find(pid);
+		if (it != forked_query_start.end()) {
+			collectorStats.global.updateQueryWorkerStats(-1, _condor_debug_get_time_double() - it->second);
+			forked_query_start.erase(it);
+		}
 	}
 
 	// Grab a queue_entry to service, ignoring "stale" (old) entries.
@@ -970,6 +983,10 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 		}
 	}  // end of while queue_entry == NULL
 
+	if (query_thread_pool.running()) {
+		return StartQueryThread(query_entry, high_prio_query);
+	}
+
 	// If we have made it here, we are allowed to fork another worker
 	// to handle the query represented by query_entry. Fork one!
 	// First stash a copy of query_entry->sock and query_entry->cad so 
@@ -996,6 +1013,9 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 	// Increment our count of active workers
 	active_query_workers++;
 	collectorStats.global.ActiveQueryWorkers = active_query_workers;
+	if ( ! daemonCore->DoFakeCreateThread()) {
+		forked_query_start[tid] = _condor_debug_get_time_double();
+	}
 
 	// Also close query_entry->sock since DaemonCore
 	// will have cloned this socket for the child, and we have no need to write anything
@@ -1018,22 +1038,66 @@ int CollectorDaemon::QueryReaper(int pid, int /* exit_status */ )
 }
 
 
-int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Stream* sock)
+// Hand a query to the worker thread pool, this is used instead of forking when
+// COLLECTOR_QUERY_WORKERS_USE_THREADS is true.
+// Return 1 if the query was started, and -1 upon an error.
+int CollectorDaemon::StartQueryThread(pending_query_entry_t * query_entry, bool high_prio_query)
 {
-	int return_status = TRUE;
-	_condor_runtime runtime;
-	double tick_time = runtime.begin;
-	double query_time = 0;
-	double send_time = 0;
+	query_entry->snapshot = make_query_snapshot(query_entry);
+	if ( ! query_thread_pool.submit(query_entry, query_entry->sock)) {
+		dprintf(D_ALWAYS,
+				"ERROR: failed to hand query to a QueryWorker thread!\n");
+		CollectorRecord::Reclaimer().unpin(query_entry->snapshot->generation);
+		delete query_entry->snapshot;
+		delete query_entry->sock;
+		delete query_entry->cad;
+		free(query_entry);
+		return -1;
+	}
 
-	// Pull out relavent state from query_entry
-	pending_query_entry_t *query_entry = (pending_query_entry_t *) in_query_entry;
-	ClassAd *query = query_entry->cad;
-	bool is_locate = query_entry->is_locate;
-	bool wants_pvt_attrs = false;
-	int num_adtypes = (query_entry->num_adtypes > 0) ? query_entry->num_adtypes : 1;
-	std::deque<CollectorRecord*> results;
+	active_query_workers++;
+	collectorStats.global.ActiveQueryWorkers = active_query_workers;
+
+	dprintf(D_ALWAYS,
+			"QueryWorker: started %squery on worker thread ( max %d active %d pending %d )\n",
+			high_prio_query ? "high priority " : "",
+			max_query_workers, active_query_workers, pending_query_workers);
+
+	return 1;
+}
+
+// Called on the main thread by the query thread pool when a worker thread finishes a query.
+void CollectorDaemon::QueryThreadDone(void * in_query_entry, Stream * sock, int /*status*/, int worker, double latency)
+{
+	pending_query_entry_t * query_entry = (pending_query_entry_t *) in_query_entry;
+
+	dprintf(D_FULLDEBUG, "QueryWorker: thread %d done, latency %.3f\n", worker, latency);
+	collectorStats.global.updateQueryWorkerStats(worker, latency);
 
+	uint64_t generation = query_entry->snapshot->generation;
+	delete query_entry->snapshot;
+	delete sock;
+	delete query_entry->cad;
+	free(query_entry);
+
+	// the ads that were replaced while the query was running can be deleted now,
+	// unless an older query is still running.
+	CollectorRecord::Reclaimer().unpin(generation);
+	CollectorRecord::Reclaimer().reclaim();
+
+	if (active_query_workers > 0) {
+		active_query_workers--;
+	}
+	collectorStats.global.ActiveQueryWorkers = active_query_workers;
+
+	// start the next pending query, if any
+	QueryReaper(-1, -1);
+}
+
+// decide whether private attributes should be filtered out of the ads sent in reply to a query
+bool CollectorDaemon::query_filter_private_attrs(ClassAd * query, Stream * sock)
+{
+	bool wants_pvt_attrs = false;
 	query->LookupBool(ATTR_SEND_PRIVATE_ATTRIBUTES, wants_pvt_attrs);
 
 		// If our peer is at least 8.9.3 and has NEGOTIATOR authz, then we'll
@@ -1061,6 +1125,132 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 		filter_private_attrs = false;
 	}
 
+	return filter_private_attrs;
+}
+
+// if querying collector ads, and the collectors own ad appears in this list.
+// then we want to shove in current statistics. we do this by chaining a
+// temporary stats ad into the ad to be returned, and publishing updated
+// statistics into the stats ad.  we do this because if the verbosity level
+// is increased we do NOT want to put the high-verbosity attributes into
+// our persistent collector ad.
+// returns NULL if the query wants the stored statistics, otherwise the caller
+// must Unchain and delete the returned ad.
+ClassAd * CollectorDaemon::make_self_stats_ad(ClassAd * query, CollectorRecord * self_rec, bool filter_private_attrs)
+{
+	// update stats in the collector ad before we return it.
+	std::string stats_config;
+	query->LookupString("STATISTICS_TO_PUBLISH",stats_config);
+	if (stats_config == "stored") {
+		return nullptr;
+	}
+
+	dprintf(D_ALWAYS,"Updating collector stats using a chained ad and config=%s\n", stats_config.c_str());
+	ClassAd * stats_ad = new ClassAd();
+	if (!filter_private_attrs) {
+		stats_ad->CopyFrom(*self_rec->m_pvtAd);
+	}
+	daemonCore->dc_stats.Publish(*stats_ad, stats_config.c_str());
+	daemonCore->monitor_data.ExportData(stats_ad, true);
+	collectorStats.publishGlobal(stats_ad, stats_config.c_str());
+	stats_ad->ChainToAd(self_rec->m_publicAd);
+	return stats_ad;
+}
+
+// evaluate a projection expression in the context of the query ad, with the given ad as the target.
+// This does what EvalString does, but it does not use the global match ad, and it does not
+// modify the target ad, so it is safe to call while query worker threads are reading the ad.
+static bool eval_projection_expr(const std::string & attr, ClassAd * query, ClassAd * ad, classad::MatchClassAd & mad, std::string & projection)
+{
+	// the match ad sets the parent scope of the target, so we give it an empty ad that is
+	// chained to the real target ad instead.
+	ClassAd target;
+	target.ChainToAd(ad);
+
+	mad.ReplaceLeftAd(query);
+	mad.ReplaceRightAd(&target);
+	bool rval = query->EvaluateAttrString(attr, projection);
+	mad.RemoveLeftAd();
+	mad.RemoveRightAd();
+	return rval;
+}
+
+// Build the snapshot of ads that a query worker thread will scan, called on the main thread
+// when the query is dispatched.
+CollectorQuerySnapshot * CollectorDaemon::make_query_snapshot(pending_query_entry_t * query_entry)
+{
+	CollectorQuerySnapshot * snapshot = new CollectorQuerySnapshot();
+	ClassAd * query = query_entry->cad;
+	Stream * sock = query_entry->sock;
+
+	snapshot->peer = sock->peer_description();
+	snapshot->filter_private_attrs = query_filter_private_attrs(query, sock);
+
+	int num_adtypes = (query_entry->num_adtypes > 0) ? query_entry->num_adtypes : 1;
+	snapshot->ads.resize(num_adtypes);
+	for (int ix = 0; ix < num_adtypes; ++ix) {
+		const AdTypes whichAds = (AdTypes) query_entry->adt[ix].whichAds;
+		const char * mytype = (query_entry->adt[ix].match_mytype) ? query_entry->adt[ix].tag : nullptr;
+		bool filter_private_attrs = snapshot->filter_private_attrs && (whichAds != STARTD_PVT_AD);
+		std::vector<CollectorQuerySnapshot::Ad> & ads = snapshot->ads[ix];
+
+		auto add_record = [&](CollectorRecord * cr) {
+			ClassAd * stats_ad = nullptr;
+			if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(cr)) {
+				stats_ad = make_self_stats_ad(query, cr, filter_private_attrs);
+			}
+			ads.push_back(CollectorQuerySnapshot::Ad{cr->m_publicAd, cr->m_pvtAd, stats_ad});
+			return 1;
+		};
+
+		std::vector<CollectorHashTable *> tables;
+		if (whichAds == GENERIC_AD) {
+			tables.push_back(collector.getGenericHashTable(query_entry->adt[ix].tag));
+		} else if (whichAds != ANY_AD) {
+			tables.push_back(collector.getHashTable(whichAds));
+		} else if (ix == 0) {
+			tables = collector.getAnyHashTables(mytype);
+		}
+		for (auto table : tables) {
+			if ( ! table) {
+				dprintf (D_ALWAYS, "Error no collector table for %s\n", query_entry->adt[ix].tag);
+				continue;
+			}
+			ads.reserve(ads.size() + table->getNumElements());
+			collector.walkTableForConstraint(*table, query_entry->adt[ix].constraint, add_record);
+		}
+		if (whichAds == ANY_AD) {
+			break; // don't allow Any as part of a multi-table scan.
+		}
+	}
+
+	snapshot->generation = CollectorRecord::Reclaimer().pin();
+	return snapshot;
+}
+
+int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Stream* sock)
+{
+	int return_status = TRUE;
+	_condor_runtime runtime;
+	double tick_time = runtime.begin;
+	double query_time = 0;
+	double send_time = 0;
+
+	// Pull out relavent state from query_entry
+	pending_query_entry_t *query_entry = (pending_query_entry_t *) in_query_entry;
+	ClassAd *query = query_entry->cad;
+	bool is_locate = query_entry->is_locate;
+	int num_adtypes = (query_entry->num_adtypes > 0) ? query_entry->num_adtypes : 1;
+	std::deque<CollectorRecord*> results;
+
+	// When running on a worker thread, the ads to scan and the authorization decisions
+	// were captured on the main thread.  We must not touch the collector tables or DaemonCore.
+	CollectorQuerySnapshot * snapshot = query_entry->snapshot;
+	std::vector<const CollectorQuerySnapshot::Ad*> snapshot_results;
+	std::unique_ptr<classad::MatchClassAd> projection_mad;
+
+	bool filter_private_attrs = snapshot ? snapshot->filter_private_attrs : query_filter_private_attrs(query, sock);
+
 	// See if query ad asks for server-side projection
 	std::string projection;
 	std::string attr_projection(ATTR_PROJECTION);
@@ -1091,37 +1281,47 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 		op.__resultLimit__ = MIN(query_entry->limit, query_entry->adt[ix].limit) - op.__numAds__;
 		op.__results__ = &results;
 		results.clear();
+		snapshot_results.clear();
 
-		CollectorHashTable * table = nullptr;
-		if (whichAds == GENERIC_AD) {
-			table = collector.getGenericHashTable(query_entry->adt[ix].tag);
-		} else if (whichAds != ANY_AD) {
-			table = collector.getHashTable(whichAds);
-		}
-		if (table) {
-			collector.walkHashTable (*table,
-				[&op](CollectorRecord*cr){
-					return op.query_scanFunc(cr);
-				});
-		} else if (ix==0 && whichAds == ANY_AD) {
-			std::vector<CollectorHashTable *> tables = collector.getAnyHashTables(op.__mytype__);
-			for (auto table : tables) {
-				collector.walkHashTable (*table,
+		if (snapshot) {
+			for (const auto & ad : snapshot->ads[ix]) {
+				if (op.query_matchAd(ad.pub)) {
+					snapshot_results.push_back(&ad);
+					if (op.__numAds__ >= op.__resultLimit__) break;
+				}
+			}
+		} else {
+			CollectorHashTable * table = nullptr;
+			if (whichAds == GENERIC_AD) {
+				table = collector.getGenericHashTable(query_entry->adt[ix].tag);
+			} else if (whichAds != ANY_AD) {
+				table = collector.getHashTable(whichAds);
+			}
+			if (table) {
+				collector.walkTableForConstraint (*table, op.__filter__,
 					[&op](CollectorRecord*cr){
 						return op.query_scanFunc(cr);
 					});
-				if (op.__numAds__ >= op.__resultLimit__)
-					break;
+			} else if (ix==0 && whichAds == ANY_AD) {
+				std::vector<CollectorHashTable *> tables = collector.getAnyHashTables(op.__mytype__);
+				for (auto table : tables) {
+					collector.walkTableForConstraint (*table, op.__filter__,
+						[&op](CollectorRecord*cr){
+							return op.query_scanFunc(cr);
+						});
+					if (op.__numAds__ >= op.__resultLimit__)
+						break;
+				}
+				num_adtypes = 1; // don't allow Any as part of a multi-table scan.
+			} else {
+				dprintf (D_ALWAYS, "Error no collector table for %s\n", query_entry->adt[ix].tag);
+				continue;
 			}
-			num_adtypes = 1; // don't allow Any as part of a multi-table scan.
-		} else {
-			dprintf (D_ALWAYS, "Error no collector table for %s\n", query_entry->adt[ix].tag);
-			continue;
 		}
 
 		query_time += runtime.tick(tick_time);
 
-		if (results.empty())
+		if (results.empty() && snapshot_results.empty())
 			continue;
 
 		// do first time initialization for sending ads
@@ -1153,39 +1353,38 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 			}
 		}
 
-		for (CollectorRecord* curr_rec : results)
+		size_t num_results = snapshot ? snapshot_results.size() : results.size();
+		for (size_t ixr = 0; ixr < num_results; ++ixr)
 		{
-			ClassAd* ad_to_send = filter_private_attrs ? curr_rec->m_publicAd : curr_rec->m_pvtAd;
-			// if querying collector ads, and the collectors own ad appears in this list.
-			// then we want to shove in current statistics. we do this by chaining a
-			// temporary stats ad into the ad to be returned, and publishing updated
-			// statistics into the stats ad.  we do this because if the verbosity level
-			// is increased we do NOT want to put the high-verbosity attributes into
-			// our persistent collector ad.
+			ClassAd * public_ad = nullptr;
+			ClassAd * ad_to_send = nullptr;
 			ClassAd * stats_ad = NULL;
-			if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(curr_rec)) {
-				dprintf(D_ALWAYS,"Query includes collector's self ad\n");
-				// update stats in the collector ad before we return it.
-				std::string stats_config;
-				query->LookupString("STATISTICS_TO_PUBLISH",stats_config);
-				if (stats_config != "stored") {
-					dprintf(D_ALWAYS,"Updating collector stats using a chained ad and config=%s\n", stats_config.c_str());
-					stats_ad = new ClassAd();
-					if (!filter_private_attrs) {
-						stats_ad->CopyFrom(*curr_rec->m_pvtAd);
-					}
-					daemonCore->dc_stats.Publish(*stats_ad, stats_config.c_str());
-					daemonCore->monitor_data.ExportData(stats_ad, true);
-					collectorStats.publishGlobal(stats_ad, stats_config.c_str());
-					stats_ad->ChainToAd(curr_rec->m_publicAd);
-					ad_to_send = stats_ad; // send the stats ad instead of the self ad.
+			bool delete_stats_ad = false;
+			if (snapshot) {
+				const CollectorQuerySnapshot::Ad * ad = snapshot_results[ixr];
+				public_ad = ad->pub;
+				ad_to_send = filter_private_attrs ? ad->pub : ad->pvt;
+				stats_ad = ad->stats;
+				if (stats_ad) { dprintf(D_ALWAYS,"Query includes collector's self ad\n"); }
+			} else {
+				CollectorRecord * curr_rec = results[ixr];
+				public_ad = curr_rec->m_publicAd;
+				ad_to_send = filter_private_attrs ? curr_rec->m_publicAd : curr_rec->m_pvtAd;
+				if ((whichAds == COLLECTOR_AD) && collector.isSelfAd(curr_rec)) {
+					dprintf(D_ALWAYS,"Query includes collector's self ad\n");
+					stats_ad = make_self_stats_ad(query, curr_rec, filter_private_attrs);
+					delete_stats_ad = true;
 				}
 			}
+			if (stats_ad) {
+				ad_to_send = stats_ad; // send the stats ad instead of the self ad.
+			}
 
 			if (evaluate_projection) {
 				active_proj->clear();
 				projection.clear();
-				if (EvalString(attr_projection.c_str(), query, curr_rec->m_publicAd, projection) && ! projection.empty()) {
+				if ( ! projection_mad) { projection_mad.reset(new classad::MatchClassAd()); }
+				if (eval_projection_expr(attr_projection, query, public_ad, *projection_mad, projection) && ! projection.empty()) {
 					StringTokenIterator list(projection);
 					const std::string * attr;
 					while ((attr = list.next_string())) { active_proj->insert(*attr); }
@@ -1195,7 +1394,7 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 
 			bool send_failed = (!sock->code(more) || !putClassAd(sock, *ad_to_send, 0, whitelist));
 
-			if (stats_ad) {
+			if (stats_ad && delete_stats_ad) {
 				stats_ad->Unchain();
 				delete stats_ad;
 			}
@@ -1219,6 +1418,7 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 
 		send_time += runtime.tick(tick_time);
 		results.clear();
+		snapshot_results.clear();
 	}
 
 	if ( ! sending) {
@@ -1241,6 +1441,8 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 
 	send_time += runtime.tick(tick_time);
 
+	{
+	std::string filter_buf;
 	dprintf (D_ALWAYS,
 			 "Query info: matched=%d; skipped=%d; query_time=%f; send_time=%f; type=%s; requirements={%s}; locate=%d; limit=%d; from=%s; peer=%s; projection={%s}; filter_private_attrs=%d\n",
 			 op.__numAds__,
@@ -1248,13 +1450,14 @@ int CollectorDaemon::receive_query_cedar_worker_thread(void *in_query_entry, Str
 			 query_time,
 			 send_time,
 			 query_entry->label ? query_entry->label : "?",
-			 op.__filter__ ? ExprTreeToString(op.__filter__) : "",
+			 op.__filter__ ? ExprTreeToString(op.__filter__, filter_buf) : "",
 			 is_locate,
 			 (op.__resultLimit__ == INT_MAX) ? 0 : op.__resultLimit__,
 			 query_entry->subsys,
-			 sock->peer_description(),
+			 snapshot ? snapshot->peer.c_str() : sock->peer_description(),
 			 projection.c_str(),
 			 filter_private_attrs);
+	}
 END:
 	
 	// All done.  Deallocate memory allocated in this method.  Note that DaemonCore 
@@ -1554,8 +1757,14 @@ int CollectorDaemon::receive_update(int command, Stream* sock)
 	CollectorEngine_ru_collect_runtime += rt.tick(rt_last);
 #endif
 
+	// the delta was merged into the whole ad, so treat it as a normal update from here on
+	if (command == UPDATE_STARTD_AD_DELTA) {
+		command = UPDATE_STARTD_AD;
+	}
+
 	/* let the off-line plug-in have at it */
 	offline_plugin_.update ( command, *record->m_publicAd );
+	record->Reindex();
 
 #if defined(UNIX) && !defined(DARWIN)
 	// JEF TODO Should we use the private ad here?
@@ -1696,6 +1905,7 @@ int CollectorDaemon::receive_update_expect_ack(int command,
 
 	if(record) {
 		offline_plugin_.update ( command, *record->m_publicAd );
+		record->Reindex();
 
 #if defined(UNIX) && !defined(DARWIN)
 		// JEF TODO Should we use the private ad here?
@@ -1750,13 +1960,28 @@ CollectorDaemon::stashSocket( ReliSock* sock )
 
 int CollectorDaemon::collect_op::query_scanFunc (CollectorRecord *record)
 {
-	ClassAd* cad = record->m_publicAd;
+	int rc = 1;
+	if (query_matchAd(record->m_publicAd)) {
+		__results__->push_back(record);
+		if (__numAds__ >= __resultLimit__) {
+			rc = 0; // tell it to stop iterating, we have all the results we want
+		}
+	}
+	return rc;
+}
 
-	if (__mytype__ && MATCH != strcasecmp(__mytype__, GetMyTypeName(*cad))) {
-		return 1;
+// returns true and counts the match if the ad matches the query.
+// this does not modify the ad, so it can be called from a query worker thread.
+bool CollectorDaemon::collect_op::query_matchAd (ClassAd *cad)
+{
+	if (__mytype__) {
+		std::string mytype;
+		cad->LookupString(ATTR_MY_TYPE, mytype);
+		if (MATCH != strcasecmp(__mytype__, mytype.c_str())) {
+			return false;
+		}
 	}
 
-	int rc = 1;
 	classad::Value result;
 	bool val;
 	if ( ! __filter__ ||
@@ -1768,16 +1993,13 @@ int CollectorDaemon::collect_op::query_scanFunc (CollectorRecord *record)
 		} else {
 			// Found a match
 			__numAds__++;
-			__results__->push_back(record);
-			if (__numAds__ >= __resultLimit__) {
-				rc = 0; // tell it to stop iterating, we have all the results we want
-			}
+			return true;
 		}
 	} else {
 		__failed__++;
 	}
 
-    return rc;
+	return false;
 }
 
 #if 0
@@ -1854,16 +2076,17 @@ void CollectorDaemon::process_query_public (AdTypes whichAds,
 //
 int CollectorDaemon::collect_op::expiration_scanFunc (CollectorRecord *record)
 {
-    return setAttrLastHeardFrom( record->m_publicAd, 1 );
+    return setAttrLastHeardFrom( record, 1 );
 }
 
 int CollectorDaemon::collect_op::invalidation_scanFunc (CollectorRecord *record)
 {
-    return setAttrLastHeardFrom( record->m_publicAd, 0 );
+    return setAttrLastHeardFrom( record, 0 );
 }
 
-int CollectorDaemon::collect_op::setAttrLastHeardFrom (ClassAd* cad, unsigned long time)
+int CollectorDaemon::collect_op::setAttrLastHeardFrom (CollectorRecord* record, unsigned long time)
 {
+	ClassAd* cad = record->m_publicAd;
 	if (__mytype__) {
 		std::string type = "";
 		cad->LookupString( ATTR_MY_TYPE, type );
@@ -1877,7 +2100,8 @@ int CollectorDaemon::collect_op::setAttrLastHeardFrom (ClassAd* cad, unsigned lo
 	if ( EvalExprToBool( __filter__, cad, NULL, result ) &&
 		 result.IsBooleanValueEquiv(val) && val ) {
 
-		cad->Assign( ATTR_LAST_HEARD_FROM, time );
+		record->Unshare();
+		record->m_publicAd->Assign( ATTR_LAST_HEARD_FROM, time );
         __numAds__++;
     }
 
@@ -2151,6 +2375,11 @@ void CollectorDaemon::Config()
 	// This it temporary (for 8.7.0) just in case we need to turn off the new getClassAdEx options
 	collector.m_get_ad_options = param_integer("COLLECTOR_GETAD_OPTIONS", GET_CLASSAD_FAST | GET_CLASSAD_LAZY_PARSE);
 	collector.m_get_ad_options &= (GET_CLASSAD_LAZY_PARSE | GET_CLASSAD_FAST | GET_CLASSAD_NO_CACHE);
+	if (query_workers_use_threads) {
+		// a lazy parsed ad is modified the first time that it is evaluated,
+		// which is not safe when query worker threads are reading the ads.
+		collector.m_get_ad_options &= ~GET_CLASSAD_LAZY_PARSE;
+	}
 	std::string opts;
 	if (collector.m_get_ad_options & GET_CLASSAD_FAST) { opts += "fast "; }
 	if (collector.m_get_ad_options & GET_CLASSAD_NO_CACHE) { opts += "no-cache "; }
@@ -2173,6 +2402,10 @@ void CollectorDaemon::Config()
 
 	init_classad(i);
 
+	std::string indexed_attrs;
+	param(indexed_attrs, "COLLECTOR_INDEXED_ATTRIBUTES");
+	collector.setIndexedAttributes(split(indexed_attrs));
+
     // set the appropriate parameters in the collector engine
     collector.setClientTimeout( ClientTimeout );
     collector.scheduleHousekeeper( ClassadLifetime );
@@ -2279,6 +2512,14 @@ void CollectorDaemon::Config()
 				reserved_for_highprio_query_workers);
 	}
 
+	// the thread pool grows when COLLECTOR_QUERY_WORKERS is increased, but never shrinks,
+	// we just don't hand queries to more than max_query_workers threads at a time.
+	if (query_workers_use_threads && max_query_workers > 0) {
+		if ( ! query_thread_pool.start(max_query_workers, receive_query_cedar_worker_thread, QueryThreadDone)) {
+			dprintf(D_ALWAYS, "Warning: could not start query worker threads, query workers will be forked\n");
+		}
+	}
+
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	want_track_queries_by_subsys = param_boolean("COLLECTOR_TRACK_QUERY_BY_SUBSYS",true);
 #endif
@@ -2323,6 +2564,7 @@ void CollectorDaemon::Exit()
 	// because the collector will be shutdown and the daemonCore
 	// object deleted by the time the worker cleanup is attempted.
 	// forkQuery.DeleteAll( );
+	query_thread_pool.stop();
 	if ( UpdateTimerId >= 0 ) {
 		daemonCore->Cancel_Timer(UpdateTimerId);
 		UpdateTimerId = -1;
@@ -2345,6 +2587,7 @@ void CollectorDaemon::Shutdown()
 	// because the collector will be shutdown and the daemonCore
 	// object deleted by the time the worker cleanup is attempted.
 	// forkQuery.DeleteAll( );
+	query_thread_pool.stop();
 	if ( UpdateTimerId >= 0 ) {
 		daemonCore->Cancel_Timer(UpdateTimerId);
 		UpdateTimerId = -1;
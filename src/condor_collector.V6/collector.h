@@ -20,6 +20,7 @@
 #ifndef _COLLECTOR_DAEMON_H_
 #define _COLLECTOR_DAEMON_H_
 
+#include <map>
 #include <vector>
 #include <queue>
 
@@ -27,6 +28,7 @@
 #include "forkwork.h"
 
 #include "collector_engine.h"
+#include "collector_query_pool.h"
 #include "collector_stats.h"
 #include "dc_collector.h"
 #include "offline_plugin.h"
@@ -92,10 +94,11 @@ public:
 
 		//void process_query_public(AdTypes, ClassAd *query, std::deque<CollectorRecord*> * results);
 		int query_scanFunc(CollectorRecord*);
+		bool query_matchAd(ClassAd*);
 		void process_invalidation(AdTypes, ClassAd&, Stream*);
 		int invalidation_scanFunc(CollectorRecord*);
 		int expiration_scanFunc(CollectorRecord*);
-		int setAttrLastHeardFrom( ClassAd* cad, unsigned long time );
+		int setAttrLastHeardFrom( CollectorRecord* record, unsigned long time );
 	};
 #else
 	static void process_query_public(AdTypes, ClassAd*, List<CollectorRecord>*);
@@ -155,6 +158,7 @@ public:
 		bool is_locate;
 		bool is_multi;
 		char subsys[15];
+		CollectorQuerySnapshot * snapshot; // ads to scan when the query runs on a worker thread
 		int  limit;           // overall result limit
 		int num_adtypes;
 		struct adtype_query_props {
@@ -175,17 +179,25 @@ public:
 	} pending_query_entry_t;
 	static pending_query_entry_t * make_query_entry(AdTypes whichAds, ClassAd * query, bool allow_pvt=false);
 	static ExprTree * get_query_filter(ClassAd* query, const std::string & attr, bool & skip_absent);
+	static bool query_filter_private_attrs(ClassAd * query, Stream * sock);
+	static ClassAd * make_self_stats_ad(ClassAd * query, CollectorRecord * self_rec, bool filter_private_attrs);
+	static CollectorQuerySnapshot * make_query_snapshot(pending_query_entry_t * query_entry);
 
 	static std::queue<pending_query_entry_t *> query_queue_high_prio;
 	static std::queue<pending_query_entry_t *> query_queue_low_prio;
 	static int ReaperId;
 	static int QueryReaper(int pid, int exit_status);
+	static int StartQueryThread(pending_query_entry_t * query_entry, bool high_prio_query);
+	static void QueryThreadDone(void * query_entry, Stream * sock, int status, int worker, double latency);
 	static int max_query_workers;  // from config file
 	static int max_pending_query_workers;  // from config file
 	static int max_query_worktime;  // from config file
 	static int reserved_for_highprio_query_workers; // from config file
 	static int active_query_workers;
 	static int pending_query_workers;
+	static bool query_workers_use_threads; // from config file at startup
+	static CollectorQueryPool query_thread_pool;
+	static std::map<int, double> forked_query_start; // start time of forked query workers, by tid
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	static bool want_track_queries_by_subsys;
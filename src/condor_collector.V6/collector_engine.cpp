@@ -276,7 +276,15 @@ CollectorEngine::invalidateAds(CollectorHashTable *table, const char *targetType
 	std::string hkString;
 	(*table).startIterations();
 	while ((*table).iterate (record)) {
-		if (IsATargetMatch(&query, record->m_publicAd, targetType)) {
+		// matching sets the parent scope of the target ad, so when query worker threads
+		// might be reading the ads, match against an empty ad chained to the record instead.
+		ClassAd chained_ad;
+		ClassAd * target = record->m_publicAd;
+		if (CollectorRecord::Reclaimer().pinned()) {
+			chained_ad.ChainToAd(target);
+			target = &chained_ad;
+		}
+		if (IsATargetMatch(&query, target, targetType)) {
 			(*table).getCurrentKey(hk);
 			hk.sprint(hkString);
 			if ((*table).remove(hk) == -1) {
@@ -296,6 +304,8 @@ CollectorEngine::invalidateAds(CollectorHashTable *table, const char *targetType
 	return count;
 }
 
+CollectorAdReclaimer CollectorRecord::s_reclaimer;
+
 int (*CollectorEngine::genericTableScanFunction)(CollectorRecord *) = NULL;
 
 int CollectorEngine::
@@ -476,6 +486,18 @@ collect (int command, Sock *sock, const condor_sockaddr& from, int &insert)
 	CollectorEngine_ruc_getAd_runtime.Add(delta_time);
 #endif
 
+	if (command == UPDATE_STARTD_AD_DELTA) {
+		// from here on a delta update is handled as a normal update of the whole ad
+		ClassAd * wholeAd = applyDeltaUpdate(clientAd, insert);
+		delete clientAd;
+		clientAd = wholeAd;
+		command = UPDATE_STARTD_AD;
+		if ( ! clientAd) {
+			sock->end_of_message();
+			return 0;
+		}
+	}
+
 	// insert the authenticated user into the ad itself
 	const char* authn_user = sock->getFullyQualifiedUser();
 	if (authn_user) {
@@ -1071,6 +1093,75 @@ collect (int command,ClassAd *clientAd,const condor_sockaddr& from,int &insert,S
 	return retVal;
 }
 
+// Rebuild the whole slot ad for an UPDATE_STARTD_AD_DELTA from the ad that we have and the delta.
+// The delta applies only if the ad that we have is from the update that the delta was made against.
+// Returns NULL if the delta cannot be applied, the caller should then close the update socket
+// so that the startd will reconnect and send the whole ad.
+//
+// The UpdateSequenceNumber and DaemonStartTime together identify the update.  An ad
+// without a DaemonStartTime on either side can't be tied to a run of the startd, so
+// a delta never applies to it and the startd must send the whole ad.  Neither does a
+// delta apply to an ad that a MERGE_STARTD_AD has changed since its last whole update,
+// the merged attributes last only until the next update from the startd, as they
+// would if it had sent the whole ad.
+ClassAd * CollectorEngine::
+applyDeltaUpdate (ClassAd *delta, int &insert)
+{
+	AdNameHashKey hk;
+	if ( ! makeStartdAdHashKey(hk, delta)) {
+		dprintf (D_ALWAYS, "Could not make hashkey for delta update --- ignoring ad\n");
+		insert = -3;
+		return NULL;
+	}
+
+	long long base_seq = -1, stored_seq = -1;
+	long long start_time = -1, stored_start_time = -1;
+	bool has_base_seq = delta->LookupInteger(ATTR_UPDATE_DELTA_BASE_SEQUENCE_NUMBER, base_seq);
+	bool has_start_time = delta->LookupInteger(ATTR_DAEMON_START_TIME, start_time);
+
+	const char * why = nullptr;
+	CollectorRecord *record = nullptr;
+	if (StartdSlotAds.lookup(hk, record) == -1) {
+		record = nullptr;
+		why = "there is no stored ad";
+	} else if ( ! has_base_seq ||
+			! record->m_publicAd->LookupInteger(ATTR_UPDATE_SEQUENCE_NUMBER, stored_seq) ||
+			base_seq != stored_seq) {
+		why = "the stored ad is not its base";
+	} else if ( ! has_start_time ||
+			! record->m_publicAd->LookupInteger(ATTR_DAEMON_START_TIME, stored_start_time)) {
+		why = "there is no DaemonStartTime";
+	} else if (start_time != stored_start_time) {
+		why = "the startd has restarted";
+	} else if (record->m_merged) {
+		why = "the stored ad has merged attributes";
+	}
+	if (why) {
+		std::string hashString;
+		hk.sprint(hashString);
+		dprintf (D_ALWAYS, "Delta update for \"%s\" does not apply because %s (base %lld, have %lld) --- ignoring ad\n",
+				 hashString.c_str(), why, base_seq, stored_seq);
+		collectorStats->global.DeltaUpdatesRejected += 1;
+		insert = -5;
+		return NULL;
+	}
+
+	// the stored ad is not modified, query worker threads may be reading it
+	ClassAd *wholeAd = new ClassAd(*record->m_publicAd);
+	std::string removed;
+	if (delta->LookupString(ATTR_UPDATE_DELTA_REMOVED_ATTRS, removed)) {
+		for (const auto & attr : StringTokenIterator(removed)) {
+			wholeAd->Delete(attr);
+		}
+	}
+	delta->Delete(ATTR_UPDATE_DELTA_REMOVED_ATTRS);
+	delta->Delete(ATTR_UPDATE_DELTA_BASE_SEQUENCE_NUMBER);
+	wholeAd->Update(*delta);
+
+	collectorStats->global.DeltaUpdates += 1;
+	return wholeAd;
+}
+
 CollectorRecord *CollectorEngine::
 lookup (AdTypes adType, AdNameHashKey &hk)
 {
@@ -1153,9 +1244,11 @@ int CollectorEngine::expire(CollectorHashTable * hTable, AdNameHashKey & hKey) {
 	int rVal = 0;
 	CollectorRecord* record = nullptr;
 	if( hTable->lookup( hKey, record ) != -1 ) {
+		record->Unshare();
 		record->m_publicAd->Assign( ATTR_LAST_HEARD_FROM, 1 );
 
 		if( CollectorDaemon::offline_plugin_.expire( * record->m_publicAd ) == true ) {
+			record->Reindex();
 			return rVal;
 		}
 
@@ -1206,6 +1299,29 @@ remove (AdTypes adType, AdNameHashKey &hk)
 	return !table->remove(hk);
 }
 
+void CollectorEngine::
+setIndexedAttributes(const std::vector<std::string> & attrs)
+{
+	if (attrs == m_slotIndex.getAttributes()) {
+		return;
+	}
+
+	m_slotIndex.setAttributes(attrs);
+	CollectorAdIndex * index = m_slotIndex.enabled() ? &m_slotIndex : nullptr;
+
+	CollectorRecord *record = nullptr;
+	StartdSlotAds.startIterations();
+	while (StartdSlotAds.iterate(record)) {
+		record->m_index = index;
+		if (index) { index->insert(record); }
+	}
+
+	if (index) {
+		dprintf(D_ALWAYS, "Indexing %d slot ads by %s\n",
+			StartdSlotAds.getNumElements(), join(attrs, ",").c_str());
+	}
+}
+
 void CollectorEngine::
 identifySelfAd(CollectorRecord * ad)
 {
@@ -1279,7 +1395,8 @@ updateClassAd (CollectorHashTable &hashTable,
 		}
 
 		// Now, store it away
-		record = new CollectorRecord(new_ad, new_pvt_ad);
+		CollectorAdIndex * index = (&hashTable == &StartdSlotAds && m_slotIndex.enabled()) ? &m_slotIndex : nullptr;
+		record = new CollectorRecord(new_ad, new_pvt_ad, index);
 		if (hashTable.insert (hk, record) == -1)
 		{
 			EXCEPT ("Error inserting ad (out of memory)");
@@ -1332,6 +1449,7 @@ updateClassAd (CollectorHashTable &hashTable,
 
 		// Now, finally, store the new ClassAd
 		record->ReplaceAds(new_ad, new_pvt_ad);
+		record->m_merged = false;
 
 		insert = 0;
 		return record;
@@ -1377,8 +1495,11 @@ mergeClassAd (CollectorHashTable &hashTable,
 		movePrivateAttrs(new_pvt_ad, new_ad_copy);
 
 		// Now, finally, merge the new ClassAd into the old one
+		record->Unshare();
 		MergeClassAds(record->m_publicAd, &new_ad_copy, true);
 		MergeClassAds(record->m_pvtAd, &new_pvt_ad, true);
+		record->Reindex();
+		record->m_merged = true;
 	}
 	delete new_ad;
 	return record;
@@ -1497,8 +1618,10 @@ cleanHashTable (CollectorHashTable &hashTable, time_t now, HashFunc makeKey) con
 				   potentially mark the ad absent. if expire() returns false, then delete
 				   the ad as planned; if it return true, it was likely marked as absent,
 				   so then this ad should NOT be deleted. */
+				record->Unshare();
 				if ( CollectorDaemon::offline_plugin_.expire( *record->m_publicAd ) == true ) {
 					// plugin say to not delete this ad, so continue
+					record->Reindex();
 					continue;
 				} else {
 					dprintf (D_ALWAYS,"\t\t**** Removing stale ad: \"%s\"\n", hkString.c_str() );
@@ -23,18 +23,87 @@
 #include "condor_classad.h"
 
 #include "collector_stats.h"
+#include "collector_index.h"
 #include "hashkey.h"
 
+#include <deque>
+#include <set>
+
+// Deferred deletion of ads that query worker threads may still be reading.
+//
+// A query that runs on a worker thread pins the current generation while it holds
+// pointers to ads from the collector tables.  Ads that are retired while any generation
+// is pinned are kept until every query that could have seen them has unpinned.
+// When nothing is pinned, retire() deletes immediately, so there is no cost when
+// queries are handled in-proc or by forked workers.
+// All methods must be called on the main thread.
+class CollectorAdReclaimer
+{
+public:
+	uint64_t pin() { m_readers.insert(++m_generation); return m_generation; }
+	void unpin(uint64_t gen) {
+		auto it = m_readers.find(gen);
+		if (it != m_readers.end()) m_readers.erase(it);
+	}
+	bool pinned() const { return ! m_readers.empty(); }
+
+	void retire(ClassAd * public_ad, ClassAd * pvt_ad) {
+		if (m_readers.empty()) { delete public_ad; delete pvt_ad; return; }
+		m_retired.push_back(Retired{m_generation, public_ad, pvt_ad});
+	}
+
+	// delete the retired ads that no pinned generation can see, returns the number of ads still deferred
+	size_t reclaim() {
+		uint64_t oldest = m_readers.empty() ? UINT64_MAX : *m_readers.begin();
+		while ( ! m_retired.empty() && m_retired.front().generation < oldest) {
+			delete m_retired.front().public_ad;
+			delete m_retired.front().pvt_ad;
+			m_retired.pop_front();
+		}
+		return m_retired.size();
+	}
+
+private:
+	struct Retired {
+		uint64_t generation; // the newest generation that might see these ads
+		ClassAd * public_ad;
+		ClassAd * pvt_ad;
+	};
+	uint64_t m_generation {0};
+	std::multiset<uint64_t> m_readers;
+	std::deque<Retired> m_retired;
+};
+
 struct CollectorRecord
 {
-	CollectorRecord(ClassAd* public_ad, ClassAd* pvt_ad)
-		: m_publicAd(public_ad), m_pvtAd(pvt_ad) { m_pvtAd->ChainToAd(m_publicAd); }
-	~CollectorRecord() { delete m_publicAd; delete m_pvtAd; }
-	void ReplaceAds(ClassAd* public_ad, ClassAd* pvt_ad)
-	{ delete m_publicAd; delete m_pvtAd; m_publicAd=public_ad; m_pvtAd=pvt_ad; m_pvtAd->ChainToAd(m_publicAd); }
+	CollectorRecord(ClassAd* public_ad, ClassAd* pvt_ad, CollectorAdIndex * index = nullptr)
+		: m_publicAd(public_ad), m_pvtAd(pvt_ad), m_index(index) {
+		m_pvtAd->ChainToAd(m_publicAd);
+		if (m_index) m_index->insert(this);
+	}
+	~CollectorRecord() { if (m_index) m_index->remove(this); s_reclaimer.retire(m_publicAd, m_pvtAd); }
+	void ReplaceAds(ClassAd* public_ad, ClassAd* pvt_ad) {
+		s_reclaimer.retire(m_publicAd, m_pvtAd); m_publicAd=public_ad; m_pvtAd=pvt_ad; m_pvtAd->ChainToAd(m_publicAd);
+		if (m_index) m_index->update(this);
+	}
+	// call this after modifying the public ad in place
+	void Reindex() { if (m_index) m_index->update(this); }
+	// call this before modifying the ads in place.  If query worker threads might be
+	// reading the ads, they are replaced by copies so that the readers see no change.
+	void Unshare() {
+		if ( ! s_reclaimer.pinned()) return;
+		ReplaceAds(new ClassAd(*m_publicAd), new ClassAd(*m_pvtAd));
+	}
+
+	static CollectorAdReclaimer & Reclaimer() { return s_reclaimer; }
 
 	ClassAd* m_publicAd;
 	ClassAd* m_pvtAd;
+	CollectorAdIndex* m_index; // index this record is in, not owned
+	bool m_merged{false}; // a MERGE_STARTD_AD changed the ads since the last whole update
+
+private:
+	static CollectorAdReclaimer s_reclaimer;
 };
 
 // type for the hash tables ...
@@ -62,6 +131,9 @@ class CollectorEngine : public Service
 	// lookup classad in the specified table with the given hashkey
 	CollectorRecord *lookup (AdTypes, AdNameHashKey &);
 
+	// rebuild the whole startd slot ad for an UPDATE_STARTD_AD_DELTA, returns NULL if it does not apply
+	ClassAd *applyDeltaUpdate (ClassAd *delta, int &insert);
+
 	/**
 	* remove () - attempts to construct a hashkey from a query
     * to remove in O(1) for INVALIDATE* vs. O(n). The query must contain
@@ -103,6 +175,15 @@ class CollectorEngine : public Service
 
 	std::vector<CollectorHashTable *> getAnyHashTables(const char * mytype = nullptr);
 
+	// returns the secondary index for the given table, or nullptr if the table is not indexed
+	const CollectorAdIndex * getTableIndex(const CollectorHashTable * table) const {
+		if (table == &StartdSlotAds && m_slotIndex.enabled()) { return &m_slotIndex; }
+		return nullptr;
+	}
+
+	// set the list of attributes of slot ads to index, rebuilds the index
+	void setIndexedAttributes(const std::vector<std::string> & attrs);
+
 	// templated version of the above that uses a callable for the walk function
 	template <typename Func>
 	int walkHashTable(CollectorHashTable & table, Func fn) {
@@ -116,6 +197,29 @@ class CollectorEngine : public Service
 		return 1;
 	}
 
+	// Same as walkHashTable, but when the table has a secondary index that can be used
+	// for the constraint, call fn only for the candidate records from the index.
+	// The constraint is not evaluated here, fn must still do that.
+	// When the index is used, the records are visited in the order of the index
+	// buckets, which is not the order of the hash table.
+	// returns true if the index was used.
+	template <typename Func>
+	bool walkTableForConstraint(CollectorHashTable & table, ExprTree * constraint, Func fn) {
+		const CollectorAdIndex * index = getTableIndex(&table);
+		std::vector<CollectorRecord*> candidates;
+		std::string index_attr;
+		if (index && index->getCandidates(constraint, candidates, &index_attr)) {
+			dprintf(D_FULLDEBUG, "Using %s index, %d of %d ads are candidates\n",
+				index_attr.c_str(), (int)candidates.size(), table.getNumElements());
+			for (CollectorRecord * record : candidates) {
+				if (!fn(record)) break;
+			}
+			return true;
+		}
+		walkHashTable(table, fn);
+		return false;
+	}
+
 
 	// Walk through a specific (non-generic, non-ANY) table using a lambda
 	// this is used only by schedd_token_request.  
@@ -181,6 +285,9 @@ class CollectorEngine : public Service
 	CollectorHashTable NegotiatorAds;
 	CollectorHashTable HadAds;
 	CollectorHashTable GridAds;
+
+	// secondary index over StartdSlotAds, see COLLECTOR_INDEXED_ATTRIBUTES
+	CollectorAdIndex m_slotIndex;
 	
 	// table for "generic" ad types
 	GenericAdHashTable GenericAds;
@@ -0,0 +1,317 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+#include "compat_classad_util.h"
+
+#include <cmath>
+
+#include "collector_index.h"
+#include "collector_engine.h"
+
+void CollectorAdIndex::setAttributes(const std::vector<std::string> & attrs)
+{
+	clear();
+	m_attrNames.clear();
+	for (const auto & attr : attrs) {
+		if (attrIndexOf(attr) < 0) {
+			m_attrNames.push_back(attr);
+		}
+	}
+	m_attrs.clear();
+	m_attrs.resize(m_attrNames.size());
+}
+
+void CollectorAdIndex::clear()
+{
+	for (auto & ai : m_attrs) {
+		ai.strings.clear();
+		ai.numbers.clear();
+		ai.unindexed.clear();
+	}
+	m_entries.clear();
+}
+
+int CollectorAdIndex::attrIndexOf(const std::string & attr) const
+{
+	for (size_t ix = 0; ix < m_attrNames.size(); ++ix) {
+		if (MATCH == strcasecmp(m_attrNames[ix].c_str(), attr.c_str())) {
+			return (int)ix;
+		}
+	}
+	return -1;
+}
+
+void CollectorAdIndex::makeEntries(CollectorRecord * record, std::vector<std::pair<size_t, IndexEntry>> & entries) const
+{
+	classad::Value val;
+	std::string str;
+	double num = 0;
+	for (size_t ix = 0; ix < m_attrNames.size(); ++ix) {
+		classad::ExprTree * tree = record->m_publicAd->Lookup(m_attrNames[ix]);
+		if ( ! tree) {
+			// attribute is not present, so no literal comparison can be true
+			continue;
+		}
+
+		IndexEntry ent;
+		ent.kind = IndexEntry::UNINDEXED;
+		ent.num = 0;
+		if (ExprTreeIsLiteral(tree, val)) {
+			if (val.IsUndefinedValue()) {
+				continue;
+			} else if (val.IsStringValue(str)) {
+				ent.kind = IndexEntry::STRING;
+				ent.str = str;
+			} else if (val.IsNumber(num) && ! std::isnan(num)) {
+				// note that booleans are numbers here, so true will be in the 1.0 bucket
+				ent.kind = IndexEntry::NUMBER;
+				ent.num = num;
+			}
+		}
+		entries.emplace_back(ix, ent);
+	}
+}
+
+void CollectorAdIndex::insert(CollectorRecord * record)
+{
+	if (m_attrs.empty() || ! record || ! record->m_publicAd) {
+		return;
+	}
+
+	std::vector<std::pair<size_t, IndexEntry>> entries;
+	makeEntries(record, entries);
+
+	auto it = m_entries.find(record);
+	if (it != m_entries.end()) {
+		// when re-indexing, there is nothing to do if none of the indexed values changed
+		if (it->second == entries) {
+			return;
+		}
+		remove(record);
+	}
+	if (entries.empty()) {
+		return;
+	}
+
+	for (auto & [ix, ent] : entries) {
+		switch (ent.kind) {
+		case IndexEntry::STRING:    m_attrs[ix].strings[ent.str].insert(record); break;
+		case IndexEntry::NUMBER:    m_attrs[ix].numbers[ent.num].insert(record); break;
+		case IndexEntry::UNINDEXED: m_attrs[ix].unindexed.insert(record); break;
+		}
+	}
+	m_entries[record] = std::move(entries);
+}
+
+void CollectorAdIndex::remove(CollectorRecord * record)
+{
+	auto it = m_entries.find(record);
+	if (it == m_entries.end()) {
+		return;
+	}
+
+	for (auto & [ix, ent] : it->second) {
+		if (ix >= m_attrs.size()) continue;
+		AttrIndex & ai = m_attrs[ix];
+		switch (ent.kind) {
+		case IndexEntry::STRING: {
+			auto bucket = ai.strings.find(ent.str);
+			if (bucket != ai.strings.end()) {
+				bucket->second.erase(record);
+				if (bucket->second.empty()) { ai.strings.erase(bucket); }
+			}
+		} break;
+		case IndexEntry::NUMBER: {
+			auto bucket = ai.numbers.find(ent.num);
+			if (bucket != ai.numbers.end()) {
+				bucket->second.erase(record);
+				if (bucket->second.empty()) { ai.numbers.erase(bucket); }
+			}
+		} break;
+		case IndexEntry::UNINDEXED:
+			ai.unindexed.erase(record);
+			break;
+		}
+	}
+	m_entries.erase(it);
+}
+
+// collect the indexable conjuncts of the top level && clauses of the tree
+void CollectorAdIndex::findConjuncts(classad::ExprTree * tree, std::vector<Conjunct> & conj) const
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree || tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return;
+	}
+
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+	if (op == classad::Operation::LOGICAL_AND_OP) {
+		findConjuncts(t1, conj);
+		findConjuncts(t2, conj);
+		return;
+	}
+
+	switch (op) {
+	case classad::Operation::EQUAL_OP:
+	case classad::Operation::META_EQUAL_OP:
+	case classad::Operation::LESS_THAN_OP:
+	case classad::Operation::LESS_OR_EQUAL_OP:
+	case classad::Operation::GREATER_THAN_OP:
+	case classad::Operation::GREATER_OR_EQUAL_OP:
+		break;
+	default:
+		return;
+	}
+
+	t1 = SkipExprParens(t1);
+	t2 = SkipExprParens(t2);
+
+	Conjunct cj;
+	std::string attr;
+	if (ExprTreeIsAttrRef(t1, attr) && ExprTreeIsLiteral(t2, cj.value)) {
+		cj.op = op;
+	} else if (ExprTreeIsLiteral(t1, cj.value) && ExprTreeIsAttrRef(t2, attr)) {
+		// literal is on the left, so flip the sense of the ordered comparisons
+		switch (op) {
+		case classad::Operation::LESS_THAN_OP: cj.op = classad::Operation::GREATER_THAN_OP; break;
+		case classad::Operation::LESS_OR_EQUAL_OP: cj.op = classad::Operation::GREATER_OR_EQUAL_OP; break;
+		case classad::Operation::GREATER_THAN_OP: cj.op = classad::Operation::LESS_THAN_OP; break;
+		case classad::Operation::GREATER_OR_EQUAL_OP: cj.op = classad::Operation::LESS_OR_EQUAL_OP; break;
+		default: cj.op = op; break;
+		}
+	} else {
+		return;
+	}
+
+	int ix = attrIndexOf(attr);
+	if (ix < 0) {
+		return;
+	}
+	cj.ix = ix;
+
+	double num;
+	if (cj.value.IsStringValue()) {
+		// we only use ordered lookups for numbers
+		if (cj.op != classad::Operation::EQUAL_OP && cj.op != classad::Operation::META_EQUAL_OP) {
+			return;
+		}
+	} else if ( ! cj.value.IsNumber(num) || std::isnan(num)) {
+		return;
+	}
+	conj.push_back(cj);
+}
+
+// return the range of numeric buckets that can satisfy a numeric conjunct
+void CollectorAdIndex::numberRange(const Conjunct & cj, NumberMap::const_iterator & lo, NumberMap::const_iterator & hi) const
+{
+	const NumberMap & numbers = m_attrs[cj.ix].numbers;
+	double num = 0;
+	cj.value.IsNumber(num);
+	lo = numbers.begin();
+	hi = numbers.end();
+	switch (cj.op) {
+	case classad::Operation::LESS_THAN_OP:        hi = numbers.lower_bound(num); break;
+	case classad::Operation::LESS_OR_EQUAL_OP:    hi = numbers.upper_bound(num); break;
+	case classad::Operation::GREATER_THAN_OP:     lo = numbers.upper_bound(num); break;
+	case classad::Operation::GREATER_OR_EQUAL_OP: lo = numbers.lower_bound(num); break;
+	default:
+		lo = numbers.lower_bound(num);
+		hi = numbers.upper_bound(num);
+		break;
+	}
+}
+
+size_t CollectorAdIndex::countMatches(const Conjunct & cj) const
+{
+	const AttrIndex & ai = m_attrs[cj.ix];
+	size_t count = ai.unindexed.size();
+
+	std::string str;
+	if (cj.value.IsStringValue(str)) {
+		auto it = ai.strings.find(str);
+		if (it != ai.strings.end()) { count += it->second.size(); }
+	} else {
+		NumberMap::const_iterator lo, hi;
+		numberRange(cj, lo, hi);
+		for (auto it = lo; it != hi; ++it) { count += it->second.size(); }
+	}
+	return count;
+}
+
+void CollectorAdIndex::appendMatches(const Conjunct & cj, std::vector<CollectorRecord*> & candidates) const
+{
+	const AttrIndex & ai = m_attrs[cj.ix];
+
+	std::string str;
+	if (cj.value.IsStringValue(str)) {
+		auto it = ai.strings.find(str);
+		if (it != ai.strings.end()) {
+			candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+		}
+	} else {
+		NumberMap::const_iterator lo, hi;
+		numberRange(cj, lo, hi);
+		for (auto it = lo; it != hi; ++it) {
+			candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+		}
+	}
+
+	// records whose value is an expression might match, so they are always candidates
+	candidates.insert(candidates.end(), ai.unindexed.begin(), ai.unindexed.end());
+}
+
+bool CollectorAdIndex::getCandidates(
+	classad::ExprTree * constraint,
+	std::vector<CollectorRecord*> & candidates,
+	std::string * index_attr /*=nullptr*/) const
+{
+	if (m_attrs.empty() || ! constraint) {
+		return false;
+	}
+
+	std::vector<Conjunct> conj;
+	findConjuncts(constraint, conj);
+	if (conj.empty()) {
+		return false;
+	}
+
+	// use the single most selective conjunct
+	size_t best = 0;
+	size_t best_count = countMatches(conj[0]);
+	for (size_t ix = 1; ix < conj.size() && best_count > 0; ++ix) {
+		size_t count = countMatches(conj[ix]);
+		if (count < best_count) {
+			best = ix;
+			best_count = count;
+		}
+	}
+
+	candidates.reserve(candidates.size() + best_count);
+	appendMatches(conj[best], candidates);
+	if (index_attr) {
+		*index_attr = m_attrNames[conj[best].ix];
+	}
+	return true;
+}
@@ -0,0 +1,126 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __COLLECTOR_INDEX_H__
+#define __COLLECTOR_INDEX_H__
+
+#include "condor_classad.h"
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+struct CollectorRecord;
+
+// Secondary index over the public ads of a collector table.
+//
+// For each indexed attribute the index keeps the records bucketed by the
+// literal value of that attribute in the public ad.  String values are keyed
+// case-insensitively (to match the ClassAd == operator), numeric and boolean
+// values are keyed as doubles so that range comparisons can be answered from
+// an ordered walk of the buckets.  Records whose value is not a simple literal
+// (i.e. an expression) are kept in an 'unindexed' set and are always returned
+// as candidates.  Records that do not have the attribute at all are not in the
+// index for that attribute, since a comparison of undefined with a literal
+// string or number can never be true.
+//
+// The index is only ever used to produce a superset of the matching records,
+// the caller must still evaluate the full constraint on each candidate.
+//
+// Records are inspected but not owned by the index.  The CollectorRecord keeps
+// a pointer to the index it is in, and calls remove() when it is destroyed.
+class CollectorAdIndex
+{
+public:
+	CollectorAdIndex() = default;
+	~CollectorAdIndex() = default;
+	CollectorAdIndex(const CollectorAdIndex&) = delete;
+	CollectorAdIndex& operator=(const CollectorAdIndex&) = delete;
+
+	// Set the attributes to index. This clears the index, the caller
+	// is responsible for re-inserting the records of the table.
+	void setAttributes(const std::vector<std::string> & attrs);
+	const std::vector<std::string> & getAttributes() const { return m_attrNames; }
+	bool enabled() const { return ! m_attrs.empty(); }
+
+	// add a record to the index using the current contents of its public ad.
+	// if the record is already in the index, it is re-indexed.
+	void insert(CollectorRecord * record);
+	// remove a record from the index, this does not look at the record's ads
+	// so it is safe to call after the ads have been replaced or deleted.
+	void remove(CollectorRecord * record);
+	// re-index a record after its public ad has changed, this is cheap
+	// when none of the indexed attributes have changed.
+	void update(CollectorRecord * record) { insert(record); }
+	void clear();
+
+	size_t size() const { return m_entries.size(); }
+
+	// Look for a conjunct of the constraint of the form <attr> <op> <literal>
+	// where attr is indexed, and op is one of == =?= < <= > >=.  If one is found,
+	// candidates is filled with the records of the most selective such conjunct
+	// and true is returned.  If the index cannot be used for this constraint,
+	// false is returned and candidates is not modified.
+	// if index_attr is not null, it is set to the name of the attribute used.
+	bool getCandidates(classad::ExprTree * constraint,
+		std::vector<CollectorRecord*> & candidates,
+		std::string * index_attr = nullptr) const;
+
+private:
+	typedef std::unordered_set<CollectorRecord*> RecordSet;
+	typedef std::map<double, RecordSet> NumberMap;
+
+	struct AttrIndex {
+		std::map<std::string, RecordSet, classad::CaseIgnLTStr> strings;
+		NumberMap numbers;
+		RecordSet unindexed;  // value is an expression, always a candidate
+	};
+
+	// where a record was put for one attribute, so that we can remove it
+	// without having to look at the (possibly already deleted) ad.
+	struct IndexEntry {
+		enum { STRING, NUMBER, UNINDEXED } kind;
+		double num;
+		std::string str;
+		bool operator==(const IndexEntry & rhs) const {
+			// strings are compared case-sensitively so that a change in case re-indexes the record
+			return kind == rhs.kind && ! (num < rhs.num) && ! (rhs.num < num) && str == rhs.str;
+		}
+	};
+
+	// a single indexable conjunct of a constraint
+	struct Conjunct {
+		size_t ix;  // index into m_attrs
+		classad::Operation::OpKind op;
+		classad::Value value;
+	};
+
+	int attrIndexOf(const std::string & attr) const;
+	void makeEntries(CollectorRecord * record, std::vector<std::pair<size_t, IndexEntry>> & entries) const;
+	void findConjuncts(classad::ExprTree * tree, std::vector<Conjunct> & conj) const;
+	void numberRange(const Conjunct & conj, NumberMap::const_iterator & lo, NumberMap::const_iterator & hi) const;
+	size_t countMatches(const Conjunct & conj) const;
+	void appendMatches(const Conjunct & conj, std::vector<CollectorRecord*> & candidates) const;
+
+	std::vector<std::string> m_attrNames;
+	std::vector<AttrIndex> m_attrs;
+	std::unordered_map<CollectorRecord*, std::vector<std::pair<size_t, IndexEntry>>> m_entries;
+};
+
+#endif // __COLLECTOR_INDEX_H__
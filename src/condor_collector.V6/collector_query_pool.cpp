@@ -0,0 +1,179 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+
+#include "collector_query_pool.h"
+
+CollectorQuerySnapshot::~CollectorQuerySnapshot()
+{
+	for (auto & table : ads) {
+		for (auto & ad : table) {
+			if (ad.stats) {
+				ad.stats->Unchain();
+				delete ad.stats;
+			}
+		}
+	}
+}
+
+CollectorQueryPool::~CollectorQueryPool()
+{
+	stop();
+}
+
+bool CollectorQueryPool::start(int num_threads, WorkFunc work, DoneFunc done)
+{
+	if (num_threads <= numThreads()) {
+		return running();
+	}
+
+	if (m_pipe[0] == -1) {
+#ifndef WIN32
+		if ( ! daemonCore->Create_Pipe(m_pipe, true, false, true, true)) {
+			dprintf(D_ALWAYS, "QueryWorker: Create_Pipe failed, cannot start worker threads\n");
+			m_pipe[0] = m_pipe[1] = -1;
+			return false;
+		}
+		if ( ! daemonCore->Get_Pipe_FD(m_pipe[1], &m_wake_fd) ||
+			-1 == daemonCore->Register_Pipe(m_pipe[0], "Query Worker Pipe",
+						(PipeHandlercpp)&CollectorQueryPool::pipeHandler,
+						"CollectorQueryPool::pipeHandler", this)) {
+			dprintf(D_ALWAYS, "QueryWorker: failed to register pipe, cannot start worker threads\n");
+			daemonCore->Close_Pipe(m_pipe[0]);
+			daemonCore->Close_Pipe(m_pipe[1]);
+			m_pipe[0] = m_pipe[1] = -1;
+			m_wake_fd = -1;
+			return false;
+		}
+#else
+		m_pipe[0] = m_pipe[1] = 0; // not used on Windows, we register pump work instead
+#endif
+	}
+
+	m_work = work;
+	m_done = done;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopping = false;
+	}
+	for (int worker = numThreads(); worker < num_threads; ++worker) {
+		m_threads.emplace_back(&CollectorQueryPool::workerMain, this, worker);
+	}
+	dprintf(D_ALWAYS, "QueryWorker: %d worker threads\n", numThreads());
+	return true;
+}
+
+void CollectorQueryPool::stop()
+{
+	if ( ! running()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopping = true;
+		m_pending.clear();
+	}
+	m_cv.notify_all();
+	for (auto & thr : m_threads) {
+		thr.join();
+	}
+	m_threads.clear();
+}
+
+bool CollectorQueryPool::submit(void * arg, Stream * sock)
+{
+	if ( ! running()) {
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_pending.push_back(Job{arg, sock, _condor_debug_get_time_double(), 0, -1, 0.0});
+	}
+	m_cv.notify_one();
+	return true;
+}
+
+void CollectorQueryPool::workerMain(int worker)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_cv.wait(lock, [this]{ return m_stopping || ! m_pending.empty(); });
+		if (m_stopping) {
+			break;
+		}
+		Job job = m_pending.front();
+		m_pending.pop_front();
+		lock.unlock();
+
+		job.status = m_work(job.arg, job.sock);
+		job.worker = worker;
+		job.latency = _condor_debug_get_time_double() - job.submit_time;
+
+		lock.lock();
+		m_completed.push_back(job);
+		lock.unlock();
+		wakeMainThread();
+		lock.lock();
+	}
+}
+
+void CollectorQueryPool::wakeMainThread()
+{
+#ifdef WIN32
+	daemonCore->Register_PumpWork_TS(&CollectorQueryPool::pumpWorkHandler, this, nullptr);
+#else
+	// the pipe is non-blocking, if it is full the main thread is already going to wake up
+	char ch = 'Q';
+	if (write(m_wake_fd, &ch, 1) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		dprintf(D_ALWAYS, "QueryWorker: failed to write to worker pipe, errno=%d\n", errno);
+	}
+#endif
+}
+
+int CollectorQueryPool::pipeHandler(int pipe_end)
+{
+	char buf[64];
+	while (daemonCore->Read_Pipe(pipe_end, buf, sizeof(buf)) > 0) {
+		// drain the pipe, the contents don't matter
+	}
+	reapCompleted();
+	return TRUE;
+}
+
+int CollectorQueryPool::pumpWorkHandler(void * cls, void * /*data*/)
+{
+	((CollectorQueryPool*)cls)->reapCompleted();
+	return 0;
+}
+
+int CollectorQueryPool::reapCompleted()
+{
+	std::deque<Job> done;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		done.swap(m_completed);
+	}
+	for (auto & job : done) {
+		m_done(job.arg, job.sock, job.status, job.worker, job.latency);
+	}
+	return (int)done.size();
+}
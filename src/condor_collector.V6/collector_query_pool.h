@@ -0,0 +1,127 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __COLLECTOR_QUERY_POOL_H__
+#define __COLLECTOR_QUERY_POOL_H__
+
+#include "condor_classad.h"
+#include "dc_service.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Stream;
+
+// The ads that a query handled by a worker thread will scan.
+//
+// The snapshot is built on the main thread when the query is dispatched.  It holds
+// pointers to the ads that were in the collector tables at that time (or the index
+// candidates for the query constraint).  The ads are not copied, instead the snapshot
+// pins a generation of the CollectorAdReclaimer, which keeps ads that are replaced or
+// removed from the tables from being deleted until the snapshot is released.
+// Ads that are in the tables are never modified in place while a generation is pinned,
+// see CollectorRecord::Unshare().
+struct CollectorQuerySnapshot
+{
+	struct Ad {
+		ClassAd * pub;    // public ad
+		ClassAd * pvt;    // private ad, chained to the public ad
+		ClassAd * stats;  // for the collector's own ad, fresh statistics chained to the public ad. owned by the snapshot
+	};
+
+	CollectorQuerySnapshot() = default;
+	~CollectorQuerySnapshot();
+	CollectorQuerySnapshot(const CollectorQuerySnapshot&) = delete;
+	CollectorQuerySnapshot& operator=(const CollectorQuerySnapshot&) = delete;
+
+	std::vector<std::vector<Ad>> ads;   // candidate ads for each adtype of the query
+	std::string peer;                   // peer description of the query socket
+	uint64_t generation {0};            // reclaimer generation pinned by this snapshot
+	bool filter_private_attrs {true};   // authorization decision made on the main thread
+};
+
+// A pool of threads that run collector queries against a CollectorQuerySnapshot.
+//
+// submit() and reapCompleted() are called on the main thread.  The work function runs
+// on a worker thread and must not touch DaemonCore or the collector tables.  The done
+// function is called on the main thread by reapCompleted() for each finished job,
+// it is responsible for releasing the snapshot and deleting the socket.
+//
+// When a job finishes, the worker wakes up the main thread by writing to a DaemonCore
+// pipe whose handler calls reapCompleted() (on Windows, by registering pump work).
+class CollectorQueryPool : public Service
+{
+public:
+	typedef int (*WorkFunc)(void * arg, Stream * sock);
+	typedef void (*DoneFunc)(void * arg, Stream * sock, int status, int worker, double latency);
+
+	CollectorQueryPool() = default;
+	~CollectorQueryPool();
+	CollectorQueryPool(const CollectorQueryPool&) = delete;
+	CollectorQueryPool& operator=(const CollectorQueryPool&) = delete;
+
+	// start the pool or grow it to num_threads.  the pool never shrinks, the caller limits
+	// the number of jobs that are active at one time.
+	bool start(int num_threads, WorkFunc work, DoneFunc done);
+	// wait for the jobs that are running to finish, and join the threads.
+	// jobs that have not started are discarded without calling the done function.
+	void stop();
+
+	bool running() const { return ! m_threads.empty(); }
+	int numThreads() const { return (int)m_threads.size(); }
+
+	// queue a job, returns false if the pool is not running
+	bool submit(void * arg, Stream * sock);
+
+	// call the done function for each finished job, returns the number of jobs reaped
+	int reapCompleted();
+
+private:
+	struct Job {
+		void * arg;
+		Stream * sock;
+		double submit_time;
+		int status;
+		int worker;
+		double latency;
+	};
+
+	void workerMain(int worker);
+	void wakeMainThread();
+	int pipeHandler(int pipe_end);
+	static int pumpWorkHandler(void * cls, void * data);
+
+	WorkFunc m_work {nullptr};
+	DoneFunc m_done {nullptr};
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<Job> m_pending;    // guarded by m_mutex
+	std::deque<Job> m_completed;  // guarded by m_mutex
+	bool m_stopping {false};      // guarded by m_mutex
+
+	int m_pipe[2] {-1, -1};  // DaemonCore pipe ends
+	int m_wake_fd {-1};      // os fd of the write end of the pipe
+};
+
+#endif // __COLLECTOR_QUERY_POOL_H__
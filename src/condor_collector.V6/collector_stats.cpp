@@ -375,6 +375,10 @@ void UpdatesStats::Init()
 	STATS_POOL_ADD(Pool, "", ActiveQueryWorkers, IF_BASICPUB);
 	STATS_POOL_ADD(Pool, "", PendingQueries, IF_BASICPUB);
 	STATS_POOL_ADD_VAL_PUB_RECENT(Pool, "", DroppedQueries, IF_BASICPUB);
+	STATS_POOL_ADD_VAL_PUB_RECENT(Pool, "", DeltaUpdates, IF_BASICPUB);
+	STATS_POOL_ADD_VAL_PUB_RECENT(Pool, "", DeltaUpdatesRejected, IF_BASICPUB);
+	Pool.AddProbe("QueryWorkerLatency", &QueryWorkerLatency, NULL,
+		IF_BASICPUB | stats_entry_recent<Probe>::PubValueAndRecent | ProbeDetailMode_CAMM | IF_NONZERO);
 
 	ADD_EXTERN_RUNTIME(Pool, HandleQuery, IF_VERBOSEPUB);
 	ADD_EXTERN_RUNTIME(Pool, HandleLocate, IF_VERBOSEPUB);
@@ -465,7 +469,15 @@ void UpdatesStats::Clear()
 	this->RecentStatsLifetime = 0;
 
 	Pool.Clear();
+		// the pool holds pointers to these probes, so take them out before they are destroyed
+	for (auto & [name, counters] : PerClass) {
+		counters.UnregisterCounters(Pool);
+	}
 	PerClass.clear();
+	for (auto & [worker, probe] : PerWorkerLatency) {
+		Pool.RemoveProbesByAddress(&probe, &probe);
+	}
+	PerWorkerLatency.clear();
 }
 
 time_t UpdatesStats::Tick(time_t now) // call this when time may have changed to update StatsUpdateTime, etc.
@@ -581,6 +593,26 @@ int  UpdatesStats::updateStats( const char * className, bool sequenced, int drop
 	return 0;
 }
 
+// this is called when a query worker finishes.
+void UpdatesStats::updateQueryWorkerStats( int worker, double latency )
+{
+	QueryWorkerLatency += latency;
+
+	if (worker >= 0) {
+		auto found = PerWorkerLatency.find(worker);
+		if (found == PerWorkerLatency.end()) {
+			int cRecent = RecentWindowQuantum ? RecentWindowMax / RecentWindowQuantum : RecentWindowMax;
+			found = PerWorkerLatency.emplace(worker, stats_entry_recent<Probe>()).first;
+			found->second.SetRecentMax(cRecent);
+			std::string attr;
+			formatstr(attr, "QueryWorker%dLatency", worker);
+			Pool.AddProbe(attr.c_str(), &found->second, NULL,
+				IF_VERBOSEPUB | stats_entry_recent<Probe>::PubValueAndRecent | ProbeDetailMode_CAMM | IF_NONZERO);
+		}
+		found->second += latency;
+	}
+}
+
 
 // **********************************************
 // Per daemon List of Collector Statistics
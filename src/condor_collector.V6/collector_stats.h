@@ -171,6 +171,12 @@ struct UpdatesStats {
 	stats_entry_abs<int> ActiveQueryWorkers;
 	stats_entry_abs<int> PendingQueries;
 	stats_entry_recent<long> DroppedQueries;
+	stats_entry_recent<long> DeltaUpdates;         // UPDATE_STARTD_AD_DELTA merged into a stored ad
+	stats_entry_recent<long> DeltaUpdatesRejected; // UPDATE_STARTD_AD_DELTA that did not match the stored ad
+	stats_entry_recent<Probe> QueryWorkerLatency; // time from dispatch to completion of forked or threaded queries
+
+	// per-thread query latency, only used when COLLECTOR_QUERY_WORKERS_USE_THREADS is true
+	std::map<int, stats_entry_recent<Probe>> PerWorkerLatency;
 
 #ifdef TRACK_QUERIES_BY_SUBSYS
 	stats_entry_recent<long> InProcQueriesFrom[SUBSYSTEM_ID_COUNT]; // Track subsystems < the AUTO subsys.
@@ -207,6 +213,9 @@ struct UpdatesStats {
 
 	// this is called when a new update arrives.
 	int  updateStats( const char * className, bool sequenced, int dropped );
+
+	// this is called when a query worker finishes, worker is -1 for forked workers
+	void updateQueryWorkerStats( int worker, double latency );
 };
 
 
@@ -0,0 +1,275 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the collector's secondary index of slot ads
+
+#include "condor_common.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "condor_debug.h"
+#include "condor_daemon_core.h"
+#include "compat_classad_util.h"
+
+#include "collector_index.h"
+#include "collector_engine.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+
+// collector_engine.cpp is not linked into this test
+CollectorAdReclaimer CollectorRecord::s_reclaimer;
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static ClassAd * makeSlot(const char * name, const char * state, int cpus, const char * extra = nullptr)
+{
+	ClassAd * ad = new ClassAd();
+	ad->Assign(ATTR_NAME, name);
+	if (state) { ad->Assign(ATTR_STATE, state); }
+	ad->Assign(ATTR_CPUS, cpus);
+	if (extra) { ad->Insert(extra); }
+	return ad;
+}
+
+static CollectorRecord * makeRecord(CollectorAdIndex & index, const char * name, const char * state, int cpus, const char * extra = nullptr)
+{
+	return new CollectorRecord(makeSlot(name, state, cpus, extra), new ClassAd(), &index);
+}
+
+// returns the names of the candidate records, or "none" if the index was not used
+static std::string candidates(const CollectorAdIndex & index, const char * constraint, std::string * attr = nullptr)
+{
+	ExprTree * tree = nullptr;
+	if (ParseClassAdRvalExpr(constraint, tree) != 0) {
+		fprintf(stderr, "could not parse %s\n", constraint);
+		++fail_count;
+		return "";
+	}
+	std::vector<CollectorRecord*> recs;
+	bool used = index.getCandidates(tree, recs, attr);
+	delete tree;
+	if ( ! used) {
+		return "none";
+	}
+	std::vector<std::string> names;
+	for (CollectorRecord * rec : recs) {
+		std::string name;
+		rec->m_publicAd->LookupString(ATTR_NAME, name);
+		names.push_back(name);
+	}
+	std::sort(names.begin(), names.end());
+	std::string result;
+	for (const auto & name : names) {
+		if ( ! result.empty()) result += ",";
+		result += name;
+	}
+	return result;
+}
+
+static void test_string_equality()
+{
+	CollectorAdIndex index;
+	index.setAttributes({ATTR_STATE, ATTR_CPUS});
+	std::unique_ptr<CollectorRecord> a(makeRecord(index, "a", "Unclaimed", 1));
+	std::unique_ptr<CollectorRecord> b(makeRecord(index, "b", "Claimed", 2));
+	std::unique_ptr<CollectorRecord> c(makeRecord(index, "c", "unclaimed", 4));
+	std::unique_ptr<CollectorRecord> d(makeRecord(index, "d", nullptr, 8));
+
+	REQUIRE(index.size() == 4);
+	// strings are matched case-insensitively, like ==
+	REQUIRE(candidates(index, "State == \"Unclaimed\"") == "a,c");
+	REQUIRE(candidates(index, "State =?= \"CLAIMED\"") == "b");
+	REQUIRE(candidates(index, "\"Claimed\" == State") == "b");
+	REQUIRE(candidates(index, "State == \"Owner\"") == "");
+	// ordered comparisons of strings do not use the index
+	REQUIRE(candidates(index, "State < \"M\"") == "none");
+	// neither do attributes that are not indexed or clauses under ||
+	REQUIRE(candidates(index, "Name == \"a\"") == "none");
+	REQUIRE(candidates(index, "State == \"Claimed\" || Cpus > 2") == "none");
+}
+
+static void test_number_ranges()
+{
+	CollectorAdIndex index;
+	index.setAttributes({ATTR_CPUS});
+	std::vector<std::unique_ptr<CollectorRecord>> recs;
+	for (int cpus = 1; cpus <= 5; ++cpus) {
+		std::string name = "s" + std::to_string(cpus);
+		recs.emplace_back(makeRecord(index, name.c_str(), "Unclaimed", cpus));
+	}
+
+	REQUIRE(candidates(index, "Cpus == 3") == "s3");
+	REQUIRE(candidates(index, "Cpus == 3.0") == "s3");
+	REQUIRE(candidates(index, "Cpus < 3") == "s1,s2");
+	REQUIRE(candidates(index, "Cpus <= 3") == "s1,s2,s3");
+	REQUIRE(candidates(index, "Cpus > 3") == "s4,s5");
+	REQUIRE(candidates(index, "Cpus >= 3") == "s3,s4,s5");
+	// literal on the left flips the comparison
+	REQUIRE(candidates(index, "3 < Cpus") == "s4,s5");
+	REQUIRE(candidates(index, "3 >= Cpus") == "s1,s2,s3");
+	REQUIRE(candidates(index, "(Cpus > 1) && (Cpus < 5)") != "none");
+	REQUIRE(candidates(index, "Cpus > 10") == "");
+}
+
+static void test_most_selective()
+{
+	CollectorAdIndex index;
+	index.setAttributes({ATTR_STATE, ATTR_CPUS});
+	std::vector<std::unique_ptr<CollectorRecord>> recs;
+	for (int ii = 0; ii < 10; ++ii) {
+		std::string name = "s" + std::to_string(ii);
+		recs.emplace_back(makeRecord(index, name.c_str(), "Unclaimed", ii == 7 ? 16 : 1));
+	}
+
+	std::string attr;
+	REQUIRE(candidates(index, "State == \"Unclaimed\" && Cpus >= 16", &attr) == "s7");
+	REQUIRE(attr == ATTR_CPUS);
+	REQUIRE(candidates(index, "Cpus >= 1 && State == \"Claimed\" && Name =!= undefined", &attr) == "");
+	REQUIRE(attr == ATTR_STATE);
+}
+
+static void test_unindexed_values()
+{
+	CollectorAdIndex index;
+	index.setAttributes({ATTR_STATE, ATTR_CPUS});
+	std::unique_ptr<CollectorRecord> a(makeRecord(index, "a", "Claimed", 1));
+	// an expression could evaluate to anything, so it is always a candidate
+	std::unique_ptr<CollectorRecord> b(makeRecord(index, "b", nullptr, 1, "State = MyState"));
+	// undefined never compares equal to a literal
+	std::unique_ptr<CollectorRecord> c(makeRecord(index, "c", nullptr, 1, "State = undefined"));
+
+	REQUIRE(candidates(index, "State == \"Unclaimed\"") == "b");
+	REQUIRE(candidates(index, "State == \"Claimed\"") == "a,b");
+}
+
+static void test_update_and_remove()
+{
+	CollectorAdIndex index;
+	index.setAttributes({ATTR_STATE});
+	std::unique_ptr<CollectorRecord> a(makeRecord(index, "a", "Unclaimed", 1));
+	std::unique_ptr<CollectorRecord> b(makeRecord(index, "b", "Unclaimed", 1));
+
+	// modify in place and re-index
+	a->m_publicAd->Assign(ATTR_STATE, "Claimed");
+	a->Reindex();
+	REQUIRE(candidates(index, "State == \"Unclaimed\"") == "b");
+	REQUIRE(candidates(index, "State == \"Claimed\"") == "a");
+
+	// replace the ads
+	b->ReplaceAds(makeSlot("b", "Claimed", 1), new ClassAd());
+	REQUIRE(candidates(index, "State == \"Unclaimed\"") == "");
+	REQUIRE(candidates(index, "State == \"Claimed\"") == "a,b");
+
+	// dropping the attribute takes the record out of the index
+	b->m_publicAd->Delete(ATTR_STATE);
+	b->Reindex();
+	REQUIRE(candidates(index, "State == \"Claimed\"") == "a");
+	REQUIRE(index.size() == 1);
+
+	// deleting the record removes it
+	a.reset();
+	REQUIRE(index.size() == 0);
+	REQUIRE(candidates(index, "State == \"Claimed\"") == "");
+
+	// changing the attributes clears the index
+	std::unique_ptr<CollectorRecord> c(makeRecord(index, "c", "Unclaimed", 1));
+	index.setAttributes({ATTR_CPUS});
+	REQUIRE(index.size() == 0);
+	REQUIRE(candidates(index, "State == \"Unclaimed\"") == "none");
+	index.insert(c.get());
+	REQUIRE(candidates(index, "Cpus == 1") == "c");
+
+	index.setAttributes({});
+	REQUIRE( ! index.enabled());
+	REQUIRE(candidates(index, "Cpus == 1") == "none");
+}
+
+// the candidates must always include every ad that matches the constraint
+static void test_superset()
+{
+	CollectorAdIndex index;
+	index.setAttributes({ATTR_STATE, ATTR_CPUS, ATTR_MEMORY});
+	const char * states[] = {"Unclaimed", "Claimed", "Owner", "Matched"};
+	std::vector<std::unique_ptr<CollectorRecord>> recs;
+	for (int ii = 0; ii < 200; ++ii) {
+		std::string name = "s" + std::to_string(ii);
+		const char * extra = nullptr;
+		if (ii % 17 == 0) extra = "Memory = Cpus * 1024";
+		else if (ii % 5 == 0) extra = "Memory = 2048.5";
+		else if (ii % 3 == 0) extra = "Memory = true";
+		recs.emplace_back(makeRecord(index, name.c_str(), states[ii % 4], ii % 9, extra));
+	}
+
+	const char * constraints[] = {
+		"State == \"Unclaimed\"",
+		"Cpus >= 4 && State =?= \"Claimed\"",
+		"Memory > 2048",
+		"Memory == 1",
+		"Memory <= 4096 && Cpus < 3",
+		"8 > Cpus && Memory >= 2048.5",
+		"(State == \"Owner\") && (Cpus == 0 || Cpus == 8)",
+	};
+	for (const char * constraint : constraints) {
+		ExprTree * tree = nullptr;
+		REQUIRE(ParseClassAdRvalExpr(constraint, tree) == 0);
+		std::vector<CollectorRecord*> cand;
+		REQUIRE(index.getCandidates(tree, cand));
+		std::set<CollectorRecord*> cset(cand.begin(), cand.end());
+		REQUIRE(cset.size() == cand.size());
+		int matches = 0;
+		for (auto & rec : recs) {
+			if (EvalExprBool(rec->m_publicAd, tree)) {
+				++matches;
+				if ( ! cset.count(rec.get())) {
+					std::string name;
+					rec->m_publicAd->LookupString(ATTR_NAME, name);
+					fprintf(stderr, "Failed: %s is not a candidate for %s\n", name.c_str(), constraint);
+					++fail_count;
+				}
+			}
+		}
+		REQUIRE(matches > 0);
+		REQUIRE(cand.size() < recs.size());
+		delete tree;
+	}
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	test_string_equality();
+	test_number_ranges();
+	test_most_selective();
+	test_unindexed_values();
+	test_update_and_remove();
+	test_superset();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
@@ -180,6 +180,11 @@ void CollectorList::checkVersionBeforeSendingUpdates(bool check) {
 	for (auto * dcc : m_list) { if (dcc) dcc->checkVersionBeforeSendingUpdate(check); }
 }
 
+// pass delta update limit down to the individual DCCollector objects
+void CollectorList::useDeltaUpdates(int max_deltas) {
+	for (auto * dcc : m_list) { if (dcc) dcc->useDeltaUpdates(max_deltas); }
+}
+
 QueryResult
 CollectorList::query (CondorQuery & cQuery, bool (*callback)(void*, ClassAd *), void* pv, CondorError * errstack) {
 
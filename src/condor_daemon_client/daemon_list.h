@@ -52,6 +52,7 @@ class CollectorList {
 		const std::string authz_name = "");
 
 	void checkVersionBeforeSendingUpdates(bool check);
+	void useDeltaUpdates(int max_deltas);
 
 	std::vector<DCCollector*>& getList() { return m_list; }
 
@@ -27,6 +27,7 @@
 #include "condor_daemon_core.h"
 #include "dc_collector.h"
 #include "subsystem_info.h"
+#include "selector.h"
 
 #include <algorithm>
 
@@ -737,8 +738,7 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 		// and we only want to invoke the callback once.  So we avoid passing the callback to
 		// finishUpdate to prevent both finishUpdate and initiateUpdate from invoking the
 		// callback function in the case we need to create a new connection.
-	update_rsock->encode();
-	if (update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2, nullptr, nullptr)) {
+	if (sendTCPUpdateOnStashedSock(cmd, ad1, ad2)) {
 		if (callback_fn) {
 			(*callback_fn)(true, update_rsock, nullptr, update_rsock->getTrustDomain(), update_rsock->shouldTryTokenRequest(), miscdata);
 		}
@@ -756,6 +756,118 @@ DCCollector::sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblockin
 
 
 
+// Send an update over the stashed TCP socket.
+//
+// When delta updates are enabled, a startd slot ad is sent as UPDATE_STARTD_AD_DELTA
+// with only the attributes that changed since the last update of that slot that was
+// sent over this same socket.  Because the socket delivers updates in order, the
+// collector has that update unless it dropped it, in which case it closes the socket
+// rather than apply the delta.  A collector that doesn't know the command closes it
+// too.  Then this update starts a new connection, which discards the delta bases so
+// the whole ad is sent.  After MAX_REFUSED_DELTA_UPDATES deltas in a row are refused,
+// only whole ads are sent to this collector until the next reconfig.
+bool
+DCCollector::sendTCPUpdateOnStashedSock( int cmd, ClassAd* ad1, ClassAd* ad2 )
+{
+		// the collector never writes to the update socket, so if the last
+		// update was a delta and the socket is now readable, the collector
+		// closed it and refused the delta
+	if (last_update_was_delta) {
+		last_update_was_delta = false;
+		Selector selector;
+		selector.add_fd(update_rsock->get_file_desc(), Selector::IO_READ);
+		selector.set_timeout(0);
+		selector.execute();
+		if (selector.has_ready()) {
+			if (++refused_delta_updates == MAX_REFUSED_DELTA_UPDATES) {
+				dprintf(D_ALWAYS, "Collector %s refused %d delta updates in a row, "
+					"sending whole ads until reconfig\n", updateDestination(), refused_delta_updates);
+			}
+			return false;
+		}
+		refused_delta_updates = 0;
+	}
+
+	update_rsock->encode();
+
+	if (max_delta_updates <= 0 || cmd != UPDATE_STARTD_AD || ! ad1 || ! ad2 ||
+		refused_delta_updates >= MAX_REFUSED_DELTA_UPDATES ||
+		! checkCachedVersion(24, 2, 0, false)) {
+		return update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2, nullptr, nullptr);
+	}
+
+	std::string key, mytype;
+	makeAdSeqKey(*ad1, key, mytype);
+	long long sequence = 0;
+	ad1->LookupInteger(ATTR_UPDATE_SEQUENCE_NUMBER, sequence);
+
+	ClassAd delta;
+	auto found = delta_bases.find(key);
+	bool send_delta = found != delta_bases.end() &&
+		found->second.deltas < max_delta_updates &&
+		makeDeltaUpdate(*ad1, found->second, delta);
+
+	bool sent;
+	if (send_delta) {
+		sent = update_rsock->put(UPDATE_STARTD_AD_DELTA) && finishUpdate(this, update_rsock, &delta, ad2, nullptr, nullptr);
+	} else {
+		sent = update_rsock->put(cmd) && finishUpdate(this, update_rsock, ad1, ad2, nullptr, nullptr);
+	}
+	if ( ! sent) {
+		delta_bases.clear();
+		return false;
+	}
+
+	last_update_was_delta = send_delta;
+	DeltaBase & base = delta_bases[key];
+	base.ad = *ad1;
+	base.sequence = sequence;
+	base.deltas = send_delta ? base.deltas + 1 : 0;
+	return true;
+}
+
+// Fill in delta with the attributes of ad that are new or changed since the base ad,
+// the names of the attributes that were removed, and the attributes the collector
+// needs to find the ad that the delta applies to.
+// Returns false if the delta would not be much smaller than the ad, or if the ad has
+// no DaemonStartTime, since the collector never applies a delta to such an ad.
+bool
+DCCollector::makeDeltaUpdate( const ClassAd & ad, const DeltaBase & base, ClassAd & delta )
+{
+	if ( ! ad.Lookup(ATTR_DAEMON_START_TIME)) {
+		return false;
+	}
+	for (const auto & [attr, expr] : ad) {
+		ExprTree * old_expr = base.ad.Lookup(attr);
+		if ( ! old_expr || ! old_expr->SameAs(expr)) {
+			delta.Insert(attr, expr->Copy());
+		}
+	}
+	if (delta.size() * 2 > ad.size()) {
+		return false;
+	}
+
+	std::string removed;
+	for (const auto & [attr, expr] : base.ad) {
+		if ( ! ad.Lookup(attr)) {
+			if ( ! removed.empty()) removed += ",";
+			removed += attr;
+		}
+	}
+	if ( ! removed.empty()) {
+		delta.Assign(ATTR_UPDATE_DELTA_REMOVED_ATTRS, removed);
+	}
+
+	for (const char * attr : {ATTR_NAME, ATTR_MACHINE, ATTR_SLOT_ID, ATTR_MY_TYPE,
+			ATTR_MY_ADDRESS, ATTR_STARTD_IP_ADDR, ATTR_DAEMON_START_TIME}) {
+		if ( ! delta.Lookup(attr) && ad.Lookup(attr)) {
+			CopyAttribute(attr, delta, ad);
+		}
+	}
+	delta.Assign(ATTR_UPDATE_DELTA_BASE_SEQUENCE_NUMBER, base.sequence);
+	return true;
+}
+
 bool
 DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType *callback_fn, void *miscdata )
 {
@@ -763,6 +875,9 @@ DCCollector::initiateTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblo
 		delete update_rsock;
 		update_rsock = NULL;
 	}
+		// the collector may not have the ads that we sent over the old socket
+	delta_bases.clear();
+	last_update_was_delta = false;
 	if(nonblocking) {
 		UpdateData *ud = new UpdateData(cmd, Sock::reli_sock, ad1, ad2, this, callback_fn, miscdata);
 			// Note that UpdateData automatically adds itself to the pending_update_list.
@@ -841,17 +956,24 @@ DCCollector::initDestinationStrings( void )
 // Ad Sequence Number class methods
 //
 
+// Make the key that identifies an ad for sequence numbers and delta updates
+void makeAdSeqKey(const ClassAd & ad, std::string & key, std::string & mytype)
+{
+	std::string attr;
+	ad.LookupString( ATTR_NAME, key );
+	ad.LookupString( ATTR_MY_TYPE, mytype );
+	key += "\n"; key += mytype;
+	ad.LookupString( ATTR_MACHINE, attr );
+	key += "\n"; key += attr;
+}
+
 // Get a sequence number class for this classad, creating it if needed.
 DCCollectorAdSeq& DCCollectorAdSequences::getAdSeq(const ClassAd & ad)
 {
 	AdTypes mytype = NO_AD;
 	std::string name, attr;
-	ad.LookupString( ATTR_NAME, name );
-	ad.LookupString( ATTR_MY_TYPE, attr );
-	name += "\n"; name += attr;
+	makeAdSeqKey(ad, name, attr);
 	if ( ! attr.empty()) { mytype = AdTypeStringToAdType(attr.c_str()); }
-	ad.LookupString( ATTR_MACHINE, attr );
-	name += "\n"; name += attr;
 
 	DCCollectorAdSeqMap::iterator it = seqs.find(name);
 	if (it != seqs.end()) {
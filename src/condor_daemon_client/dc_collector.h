@@ -52,6 +52,9 @@ protected:
 	AdTypes   adtype{NO_AD};
 };
 
+// make the key that identifies an ad for DCCollectorAdSequences, also returns the ad's MyType
+void makeAdSeqKey(const ClassAd & ad, std::string & key, std::string & mytype);
+
 typedef std::map<std::string, DCCollectorAdSeq> DCCollectorAdSeqMap;
 class DCCollectorAdSequences {
 public:
@@ -111,6 +114,10 @@ public:
 	// do a version check against the cached version number, return default value if version is not known
 	bool checkCachedVersion(int major, int minor, int subminor, bool default_value);
 	bool hasVersion() { return ! _version.empty(); }
+	// send startd slot ads as deltas against the previous update, sending the whole ad
+	// after max_deltas consecutive deltas.  0 disables delta updates.
+	// also lets a collector that refused deltas be sent them again
+	void useDeltaUpdates(int max_deltas) { max_delta_updates = max_deltas; refused_delta_updates = 0; if ( ! max_deltas) delta_bases.clear(); }
 
 	time_t getStartTime() const { return startTime; }
 	time_t getReconfigTime() const { return reconfigTime; }
@@ -144,6 +151,24 @@ private:
 	std::deque<class UpdateData*> pending_update_list;
 	friend class UpdateData;
 
+	// the last slot ads sent over update_rsock, keyed like DCCollectorAdSequences.
+	// these are the base of the next delta update for each slot.
+	struct DeltaBase {
+		ClassAd ad;
+		long long sequence{0};
+		int deltas{0}; // number of consecutive delta updates sent since the whole ad
+	};
+	std::map<std::string, DeltaBase> delta_bases;
+	int max_delta_updates{0};
+	// the last update sent over update_rsock was a delta
+	bool last_update_was_delta{false};
+	// deltas in a row that the collector closed the socket on
+	int refused_delta_updates{0};
+	static const int MAX_REFUSED_DELTA_UPDATES = 2;
+
+	bool makeDeltaUpdate( const ClassAd & ad, const DeltaBase & base, ClassAd & delta );
+	bool sendTCPUpdateOnStashedSock( int cmd, ClassAd* ad1, ClassAd* ad2 );
+
 	bool sendTCPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType callback_fn, void* miscdata );
 	bool sendUDPUpdate( int cmd, ClassAd* ad1, ClassAd* ad2, bool nonblocking, StartCommandCallbackType callback_fn, void *miscdata );
 
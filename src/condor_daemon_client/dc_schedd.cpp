@@ -2172,24 +2172,15 @@ bool DCSchedd::canUseQueryWithAuth()
 }
 
 
-int DCSchedd::queryJobs (
-	int cmd, // QUERY_JOB_ADS or QUERY_JOB_ADS_WITH_AUTH
-	ClassAd & request_ad,
-	// return false to take ownership of the ad, true to allow the ad to be deleted after
+// read the reply to a job query from sock, passing each job ad to process_func
+static int
+receiveJobQueryResults (
+	Sock * sock,
 	bool (*process_func)(void*, ClassAd *ad),
 	void * process_func_data,
-	int connect_timeout,
 	CondorError *errstack,
 	ClassAd ** psummary_ad)
 {
-	Sock* sock;
-	if (!(sock = startCommand(cmd, Stream::reli_sock, connect_timeout, errstack))) return Q_SCHEDD_COMMUNICATION_ERROR;
-
-	classad_shared_ptr<Sock> sock_sentry(sock);
-
-	if (!putClassAd(sock, request_ad) || !sock->end_of_message()) return Q_SCHEDD_COMMUNICATION_ERROR;
-	dprintf(D_FULLDEBUG, "Sent Query classad to schedd\n");
-
 	ClassAd *ad = NULL;	// job ad result
 	int rval = 0;
 	do {
@@ -2236,6 +2227,144 @@ int DCSchedd::queryJobs (
 	return rval;
 }
 
+int DCSchedd::queryJobs (
+	int cmd, // QUERY_JOB_ADS or QUERY_JOB_ADS_WITH_AUTH
+	ClassAd & request_ad,
+	// return false to take ownership of the ad, true to allow the ad to be deleted after
+	bool (*process_func)(void*, ClassAd *ad),
+	void * process_func_data,
+	int connect_timeout,
+	CondorError *errstack,
+	ClassAd ** psummary_ad)
+{
+	Sock* sock;
+	if (!(sock = startCommand(cmd, Stream::reli_sock, connect_timeout, errstack))) return Q_SCHEDD_COMMUNICATION_ERROR;
+
+	classad_shared_ptr<Sock> sock_sentry(sock);
+
+	if (!putClassAd(sock, request_ad) || !sock->end_of_message()) return Q_SCHEDD_COMMUNICATION_ERROR;
+	dprintf(D_FULLDEBUG, "Sent Query classad to schedd\n");
+
+	return receiveJobQueryResults(sock, process_func, process_func_data, errstack, psummary_ad);
+}
+
+
+// the job counts of the summary ad that are for the ads of the query, and so must be
+// summed over the pages of a paged query.  the other counts are for the whole schedd.
+static const char * const paged_query_counts[] = {
+	"Jobs", "Idle", "Running", "Removed", "Completed", "Held", "Suspended",
+	"SchedulerJobs", "SchedulerIdle", "SchedulerRunning", "SchedulerRemoved", "SchedulerCompleted", "SchedulerHeld",
+};
+
+// the ads of the first page of a paged query, held until we know that the schedd paged it
+struct FirstPageAds {
+	std::vector<ClassAd *> ads;
+	~FirstPageAds() { for (ClassAd * ad : ads) { delete ad; } }
+	static bool hold(void * pv, ClassAd * ad) { static_cast<FirstPageAds *>(pv)->ads.push_back(ad); return false; }
+};
+
+int DCSchedd::queryJobsPaged (
+	int cmd, // QUERY_JOB_ADS or QUERY_JOB_ADS_WITH_AUTH
+	ClassAd & request_ad,
+	int page_size,
+	// return false to take ownership of the ad, true to allow the ad to be deleted after
+	bool (*process_func)(void*, ClassAd *ad),
+	void * process_func_data,
+	int connect_timeout,
+	CondorError *errstack,
+	ClassAd ** psummary_ad)
+{
+	if (page_size <= 0) {
+		return queryJobs(cmd, request_ad, process_func, process_func_data, connect_timeout, errstack, psummary_ad);
+	}
+
+	ClassAd page_request(request_ad);
+	page_request.InsertAttr(ATTR_LIMIT_RESULTS, page_size);
+	page_request.InsertAttr(ATTR_QUERY_Q_CURSOR, 0);
+
+	std::map<std::string, long long> counts;
+	FirstPageAds first_page_ads;
+	bool first_page = true;
+	bool hold_first_page = true;
+	int rval = Q_OK;
+	while (true) {
+		Sock* sock;
+		if (!(sock = startCommand(cmd, Stream::reli_sock, connect_timeout, errstack))) return Q_SCHEDD_COMMUNICATION_ERROR;
+
+		classad_shared_ptr<Sock> sock_sentry(sock);
+
+		if (first_page) {
+			first_page = false;
+			// we know the version of the schedd once we are connected.  a schedd that can't
+			// page would ignore the cursor and return only the first page, so don't page
+			if (_version.empty() && sock->get_peer_version()) {
+				_version = sock->get_peer_version()->get_version_stdstring();
+			}
+			if (_version.empty() || ! CondorVersionInfo(_version.c_str()).built_since_version(24, 2, 0)) {
+				dprintf(D_FULLDEBUG, "Schedd %s cannot page job queries, querying all of the jobs at once\n",
+					_version.empty() ? "of unknown version" : _version.c_str());
+				if (!putClassAd(sock, request_ad) || !sock->end_of_message()) return Q_SCHEDD_COMMUNICATION_ERROR;
+				return receiveJobQueryResults(sock, process_func, process_func_data, errstack, psummary_ad);
+			}
+		}
+
+		if (!putClassAd(sock, page_request) || !sock->end_of_message()) return Q_SCHEDD_COMMUNICATION_ERROR;
+		dprintf(D_FULLDEBUG, "Sent Query classad for a page of %d jobs to schedd\n", page_size);
+
+		ClassAd * summary_ad = nullptr;
+		bool holding = hold_first_page;
+		hold_first_page = false;
+		if (holding) {
+			rval = receiveJobQueryResults(sock, FirstPageAds::hold, &first_page_ads, errstack, &summary_ad);
+		} else {
+			rval = receiveJobQueryResults(sock, process_func, process_func_data, errstack, &summary_ad);
+		}
+		if (rval != Q_OK || ! summary_ad) {
+			delete summary_ad;
+			break;
+		}
+		if (holding) {
+			// a schedd that ignored the cursor sent the first page_size jobs and stopped,
+			// unless there were no more than that, so ask it again for all of the jobs
+			bool paged = false;
+			summary_ad->LookupBool(ATTR_QUERY_Q_PAGED, paged);
+			if ( ! paged && (int)first_page_ads.ads.size() >= page_size) {
+				dprintf(D_FULLDEBUG, "Schedd did not page the job query, querying all of the jobs at once\n");
+				delete summary_ad;
+				return queryJobs(cmd, request_ad, process_func, process_func_data, connect_timeout, errstack, psummary_ad);
+			}
+			for (ClassAd *& ad : first_page_ads.ads) {
+				if (process_func(process_func_data, ad)) { delete ad; }
+				ad = nullptr;
+			}
+			first_page_ads.ads.clear();
+		}
+		summary_ad->Delete(ATTR_QUERY_Q_PAGED);
+		for (const char * attr : paged_query_counts) {
+			long long count = 0;
+			if (summary_ad->LookupInteger(attr, count)) { counts[attr] += count; }
+		}
+
+		// the schedd returns the cursor and the id of the last ad when there may be more pages
+		int cursor = 0;
+		std::string after_id;
+		bool more = summary_ad->LookupInteger(ATTR_QUERY_Q_CURSOR, cursor) &&
+			summary_ad->LookupString(ATTR_QUERY_Q_AFTER_JOB_ID, after_id);
+		summary_ad->Delete(ATTR_QUERY_Q_CURSOR);
+		summary_ad->Delete(ATTR_QUERY_Q_AFTER_JOB_ID);
+		if ( ! more) {
+			for (const auto & [attr, count] : counts) { summary_ad->InsertAttr(attr, count); }
+			if (psummary_ad) { *psummary_ad = summary_ad; }
+			else { delete summary_ad; }
+			break;
+		}
+		delete summary_ad;
+		page_request.InsertAttr(ATTR_QUERY_Q_CURSOR, cursor);
+		page_request.InsertAttr(ATTR_QUERY_Q_AFTER_JOB_ID, after_id);
+	}
+	return rval;
+}
+
 
 /*static*/ int DCSchedd::makeUsersQueryAd (
 	classad::ClassAd & request_ad,
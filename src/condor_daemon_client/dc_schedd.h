@@ -413,6 +413,23 @@ public:
 		CondorError *errstack,
 		ClassAd ** psummary_ad);
 
+	// like queryJobs, but fetch the results in pages of page_size ads, using a separate
+	// connection for each page. the schedd keeps a cursor between pages, so each page
+	// resumes where the last one stopped. the summary ad is the one of the last page,
+	// with the job counts of the query summed over the pages. if page_size is 0, or
+	// the schedd is older than 24.2.0 or of unknown version, this is the same as queryJobs.
+	// the ads of the first page are held until the schedd confirms that it paged the
+	// query; if it didn't, and the page may not have all of the jobs, they are dropped
+	// and the jobs are queried again with queryJobs.
+	int queryJobsPaged (int cmd, // QUERY_JOB_ADS or QUERY_JOB_ADS_WITH_AUTH
+		ClassAd & query_ad,
+		int page_size,
+		bool (*process_func)(void*, ClassAd *ad),
+		void * process_func_data,
+		int connect_timeout,
+		CondorError *errstack,
+		ClassAd ** psummary_ad);
+
 		/*
 		 * methods for schedd UserRec records
 		 */
@@ -82,12 +82,14 @@ public:
 		    @param alive_interval Seconds
 		    @param timeout Socket timeout.
 		    @param cb - callback object
+		    @param num_dslots Number of dynamic slots to claim when the
+			  claim id is for a partitionable slot
 
 			To see the result of the request, check claimed_startd_success()
 			in the DCStartdMsg object, which may be obtained from the callback
 			object at callback time.
 		*/
-	void asyncRequestOpportunisticClaim( ClassAd const *req_ad, char const *description, char const *scheduler_addr, int alive_interval, bool claim_pslot, int timeout, int deadline_timeout, classy_counted_ptr<DCMsgCallback> cb );
+	void asyncRequestOpportunisticClaim( ClassAd const *req_ad, char const *description, char const *scheduler_addr, int alive_interval, bool claim_pslot, int timeout, int deadline_timeout, classy_counted_ptr<DCMsgCallback> cb, int num_dslots = 1 );
 
 		/** Send the command to this startd to deactivate the claim 
 			@param graceful Should we be graceful or forcful?
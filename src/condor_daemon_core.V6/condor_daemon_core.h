@@ -62,6 +62,7 @@
 #include <vector>
 #include <memory>
 #include <deque>
+#include <mutex>
 
 #include "../condor_procd/proc_family_io.h"
 class ProcFamilyInterface;
@@ -73,6 +74,7 @@ class ProcFamilyInterface;
 #define DEBUG_SETTABLE_ATTR_LISTS 0
 
 class Probe;
+class Selector;
 
 #define USE_MIRON_PROBE_FOR_DC_RUNTIME_STATS
 
@@ -1166,7 +1168,8 @@ class DaemonCore : public Service
 
     // register a callback from any thread that will be called on the main thread
     // as soon as we are back in the daemon core pump (just before timers are handled).
-    // In effect, this is a thread safe register of a zero length one-shot timer
+    // In effect, this is a thread safe register of a zero length one-shot timer.
+    // Callbacks are called in the order they were registered.
     int Register_PumpWork_TS (
         PumpWorkCallback handler,
         void* cls, // intended to be the 'this' pointer when registering a static method in a class
@@ -1752,6 +1755,10 @@ class DaemonCore : public Service
       #endif
 	   stats_entry_abs<int> UdpQueueDepth;  // Unread bytes for the UDP command port 
 
+	   stats_entry_abs<int> SessionsRestored;               // sessions loaded from SEC_SESSION_CACHE_FILE at startup
+	   stats_entry_recent<int> SessionsResumedAfterRestart; // restored sessions that a peer resumed
+	   stats_entry_recent<int> SessionsNotFound;            // requests to resume a session we do not have
+
 		
        stats_entry_recent<Probe> PumpCycle;   // count of pump cycles plus sum of cycle time with min/max/avg/std 
        stats_entry_sum_ema_rate<int> Commands;
@@ -2031,6 +2038,11 @@ class DaemonCore : public Service
 	int               nPendingSockets; // number of sockets waiting on timers or any other callbacks
 	std::vector<SockEnt> sockTable; // socket table; grows dynamically if needed
 
+		// the Selector of the Driver() loop when it keeps epoll registrations, so
+		// that canceled sockets and pipes can be removed from it.  NULL otherwise.
+	Selector * m_driver_selector {nullptr};
+	void ForgetSelectorFd(int fd);
+
 		// number of file descriptors in use past which we should start
 		// avoiding the creation of new persistent sockets.  Do not use
 		// this value directly.  Call FileDescriptorSafetyLimit().
@@ -2164,8 +2176,15 @@ class DaemonCore : public Service
     __declspec(align(MEMORY_ALLOCATION_ALIGNMENT))
     SLIST_HEADER        PumpWorkHead; // list head for async PumpWorkCallback items.
 #else
-    // implement for non windows?
+    struct PumpWorkItem
+    {
+        PumpWorkCallback callback;
+        void *           cls;
+        void *           data;
+    };
 
+    std::mutex                PumpWorkMutex;
+    std::vector<PumpWorkItem> PumpWorkQueue; // guarded by PumpWorkMutex
 #endif
     int  DoPumpWork(); // call on main thread to handle all of work in the PumpWork list, returns number of callbacks handled
             
@@ -33,6 +33,9 @@
 #include "dc_service.h"
 #include "condor_timeslice.h"
 
+#include <set>
+#include <unordered_map>
+
 #ifdef WIN32
 #include <time.h>
 #else
@@ -83,7 +86,7 @@ struct tagTimer {
     /** Not_Yet_Documented */ TimerHandler             handler;
     /** Not_Yet_Documented */ TimerHandlercpp          handlercpp;
     /** Not_Yet_Documented */ class Service*    service; 
-    /** Not_Yet_Documented */ struct tagTimer*  next;
+    /** order of insertion, breaks ties in when */ uint64_t seq;
     /** Not_Yet_Documented */ char*             event_descrip;
     /** Not_Yet_Documented */ void*             data_ptr;
     /** Not_Yet_Documented */ Timeslice *       timeslice;
@@ -251,19 +254,35 @@ class TimerManager
                   unsigned   period          =  0,
 				  const Timeslice *timeslice = NULL);
 
-	void RemoveTimer( Timer *timer, Timer *prev );
+	void RemoveTimer( Timer *timer );
 	void InsertTimer( Timer *new_timer );
 	void DeleteTimer( Timer *timer );
 
 	/*
 	  @param id The id of the timer to find
-	  @param prev If not NULL, this will be set to previous timer in list
 	  @return pointer to timer with specified id or NULL if not found
 	 */
-	Timer *GetTimer( int id, Timer **prev );
-
-    Timer*  timer_list;
-	Timer*  list_tail;
+	Timer *GetTimer( int id );
+
+	// the soonest timer, or NULL if there are no timers
+	Timer *FirstTimer() const { return timer_list.empty() ? NULL : *timer_list.begin(); }
+
+	// Timers are ordered on "when", timers with the same "when" are ordered
+	// by when they were inserted, so timers that constantly reset themselves
+	// to zero take turns.
+	struct TimerOrder {
+		bool operator()(const Timer *a, const Timer *b) const {
+			if (a->when != b->when) { return a->when < b->when; }
+			return a->seq < b->seq;
+		}
+	};
+
+	// The timers sorted by TimerOrder, and indexed by id, so that inserting,
+	// resetting and cancelling a timer is O(log n) in the number of timers.
+	// A timer's when and seq must not change while it is in timer_list.
+	std::set<Timer*, TimerOrder> timer_list;
+	std::unordered_map<int, Timer*> timer_index;
+	uint64_t timer_seq;
     int     timer_ids;
     Timer*  in_timeout;
     bool    did_reset;
@@ -36,6 +36,7 @@
 #include "ipv6_hostname.h"
 #include "daemon_command.h"
 #include "condor_base64.h"
+#include "condor_auth_offload.h"
 
 
 static unsigned int ZZZZZ = 0;
@@ -43,6 +44,20 @@ static int ZZZ_always_increase() {
 	return ZZZZZ++;
 }
 
+// Count the lookups of sessions that peers ask to resume.  The first
+// resumption of a session restored from SEC_SESSION_CACHE_FILE is counted
+// as a session that was saved from having to authenticate again.
+static void
+count_session_lookup(KeyCacheEntry *session)
+{
+	if ( ! session) {
+		daemonCore->dc_stats.SessionsNotFound += 1;
+	} else if (session->getRestoredFlag()) {
+		session->setRestoredFlag(false);
+		daemonCore->dc_stats.SessionsResumedAfterRestart += 1;
+	}
+}
+
 const std::string DaemonCommandProtocol::WaitForSocketDataString = "DaemonCommandProtocol::WaitForSocketData";
 
 DaemonCommandProtocol::DaemonCommandProtocol( Stream * sock, bool is_command_sock, bool isSharedPortLoopback ) :
@@ -95,6 +110,7 @@ DaemonCommandProtocol::DaemonCommandProtocol( Stream * sock, bool is_command_soc
 
 DaemonCommandProtocol::~DaemonCommandProtocol()
 {
+	AuthOffloadCancel(m_offload_job);
 	if (m_errstack) {
 		delete m_errstack;
 		m_errstack = NULL;
@@ -226,6 +242,33 @@ DaemonCommandProtocol::SocketCallback( Stream *stream )
 	return rc;
 }
 
+// While authenticating, wait either for data on the socket or for a step
+// that is running on the authentication threads.
+DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::WaitForAuthentication()
+{
+	ReliSock *rsock = dynamic_cast<ReliSock *>(m_sock);
+	if( rsock && rsock->isAuthenticationOffloaded() ) {
+		condor_gettimestamp( m_async_waiting_start_time );
+		return CommandProtocolInProgress;
+	}
+	return WaitForSocketData();
+}
+
+// This function is called on the main thread when work we gave to the
+// authentication threads is done.
+void
+DaemonCommandProtocol::OffloadCallback()
+{
+	struct timeval async_waiting_stop_time;
+	condor_gettimestamp( async_waiting_stop_time );
+	m_async_waiting_time += timersub_double( async_waiting_stop_time, m_async_waiting_start_time );
+
+	m_offload_job.reset();
+
+		// nobody is waiting for the result; finalize() cleans up
+	doProtocol();
+}
+
 // This is the first thing we do on an incoming TCP command socket.
 // Once this function is finished, m_sock will point to the socket
 // from which we should read the command.
@@ -298,6 +341,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::AcceptUDPReq
 			auto sess_itr = m_sec_man->session_cache->find(sess_id);
 			if (sess_itr == m_sec_man->session_cache->end()) {
 				dprintf ( D_ERROR, "DC_AUTHENTICATE: session %s NOT FOUND; this session was requested by %s with return address %s\n", sess_id, m_sock->peer_description(), return_address_ss ? return_address_ss : "(none)");
+				count_session_lookup(nullptr);
 				// no session... we outta here!
 
 				// but first, we should be nice and send a message back to
@@ -316,6 +360,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::AcceptUDPReq
 				session = &sess_itr->second;
 			}
 
+			count_session_lookup(session);
 			session->renewLease();
 
 			if (!session->key()) {
@@ -393,6 +438,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::AcceptUDPReq
 			auto sess_itr = m_sec_man->session_cache->find(sess_id);
 			if (sess_itr == m_sec_man->session_cache->end()) {
 				dprintf ( D_ERROR, "DC_AUTHENTICATE: session %s NOT FOUND; this session was requested by %s with return address %s\n", sess_id, m_sock->peer_description(), return_address_ss ? return_address_ss : "(none)");
+				count_session_lookup(nullptr);
 				// no session... we outta here!
 
 				// but first, send a message to whoever provided us with incorrect session id
@@ -410,6 +456,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::AcceptUDPReq
 				session = &sess_itr->second;
 			}
 
+			count_session_lookup(session);
 			session->renewLease();
 
 			if (!session->key()) {
@@ -733,6 +780,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::ReadCommand(
 					m_auth_info.LookupString(ATTR_SEC_SERVER_COMMAND_SOCK, return_addr);
 					dprintf (D_ERROR, "DC_AUTHENTICATE: attempt to open "
 					         "invalid session %s, failing; this session was requested by %s with return address %s\n", m_sid.c_str(), m_sock->peer_description(), return_addr.empty() ? "(none)" : return_addr.c_str());
+					count_session_lookup(nullptr);
 					if( !strncmp( m_sid.c_str(), "family:", strlen("family:") ) ) {
 						dprintf(D_ERROR, "  The remote daemon thinks that we are in the same family of Condor daemon processes as it, but I don't recognize its family security session.\n");
 						dprintf(D_ERROR, "  If we are in the same family of processes, you may need to change how the configuration parameter SEC_USE_FAMILY_SESSION is set.\n");
@@ -793,6 +841,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::ReadCommand(
 					}
 				}
 
+				count_session_lookup(session);
 				session->renewLease();
 
 				// For a non-negotiated session, remember the version of
@@ -1191,13 +1240,17 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::Authenticate
 
 	char *method_used = NULL;
 	m_sock->setPolicyAd(*m_policy);
+	ReliSock *rsock = dynamic_cast<ReliSock *>(m_sock);
+	if( m_nonblocking && rsock ) {
+		rsock->setAuthenticationOffloadCallback([this]() { OffloadCallback(); });
+	}
 	int auth_success = m_sock->authenticate(m_key, auth_methods.c_str(), m_errstack, auth_timeout, m_nonblocking, &method_used);
 	m_sock->getPolicyAd(*m_policy);
 
 	if (auth_success == 2) {
 		m_state = CommandProtocolAuthenticateContinue;
 		dprintf(D_SECURITY, "Will return to DC because authentication is incomplete.\n");
-		return WaitForSocketData();
+		return WaitForAuthentication();
 	}
         return AuthenticateFinish(auth_success, method_used);
 }
@@ -1210,7 +1263,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::Authenticate
 	int auth_result = m_sock->authenticate_continue(m_errstack, true, &method_used);
 	if (auth_result == 2) {
 		dprintf(D_SECURITY, "Will return to DC to continue authentication..\n");
-		return WaitForSocketData();
+		return WaitForAuthentication();
 	}
 	return AuthenticateFinish(auth_result, method_used);
 }
@@ -1219,6 +1272,12 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::Authenticate
 {
 	dprintf( D_DAEMONCORE, "DAEMONCORE: AuthenticateFinish(%i, %s)\n", auth_success, method_used?method_used:"(no authentication)");
 
+		// the handler may keep the socket after we are gone
+	ReliSock *rsock = dynamic_cast<ReliSock *>(m_sock);
+	if( rsock ) {
+		rsock->setAuthenticationOffloadCallback(nullptr);
+	}
+
 	if ( method_used ) {
 		m_policy->Assign(ATTR_SEC_AUTHENTICATION_METHODS, method_used);
 
@@ -1302,7 +1361,7 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::EnableCrypto
 	dprintf( D_DAEMONCORE, "DAEMONCORE: EnableCrypto()\n");
 
 	// If we're doing ECDH, derive the session key now
-	if (m_keyexchange) {
+	if (m_keyexchange || m_derivation) {
 		std::string crypto_method;
 		if (!m_policy->LookupString(ATTR_SEC_CRYPTO_METHODS, crypto_method)) {
 			dprintf ( D_ERROR, "DC_AUTHENTICATE: No crypto methods enabled for request from %s.\n", m_sock->peer_description() );
@@ -1311,17 +1370,34 @@ DaemonCommandProtocol::CommandProtocolResult DaemonCommandProtocol::EnableCrypto
 		}
 		Protocol method = SecMan::getCryptProtocolNameToEnum(crypto_method.c_str());
 		size_t keylen = method == CONDOR_AESGCM ? SEC_SESSION_KEY_LENGTH_V9 : SEC_SESSION_KEY_LENGTH_OLD;
-		std::unique_ptr<unsigned char, decltype(&free)> rbuf(
-			static_cast<unsigned char *>(malloc(keylen)),
-			&free);
-		if (!SecMan::FinishKeyExchange(std::move(m_keyexchange), m_peer_pubkey_encoded.c_str(), rbuf.get(), keylen, m_errstack)) {
-			dprintf(D_ERROR, "DC_AUTHENTICATE: Failed to generate a symmetric key for session with %s: %s.\n", m_sock->peer_description(), m_errstack->getFullText().c_str());
+		if (!m_derivation) {
+			m_derivation = std::make_shared<KeyDerivation>();
+			m_derivation->m_keyexchange = std::move(m_keyexchange);
+			m_derivation->m_peer_pubkey_encoded = m_peer_pubkey_encoded;
+			m_derivation->m_key.resize(keylen);
+			auto derive = [derivation = m_derivation]() {
+				if (!SecMan::FinishKeyExchange(std::move(derivation->m_keyexchange), derivation->m_peer_pubkey_encoded.c_str(), derivation->m_key.data(), derivation->m_key.size(), &derivation->m_errstack)) {
+					derivation->m_key.clear();
+				}
+			};
+			if (m_nonblocking) {
+				m_offload_job = AuthOffloadRun("ECDH", derive, [this]() { OffloadCallback(); });
+			}
+			if (m_offload_job) {
+				dprintf(D_SECURITY|D_VERBOSE, "Will return to DC while the session key is derived.\n");
+				condor_gettimestamp( m_async_waiting_start_time );
+				return CommandProtocolInProgress;
+			}
+			derive();
+		}
+		if (m_derivation->m_key.size() != keylen) {
+			dprintf(D_ERROR, "DC_AUTHENTICATE: Failed to generate a symmetric key for session with %s: %s.\n", m_sock->peer_description(), m_derivation->m_errstack.getFullText().c_str());
 			m_result = false;
 			return CommandProtocolFinished;
 		}
 
 		dprintf (D_SECURITY, "DC_AUTHENTICATE: generating %s key for session %s...\n", crypto_method.c_str(), m_sid.c_str());
-		m_key = new KeyInfo(rbuf.get(), keylen, method, 0);
+		m_key = new KeyInfo(m_derivation->m_key.data(), keylen, method, 0);
 	}
 
 	// We must configure encryption before integrity on the socket
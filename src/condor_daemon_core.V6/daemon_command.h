@@ -24,6 +24,8 @@
 #include <string>
 #include <vector>
 
+class AuthOffloadJob;
+
 class DaemonCommandProtocol: Service {
 
 	friend class DaemonCore;
@@ -89,6 +91,18 @@ private:
 	std::string m_peer_pubkey_encoded;
 		// Our keypair for key exchange.
 	std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> m_keyexchange{nullptr, &EVP_PKEY_free};
+		// The derivation of the session key from m_keyexchange, which may
+		// be done on the authentication threads.  The work shares it with
+		// us, so that it can finish after we are gone.  The key is empty if
+		// the derivation failed.
+	struct KeyDerivation {
+		std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> m_keyexchange{nullptr, &EVP_PKEY_free};
+		std::string m_peer_pubkey_encoded;
+		std::vector<unsigned char> m_key;
+		CondorError m_errstack;
+	};
+	std::shared_ptr<KeyDerivation> m_derivation;
+	std::shared_ptr<AuthOffloadJob> m_offload_job;
 
 	bool m_new_session;
 	SecMan::sec_feat_act m_will_enable_encryption;
@@ -107,6 +121,8 @@ private:
 	CommandProtocolResult ExecCommand();
 	CommandProtocolResult WaitForSocketData();
 	int SocketCallback( Stream *stream );
+	CommandProtocolResult WaitForAuthentication();
+	void OffloadCallback();
 	int finalize();
 };
 
@@ -766,10 +766,14 @@ int DaemonCore::Register_PumpWork_TS(PumpWorkCallback handler, void* cls, void*
 	}
 	return 1;
 #else
-	// implement for non-windows?
-	dprintf(D_ERROR, "Register_PumpWork_TS(%p, %p, %p) called, but has not (yet) been implemented on this platform\n",
-			handler, cls, data);
-	return -1;
+	{
+		std::lock_guard<std::mutex> guard(PumpWorkMutex);
+		PumpWorkQueue.push_back(PumpWorkItem{handler, cls, data});
+	}
+	// we don't know which thread we are on, but waking up select
+	// from the main thread just costs an extra trip around the pump
+	Do_Wake_up_select();
+	return 1;
 #endif
 }
 
@@ -809,8 +813,21 @@ int DaemonCore::DoPumpWork() {
 	}
 	return citems;
 #else
-	// implement for non-windows?
-	return 0;
+	std::vector<PumpWorkItem> work;
+	{
+		std::lock_guard<std::mutex> guard(PumpWorkMutex);
+		work.swap(PumpWorkQueue);
+	}
+	if (work.empty()) {
+		return 0;
+	}
+	dprintf(D_DAEMONCORE, "Processing %d pump work item(s)\n", (int)work.size());
+
+	// handlers may register more work, that will be handled the next time around
+	for (auto & item : work) {
+		item.callback(item.cls, item.data);
+	}
+	return (int)work.size();
 #endif
 }
 
@@ -1761,6 +1778,9 @@ int DaemonCore::Cancel_Socket( Stream* insock, void *prev_entry)
 	if ( curr_dataptr == &( sockTable[i].data_ptr) )
 		curr_dataptr = NULL;
 
+	// the caller is likely to close the socket, and its fd may be reused right away
+	ForgetSelectorFd( sockTable[i].iosock->get_file_desc() );
+
 	if (sockTable[i].servicing_tid == 0 ||
 		sockTable[i].servicing_tid == CondorThreads::get_handle()->get_tid() || prev_entry)
 	{
@@ -2160,6 +2180,10 @@ int DaemonCore::Cancel_Pipe( int pipe_end )
 			"Cancel_Pipe: cancelled pipe end %d <%s> (entry=%zu)\n",
 			pipe_end,pipeTable[i].pipe_descrip, i );
 
+#ifndef WIN32
+	ForgetSelectorFd( pipeHandleTable[index] );
+#endif
+
 	// mark entry unused
 	pipeTable[i].index = -1;
 	free(pipeTable[i].pipe_descrip );
@@ -3124,6 +3148,14 @@ DaemonCore::Verify(char const *command_descrip, DCpermission perm, const Sock &s
 	return Verify(command_descrip, perm, sock.peer_addr(), fqu, log_level);
 }
 
+void
+DaemonCore::ForgetSelectorFd(int fd)
+{
+	if ( m_driver_selector ) {
+		m_driver_selector->forget_fd( fd );
+	}
+}
+
 bool
 DaemonCore::Wake_up_select()
 {
@@ -3309,6 +3341,13 @@ void DaemonCore::Driver()
 		dprintf( D_ALWAYS, "Done with stdout & stderr tests\n" );
 	}
 
+	if ( param_boolean( "DAEMON_CORE_USE_EPOLL", false ) ) {
+		if ( selector.use_epoll() ) {
+			dprintf( D_ALWAYS, "DaemonCore: using epoll to wait for sockets and pipes\n" );
+			m_driver_selector = &selector;
+		}
+	}
+
 	double runtime = _condor_debug_get_time_double();
 	double group_runtime = runtime;
     double pump_cycle_begin_time = runtime;
@@ -3396,6 +3435,16 @@ void DaemonCore::Driver()
 		if ( sent_signal == TRUE ) {
 			timeout = 0;
 		}
+#ifndef WIN32
+		// pump work registered after DoPumpWork() above may have had its
+		// wake up drained from the async_pipe already, don't wait for it.
+		{
+			std::lock_guard<std::mutex> guard(PumpWorkMutex);
+			if ( ! PumpWorkQueue.empty()) {
+				timeout = 0;
+			}
+		}
+#endif
 		if ( timeout < 0 ) {
 			timeout = TIME_T_NEVER;
 		}
@@ -3408,6 +3457,8 @@ void DaemonCore::Driver()
 		// Setup what socket descriptors to select on.  We recompute this
 		// every time because 1) some timeout handler may have removed/added
 		// sockets, and 2) it ain't that expensive....
+		// When using epoll, this just notes what we want, and the selector
+		// only tells the kernel about sockets and pipes that changed.
 		selector.reset();
 		min_deadline = 0;
 		for (auto & sockEnt : sockTable) {
@@ -3434,6 +3485,9 @@ void DaemonCore::Driver()
 						// connect is ready to write.  when connect
 						// is ready, select will set the writefd set
 						// on success, or the exceptfd set on failure.
+						// a connect that is retried may get a new fd with the same
+						// number, so don't trust an existing epoll registration.
+					ForgetSelectorFd( sockEnt.iosock->get_file_desc() );
 					selector.add_fd( sockEnt.iosock->get_file_desc(), Selector::IO_WRITE );
 					selector.add_fd( sockEnt.iosock->get_file_desc(), Selector::IO_EXCEPT );
 				} else {
@@ -3779,12 +3833,14 @@ void DaemonCore::Driver()
 
 #else
 							// UNIX
+							// use a separate selector so that the registrations
+							// of the main selector are kept.
 							int pipefd = pipeHandleTable[pipeTable[i].index];
-							selector.reset();
-							selector.set_timeout( 0 );
-							selector.add_fd( pipefd, Selector::IO_READ );
-							selector.execute();
-							if ( selector.timed_out() ) {
+							Selector recheck;
+							recheck.set_timeout( 0 );
+							recheck.add_fd( pipefd, Selector::IO_READ );
+							recheck.execute();
+							if ( recheck.timed_out() ) {
 								// nothing available, try the next entry...
 								continue;
 							}
@@ -3883,13 +3939,13 @@ void DaemonCore::Driver()
 							// read on the pipe could block?  to prevent this, we need
 							// to check one more time to make certain the pipe is ready
 							// for reading.
-							selector.reset();
-							selector.set_timeout( 0 );// set timeout for a poll
-							selector.add_fd( sockTable[i].iosock->get_file_desc(),
+							Selector recheck;
+							recheck.set_timeout( 0 );// set timeout for a poll
+							recheck.add_fd( sockTable[i].iosock->get_file_desc(),
 											 Selector::IO_READ );
 
-							selector.execute();
-							if ( selector.timed_out() ) {
+							recheck.execute();
+							if ( recheck.timed_out() ) {
 								// nothing available, try the next entry...
 								continue;
 							}
@@ -10843,6 +10899,12 @@ DaemonCore::initCollectorList() {
 		// this knob to true is how an admin tells us not to worry about older collectors.
 		m_collector_list->checkVersionBeforeSendingUpdates(false);
 	}
+
+	// Startd slot ads can be sent as deltas against the previous update of the slot.
+	// only UPDATE_STARTD_AD with a private ad is affected, so this is harmless for other daemons
+	if (m_collector_list) {
+		m_collector_list->useDeltaUpdates(param_integer("STARTD_MAX_DELTA_UPDATES", 0, 0));
+	}
 }
 
 
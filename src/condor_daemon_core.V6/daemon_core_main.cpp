@@ -45,9 +45,12 @@
 #include "dc_collector.h"
 #include "token_utils.h"
 #include "condor_scitokens.h"
+#include "KeyCacheFile.h"
+#include "condor_auth_offload.h"
 
 #include <chrono>
 #include <algorithm>
+#include <thread>
 
 #ifdef LINUX
 #include <sys/prctl.h>
@@ -686,11 +689,93 @@ check_parent(int /* tid */)
 }
 #endif
 
+// The pid of the process that loaded SEC_SESSION_CACHE_FILE.  Only that
+// process saves it, never a forked child.
+static pid_t session_cache_file_pid = 0;
+
+// Restore the incoming sessions saved by a previous run of this daemon
+static void
+load_session_cache_file()
+{
+	std::string file, key_file;
+	if ( ! param(file, "SEC_SESSION_CACHE_FILE") || ! param(key_file, "SEC_SESSION_CACHE_KEY_FILE")) {
+		return;
+	}
+	session_cache_file_pid = getpid();
+	int restored = LoadKeyCacheFile(SecMan::m_default_session_cache, file.c_str(), key_file.c_str());
+	if (restored > 0) {
+		daemonCore->dc_stats.SessionsRestored = restored;
+	}
+}
+
+// A save of SEC_SESSION_CACHE_FILE that is being encrypted and written on
+// session_cache_thread.  The sessions are serialized on the main thread
+// first, since the cache changes under it.  The thread is not a static
+// object, so that a forked child doesn't terminate when it exits.
+static std::unique_ptr<KeyCacheFileWriter> session_cache_writer;
+static std::thread *session_cache_thread = nullptr;
+
+// Put the file that session_cache_thread wrote in place
+static void
+finish_session_cache_file()
+{
+	if (session_cache_thread) {
+		session_cache_thread->join();
+		delete session_cache_thread;
+		session_cache_thread = nullptr;
+	}
+	if (session_cache_writer) {
+		session_cache_writer->Finish();
+		session_cache_writer.reset();
+	}
+}
+
+// Save the incoming sessions, so that peers can resume them after we restart.
+// Unless we are exiting, the file is encrypted and written on another thread.
+static void
+save_session_cache_file(bool exiting)
+{
+	std::string file, key_file;
+	if (session_cache_file_pid != getpid() ||
+		! param(file, "SEC_SESSION_CACHE_FILE") || ! param(key_file, "SEC_SESSION_CACHE_KEY_FILE")) {
+		return;
+	}
+	if (session_cache_writer) {
+		if ( ! exiting) {
+			dprintf(D_SECURITY, "Not saving %s, the last save has not finished\n", file.c_str());
+			return;
+		}
+		finish_session_cache_file();
+	}
+
+	long long max_size = param_integer("SEC_SESSION_CACHE_FILE_MAX_SIZE", 64 * 1024 * 1024, 0);
+	auto writer = std::make_unique<KeyCacheFileWriter>();
+	if ( ! writer->Prepare(SecMan::m_default_session_cache, file.c_str(), key_file.c_str(), (size_t)max_size)) {
+		return;
+	}
+	if (exiting) {
+		writer->Write();
+		writer->Finish();
+		return;
+	}
+
+	dprintf_make_thread_safe();
+	session_cache_writer = std::move(writer);
+	session_cache_thread = new std::thread([writer = session_cache_writer.get()]() {
+		writer->Write();
+		daemonCore->Register_PumpWork_TS([](void *, void *) -> int {
+			finish_session_cache_file();
+			return 0;
+		}, nullptr, nullptr);
+	});
+}
+
 // This function clears expired sessions from the cache
 void
 check_session_cache(int /* tid */)
 {
 	daemonCore->getSecMan()->invalidateExpiredCache();
+	save_session_cache_file(false);
 }
 
 bool global_dc_set_cookie(int len, unsigned char* data) {
@@ -830,6 +915,7 @@ DC_Exit( int status, const char *shutdown_program )
 {
 	if( daemonCore ) {
 		daemonCore->kill_immediate_children();
+		save_session_cache_file(true);
 	}
 
 		// First, delete any files we might have created, like the
@@ -3179,6 +3265,9 @@ dc_reconfig()
 		// do this first in case anything else depends on DNS
 	daemonCore->refreshDNS();
 
+		// the authentication threads may be calling param()
+	AuthOffloadDrain();
+
 		// Actually re-read the files...  Added by Derek Wright on
 		// 12/8/97 (long after this function was first written... 
 		// nice goin', Todd).  *grin*
@@ -4158,6 +4247,7 @@ int dc_main( int argc, char** argv )
 	daemonCore->Register_Timer( 0,
 				dc_touch_lock_files, "dc_touch_lock_files" );
 
+	load_session_cache_file();
 	daemonCore->Register_Timer( 0, 5 * 60,
 				check_session_cache, "check_session_cache" );
 
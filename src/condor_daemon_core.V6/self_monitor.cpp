@@ -238,6 +238,9 @@ void DaemonCore::Stats::Init(bool enable)
    STATS_POOL_ADD_VAL(Pool, "DC", UdpQueueDepth,  IF_BASICPUB);
    STATS_POOL_PUB_PEAK(Pool, "DC", UdpQueueDepth,  IF_BASICPUB);
    DC_STATS_ADD_DEF(Pool, Commands, IF_BASICPUB);
+   STATS_POOL_ADD_VAL(Pool, "DC", SessionsRestored, IF_BASICPUB);
+   DC_STATS_ADD_RECENT(Pool, SessionsResumedAfterRestart, IF_BASICPUB);
+   DC_STATS_ADD_RECENT(Pool, SessionsNotFound, IF_BASICPUB);
 
    // insert entries that are stored in helper modules
    //
@@ -0,0 +1,230 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the order in which the TimerManager fires timers
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "subsystem_info.h"
+#include "condor_daemon_core.h"
+
+#include <functional>
+#include <map>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static TimerManager & timers() { return TimerManager::GetTimerManager(); }
+
+// the names of the timers that fired, in order, as "a,b,..."
+static std::string fired;
+static std::map<int, std::string> names;
+// what a timer does in its handler
+static std::map<int, std::function<void()>> actions;
+
+static void handler(int id)
+{
+	if ( ! fired.empty()) fired += ",";
+	fired += names[id];
+	auto it = actions.find(id);
+	if (it != actions.end()) {
+		it->second();
+	}
+}
+
+static int newTimer(const char * name, unsigned deltawhen, unsigned period = 0)
+{
+	int id = timers().NewTimer(deltawhen, handler, name, period);
+	names[id] = name;
+	return id;
+}
+
+static std::string timeout()
+{
+	fired.clear();
+	timers().Timeout();
+	return fired;
+}
+
+static void cleanup()
+{
+	timers().CancelAllTimers();
+	names.clear();
+	actions.clear();
+	fired.clear();
+}
+
+// timers that are due at the same time fire in the order that they were
+// added, and a timer that is reset goes behind the others that are due
+static void test_equal_time_order()
+{
+	int a = newTimer("a", 0);
+	newTimer("b", 0);
+	newTimer("c", 0);
+	timers().ResetTimer(a, 0);
+	REQUIRE(timeout() == "b,c,a");
+	REQUIRE(timeout() == "");
+
+	// periodic timers that reset themselves to 0 take turns
+	int x = newTimer("x", 0, 100);
+	int y = newTimer("y", 0, 100);
+	actions[x] = [x] { timers().ResetTimer(x, 0, 100); };
+	actions[y] = [y] { timers().ResetTimer(y, 0, 100); };
+	REQUIRE(timeout() == "x,y");
+	REQUIRE(timeout() == "x,y");
+	actions[x] = [] {};
+	REQUIRE(timeout() == "x,y");
+	// x was not reset, so it went back to its period
+	REQUIRE(timeout() == "y");
+	REQUIRE(timers().GetNextRuntime(x) >= time(nullptr) + 99);
+	cleanup();
+}
+
+// a handler that resets a timer, either its own or one that has not fired yet
+static void test_reset_during_dispatch()
+{
+	int a = newTimer("a", 0);
+	int b = newTimer("b", 0);
+	int c = newTimer("c", 0);
+	actions[a] = [a, b] {
+		timers().ResetTimer(a, 1000);
+		timers().ResetTimer(b, 1000);
+	};
+	REQUIRE(timeout() == "a,c");
+	// a was a one time timer, but it was reset, so it is still there
+	time_t now = time(nullptr);
+	REQUIRE(timers().GetNextRuntime(a) >= now + 999);
+	REQUIRE(timers().GetNextRuntime(b) >= now + 999);
+	REQUIRE(timers().GetNextRuntime(c) == 0);
+	REQUIRE(timeout() == "");
+
+	// a timer that is made due by a handler waits for the next Timeout
+	int d = newTimer("d", 0);
+	actions[d] = [b] { timers().ResetTimer(b, 0); };
+	REQUIRE(timeout() == "d");
+	REQUIRE(timeout() == "b");
+	cleanup();
+}
+
+// a handler that cancels a timer, either its own or one that has not fired yet
+static void test_cancel_during_dispatch()
+{
+	int a = newTimer("a", 0, 10);
+	int b = newTimer("b", 0, 10);
+	int c = newTimer("c", 0);
+	actions[a] = [a, b] {
+		REQUIRE(timers().CancelTimer(a) == 0);
+		REQUIRE(timers().CancelTimer(b) == 0);
+	};
+	REQUIRE(timeout() == "a,c");
+	REQUIRE(timers().GetNextRuntime(a) == 0);
+	REQUIRE(timers().GetNextRuntime(b) == 0);
+	REQUIRE(timers().CancelTimer(a) == -1);
+	REQUIRE(timers().CancelTimer(b) == -1);
+
+	// a timer added by a handler waits for the next Timeout
+	int d = newTimer("d", 0);
+	actions[d] = [] { newTimer("e", 0); };
+	REQUIRE(timeout() == "d");
+	REQUIRE(timeout() == "e");
+
+	// cancelling everything from a handler
+	newTimer("f", 0);
+	int g = newTimer("g", 0);
+	newTimer("h", 0);
+	actions[g] = [] { timers().CancelAllTimers(); };
+	REQUIRE(timeout() == "f,g");
+	REQUIRE(timeout() == "");
+	cleanup();
+}
+
+// timers whose interval comes from a Timeslice
+static void test_timeslice_timers()
+{
+	Timeslice ts;
+	ts.setInitialInterval(0);
+	ts.setDefaultInterval(100);
+	int t = timers().NewTimer(ts, handler, "t");
+	names[t] = "t";
+	int u = newTimer("u", 0);
+	REQUIRE(timeout() == "t,u");
+	time_t now = time(nullptr);
+	REQUIRE(timers().GetNextRuntime(t) >= now + 99 && timers().GetNextRuntime(t) <= now + 101);
+
+	// ResetTimer can't change a timeslice timer
+	REQUIRE(timers().ResetTimer(t, 0) == 0);
+	REQUIRE(timers().GetNextRuntime(t) >= now + 99);
+	Timeslice got;
+	REQUIRE(timers().GetTimerTimeslice(t, got) && got.getDefaultInterval() == 100);
+	REQUIRE( ! timers().GetTimerTimeslice(u, got));
+
+	// a new timeslice that has never run is due now
+	Timeslice soon;
+	soon.setDefaultInterval(50);
+	REQUIRE(timers().ResetTimerTimeslice(t, soon));
+	REQUIRE(timers().GetNextRuntime(t) <= time(nullptr) + 1);
+	int v = newTimer("v", 0);
+	REQUIRE(timeout() == "t,v");
+	REQUIRE(timers().GetNextRuntime(v) == 0);
+	now = time(nullptr);
+	REQUIRE(timers().GetNextRuntime(t) >= now + 49 && timers().GetNextRuntime(t) <= now + 51);
+
+	// a timeslice timer that resets its own timeslice from its handler
+	Timeslice again;
+	again.setInitialInterval(0);
+	again.setDefaultInterval(1000);
+	REQUIRE(timers().ResetTimerTimeslice(t, again));
+	actions[t] = [t] {
+		Timeslice later;
+		later.setInitialInterval(500);
+		timers().ResetTimerTimeslice(t, later);
+	};
+	REQUIRE(timeout() == "t");
+	now = time(nullptr);
+	REQUIRE(timers().GetNextRuntime(t) >= now + 499 && timers().GetNextRuntime(t) <= now + 501);
+	REQUIRE(timeout() == "");
+	cleanup();
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+	// Timeout() checks the priv state through daemonCore after each handler
+	daemonCore = new DaemonCore();
+
+	test_equal_time_order();
+	test_reset_during_dispatch();
+	test_cancel_during_dispatch();
+	test_timeslice_timers();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
@@ -50,8 +50,7 @@ TimerManager::TimerManager()
 	{
 		EXCEPT("TimerManager object exists!");
 	}
-	timer_list = NULL;
-	list_tail = NULL;
+	timer_seq = 0;
 	timer_ids = 0;
 	in_timeout = NULL;
 	_t = this; 
@@ -182,7 +181,7 @@ bool TimerManager::ResetTimerTimeslice(int id, Timeslice const &new_timeslice)
 
 bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if( !timer_ptr || !timer_ptr->timeslice ) {
 		return false;
 	}
@@ -192,7 +191,7 @@ bool TimerManager::GetTimerTimeslice(int id, Timeslice &timeslice)
 
 time_t TimerManager::GetNextRuntime(int id)
 {
-	Timer *timer_ptr = GetTimer( id, NULL );
+	Timer *timer_ptr = GetTimer( id );
 	if (!timer_ptr) { return false; }
 
 	return timer_ptr->when;
@@ -202,26 +201,28 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 							 Timeslice const *new_timeslice)
 {
 	Timer*			timer_ptr;
-	Timer*			trail_ptr;
 
 	dprintf( D_DAEMONCORE,
 			 "In reset_timer(), id=%d, time=%d, period=%d\n",id,when,period);
-	if (timer_list == NULL) {
+	if (timer_list.empty()) {
 		dprintf( D_DAEMONCORE, "Reseting Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
-
+	timer_ptr = GetTimer( id );
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
 		return -1;
 	}
+	if ( !new_timeslice && timer_ptr->timeslice ) {
+		dprintf( D_DAEMONCORE, "Timer %d with timeslice can't be reset\n",
+				 id );
+		return 0;
+	}
+
+	// take the timer out of the list before changing when, the list is sorted on it
+	RemoveTimer( timer_ptr );
+
 	if ( new_timeslice ) {
 		if( timer_ptr->timeslice == NULL ) {
 			timer_ptr->timeslice = new Timeslice( *new_timeslice );
@@ -231,11 +232,6 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 		}
 
 		timer_ptr->when = timer_ptr->timeslice->getNextStartTime();
-	}
-	else if ( timer_ptr->timeslice ) {
-		dprintf( D_DAEMONCORE, "Timer %d with timeslice can't be reset\n",
-				 id );
-		return 0;
 	} else if( recompute_when ) {
 		time_t old_when = timer_ptr->when;
 
@@ -275,7 +271,6 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 	}
 	timer_ptr->period = period;
 
-	RemoveTimer( timer_ptr, trail_ptr );
 	InsertTimer( timer_ptr );
 
 	if ( in_timeout == timer_ptr ) {
@@ -290,27 +285,21 @@ int TimerManager::ResetTimer(int id, unsigned when, unsigned period,
 int TimerManager::CancelTimer(int id)
 {
 	Timer*		timer_ptr;
-	Timer*		trail_ptr;
 
 	dprintf( D_DAEMONCORE, "In cancel_timer(), id=%d\n",id);
-	if (timer_list == NULL) {
+	if (timer_list.empty()) {
 		dprintf( D_DAEMONCORE, "Removing Timer from empty list!\n");
 		return -1;
 	}
 
-	timer_ptr = timer_list;
-	trail_ptr = NULL;
-	while ( timer_ptr && timer_ptr->id != id ) {
-		trail_ptr = timer_ptr;
-		timer_ptr = timer_ptr->next;
-	}
-
+	timer_ptr = GetTimer( id );
 	if ( timer_ptr == NULL ) {
 		dprintf( D_ALWAYS, "Timer %d not found\n",id );
 		return -1;
 	}
 
-	RemoveTimer( timer_ptr, trail_ptr );
+	RemoveTimer( timer_ptr );
+	timer_index.erase( id );
 
 	if ( in_timeout == timer_ptr ) {
 		// We're inside the handler for this timer. Don't delete it,
@@ -326,11 +315,11 @@ int TimerManager::CancelTimer(int id)
 
 void TimerManager::CancelAllTimers()
 {
-	Timer		*timer_ptr;
+	std::set<Timer*, TimerOrder> timers;
+	timers.swap( timer_list );
+	timer_index.clear();
 
-	while( timer_list != NULL ) {
-		timer_ptr = timer_list;
-		timer_list = timer_list->next;
+	for( Timer *timer_ptr : timers ) {
 		if( in_timeout == timer_ptr ) {
 				// We get here if somebody calls exit from inside a timer.
 			did_cancel = true;
@@ -339,8 +328,6 @@ void TimerManager::CancelAllTimers()
 			DeleteTimer( timer_ptr );
 		}
 	}
-	timer_list = NULL;
-	list_tail = NULL;
 }
 
 // Timeout() is called when a select() time out.  Returns number of seconds
@@ -358,10 +345,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	if ( in_timeout != NULL ) {
 		dprintf(D_DAEMONCORE,"DaemonCore Timeout() called and in_timeout is non-NULL\n");
-		if ( timer_list == NULL ) {
+		if ( timer_list.empty() ) {
 			result = 0;
 		} else {
-			result = (timer_list->when) - time(NULL);
+			result = (FirstTimer()->when) - time(NULL);
 		}
 		if ( result < 0 ) {
 			result = 0;
@@ -369,7 +356,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 		return(result);
 	}
 		
-	if (timer_list == NULL) {
+	if (timer_list.empty()) {
 		dprintf( D_DAEMONCORE, "Empty timer list, nothing to do\n" );
 	}
 
@@ -383,12 +370,9 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
     // timer handlers themselves.
     std::unordered_set<int> readyTimerIds;
     if (max_timer_events_per_cycle == INT_MAX) {
-        in_timeout = timer_list;
-        while ((in_timeout != NULL) && (in_timeout->when <= now)) {
-            readyTimerIds.insert(in_timeout->id);
-            in_timeout = in_timeout->next;
+        for (auto it = timer_list.begin(); it != timer_list.end() && (*it)->when <= now; ++it) {
+            readyTimerIds.insert((*it)->id);
         }
-        in_timeout = NULL;
     }
 
 	// loop until all handlers that should have been called by now or before
@@ -399,10 +383,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 	// we make certain we do not call more than "max_fires" handlers in a 
 	// single timeout --- this ensures that timers don't starve out the rest
 	// of daemonCore if a timer handler resets itself to 0.
-	while( (timer_list != NULL) && (timer_list->when <= now ) &&
+	while( !timer_list.empty() && (FirstTimer()->when <= now ) &&
 		   (num_fires < max_timer_events_per_cycle))
 	{
-        in_timeout = timer_list;
+        in_timeout = FirstTimer();
 
         // In this code block, if there is no limit on how many timer handlers we will invoke,
         // we want to skip over timers that got  added or reset by other timer handlers to make
@@ -410,6 +394,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
         // were ready to fire when we first entered Timeout().
         if (max_timer_events_per_cycle == INT_MAX) {
             std::unordered_set<int>::iterator it;
+            auto next = timer_list.begin();
             bool call_handler = false;
             // Skip handlers already invoked or added
             do {
@@ -419,7 +404,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
                     // added or reset by another timer callback.  in this case, skip this timer
                     // callback (we will deal with it next time through the daemoncore loop).
                     dprintf(D_DAEMONCORE, "Timer %d not fired (SKIPPED) cause added\n", in_timeout->id);
-                    in_timeout = in_timeout->next;
+                    in_timeout = (++next != timer_list.end()) ? *next : NULL;
                 }
                 else {
                     // this timer was ready to fire when we first looked at the timer list, so
@@ -432,6 +417,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
             if (!call_handler) {
                 // no timers left that we want to fire at this time, break out of outer while loop
+                in_timeout = NULL;
                 break;
             }
         }  // end of block if max_timer_events_per_cycle == INT_MAX
@@ -505,12 +491,10 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 			// If a new timer was added at a time in the past
 			// (possible when resetting a timeslice timer), then
 			// it may have landed before the timer we just processed,
-			// meaning that we cannot assume prev==NULL in the call
-			// to RemoveTimer() below.
+			// so it is not necessarily still the first timer.
 
-			Timer *prev = NULL;
-			ASSERT( GetTimer(in_timeout->id,&prev) == in_timeout );
-			RemoveTimer( in_timeout, prev );
+			ASSERT( GetTimer(in_timeout->id) == in_timeout );
+			RemoveTimer( in_timeout );
 
 			if ( in_timeout->period > 0 || in_timeout->timeslice ) {
 				in_timeout->period_started = time(NULL);
@@ -528,6 +512,7 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 			} else {
 				// timer is not perodic; it is just a one-time event.  we just called
 				// the handler, so now just delete it. 
+				timer_index.erase( in_timeout->id );
 				DeleteTimer( in_timeout );
 			}
 		}
@@ -536,13 +521,13 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 	// set result to number of seconds until next event.  get an update on the
 	// time from time() in case the handlers we called above took significant time.
-	if ( timer_list == NULL ) {
+	if ( timer_list.empty() ) {
 		// we set result to be -1 so that we do not busy poll.
 		// a -1 return value will tell the DaemonCore:Driver to use select with
 		// no timeout.
 		result = -1;
 	} else {
-		result = (timer_list->when) - time(NULL);
+		result = (FirstTimer()->when) - time(NULL);
 		if (result < 0)
 			result = 0;
 	}
@@ -557,7 +542,6 @@ TimerManager::Timeout(int * pNumFired /*= NULL*/, double * pruntime /*=NULL*/)
 
 void TimerManager::DumpTimerList(int flag, const char* indent)
 {
-	Timer		*timer_ptr;
 	const char	*ptmp;
 
 	// we want to allow flag to be "D_FULLDEBUG | D_DAEMONCORE",
@@ -574,7 +558,7 @@ void TimerManager::DumpTimerList(int flag, const char* indent)
 	dprintf(flag, "\n");
 	dprintf(flag, "%sTimers\n", indent);
 	dprintf(flag, "%s~~~~~~\n", indent);
-	for(timer_ptr = timer_list; timer_ptr != NULL; timer_ptr = timer_ptr->next)
+	for(const Timer *timer_ptr : timer_list)
 	{
 		if ( timer_ptr->event_descrip )
 			ptmp = timer_ptr->event_descrip;
@@ -642,68 +626,26 @@ void TimerManager::Start()
 	}
 }
 
-void TimerManager::RemoveTimer( Timer *timer, Timer *prev )
+void TimerManager::RemoveTimer( Timer *timer )
 {
-	if ( timer == NULL || ( prev && prev->next != timer ) ||
-		 ( !prev && timer != timer_list ) ) {
+	if ( timer == NULL || timer_list.erase( timer ) != 1 ) {
 		EXCEPT( "Bad call to TimerManager::RemoveTimer()!" );
 	}
-
-	if ( timer == timer_list ) {
-		timer_list = timer_list->next;
-	}
-	if ( timer == list_tail ) {
-		list_tail = prev;
-	}
-	if ( prev ) {
-		prev->next = timer->next;
-	}
 }
 
 void TimerManager::InsertTimer( Timer *new_timer )
 {
-	if ( timer_list == NULL ) {
-		// list is empty, place ours in front
-		timer_list = new_timer;
-		list_tail = new_timer;
-		new_timer->next = NULL;
-			// since we have a new first timer, we must wake up select
+	// keep timer_list ordered from soonest to farthest (i.e. sorted on
+	// "when").  Timers with the same "when" are kept in the order they
+	// were inserted -- this makes certain we "round-robin" across
+	// timers that constantly reset themselves to zero.
+	new_timer->seq = timer_seq++;
+	auto it = timer_list.insert( new_timer ).first;
+	timer_index[new_timer->id] = new_timer;
+
+	if ( it == timer_list.begin() ) {
+		// since we have a new first timer, we must wake up select
 		daemonCore->Wake_up_select();
-	} else {
-		// list is not empty, so keep timer_list ordered from soonest to
-		// farthest (i.e. sorted on "when").
-		// Note: when doing the comparisons, we always use "<" instead
-		// of "<=" -- this makes certain we "round-robin" across 
-		// timers that constantly reset themselves to zero.
-		if ( new_timer->when < timer_list->when ) {
-			// make the this new timer first in line
-			new_timer->next = timer_list;
-			timer_list = new_timer;
-			// since we have a new first timer, we must wake up select
-			daemonCore->Wake_up_select();
-		} else if ( new_timer->when == TIME_T_NEVER ) {
-			// Our new timer goes to the very back of the list.
-			new_timer->next = NULL;
-			list_tail->next = new_timer;
-			list_tail = new_timer;
-		} else {
-			Timer* timer_ptr;
-			Timer* trail_ptr = NULL;
-			for (timer_ptr = timer_list; timer_ptr != NULL; 
-				 timer_ptr = timer_ptr->next ) 
-			{
-				if (new_timer->when < timer_ptr->when) {
-					break;
-				}
-				trail_ptr = timer_ptr;
-			}
-			ASSERT( trail_ptr );
-			new_timer->next = timer_ptr;
-			trail_ptr->next = new_timer;
-			if ( trail_ptr == list_tail ) {
-				list_tail = new_timer;
-			}
-		}
 	}
 }
 
@@ -729,31 +671,23 @@ void TimerManager::DeleteTimer( Timer *timer )
 	delete timer;
 }
 
-Timer *TimerManager::GetTimer( int id, Timer **prev )
+Timer *TimerManager::GetTimer( int id )
 {
-	Timer *timer_ptr = timer_list;
-	if( prev ) {
-		*prev = NULL;
+	auto it = timer_index.find( id );
+	if ( it == timer_index.end() ) {
+		return NULL;
 	}
-	while ( timer_ptr && timer_ptr->id != id ) {
-		if( prev ) {
-			*prev = timer_ptr;
-		}
-		timer_ptr = timer_ptr->next;
-	}
-
-	return timer_ptr;
+	return it->second;
 }
 
 
 int
 TimerManager::countTimersByDescription( const char * description ) {
     if( description == NULL ) { return -1; }
-    if( timer_list == NULL ) { return 0; }
+    if( timer_list.empty() ) { return 0; }
 
     int counter = 0;
-	Timer * i = timer_list;
-	for( ; i; i = i->next ) {
+	for( const Timer * i : timer_list ) {
     	if( 0 == strcmp(i->event_descrip, description) ) {
     	    ++counter;
     	}
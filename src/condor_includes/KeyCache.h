@@ -41,12 +41,21 @@ class KeyCacheEntry {
     KeyInfo*              key();
     KeyInfo*              key(Protocol protocol);
     ClassAd*              policy();
+    const ClassAd*        policy() const { return &_policy; }
+    const std::vector<KeyInfo>& keys() const { return _keys; }
     time_t                expiration() const;
+	time_t                lifetimeExpiration() const { return _expiration; }
+	int                   leaseInterval() const { return _lease_interval; }
 	char const *          expirationType() const;
 	void                  setExpiration(time_t new_expiration);
 	void                  setLingerFlag(bool flag) { _lingering = flag; }
 	bool                  getLingerFlag() const { return _lingering; }
 	bool                  setPreferredProtocol(Protocol preferred);
+	Protocol              getPreferredProtocol() const { return _preferred_protocol; }
+		// true if the session was loaded from the session cache file
+		// and has not been resumed since, see KeyCacheFile.h
+	void                  setRestoredFlag(bool flag) { _restored = flag; }
+	bool                  getRestoredFlag() const { return _restored; }
 	void                  setLastPeerVersion(const std::string& version) { _last_peer_version = version; }
 	std::string           getLastPeerVersion() const { return _last_peer_version; }
 
@@ -63,6 +72,7 @@ class KeyCacheEntry {
 	bool                 _lingering; // true if session only exists
 	                                 // to catch lingering communication
 	Protocol             _preferred_protocol;
+	bool                 _restored;
 	std::string          _last_peer_version;
 };
 
@@ -54,6 +54,15 @@ class Authentication {
     int authenticate( char *hostAddr, KeyInfo *& key, const char* auth_methods, CondorError* errstack, int timeout, bool non_blocking );
     int authenticate_continue( CondorError* errstack, bool non_blocking );
 
+    bool isOffloaded() const { return m_continue_auth && m_auth && m_auth->isOffloaded(); }
+    //------------------------------------------
+    // PURPOSE: Whether authenticate_continue() returned 2
+    //          because a step is running on the
+    //          authentication threads rather than
+    //          because it is waiting for the peer.
+    //          See ReliSock::setAuthenticationOffloadCallback()
+    //------------------------------------------
+
     //------------------------------------------
     // PURPOSE: To send the secret key over. this method
     //          is written to keep compatibility issues
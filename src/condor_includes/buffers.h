@@ -21,6 +21,10 @@
 #define BUFFERS_H
 
 #define CONDOR_IO_BUF_SIZE 4096
+
+// The largest packet ReliSock grows its send buffer to in a long message.
+// Receivers reject packets larger than 1MB.
+#define CONDOR_IO_MAX_BUF_SIZE (256 * 1024)
 #include "sock.h"
 
 void sanity_check();
@@ -48,6 +52,7 @@ public:
 	void alloc_buf();
 	void dealloc_buf();
 	void grow_buf(int new_sz);
+	void set_max_size(int new_sz);
 
 	inline int max_size() const { return _dta_maxsz; }
 	inline int num_untouched() const { return _dta_sz - _dta_pt; }
@@ -64,6 +69,8 @@ public:
 	int read(char const *peer_description,SOCKET sockd, int sz=-1, int timeout=0, bool non_blocking=false);
 
 	int flush(char const *peer_description,SOCKET sockd, void * hdr=0, int sz=0, int timeout=0, bool non_blocking=false);
+	// like flush(), but sends extra after the buffered data without copying it
+	int flush_with(char const *peer_description,SOCKET sockd, void * hdr, int sz, const char *extra, int extra_sz, int timeout=0);
 
 	int put_max(const void *, int);
 	int put_force(const void *, int);
@@ -305,6 +305,8 @@
 #define ATTR_HOOK_KEYWORD  "HookKeyword"
 #define ATTR_HISTORY_RECORD_SOURCE  "HistoryRecordSource"
 #define ATTR_HISTORY_AD_TYPE_FILTER  "HistoryAdTypeFilter"
+#define ATTR_HISTORY_JOB_ID_FILTER  "HistoryJobIdFilter"
+#define ATTR_HISTORY_OWNER_FILTER  "HistoryOwnerFilter"
 #define ATTR_IDLE_JOBS  "IdleJobs"
 #define ATTR_IMAGE_SIZE  "ImageSize"
 #define ATTR_IO_WAIT  "IOWait"
@@ -645,10 +647,13 @@
 #define ATTR_REQUEUE_REASON  "RequeueReason"
 #define ATTR_REQUIREMENTS  "Requirements"
 #define ATTR_CUDA_VERSION "CUDAVersion"
+#define ATTR_QUERY_Q_AFTER_JOB_ID       "QueryAfterJobId"
+#define ATTR_QUERY_Q_CURSOR             "QueryCursor"
 #define ATTR_QUERY_Q_IDS                "IDs"
 #define ATTR_QUERY_Q_INCLUDE_CLUSTER_AD "IncludeClusterAd"
 #define ATTR_QUERY_Q_INCLUDE_JOBSET_ADS "IncludeJobsetAds"
 #define ATTR_QUERY_Q_NO_PROC_ADS        "NoProcAds"
+#define ATTR_QUERY_Q_PAGED              "QueryPaged"
 #define ATTR_RESOURCE_REQUEST_CONSTRAINT "_condor_RESOURCE_CONSTRAINT"  // used in resource request ad
 #define ATTR_RESOURCE_REQUEST_COUNT "_condor_RESOURCE_COUNT"  // used in resource request ad
 #define ATTR_RESOURCE_REQUEST_CLUSTER "_condor_RESOURCE_CLUSTER"
@@ -808,6 +813,8 @@
 #define ATTR_UPDATE_INTERVAL  "UpdateInterval"
 #define ATTR_CLASSAD_LIFETIME  "ClassAdLifetime"
 #define ATTR_UPDATE_PRIO  "UpdatePrio"
+#define ATTR_UPDATE_DELTA_BASE_SEQUENCE_NUMBER  "UpdateDeltaBaseSequenceNumber"
+#define ATTR_UPDATE_DELTA_REMOVED_ATTRS  "UpdateDeltaRemovedAttrs"
 #define ATTR_UPDATE_SEQUENCE_NUMBER  "UpdateSequenceNumber"
 #define ATTR_USE_PARROT  "UseParrot"
 #define ATTR_USER  "User"
@@ -1144,7 +1151,13 @@ extern const char ATTR_SEC_AUTHENTICATED_USER [];
 #define ATTR_LAST_NEGOTIATION_CYCLE_SUBMITTERS_SHARE_LIMIT  "LastNegotiationCycleSubmittersShareLimit"
 #define ATTR_LAST_NEGOTIATION_CYCLE_ACTIVE_SUBMITTER_COUNT  "LastNegotiationCycleActiveSubmitterCount"
 #define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE  "LastNegotiationCycleMatchRate"
+#define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_CACHE_HITS  "LastNegotiationCycleMatchCacheHits"
+#define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_CACHE_MISSES  "LastNegotiationCycleMatchCacheMisses"
 #define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE_SUSTAINED  "LastNegotiationCycleMatchRateSustained"
+#define ATTR_LAST_NEGOTIATION_CYCLE_MATCH_THREADS  "LastNegotiationCycleMatchThreads"
+#define ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_DURATION  "LastNegotiationCycleParallelMatchDuration"
+#define ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_SPEEDUP  "LastNegotiationCycleParallelMatchSpeedup"
+#define ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_EFFICIENCY  "LastNegotiationCycleParallelMatchEfficiency"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PIES  "LastNegotiationCyclePies"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS  "LastNegotiationCyclePieSpins"
 #define ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION  "LastNegotiationCyclePrefetchDuration"
@@ -27,6 +27,11 @@
 #include "condor_uid.h"
 #include "my_username.h"
 
+#include <functional>
+#include <memory>
+
+class AuthOffloadJob;
+
 const int CAUTH_NONE                    = 0;
 const int CAUTH_ANY                     = 1;
 const int CAUTH_CLAIMTOBE               = 2;
@@ -193,8 +198,40 @@ class Condor_Auth_Base {
     // RETUNRS: None (this)
     //------------------------------------------
 
+    bool isOffloaded() const { return (bool)offloadJob_; }
+    //------------------------------------------
+    // PURPOSE: Whether a step started by offload()
+    //          has not finished yet
+    // REQUIRE: None
+    // RETURNS: true or false
+    //------------------------------------------
+
  protected:
 
+    bool offload(const char * step, std::function<void()> work);
+    //------------------------------------------
+    // PURPOSE: Run work on the authentication threads
+    //          (see condor_auth_offload.h), if the
+    //          socket has an offload callback.  When
+    //          work is done, authenticate_continue()
+    //          is called again.
+    // REQUIRE: work must not touch the socket or
+    //          this object, only what it captures by
+    //          value or by std::shared_ptr, since it
+    //          may still be running after we are gone
+    // RETURNS: true -- the caller should return 2
+    //          (would block); false -- the caller
+    //          should do the work itself
+    //------------------------------------------
+
+    void cancelOffload();
+    //------------------------------------------
+    // PURPOSE: Stop a step started by offload(), so
+    //          that authenticate_continue() is not
+    //          called for it.  Work that is running
+    //          is left to finish, this doesn't wait.
+    //------------------------------------------
+
     Condor_Auth_Base& setRemoteHost(const char * hostAddr);
     //------------------------------------------
     // PURPOSE: Set the remote address
@@ -228,6 +265,7 @@ class Condor_Auth_Base {
     char *          localDomain_;    // Local user domain
     char *          fqu_;            // Fully qualified
     char *          authenticatedName_;   // Different for each method
+    std::shared_ptr<AuthOffloadJob> offloadJob_;   // step started by offload()
 };
 
 #endif
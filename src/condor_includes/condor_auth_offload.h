@@ -0,0 +1,110 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef CONDOR_AUTH_OFFLOAD_H
+#define CONDOR_AUTH_OFFLOAD_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The CPU heavy steps of authenticating an incoming connection (the TLS
+// handshake, validating a SciToken, deriving the session key) can be run
+// on a pool of SEC_AUTHENTICATION_THREADS threads instead of the DaemonCore
+// main thread, so that a burst of new connections doesn't stall the daemon.
+//
+// The work given to the pool must not touch the socket, DaemonCore or
+// ClassAds.  It should compute into memory that it shares with the caller
+// through a std::shared_ptr that it captures, and leave the results to be
+// used by the done function, which is called on the main thread from the
+// DaemonCore pump.  A cancelled job keeps what its work captured until the
+// work has finished, and then frees it on the main thread.  The work may
+// call param(), the config is not reloaded while work is running, but it
+// must not switch priv states, use the known_hosts file or change the
+// config.
+//
+// The run time and the time spent waiting for a thread of each kind of
+// step are published in the DaemonCore stats as DCAuthOffload<step>Runtime
+// and DCAuthOffload<step>Wait.
+
+class AuthOffloadJob;
+
+// Queues work to run on the pool, and then done to be called on the main
+// thread.  Returns NULL if there is no pool, because this is not a
+// DaemonCore daemon or SEC_AUTHENTICATION_THREADS is 0, in which case
+// the caller should do the work itself.
+std::shared_ptr<AuthOffloadJob> AuthOffloadRun(const char *step, std::function<void()> work, std::function<void()> done);
+
+// Makes sure that done will not be called, and that work will not run if
+// it hasn't started.  Work that is running is left to finish, this does
+// not wait for it.
+void AuthOffloadCancel(const std::shared_ptr<AuthOffloadJob> &job);
+
+// Waits until no work is queued or running.  Called before the config is
+// reloaded.
+void AuthOffloadDrain();
+
+// True on the threads of the pool, for code that the work calls that must
+// not do some things there.
+bool AuthOffloadIsPoolThread();
+
+// The pool of threads behind the functions above.  When the work of a job
+// is done, post is called on the pool thread, and it must arrange for
+// Finish() to be called with the job on the main thread.  AuthOffloadRun()
+// uses a pool whose post function registers pump work with DaemonCore.
+class AuthOffloadPool {
+public:
+	using PostFunc = std::function<void(std::shared_ptr<AuthOffloadJob>)>;
+
+	explicit AuthOffloadPool(PostFunc post) : m_post(std::move(post)) {}
+	// stops the threads after the jobs they are running, drops queued jobs
+	~AuthOffloadPool();
+	AuthOffloadPool(const AuthOffloadPool &) = delete;
+	AuthOffloadPool &operator=(const AuthOffloadPool &) = delete;
+
+	// start more threads if there are fewer than threads, there is no
+	// way to stop them.
+	void grow(int threads);
+	int threads() const { return (int)m_threads.size(); }
+
+	std::shared_ptr<AuthOffloadJob> submit(const char *step, std::function<void()> work, std::function<void()> done);
+	void cancel(const std::shared_ptr<AuthOffloadJob> &job);
+	void drain();
+
+	// calls the done function of a job, unless it was cancelled
+	static void Finish(const std::shared_ptr<AuthOffloadJob> &job);
+
+private:
+	void threadMain();
+
+	PostFunc m_post;
+	std::mutex m_mutex;
+	std::condition_variable m_work_cv;
+	std::condition_variable m_idle_cv;   // a job has stopped running
+	std::deque<std::shared_ptr<AuthOffloadJob>> m_queue;   // guarded by m_mutex
+	int m_running {0};                                     // guarded by m_mutex
+	bool m_stopping {false};                               // guarded by m_mutex
+	std::vector<std::thread> m_threads;
+};
+
+#endif
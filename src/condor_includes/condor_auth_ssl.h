@@ -26,6 +26,7 @@
 #include "condor_auth.h"        // Condor_Auth_Base class is defined here
 #include "condor_crypt_3des.h"
 #include "env.h"
+#include "condor_scitokens.h"
 
 #define AUTH_SSL_BUF_SIZE         1048576
 #define AUTH_SSL_ERROR            -1
@@ -139,7 +140,8 @@ class Condor_Auth_SSL final : public Condor_Auth_Base {
 		PreConnect,
 		Connect,
 		KeyExchange,
-		SciToken
+		SciToken,
+		SciTokenVerify
 	};
 
 	enum class CondorAuthSSLRetval {
@@ -164,6 +166,13 @@ class Condor_Auth_SSL final : public Condor_Auth_Base {
 	CondorAuthSSLRetval authenticate_server_scitoken(CondorError *errstack,
 		bool non_blocking);
 
+	// Step 4, after the scitoken was validated on the authentication threads.
+	CondorAuthSSLRetval authenticate_server_scitoken_verified(CondorError *errstack,
+		bool non_blocking);
+
+	// Step 4: exchange messages with the client for one round.
+	CondorAuthSSLRetval server_scitoken_round(bool non_blocking);
+
 	// Common to both client and server: successfully finish, tear down state.
 	CondorAuthSSLRetval authenticate_finish(CondorError *errstack,
 		bool non_blocking);
@@ -171,6 +180,21 @@ class Condor_Auth_SSL final : public Condor_Auth_Base {
 	// Common to both client and server: fail and release state.
 	CondorAuthSSLRetval authenticate_fail();
 
+	// The result of validating the client's scitoken.
+	struct SciTokenResult {
+		int m_ident{0};
+		htcondor::SciTokenConfig m_config; // read before validating, maybe on another thread
+		bool m_valid{false};
+		std::string m_issuer;
+		std::string m_subject;
+		long long m_expiry{0};
+		std::vector<std::string> m_bounding_set;
+		std::vector<std::string> m_groups;
+		std::vector<std::string> m_scopes;
+		std::string m_jti;
+		CondorError m_errstack;
+	};
+
 	class AuthState {
 	public:
 		AuthState() {}
@@ -191,9 +215,18 @@ class Condor_Auth_SSL final : public Condor_Auth_Base {
 		SSL_CTX *m_ctx{nullptr};
 		unsigned char m_session_key[AUTH_SSL_SESSION_KEY_LEN];
 		Phase m_phase{Phase::Startup};
+			// SSL_accept() ran on the authentication threads, and
+			// m_ssl_status and m_err hold its result
+		bool m_accept_done{false};
+			// the error that SSL_accept() left in the error queue of
+			// the thread that called it
+		std::string m_ssl_error;
+		std::unique_ptr<SciTokenResult> m_scitoken;
 	};
 
-	std::unique_ptr<AuthState> m_auth_state;
+		// shared with the work we give to the authentication threads,
+		// which may still be running after we are gone
+	std::shared_ptr<AuthState> m_auth_state;
 
 	static bool m_initTried;
 	static bool m_initSuccess;
@@ -222,7 +255,15 @@ class Condor_Auth_SSL final : public Condor_Auth_Base {
                                  BIO *conn_in, BIO *conn_out);
 //    int verify_callback(int ok, X509_STORE_CTX *store);
     long post_connection_check(SSL *ssl, int role);
+		// call SSL_accept() and record its result in state, may be run
+		// on the authentication threads
+	static void server_accept(AuthState &state);
+		// validate the client's scitoken into result, may be run on the
+		// authentication threads
+	static void validate_client_scitoken(const std::string &scitoken, SciTokenResult &result);
+		// use the result of validate_client_scitoken()
 	bool server_verify_scitoken(CondorError* errstack);
+	void server_check_scitoken(CondorError* errstack);
 	std::string get_peer_identity(SSL *ssl);
 
 		/** This stores the shared session key produced as output of
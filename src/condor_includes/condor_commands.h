@@ -712,7 +712,7 @@ static_assert(makeCommandTable().back().first == COMMAND_LAST, "Is the size of t
 *** Command ids used by the collector 
 ************/
 constexpr const
-std::array<std::pair<int, const char *>, 63> makeCollectorCommandTable() {
+std::array<std::pair<int, const char *>, 64> makeCollectorCommandTable() {
 	return {{ 
 #define UPDATE_STARTD_AD		0
 		{UPDATE_STARTD_AD, "UPDATE_STARTD_AD"},
@@ -880,6 +880,11 @@ std::array<std::pair<int, const char *>, 63> makeCollectorCommandTable() {
 #define IMPERSONATION_TOKEN_REQUEST 81
 		{IMPERSONATION_TOKEN_REQUEST, "IMPERSONATION_TOKEN_REQUEST"},
 
+			// A startd slot ad that holds only the attributes that changed since an
+			// earlier update, the collector merges it into the ad that it already has.
+#define UPDATE_STARTD_AD_DELTA 82
+		{UPDATE_STARTD_AD_DELTA, "UPDATE_STARTD_AD_DELTA"},
+
 #define COLLECTOR_COMMAND_LAST (INT_MAX - 1)			// used by the Win32 credd only
 		{COLLECTOR_COMMAND_LAST, "COLLECTOR_COMMAND_LAST"},
 	}};
@@ -269,6 +269,16 @@ public:
 	int authenticate( KeyInfo *& key, const char* methods, CondorError* errstack, int auth_timeout, bool non_blocking, char **method_used );
     ///
 	int authenticate_continue( CondorError* errstack, bool non_blocking, char **method_used );
+
+	// Lets the authentication methods run their CPU heavy steps on the
+	// authentication threads (see condor_auth_offload.h).  While one is
+	// running, authenticate() and authenticate_continue() return 2 and
+	// isAuthenticationOffloaded() is true.  Rather than waiting for the
+	// socket to be readable, wait for callback to be called on the main
+	// thread, then call authenticate_continue().
+	void setAuthenticationOffloadCallback(std::function<void()> callback) { m_auth_offload_callback = std::move(callback); }
+	const std::function<void()> & getAuthenticationOffloadCallback() const { return m_auth_offload_callback; }
+	bool isAuthenticationOffloaded() const;
     ///
 	int isClient() const { return is_client; };
 
@@ -356,6 +366,7 @@ protected:
                 Condor_MD_MAC * mdChecker_;
 		ReliSock      * p_sock;
 		Buf		*m_out_buf;
+		int		m_packet_size;  // capacity of buf, grows in long messages
 		void stash_packet();
 
 	public:
@@ -363,7 +374,12 @@ protected:
 		~SndMsg();
 		void reset();
 		Buf			buf;
-		int snd_packet(char const *peer_description, int, int, int);
+			// extra is sent after the buffered data in the same packet,
+			// straight from the caller's memory; see put_bytes_after_encryption()
+		int snd_packet(char const *peer_description, int, int, int, const char *extra = NULL, int extra_sz = 0);
+
+			// true if snd_packet() can be given extra data
+		bool can_send_extra() const;
 
 			// If there is a packet not flushed to the network, try to
 			// send it again.
@@ -397,6 +413,7 @@ protected:
 
 	Authentication *m_authob;
 	bool m_auth_in_progress;
+	std::function<void()> m_auth_offload_callback;
 
 	bool m_has_backlog;
 	bool m_read_would_block;
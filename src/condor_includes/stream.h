@@ -47,6 +47,8 @@ const condor_mode_t MISSING_FILE_PERMISSIONS = (condor_mode_t)(1 << 24);
 
 #include "proc.h"
 
+class ClassAdWireState;
+
 /** @name Special Types
     We need to define a special code() method for certain integer arguments.
     To take advantage of overloading, we need make these arguments have a
@@ -504,6 +506,10 @@ public:
 	/// Set the peer's version.
 	void set_peer_version(CondorVersionInfo const *version);
 
+	/// Interned attribute names of the binary ClassAd encoding for the
+	/// current message, see classad_wire.h
+	ClassAdWireState & classad_wire_state();
+
 	/** Get this stream's type.
         @return the type of this stream
     */
@@ -592,6 +598,11 @@ protected:
 	int decrypt_buf_len;
 	char *m_peer_description_str;
 	CondorVersionInfo *m_peer_version;
+	ClassAdWireState *m_classad_wire_state;
+
+	// forget the interned names of the binary ClassAd encoding, called at
+	// the end of each message
+	void reset_classad_wire_state();
 
 	time_t m_deadline_time;
 	static int timeout_multiplier;
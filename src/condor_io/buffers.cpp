@@ -92,6 +92,18 @@ Buf::grow_buf(int new_sz)
 	_dta_maxsz = new_sz;
 }
 
+// Change the capacity of an empty buffer.  The memory is allocated when
+// the buffer is next used.
+void
+Buf::set_max_size(int new_sz)
+{
+	ASSERT(empty());
+	if (new_sz != _dta_maxsz) {
+		dealloc_buf();
+		_dta_maxsz = new_sz;
+	}
+}
+
 int Buf::write(
 	char const *peer_description,
 	SOCKET	sockd,
@@ -163,6 +175,47 @@ int Buf::flush(
 }
 
 
+int Buf::flush_with(
+	char const *peer_description,
+	SOCKET	sockd,
+	void	*hdr,
+	int		sz,
+	const char *extra,
+	int		extra_sz,
+	int		timeout
+	)
+{
+	alloc_buf();
+
+	if (sz > max_size()) return -1;
+	if (hdr && sz > 0){
+		memcpy(_dta, hdr, sz);
+	}
+
+	int nw;
+#ifdef WIN32
+	nw = condor_write(peer_description, sockd, _dta, num_used(), timeout);
+	if (nw >= 0 && extra_sz > 0) {
+		int nwe = condor_write(peer_description, sockd, extra, extra_sz, timeout);
+		nw = (nwe < 0) ? nwe : nw + nwe;
+	}
+#else
+	struct iovec iov[2];
+	iov[0].iov_base = _dta;
+	iov[0].iov_len = num_used();
+	iov[1].iov_base = const_cast<char *>(extra);
+	iov[1].iov_len = extra_sz;
+	nw = condor_writev(peer_description, sockd, iov, 2, timeout);
+#endif
+	if (nw < 0) {
+		dprintf( D_ALWAYS, "Buf::flush_with(): write failed\n" );
+	}
+
+	reset();
+	return nw;
+}
+
+
 int Buf::read(
 	char const *peer_description,
 	SOCKET	sockd,
@@ -21,6 +21,7 @@
 #include "condor_common.h"
 #include "condor_auth.h"
 #include "condor_config.h"
+#include "condor_auth_offload.h"
 
 //static const char root[] = "root";
 
@@ -72,6 +73,8 @@ Condor_Auth_Base :: Condor_Auth_Base(ReliSock * sock, int mode) :
 
 Condor_Auth_Base :: ~Condor_Auth_Base()
 {
+    cancelOffload();
+
     if (remoteUser_) {
         free(remoteUser_);
     }
@@ -97,6 +100,27 @@ Condor_Auth_Base :: ~Condor_Auth_Base()
 	}
 }
 
+bool Condor_Auth_Base :: offload(const char * step, std::function<void()> work)
+{
+    if ( ! mySock_->getAuthenticationOffloadCallback()) {
+        return false;
+    }
+    offloadJob_ = AuthOffloadRun(step, std::move(work), [this]() {
+        offloadJob_.reset();
+        auto callback = mySock_->getAuthenticationOffloadCallback();
+        callback();
+    });
+    return (bool)offloadJob_;
+}
+
+void Condor_Auth_Base :: cancelOffload()
+{
+    if (offloadJob_) {
+        AuthOffloadCancel(offloadJob_);
+        offloadJob_.reset();
+    }
+}
+
 int Condor_Auth_Base :: wrap(const char *   input,
                              int      input_len, 
                              char*&   output, 
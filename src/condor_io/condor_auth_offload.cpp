@@ -0,0 +1,225 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_daemon_core.h"
+#include "condor_auth_offload.h"
+
+#include <algorithm>
+#include <string>
+
+class AuthOffloadJob {
+public:
+	std::string step;
+	std::function<void()> work;
+	std::function<void()> done;
+	double queued {0.0};
+	double started {0.0};
+	double finished {0.0};
+	bool cancelled {false};   // only used on the main thread
+};
+
+namespace {
+
+	// never destroyed, its threads are waiting for work when the process exits
+AuthOffloadPool *the_pool = nullptr;
+
+thread_local bool in_pool_thread = false;
+
+	// called on the main thread
+int
+jobDone(void * /*cls*/, void *data)
+{
+	std::unique_ptr<std::shared_ptr<AuthOffloadJob>> holder(static_cast<std::shared_ptr<AuthOffloadJob> *>(data));
+	const std::shared_ptr<AuthOffloadJob> &job = *holder;
+	if (job->cancelled) {
+		return 0;
+	}
+
+	std::string probe("DCAuthOffload");
+	probe += job->step;
+	daemonCore->dc_stats.AddSample(probe.c_str(), IF_BASICPUB | IF_RT_SUM, job->finished - job->started);
+	probe += "Wait";
+	daemonCore->dc_stats.AddSample(probe.c_str(), IF_BASICPUB, job->started - job->queued);
+
+	dprintf(D_SECURITY | D_VERBOSE, "Authentication step %s took %.6f seconds after waiting %.6f seconds for a thread\n",
+		job->step.c_str(), job->finished - job->started, job->started - job->queued);
+
+	AuthOffloadPool::Finish(job);
+	return 0;
+}
+
+} // namespace
+
+AuthOffloadPool::~AuthOffloadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopping = true;
+		m_queue.clear();
+	}
+	m_work_cv.notify_all();
+	for (auto &thread : m_threads) {
+		thread.join();
+	}
+}
+
+void
+AuthOffloadPool::grow(int threads)
+{
+	if (threads <= (int)m_threads.size()) {
+		return;
+	}
+	dprintf_make_thread_safe();
+
+#ifndef WIN32
+		// DaemonCore signal handlers must run on the main thread, so
+		// the threads start with all signals blocked.
+	sigset_t all_signals, old_mask;
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_SETMASK, &all_signals, &old_mask);
+#endif
+	while ((int)m_threads.size() < threads) {
+		m_threads.emplace_back(&AuthOffloadPool::threadMain, this);
+	}
+#ifndef WIN32
+	pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+#endif
+
+	dprintf(D_ALWAYS, "Using %d threads for authentication\n", (int)m_threads.size());
+}
+
+std::shared_ptr<AuthOffloadJob>
+AuthOffloadPool::submit(const char *step, std::function<void()> work, std::function<void()> done)
+{
+	auto job = std::make_shared<AuthOffloadJob>();
+	job->step = step;
+	job->work = std::move(work);
+	job->done = std::move(done);
+	job->queued = _condor_debug_get_time_double();
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_queue.push_back(job);
+	}
+	m_work_cv.notify_one();
+	return job;
+}
+
+void
+AuthOffloadPool::cancel(const std::shared_ptr<AuthOffloadJob> &job)
+{
+	job->cancelled = true;
+
+		// A job that is running or done is dropped by Finish(), on the
+		// main thread, so that what its work captured is freed there.
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto it = std::find(m_queue.begin(), m_queue.end(), job);
+	if (it != m_queue.end()) {
+		m_queue.erase(it);
+		if (m_queue.empty() && m_running == 0) {
+			m_idle_cv.notify_all();
+		}
+	}
+}
+
+void
+AuthOffloadPool::drain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle_cv.wait(lock, [this] { return m_queue.empty() && m_running == 0; });
+}
+
+void
+AuthOffloadPool::threadMain()
+{
+	in_pool_thread = true;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_work_cv.wait(lock, [this] { return m_stopping || ! m_queue.empty(); });
+		if (m_stopping) {
+			return;
+		}
+		std::shared_ptr<AuthOffloadJob> job = std::move(m_queue.front());
+		m_queue.pop_front();
+		++m_running;
+		lock.unlock();
+
+		job->started = _condor_debug_get_time_double();
+		job->work();
+		job->finished = _condor_debug_get_time_double();
+		m_post(std::move(job));
+
+		lock.lock();
+		--m_running;
+		m_idle_cv.notify_all();
+	}
+}
+
+void
+AuthOffloadPool::Finish(const std::shared_ptr<AuthOffloadJob> &job)
+{
+	if ( ! job->cancelled && job->done) {
+		job->done();
+	}
+}
+
+std::shared_ptr<AuthOffloadJob>
+AuthOffloadRun(const char *step, std::function<void()> work, std::function<void()> done)
+{
+	if ( ! daemonCore) {
+		return nullptr;
+	}
+	int threads = param_integer("SEC_AUTHENTICATION_THREADS", 0, 0);
+	if (threads <= 0) {
+		return nullptr;
+	}
+	if ( ! the_pool) {
+		the_pool = new AuthOffloadPool([](std::shared_ptr<AuthOffloadJob> job) {
+			daemonCore->Register_PumpWork_TS(&jobDone, nullptr,
+				new std::shared_ptr<AuthOffloadJob>(std::move(job)));
+		});
+	}
+	the_pool->grow(threads);
+	return the_pool->submit(step, std::move(work), std::move(done));
+}
+
+void
+AuthOffloadCancel(const std::shared_ptr<AuthOffloadJob> &job)
+{
+	if (job && the_pool) {
+		the_pool->cancel(job);
+	}
+}
+
+void
+AuthOffloadDrain()
+{
+	if (the_pool) {
+		the_pool->drain();
+	}
+}
+
+bool
+AuthOffloadIsPoolThread()
+{
+	return in_pool_thread;
+}
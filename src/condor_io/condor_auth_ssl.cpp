@@ -43,6 +43,7 @@
 #include "condor_attributes.h"
 #include "secure_file.h"
 #include "subsystem_info.h"
+#include "condor_auth_offload.h"
 
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
@@ -383,6 +384,8 @@ Condor_Auth_SSL::authenticate_continue(CondorError *errstack, bool non_blocking)
 		return static_cast<int>(authenticate_server_key(errstack, non_blocking));
 	case Phase::SciToken:
 		return static_cast<int>(authenticate_server_scitoken(errstack, non_blocking));
+	case Phase::SciTokenVerify:
+		return static_cast<int>(authenticate_server_scitoken_verified(errstack, non_blocking));
 	};
 	return static_cast<int>(CondorAuthSSLRetval::Fail);
 }
@@ -751,6 +754,9 @@ int Condor_Auth_SSL::authenticate(const char * /* remoteHost */, CondorError* er
             // SSL_set_accept_state(ssl); // Do I really have to do this?
             SSL_set_bio_ptr(m_auth_state->m_ssl, m_auth_state->m_conn_in,
 				m_auth_state->m_conn_out);
+            // No LastVerifyError, so that verify_callback() leaves
+            // known_hosts alone when SSL_accept() runs on an
+            // authentication thread.
         }
 		if( send_status( m_auth_state->m_server_status ) == AUTH_SSL_ERROR ) {
 			return static_cast<int>(CondorAuthSSLRetval::Fail);
@@ -785,20 +791,47 @@ Condor_Auth_SSL::authenticate_server_pre(CondorError *errstack, bool non_blockin
 }
 
 
+void
+Condor_Auth_SSL::server_accept(AuthState &state)
+{
+	state.m_ssl_status = SSL_accept_ptr( state.m_ssl );
+	state.m_err = 0;
+	state.m_ssl_error.clear();
+	if( state.m_ssl_status < 1 ) {
+		state.m_err = SSL_get_error_ptr( state.m_ssl,
+			state.m_ssl_status );
+		if( state.m_err == SSL_ERROR_SSL ) {
+			char errbuf[256];
+			ERR_error_string_n(ERR_get_error(), errbuf, sizeof(errbuf));
+			state.m_ssl_error = errbuf;
+		}
+	}
+		// the error queue belongs to this thread, which may be an
+		// authentication thread, so leave it empty for the next user
+	ERR_clear_error();
+}
+
+
 Condor_Auth_SSL::CondorAuthSSLRetval
 Condor_Auth_SSL::authenticate_server_connect(CondorError *errstack, bool non_blocking) {
 		m_auth_state->m_phase = Phase::Connect;
         while( !m_auth_state->m_done ) {
             if( m_auth_state->m_server_status != AUTH_SSL_HOLDING ) {
-                ouch("Trying to accept.\n");
-                m_auth_state->m_ssl_status = SSL_accept_ptr( m_auth_state->m_ssl );
+                if( m_auth_state->m_accept_done ) {
+                    m_auth_state->m_accept_done = false;
+                } else {
+                    ouch("Trying to accept.\n");
+                    if( non_blocking && offload("SSL", [state = m_auth_state]() { server_accept(*state); }) ) {
+                        m_auth_state->m_accept_done = true;
+                        return CondorAuthSSLRetval::WouldBlock;
+                    }
+                    server_accept(*m_auth_state);
+                }
                 dprintf(D_SECURITY|D_VERBOSE, "Accept returned %d.\n", m_auth_state->m_ssl_status);
             }
             if( m_auth_state->m_ssl_status < 1 ) {
                 m_auth_state->m_server_status = AUTH_SSL_QUITTING;
                 m_auth_state->m_done = 1;
-                m_auth_state->m_err = SSL_get_error_ptr( m_auth_state->m_ssl,
-					m_auth_state->m_ssl_status );
                 switch( m_auth_state->m_err ) {
                 case SSL_ERROR_ZERO_RETURN:
                     ouch("SSL: connection has been closed.\n");
@@ -824,7 +857,7 @@ Condor_Auth_SSL::authenticate_server_connect(CondorError *errstack, bool non_blo
                     ouch("SSL: Syscall.\n" );
                     break;
                 case SSL_ERROR_SSL:
-                    dprintf(D_SECURITY, "SSL: library failure: %s\n", ERR_error_string(ERR_get_error(), NULL));
+                    dprintf(D_SECURITY, "SSL: library failure: %s\n", m_auth_state->m_ssl_error.c_str());
                     break;
                 default:
                     ouch("SSL: unknown error?\n" );
@@ -1052,64 +1085,23 @@ Condor_Auth_SSL::authenticate_server_scitoken(CondorError *errstack, bool non_bl
 			if(m_auth_state->m_client_status == AUTH_SSL_HOLDING) {
 				m_auth_state->m_done = 1;
 			}
-			if (server_verify_scitoken(errstack)) {
-				m_auth_state->m_server_status = AUTH_SSL_HOLDING;
-			} else {
-				m_auth_state->m_server_status = AUTH_SSL_QUITTING;
-			}
-
-
-			// We don't currently go back and try another authentication method
-			// if authorization fails, so check for a succesful mapping here.
-			//
-			// We can't delay this info authentication_finish() because we
-			// need to be able to tell the client that the authN failed.
-			if (m_auth_state->m_server_status == AUTH_SSL_HOLDING) {
-				std::string canonical_user;
-				Authentication::load_map_file();
-				auto global_map_file = Authentication::getGlobalMapFile();
-				bool mapFailed = true;
-				bool pluginsDefined = param_defined("SEC_SCITOKENS_PLUGIN_NAMES");
-				if( global_map_file != NULL ) {
-					mapFailed = global_map_file->GetCanonicalization( "SCITOKENS", m_scitokens_auth_name, canonical_user );
-				}
-				if (!global_map_file && pluginsDefined) {
-					dprintf(D_SECURITY|D_VERBOSE, "No map file, but SCITOKENS plugins defined, assuming authorization will succeed\n");
-				} else if( mapFailed ) {
-					dprintf(D_ERROR, "Failed to map SCITOKENS authenticated identity '%s', failing authentication to give another authentication method a go.\n", m_scitokens_auth_name.c_str() );
-
-					m_auth_state->m_server_status = AUTH_SSL_QUITTING;
-				} else {
-					dprintf(D_SECURITY|D_VERBOSE, "Mapped SCITOKENS authenticated identity '%s' to %s, assuming authorization will succeed.\n", m_scitokens_auth_name.c_str(), canonical_user.c_str() );
-				}
-			}
-		}
-		if(m_auth_state->m_round_ctr % 2 == 1) {
-			if(AUTH_SSL_ERROR == server_send_message(
-				m_auth_state->m_server_status, m_auth_state->m_buffer,
-				m_auth_state->m_conn_in, m_auth_state->m_conn_out ))
+			m_auth_state->m_scitoken.reset(new SciTokenResult);
+			m_auth_state->m_scitoken->m_ident = mySock_->getUniqueId();
+			m_auth_state->m_scitoken->m_config = htcondor::scitoken_config_from_params();
+			if (non_blocking && htcondor::init_scitokens() &&
+				offload("SCITOKENS", [state = m_auth_state, scitoken = m_client_scitoken]() {
+					validate_client_scitoken(scitoken, *state->m_scitoken);
+				}))
 			{
-				m_auth_state->m_client_status = AUTH_SSL_QUITTING;
-			}
-		} else {
-			auto retval = server_receive_message(non_blocking,
-				m_auth_state->m_server_status, m_auth_state->m_buffer,
-				m_auth_state->m_conn_in, m_auth_state->m_conn_out,
-				m_auth_state->m_client_status );
-			if (retval != CondorAuthSSLRetval::Success) {
-				return retval == CondorAuthSSLRetval::Fail ? authenticate_fail() : retval;
+				m_auth_state->m_phase = Phase::SciTokenVerify;
+				return CondorAuthSSLRetval::WouldBlock;
 			}
+			validate_client_scitoken(m_client_scitoken, *m_auth_state->m_scitoken);
+			server_check_scitoken(errstack);
 		}
-		m_auth_state->m_round_ctr++;
-		dprintf(D_SECURITY|D_VERBOSE, "SciToken exchange server status: c: %d, s: %d\n", m_auth_state->m_client_status,
-				m_auth_state->m_server_status);
-		if(m_auth_state->m_server_status == AUTH_SSL_HOLDING
-			&& m_auth_state->m_client_status == AUTH_SSL_HOLDING)
-		{
-			m_auth_state->m_done = 1;
-		}
-		if(m_auth_state->m_client_status == AUTH_SSL_QUITTING) {
-			m_auth_state->m_done = 1;
+		auto retval = server_scitoken_round(non_blocking);
+		if (retval != CondorAuthSSLRetval::Success) {
+			return retval;
 		}
 	}
 	if( m_auth_state->m_server_status == AUTH_SSL_QUITTING
@@ -1122,17 +1114,113 @@ Condor_Auth_SSL::authenticate_server_scitoken(CondorError *errstack, bool non_bl
 }
 
 
+Condor_Auth_SSL::CondorAuthSSLRetval
+Condor_Auth_SSL::authenticate_server_scitoken_verified(CondorError *errstack, bool non_blocking)
+{
+	server_check_scitoken(errstack);
+	m_auth_state->m_phase = Phase::SciToken;
+	auto retval = server_scitoken_round(non_blocking);
+	if (retval != CondorAuthSSLRetval::Success) {
+		return retval;
+	}
+	return authenticate_server_scitoken(errstack, non_blocking);
+}
+
+
+Condor_Auth_SSL::CondorAuthSSLRetval
+Condor_Auth_SSL::server_scitoken_round(bool non_blocking)
+{
+	if(m_auth_state->m_round_ctr % 2 == 1) {
+		if(AUTH_SSL_ERROR == server_send_message(
+			m_auth_state->m_server_status, m_auth_state->m_buffer,
+			m_auth_state->m_conn_in, m_auth_state->m_conn_out ))
+		{
+			m_auth_state->m_client_status = AUTH_SSL_QUITTING;
+		}
+	} else {
+		auto retval = server_receive_message(non_blocking,
+			m_auth_state->m_server_status, m_auth_state->m_buffer,
+			m_auth_state->m_conn_in, m_auth_state->m_conn_out,
+			m_auth_state->m_client_status );
+		if (retval != CondorAuthSSLRetval::Success) {
+			return retval == CondorAuthSSLRetval::Fail ? authenticate_fail() : retval;
+		}
+	}
+	m_auth_state->m_round_ctr++;
+	dprintf(D_SECURITY|D_VERBOSE, "SciToken exchange server status: c: %d, s: %d\n", m_auth_state->m_client_status,
+			m_auth_state->m_server_status);
+	if(m_auth_state->m_server_status == AUTH_SSL_HOLDING
+		&& m_auth_state->m_client_status == AUTH_SSL_HOLDING)
+	{
+		m_auth_state->m_done = 1;
+	}
+	if(m_auth_state->m_client_status == AUTH_SSL_QUITTING) {
+		m_auth_state->m_done = 1;
+	}
+	return CondorAuthSSLRetval::Success;
+}
+
+
+void
+Condor_Auth_SSL::server_check_scitoken(CondorError* errstack)
+{
+	if (server_verify_scitoken(errstack)) {
+		m_auth_state->m_server_status = AUTH_SSL_HOLDING;
+	} else {
+		m_auth_state->m_server_status = AUTH_SSL_QUITTING;
+	}
+
+	// We don't currently go back and try another authentication method
+	// if authorization fails, so check for a succesful mapping here.
+	//
+	// We can't delay this info authentication_finish() because we
+	// need to be able to tell the client that the authN failed.
+	if (m_auth_state->m_server_status == AUTH_SSL_HOLDING) {
+		std::string canonical_user;
+		Authentication::load_map_file();
+		auto global_map_file = Authentication::getGlobalMapFile();
+		bool mapFailed = true;
+		bool pluginsDefined = param_defined("SEC_SCITOKENS_PLUGIN_NAMES");
+		if( global_map_file != NULL ) {
+			mapFailed = global_map_file->GetCanonicalization( "SCITOKENS", m_scitokens_auth_name, canonical_user );
+		}
+		if (!global_map_file && pluginsDefined) {
+			dprintf(D_SECURITY|D_VERBOSE, "No map file, but SCITOKENS plugins defined, assuming authorization will succeed\n");
+		} else if( mapFailed ) {
+			dprintf(D_ERROR, "Failed to map SCITOKENS authenticated identity '%s', failing authentication to give another authentication method a go.\n", m_scitokens_auth_name.c_str() );
+
+			m_auth_state->m_server_status = AUTH_SSL_QUITTING;
+		} else {
+			dprintf(D_SECURITY|D_VERBOSE, "Mapped SCITOKENS authenticated identity '%s' to %s, assuming authorization will succeed.\n", m_scitokens_auth_name.c_str(), canonical_user.c_str() );
+		}
+	}
+}
+
+
+void
+Condor_Auth_SSL::validate_client_scitoken(const std::string &scitoken, SciTokenResult &result)
+{
+	result.m_valid = htcondor::validate_scitoken(scitoken, result.m_issuer,
+		result.m_subject, result.m_expiry, result.m_bounding_set, result.m_groups,
+		result.m_scopes, result.m_jti, result.m_config, result.m_ident, result.m_errstack);
+}
+
+
 bool
 Condor_Auth_SSL::server_verify_scitoken(CondorError* errstack)
 {
-	std::string issuer, subject;
-	long long expiry;
-	std::vector<std::string> bounding_set;
-	std::vector<std::string> groups, scopes;
-	std::string jti;
-	if (!htcondor::validate_scitoken(m_client_scitoken, issuer, subject, expiry,
-		bounding_set, groups, scopes, jti, mySock_->getUniqueId(), *errstack))
+	const SciTokenResult &result = *m_auth_state->m_scitoken;
+	const std::string &issuer = result.m_issuer;
+	const std::string &subject = result.m_subject;
+	const std::vector<std::string> &bounding_set = result.m_bounding_set;
+	const std::vector<std::string> &groups = result.m_groups;
+	const std::vector<std::string> &scopes = result.m_scopes;
+	const std::string &jti = result.m_jti;
+	if (!result.m_valid)
 	{
+		if (!result.m_errstack.empty()) {
+			errstack->push(result.m_errstack.subsys(), result.m_errstack.code(), result.m_errstack.message());
+		}
 		dprintf(D_SECURITY, "SCITOKENS error: %s\n", errstack->message(0));
 		return false;
 	}
@@ -1405,6 +1493,14 @@ int verify_callback(int ok, X509_STORE_CTX *store)
 
 		const SSL* ssl = (const SSL*)X509_STORE_CTX_get_ex_data(store, (*SSL_get_ex_data_X509_STORE_CTX_idx_ptr)());
 		Condor_Auth_SSL::LastVerifyError *verify_ptr = (Condor_Auth_SSL::LastVerifyError *)(g_last_verify_error_index >= 0 ? SSL_get_ex_data_ptr(ssl, g_last_verify_error_index) : nullptr);
+			// Only clients give their SSL a LastVerifyError, since
+			// known_hosts records the servers that they trust.  A server
+			// may call SSL_accept() on the authentication threads, where
+			// known_hosts and the config must not be used.
+		if (verify_ptr && AuthOffloadIsPoolThread()) {
+			dprintf(D_ERROR, "SSL: not checking known_hosts on an authentication thread.\n");
+			verify_ptr = nullptr;
+		}
 		if (verify_ptr) verify_ptr->m_skip_error = 0;
 
 		if (verify_ptr && ((err == X509_V_ERR_DEPTH_ZERO_SELF_SIGNED_CERT) ||
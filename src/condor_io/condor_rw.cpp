@@ -601,3 +601,90 @@ condor_write( char const *peer_description, SOCKET fd, const char *buf, int sz,
 }
 
 
+
+
+#ifndef WIN32
+int
+condor_writev( char const *peer_description, SOCKET fd, const struct iovec *iov, int iovcnt, int timeout )
+{
+	char sinbuf[SINFUL_STRING_BUF_SIZE];
+	std::vector<struct iovec> vec;
+	int sz = 0;
+	for (int i = 0; i < iovcnt; ++i) {
+		if (iov[i].iov_len > 0) {
+			vec.push_back(iov[i]);
+			sz += (int)iov[i].iov_len;
+		}
+	}
+
+	if( IsDebugLevel( D_NETWORK ) ) {
+		dprintf(D_NETWORK,
+				"condor_writev(fd=%d %s,,iovcnt=%d,size=%d,timeout=%d)\n",
+				fd,
+				not_null_peer_description(peer_description,fd,sinbuf),
+				(int)vec.size(),
+				sz,
+				timeout);
+	}
+
+	/* Pre-conditions. */
+	ASSERT(sz > 0);      /* Can't write buffers that are have no data */
+	ASSERT(fd >= 0);     /* Need valid file descriptor */
+
+		// Hand everything to the kernel in one sendmsg().  If the socket
+		// does not take all of it, let condor_write() finish the fragment
+		// we stopped in, it knows how to wait for the socket within the
+		// timeout, and then try sendmsg() again with the rest.
+	int nw = 0;
+	size_t ix = 0;
+	while (ix < vec.size()) {
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &vec[ix];
+		msg.msg_iovlen = MIN(vec.size() - ix, (size_t)IOV_MAX);
+
+		start_thread_safe("sendmsg");
+		int flags = 0;
+#ifdef MSG_DONTWAIT
+			// with a timeout, we must not block in sendmsg()
+		if (timeout > 0) { flags = MSG_DONTWAIT; }
+#endif
+		ssize_t nwo = sendmsg(fd, &msg, flags);
+		int the_error = errno;
+		stop_thread_safe("sendmsg");
+
+		if (nwo < 0) {
+			if ( ! errno_is_temporary(the_error)) {
+				dprintf( D_ALWAYS, "condor_writev() failed: sendmsg() %d bytes to %s "
+						 "returned %d, "
+						 "timeout=%d, errno=%d %s.\n",
+						 sz - nw,
+						 not_null_peer_description(peer_description,fd,sinbuf),
+						 (int)nwo, timeout, the_error, strerror(the_error) );
+				return -1;
+			}
+			nwo = 0;
+		}
+		nw += (int)nwo;
+
+		bool wrote_nothing = (nwo == 0);
+		while (ix < vec.size() && (size_t)nwo >= vec[ix].iov_len) {
+			nwo -= vec[ix].iov_len;
+			++ix;
+		}
+		if (ix < vec.size() && (nwo > 0 || wrote_nothing)) {
+			char * base = (char *)vec[ix].iov_base + nwo;
+			int len = (int)(vec[ix].iov_len - nwo);
+			if (condor_write(peer_description, fd, base, len, timeout, 0, false) < 0) {
+				return -1;
+			}
+			nw += len;
+			++ix;
+		}
+	}
+
+	/* POST conditions. */
+	ASSERT( nw == sz ); /* Make sure that we wrote everything */
+	return nw;
+}
+#endif
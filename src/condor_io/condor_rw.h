@@ -30,4 +30,10 @@ int condor_read(char const *peer_description,SOCKET fd, char *buf, int sz, int t
 
 int condor_write(char const *peer_description,SOCKET fd, const char *buf, int sz, int timeout, int flags=0, bool non_blocking=false);
 
+#ifndef WIN32
+ // Write all of the fragments in iov, with as few system calls as the
+ // socket allows.  Returns the number of bytes written, < 0 upon an error.
+int condor_writev(char const *peer_description,SOCKET fd, const struct iovec *iov, int iovcnt, int timeout);
+#endif
+
 #endif
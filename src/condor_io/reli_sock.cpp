@@ -43,6 +43,8 @@
 
 #define NORMAL_HEADER_SIZE 5
 #define MAX_HEADER_SIZE MAC_SIZE + NORMAL_HEADER_SIZE
+	// put_bytes() sends data at least this large without copying it
+#define CONDOR_IO_DIRECT_SEND_MIN (16 * 1024)
 
 #define MAX_MESSAGE_SIZE (1024*1024)
 
@@ -562,6 +564,7 @@ ReliSock::end_of_message_internal()
 	if (crypto_state_ && crypto_state_->m_keyInfo.getProtocol() != CONDOR_AESGCM) {
 		resetCrypto();
 	}
+	reset_classad_wire_state();
 	switch(_coding){
 		case stream_encode:
 			if ( ignore_next_encode_eom == TRUE ) {
@@ -662,7 +665,27 @@ ReliSock::put_bytes_after_encryption(const void *dta, int sz) {
 	int		nw;
 	int 	tw = 0;
 	int		header_size = isOutgoing_Hash_on() ? MAX_HEADER_SIZE:NORMAL_HEADER_SIZE;
-	for(nw=0;;) {
+
+		// Data that does not fit in the buffer is sent straight from the
+		// caller's memory, in the same packet as what is already buffered,
+		// instead of being copied through the buffer a packet at a time.
+		// The last byte is always buffered, so that end_of_message() has a
+		// packet to send with the end flag.
+	nw = 0;
+	if (dta && sz >= CONDOR_IO_DIRECT_SEND_MIN && sz > snd_msg.buf.num_free() && snd_msg.can_send_extra()) {
+		while (sz - nw > 1) {
+			if (snd_msg.buf.empty()) {
+				snd_msg.buf.seek(header_size);
+			}
+			int extra_sz = MIN(sz - nw - 1, CONDOR_IO_MAX_BUF_SIZE - snd_msg.buf.num_used());
+			if ( ! snd_msg.snd_packet(peer_description(), _sock, FALSE, _timeout, &((const char *)dta)[nw], extra_sz)) {
+				return FALSE;
+			}
+			nw += extra_sz;
+		}
+	}
+
+	for(;;) {
 		
 		if (snd_msg.buf.full()) {
 			int retval = snd_msg.snd_packet(peer_description(), _sock, FALSE, _timeout);
@@ -1079,7 +1102,8 @@ ReliSock::SndMsg::SndMsg() :
     mode_(MD_OFF), 
     mdChecker_(0),
 	p_sock(0),
-	m_out_buf(NULL)
+	m_out_buf(NULL),
+	m_packet_size(CONDOR_IO_BUF_SIZE)
 {
 }
 
@@ -1094,6 +1118,17 @@ void ReliSock::SndMsg::reset()
 	buf.reset();
 	delete m_out_buf;
 	m_out_buf = NULL;
+	m_packet_size = CONDOR_IO_BUF_SIZE;
+	buf.set_max_size(m_packet_size);
+}
+
+bool ReliSock::SndMsg::can_send_extra() const
+{
+		// AES-GCM and the MAC need the whole packet in buf, and in
+		// non-blocking mode a partly sent packet is stashed for later,
+		// when the caller's memory is gone.
+	return mode_ == MD_OFF && m_out_buf == NULL && ! p_sock->is_non_blocking() &&
+		! (p_sock->get_encryption() && p_sock->get_crypto_state()->m_keyInfo.getProtocol() == CONDOR_AESGCM);
 }
 
 int ReliSock::SndMsg::finish_packet(const char *peer_description, int sock, int timeout)
@@ -1136,8 +1171,10 @@ void ReliSock::SndMsg::stash_packet()
 	// partially send it to the wire.  If this happens, we return 2.  In such a case,
 	// we leave the SndMsg buffer in a valid state -- if the caller cannot buffer the
 	// data itself, it may use the 'put_force' method to grow the underlying buffer.
-int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int end, int _timeout )
+int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int end, int _timeout, const char *extra, int extra_sz )
 {
+	ASSERT(extra_sz == 0 || can_send_extra());
+
 		// First, see if we have an incomplete packet.
 	int retval = finish_packet(peer_description, _sock, _timeout);
 	if (retval == 2) {
@@ -1153,7 +1190,7 @@ int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int e
 
 	header_size = (mode_ != MD_OFF) ? MAX_HEADER_SIZE : NORMAL_HEADER_SIZE;
 	hdr[0] = (char) end;
-	ns = buf.num_used() - header_size;
+	ns = buf.num_used() - header_size + extra_sz;
 	len = (int) htonl(ns);
 	memcpy(&hdr[1], &len, 4);
 
@@ -1185,7 +1222,11 @@ int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int e
 			dprintf(D_NETWORK, "IO: Failed to update the message digest.\n");
 			return false;
 		}
-		dprintf(D_NETWORK, "AESGCM: Send digest added %u + %d bytes \n", header_size, buf.num_untouched());
+		if (extra_sz > 0 && 1 != EVP_DigestUpdate(p_sock->m_send_md_ctx.get(), extra, extra_sz)) {
+			dprintf(D_NETWORK, "IO: Failed to update the message digest.\n");
+			return false;
+		}
+		dprintf(D_NETWORK, "AESGCM: Send digest added %u + %d bytes \n", header_size, buf.num_untouched() + extra_sz);
 	}
 
 		// AES-GCM mode encrypts the whole message at send() time; do this now and
@@ -1287,7 +1328,12 @@ int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int e
 		}
 	}
 
-	int result = buf.flush(peer_description, _sock, hdr, header_size, _timeout, p_sock->is_non_blocking());
+	int result;
+	if (extra_sz > 0) {
+		result = buf.flush_with(peer_description, _sock, hdr, header_size, extra, extra_sz, _timeout);
+	} else {
+		result = buf.flush(peer_description, _sock, hdr, header_size, _timeout, p_sock->is_non_blocking());
+	}
 	if (result < 0) {
 		return false;
 	} else if (result != ns+header_size) {
@@ -1299,8 +1345,17 @@ int ReliSock::SndMsg::snd_packet( char const *peer_description, int _sock, int e
 		}
 	}
         
+		// Start each message with small packets, and double the packet
+		// size with each packet of a long message, so that large replies
+		// take fewer system calls.  This also drops the space AES-GCM
+		// added to buf for the packet just sent.
 	if( end ) {
+		m_packet_size = CONDOR_IO_BUF_SIZE;
+		buf.set_max_size(m_packet_size);
 		buf.dealloc_buf(); // save space, now that we are done sending
+	} else {
+		m_packet_size = MIN(m_packet_size * 2, CONDOR_IO_MAX_BUF_SIZE);
+		buf.set_max_size(m_packet_size);
 	}
 	return TRUE;
 }
@@ -1618,6 +1673,11 @@ int ReliSock::perform_authenticate(bool with_key, KeyInfo *& key,
     }
 }
 
+bool ReliSock::isAuthenticationOffloaded() const
+{
+	return m_auth_in_progress && m_authob && m_authob->isOffloaded();
+}
+
 int ReliSock::authenticate_continue(CondorError* errstack, bool non_blocking, char **method_used)
 {
 	int result = 1;
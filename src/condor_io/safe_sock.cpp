@@ -139,6 +139,7 @@ int SafeSock::end_of_message()
 	int sent;
         unsigned char * md = 0;
 
+	reset_classad_wire_state();
 	switch(_coding){
 		case stream_encode:
                     if (mdChecker_) {
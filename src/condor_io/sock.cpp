@@ -1889,6 +1889,9 @@ int Sock::close()
 	setFullyQualifiedUser(NULL);
 	setTriedAuthentication(false);
 
+	// and forget any half sent or received message's interned names
+	reset_classad_wire_state();
+
 	return TRUE;
 }
 
@@ -23,6 +23,7 @@
 #include "condor_io.h"
 #include "condor_debug.h"
 #include "utilfns.h"
+#include "classad_wire.h"
 
 // initialize static data members
 int Stream::timeout_multiplier = 0;
@@ -56,6 +57,7 @@ Stream :: Stream() :
 	decrypt_buf_len(0),
 	m_peer_description_str(NULL),
 	m_peer_version(NULL),
+	m_classad_wire_state(NULL),
 	m_deadline_time(0),
 	ignore_timeout_multiplier(false)
 {
@@ -89,6 +91,7 @@ Stream :: ~Stream()
 	if( m_peer_version ) {
 		delete m_peer_version;
 	}
+	delete m_classad_wire_state;
 }
 
 int 
@@ -1509,6 +1512,23 @@ Stream::set_peer_version(CondorVersionInfo const *version)
 	}
 }
 
+ClassAdWireState &
+Stream::classad_wire_state()
+{
+	if( !m_classad_wire_state ) {
+		m_classad_wire_state = new ClassAdWireState;
+	}
+	return *m_classad_wire_state;
+}
+
+void
+Stream::reset_classad_wire_state()
+{
+	if( m_classad_wire_state ) {
+		m_classad_wire_state->clear();
+	}
+}
+
 void
 Stream::set_deadline_timeout(int t)
 {
@@ -0,0 +1,266 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the pool of threads that runs authentication steps
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "subsystem_info.h"
+#include "condor_auth_offload.h"
+
+#include <atomic>
+#include <chrono>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+// stands in for the DaemonCore pump: jobs that the pool posts wait here
+// until the main thread calls pump()
+static std::mutex posted_mutex;
+static std::condition_variable posted_cv;
+static std::deque<std::shared_ptr<AuthOffloadJob>> posted;
+
+static void post(std::shared_ptr<AuthOffloadJob> job)
+{
+	std::lock_guard<std::mutex> guard(posted_mutex);
+	posted.push_back(std::move(job));
+	posted_cv.notify_all();
+}
+
+// waits for count jobs to be posted, finishes them, returns how many there were
+static size_t pump(size_t count)
+{
+	std::deque<std::shared_ptr<AuthOffloadJob>> jobs;
+	{
+		std::unique_lock<std::mutex> lock(posted_mutex);
+		posted_cv.wait_for(lock, std::chrono::seconds(10), [count] { return posted.size() >= count; });
+		jobs.swap(posted);
+	}
+	size_t num = jobs.size();
+	while ( ! jobs.empty()) {
+		AuthOffloadPool::Finish(jobs.front());
+		jobs.pop_front();
+	}
+	return num;
+}
+
+// a flag that work waits for, so that the test can hold a thread
+class Gate {
+public:
+	void open() {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_open = true;
+		m_cv.notify_all();
+	}
+	bool wait() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_cv.wait_for(lock, std::chrono::seconds(10), [this] { return m_open; });
+	}
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_open {false};
+};
+
+// work runs on the threads of the pool, done on the thread that calls Finish()
+static void test_run()
+{
+	const std::thread::id main_id = std::this_thread::get_id();
+	AuthOffloadPool pool(post);
+	pool.grow(2);
+	REQUIRE(pool.threads() == 2);
+	pool.grow(1);
+	REQUIRE(pool.threads() == 2);
+	REQUIRE( ! AuthOffloadIsPoolThread());
+
+	const int num_jobs = 10;
+	std::atomic<int> on_pool {0};
+	int done_on_main = 0;
+	std::vector<int> results(num_jobs, 0);
+	for (int ii = 0; ii < num_jobs; ++ii) {
+		pool.submit("TEST", [&, ii]() {
+			if (AuthOffloadIsPoolThread() && std::this_thread::get_id() != main_id) {
+				++on_pool;
+			}
+			results[ii] = ii + 1;
+		}, [&]() {
+			if (std::this_thread::get_id() == main_id) {
+				++done_on_main;
+			}
+		});
+	}
+	pool.drain();
+	REQUIRE(pump(num_jobs) == num_jobs);
+	REQUIRE(on_pool == num_jobs);
+	REQUIRE(done_on_main == num_jobs);
+	bool all_ran = true;
+	for (int ii = 0; ii < num_jobs; ++ii) {
+		if (results[ii] != ii + 1) all_ran = false;
+	}
+	REQUIRE(all_ran);
+
+	// the threads of the pool run jobs at the same time
+	pool.grow(3);
+	std::mutex mutex;
+	std::condition_variable cv;
+	int arrived = 0;
+	std::atomic<int> met {0};
+	for (int ii = 0; ii < 3; ++ii) {
+		pool.submit("TEST", [&]() {
+			std::unique_lock<std::mutex> lock(mutex);
+			++arrived;
+			cv.notify_all();
+			if (cv.wait_for(lock, std::chrono::seconds(10), [&] { return arrived == 3; })) {
+				++met;
+			}
+		}, nullptr);
+	}
+	pool.drain();
+	REQUIRE(pump(3) == 3);
+	REQUIRE(met == 3);
+}
+
+// a job that is cancelled before it starts never runs
+static void test_cancel_queued()
+{
+	AuthOffloadPool pool(post);
+	pool.grow(1);
+
+	Gate gate;
+	std::atomic<bool> blocker_started {false};
+	bool blocker_done = false;
+	pool.submit("TEST", [&]() { blocker_started = true; gate.wait(); }, [&]() { blocker_done = true; });
+	bool ran = false, done = false;
+	auto job = pool.submit("TEST", [&]() { ran = true; }, [&]() { done = true; });
+	while ( ! blocker_started) {
+		std::this_thread::yield();
+	}
+	pool.cancel(job);
+	gate.open();
+	pool.drain();
+
+	REQUIRE(pump(1) == 1);
+	REQUIRE(blocker_done);
+	REQUIRE( ! ran);
+	REQUIRE( ! done);
+	// cancelling a job again, or one that is gone, does nothing
+	pool.cancel(job);
+	REQUIRE(pump(0) == 0);
+}
+
+// what the work of a job shares with the caller
+struct SharedState {
+	~SharedState() { freed_on = std::this_thread::get_id(); }
+	static std::thread::id freed_on;
+	int result {0};
+};
+std::thread::id SharedState::freed_on;
+
+// cancelling a job that is running doesn't wait for it, and what the work
+// captured is freed on the main thread after it finishes
+static void test_cancel_running()
+{
+	const std::thread::id main_id = std::this_thread::get_id();
+	AuthOffloadPool pool(post);
+	pool.grow(1);
+
+	Gate gate;
+	std::atomic<bool> started {false}, finished {false};
+	bool done = false;
+	auto state = std::make_shared<SharedState>();
+	auto job = pool.submit("TEST", [state, &gate, &started, &finished]() {
+		started = true;
+		gate.wait();
+		state->result = 42;
+		finished = true;
+	}, [&done]() { done = true; });
+	while ( ! started) {
+		std::this_thread::yield();
+	}
+
+	pool.cancel(job);
+	REQUIRE( ! finished);
+	job.reset();
+	state.reset();
+
+	gate.open();
+	pool.drain();
+	REQUIRE(finished);
+	REQUIRE(SharedState::freed_on == std::thread::id());
+	REQUIRE(pump(1) == 1);
+	REQUIRE( ! done);
+	REQUIRE(SharedState::freed_on == main_id);
+}
+
+// drain() waits for the jobs that are queued and running
+static void test_drain()
+{
+	AuthOffloadPool pool(post);
+	pool.grow(2);
+
+	std::atomic<int> ran {0};
+	for (int ii = 0; ii < 6; ++ii) {
+		pool.submit("TEST", [&ran]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			++ran;
+		}, nullptr);
+	}
+	pool.drain();
+	REQUIRE(ran == 6);
+	REQUIRE(pump(6) == 6);
+
+	// draining an idle pool doesn't wait
+	pool.drain();
+}
+
+// the functions that a daemon calls do nothing outside of DaemonCore
+static void test_no_daemon_core()
+{
+	bool ran = false;
+	REQUIRE( ! AuthOffloadRun("TEST", [&ran]() { ran = true; }, nullptr));
+	REQUIRE( ! ran);
+	AuthOffloadCancel(nullptr);
+	AuthOffloadDrain();
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	test_run();
+	test_cancel_queued();
+	test_cancel_running();
+	test_drain();
+	test_no_daemon_core();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
@@ -0,0 +1,306 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the ReliSock send path: condor_writev(), the size of the
+// packets of a long message, and the handshake digest of data that
+// put_bytes() sends without copying it
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "subsystem_info.h"
+#include "reli_sock.h"
+#include "buffers.h"
+#include "condor_rw.h"
+#include "CryptKey.h"
+
+#include <thread>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+// receivers reject packets larger than this, see ReliSock::RcvMsg::rcv_packet()
+#define RECEIVER_MAX_PACKET (1024 * 1024)
+#define HEADER_SIZE 5
+
+static std::string pattern(size_t size, unsigned int seed)
+{
+	std::string data(size, '\0');
+	for (size_t ii = 0; ii < size; ++ii) {
+		seed = seed * 1103515245 + 12345;
+		data[ii] = (char)(seed >> 16);
+	}
+	return data;
+}
+
+// read exactly sz bytes from fd, slowly if chunk is small
+static bool readAll(int fd, char * buf, size_t sz, size_t chunk = 65536)
+{
+	size_t got = 0;
+	while (got < sz) {
+		ssize_t nr = read(fd, buf + got, MIN(chunk, sz - got));
+		if (nr <= 0) {
+			return false;
+		}
+		got += nr;
+		if (chunk < 65536) {
+			usleep(100);
+		}
+	}
+	return true;
+}
+
+// condor_writev() when the socket takes only part of what it is given
+static void test_writev_partial()
+{
+	for (int timeout : { 0, 20 }) {
+		int fds[2];
+		REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+		int sndbuf = 4096;
+		setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+		// fragments of every size, empty ones, and more than IOV_MAX of them
+		std::string data = pattern(3 * 1024 * 1024, timeout + 1);
+		std::vector<struct iovec> iov;
+		size_t pos = 0;
+		for (size_t sz : { (size_t)1, (size_t)0, (size_t)4095, (size_t)300 * 1024, (size_t)0, (size_t)17 }) {
+			iov.push_back({ &data[pos], sz });
+			pos += sz;
+		}
+		for (int ii = 0; ii < IOV_MAX + 100; ++ii) {
+			iov.push_back({ &data[pos], (size_t)(1 + ii % 500) });
+			pos += iov.back().iov_len;
+		}
+		iov.push_back({ &data[pos], data.size() - pos });
+
+		std::string got(data.size(), '\0');
+		bool read_ok = false;
+		std::thread reader([&]() { read_ok = readAll(fds[1], &got[0], got.size(), 1000); });
+		int nw = condor_writev("test", fds[0], iov.data(), (int)iov.size(), timeout);
+		reader.join();
+
+		REQUIRE(nw == (int)data.size());
+		REQUIRE(read_ok);
+		REQUIRE(got == data);
+		close(fds[0]);
+		close(fds[1]);
+	}
+}
+
+struct Packet {
+	bool end;
+	int len;
+};
+
+// read the packets of one message off the raw socket, append their payload to data
+static std::vector<Packet> readPackets(int fd, std::string & data)
+{
+	std::vector<Packet> packets;
+	for (;;) {
+		char hdr[HEADER_SIZE];
+		if ( ! readAll(fd, hdr, HEADER_SIZE)) {
+			break;
+		}
+		int len;
+		memcpy(&len, &hdr[1], 4);
+		len = ntohl(len);
+		packets.push_back({ hdr[0] != 0, len });
+		if (len <= 0 || len > RECEIVER_MAX_PACKET) {
+			break;
+		}
+		size_t pos = data.size();
+		data.resize(pos + len);
+		if ( ! readAll(fd, &data[pos], len) || hdr[0]) {
+			break;
+		}
+	}
+	return packets;
+}
+
+// checks the packets of one message, returns the size of the largest
+static int checkPackets(const std::vector<Packet> & packets)
+{
+	int largest = 0;
+	REQUIRE( ! packets.empty());
+	for (size_t ii = 0; ii < packets.size(); ++ii) {
+		REQUIRE(packets[ii].len > 0);
+		REQUIRE(packets[ii].len <= CONDOR_IO_MAX_BUF_SIZE);
+		REQUIRE(packets[ii].end == (ii + 1 == packets.size()));
+		largest = MAX(largest, packets[ii].len);
+	}
+	return largest;
+}
+
+// the packets of a long message grow up to CONDOR_IO_MAX_BUF_SIZE and no
+// further, which is well under what a receiver accepts
+static void test_packet_sizes()
+{
+	static_assert(CONDOR_IO_MAX_BUF_SIZE + HEADER_SIZE + MAC_SIZE <= RECEIVER_MAX_PACKET,
+		"packets must fit the receiver's limit");
+
+	ReliSock sender, receiver;
+	REQUIRE(sender.connect_socketpair(receiver));
+	sender.timeout(20);
+	int fd = receiver.get_file_desc();
+
+	// many small writes, two messages
+	std::string small = pattern(3 * 1024 * 1024, 7);
+	for (int msg = 0; msg < 2; ++msg) {
+		std::thread writer([&]() {
+			sender.encode();
+			for (size_t pos = 0; pos < small.size(); pos += 100) {
+				sender.put_bytes(&small[pos], (int)MIN(100, small.size() - pos));
+			}
+			sender.end_of_message();
+		});
+		std::string got;
+		std::vector<Packet> packets = readPackets(fd, got);
+		writer.join();
+
+		REQUIRE(got == small);
+		REQUIRE(checkPackets(packets) > CONDOR_IO_MAX_BUF_SIZE / 2);
+		// each message starts with small packets again
+		REQUIRE(packets[0].len <= CONDOR_IO_BUF_SIZE);
+		REQUIRE(packets.size() < small.size() / CONDOR_IO_BUF_SIZE / 4);
+	}
+
+	// a big put_bytes() that is sent without copying it, after a little buffered data
+	std::string big = pattern(3 * 1024 * 1024 + 17, 8);
+	std::thread writer([&]() {
+		sender.encode();
+		sender.put_bytes(&big[0], 10);
+		sender.put_bytes(&big[10], (int)big.size() - 10);
+		sender.end_of_message();
+	});
+	std::string got;
+	std::vector<Packet> packets = readPackets(fd, got);
+	writer.join();
+
+	REQUIRE(got == big);
+	checkPackets(packets);
+	REQUIRE(packets.size() >= big.size() / CONDOR_IO_MAX_BUF_SIZE);
+	// the last byte was buffered so that end_of_message() could send it
+	REQUIRE(packets.back().len >= 1);
+}
+
+// a ReliSock receiver reads the same long messages back
+static void test_receive_long_message()
+{
+	ReliSock sender, receiver;
+	REQUIRE(sender.connect_socketpair(receiver));
+	sender.timeout(20);
+	receiver.timeout(20);
+
+	std::string big = pattern(5 * 1024 * 1024 + 3, 9);
+	std::thread writer([&]() {
+		sender.encode();
+		int len = (int)big.size();
+		sender.code(len);
+		sender.put_bytes(big.data(), len);
+		for (int ii = 0; ii < 100000; ++ii) {
+			sender.code(ii);
+		}
+		sender.end_of_message();
+	});
+
+	receiver.decode();
+	int len = 0;
+	REQUIRE(receiver.code(len) && len == (int)big.size());
+	std::string got(len, '\0');
+	REQUIRE(receiver.get_bytes(&got[0], len) == len);
+	REQUIRE(got == big);
+	bool ints_ok = true;
+	for (int ii = 0; ii < 100000; ++ii) {
+		int val = -1;
+		if ( ! receiver.code(val) || val != ii) { ints_ok = false; break; }
+	}
+	REQUIRE(ints_ok);
+	REQUIRE(receiver.end_of_message());
+	writer.join();
+}
+
+// Data that put_bytes() sends without copying it before AES-GCM is turned on
+// must go into the handshake digest.  If it didn't, the digests of the two
+// ends would differ and the receiver would fail to decrypt the first
+// encrypted packet.
+static void test_digest_covers_direct_send()
+{
+	ReliSock sender, receiver;
+	REQUIRE(sender.connect_socketpair(receiver));
+	sender.timeout(20);
+	receiver.timeout(20);
+
+	// less than the 1MB the digest covers, more than the buffer
+	std::string plain = pattern(300 * 1024, 10);
+	std::thread writer([&]() {
+		sender.encode();
+		sender.put_bytes(plain.data(), 100);
+		sender.put_bytes(&plain[100], (int)plain.size() - 100);
+		sender.end_of_message();
+	});
+	receiver.decode();
+	std::string got(plain.size(), '\0');
+	REQUIRE(receiver.get_bytes(&got[0], (int)got.size()) == (int)got.size());
+	REQUIRE(receiver.end_of_message());
+	writer.join();
+	REQUIRE(got == plain);
+
+	unsigned char key_data[32];
+	memcpy(key_data, "0123456789abcdef0123456789abcdef", sizeof(key_data));
+	KeyInfo key(key_data, sizeof(key_data), CONDOR_AESGCM, 0);
+	REQUIRE(sender.set_crypto_key(true, &key));
+	REQUIRE(receiver.set_crypto_key(true, &key));
+
+	std::string secret = pattern(64 * 1024, 11);
+	std::thread encrypted_writer([&]() {
+		sender.encode();
+		sender.put_bytes(secret.data(), (int)secret.size());
+		sender.end_of_message();
+	});
+	receiver.decode();
+	got.assign(secret.size(), '\0');
+	REQUIRE(receiver.get_bytes(&got[0], (int)got.size()) == (int)got.size());
+	REQUIRE(receiver.end_of_message());
+	encrypted_writer.join();
+	REQUIRE(got == secret);
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	test_writev_partial();
+	test_packet_sizes();
+	test_receive_long_message();
+	test_digest_covers_direct_send();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
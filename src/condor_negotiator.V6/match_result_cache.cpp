@@ -0,0 +1,464 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_attributes.h"
+#include "condor_debug.h"
+#include "compat_classad_util.h"
+#include "stl_string_utils.h"
+
+#include "match_result_cache.h"
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_set>
+
+// what an expression refers to
+struct ExprRefs {
+	bool uncacheable {false};          // the value can change while the ads don't
+	std::vector<std::string> own;      // unscoped and MY. references
+	std::vector<std::string> target;   // TARGET. references
+
+	void clear() { uncacheable = false; own.clear(); target.clear(); }
+};
+
+// Functions whose result depends on something other than their arguments.
+// The ResourcesInUse functions are registered by the negotiator and look
+// at the accountant.
+static bool
+is_uncacheable_function(const std::string &name)
+{
+	static const classad::References names = {
+		"time", "random", "eval",
+		"ResourcesInUseByUser", "ResourcesInUseByUsersGroup",
+	};
+	return names.count(name) > 0;
+}
+
+// Unscoped names that don't refer to an attribute of the ad itself
+static bool
+is_special_name(const std::string &attr)
+{
+	static const classad::References names = {
+		"my", "target", "other", "left", "right", "lctx", "rctx",
+		"toplevel", "root", "self", "parent", "CurrentTime",
+	};
+	return names.count(attr) > 0;
+}
+
+static void
+scan_expr(const classad::ExprTree *tree, ExprRefs &refs)
+{
+	if ( ! tree || refs.uncacheable) return;
+	switch (tree->GetKind()) {
+		case classad::ExprTree::ERROR_LITERAL:
+		case classad::ExprTree::UNDEFINED_LITERAL:
+		case classad::ExprTree::BOOLEAN_LITERAL:
+		case classad::ExprTree::INTEGER_LITERAL:
+		case classad::ExprTree::REAL_LITERAL:
+		case classad::ExprTree::RELTIME_LITERAL:
+		case classad::ExprTree::ABSTIME_LITERAL:
+		case classad::ExprTree::STRING_LITERAL:
+			break;
+
+		case classad::ExprTree::ATTRREF_NODE: {
+			classad::ExprTree *expr = NULL;
+			std::string attr, scope;
+			bool absolute = false;
+			((const classad::AttributeReference*)tree)->GetComponents(expr, attr, absolute);
+			if (absolute) {
+				refs.uncacheable = true;
+			} else if ( ! expr) {
+				if (is_special_name(attr)) {
+					refs.uncacheable = true;
+				} else {
+					refs.own.push_back(attr);
+				}
+			} else if (ExprTreeIsAttrRef(expr, scope) && YourStringNoCase("MY") == scope) {
+				refs.own.push_back(attr);
+			} else if (ExprTreeIsAttrRef(expr, scope) && YourStringNoCase("TARGET") == scope) {
+				refs.target.push_back(attr);
+			} else {
+					// nested ads, LEFT., RIGHT. and the like
+				refs.uncacheable = true;
+			}
+		}
+		break;
+
+		case classad::ExprTree::OP_NODE: {
+			classad::Operation::OpKind op;
+			classad::ExprTree *t1, *t2, *t3;
+			((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+			scan_expr(t1, refs);
+			scan_expr(t2, refs);
+			scan_expr(t3, refs);
+		}
+		break;
+
+		case classad::ExprTree::FN_CALL_NODE: {
+			std::string fnName;
+			std::vector<classad::ExprTree*> args;
+			((const classad::FunctionCall*)tree)->GetComponents(fnName, args);
+			if (is_uncacheable_function(fnName)) {
+				refs.uncacheable = true;
+				break;
+			}
+			for (classad::ExprTree *arg : args) {
+				scan_expr(arg, refs);
+			}
+		}
+		break;
+
+		case classad::ExprTree::CLASSAD_NODE: {
+			std::vector< std::pair<std::string, classad::ExprTree*> > attrs;
+			((const classad::ClassAd*)tree)->GetComponents(attrs);
+			for (auto & it : attrs) {
+				scan_expr(it.second, refs);
+			}
+		}
+		break;
+
+		case classad::ExprTree::EXPR_LIST_NODE: {
+			std::vector<classad::ExprTree*> exprs;
+			((const classad::ExprList*)tree)->GetComponents(exprs);
+			for (classad::ExprTree *expr : exprs) {
+				scan_expr(expr, refs);
+			}
+		}
+		break;
+
+		case classad::ExprTree::EXPR_ENVELOPE:
+			scan_expr(SkipExprEnvelope(const_cast<classad::ExprTree*>(tree)), refs);
+			break;
+	}
+}
+
+static inline uint64_t
+mix64(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static inline uint64_t
+hash_bytes(const char *str, size_t len)
+{
+	return mix64(std::hash<std::string_view>{}(std::string_view(str, len)));
+}
+
+// attribute names are not case sensitive, so neither is their hash
+static uint64_t
+hash_name(const std::string &attr)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (char ch : attr) {
+		h ^= (unsigned char)tolower(ch);
+		h *= 0x100000001b3ULL;
+	}
+	return mix64(h);
+}
+
+// The hash of an attribute and its value.  The hashes of the attributes of
+// an ad are added up, so that the order of the attributes doesn't matter.
+// Literals are hashed without unparsing them.
+static uint64_t
+hash_attr(const std::string &attr, classad::ExprTree *tree, std::string &buffer, bool &is_literal)
+{
+	uint64_t vh = 0;
+	classad::Value val;
+	long long ival;
+	double rval;
+	bool bval;
+	const char *str = NULL;
+
+	is_literal = ExprTreeIsLiteral(tree, val);
+	if ( ! is_literal) {
+		vh = 1;
+	} else if (val.IsIntegerValue(ival)) {
+		vh = mix64(2) ^ mix64((uint64_t)ival);
+	} else if (val.IsRealValue(rval)) {
+		uint64_t bits;
+		memcpy(&bits, &rval, sizeof(bits));
+		vh = mix64(3) ^ mix64(bits);
+	} else if (val.IsBooleanValue(bval)) {
+		vh = mix64(4 + (bval ? 1 : 0));
+	} else if (val.IsStringValue(str)) {
+		vh = mix64(6) ^ hash_bytes(str, strlen(str));
+	} else if (val.IsUndefinedValue()) {
+		vh = mix64(7);
+	} else {
+		vh = 1;
+	}
+
+	if (vh == 1) {
+			// an expression, or a literal of some other type
+		classad::ClassAdUnParser unparser;
+		buffer.clear();
+		unparser.Unparse(buffer, tree);
+		vh = mix64(8) ^ hash_bytes(buffer.data(), buffer.size());
+	}
+	return mix64(hash_name(attr) + 0x9e3779b97f4a7c15ULL * vh);
+}
+
+static uint64_t
+hash_missing_attr(const std::string &attr)
+{
+	return mix64(hash_name(attr) + 0x9e3779b97f4a7c15ULL * mix64(9));
+}
+
+void
+MatchResultCache::clear()
+{
+	m_slots.clear();
+	m_results.clear();
+	m_job_attrs.clear();
+	m_job_attrs_str.clear();
+	m_size = 0;
+}
+
+void
+MatchResultCache::beginCycle(const std::vector<ClassAd *> &slots, const char *job_attrs)
+{
+	m_slots.clear();
+	++m_cycle;
+
+		// the signatures depend on the list of job attributes, so if that
+		// changes none of the results can be found again
+	if ( ! job_attrs) job_attrs = "";
+	if (m_job_attrs_str != job_attrs) {
+		clear();
+		m_job_attrs_str = job_attrs;
+		for (const auto & attr : StringTokenIterator(m_job_attrs_str)) {
+			m_job_attrs.push_back(attr);
+		}
+	}
+
+	m_slots.reserve(slots.size());
+	for (ClassAd *slot : slots) {
+		hashSlot(slot, m_slots[slot]);
+	}
+}
+
+void
+MatchResultCache::endCycle(size_t max_results)
+{
+	std::unordered_set<uint64_t> live;
+	live.reserve(m_slots.size());
+	for (auto & it : m_slots) {
+		if (it.second.hash) {
+			live.insert(it.second.hash);
+		}
+	}
+	m_slots.clear();
+
+	m_size = 0;
+	for (auto it = m_results.begin(); it != m_results.end(); ) {
+		auto & slots = it->second.slots;
+		for (auto jt = slots.begin(); jt != slots.end(); ) {
+			if (live.count(jt->first)) {
+				++jt;
+			} else {
+				jt = slots.erase(jt);
+			}
+		}
+		if (slots.empty()) {
+			it = m_results.erase(it);
+		} else {
+			m_size += slots.size();
+			++it;
+		}
+	}
+
+	if (m_size > max_results) {
+		std::vector<std::pair<long long, uint64_t>> lru;
+		lru.reserve(m_results.size());
+		for (auto & it : m_results) {
+			lru.emplace_back(it.second.last_cycle, it.first);
+		}
+		std::sort(lru.begin(), lru.end());
+		for (auto & it : lru) {
+			if (m_size <= max_results) {
+				break;
+			}
+			auto jt = m_results.find(it.second);
+			m_size -= jt->second.slots.size();
+			m_results.erase(jt);
+		}
+	}
+
+	dprintf(D_FULLDEBUG, "MatchResultCache: keeping %zu results for %zu request signatures\n",
+		m_size, m_results.size());
+}
+
+void
+MatchResultCache::refresh(ClassAd *slot)
+{
+	auto it = m_slots.find(slot);
+	if (it != m_slots.end()) {
+		hashSlot(slot, it->second);
+	}
+}
+
+void
+MatchResultCache::hashSlot(ClassAd *slot, SlotHash &sh)
+{
+	sh.hash = 0;
+	sh.uncacheable.clear();
+
+	uint64_t hash = 0;
+	classad::References uncacheable;
+	std::vector<std::pair<std::string, std::vector<std::string>>> exprs;
+	ExprRefs refs;
+	bool is_literal;
+	for (auto & it : *slot) {
+		hash += hash_attr(it.first, it.second, m_buffer, is_literal);
+		if (is_literal) {
+			continue;
+		}
+		refs.clear();
+		scan_expr(it.second, refs);
+		if (refs.uncacheable) {
+			uncacheable.insert(it.first);
+		} else if ( ! refs.own.empty()) {
+			exprs.emplace_back(it.first, std::move(refs.own));
+		}
+	}
+
+		// an attribute that refers to an uncacheable one is uncacheable too
+	bool changed = ! uncacheable.empty();
+	while (changed) {
+		changed = false;
+		for (auto & expr : exprs) {
+			if (uncacheable.count(expr.first)) {
+				continue;
+			}
+			for (auto & ref : expr.second) {
+				if (uncacheable.count(ref)) {
+					uncacheable.insert(expr.first);
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (uncacheable.count(ATTR_REQUIREMENTS)) {
+		return;
+	}
+	sh.uncacheable.assign(uncacheable.begin(), uncacheable.end());
+	sh.hash = hash ? hash : 1;
+}
+
+void
+MatchResultCache::signature(ClassAd &request, Signature &sig)
+{
+	sig.hash = 0;
+	sig.target_refs.clear();
+	sig.results = NULL;
+
+		// everything that matching the request to a slot can look at in
+		// the request: its Requirements and Rank, the attributes that slot
+		// ads refer to, and what those refer to in turn
+	std::vector<std::string> todo = { ATTR_REQUIREMENTS, ATTR_RANK };
+	todo.insert(todo.end(), m_job_attrs.begin(), m_job_attrs.end());
+
+	classad::References seen;
+	uint64_t hash = 0;
+	ExprRefs refs;
+	bool is_literal;
+	for (size_t ix = 0; ix < todo.size(); ++ix) {
+		std::string attr = todo[ix];
+		if ( ! seen.insert(attr).second) {
+			continue;
+		}
+		classad::ExprTree *tree = request.Lookup(attr);
+		if ( ! tree) {
+				// an unscoped reference to a missing attribute is looked up in the slot ad
+			sig.target_refs.insert(attr);
+			hash += hash_missing_attr(attr);
+			continue;
+		}
+		hash += hash_attr(attr, tree, m_buffer, is_literal);
+		if (is_literal) {
+			continue;
+		}
+		refs.clear();
+		scan_expr(tree, refs);
+		if (refs.uncacheable) {
+			return;
+		}
+		todo.insert(todo.end(), refs.own.begin(), refs.own.end());
+		sig.target_refs.insert(refs.target.begin(), refs.target.end());
+	}
+
+	sig.hash = hash ? hash : 1;
+	JobResults &results = m_results[sig.hash];
+	results.last_cycle = m_cycle;
+	sig.results = &results;
+}
+
+const MatchResultCache::SlotHash *
+MatchResultCache::usableSlot(const Signature &sig, const ClassAd *slot) const
+{
+	if ( ! sig.results) {
+		return NULL;
+	}
+	auto it = m_slots.find(slot);
+	if (it == m_slots.end() || ! it->second.hash) {
+		return NULL;
+	}
+	for (const auto & attr : it->second.uncacheable) {
+		if (sig.target_refs.count(attr)) {
+			return NULL;
+		}
+	}
+	return &it->second;
+}
+
+MatchResultCache::Result *
+MatchResultCache::find(const Signature &sig, const ClassAd *slot)
+{
+	const SlotHash *sh = usableSlot(sig, slot);
+	if ( ! sh) {
+		return NULL;
+	}
+	auto it = sig.results->slots.find(sh->hash);
+	return (it == sig.results->slots.end()) ? NULL : &it->second;
+}
+
+MatchResultCache::Result *
+MatchResultCache::insert(const Signature &sig, const ClassAd *slot, bool match)
+{
+	const SlotHash *sh = usableSlot(sig, slot);
+	if ( ! sh) {
+		return NULL;
+	}
+	auto ins = sig.results->slots.try_emplace(sh->hash);
+	if (ins.second) {
+		++m_size;
+	}
+	Result &result = ins.first->second;
+	result = Result();
+	result.match = match;
+	return &result;
+}
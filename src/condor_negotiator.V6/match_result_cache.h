@@ -0,0 +1,117 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __MATCH_RESULT_CACHE_H__
+#define __MATCH_RESULT_CACHE_H__
+
+#include "condor_classad.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The results of matching requests to slot ads, kept from one negotiation
+// cycle to the next.
+//
+// A result is found by the signature of the request, which is a hash of
+// the values of the attributes that matching can look at in the request
+// (Requirements, Rank, the job attributes that slot ads refer to, and
+// whatever those refer to), and by a hash of the whole slot ad.  So all of
+// the requests of an autocluster share results, and a slot ad that comes
+// back from the collector unchanged in the next cycle finds its results
+// again.  A slot ad that changes gets a new hash, and the results for the
+// old one are dropped at the end of the cycle.
+//
+// Expressions whose value can change while the ads stay the same, like
+// time() or random(), can't be cached.  A request that has one gets no
+// signature, a slot ad whose Requirements has one gets no hash, and a
+// request that refers to such a slot attribute can't use the results for
+// that slot.
+class MatchResultCache
+{
+private:
+	struct JobResults;
+
+public:
+	struct Result {
+		double rank {0.0};       // the Rank of the request for the slot, if has_rank
+		bool match {false};
+		bool has_rank {false};
+	};
+
+	// what a request's matches depend on, see signature()
+	struct Signature {
+		uint64_t hash {0};                 // 0 if the request can't use the cache
+		classad::References target_refs;   // slot attributes the request refers to
+		JobResults *results {NULL};
+	};
+
+	MatchResultCache() {}
+	MatchResultCache(const MatchResultCache &) = delete;
+	MatchResultCache &operator=(const MatchResultCache &) = delete;
+
+	// hash the slot ads of a negotiation cycle.  job_attrs is the list of
+	// job attributes that the slot ads refer to.
+	void beginCycle(const std::vector<ClassAd *> &slots, const char *job_attrs);
+
+	// drop the results for slot ads that changed or went away, and the
+	// least recently used requests when there are more than max_results.
+	void endCycle(size_t max_results);
+
+	void clear();
+
+	// hash a slot ad again after it was changed
+	void refresh(ClassAd *slot);
+
+	void signature(ClassAd &request, Signature &sig);
+
+	// the cached result of matching the request to a slot, or NULL
+	Result *find(const Signature &sig, const ClassAd *slot);
+
+	// remember the result of matching the request to a slot.
+	// returns NULL if the result can't be cached.
+	Result *insert(const Signature &sig, const ClassAd *slot, bool match);
+
+	size_t size() const { return m_size; }
+
+private:
+	struct SlotHash {
+		uint64_t hash {0};                     // 0 if the slot can't use the cache
+		std::vector<std::string> uncacheable;  // attributes that can change without the ad changing
+	};
+
+	struct JobResults {
+		std::unordered_map<uint64_t, Result> slots;   // by slot ad hash
+		long long last_cycle {0};
+	};
+
+	void hashSlot(ClassAd *slot, SlotHash &sh);
+	const SlotHash *usableSlot(const Signature &sig, const ClassAd *slot) const;
+
+	std::unordered_map<const ClassAd *, SlotHash> m_slots;
+	std::unordered_map<uint64_t, JobResults> m_results;   // by request signature
+	std::vector<std::string> m_job_attrs;
+	std::string m_job_attrs_str;
+	std::string m_buffer;
+	size_t m_size {0};
+	long long m_cycle {0};
+};
+
+#endif
@@ -105,6 +105,12 @@ public:
     int pies;
     int pie_spins;
 
+    // timing of the parallel matches, see NEGOTIATOR_NUM_THREADS
+    MatchThreadPoolStats parallel_match;
+
+    int match_cache_hits;
+    int match_cache_misses;
+
     // set of unique active schedd, id by sinful strings:
     std::set<std::string> active_schedds;
 
@@ -142,6 +148,9 @@ NegotiationCycleStats::NegotiationCycleStats():
 	rejections(0),
     pies(0),
     pie_spins(0),
+    parallel_match(),
+    match_cache_hits(0),
+    match_cache_misses(0),
     active_schedds(),
     active_submitters(),
     submitters_share_limit(),
@@ -436,6 +445,9 @@ Matchmaker ()
 
 	want_globaljobprio = false;
 	want_matchlist_caching = false;
+	want_slot_prefilter = true;
+	want_match_cache = true;
+	match_cache_max_results = 0;
 	PublishCrossSlotPrios = false;
 	ConsiderPreemption = true;
 	ConsiderEarlyPreemption = false;
@@ -812,6 +824,12 @@ reinitialize ()
 
 	want_globaljobprio = param_boolean("USE_GLOBAL_JOB_PRIOS",false);
 	want_matchlist_caching = param_boolean("NEGOTIATOR_MATCHLIST_CACHING",true);
+	want_slot_prefilter = param_boolean("NEGOTIATOR_PREFILTER_SLOTS",true);
+	matchThreadPool.resize(param_integer("NEGOTIATOR_NUM_THREADS", 1));
+	want_match_cache = param_boolean("NEGOTIATOR_MATCH_CACHE",true);
+	match_cache_max_results = param_integer("NEGOTIATOR_MATCH_CACHE_MAX_RESULTS", 4000000, 0);
+		// the cached results may depend on the old configuration
+	matchResultCache.clear();
 	PublishCrossSlotPrios = param_boolean("NEGOTIATOR_CROSS_SLOT_PRIOS", false);
 	ConsiderPreemption = param_boolean("NEGOTIATOR_CONSIDER_PREEMPTION",true);
 	ConsiderEarlyPreemption = param_boolean("NEGOTIATOR_CONSIDER_EARLY_PREEMPTION",false);
@@ -1812,6 +1830,19 @@ Matchmaker::negotiationTime( int /* timerID */ )
 	// available during matchmaking
 	addRemoteUserPrios( startdAds );
 
+	// the slot ads won't change from here on except through matches,
+	// which refresh their rows, so the columns are good for the whole cycle
+	if (want_slot_prefilter) {
+		slotAdColumns.build(startdAds);
+	} else {
+		slotAdColumns.clear();
+	}
+	if (want_match_cache) {
+		matchResultCache.beginCycle(startdAds, job_attr_references);
+	} else {
+		matchResultCache.clear();
+	}
+
 	SetupMatchSecurity(submitterAds);
 
     if (hgq_groups.size() <= 1) {
@@ -1900,6 +1931,11 @@ Matchmaker::negotiationTime( int /* timerID */ )
     // ----- Done with the negotiation cycle
     dprintf( D_ALWAYS, "---------- Finished Negotiation Cycle ----------\n" );
 
+	slotAdColumns.clear();
+	if (want_match_cache) {
+		matchResultCache.endCycle(match_cache_max_results);
+	}
+
 	startedLastCycleTime = start_time;
     completedLastCycleTime = time(NULL);
 
@@ -4173,6 +4209,7 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
 			// 2e(ii).  perform the matchmaking protocol
 			result = matchmakingProtocol (request, offer, claimIds, sock,
 					submitterName, scheddAddr.c_str());
+			refreshSlotAd(offer);
 
 			// 2e(iii). if the matchmaking protocol failed, do not consider the
 			//			startd again for this negotiation cycle.
@@ -4244,6 +4281,7 @@ negotiate(char const* groupName, char const *submitterName, const ClassAd *submi
             // traditional match cost is just slot weight expression
             match_cost = accountant.GetSlotWeight(offer);
         }
+		refreshSlotAd(offer);
         dprintf(D_FULLDEBUG, "Match completed, match cost= %g\n", match_cost);
 
 		if (param_boolean("NEGOTIATOR_DEPTH_FIRST", false)) {
@@ -4590,10 +4628,32 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 	std::vector<ClassAd *> par_candidates;
 	std::vector<ClassAd *> par_matches;
 
-	int num_threads =  param_integer("NEGOTIATOR_NUM_THREADS", 1);
+		// Rule out the slots that fail a simple clause of the request's
+		// Requirements, like TARGET.Memory >= 2048, without a full match
+	SlotAdPrefilter prefilter;
+	if (prefilter.evaluate(request, slotAdColumns)) {
+		dprintf(D_FULLDEBUG, "matchmakingAlgorithm: %zu Requirements clauses rule out %zu of %zu slots\n",
+				prefilter.numClauses(), prefilter.numRejected(), slotAdColumns.size());
+	}
+
+		// Match results from this or earlier cycles for requests with
+		// the same signature, and slot ads that have not changed since
+	MatchResultCache::Signature matchSignature;
+	if (want_match_cache) {
+		matchResultCache.signature(request, matchSignature);
+	}
+
+	int num_threads = matchThreadPool.threads();
 	if (num_threads > 1) {
-		par_candidates = startdAds;
-		ParallelIsAMatch(&request, par_candidates, par_matches, num_threads, false);
+		par_candidates.reserve(startdAds.size());
+		for (ClassAd *candidate: startdAds) {
+			if ( ! prefilter.rejects(slotAdColumns, candidate) &&
+				 ! matchResultCache.find(matchSignature, candidate)) {
+				par_candidates.push_back(candidate);
+			}
+		}
+		matchThreadPool.match(&request, par_candidates, par_matches, false,
+				&negotiation_cycle_stats[0]->parallel_match);
 	}
 
 	// scan the offer ads
@@ -4665,12 +4725,30 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
         // requested via consumption policy must also be available from
         // the resource
 		bool is_a_match = false;
-		if (num_threads > 1) {
-			is_a_match = cp_sufficient &&
-				(par_matches.end() !=
-					std::find(par_matches.begin(), par_matches.end(), candidate));
+		// the prefilter and the cache have the request as it is without the consumption policy
+		bool prefiltered = ! has_cp && prefilter.rejects(slotAdColumns, candidate);
+		MatchResultCache::Result *cachedResult = NULL;
+		if ( ! has_cp && ! prefiltered) {
+			cachedResult = matchResultCache.find(matchSignature, candidate);
+		}
+		if (cachedResult) {
+			// slots with a cached result were left out of par_candidates
+			is_a_match = cachedResult->match;
+			negotiation_cycle_stats[0]->match_cache_hits++;
 		} else {
-			is_a_match = cp_sufficient && IsAMatch(&request, candidate);
+			if (num_threads > 1) {
+				is_a_match = cp_sufficient &&
+					(par_matches.end() !=
+						std::find(par_matches.begin(), par_matches.end(), candidate));
+			} else {
+				is_a_match = cp_sufficient && ! prefiltered && IsAMatch(&request, candidate);
+			}
+			if ( ! has_cp && ! prefiltered) {
+				cachedResult = matchResultCache.insert(matchSignature, candidate, is_a_match);
+				if (cachedResult) {
+					negotiation_cycle_stats[0]->match_cache_misses++;
+				}
+			}
 		}
 
         if (has_cp) {
@@ -4828,7 +4906,17 @@ matchmakingAlgorithm(const char *submitterName, const char *scheddAddr, const ch
 			}
 		}
 
-		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue);
+			// the Rank is cached along with the match, unless the slot only
+			// matched after pslotMultiMatch() changed it
+		if (cachedResult && ( ! cachedResult->match || m_staticRanks)) {
+			cachedResult = NULL;
+		}
+		calculateRanks(request, candidate, candidatePreemptState, candidateRankValue, candidatePreJobRankValue, candidatePostJobRankValue, candidatePreemptRankValue,
+			(cachedResult && cachedResult->has_rank) ? &cachedResult->rank : NULL);
+		if (cachedResult && ! cachedResult->has_rank) {
+			cachedResult->rank = candidateRankValue;
+			cachedResult->has_rank = true;
+		}
 
 		if ( MatchList ) {
 			MatchList->add_candidate(
@@ -4946,7 +5034,8 @@ calculateRanks(ClassAd &request,
                double &candidateRankValue,
                double &candidatePreJobRankValue,
                double &candidatePostJobRankValue,
-               double &candidatePreemptRankValue
+               double &candidatePreemptRankValue,
+               const double *knownRankValue
               )
 {
 	if (m_staticRanks) {
@@ -4969,7 +5058,9 @@ calculateRanks(ClassAd &request,
 
 	// calculate the request's rank of the candidate
 	double tmp;
-	if(!EvalFloat(ATTR_RANK, &request, candidate, tmp)) {
+	if (knownRankValue) {
+		tmp = *knownRankValue;
+	} else if(!EvalFloat(ATTR_RANK, &request, candidate, tmp)) {
 		tmp = 0.0;
 	}
 	candidateRankValue = tmp;
@@ -4995,6 +5086,13 @@ calculateRanks(ClassAd &request,
 	}
 }
 
+void Matchmaker::
+refreshSlotAd(ClassAd *slot)
+{
+	slotAdColumns.refresh(slot);
+	matchResultCache.refresh(slot);
+}
+
 	// NOTE NOTE: this assumes that p-slots are not being preempted.
 bool Matchmaker::
 returnPslotToMatchList(ClassAd &request, ClassAd *offer)
@@ -5831,6 +5929,7 @@ void Matchmaker::DeleteMatchList()
 	// original state (i.e. restore them back to how we got them from the collector).
 	for (auto i = unmutatedSlotAds.begin(); i != unmutatedSlotAds.end(); i++) {
 		(i->first)->Update(*(i->second));  // restore backup ad (i.second) attrs into machine ad (i.first)
+		refreshSlotAd(i->first);
 		delete i->second;  // deallocate backup ad (i.second)
 	}
 	unmutatedSlotAds.clear();
@@ -6231,7 +6330,13 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
         ATTR_LAST_NEGOTIATION_CYCLE_SUBMITTERS_SHARE_LIMIT,
         ATTR_LAST_NEGOTIATION_CYCLE_ACTIVE_SUBMITTER_COUNT,
         ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE,
-        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE_SUSTAINED
+        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE_SUSTAINED,
+        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_CACHE_HITS,
+        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_CACHE_MISSES,
+        ATTR_LAST_NEGOTIATION_CYCLE_MATCH_THREADS,
+        ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_DURATION,
+        ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_SPEEDUP,
+        ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_EFFICIENCY
     };
     const int nattrs = sizeof(attrs)/sizeof(*attrs);
 
@@ -6270,6 +6375,8 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE, i, (s->duration > 0) ? (double)(s->matches)/double(s->duration) : double(0.0));
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_RATE_SUSTAINED, i, (period > 0) ? (double)(s->matches)/double(period) : double(0.0));
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_ACTIVE_SUBMITTER_COUNT, i, (int)s->active_submitters.size());
+		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_CACHE_HITS, i, s->match_cache_hits);
+		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_CACHE_MISSES, i, s->match_cache_misses);
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PIES, i, s->pies );
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PIE_SPINS, i, s->pie_spins );
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PREFETCH_DURATION, i, s->prefetch_duration );
@@ -6284,6 +6391,12 @@ Matchmaker::publishNegotiationCycleStats( ClassAd *ad )
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_SUBMITTERS_FAILED, i, s->submitters_failed);
 		SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_SUBMITTERS_OUT_OF_TIME, i, s->submitters_out_of_time);
         SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_SUBMITTERS_SHARE_LIMIT, i, s->submitters_share_limit);
+		if (s->parallel_match.calls > 0) {
+			SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_MATCH_THREADS, i, s->parallel_match.threads);
+			SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_DURATION, i, s->parallel_match.wall_time);
+			SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_SPEEDUP, i, s->parallel_match.speedup());
+			SetAttrN( ad, ATTR_LAST_NEGOTIATION_CYCLE_PARALLEL_MATCH_EFFICIENCY, i, s->parallel_match.efficiency());
+		}
 	}
 }
 
@@ -6533,6 +6646,7 @@ Matchmaker::pslotMultiMatch(ClassAd *job, ClassAd *machine, const char *submitte
 			// Stash away all the attributes we mutated in the slot ad so we can restore it
 			// when/if we purge the match list in DeleteMatchList().
 			unmutatedSlotAds.emplace_back(machine, backupAd );
+			refreshSlotAd(machine);
 
 			// Note we do not want to delete backupAd when returning here, since we handed off this
 			// pointer to unmutatedSlotAds above; it will be deleted in DeleteMatchList().
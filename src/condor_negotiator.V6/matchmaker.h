@@ -29,6 +29,9 @@
 #include "condor_ver_info.h"
 #include "matchmaker_negotiate.h"
 #include "GroupEntry.h"
+#include "slot_ad_columns.h"
+#include "match_thread_pool.h"
+#include "match_result_cache.h"
 
 #include <vector>
 #include <string>
@@ -94,7 +97,7 @@ class Matchmaker : public Service
 		void forwardAccountingData(std::set<std::string> &names);
 		void forwardGroupAccounting(GroupEntry *ge);
 
-		void calculateRanks(ClassAd &request, ClassAd *offer, PreemptState candidatePreemptState, double &candidateRankValue, double &candidatePreJobRankValue, double &candidatePostJobRankValue, double &candidatePreemptRankValue);
+		void calculateRanks(ClassAd &request, ClassAd *offer, PreemptState candidatePreemptState, double &candidateRankValue, double &candidatePreJobRankValue, double &candidatePostJobRankValue, double &candidatePreemptRankValue, const double *knownRankValue = NULL);
 
 		void setDryRun(bool d) {m_dryrun = d;}
 		bool getDryRun() const {return m_dryrun;}
@@ -284,6 +287,10 @@ class Matchmaker : public Service
 		friend struct submitterLessThan;
 
 		std::vector<std::pair<ClassAd*,ClassAd*> > unmutatedSlotAds;
+		SlotAdColumns slotAdColumns;	// literal slot ad values for the prefilter, rebuilt each cycle
+		MatchThreadPool matchThreadPool;	// sized by NEGOTIATOR_NUM_THREADS
+		MatchResultCache matchResultCache;	// match results kept across cycles
+		void refreshSlotAd(ClassAd *slot);	// after the negotiator changes a slot ad
 		std::map<std::string, ClassAd *> m_slotNameToAdMap;
 
 		bool pslotMultiMatch(ClassAd *job, ClassAd *machine, const char* submitterName,
@@ -332,6 +339,9 @@ class Matchmaker : public Service
 		ExprTree *NegotiatorPostJobRank; // rank applied after job rank
 		bool want_globaljobprio;	// cached value of config knob USE_GLOBAL_JOB_PRIOS
 		bool want_matchlist_caching;	// should we cache matches per autocluster?
+		bool want_slot_prefilter;	// check simple Requirements clauses against slot ad columns
+		bool want_match_cache;		// keep match results across cycles
+		int match_cache_max_results;
 		bool PublishCrossSlotPrios; // value of knob NEGOTIATOR_CROSS_SLOT_PRIOS, default of false
 		bool ConsiderPreemption; // if false, negotiation is faster (default=true)
 		bool ConsiderEarlyPreemption; // if false, do not preempt slots that still have retirement time
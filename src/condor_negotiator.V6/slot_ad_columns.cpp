@@ -0,0 +1,462 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+
+#include "slot_ad_columns.h"
+
+#include <math.h>
+
+// integers beyond this can't be compared exactly as doubles
+static const double MAX_EXACT_INTEGER = 9007199254740992.0; // 2^53
+
+// Names that an unscoped lookup in a slot ad does not treat as missing
+// when the slot ad doesn't have them, because the match ad or the
+// evaluator itself defines them.
+static bool
+is_match_scope_name(const std::string &attr)
+{
+	static const classad::References names = {
+		"my", "target", "other", "ad", "left", "right", "lctx", "rctx",
+		"symmetricMatch", "leftMatchesRight", "rightMatchesLeft",
+		"leftRankValue", "rightRankValue",
+		"toplevel", "root", "self", "parent",
+	};
+	return names.count(attr) > 0;
+}
+
+void
+SlotAdColumns::clear()
+{
+	m_ads.clear();
+	m_rows.clear();
+	m_columns.clear();
+	m_strings.clear();
+	m_folded.clear();
+}
+
+void
+SlotAdColumns::build(const std::vector<ClassAd *> &ads)
+{
+	clear();
+	m_ads = ads;
+	m_rows.reserve(ads.size());
+	for (size_t row = 0; row < m_ads.size(); ++row) {
+		m_rows[m_ads[row]] = (int)row;
+	}
+}
+
+void
+SlotAdColumns::refresh(ClassAd *ad)
+{
+	int row = this->row(ad);
+	if (row < 0) {
+		return;
+	}
+	for (auto & it : m_columns) {
+		project(it.second, it.first, row);
+	}
+}
+
+const SlotAdColumns::Column *
+SlotAdColumns::column(const std::string &attr)
+{
+	if (is_match_scope_name(attr)) {
+		return NULL;
+	}
+
+	auto it = m_columns.find(attr);
+	if (it != m_columns.end()) {
+		return &it->second;
+	}
+
+	Column &col = m_columns[attr];
+	size_t rows = m_ads.size();
+	col.kind.resize(rows, CELL_OTHER);
+	col.num.resize(rows, 0.0);
+	col.str.resize(rows, -1);
+	col.folded.resize(rows, -1);
+	for (size_t row = 0; row < rows; ++row) {
+		project(col, attr, row);
+	}
+	return &col;
+}
+
+int
+SlotAdColumns::stringId(const std::string &str) const
+{
+	auto it = m_strings.find(str);
+	return (it == m_strings.end()) ? -1 : it->second;
+}
+
+int
+SlotAdColumns::foldedStringId(const std::string &str) const
+{
+	std::string lower(str);
+	lower_case(lower);
+	auto it = m_folded.find(lower);
+	return (it == m_folded.end()) ? -1 : it->second;
+}
+
+int
+SlotAdColumns::internString(const std::string &str, std::unordered_map<std::string, int> &ids)
+{
+	auto it = ids.emplace(str, (int)ids.size());
+	return it.first->second;
+}
+
+void
+SlotAdColumns::project(Column &col, const std::string &attr, size_t row)
+{
+	unsigned char kind = CELL_OTHER;
+	double num = 0.0;
+	int str = -1, folded = -1;
+
+	classad::ExprTree *tree = m_ads[row]->Lookup(attr);
+	classad::Value val;
+	if ( ! tree) {
+		kind = CELL_UNDEFINED;
+	} else if (ExprTreeIsLiteral(tree, val)) {
+		long long ival;
+		double rval;
+		bool bval;
+		std::string sval;
+		if (val.IsUndefinedValue()) {
+			kind = CELL_UNDEFINED;
+		} else if (val.IsIntegerValue(ival)) {
+			if (fabs((double)ival) < MAX_EXACT_INTEGER) {
+				kind = CELL_INTEGER;
+				num = (double)ival;
+			}
+		} else if (val.IsRealValue(rval)) {
+			if ( ! std::isnan(rval)) {
+				kind = CELL_REAL;
+				num = rval;
+			}
+		} else if (val.IsBooleanValue(bval)) {
+			kind = CELL_BOOL;
+			num = bval ? 1.0 : 0.0;
+		} else if (val.IsStringValue(sval)) {
+			kind = CELL_STRING;
+			str = internString(sval, m_strings);
+			lower_case(sval);
+			folded = internString(sval, m_folded);
+		}
+	}
+
+	col.kind[row] = kind;
+	col.num[row] = num;
+	col.str[row] = str;
+	col.folded[row] = folded;
+}
+
+
+// Returns the name of the slot attribute if the tree is a reference
+// to an attribute of the slot ad, in the form TARGET.attr or the
+// .RIGHT.attr that matchmaking optimization turns that into.
+static bool
+is_slot_attr_ref(classad::ExprTree *tree, ClassAd &request, std::string &attr)
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree || tree->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+		return false;
+	}
+	classad::ExprTree *scope = NULL;
+	bool absolute = false;
+	((classad::AttributeReference*)tree)->GetComponents(scope, attr, absolute);
+	if ( ! scope || absolute || scope->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+		return false;
+	}
+
+	std::string scope_name;
+	classad::ExprTree *outer = NULL;
+	((classad::AttributeReference*)scope)->GetComponents(outer, scope_name, absolute);
+	if (outer) {
+		return false;
+	}
+	if (absolute) {
+		return strcasecmp(scope_name.c_str(), "RIGHT") == 0;
+	}
+	return strcasecmp(scope_name.c_str(), "TARGET") == 0 && ! request.Lookup("TARGET");
+}
+
+// Returns the value if the tree is a literal or a reference to an
+// attribute of the request that is a literal.
+static bool
+is_request_constant(classad::ExprTree *tree, ClassAd &request, classad::Value &val)
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree) {
+		return false;
+	}
+	if (ExprTreeIsLiteral(tree, val)) {
+		return true;
+	}
+	if (tree->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+		return false;
+	}
+
+	classad::ExprTree *scope = NULL;
+	std::string attr;
+	bool absolute = false;
+	((classad::AttributeReference*)tree)->GetComponents(scope, attr, absolute);
+	if (absolute || is_match_scope_name(attr)) {
+		return false;
+	}
+	if (scope) {
+		// MY.attr
+		std::string scope_name;
+		classad::ExprTree *outer = NULL;
+		if (scope->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+			return false;
+		}
+		((classad::AttributeReference*)scope)->GetComponents(outer, scope_name, absolute);
+		if (outer || absolute || strcasecmp(scope_name.c_str(), "MY") != 0 || request.Lookup("MY")) {
+			return false;
+		}
+	}
+	classad::ExprTree *expr = request.Lookup(attr);
+	return expr && ExprTreeIsLiteral(expr, val);
+}
+
+bool
+SlotAdPrefilter::evaluate(ClassAd &request, SlotAdColumns &columns)
+{
+	m_active = false;
+	m_clauses.clear();
+	m_rejected = 0;
+
+	classad::ExprTree *requirements = request.Lookup(ATTR_REQUIREMENTS);
+	if (columns.empty() || ! requirements) {
+		return false;
+	}
+	collect(requirements, request, columns);
+	if (m_clauses.empty()) {
+		return false;
+	}
+
+	m_pass.assign(columns.size(), 1);
+	for (const auto & clause : m_clauses) {
+		apply(clause);
+	}
+	for (unsigned char pass : m_pass) {
+		m_rejected += ! pass;
+	}
+	m_active = true;
+	return true;
+}
+
+void
+SlotAdPrefilter::collect(classad::ExprTree *tree, ClassAd &request, SlotAdColumns &columns)
+{
+	tree = SkipExprEnvelope(tree);
+	if ( ! tree) {
+		return;
+	}
+	if (tree->GetKind() == classad::ExprTree::OP_NODE) {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+		((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op == classad::Operation::PARENTHESES_OP) {
+			collect(t1, request, columns);
+			return;
+		}
+		if (op == classad::Operation::LOGICAL_AND_OP) {
+			collect(t1, request, columns);
+			collect(t2, request, columns);
+			return;
+		}
+	}
+	addClause(tree, request, columns);
+}
+
+bool
+SlotAdPrefilter::addClause(classad::ExprTree *tree, ClassAd &request, SlotAdColumns &columns)
+{
+	Clause clause{NULL, CLAUSE_TRUE, SlotAdColumns::CELL_OTHER, 0.0, -1, -1};
+	std::string attr;
+	classad::Value val;
+
+	if (is_slot_attr_ref(tree, request, attr)) {
+		clause.op = CLAUSE_TRUE;
+		clause.col = columns.column(attr);
+		if ( ! clause.col) {
+			return false;
+		}
+	} else {
+		if (tree->GetKind() != classad::ExprTree::OP_NODE) {
+			return false;
+		}
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1 = NULL, *t2 = NULL, *t3 = NULL;
+		((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op < classad::Operation::__COMPARISON_START__ || op > classad::Operation::__COMPARISON_END__ || ! t1 || ! t2) {
+			return false;
+		}
+
+		bool flip = false;
+		if (is_slot_attr_ref(t1, request, attr) && is_request_constant(t2, request, val)) {
+			flip = false;
+		} else if (is_slot_attr_ref(t2, request, attr) && is_request_constant(t1, request, val)) {
+			flip = true;
+		} else {
+			return false;
+		}
+
+			// the slot attribute always goes on the left
+		switch (op) {
+		case classad::Operation::LESS_THAN_OP:         clause.op = flip ? CLAUSE_GT : CLAUSE_LT; break;
+		case classad::Operation::LESS_OR_EQUAL_OP:     clause.op = flip ? CLAUSE_GE : CLAUSE_LE; break;
+		case classad::Operation::GREATER_THAN_OP:      clause.op = flip ? CLAUSE_LT : CLAUSE_GT; break;
+		case classad::Operation::GREATER_OR_EQUAL_OP:  clause.op = flip ? CLAUSE_LE : CLAUSE_GE; break;
+		case classad::Operation::EQUAL_OP:             clause.op = CLAUSE_EQ; break;
+		case classad::Operation::NOT_EQUAL_OP:         clause.op = CLAUSE_NE; break;
+		case classad::Operation::META_EQUAL_OP:        clause.op = CLAUSE_IS; break;
+		case classad::Operation::META_NOT_EQUAL_OP:    clause.op = CLAUSE_ISNT; break;
+		default:
+			return false;
+		}
+
+			// fill in the column first, so the ids of its strings are known
+		clause.col = columns.column(attr);
+		if ( ! clause.col) {
+			return false;
+		}
+
+		long long ival;
+		bool bval;
+		if (val.IsUndefinedValue()) {
+			// only =?= and =!= give a definite answer for undefined
+			if (clause.op != CLAUSE_IS && clause.op != CLAUSE_ISNT) {
+				return false;
+			}
+			clause.kind = SlotAdColumns::CELL_UNDEFINED;
+		} else if (val.IsIntegerValue(ival)) {
+			if (fabs((double)ival) >= MAX_EXACT_INTEGER) {
+				return false;
+			}
+			clause.kind = SlotAdColumns::CELL_INTEGER;
+			clause.num = (double)ival;
+		} else if (val.IsRealValue(clause.num)) {
+			if (std::isnan(clause.num)) {
+				return false;
+			}
+			clause.kind = SlotAdColumns::CELL_REAL;
+		} else if (val.IsBooleanValue(bval)) {
+			clause.kind = SlotAdColumns::CELL_BOOL;
+			clause.num = bval ? 1.0 : 0.0;
+		} else if (val.IsStringValue()) {
+			// ordering of strings is not checked
+			if (clause.op != CLAUSE_EQ && clause.op != CLAUSE_NE &&
+				clause.op != CLAUSE_IS && clause.op != CLAUSE_ISNT) {
+				return false;
+			}
+			std::string sval;
+			val.IsStringValue(sval);
+			clause.kind = SlotAdColumns::CELL_STRING;
+			clause.str = columns.stringId(sval);
+			clause.folded = columns.foldedStringId(sval);
+		} else {
+			return false;
+		}
+	}
+
+	m_clauses.push_back(clause);
+	return true;
+}
+
+static inline bool
+is_number_cell(unsigned char kind)
+{
+	return kind == SlotAdColumns::CELL_INTEGER || kind == SlotAdColumns::CELL_REAL ||
+		kind == SlotAdColumns::CELL_BOOL;
+}
+
+// pass[i] &= slot value <op> constant is true or can't be known from the column.
+// Comparing a number with undefined or a string is never true, bools compare as 0 and 1.
+template <class Compare>
+static void
+apply_numeric(unsigned char *pass, const unsigned char *kind, const double *num, size_t rows, Compare cmp)
+{
+	for (size_t i = 0; i < rows; ++i) {
+		pass[i] &= (kind[i] == SlotAdColumns::CELL_OTHER) | (is_number_cell(kind[i]) & cmp(num[i]));
+	}
+}
+
+void
+SlotAdPrefilter::apply(const Clause &clause)
+{
+	const SlotAdColumns::Column &col = *clause.col;
+	const unsigned char *kind = col.kind.data();
+	const double *num = col.num.data();
+	const int *str = col.str.data();
+	const int *folded = col.folded.data();
+	unsigned char *pass = m_pass.data();
+	size_t rows = m_pass.size();
+	const double c = clause.num;
+
+	switch (clause.op) {
+	case CLAUSE_TRUE:
+		// undefined, false, 0 and strings make the && false, undefined or error
+		for (size_t i = 0; i < rows; ++i) {
+			pass[i] &= (kind[i] == SlotAdColumns::CELL_OTHER) | (is_number_cell(kind[i]) & (num[i] != 0.0));
+		}
+		return;
+
+	case CLAUSE_IS:
+	case CLAUSE_ISNT: {
+		// =?= is true only for the same type and the same value
+		bool want = (clause.op == CLAUSE_IS);
+		const unsigned char ckind = clause.kind;
+		for (size_t i = 0; i < rows; ++i) {
+			bool same = (kind[i] == ckind) &&
+				(ckind == SlotAdColumns::CELL_UNDEFINED ||
+				 (ckind == SlotAdColumns::CELL_STRING ? str[i] == clause.str : num[i] == c));
+			pass[i] &= (kind[i] == SlotAdColumns::CELL_OTHER) | (same == want);
+		}
+		return;
+	}
+
+	default:
+		break;
+	}
+
+	if (clause.kind == SlotAdColumns::CELL_STRING) {
+		// == and != ignore case.  anything but a string compared with a
+		// string is an error or undefined
+		bool want = (clause.op == CLAUSE_EQ);
+		for (size_t i = 0; i < rows; ++i) {
+			bool is_string = (kind[i] == SlotAdColumns::CELL_STRING);
+			pass[i] &= (kind[i] == SlotAdColumns::CELL_OTHER) | (is_string & ((folded[i] == clause.folded) == want));
+		}
+		return;
+	}
+
+	switch (clause.op) {
+	case CLAUSE_LT: apply_numeric(pass, kind, num, rows, [c](double v) { return v < c; }); break;
+	case CLAUSE_LE: apply_numeric(pass, kind, num, rows, [c](double v) { return v <= c; }); break;
+	case CLAUSE_GT: apply_numeric(pass, kind, num, rows, [c](double v) { return v > c; }); break;
+	case CLAUSE_GE: apply_numeric(pass, kind, num, rows, [c](double v) { return v >= c; }); break;
+	case CLAUSE_EQ: apply_numeric(pass, kind, num, rows, [c](double v) { return v == c; }); break;
+	case CLAUSE_NE: apply_numeric(pass, kind, num, rows, [c](double v) { return v != c; }); break;
+	default: break;
+	}
+}
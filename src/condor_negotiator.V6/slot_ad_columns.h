@@ -0,0 +1,146 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __SLOT_AD_COLUMNS_H__
+#define __SLOT_AD_COLUMNS_H__
+
+#include "condor_classad.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A column oriented copy of the literal attribute values of the slot ads
+// in a negotiation cycle.  There is one row per slot ad and one column per
+// attribute, and a column is filled in from all of the ads the first time
+// it is asked for.  Values that are not literal numbers, bools or strings
+// are not copied, the prefilter never rejects a slot because of them.
+//
+// The negotiator modifies some slot ads while it matches, so refresh()
+// must be called for an ad after it has been changed.
+class SlotAdColumns
+{
+public:
+	enum CellKind : unsigned char {
+		CELL_OTHER = 0,   // an expression, or a value of some other type
+		CELL_UNDEFINED,   // the attribute is missing or is the literal undefined
+		CELL_INTEGER,     // value in num
+		CELL_REAL,        // value in num
+		CELL_BOOL,        // value in num, 0 or 1
+		CELL_STRING,      // value in str and folded
+	};
+
+	struct Column {
+		std::vector<unsigned char> kind;
+		std::vector<double> num;
+		std::vector<int> str;      // id of the string
+		std::vector<int> folded;   // id of the lower case string
+	};
+
+	SlotAdColumns() {}
+	SlotAdColumns(const SlotAdColumns &) = delete;
+	SlotAdColumns &operator=(const SlotAdColumns &) = delete;
+
+	// forget all ads and columns, then make a row for each ad
+	void build(const std::vector<ClassAd *> &ads);
+	void clear();
+
+	// copy the values of an ad that was changed into its row
+	void refresh(ClassAd *ad);
+
+	// the row of an ad, or -1 if the ad has none
+	int row(const ClassAd *ad) const {
+		auto it = m_rows.find(ad);
+		return (it == m_rows.end()) ? -1 : it->second;
+	}
+	size_t size() const { return m_ads.size(); }
+	bool empty() const { return m_ads.empty(); }
+
+	// the column for an attribute, filled in on first use.
+	// returns NULL for attributes that the prefilter cannot use.
+	const Column *column(const std::string &attr);
+
+	// the id of a string in the columns, or -1 if no slot ad has it
+	int stringId(const std::string &str) const;
+	int foldedStringId(const std::string &str) const;
+
+private:
+	void project(Column &col, const std::string &attr, size_t row);
+	int internString(const std::string &str, std::unordered_map<std::string, int> &ids);
+
+	std::vector<ClassAd *> m_ads;
+	std::unordered_map<const ClassAd *, int> m_rows;
+	std::map<std::string, Column, classad::CaseIgnLTStr> m_columns;
+	std::unordered_map<std::string, int> m_strings;
+	std::unordered_map<std::string, int> m_folded;
+};
+
+// The clauses of a job's Requirements that can be checked against the
+// columns.  Requirements is only true when every clause of its top level
+// && is true, so a slot can be rejected as soon as one clause of the
+// form TARGET.attr <op> constant is certain not to be true for it.
+// A slot that passes may still fail the full match.
+class SlotAdPrefilter
+{
+public:
+	SlotAdPrefilter() {}
+
+	// find the clauses of the request's Requirements that can be checked
+	// and check them against every row.  returns false if there are none.
+	bool evaluate(ClassAd &request, SlotAdColumns &columns);
+
+	// true if the slot ad certainly does not match the request
+	bool rejects(const SlotAdColumns &columns, const ClassAd *slot) const {
+		if ( ! m_active) return false;
+		int row = columns.row(slot);
+		return row >= 0 && ! m_pass[row];
+	}
+
+	size_t numClauses() const { return m_clauses.size(); }
+	size_t numRejected() const { return m_rejected; }
+
+private:
+	enum ClauseOp {
+		CLAUSE_TRUE,   // TARGET.attr
+		CLAUSE_LT, CLAUSE_LE, CLAUSE_GT, CLAUSE_GE,
+		CLAUSE_EQ, CLAUSE_NE,
+		CLAUSE_IS, CLAUSE_ISNT,
+	};
+
+	struct Clause {
+		const SlotAdColumns::Column *col;
+		ClauseOp op;
+		SlotAdColumns::CellKind kind;   // of the constant
+		double num;
+		int str;
+		int folded;
+	};
+
+	void collect(classad::ExprTree *tree, ClassAd &request, SlotAdColumns &columns);
+	bool addClause(classad::ExprTree *tree, ClassAd &request, SlotAdColumns &columns);
+	void apply(const Clause &clause);
+
+	std::vector<Clause> m_clauses;
+	std::vector<unsigned char> m_pass;
+	size_t m_rejected{0};
+	bool m_active{false};
+};
+
+#endif
@@ -3785,6 +3785,7 @@ show_schedd_queue(const char* scheddAddress, const char* scheddName, const char*
 			// we do this so that a subsequent "condor_q -jobs <file> -nobatch" will show the correct job times.
 			Q.requestServerTime(true);
 		}
+		Q.setPageSize(param_integer("CONDOR_Q_PAGE_SIZE", 0, 0));
 		std::vector<std::string> attrs;
 		std::copy(pattrs->begin(), pattrs->end(), std::back_inserter(attrs));
 		fetchResult = Q.fetchQueueFromHostAndProcess(scheddAddress, attrs, fetch_opts, g_match_limit, pfnProcess, pvProcess, useFastPath, &errstack, &summary_ad);
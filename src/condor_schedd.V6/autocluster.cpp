@@ -26,6 +26,9 @@
 #include "qmgmt.h"
 #include "schedd_stats.h" // for schedd_runtime_probe
 
+#include <atomic>
+#include <thread>
+
 // this is a placeholder for a future class that will compactly hold a set of jobs
 // by taking into account the fact that it is common for only the cluster to be significant
 // and that consecutive cluster id's are often owned by the same user.
@@ -64,6 +67,7 @@ JobCluster::~JobCluster()
 void JobCluster::clear()
 {
 	cluster_map.clear();
+	cluster_sigs.clear();
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 	cluster_use.clear();
 	cluster_gone.clear();
@@ -137,6 +141,13 @@ bool JobCluster::setSigAttrs(const char* new_sig_attrs, bool free_input_attrs, b
 	return sig_attrs_changed;
 }
 
+// remove a cluster from both the signature map and the id map, returns the next item in the signature map
+JobCluster::JobSigidMap::iterator JobCluster::erase_cluster(JobSigidMap::iterator it)
+{
+	cluster_sigs.erase(it->second);
+	return cluster_map.erase(it);
+}
+
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 
 // lookup the autocluster for a job (assumes job.autocluster_id is valid)
@@ -197,9 +208,11 @@ void JobCluster::collect_garbage(bool brute_force) // free the deleted clusters
 				}
 			}
 		}
-		// advance here so that we can erase the previous entry if needed.
-		auto last = it++;
-		if (gone) { cluster_map.erase(last); }
+		if (gone) {
+			it = erase_cluster(it);
+		} else {
+			++it;
+		}
 	}
 	cluster_gone.clear();
 }
@@ -210,8 +223,13 @@ extern int    last_autocluster_classad_cache_hit;
 
 int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string * final_list)
 {
-	int cur_id = -1;
+	std::string signature;
+	makeSignature(job, expand_refs, signature, final_list);
+	return getClusteridForSignature(job, signature);
+}
 
+void JobCluster::makeSignature(JobQueueJob & job, bool expand_refs, std::string & signature, std::string * final_list) const
+{
 	// we want to summarize job into a string "signature"
 	// the signature will consist of "key1=val1\nkey2=val2\n"
 	// for each of the keys in the significant_attrs list and (if expand_refs is true)
@@ -275,7 +293,7 @@ int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string *
 	// we build a signature essentially by printing it all out in one big string
 	//
 	bool need_sep = false; // true after the first item, (when we need to print separators)
-	std::string signature;
+	signature.clear();
 	signature.reserve(strlen(significant_attrs) + exattrs.size()*20 + sigset.size()*20); // make a guess as to how much space the signature will take.
 
 	classad::ClassAdUnParser unp;
@@ -312,17 +330,23 @@ int JobCluster::getClusterid(JobQueueJob & job, bool expand_refs, std::string *
 		}
 		++ix;
 	}
+}
+
+int JobCluster::getClusteridForSignature(JobQueueJob & job, const std::string & signature)
+{
+	int cur_id = -1;
 
 	// now check the signature against the current cluster map
 	// and either return the matching cluster id, or a new cluster id.
-	JobSigidMap::iterator it;
-	it = cluster_map.find(signature);
+	auto it = cluster_map.find(signature);
 	if (it != cluster_map.end()) {
 		cur_id = it->second;
 	}
 	else {
 		cur_id = next_id++;
-		cluster_map.insert(JobSigidMap::value_type(signature,cur_id));
+		it = cluster_map.emplace(signature, cur_id).first;
+		// the keys of an unordered_map don't move when it rehashes, so we can point to them
+		cluster_sigs[cur_id] = &it->first;
 	}
 
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
@@ -553,21 +577,17 @@ void AutoCluster::mark()
 
 void AutoCluster::sweep()
 {
-	JobSigidMap::iterator it,next;
-	for( it = cluster_map.begin();
-		 it != cluster_map.end();
-		 it = next )
-	{
-		next = it;
-		next++; // avoid invalid iterator if we delete this element
-
+	JobSigidMap::iterator it = cluster_map.begin();
+	while (it != cluster_map.end()) {
 		int id = it->second;
 		JobClusterIDs::iterator in_use;
 		in_use = cluster_in_use.find(id);
 		if (in_use == cluster_in_use.end()) {
 				// found an entry to remove.
 			dprintf(D_FULLDEBUG,"removing auto cluster id %d\n",id);
-			cluster_map.erase( it );
+			it = erase_cluster(it);
+		} else {
+			++it;
 		}
 	}
 }
@@ -610,6 +630,13 @@ int AutoCluster::getAutoClusterid(JobQueueJob *job)
 		EXCEPT("Auto cluster IDs exhausted! (allocated %d)",cur_id);
 	}
 
+	assignAutoClusterid(job, cur_id, final_list);
+
+	return cur_id;
+}
+
+void AutoCluster::assignAutoClusterid(JobQueueJob *job, int cur_id, const std::string & final_list)
+{
 		// mark as in-use for the mark/sweep code
 	cluster_in_use.insert(cur_id);
 
@@ -624,8 +651,65 @@ int AutoCluster::getAutoClusterid(JobQueueJob *job)
 		// changed, then SetAttribute() will delete the ATTR_AUTO_CLUSTER_ID, since
 		// the signature needs to be recomputed as it may have changed.
 	job->Assign(ATTR_AUTO_CLUSTER_ATTRS, final_list);
+}
 
-	return cur_id;
+// the signatures are made this many jobs at a time, which bounds the memory used to hold them
+static const size_t AUTOCLUSTER_BATCH_SIZE = 16*1024;
+// and each thread takes this many jobs at a time from the batch
+static const size_t AUTOCLUSTER_CHUNK_SIZE = 256;
+
+void AutoCluster::getAutoClusterids(const std::vector<JobQueueJob*> & jobs, int num_threads)
+{
+	if ( ! significant_attrs || jobs.empty()) {
+		return;
+	}
+
+	if (num_threads <= 0) {
+		num_threads = MAX(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// making the signatures is most of the work, and it only reads the jobs, so several
+	// threads make the signatures for a batch of jobs, then the jobs in the batch are
+	// given their ids one at a time in order, just as getAutoClusterid() would.
+	std::vector<std::string> sigs;
+	std::vector<std::string> final_lists;
+	for (size_t first = 0; first < jobs.size(); first += AUTOCLUSTER_BATCH_SIZE) {
+		size_t last = MIN(first + AUTOCLUSTER_BATCH_SIZE, jobs.size());
+		size_t chunks = (last - first + AUTOCLUSTER_CHUNK_SIZE - 1) / AUTOCLUSTER_CHUNK_SIZE;
+		int threads = (int)MAX((size_t)1, MIN((size_t)num_threads, chunks));
+
+		sigs.resize(last - first);
+		final_lists.resize(last - first);
+		std::atomic<size_t> next_chunk {0};
+		auto work = [&]() {
+			size_t chunk;
+			while ((chunk = next_chunk.fetch_add(1)) < chunks) {
+				size_t begin_ix = first + chunk * AUTOCLUSTER_CHUNK_SIZE;
+				size_t end_ix = MIN(begin_ix + AUTOCLUSTER_CHUNK_SIZE, last);
+				for (size_t ix = begin_ix; ix < end_ix; ++ix) {
+					final_lists[ix - first].clear();
+					makeSignature(*jobs[ix], true, sigs[ix - first], &final_lists[ix - first]);
+				}
+			}
+		};
+
+		std::vector<std::thread> helpers;
+		for (int id = 1; id < threads; ++id) {
+			helpers.emplace_back(work);
+		}
+		work();
+		for (auto & thr : helpers) {
+			thr.join();
+		}
+
+		for (size_t ix = first; ix < last; ++ix) {
+			int cur_id = getClusteridForSignature(*jobs[ix], sigs[ix - first]);
+			if (cur_id < 0) {
+				EXCEPT("Auto cluster IDs exhausted! (allocated %d)",cur_id);
+			}
+			assignAutoClusterid(jobs[ix], cur_id, final_lists[ix - first]);
+		}
+	}
 }
 
 bool AutoCluster::preSetAttribute(JobQueueJob &job, const char * attr, const char * /*value*/, int /*flags*/)
@@ -741,17 +825,17 @@ bool JobAggregationResults::compute()
 bool JobAggregationResults::rewind()
 {
 	results_returned = 0;
-	pause_position.clear();
-	it = jc.cluster_map.begin();
-	return it != jc.cluster_map.end();
+	pause_position = -1;
+	it = jc.cluster_sigs.begin();
+	return it != jc.cluster_sigs.end();
 }
 
-// pause iterator, remember the key of the current item, when we resume
+// pause iterator, remember the id of the current item, when we resume
 // we will pick back up at that point.
 void JobAggregationResults::pause()
 {
-	pause_position.clear();
-	if (it != jc.cluster_map.end()) {
+	pause_position = -1;
+	if (it != jc.cluster_sigs.end()) {
 		pause_position = it->first;
 	}
 }
@@ -765,34 +849,34 @@ ClassAd * JobAggregationResults::next()
 
 	// if we are resuming from a paused state, we don't have a valid iterator
 	// so we have to find the the element we paused at or the first one after it.
-	if ( ! pause_position.empty()) {
-		it = jc.cluster_map.lower_bound(pause_position);
-		pause_position.clear();
+	if (pause_position >= 0) {
+		it = jc.cluster_sigs.lower_bound(pause_position);
+		pause_position = -1;
 	}
 
 	// in case we never enter the loop, clear our 'current' ad here.
 	ad.Clear();
 
 	// we may have to look at multiple items in order to find one to return
-	while (it != jc.cluster_map.end()) {
+	while (it != jc.cluster_sigs.end()) {
 
 		ad.Clear();
 
 		// the autocluster key (or signature), is a string containing key value
 		// pairs separated by \n. So we can easily turn it into a classad.
-		StringTokenIterator iter(it->first, "\n");
+		StringTokenIterator iter(*it->second, "\n");
 		const char * line = nullptr;
 		while ((line = iter.next())) {
 			(void) ad.Insert(line);
 		}
 		if (this->is_def_autocluster) {
-			ad.Assign(ATTR_AUTO_CLUSTER_ID,it->second);
+			ad.Assign(ATTR_AUTO_CLUSTER_ID,it->first);
 		} else {
-			ad.Assign("Id",it->second);
+			ad.Assign("Id",it->first);
 		}
 	#ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 		int cJobs = 0;
-		auto jit = jc.cluster_use.find(it->second);
+		auto jit = jc.cluster_use.find(it->first);
 		if (jit != jc.cluster_use.end()) {
 			JobIdSet & jids = jit->second;
 			cJobs = jids.count();
@@ -26,6 +26,7 @@
 
 #include "condor_classad.h"
 #include <generic_stats.h>
+#include <unordered_map>
 
 class JobIdSet;
 class JobAggregationResults;
@@ -41,6 +42,11 @@ public:
 	void keepJobIds(bool keep) { keep_job_ids = keep; }
 #endif
 	int getClusterid(JobQueueJob &job, bool expand_refs, std::string * final_list);
+	// build the signature of a job, this does not change the job or the JobCluster, so
+	// it can be called by several threads at once as long as nothing else changes the jobs.
+	void makeSignature(JobQueueJob &job, bool expand_refs, std::string & signature, std::string * final_list) const;
+	// return the cluster id for a signature from makeSignature, making a new cluster if needed
+	int getClusteridForSignature(JobQueueJob &job, const std::string & signature);
 	int size();
 	void clear();
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
@@ -50,8 +56,11 @@ public:
 
 protected:
 	friend class JobAggregationResults;
-	typedef std::map<std::string,int> JobSigidMap;
-	JobSigidMap cluster_map;  // map of signature to a cluster id
+	typedef std::unordered_map<std::string,int> JobSigidMap;
+	typedef std::map<int, const std::string *> JobIdSigMap;
+	JobSigidMap cluster_map;  // hashed map of signature to a cluster id
+	JobIdSigMap cluster_sigs; // map of cluster id to its signature (the key in cluster_map), in id order
+	JobSigidMap::iterator erase_cluster(JobSigidMap::iterator it);
 #ifdef USE_AUTOCLUSTER_TO_JOBID_MAP
 	typedef std::map<int, JobIdSet> JobIdSetMap;
 	JobIdSetMap cluster_use; // map clusterId to a set of jobIds
@@ -114,6 +123,14 @@ public:
 	*/
 	int getAutoClusterid(JobQueueJob *job);
 
+	/** Compute the autocluster ids of many jobs that don't have one, as getAutoClusterid()
+		would, but make the signatures of the jobs with several threads at once.  The
+		jobs must not be changed by anything else until this returns.
+		@param jobs The jobs, which must not have an ATTR_AUTO_CLUSTER_ID
+		@param num_threads The number of threads to use, 0 for one per CPU core
+	*/
+	void getAutoClusterids(const std::vector<JobQueueJob*> & jobs, int num_threads);
+
 		// garbage collection methods...
 
 	/** Set the deletion flag for all autocluster id entries in the class.
@@ -152,6 +169,8 @@ public:
 
 
 protected:
+	void assignAutoClusterid(JobQueueJob *job, int cur_id, const std::string & final_list);
+
 	bool sig_attrs_came_from_config_file;
 	typedef std::set<int> JobClusterIDs;
 	JobClusterIDs cluster_in_use; // used by mark & sweep code. id in list if in use
@@ -190,8 +209,8 @@ protected:
 	int  result_limit;
 	int  results_returned;
 	ClassAd ad;
-	JobCluster::JobSigidMap::iterator it;
-	std::string pause_position; // holds the key that the iterator was pointing to before we paused.
+	JobCluster::JobIdSigMap::iterator it;
+	int pause_position {-1}; // holds the cluster id that the iterator was pointing to before we paused.
 };
 
 
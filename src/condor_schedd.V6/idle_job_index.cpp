@@ -0,0 +1,164 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "idle_job_index.h"
+
+#include <algorithm>
+
+void IdleJobIndex::Clear()
+{
+	m_submitters.clear();
+	m_jobs.clear();
+	m_num_idle = 0;
+}
+
+void IdleJobIndex::Link(const prio_rec & rec)
+{
+	m_submitters[rec.submitter][rec.auto_cluster_id].insert(rec);
+	++m_num_idle;
+}
+
+void IdleJobIndex::Unlink(const prio_rec & rec)
+{
+	auto sub = m_submitters.find(rec.submitter);
+	if (sub == m_submitters.end()) {
+		return;
+	}
+	auto ac = sub->second.find(rec.auto_cluster_id);
+	if (ac == sub->second.end()) {
+		return;
+	}
+	if (ac->second.erase(rec)) {
+		--m_num_idle;
+	}
+	if (ac->second.empty()) {
+		sub->second.erase(ac);
+		if (sub->second.empty()) {
+			m_submitters.erase(sub);
+		}
+	}
+}
+
+void IdleJobIndex::Insert(const prio_rec & rec)
+{
+	Entry & entry = m_jobs[rec.id];
+	if (entry.idle) {
+		Unlink(entry.rec);
+	}
+	entry.rec = rec;
+	entry.rec.matched = false;
+	entry.rec.not_runnable = false;
+	entry.idle = true;
+	Link(entry.rec);
+}
+
+void IdleJobIndex::JobNotIdle(const JOB_ID_KEY & jid)
+{
+	auto it = m_jobs.find(jid);
+	if (it == m_jobs.end() || ! it->second.idle) {
+		return;
+	}
+	Unlink(it->second.rec);
+	it->second.idle = false;
+}
+
+bool IdleJobIndex::JobIdle(const JOB_ID_KEY & jid)
+{
+	auto it = m_jobs.find(jid);
+	if (it == m_jobs.end()) {
+		return false;
+	}
+	if ( ! it->second.idle) {
+		Link(it->second.rec);
+		it->second.idle = true;
+	}
+	return true;
+}
+
+void IdleJobIndex::JobRemoved(const JOB_ID_KEY & jid)
+{
+	auto it = m_jobs.find(jid);
+	if (it == m_jobs.end()) {
+		return;
+	}
+	if (it->second.idle) {
+		Unlink(it->second.rec);
+	}
+	m_jobs.erase(it);
+}
+
+const IdleJobIndex::JobSet * IdleJobIndex::Jobs(const std::string & submitter, int auto_cluster_id) const
+{
+	auto sub = m_submitters.find(submitter);
+	if (sub == m_submitters.end()) {
+		return nullptr;
+	}
+	auto ac = sub->second.find(auto_cluster_id);
+	if (ac == sub->second.end()) {
+		return nullptr;
+	}
+	return &ac->second;
+}
+
+IdleJobIndex::Walker::Walker(const IdleJobIndex & index, const std::string * submitter)
+{
+	if (submitter) {
+		auto sub = index.m_submitters.find(*submitter);
+		if (sub != index.m_submitters.end()) {
+			AddStreams(sub->second);
+		}
+	} else {
+		for (const auto & [name, clusters] : index.m_submitters) {
+			AddStreams(clusters);
+		}
+	}
+	std::make_heap(m_heap.begin(), m_heap.end(), StreamCompare{});
+}
+
+void IdleJobIndex::Walker::AddStreams(const std::map<int, JobSet> & clusters)
+{
+	for (const auto & [id, jobs] : clusters) {
+		if ( ! jobs.empty()) {
+			m_heap.push_back(Stream{jobs.begin(), jobs.end()});
+		}
+	}
+}
+
+const prio_rec * IdleJobIndex::Walker::Next()
+{
+	// put the autocluster of the last job back in the heap, starting at its next job
+	if (m_have_current) {
+		if (++m_current.it != m_current.end) {
+			m_heap.push_back(m_current);
+			std::push_heap(m_heap.begin(), m_heap.end(), StreamCompare{});
+		}
+		m_have_current = false;
+	}
+
+	if (m_heap.empty()) {
+		return nullptr;
+	}
+
+	std::pop_heap(m_heap.begin(), m_heap.end(), StreamCompare{});
+	m_current = m_heap.back();
+	m_heap.pop_back();
+	m_have_current = true;
+	return &*m_current.it;
+}
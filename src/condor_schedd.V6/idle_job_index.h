@@ -0,0 +1,112 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _idle_job_index_H_
+#define _idle_job_index_H_
+
+#include "proc.h"
+#include "prio_rec.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// An index of the runnable idle jobs by submitter and autocluster, kept in the same priority
+// order as the PrioRec array.
+//
+// The index is filled from the same queue walk that builds the PrioRec array, which is
+// where jobs get their autocluster id and priority.  Between walks it is kept up to date
+// as job status changes are committed, so jobs that are running, held or removed drop out
+// of it right away, and jobs that go back to idle come back under the submitter and autocluster
+// they had at the last walk.  Negotiation and claim reuse walk the index instead of the PrioRec
+// array, so they only look at jobs that are idle now.
+class IdleJobIndex {
+public:
+	typedef std::set<prio_rec, prio_compar> JobSet;
+
+	IdleJobIndex() {}
+
+	// forget all jobs, before a queue walk that inserts all of the runnable jobs again
+	void Clear();
+
+	// add a runnable idle job, or move it if its submitter, autocluster or priority changed
+	void Insert(const prio_rec & rec);
+
+	// the job has left the idle state, take it out of the index but remember where it was
+	void JobNotIdle(const JOB_ID_KEY & jid);
+
+	// the job is idle again. returns false if the job was not in the index at the last walk
+	bool JobIdle(const JOB_ID_KEY & jid);
+
+	// the job has left the queue
+	void JobRemoved(const JOB_ID_KEY & jid);
+
+	// the idle jobs of a submitter in an autocluster in priority order, or NULL if there are none
+	const JobSet * Jobs(const std::string & submitter, int auto_cluster_id) const;
+
+	size_t NumIdle() const { return m_num_idle; }
+	size_t NumKnown() const { return m_jobs.size(); }
+
+	// Walks the idle jobs of one submitter, or of all submitters, in the order of the
+	// PrioRec array by merging the autoclusters as it goes.  The index must not
+	// be changed while a Walker is in use.
+	class Walker {
+	public:
+		// pass NULL for submitter to walk the jobs of all submitters
+		Walker(const IdleJobIndex & index, const std::string * submitter);
+
+		// the next job, or NULL when there are no more jobs
+		const prio_rec * Next();
+
+		// don't return any more jobs from the autocluster of the job last returned by Next()
+		void SkipAutoCluster() { m_have_current = false; }
+
+	private:
+		struct Stream {
+			JobSet::const_iterator it;
+			JobSet::const_iterator end;
+		};
+		// orders the heap so that the stream with the highest priority job is on top
+		struct StreamCompare {
+			bool operator()(const Stream & a, const Stream & b) const { return prio_compar{}(*b.it, *a.it); }
+		};
+
+		void AddStreams(const std::map<int, JobSet> & clusters);
+
+		std::vector<Stream> m_heap;
+		Stream m_current;
+		bool m_have_current {false};
+	};
+
+private:
+	struct Entry {
+		prio_rec rec;
+		bool idle {false};
+	};
+
+	void Link(const prio_rec & rec);
+	void Unlink(const prio_rec & rec);
+
+	std::map<std::string, std::map<int, JobSet>> m_submitters;
+	std::map<JOB_ID_KEY, Entry> m_jobs;  // every job indexed at the last walk, idle or not
+	size_t m_num_idle {0};
+};
+
+#endif
@@ -36,6 +36,12 @@ struct LiveJobCounters {
   int SchedulerJobsRemoved;
   int SchedulerJobsCompleted;
   int SchedulerJobsHeld;
+  // Local universe jobs are counted in the Jobs counters above, and also here.
+  int LocalJobsIdle;
+  int LocalJobsRunning;
+  int LocalJobsRemoved;
+  int LocalJobsCompleted;
+  int LocalJobsHeld;
   void clear_counters() { memset(this, 0, sizeof(*this)); }
   void publish(ClassAd & ad, const char * prefix) const;
   LiveJobCounters()
@@ -50,7 +56,19 @@ struct LiveJobCounters {
 	, SchedulerJobsRemoved(0)
 	, SchedulerJobsCompleted(0)
 	, SchedulerJobsHeld(0)
+	, LocalJobsIdle(0)
+	, LocalJobsRunning(0)
+	, LocalJobsRemoved(0)
+	, LocalJobsCompleted(0)
+	, LocalJobsHeld(0)
   {}
+  // number of jobs counted, including Scheduler universe jobs
+  int total() const {
+	return JobsIdle + JobsRunning + JobsRemoved + JobsCompleted + JobsHeld + JobsSuspended
+		+ SchedulerJobsIdle + SchedulerJobsRunning + SchedulerJobsRemoved + SchedulerJobsCompleted + SchedulerJobsHeld;
+  }
+  bool operator==(const LiveJobCounters & rhs) const { return memcmp(this, &rhs, sizeof(*this)) == 0; }
+  bool operator!=(const LiveJobCounters & rhs) const { return ! (*this == rhs); }
 };
 
 void IncrementLiveJobCounter(LiveJobCounters & num, int universe, int status, int increment /*, JobQueueJob * job*/);
@@ -0,0 +1,507 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_attributes.h"
+#include "compat_classad_util.h"
+#include "qmgmt.h"
+#include "periodic_policy.h"
+
+#include <algorithm>
+#include <cmath>
+
+// the attributes of the job that UserPolicy::AnalyzePolicy and ResponsibleForPeriodicExprs look at
+// without going through an expression.
+static const char * const builtin_policy_attrs[] = {
+	ATTR_JOB_STATUS,
+	ATTR_JOB_UNIVERSE,
+	ATTR_JOB_MANAGED,
+	ATTR_GRID_JOB_ID,
+	ATTR_PERIODIC_HOLD_CHECK,
+	ATTR_PERIODIC_RELEASE_CHECK,
+	ATTR_PERIODIC_REMOVE_CHECK,
+	ATTR_PERIODIC_VACATE_CHECK,
+	ATTR_TIMER_REMOVE_CHECK,
+	ATTR_JOB_ALLOWED_JOB_DURATION,
+	ATTR_JOB_ALLOWED_EXECUTE_DURATION,
+	ATTR_SHADOW_BIRTHDATE,
+	ATTR_JOB_CURRENT_START_EXECUTING_DATE,
+	"TransferOutFinished",
+};
+
+// the periodic policy expressions of the job itself
+static const char * const job_policy_attrs[] = {
+	ATTR_PERIODIC_HOLD_CHECK,
+	ATTR_PERIODIC_RELEASE_CHECK,
+	ATTR_PERIODIC_REMOVE_CHECK,
+	ATTR_PERIODIC_VACATE_CHECK,
+	ATTR_TIMER_REMOVE_CHECK,
+};
+
+// returns true if the tree is time() or CurrentTime
+bool
+TimeThresholds::IsTime(const classad::ExprTree * tree)
+{
+	if (tree->GetKind() == classad::ExprTree::FN_CALL_NODE) {
+		std::string name;
+		std::vector<classad::ExprTree*> args;
+		((const classad::FunctionCall*)tree)->GetComponents(name, args);
+		return args.empty() && YourStringNoCase("time") == name.c_str();
+	}
+	if (tree->GetKind() == classad::ExprTree::ATTRREF_NODE) {
+		classad::ExprTree * scope = nullptr;
+		std::string attr;
+		bool absolute = false;
+		((const classad::AttributeReference*)tree)->GetComponents(scope, attr, absolute);
+		return ! scope && ! absolute && YourStringNoCase(ATTR_CURRENT_TIME) == attr.c_str();
+	}
+	return false;
+}
+
+// returns the expression of the job attribute that the tree refers to,
+// or NULL if it is not a reference to an attribute of the job
+const classad::ExprTree *
+TimeThresholds::Deref(const classad::ExprTree * tree)
+{
+	if (tree->GetKind() != classad::ExprTree::ATTRREF_NODE) {
+		return nullptr;
+	}
+	classad::ExprTree * scope = nullptr;
+	std::string attr, scope_name;
+	bool absolute = false;
+	((const classad::AttributeReference*)tree)->GetComponents(scope, attr, absolute);
+	if (absolute) {
+		return nullptr;
+	}
+	if (scope && ! (ExprTreeIsAttrRef(scope, scope_name) && YourStringNoCase("MY") == scope_name.c_str())) {
+		return nullptr;
+	}
+	return ad.Lookup(attr);
+}
+
+bool
+TimeThresholds::UsesTime(const classad::ExprTree * tree, int depth)
+{
+	if ( ! tree) {
+		return false;
+	}
+	if (depth > MAX_DEPTH) {
+		// attributes nested too deeply to look at might use the time
+		unsolved = true;
+		return true;
+	}
+	tree = SkipExprEnvelope(tree);
+	if (IsTime(tree)) {
+		return true;
+	}
+
+	switch (tree->GetKind()) {
+	case classad::ExprTree::ATTRREF_NODE:
+		return UsesTime(Deref(tree), depth+1);
+
+	case classad::ExprTree::OP_NODE: {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		return UsesTime(t1, depth) || UsesTime(t2, depth) || UsesTime(t3, depth);
+	}
+
+	case classad::ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<classad::ExprTree*> args;
+		((const classad::FunctionCall*)tree)->GetComponents(name, args);
+		for (auto * arg : args) {
+			if (UsesTime(arg, depth)) return true;
+		}
+		return false;
+	}
+
+	case classad::ExprTree::CLASSAD_NODE: {
+		std::vector< std::pair<std::string, classad::ExprTree*> > attrs;
+		((const classad::ClassAd*)tree)->GetComponents(attrs);
+		for (auto & attr : attrs) {
+			if (UsesTime(attr.second, depth)) return true;
+		}
+		return false;
+	}
+
+	case classad::ExprTree::EXPR_LIST_NODE: {
+		std::vector<classad::ExprTree*> exprs;
+		((const classad::ExprList*)tree)->GetComponents(exprs);
+		for (auto * expr : exprs) {
+			if (UsesTime(expr, depth)) return true;
+		}
+		return false;
+	}
+
+	default:
+		return false;
+	}
+}
+
+// express the tree as a*time + b.  returns LIN_UNDEFINED if a part that does not depend on
+// the time does not evaluate to a number, and LIN_OPAQUE if the time is used in some other way.
+int
+TimeThresholds::Linear(const classad::ExprTree * tree, int depth, double & a, double & b)
+{
+	a = b = 0;
+	if ( ! tree || depth > MAX_DEPTH) {
+		return LIN_OPAQUE;
+	}
+	tree = SkipExprEnvelope(tree);
+	if (IsTime(tree)) {
+		a = 1;
+		return LIN_OK;
+	}
+	if ( ! UsesTime(tree, depth)) {
+		classad::Value val;
+		if (ad.EvaluateExpr(tree, val) && val.IsNumber(b)) {
+			return LIN_OK;
+		}
+		return LIN_UNDEFINED;
+	}
+
+	const classad::ExprTree * expr = Deref(tree);
+	if (expr) {
+		return Linear(expr, depth+1, a, b);
+	}
+	if (tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return LIN_OPAQUE;
+	}
+
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+
+	double a1 = 0, b1 = 0, a2 = 0, b2 = 0;
+	int r1 = Linear(t1, depth, a1, b1);
+	if (op == classad::Operation::PARENTHESES_OP || op == classad::Operation::UNARY_PLUS_OP) {
+		a = a1; b = b1;
+		return r1;
+	}
+	if (op == classad::Operation::UNARY_MINUS_OP) {
+		a = -a1; b = -b1;
+		return r1;
+	}
+	int r2 = Linear(t2, depth, a2, b2);
+	int rval = MAX(r1, r2);
+	if (rval != LIN_OK) {
+		return rval;
+	}
+	switch (op) {
+	case classad::Operation::ADDITION_OP:
+		a = a1 + a2; b = b1 + b2;
+		return LIN_OK;
+	case classad::Operation::SUBTRACTION_OP:
+		a = a1 - a2; b = b1 - b2;
+		return LIN_OK;
+	case classad::Operation::MULTIPLICATION_OP:
+		if (a1 == 0) { a = a2 * b1; b = b2 * b1; return LIN_OK; }
+		if (a2 == 0) { a = a1 * b2; b = b1 * b2; return LIN_OK; }
+		return LIN_OPAQUE;
+	case classad::Operation::DIVISION_OP:
+		if (a2 == 0 && b2 != 0) { a = a1 / b2; b = b1 / b2; return LIN_OK; }
+		return LIN_OPAQUE;
+	default:
+		return LIN_OPAQUE;
+	}
+}
+
+void
+TimeThresholds::Add(double when)
+{
+	if ( ! std::isfinite(when) || when > (double)(now + 100*365*24*3600LL)) {
+		return;
+	}
+	// the answer can change at when, or just after it for a strict comparison
+	time_t at = (time_t)std::ceil(when);
+	if (at <= now) { at = (time_t)std::floor(when) + 1; }
+	if (at > now && ( ! next || at < next)) {
+		next = at;
+	}
+}
+
+void
+TimeThresholds::Scan(const classad::ExprTree * tree, int depth)
+{
+	if ( ! tree) {
+		return;
+	}
+	if (depth > MAX_DEPTH) {
+		unsolved = true;
+		return;
+	}
+	if ( ! UsesTime(tree, depth)) {
+		return;
+	}
+	tree = SkipExprEnvelope(tree);
+	if (IsTime(tree)) {
+		// the time by itself, not in a comparison we can solve
+		unsolved = true;
+		return;
+	}
+
+	switch (tree->GetKind()) {
+	case classad::ExprTree::ATTRREF_NODE:
+		Scan(Deref(tree), depth+1);
+		break;
+
+	case classad::ExprTree::OP_NODE: {
+		classad::Operation::OpKind op;
+		classad::ExprTree *t1, *t2, *t3;
+		((const classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+		if (op >= classad::Operation::LESS_THAN_OP && op <= classad::Operation::GREATER_THAN_OP) {
+			double a1 = 0, b1 = 0, a2 = 0, b2 = 0;
+			int rval = MAX(Linear(t1, depth, a1, b1), Linear(t2, depth, a2, b2));
+			if (rval == LIN_OPAQUE) {
+				unsolved = true;
+			} else if (rval == LIN_OK && a1 != a2) {
+				// the sides are equal when a1*t + b1 == a2*t + b2
+				Add((b2 - b1) / (a1 - a2));
+			}
+			// if a side is undefined, the answer won't change until an attribute does
+		} else {
+			Scan(t1, depth);
+			Scan(t2, depth);
+			Scan(t3, depth);
+		}
+		break;
+	}
+
+	case classad::ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<classad::ExprTree*> args;
+		((const classad::FunctionCall*)tree)->GetComponents(name, args);
+		for (auto * arg : args) { Scan(arg, depth); }
+		break;
+	}
+
+	default:
+		// time used inside a nested classad or list
+		unsolved = true;
+		break;
+	}
+}
+
+
+void
+PeriodicPolicyTracker::Config(bool enable, int interval)
+{
+	m_enabled = enable;
+	m_interval = MAX(1, interval);
+	m_policy.Init();
+	m_sys_exprs.clear();
+	m_attrs.clear();
+	Clear();
+	if ( ! m_enabled) {
+		m_wheel.clear();
+		return;
+	}
+	m_wheel.resize(WHEEL_SLOTS);
+
+	for (const char * attr : builtin_policy_attrs) {
+		m_attrs.insert(attr);
+	}
+	m_policy.GetSystemPeriodicExprs(m_sys_exprs);
+	ClassAd empty;
+	for (auto * expr : m_sys_exprs) {
+		GetExprReferences(expr, empty, &m_attrs, &m_attrs);
+	}
+}
+
+bool
+PeriodicPolicyTracker::IsPolicyAttr(const classad::References & attrs) const
+{
+	if ( ! m_enabled) {
+		return false;
+	}
+	for (const auto & attr : attrs) {
+		if (m_attrs.count(attr)) return true;
+	}
+	return false;
+}
+
+bool
+PeriodicPolicyTracker::JobChanged(const JOB_ID_KEY & jid)
+{
+	if ( ! m_enabled) {
+		return false;
+	}
+	bool was_empty = m_changed.empty();
+	m_changed.insert(jid);
+	return was_empty;
+}
+
+void
+PeriodicPolicyTracker::Clear()
+{
+	m_changed.clear();
+	m_due.clear();
+	for (auto & slot : m_wheel) {
+		slot.clear();
+	}
+	m_wheel_time = time(nullptr);
+}
+
+// add the attributes that expr refers to, following the attributes of the job that are expressions
+void
+PeriodicPolicyTracker::AddReferences(classad::ExprTree * expr, JobQueueJob & job)
+{
+	if (expr) {
+		GetExprReferences(expr, job, &m_attrs, &m_attrs);
+	}
+}
+
+time_t
+PeriodicPolicyTracker::NextTimeThreshold(JobQueueJob & job, time_t now, bool & unsolved)
+{
+	TimeThresholds thresholds(job, now);
+
+	for (const char * attr : job_policy_attrs) {
+		thresholds.Scan(job.Lookup(attr));
+	}
+	for (auto * expr : m_sys_exprs) {
+		thresholds.Scan(expr);
+	}
+
+	// the limits that UserPolicy::AnalyzePolicy checks itself
+	long long timer_remove = 0, duration = 0, birthday = 0, began = 0, transferred = 0;
+	if (job.LookupInteger(ATTR_TIMER_REMOVE_CHECK, timer_remove)) {
+		thresholds.Add((double)timer_remove + 1);
+	}
+	if (job.LookupInteger(ATTR_SHADOW_BIRTHDATE, birthday)) {
+		if (job.LookupInteger(ATTR_JOB_ALLOWED_JOB_DURATION, duration)) {
+			thresholds.Add((double)(birthday + duration));
+		}
+		if (job.LookupInteger(ATTR_JOB_ALLOWED_EXECUTE_DURATION, duration) &&
+			job.LookupInteger(ATTR_JOB_CURRENT_START_EXECUTING_DATE, began) && began > birthday) {
+			if (job.LookupInteger("TransferOutFinished", transferred) && transferred > began) {
+				began = transferred;
+			}
+			thresholds.Add((double)(began + duration + 1));
+		}
+	}
+
+	unsolved = thresholds.unsolved;
+	return thresholds.next;
+}
+
+void
+PeriodicPolicyTracker::JobEvaluated(JobQueueJob & job, time_t now, bool responsible)
+{
+	if ( ! m_enabled) {
+		return;
+	}
+
+	for (const char * attr : job_policy_attrs) {
+		AddReferences(job.Lookup(attr), job);
+	}
+	// the system expressions may refer to attributes of the job that are expressions
+	for (auto * expr : m_sys_exprs) {
+		AddReferences(expr, job);
+	}
+
+	time_t due = 0;
+	if (responsible) {
+		bool unsolved = false;
+		due = NextTimeThreshold(job, now, unsolved);
+		if (unsolved && ( ! due || due > now + m_interval)) {
+			due = now + m_interval;
+		}
+	}
+	if (due) {
+		Schedule(job.jid, due);
+	} else {
+		// any entry for the job in the wheel will be ignored
+		m_due.erase(job.jid);
+	}
+}
+
+void
+PeriodicPolicyTracker::Schedule(const JOB_ID_KEY & jid, time_t due)
+{
+	if (due <= m_wheel_time) {
+		// the wheel has already passed this time, so evaluate the job on the next pass
+		m_due.erase(jid);
+		m_changed.insert(jid);
+		return;
+	}
+	auto it = m_due.find(jid);
+	if (it != m_due.end()) {
+		if (it->second == due) return;
+		// the old entry stays in the wheel, but is ignored because it no longer matches m_due
+		it->second = due;
+	} else {
+		m_due.emplace(jid, due);
+	}
+	m_wheel[due & (WHEEL_SLOTS-1)].push_back(WheelEntry{jid, due});
+}
+
+void
+PeriodicPolicyTracker::TakeDueJobs(time_t now, std::vector<JOB_ID_KEY> & jobs)
+{
+	jobs.assign(m_changed.begin(), m_changed.end());
+	m_changed.clear();
+
+	if (now > m_wheel_time && ! m_wheel.empty()) {
+		// visit each slot that the wheel turns past, but each slot only once.
+		time_t steps = MIN(now - m_wheel_time, (time_t)WHEEL_SLOTS);
+		for (time_t tt = now - steps + 1; tt <= now; ++tt) {
+			std::vector<WheelEntry> & slot = m_wheel[tt & (WHEEL_SLOTS-1)];
+			size_t keep = 0;
+			for (const auto & entry : slot) {
+				auto it = m_due.find(entry.jid);
+				if (it == m_due.end() || it->second != entry.due) {
+					continue; // the job was scheduled again, or no longer needs to be
+				}
+				if (entry.due <= now) {
+					jobs.push_back(entry.jid);
+					m_due.erase(it);
+				} else {
+					slot[keep++] = entry; // due on a later turn of the wheel
+				}
+			}
+			slot.resize(keep);
+		}
+		m_wheel_time = now;
+	}
+
+	std::sort(jobs.begin(), jobs.end());
+	jobs.erase(std::unique(jobs.begin(), jobs.end()), jobs.end());
+}
+
+int
+PeriodicPolicyTracker::SecondsToNextDue(time_t now) const
+{
+	if ( ! m_changed.empty()) {
+		return 0;
+	}
+	if (m_due.empty()) {
+		return -1;
+	}
+	// the first slot after the wheel time that has entries is the earliest that a job can be due.
+	// it may hold only entries for later turns, in which case we just look again then.
+	for (time_t tt = m_wheel_time + 1; tt <= m_wheel_time + WHEEL_SLOTS; ++tt) {
+		if ( ! m_wheel[tt & (WHEEL_SLOTS-1)].empty()) {
+			return (int)MAX(0, tt - now);
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,136 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _periodic_policy_H_
+#define _periodic_policy_H_
+
+#include "condor_classad.h"
+#include "proc.h"
+#include "user_job_policy.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+class JobQueueJob;
+
+// Finds the earliest time after now at which a comparison in an expression can change its answer,
+// for comparisons where both sides are a sum of the current time and things that don't depend
+// on the time, for instance (time() - EnteredCurrentStatus) > 3600.  Attributes of the job that
+// are themselves expressions are followed.  Any other use of the current time, or attributes nested
+// more than MAX_DEPTH deep, makes the expression unsolved.
+class TimeThresholds {
+public:
+	TimeThresholds(classad::ClassAd & _ad, time_t _now) : ad(_ad), now(_now) {}
+
+	void Scan(const classad::ExprTree * tree, int depth=0);
+	void Add(double when); // the answer may change when the time reaches when
+
+	time_t next {0};       // the earliest time after now, 0 if none
+	bool unsolved {false}; // the expression uses the time in a way that we can't solve
+
+private:
+	enum { LIN_OK, LIN_UNDEFINED, LIN_OPAQUE };
+	static const int MAX_DEPTH = 10;
+
+	bool IsTime(const classad::ExprTree * tree);
+	bool UsesTime(const classad::ExprTree * tree, int depth);
+	int Linear(const classad::ExprTree * tree, int depth, double & a, double & b);
+	const classad::ExprTree * Deref(const classad::ExprTree * tree);
+
+	classad::ClassAd & ad;
+	time_t now;
+};
+
+// Decides which jobs need their periodic policy expressions (PeriodicHold, PeriodicRelease,
+// PeriodicRemove, PeriodicVacate and the SYSTEM_PERIODIC_* versions) evaluated, so that the schedd
+// can evaluate only the jobs that changed instead of walking the whole job queue.
+//
+// A job needs to be evaluated when an attribute that the expressions refer to changes, or when
+// the current time reaches a value at which a comparison in the expressions can change its answer.
+// Changed jobs are kept in a set until the next evaluation pass, jobs waiting for a time are kept
+// in a timer wheel with one slot per second.  Expressions that use the current time in a way that
+// we can't solve for (anything but sums and differences compared to something) are re-evaluated
+// every PERIODIC_EXPR_INTERVAL seconds.
+class PeriodicPolicyTracker {
+public:
+	PeriodicPolicyTracker() {}
+
+	// read the system periodic expressions from config and start over.
+	// interval is the PERIODIC_EXPR_INTERVAL for expressions whose next change can't be known
+	void Config(bool enable, int interval);
+	bool Enabled() const { return m_enabled; }
+
+	// the policy to evaluate the jobs with, initialized by Config()
+	UserPolicy & Policy() { return m_policy; }
+
+	// returns true if a change to this attribute of a job might change the outcome of its policy
+	bool IsPolicyAttr(const char * attr) const {
+		return m_enabled && m_attrs.count(attr) > 0;
+	}
+	// returns true if any of the attributes is a policy attribute
+	bool IsPolicyAttr(const classad::References & attrs) const;
+
+	// the job should be evaluated on the next pass.  returns true if there were no changed jobs before
+	bool JobChanged(const JOB_ID_KEY & jid);
+
+	// schedule the next evaluation of a job that was just evaluated from the time values that its
+	// expressions are waiting for, and learn the attributes that its own expressions refer to.
+	// jobs that the schedd is not responsible for are not scheduled, they wait for a change.
+	void JobEvaluated(JobQueueJob & job, time_t now, bool responsible);
+
+	// forget all changed and scheduled jobs, before a pass that evaluates all of the jobs
+	void Clear();
+
+	// move the jobs that changed, and the jobs whose time has come, into jobs.
+	void TakeDueJobs(time_t now, std::vector<JOB_ID_KEY> & jobs);
+
+	// seconds from now until the earliest time that a job may need to be evaluated,
+	// or -1 if there are no jobs that changed or are waiting for a time.
+	int SecondsToNextDue(time_t now) const;
+
+	size_t NumChanged() const { return m_changed.size(); }
+	size_t NumScheduled() const { return m_due.size(); }
+
+	// evaluate the job when the time reaches due, instead of when it was scheduled for before
+	void Schedule(const JOB_ID_KEY & jid, time_t due);
+
+private:
+	static const int WHEEL_SLOTS = 1024; // must be a power of 2
+
+	struct WheelEntry {
+		JOB_ID_KEY jid;
+		time_t due;
+	};
+
+	time_t NextTimeThreshold(JobQueueJob & job, time_t now, bool & unsolved);
+	void AddReferences(classad::ExprTree * expr, JobQueueJob & job);
+
+	bool m_enabled {false};
+	int m_interval {60};
+	UserPolicy m_policy;
+	std::vector<classad::ExprTree*> m_sys_exprs; // owned by m_policy
+	classad::References m_attrs;         // attributes that the policy of some job refers to
+	std::set<JOB_ID_KEY> m_changed;      // jobs to evaluate on the next pass
+	std::map<JOB_ID_KEY, time_t> m_due;  // the time that each job in the wheel is scheduled for
+	std::vector<std::vector<WheelEntry>> m_wheel;
+	time_t m_wheel_time {0};             // the wheel has been advanced up to this time
+};
+
+#endif
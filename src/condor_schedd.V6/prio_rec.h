@@ -58,4 +58,89 @@ public:
 	}
 };
 
+// a struct with no data and a functor for std::sort
+// This maximizes the likelyhood the compiler will inline
+// the comparison
+struct prio_compar {
+bool operator()(const prio_rec& a, const prio_rec& b) const 
+{
+	// First sort by owner name.  This doesn't need to be alphabetical,
+	// just unique.  Sort first by length, as that's faster,
+	if (a.submitter.length() < b.submitter.length()) {
+		return false;
+	}
+
+	if (a.submitter.length() > b.submitter.length()) {
+		return true;
+	}
+
+	if (a.submitter < b.submitter) {
+		return false;
+	}
+
+	if (a.submitter > b.submitter) {
+		return true;
+	}
+
+	// If we get here, the submitters are the same, so sort by priorities
+	
+	 /* compare submitted job preprio's: higher values have more priority */
+	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
+	if( a.pre_job_prio1 < b.pre_job_prio1 ) {
+		return false;
+	}
+	if( a.pre_job_prio1 > b.pre_job_prio1 ) {
+		return true;
+	}
+
+	if( a.pre_job_prio2 < b.pre_job_prio2 ) {
+		return false;
+	}
+	if( a.pre_job_prio2 > b.pre_job_prio2 ) {
+		return true;
+	}
+	 
+	 /* compare job priorities: higher values have more priority */
+	 if( a.job_prio < b.job_prio ) {
+		  return false;
+	 }
+	 if( a.job_prio > b.job_prio ) {
+		  return true;
+	 }
+	 
+	 /* compare submitted job postprio's: higher values have more priority */
+	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
+	if( a.post_job_prio1 < b.post_job_prio1 ) {
+		return false;
+	}
+	if( a.post_job_prio1 > b.post_job_prio1 ) {
+		return true;
+	}
+
+	if( a.post_job_prio2 < b.post_job_prio2 ) {
+		return false;
+	}
+	if( a.post_job_prio2 > b.post_job_prio2 ) {
+		return true;
+	}
+
+	 /* here, all job_prios are both equal */
+
+	 /* go in order of cluster id */
+	if ( a.id.cluster < b.id.cluster )
+		return true;
+	if ( a.id.cluster > b.id.cluster )
+		return false;
+
+	/* finally, go in order of the proc id */
+	if ( a.id.proc < b.id.proc )
+		return true;
+	if ( a.id.proc > b.id.proc )
+		return false;
+
+	/* give up! very unlikely we'd ever get here */
+	return false;
+}
+};
+
 #endif
@@ -58,6 +58,10 @@
 #include "exit.h"
 #include "credmon_interface.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <math.h>
 #include <param_info.h>
 #include <shortfile.h>
@@ -218,6 +222,7 @@ int		do_Q_request(QmgmtPeer &);
 void	FindPrioJob(PROC_ID &);
 #endif
 void	DoSetAttributeCallbacks(const std::set<std::string> &jobids, int triggers);
+static void PeriodicPolicyChanged(const JobQueueKey & key);
 int		MaterializeJobs(JobQueueCluster * clusterAd, TransactionWatcher & txn, int & retry_delay);
 
 static bool qmgmt_was_initialized = false;
@@ -247,6 +252,7 @@ typedef _condor_auto_accum_runtime< stats_entry_probe<double> > condor_auto_runt
 schedd_runtime_probe WalkJobQ_runtime;
 schedd_runtime_probe WalkJobQ_mark_idle_runtime;
 schedd_runtime_probe WalkJobQ_get_job_prio_runtime;
+schedd_runtime_probe WalkJobQ_collect_unclustered_jobs_runtime;
 
 class Service;
 
@@ -259,6 +265,7 @@ Timeslice   PrioRecArrayTimeslice;
 prio_rec	PrioRecArray[INITIAL_MAX_PRIO_REC];
 prio_rec	* PrioRec = &PrioRecArray[0];
 int			N_PrioRecs = 0;
+IdleJobIndex IdleJobs;
 std::map<int,int> PrioRecAutoClusterRejected;
 int BuildPrioRecArrayTid = -1;
 
@@ -295,6 +302,37 @@ static int dirty_notice_interval = 0;
 static void PeriodicDirtyAttributeNotification(int tid);
 static void ScheduleJobQueueLogFlush();
 
+// group commit of durable transactions, see SyncJobQueueLog()
+static bool job_queue_group_commit = false;
+static int job_queue_group_commit_delay = 0;
+static int job_queue_group_commit_max = 0;
+static int group_commit_timer_id = -1;
+static std::vector<double> group_commit_times; // when each of the pending durable commits was made
+static bool last_commit_awaits_sync = false;
+static void HandleGroupCommitTimer(int tid);
+static void ScheduleJobQueueGroupCommit();
+
+// qmgmt peers that are waiting for their commit to be synced before we reply,
+// the connection is set aside in the meantime, see handle_q()
+struct DeferredCommitReply {
+	QmgmtPeer * peer{nullptr};
+	int rval{0};
+	int terrno{0};
+	std::unique_ptr<CondorError> errstack;
+};
+static std::vector<DeferredCommitReply> deferred_commit_replies;
+static void SendDeferredCommitReplies();
+static int handle_q_resume(Stream *sock);
+
+// write the job queue log in the binary format, takes effect when the log is next rotated
+static bool job_queue_log_binary = false;
+
+// number of threads used to check the jobs as InitJobQueue loads them, 0 is one per core
+static int job_queue_load_threads = 0;
+
+// number of threads used to make autocluster signatures when many jobs need one, 0 is one per core
+static int autocluster_threads = 0;
+
 bool qmgmt_all_users_trusted = false;
 static std::vector<std::string> super_users;
 static const char *default_super_user =
@@ -307,131 +345,6 @@ static const char *default_super_user =
 std::map<JobQueueKey, std::map<std::string, std::string>> PrivateAttrs;
 
 
-// a struct with no data and a functor for std::sort
-// This maximizes the likelyhood the compiler will inline
-// the comparison
-struct prio_compar {
-bool operator()(const prio_rec& a, const prio_rec& b) const 
-{
-	// First sort by owner name.  This doesn't need to be alphabetical,
-	// just unique.  Sort first by length, as that's faster,
-	if (a.submitter.length() < b.submitter.length()) {
-		return false;
-	}
-
-	if (a.submitter.length() > b.submitter.length()) {
-		return true;
-	}
-
-	if (a.submitter < b.submitter) {
-		return false;
-	}
-
-	if (a.submitter > b.submitter) {
-		return true;
-	}
-
-	// If we get here, the submitters are the same, so sort by priorities
-	
-	 /* compare submitted job preprio's: higher values have more priority */
-	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
-	if( a.pre_job_prio1 < b.pre_job_prio1 ) {
-		return false;
-	}
-	if( a.pre_job_prio1 > b.pre_job_prio1 ) {
-		return true;
-	}
-
-	if( a.pre_job_prio2 < b.pre_job_prio2 ) {
-		return false;
-	}
-	if( a.pre_job_prio2 > b.pre_job_prio2 ) {
-		return true;
-	}
-	 
-	 /* compare job priorities: higher values have more priority */
-	 if( a.job_prio < b.job_prio ) {
-		  return false;
-	 }
-	 if( a.job_prio > b.job_prio ) {
-		  return true;
-	 }
-	 
-	 /* compare submitted job postprio's: higher values have more priority */
-	 /* Typically used to prioritize entire DAG jobs over other DAG jobs */
-	if( a.post_job_prio1 < b.post_job_prio1 ) {
-		return false;
-	}
-	if( a.post_job_prio1 > b.post_job_prio1 ) {
-		return true;
-	}
-
-	if( a.post_job_prio2 < b.post_job_prio2 ) {
-		return false;
-	}
-	if( a.post_job_prio2 > b.post_job_prio2 ) {
-		return true;
-	}
-
-	 /* here, all job_prios are both equal */
-
-	 /* go in order of cluster id */
-	if ( a.id.cluster < b.id.cluster )
-		return true;
-	if ( a.id.cluster > b.id.cluster )
-		return false;
-
-	/* finally, go in order of the proc id */
-	if ( a.id.proc < b.id.proc )
-		return true;
-	if ( a.id.proc > b.id.proc )
-		return false;
-
-	/* give up! very unlikely we'd ever get here */
-	return false;
-}
-};
-
-// Return the same comparison as above, but just comparing the submitter
-// field.  This allows us to binary search the PrioRecArray by submitter
-// Note the comparison up to the submitter must match the above
-struct prio_rec_submitter_lb {
-bool operator()(const prio_rec& a, const std::string &user) const {
-	if (a.submitter.length() < user.length()) {
-		return false;
-	}
-
-	if (a.submitter.length() > user.length()) {
-		return true;
-	}
-
-	if (a.submitter > user) {
-		return true;
-	}
-
-	return false;
-}
-};
-
-// The corresponding upper bound function, the negation of the above
-struct prio_rec_submitter_ub {
-bool operator()(const std::string &user, const prio_rec &a) const {
-	if (a.submitter.length() < user.length()) {
-		return true;
-	}
-
-	if (a.submitter.length() > user.length()) {
-		return false;
-	}
-
-	if (a.submitter < user) {
-		return true;
-	}
-
-	return false;
-}
-};
-
 int
 SetPrivateAttributeString(int cluster_id, int proc_id, const char *attr_name, const char *attr_value)
 {
@@ -689,6 +602,8 @@ ConstructClassAdLogTableEntry<JobQueuePayload>::Delete(ClassAd* &ad) const
 		// in which case the actual destruction would be delayed until the transaction commit. i.e. here...
 		IncrementLiveJobCounter(scheduler.liveJobCounts, job->Universe(), job->Status(), -1);
 		if (job->ownerinfo) { IncrementLiveJobCounter(job->ownerinfo->live, job->Universe(), job->Status(), -1); }
+		if (job->submitterdata) { IncrementLiveJobCounter(job->submitterdata->live, job->Universe(), job->Status(), -1); }
+		IdleJobs.JobRemoved(job->jid);
 		if (job->Cluster()) {
 			job->Cluster()->DetachJob(job);
 		}
@@ -1575,6 +1490,24 @@ InitQmgmt()
 
 	flush_job_queue_log_delay = param_integer("SCHEDD_JOB_QUEUE_LOG_FLUSH_DELAY",5,0);
 	dirty_notice_interval = param_integer("SCHEDD_JOB_QUEUE_NOTIFY_UPDATES",30,0);
+
+	job_queue_group_commit = param_boolean("SCHEDD_JOB_QUEUE_GROUP_COMMIT", false);
+	job_queue_group_commit_delay = param_integer("SCHEDD_JOB_QUEUE_GROUP_COMMIT_DELAY",0,0);
+	job_queue_group_commit_max = param_integer("SCHEDD_JOB_QUEUE_GROUP_COMMIT_MAX",1000,1);
+	if (JobQueue) {
+		if ( ! job_queue_group_commit) {
+			SyncJobQueueLog();
+		}
+		JobQueue->SetGroupCommit(job_queue_group_commit);
+	}
+
+	job_queue_log_binary = param_boolean("SCHEDD_JOB_QUEUE_LOG_BINARY", false);
+	if (JobQueue) {
+		JobQueue->SetBinaryLog(job_queue_log_binary);
+	}
+
+	job_queue_load_threads = param_integer("SCHEDD_JOB_QUEUE_LOAD_THREADS", 0, 0);
+	autocluster_threads = param_integer("SCHEDD_AUTOCLUSTER_THREADS", 0, 0);
 }
 
 void
@@ -2136,6 +2069,268 @@ CreateNeededJobsets(
 	return fail_count == 0;
 }
 
+// What InitJobQueue needs to know about each job ad to check it and to fix it up.
+// These are looked up for many jobs at once by several threads, which is safe
+// because looking up an attribute does not change the job ad or its cluster ad.
+// All of the changes are then made by the main thread, one job at a time and
+// in the order that the jobs were loaded, so the result does not depend on the
+// number of threads.
+enum {
+	JLF_NO_CLUSTER_ID          = 0x0001,
+	JLF_NO_OWNER               = 0x0002, // no Owner, or no User when User is the new Owner
+	JLF_NO_USER                = 0x0004,
+	JLF_STALE_USER             = 0x0008,
+	JLF_NO_PROC_ID             = 0x0010,
+	JLF_NO_UNIVERSE            = 0x0020,
+	JLF_HAS_STATUS             = 0x0040,
+	JLF_NO_SCHEDULER           = 0x0080,
+	JLF_STALE_SCHEDULER        = 0x0100,
+	JLF_CRON                   = 0x0200,
+	JLF_HAS_TRANSFERRING_INPUT = 0x0400,
+	JLF_TRANSFERRING_INPUT     = 0x0800,
+	JLF_HAS_TRANSFERRING_OUTPUT= 0x1000,
+	JLF_TRANSFERRING_OUTPUT    = 0x2000,
+	JLF_HAS_TRANSFER_QUEUED    = 0x4000,
+	JLF_TRANSFER_QUEUED        = 0x8000,
+	JLF_HAS_CLAIM_ID           = 0x10000,
+	JLF_HAS_CLAIM_IDS          = 0x20000,
+};
+
+struct JobLoadFacts {
+	int cluster {0};
+	int proc {0};
+	int universe {0};
+	int job_status {0};
+	unsigned int flags {0};
+};
+
+// the jobs are checked this many at a time, which bounds the memory used for JobLoadFacts
+static const size_t JOB_LOAD_BATCH_SIZE = 64*1024;
+// and each thread takes this many jobs at a time from the batch
+static const size_t JOB_LOAD_CHUNK_SIZE = 256;
+
+// the ATTR_USER that a job with the given ATTR_OWNER should have
+static void
+CorrectJobUser(ClassAd * ad, const std::string & owner, std::string & correct_user)
+{
+	#ifdef NO_DEPRECATE_NICE_USER
+	int nice_user = 0;
+	ad->LookupInteger( ATTR_NICE_USER, nice_user );
+	formatstr( correct_user, "%s%s@%s",
+			 (nice_user) ? "nice-user." : "", owner.c_str(),
+			 scheduler.uidDomain() );
+	#else
+	(void)ad;
+	correct_user = owner + "@" + scheduler.uidDomain();
+	#endif
+}
+
+// look up the facts about a job ad. this must not change the ad or the schedd,
+// it is called by several threads at once.
+static void
+LookupJobLoadFacts(JobQueueJob * ad, const std::string & correct_scheduler, JobLoadFacts & facts)
+{
+	std::string owner, user, correct_user, buffer;
+	unsigned int flags = 0;
+	int ival = 0;
+
+	if ( ! ad->LookupInteger(ATTR_CLUSTER_ID, facts.cluster)) {
+		flags |= JLF_NO_CLUSTER_ID;
+	}
+
+	// TODO: fix for USERREC_NAME_IS_FULLY_QUALIFIED
+	if (!ad->LookupString(ATTR_OWNER, owner) || ( !ad->LookupString(ATTR_USER, user) && user_is_the_new_owner)) {
+		flags |= JLF_NO_OWNER;
+	} else if ( ! user_is_the_new_owner) {
+		CorrectJobUser(ad, owner, correct_user);
+		if (user.empty()) {
+			flags |= JLF_NO_USER;
+		} else if (user != correct_user) {
+			flags |= JLF_STALE_USER;
+		}
+	}
+
+	if ( ! ad->LookupInteger(ATTR_PROC_ID, facts.proc)) {
+		flags |= JLF_NO_PROC_ID;
+	}
+	if ( ! ad->LookupInteger(ATTR_JOB_UNIVERSE, facts.universe)) {
+		flags |= JLF_NO_UNIVERSE;
+	}
+	if (ad->LookupInteger(ATTR_JOB_STATUS, facts.job_status)) {
+		flags |= JLF_HAS_STATUS;
+	}
+
+	if (facts.universe == CONDOR_UNIVERSE_MPI || facts.universe == CONDOR_UNIVERSE_PARALLEL) {
+		if ( ! ad->LookupString(ATTR_SCHEDULER, buffer)) {
+			flags |= JLF_NO_SCHEDULER;
+		} else if (buffer != correct_scheduler) {
+			flags |= JLF_STALE_SCHEDULER;
+		}
+	}
+
+	if ( ad->LookupString( ATTR_CRON_MINUTES, buffer ) ||
+		 ad->LookupString( ATTR_CRON_HOURS, buffer ) ||
+		 ad->LookupString( ATTR_CRON_DAYS_OF_MONTH, buffer ) ||
+		 ad->LookupString( ATTR_CRON_MONTHS, buffer ) ||
+		 ad->LookupString( ATTR_CRON_DAYS_OF_WEEK, buffer ) ) {
+		flags |= JLF_CRON;
+	}
+
+	if (ad->LookupInteger(ATTR_TRANSFERRING_INPUT, ival)) {
+		flags |= JLF_HAS_TRANSFERRING_INPUT | (ival ? JLF_TRANSFERRING_INPUT : 0);
+	}
+	if (ad->LookupInteger(ATTR_TRANSFERRING_OUTPUT, ival)) {
+		flags |= JLF_HAS_TRANSFERRING_OUTPUT | (ival ? JLF_TRANSFERRING_OUTPUT : 0);
+	}
+	if (ad->LookupInteger(ATTR_TRANSFER_QUEUED, ival)) {
+		flags |= JLF_HAS_TRANSFER_QUEUED | (ival ? JLF_TRANSFER_QUEUED : 0);
+	}
+	if (ad->LookupString(ATTR_CLAIM_ID, buffer)) {
+		flags |= JLF_HAS_CLAIM_ID;
+	}
+	if (ad->LookupString(ATTR_CLAIM_IDS, buffer)) {
+		flags |= JLF_HAS_CLAIM_IDS;
+	}
+
+	facts.flags = flags;
+}
+
+// A set of threads that look up the JobLoadFacts of a batch of jobs.  The threads
+// are started once for the whole load of the job queue and sleep between batches.
+// The calling thread looks up facts too, so the pool has num_threads-1 helpers.
+class JobLoadFactsPool
+{
+public:
+	JobLoadFactsPool(int num_threads, const std::string & correct_scheduler);
+	~JobLoadFactsPool();
+	JobLoadFactsPool(const JobLoadFactsPool&) = delete;
+	JobLoadFactsPool& operator=(const JobLoadFactsPool&) = delete;
+
+	int threads() const { return (int)m_busy.size(); }
+
+	// look up the facts for jobs[first..last) into facts[0..last-first).
+	// returns the time spent looking up facts summed over the threads.
+	double lookup(const std::vector<JobQueueJob*> & jobs, size_t first, size_t last, std::vector<JobLoadFacts> & facts);
+
+private:
+	void helperMain(int id);
+	void work(int id);
+
+	const std::string & m_correct_scheduler;
+	std::vector<std::thread> m_threads;
+	std::vector<double> m_busy;       // per thread, for the current batch
+
+	std::mutex m_mutex;
+	std::condition_variable m_start_cv;
+	std::condition_variable m_done_cv;
+	unsigned long m_generation {0};   // guarded by m_mutex, advanced for each batch
+	int m_running {0};                // guarded by m_mutex, helpers still working
+	bool m_stopping {false};          // guarded by m_mutex
+
+	// the current batch, set before the helpers are started
+	const std::vector<JobQueueJob*> * m_jobs {nullptr};
+	std::vector<JobLoadFacts> * m_facts {nullptr};
+	size_t m_first {0};
+	size_t m_last {0};
+	size_t m_chunks {0};
+	std::atomic<size_t> m_next_chunk {0};
+};
+
+JobLoadFactsPool::JobLoadFactsPool(int num_threads, const std::string & correct_scheduler)
+	: m_correct_scheduler(correct_scheduler)
+	, m_busy(MAX(1, num_threads), 0.0)
+{
+	for (int id = 1; id < threads(); ++id) {
+		m_threads.emplace_back(&JobLoadFactsPool::helperMain, this, id);
+	}
+}
+
+JobLoadFactsPool::~JobLoadFactsPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopping = true;
+	}
+	m_start_cv.notify_all();
+	for (auto & thr : m_threads) {
+		thr.join();
+	}
+}
+
+void
+JobLoadFactsPool::helperMain(int id)
+{
+	unsigned long seen = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_start_cv.wait(lock, [&]{ return m_stopping || m_generation != seen; });
+		if (m_stopping) {
+			break;
+		}
+		seen = m_generation;
+		lock.unlock();
+
+		work(id);
+
+		lock.lock();
+		if (--m_running == 0) {
+			m_done_cv.notify_one();
+		}
+	}
+}
+
+void
+JobLoadFactsPool::work(int id)
+{
+	double begin = _condor_debug_get_time_double();
+	const std::vector<JobQueueJob*> & jobs = *m_jobs;
+	std::vector<JobLoadFacts> & facts = *m_facts;
+	size_t chunk;
+	while ((chunk = m_next_chunk.fetch_add(1)) < m_chunks) {
+		size_t begin_ix = m_first + chunk * JOB_LOAD_CHUNK_SIZE;
+		size_t end_ix = MIN(begin_ix + JOB_LOAD_CHUNK_SIZE, m_last);
+		for (size_t ix = begin_ix; ix < end_ix; ++ix) {
+			LookupJobLoadFacts(jobs[ix], m_correct_scheduler, facts[ix - m_first]);
+		}
+	}
+	m_busy[id] = _condor_debug_get_time_double() - begin;
+}
+
+double
+JobLoadFactsPool::lookup(const std::vector<JobQueueJob*> & jobs, size_t first, size_t last, std::vector<JobLoadFacts> & facts)
+{
+	facts.assign(last - first, JobLoadFacts());
+	m_jobs = &jobs;
+	m_facts = &facts;
+	m_first = first;
+	m_last = last;
+	m_chunks = (last - first + JOB_LOAD_CHUNK_SIZE - 1) / JOB_LOAD_CHUNK_SIZE;
+	m_next_chunk = 0;
+	std::fill(m_busy.begin(), m_busy.end(), 0.0);
+
+	// a batch too small to split is done by this thread alone
+	bool helpers = ! m_threads.empty() && m_chunks > 1;
+	if (helpers) {
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_running = (int)m_threads.size();
+			++m_generation;
+		}
+		m_start_cv.notify_all();
+	}
+
+	work(0);
+
+	if (helpers) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done_cv.wait(lock, [this]{ return m_running == 0; });
+	}
+
+	double total = 0.0;
+	for (double secs : m_busy) { total += secs; }
+	return total;
+}
+
 void
 InitJobQueue(const char *job_queue_name,int max_historical_logs)
 {
@@ -2168,9 +2363,13 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 #else
 	JobQueue = new JobQueueType(new ConstructClassAdLogTableEntry<JobQueuePayload>());
 #endif
+	JobQueue->SetBinaryLog(job_queue_log_binary);
+	double replay_begin = _condor_debug_get_time_double();
 	if( !JobQueue->InitLogFile(job_queue_name,max_historical_logs) ) {
 		EXCEPT("Failed to initialize job queue log!");
 	}
+	double replay_done = _condor_debug_get_time_double();
+	JobQueue->SetGroupCommit(job_queue_group_commit);
 	ClusterSizeHashTable = new ClusterSizeHashTable_t(hashFuncInt);
 	TotalJobsCount = 0;
 	jobs_added_this_transaction = 0;
@@ -2188,9 +2387,7 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	bool	CreatedAd = false;
 	JobQueueKey cluster_key;
 	std::string	owner;
-	std::string	user;
 	std::string correct_user;
-	std::string	attr_scheduler;
 	std::string correct_scheduler;
 	std::string buffer;
 	std::string name1;
@@ -2258,6 +2455,10 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	}
 #endif
 
+	// link the jobs to their clusters as they are iterated, and check them afterwards
+	std::vector<JobQueueJob*> loaded_jobs;
+
+	double link_begin = _condor_debug_get_time_double();
 	next_cluster_num = cluster_initial_val;
 	JobQueue->StartIterateAllClassAds();
 	while (JobQueue->Iterate(key,bad)) {
@@ -2304,8 +2505,6 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 
 		// this brace isn't needed anymore, it's here to avoid re-indenting all of the code below.
 		{
-			JOB_ID_KEY_BUF job_id(key);
-
 			// find highest cluster, set next_cluster_num to one increment higher
 			if (cluster_num >= next_cluster_num) {
 				next_cluster_num = cluster_num + cluster_increment_val;
@@ -2346,9 +2545,46 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 				ad->set_id = clusterad->set_id; // cluster ad may not have the right id yet, but it's still ok to copy it
 			}
 			ad->PopulateFromAd();
+			loaded_jobs.push_back(ad);
+		}
+	} // WHILE
+	double link_done = _condor_debug_get_time_double();
+
+	int load_threads = job_queue_load_threads;
+	if (load_threads <= 0) {
+		load_threads = MAX(1, (int)std::thread::hardware_concurrency());
+	}
+	size_t load_chunks = (loaded_jobs.size() + JOB_LOAD_CHUNK_SIZE - 1) / JOB_LOAD_CHUNK_SIZE;
+	load_threads = (int)MAX((size_t)1, MIN((size_t)load_threads, load_chunks));
+
+	// check the jobs and fix them up. the lookups are done by a pool of threads for a
+	// batch of jobs, then the jobs in the batch are changed one at a time in load order.
+	// only the lookups are done in parallel: fixing up a job changes the ad, which goes
+	// through the classad library's shared expression cache, and the job queue table,
+	// the schedd's indexes and counters, the cluster sizes and PrivateAttrs that the
+	// rest of the loop changes are shared by all of the clusters.
+	double check_time = 0.0, check_busy = 0.0, apply_time = 0.0;
+	std::vector<JobLoadFacts> batch_facts;
+	std::unique_ptr<JobLoadFactsPool> load_pool(new JobLoadFactsPool(load_threads, correct_scheduler));
+	for (size_t first = 0; first < loaded_jobs.size(); first += JOB_LOAD_BATCH_SIZE) {
+		size_t last = MIN(first + JOB_LOAD_BATCH_SIZE, loaded_jobs.size());
+		double begin = _condor_debug_get_time_double();
+		check_busy += load_pool->lookup(loaded_jobs, first, last, batch_facts);
+		double checked = _condor_debug_get_time_double();
+		check_time += checked - begin;
+
+		for (size_t ix = first; ix < last; ++ix) {
+			JobQueueJob * ad = loaded_jobs[ix];
+			const JobLoadFacts & facts = batch_facts[ix - first];
+			JOB_ID_KEY_BUF job_id(ad->jid);
+			cluster_num = ad->jid.cluster;
+			clusterad = ad->Cluster();
+			cluster = facts.cluster;
+			proc = facts.proc;
+			universe = facts.universe;
 
 			// sanity check some immutable attributes
-			if (!ad->LookupInteger(ATTR_CLUSTER_ID, cluster)) {
+			if (facts.flags & JLF_NO_CLUSTER_ID) {
 				dprintf(D_ALWAYS,
 						"Job %s has no %s attribute.  Removing....\n",
 						job_id.c_str(), ATTR_CLUSTER_ID);
@@ -2364,10 +2600,7 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 				continue;
 			}
 
-
-			// TODO: fix for USERREC_NAME_IS_FULLY_QUALIFIED
-			user.clear();
-			if (!ad->LookupString(ATTR_OWNER, owner) || ( !ad->LookupString(ATTR_USER, user) && user_is_the_new_owner)) {
+			if (facts.flags & JLF_NO_OWNER) {
 				dprintf(D_ALWAYS,
 						"Job %s has no " ATTR_OWNER " or no " ATTR_USER " attribute.  Removing....\n",
 						job_id.c_str());
@@ -2376,41 +2609,19 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 			}
 
 			// TODO: shouldn't this be happening to the cluster ad?
-			if ( ! user_is_the_new_owner) {
-
-				// Figure out what ATTR_USER *should* be for this job
-				#ifdef NO_DEPRECATE_NICE_USER
-				int nice_user = 0;
-				ad->LookupInteger( ATTR_NICE_USER, nice_user );
-				formatstr( correct_user, "%s%s@%s",
-						 (nice_user) ? "nice-user." : "", owner.c_str(),
-						 scheduler.uidDomain() );
-				#else
-				correct_user = owner + "@" + scheduler.uidDomain();
-				#endif
-
-				if (user.empty()) {
-					dprintf( D_FULLDEBUG,
-							"Job %s has no %s attribute.  Inserting one now...\n",
-							job_id.c_str(), ATTR_USER);
-					ad->Assign( ATTR_USER, correct_user );
-					JobQueueDirty = true;
-				} else {
-						// ATTR_USER exists, make sure it's correct, and
-						// if not, insert the new value now.
-					if( user != correct_user ) {
-							// They're different, so insert the right value
-						dprintf( D_FULLDEBUG,
-								 "Job %s has stale %s attribute.  "
-								 "Inserting correct value now...\n",
-								 job_id.c_str(), ATTR_USER );
-						ad->Assign( ATTR_USER, correct_user );
-						JobQueueDirty = true;
-					}
-				}
+			if (facts.flags & (JLF_NO_USER | JLF_STALE_USER)) {
+				ad->LookupString(ATTR_OWNER, owner);
+				CorrectJobUser(ad, owner, correct_user);
+				dprintf( D_FULLDEBUG,
+						(facts.flags & JLF_NO_USER)
+							? "Job %s has no %s attribute.  Inserting one now...\n"
+							: "Job %s has stale %s attribute.  Inserting correct value now...\n",
+						job_id.c_str(), ATTR_USER);
+				ad->Assign( ATTR_USER, correct_user );
+				JobQueueDirty = true;
 			}
 
-			if (!ad->LookupInteger(ATTR_PROC_ID, proc)) {
+			if (facts.flags & JLF_NO_PROC_ID) {
 				dprintf(D_ALWAYS,
 						"Job %s has no %s attribute.  Removing....\n",
 						job_id.c_str(), ATTR_PROC_ID);
@@ -2418,7 +2629,7 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 				continue;
 			}
 
-			if( !ad->LookupInteger( ATTR_JOB_UNIVERSE, universe ) ) {
+			if (facts.flags & JLF_NO_UNIVERSE) {
 				dprintf( D_ALWAYS,
 						 "Job %s has no %s attribute.  Removing....\n",
 						 job_id.c_str(), ATTR_JOB_UNIVERSE );
@@ -2435,12 +2646,10 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 				continue;
 			}
 
-			int job_status = 0;
-			if (ad->LookupInteger(ATTR_JOB_STATUS, job_status)) {
+			int job_status = facts.job_status;
+			if (facts.flags & JLF_HAS_STATUS) {
 				if (ad->Status() != job_status) {
-					if (clusterad) {
-						clusterad->JobStatusChanged(ad->Status(), job_status);
-					}
+					clusterad->JobStatusChanged(ad->Status(), job_status);
 					ad->SetStatus(job_status);
 				}
 				IncrementLiveJobCounter(scheduler.liveJobCounts, ad->Universe(), ad->Status(), 1);
@@ -2450,29 +2659,14 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 				// Make sure ATTR_SCHEDULER is correct.
 				// XXX TODO: Need a better way than hard-coded
 				// universe check to decide if a job is "dedicated"
-			if( universe == CONDOR_UNIVERSE_MPI ||
-				universe == CONDOR_UNIVERSE_PARALLEL ) {
-				if( !ad->LookupString(ATTR_SCHEDULER, attr_scheduler) ) { 
-					dprintf( D_FULLDEBUG, "Job %s has no %s attribute.  "
-							 "Inserting one now...\n", job_id.c_str(),
-							 ATTR_SCHEDULER );
-					ad->Assign( ATTR_SCHEDULER, correct_scheduler );
-					JobQueueDirty = true;
-				} else {
-
-						// ATTR_SCHEDULER exists, make sure it's correct,
-						// and if not, insert the new value now.
-					if( attr_scheduler != correct_scheduler ) {
-							// They're different, so insert the right
-							// value 
-						dprintf( D_FULLDEBUG,
-								 "Job %s has stale %s attribute.  "
-								 "Inserting correct value now...\n",
-								 job_id.c_str(), ATTR_SCHEDULER );
-						ad->Assign( ATTR_SCHEDULER, correct_scheduler );
-						JobQueueDirty = true;
-					}
-				}
+			if (facts.flags & (JLF_NO_SCHEDULER | JLF_STALE_SCHEDULER)) {
+				dprintf( D_FULLDEBUG,
+						(facts.flags & JLF_NO_SCHEDULER)
+							? "Job %s has no %s attribute.  Inserting one now...\n"
+							: "Job %s has stale %s attribute.  Inserting correct value now...\n",
+						job_id.c_str(), ATTR_SCHEDULER );
+				ad->Assign( ATTR_SCHEDULER, correct_scheduler );
+				JobQueueDirty = true;
 			}
 			
 				//
@@ -2481,11 +2675,7 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 				// by the crontab feature, then we will tell the 
 				// schedd that this job needs to have runtimes calculated
 				// 
-			if ( ad->LookupString( ATTR_CRON_MINUTES, buffer ) ||
-				 ad->LookupString( ATTR_CRON_HOURS, buffer ) ||
-				 ad->LookupString( ATTR_CRON_DAYS_OF_MONTH, buffer ) ||
-				 ad->LookupString( ATTR_CRON_MONTHS, buffer ) ||
-				 ad->LookupString( ATTR_CRON_DAYS_OF_WEEK, buffer ) ) {
+			if (facts.flags & JLF_CRON) {
 				scheduler.addCronTabClassAd( ad );
 			}
 
@@ -2510,12 +2700,9 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 
 				// make file transfer status attributes sane in case
 				// we died while in the middle of transferring
-			int transferring_input = false;
-			int transferring_output = false;
-			int transfer_queued = false;
-			if( ad->LookupInteger(ATTR_TRANSFERRING_INPUT,transferring_input) ) {
+			if (facts.flags & JLF_HAS_TRANSFERRING_INPUT) {
 				if( job_status == RUNNING ) {
-					if( transferring_input ) {
+					if (facts.flags & JLF_TRANSFERRING_INPUT) {
 						ad->Assign(ATTR_TRANSFERRING_INPUT,false);
 						JobQueueDirty = true;
 					}
@@ -2525,9 +2712,9 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 					JobQueueDirty = true;
 				}
 			}
-			if( ad->LookupInteger(ATTR_TRANSFERRING_OUTPUT,transferring_output) ) {
+			if (facts.flags & JLF_HAS_TRANSFERRING_OUTPUT) {
 				if( job_status == RUNNING ) {
-					if( transferring_output ) {
+					if (facts.flags & JLF_TRANSFERRING_OUTPUT) {
 						ad->Assign(ATTR_TRANSFERRING_OUTPUT,false);
 						JobQueueDirty = true;
 					}
@@ -2537,9 +2724,9 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 					JobQueueDirty = true;
 				}
 			}
-			if( ad->LookupInteger(ATTR_TRANSFER_QUEUED,transfer_queued) ) {
+			if (facts.flags & JLF_HAS_TRANSFER_QUEUED) {
 				if( job_status == RUNNING ) {
-					if( transfer_queued ) {
+					if (facts.flags & JLF_TRANSFER_QUEUED) {
 						ad->Assign(ATTR_TRANSFER_QUEUED,false);
 						JobQueueDirty = true;
 					}
@@ -2549,21 +2736,24 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 					JobQueueDirty = true;
 				}
 			}
-			if( ad->LookupString(ATTR_CLAIM_ID, buffer) ) {
+			if( (facts.flags & JLF_HAS_CLAIM_ID) && ad->LookupString(ATTR_CLAIM_ID, buffer) ) {
 				ad->Delete(ATTR_CLAIM_ID);
-				PrivateAttrs[key][ATTR_CLAIM_ID] = buffer;
+				PrivateAttrs[ad->jid][ATTR_CLAIM_ID] = buffer;
 			}
-			if( ad->LookupString(ATTR_CLAIM_IDS, buffer) ) {
+			if( (facts.flags & JLF_HAS_CLAIM_IDS) && ad->LookupString(ATTR_CLAIM_IDS, buffer) ) {
 				ad->Delete(ATTR_CLAIM_IDS);
-				PrivateAttrs[key][ATTR_CLAIM_IDS] = buffer;
+				PrivateAttrs[ad->jid][ATTR_CLAIM_IDS] = buffer;
 			}
 
 			// count up number of procs in cluster, update ClusterSizeHashTable
 			int num_procs = IncrementClusterSize(cluster_num);
-			if (clusterad) clusterad->SetClusterSize(num_procs);
+			clusterad->SetClusterSize(num_procs);
 			TotalJobsCount++;
 		}
-	} // WHILE
+		apply_time += _condor_debug_get_time_double() - checked;
+	}
+	load_pool.reset();
+	double apply_done = _condor_debug_get_time_double();
 
 	// If this is a personal condor, ensure we have a user record for the
 	// user we're running as.
@@ -2591,6 +2781,7 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	}
 	scheduler.clearPendingOwners();
 #endif
+	double userrec_done = _condor_debug_get_time_double();
 
 	// If JobSets enabled, scan again to create needed jobsets and add jobs into jobSets runtime structures
 	if (scheduler.jobSets) {
@@ -2667,6 +2858,7 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 			}
 		}
 	}
+	double jobsets_done = _condor_debug_get_time_double();
 
 
     // We defined a candidate next_cluster_num above, as (current-max-clust) + (increment).
@@ -2727,6 +2919,13 @@ InitJobQueue(const char *job_queue_name,int max_historical_logs)
 	if( spool_cur_version != SPOOL_CUR_VERSION_SCHEDD_SUPPORTS ) {
 		WriteSpoolVersion(spool.c_str(),SPOOL_MIN_VERSION_SCHEDD_WRITES,SPOOL_CUR_VERSION_SCHEDD_SUPPORTS);
 	}
+
+	double done = _condor_debug_get_time_double();
+	dprintf(D_ALWAYS, "Loaded %d jobs from the job queue in %.3f seconds: replay %.3f, link %.3f, "
+		"check %.3f (%d threads, %.3f busy), apply %.3f, user records %.3f, jobsets %.3f, other %.3f\n",
+		TotalJobsCount, done - replay_begin, replay_done - replay_begin, link_done - link_begin,
+		check_time, load_threads, check_busy, apply_time, userrec_done - apply_done,
+		jobsets_done - userrec_done, (link_begin - replay_done) + (done - jobsets_done));
 }
 
 
@@ -3688,6 +3887,58 @@ unsetQSock()
 }
 
 
+// Set the current connection aside while its commit waits for the group
+// commit sync.  SendDeferredCommitReplies() sends the reply and then
+// handle_q_resume() carries on with the session.
+static void
+ParkQSock()
+{
+	ReliSock * sock = Q_SOCK->getReliSock();
+	if (daemonCore->SocketIsRegistered(sock)) {
+		daemonCore->Cancel_Socket(sock);
+	}
+	dprintf(D_FULLDEBUG, "QMGR waiting for the job queue sync to reply to %s\n", sock->peer_description());
+
+		// saves the connection state in the QmgmtPeer and sets Q_SOCK to null
+	getQmgmtConnectionInfo();
+}
+
+// called when a connection that was set aside by ParkQSock() has its next request
+static int
+handle_q_resume(Stream *sock)
+{
+	auto * peer = static_cast<QmgmtPeer*>(daemonCore->GetDataPtr());
+	ASSERT(peer && ! Q_SOCK);
+	if ( ! setQmgmtConnectionInfo(peer)) {
+		dprintf(D_ALWAYS, "QMGR unable to resume connection from %s\n", sock->peer_description());
+		delete peer;
+		return FALSE;
+	}
+
+	int rval = -1;
+	if (sock->deadline_expired()) {
+		dprintf(D_ALWAYS, "QMGR connection from %s timed out waiting for a request\n", sock->peer_description());
+	} else {
+		sock->set_deadline(0);
+		do {
+			rval = do_Q_request(*Q_SOCK);
+		} while(rval >= 0 && rval != Q_REPLY_DEFERRED);
+	}
+
+	if (rval == Q_REPLY_DEFERRED) {
+		ParkQSock();
+		return KEEP_STREAM;
+	}
+
+	unsetQSock();
+	dprintf(D_FULLDEBUG, "QMGR Connection closed\n");
+
+	// Abort any uncompleted transaction.
+	AbortTransactionAndRecomputeClusters();
+
+	return FALSE;
+}
+
 int
 handle_q(int cmd, Stream *sock)
 {
@@ -3722,7 +3973,12 @@ handle_q(int cmd, Stream *sock)
 		do {
 			/* Probably should wrap a timer around this */
 			rval = do_Q_request(*Q_SOCK);
-		} while(rval >= 0);
+		} while(rval >= 0 && rval != Q_REPLY_DEFERRED);
+	}
+
+	if (rval == Q_REPLY_DEFERRED) {
+		ParkQSock();
+		return KEEP_STREAM;
 	}
 
 	unsetQSock();
@@ -4561,6 +4817,7 @@ enum {
 	catSetUserRec   = 0x1000,    // a UserRec was edited
 	catNewUser      = 0x2000,    // a new job "owner" or "user" was added
 	catSetOwner     = 0x4000,    // the ATTR_OWNER or ATTR_USER of a job or jobset was set/changed
+	catPeriodicPolicy = 0x8000,  // an attribute that the periodic policy refers to was set/changed
 	catCallbackTrigger = 0x10000, // indicates that a callback should happen on commit of this attribute
 	catCallbackNow = 0x20000,    // indicates that a callback should happen when setAttribute is called
 };
@@ -5466,6 +5723,13 @@ SetAttribute(int cluster_id, int proc_id, const char *attr_name,
 					"ClassAd attribute %s=%s changed\n",
 					attr_name,attr_value);
 		}
+
+		// re-evaluate the periodic policy of the job after the change is committed
+		if (scheduler.periodicPolicy.IsPolicyAttr(attr_name)) {
+			if ( ! JobQueue->SetTransactionTriggers(catPeriodicPolicy)) {
+				PeriodicPolicyChanged(key);
+			}
+		}
 	}
 
 	// This block handles rounding of attributes.
@@ -5688,6 +5952,23 @@ SetAttribute(int cluster_id, int proc_id, const char *attr_name,
 }
 
 
+// Tell the periodic policy tracker that the policy of a job, or of all of the jobs of a cluster, may have changed.
+static void PeriodicPolicyChanged(const JobQueueKey & key)
+{
+	if (key.cluster <= 0) {
+		return; // not a job or cluster ad
+	}
+	if (key.proc >= 0) {
+		scheduler.PeriodicExprsChanged(key);
+	} else if (key.proc == -1) {
+		JobQueueCluster * cad = GetClusterAd(key.cluster);
+		if ( ! cad) return;
+		for (JobQueueJob * job = cad->FirstJob(); job; job = cad->NextJob(job)) {
+			scheduler.PeriodicExprsChanged(job->jid);
+		}
+	}
+}
+
 // For now this just updates counters for idle/running/held jobs
 // but in the future it could dispatch various callbacks based on the flags in triggers.
 //
@@ -5742,10 +6023,8 @@ void DoSetAttributeCallbacks(const std::set<std::string> &jobids, int triggers)
 					IncrementLiveJobCounter(job->ownerinfo->live, universe, job->Status(), -1);
 					IncrementLiveJobCounter(job->ownerinfo->live, universe, job_status, 1);
 				}
-				//if (job->submitterdata) {
-				//	IncrementLiveJobCounter(job->submitterdata->live, universe, job->Status(), -1);
-				//	IncrementLiveJobCounter(job->submitterdata->live, universe, job_status, 1);
-				//}
+				// this also finds the submitter of a new job, so it is counted there from the start
+				scheduler.updateSubmitterLiveJobCounts(job, job->Status(), job_status);
 
 				IncrementLiveJobCounter(scheduler.liveJobCounts, universe, job->Status(), -1);
 				IncrementLiveJobCounter(scheduler.liveJobCounts, universe, job_status, 1);
@@ -5762,6 +6041,14 @@ void DoSetAttributeCallbacks(const std::set<std::string> &jobids, int triggers)
 						triggers |= catMaterializeState;
 					}
 				}
+
+				// keep the index of idle jobs used by negotiation and claim reuse current.
+				// jobs that were not idle at the last PrioRec rebuild wait for the next one.
+				if (job_status == IDLE) {
+					IdleJobs.JobIdle(job_id);
+				} else if (job->Status() == IDLE) {
+					IdleJobs.JobNotIdle(job_id);
+				}
 				job->SetStatus(job_status);
 			}
 		}
@@ -5883,6 +6170,127 @@ HandleFlushJobQueueLogTimer(int /* tid */)
 	JobQueue->FlushLog();
 }
 
+// The microseconds from the start of a durable commit to the end of the
+// fsync that made it durable, and the microseconds of each fsync.
+static void
+RecordJobQueueCommit(double commit_time, double sync_begin, double sync_end)
+{
+	scheduler.stats.JobQueueCommitLatency += (int64_t)((sync_end - commit_time) * 1e6);
+	if (sync_begin > 0) {
+		scheduler.stats.JobQueueSyncTime += (int64_t)((sync_end - sync_begin) * 1e6);
+	}
+}
+
+void
+ScheduleJobQueueGroupCommit()
+{
+		// With a delay of 0 the timer fires as soon as the current pass of
+		// the event loop is done, so commits made while handling the events
+		// that are already waiting share one fsync.
+	if( group_commit_timer_id == -1 ) {
+		group_commit_timer_id = daemonCore->Register_Timer(
+			job_queue_group_commit_delay,
+			HandleGroupCommitTimer,
+			"HandleGroupCommitTimer");
+	}
+}
+
+void
+HandleGroupCommitTimer(int /* tid */)
+{
+	group_commit_timer_id = -1;
+	SyncJobQueueLog();
+}
+
+int
+SyncJobQueueLog()
+{
+	int synced = 0;
+	last_commit_awaits_sync = false;
+	if ( ! JobQueue || JobQueue->PendingSyncCount() == 0) {
+			// nothing pending, or a ForceLog() already synced it
+		group_commit_times.clear();
+	} else {
+		double begin = _condor_debug_get_time_double();
+		synced = JobQueue->SyncLog();
+		double end = _condor_debug_get_time_double();
+
+		for (size_t ix = 0; ix < group_commit_times.size(); ++ix) {
+			RecordJobQueueCommit(group_commit_times[ix], ix ? 0 : begin, end);
+		}
+		scheduler.stats.JobQueueSyncs += 1;
+		scheduler.stats.JobQueueSyncedCommits += synced;
+		dprintf(D_FULLDEBUG, "Synced %d job queue commits in %.6f seconds, replying to %d clients\n",
+			synced, end - begin, (int)deferred_commit_replies.size());
+		group_commit_times.clear();
+	}
+
+	if (group_commit_timer_id != -1) {
+		daemonCore->Cancel_Timer(group_commit_timer_id);
+		group_commit_timer_id = -1;
+	}
+
+		// every commit that a client is waiting for is on disk now
+	SendDeferredCommitReplies();
+	return synced;
+}
+
+bool
+JobQueueCommitAwaitsSync()
+{
+	return last_commit_awaits_sync && JobQueue && JobQueue->PendingSyncCount() > 0;
+}
+
+void
+DeferCommitTransactionReply(QmgmtPeer & peer, int rval, int terrno, std::unique_ptr<CondorError> errstack)
+{
+	DeferredCommitReply reply;
+	reply.peer = &peer;
+	reply.rval = rval;
+	reply.terrno = terrno;
+	reply.errstack = std::move(errstack);
+	deferred_commit_replies.emplace_back(std::move(reply));
+	ScheduleJobQueueGroupCommit();
+}
+
+static void
+SendDeferredCommitReplies()
+{
+	if (deferred_commit_replies.empty()) {
+		return;
+	}
+
+		// sending a reply can't add to the list, but take it anyway
+	std::vector<DeferredCommitReply> replies;
+	replies.swap(deferred_commit_replies);
+
+	for (auto & reply : replies) {
+		QmgmtPeer * peer = reply.peer;
+		ReliSock * sock = peer->getReliSock();
+		if (SendCommitTransactionReply(*peer, reply.rval, reply.terrno, reply.errstack.get()) < 0) {
+			dprintf(D_ALWAYS, "QMGR failed to send commit reply to %s\n", sock->peer_description());
+			delete peer;
+			delete sock;
+			continue;
+		}
+
+			// wait for the next request without blocking the schedd
+		int rc = daemonCore->Register_Socket(sock, "QMGMT peer",
+			handle_q_resume, "handle_q_resume", HANDLE_READ);
+		if (rc < 0) {
+			dprintf(D_ALWAYS, "QMGR failed to register connection from %s, closing it\n", sock->peer_description());
+			delete peer;
+			delete sock;
+			continue;
+		}
+		daemonCore->SetDataPtr(peer);
+		int timeout = sock->get_timeout_raw();
+		if (timeout > 0) {
+			sock->set_deadline_timeout(timeout);
+		}
+	}
+}
+
 int
 SetTimerAttribute( int cluster, int proc, const char *attr_name, int dur )
 {
@@ -6953,12 +7361,29 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 		commit_comment = comment;
 	}
 
+	last_commit_awaits_sync = false;
 	if(! durable) {
 		JobQueue->CommitNondurableTransaction(commit_comment);
 		ScheduleJobQueueLogFlush();
 	}
 	else {
+		bool empty = JobQueue->EmptyTransaction();
+		double begin = _condor_debug_get_time_double();
 		JobQueue->CommitTransaction(commit_comment);
+		if (empty) {
+			// nothing was written
+		} else if (JobQueue->GetGroupCommit()) {
+				// the fsync was deferred, the commit is durable after the next SyncJobQueueLog()
+			group_commit_times.push_back(begin);
+			if (JobQueue->PendingSyncCount() >= job_queue_group_commit_max) {
+				SyncJobQueueLog();
+			} else {
+				last_commit_awaits_sync = true;
+				ScheduleJobQueueGroupCommit();
+			}
+		} else {
+			RecordJobQueueCommit(begin, begin, _condor_debug_get_time_double());
+		}
 	}
 
 	//----------------------------------------
@@ -7228,6 +7653,20 @@ int CommitTransactionInternal( bool durable, CondorError * errorStack ) {
 	}	// end of if a new cluster(s) submitted
 
 
+	// new jobs and jobs whose policy attributes changed need their periodic policy evaluated
+	if (scheduler.periodicPolicy.Enabled()) {
+		for (const auto & key : new_ad_keys) {
+			JobQueueKey jid(key.c_str());
+			if (jid.cluster > 0 && jid.proc >= 0) { scheduler.PeriodicExprsChanged(jid); }
+		}
+		if (triggers & catPeriodicPolicy) {
+			for (const auto & key : ad_keys) {
+				PeriodicPolicyChanged(JobQueueKey(key.c_str()));
+			}
+		}
+	}
+	triggers &= ~catPeriodicPolicy;
+
 	// finally, invoke callbacks that were triggered by various SetAttribute calls in the transaction.
 	// NOTE: you might be tempted to move this up above the processing of new ad keys, but that won't work
 	// because most lookups in the job ad don't work until it has been chained to the cluster ad.
@@ -7595,6 +8034,12 @@ DeleteAttribute(int cluster_id, int proc_id, const char *attr_name)
 
 	JobQueue->DeleteAttribute(key, attr_name);
 
+	if (scheduler.periodicPolicy.IsPolicyAttr(attr_name)) {
+		if ( ! JobQueue->SetTransactionTriggers(catPeriodicPolicy)) {
+			PeriodicPolicyChanged(key);
+		}
+	}
+
 	JobQueueDirty = true;
 
 	return 1;
@@ -8865,12 +9310,12 @@ int get_job_prio(JobQueueJob *job, const JOB_ID_KEY & jid, void *)
 	GetAutoCluster_cchit_runtime += last_autocluster_classad_cache_hit;
 
 	// Figure out if we should contine and put this job into the PrioRec array
-	// or not.
-	if ( ! Runnable(job, dummy) ||
-			scheduler.AlreadyMatched(job, job->Universe()))
-	{
+	// or not.  Jobs that are matched but not yet running go into the index of
+	// idle jobs, so they are there if the match falls through.
+	if ( ! Runnable(job, dummy)) {
 		return 0;
 	}
+	bool already_matched = scheduler.AlreadyMatched(job, job->Universe());
 
 	// --- Insert this job into the PrioRec array ---
 
@@ -8929,21 +9374,28 @@ int get_job_prio(JobQueueJob *job, const JOB_ID_KEY & jid, void *)
 		}
 	}
 
-    PrioRec[N_PrioRecs].id             = jid;
-    PrioRec[N_PrioRecs].job_prio       = job_prio;
-    PrioRec[N_PrioRecs].pre_job_prio1  = pre_job_prio1;
-    PrioRec[N_PrioRecs].pre_job_prio2  = pre_job_prio2;
-    PrioRec[N_PrioRecs].post_job_prio1 = post_job_prio1;
-    PrioRec[N_PrioRecs].post_job_prio2 = post_job_prio2;
-    PrioRec[N_PrioRecs].not_runnable   = false;
-    PrioRec[N_PrioRecs].matched        = false;
+	prio_rec & rec = PrioRec[N_PrioRecs];
+    rec.id             = jid;
+    rec.job_prio       = job_prio;
+    rec.pre_job_prio1  = pre_job_prio1;
+    rec.pre_job_prio2  = pre_job_prio2;
+    rec.post_job_prio1 = post_job_prio1;
+    rec.post_job_prio2 = post_job_prio2;
+    rec.not_runnable   = false;
+    rec.matched        = false;
 	if ( auto_id == -1 ) {
-		PrioRec[N_PrioRecs].auto_cluster_id = jid.cluster;
+		rec.auto_cluster_id = jid.cluster;
 	} else {
-		PrioRec[N_PrioRecs].auto_cluster_id = auto_id;
+		rec.auto_cluster_id = auto_id;
 	}
 
-	PrioRec[N_PrioRecs].submitter = powner;
+	rec.submitter = powner;
+
+	IdleJobs.Insert(rec);
+	if (already_matched) {
+		// leave the record to be overwritten by the next job
+		return 0;
+	}
 
     N_PrioRecs += 1;
 	if ( N_PrioRecs == MAX_PRIO_REC ) {
@@ -9350,13 +9802,55 @@ schedd_runtime_probe BuildPrioRec_walk_runtime;
 schedd_runtime_probe BuildPrioRec_sort_runtime;
 schedd_runtime_probe BuildPrioRec_sweep_runtime;
 
+// when at least this many jobs need an autocluster id, they get it from
+// AutoCluster::getAutoClusterids() before the walk that builds the PrioRec array
+static const size_t MIN_JOBS_FOR_PARALLEL_AUTOCLUSTER = 1024;
+
+// true when the autocluster ids of all jobs have been cleared since the last rebuild,
+// which happens when the job queue is loaded and when the significant attributes change
+static bool AllAutoClusterIdsCleared = true;
+
+void AutoClusterIdsCleared() {
+	AllAutoClusterIdsCleared = true;
+}
+
+// callback for WalkJobQueue that collects the jobs that don't have an autocluster id
+static int collect_unclustered_jobs(JobQueueJob *job, const JOB_ID_KEY & /*jid*/, void * pv)
+{
+	int auto_id = -1;
+	job->LookupInteger(ATTR_AUTO_CLUSTER_ID, auto_id);
+	if (auto_id == -1) {
+		((std::vector<JobQueueJob*>*)pv)->push_back(job);
+	}
+	return 0;
+}
+
 static void DoBuildPrioRecArray() {
 	condor_auto_runtime rt(BuildPrioRec_runtime);
 	double now = rt.begin;
 	scheduler.autocluster.mark();
 	BuildPrioRec_mark_runtime += rt.tick(now);
 
+		// after the significant attributes change, every job needs a new autocluster id.
+		// making the signatures for them one at a time is slow on a big queue, so
+		// do them all at once with several threads before the walk. otherwise only
+		// a few jobs need one, and the walk below can make them.
+	std::vector<JobQueueJob*> unclustered;
+	if (AllAutoClusterIdsCleared) {
+		AllAutoClusterIdsCleared = false;
+		WalkJobQueue2(collect_unclustered_jobs, &unclustered);
+	}
+	if (unclustered.size() >= MIN_JOBS_FOR_PARALLEL_AUTOCLUSTER) {
+		double begin = _condor_debug_get_time_double();
+		scheduler.autocluster.getAutoClusterids(unclustered, autocluster_threads);
+		double elapsed = _condor_debug_get_time_double() - begin;
+		GetAutoCluster_signature_runtime += elapsed;
+		dprintf(D_ALWAYS, "Computed autocluster ids for %d jobs in %.3f sec, %d autoclusters in use\n",
+			(int)unclustered.size(), elapsed, scheduler.autocluster.getNumAutoclusters());
+	}
+
 	N_PrioRecs = 0;
+	IdleJobs.Clear();
 	WalkJobQueue(get_job_prio);
 	BuildPrioRec_walk_runtime += rt.tick(now);
 
@@ -9520,28 +10014,19 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 	bool rebuilt_prio_rec_array = BuildPrioRecArray();
 
 
-		// Iterate through the most recently constructed list of
-		// jobs, nicely pre-sorted first by submitter, then by job priority
+		// Iterate through the idle jobs of the user in the same order as the
+		// most recently constructed list of jobs, sorted by job priority.
+		// The index drops jobs as soon as they stop being idle, so we
+		// don't look at the jobs that started running or were held
+		// since the list was built.
 
 	// Stringify the user to make comparison faster
 	std::string user_str = user ? user : "";
 
 	do {
-		prio_rec *first = &PrioRec[0];
-		prio_rec *end = &PrioRec[N_PrioRecs];
-
-		if (!match_any_user) {
-			first = std::lower_bound(first, end, user_str, prio_rec_submitter_lb{});
-			end = std::upper_bound(first, end, user_str, prio_rec_submitter_ub{});
-		}
-
-		for (prio_rec *p = first; p != end; p++) {
-			if ( p->not_runnable || p->matched ) {
-					// This record has been disabled, because it is no longer
-					// runnable or already matched.
-				continue;
-			}
+		IdleJobIndex::Walker idle_jobs(IdleJobs, match_any_user ? nullptr : &user_str);
 
+		for (const prio_rec *p = idle_jobs.Next(); p; p = idle_jobs.Next()) {
 			ad = GetJobAd( p->id.cluster, p->id.proc );
 			if (!ad) {
 					// This ad must have been deleted since we last built
@@ -9552,26 +10037,20 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 			if (PrioRecAutoClusterRejected.contains(p->auto_cluster_id)) {
 					// We have already failed to match a job from this same
 					// autocluster with this machine.  Skip it.
+				idle_jobs.SkipAutoCluster();
 				continue;
 			}
 
-			if (scheduler.AlreadyMatched(&p->id)) {
-				p->matched = true;
-			}
-			if (!Runnable(&p->id)) {
-				p->not_runnable = true;
-			}
-			if (p->matched || p->not_runnable) {
-					// This job's status must have changed since the
-					// time it was added to the runnable job list.
-					// The not_runnable and matched flags will prevent
-					// this job from being considered in any
-					// future iterations through the list.
+			PROC_ID id = p->id;
+			bool matched = scheduler.AlreadyMatched(&id);
+			if (matched || !Runnable(&id)) {
+					// This job is matched but not yet running, or is in
+					// cool-down, or its universe is not being serviced.
 				dprintf(D_FULLDEBUG,
-						"record for job %d.%d skipped until PrioRec rebuild (%s)\n",
-						p->id.cluster, p->id.proc, p->matched ? "already matched" : "no longer runnable");
+						"record for job %d.%d skipped (%s)\n",
+						p->id.cluster, p->id.proc, matched ? "already matched" : "no longer runnable");
 
-					// Move along to the next job in the prio rec array
+					// Move along to the next idle job
 				continue;
 			}
 
@@ -9595,7 +10074,8 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 					// part of this autocluster?  TODO perhaps we should verify this
 					// job is still part of this autocluster here.
 				PrioRecAutoClusterRejected.emplace(p->auto_cluster_id,1);
-					// Move along to the next job in the prio rec array
+				idle_jobs.SkipAutoCluster();
+					// Move along to the next idle job
 				continue;
 			}
 
@@ -9609,7 +10089,7 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 
 				if ( ! runnable) {
 					dprintf(D_FULLDEBUG | D_MATCH, "job %d.%d Matches, but START_VANILLA_UNIVERSE is false\n", ad->jid.cluster, ad->jid.proc);
-						// Move along to the next job in the prio rec array
+						// Move along to the next idle job
 					continue;
 				}
 			}
@@ -9663,6 +10143,7 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 							"ConcurrencyLimits do not match, cannot "
 							"reuse claim\n");
 					PrioRecAutoClusterRejected.emplace(p->auto_cluster_id,1);
+					idle_jobs.SkipAutoCluster();
 					continue;
 				}
 			}
@@ -9670,7 +10151,7 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 			jobid = p->id; // success!
 			return;
 
-		}	// end of for loop through PrioRec array
+		}	// end of for loop through the idle jobs
 
 		if(rebuilt_prio_rec_array) {
 				// We found nothing, and we had a freshly built job list.
@@ -9686,6 +10167,33 @@ void FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad,
 	// no more jobs to run anywhere.  nothing more to do.  failure.
 }
 
+// Count the runnable jobs of the given user in the same autocluster as jobid, not counting
+// jobid itself and stopping at max_jobs.  The schedd uses this to decide how many dynamic
+// slots to ask for when claiming a partitionable slot, so that the jobs that are likely to
+// match can be started on the extra slots without waiting for another negotiation cycle.
+int CountRunnableJobsLike(PROC_ID jobid, char const * user, int max_jobs)
+{
+	JobQueueJob *job = GetJobAd(jobid);
+	if ( ! job || job->autocluster_id < 0 || max_jobs <= 0 || ! user || ! *user) {
+		return 0;
+	}
+
+	const IdleJobIndex::JobSet * jobs = IdleJobs.Jobs(user, job->autocluster_id);
+	if ( ! jobs) {
+		return 0;
+	}
+
+	int count = 0;
+	for (auto it = jobs->begin(); it != jobs->end() && count < max_jobs; ++it) {
+		PROC_ID id = it->id;
+		if (id == jobid || scheduler.AlreadyMatched(&id) || ! Runnable(&id)) {
+			continue;
+		}
+		++count;
+	}
+	return count;
+}
+
 bool Runnable(JobQueueJob *job, const char *& reason)
 {
 	int cur = 0, max = 1;
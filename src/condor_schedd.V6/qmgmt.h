@@ -24,9 +24,11 @@
 #include "condor_io.h"
 #include "log_transaction.h" // for Transaction
 #include "prio_rec.h"
+#include "idle_job_index.h"
 #include "condor_sockaddr.h"
 #include "classad_log.h"
 #include "live_job_counters.h"
+#include <memory>
 
 // the pedantic idiots at gcc generate this warning whenever you use offsetof on a struct or class that has a constructor....
 GCC_DIAG_OFF(invalid-offsetof)
@@ -299,6 +301,8 @@ protected:
 public:
 	CountJobsCounters num; // job counts by OWNER rather than by submitter
 	LiveJobCounters live; // job counts that are always up-to-date with the committed job state
+	CountJobsCounters counted; // num and live as of the last walk of the job queue by count_jobs
+	LiveJobCounters live_counted;
 	time_t LastHitTime=0; // records the last time we incremented num.Hit, use to expire OwnerInfo
 
 	JobQueueUserRec(int userrec_id, const char* _name=nullptr, const char * _domain=nullptr, unsigned char is_super=0)
@@ -596,6 +600,18 @@ int QmgmtHandleSendJobsetAd(int cluster_id, ClassAd & ad, int flags, int & terrn
 void SetMaxHistoricalLogs(int max_historical_logs);
 time_t GetOriginalJobQueueBirthdate();
 void DestroyJobQueue( void );
+// when SCHEDD_JOB_QUEUE_GROUP_COMMIT is enabled, fsync the durable commits that are
+// waiting for it. call this before telling a client that its change was committed.
+// returns the number of commits that were synced.
+int SyncJobQueueLog();
+// true when the last durable commit is written but waits for SyncJobQueueLog()
+bool JobQueueCommitAwaitsSync();
+// do_Q_request() returns this when the reply to a durable CommitTransaction
+// was queued by DeferCommitTransactionReply(), handle_q() then sets the
+// connection aside and the reply is sent after the next SyncJobQueueLog().
+const int Q_REPLY_DEFERRED = 1;
+void DeferCommitTransactionReply(QmgmtPeer & peer, int rval, int terrno, std::unique_ptr<CondorError> errstack);
+int SendCommitTransactionReply(QmgmtPeer & peer, int rval, int terrno, CondorError * errstack);
 int handle_q(int, Stream *sock);
 void dirtyJobQueue( void );
 bool SendDirtyJobAdNotification(const PROC_ID& job_id);
@@ -633,6 +649,8 @@ bool UserCheck2( const ClassAd *ad, const char *test_owner, char const *job_owne
 
 bool BuildPrioRecArray(bool no_match_found=false);
 void DirtyPrioRecArray();
+// the autocluster ids of all jobs were cleared, the next rebuild of the PrioRec array computes them all at once
+void AutoClusterIdsCleared();
 extern ClassAd *dollarDollarExpand(int cid, int pid, ClassAd *job, ClassAd *res, bool persist_expansions);
 bool rewriteSpooledJobAd(ClassAd *job_ad, int cluster, int proc, bool modify_ad);
 
@@ -894,9 +912,11 @@ void UserRecFixupDefaultsAd(ClassAd & defaultsAd);
 // priority records
 extern prio_rec *PrioRec;
 extern int N_PrioRecs;
+extern IdleJobIndex IdleJobs;  // runnable idle jobs by submitter and autocluster
 extern int grow_prio_recs(int);
 
 extern void	FindRunnableJob(PROC_ID & jobid, ClassAd* my_match_ad, char const * user);
+extern int CountRunnableJobsLike(PROC_ID jobid, char const * user, int max_jobs);
 extern bool Runnable(PROC_ID*);
 extern bool Runnable(JobQueueJob *job, const char *& reason);
 
@@ -49,6 +49,50 @@ static bool QmgmtMayAccessAttribute( char const *attr_name ) {
 	// the client at attempted commit.
 static std::unique_ptr<CondorError> g_transaction_error;
 
+// send the reply to a CommitTransaction request, called by do_Q_request
+// or, when the reply was deferred, after the commit is synced to disk.
+int
+SendCommitTransactionReply(QmgmtPeer &Q_PEER, int rval, int terrno, CondorError * errstack)
+{
+	ReliSock *syscall_sock = Q_PEER.getReliSock();
+
+	syscall_sock->encode();
+	neg_on_error( syscall_sock->code(rval) );
+	const CondorVersionInfo *vers = syscall_sock->get_peer_version();
+	bool send_classad = vers && vers->built_since_version(8, 3, 4);
+	bool always_send_classad = vers && vers->built_since_version(8, 7, 4);
+	if( rval < 0 ) {
+		neg_on_error( syscall_sock->code(terrno) );
+	}
+	if( rval < 0 && send_classad ) {
+		// Send a classad, for less backwards-incompatibility.
+		int code = 1;
+		const char * reason = "QMGMT rejected job submission.";
+		if(! errstack->empty()) {
+			code = 2;
+			reason = errstack->message();
+		}
+
+		ClassAd reply;
+		reply.Assign( "ErrorCode", code );
+		reply.Assign( "ErrorReason", reason );
+		neg_on_error( putClassAd( syscall_sock, reply ) );
+	} else if( always_send_classad ) {
+		ClassAd reply;
+
+		std::string reason;
+		if(! errstack->empty()) {
+			reason = errstack->getFullText();
+			reply.Assign( "WarningReason", reason );
+		}
+
+		neg_on_error( putClassAd( syscall_sock, reply ) );
+	}
+
+	neg_on_error( syscall_sock->end_of_message() );
+	return 0;
+}
+
 int
 do_Q_request(QmgmtPeer &Q_PEER)
 {
@@ -658,44 +702,17 @@ do_Q_request(QmgmtPeer &Q_PEER)
 			errno = 0;
 			rval = CommitTransactionAndLive( flags, errstack.get() );
 			terrno = errno;
-		}
-		dprintf( D_SYSCALLS, "\tflags = %d, rval = %d, errno = %d\n", flags, rval, terrno );
-
-		syscall_sock->encode();
-		neg_on_error( syscall_sock->code(rval) );
-		const CondorVersionInfo *vers = syscall_sock->get_peer_version();
-		bool send_classad = vers && vers->built_since_version(8, 3, 4);
-		bool always_send_classad = vers && vers->built_since_version(8, 7, 4);
-		if( rval < 0 ) {
-			neg_on_error( syscall_sock->code(terrno) );
-		}
-		if( rval < 0 && send_classad ) {
-			// Send a classad, for less backwards-incompatibility.
-			int code = 1;
-			const char * reason = "QMGMT rejected job submission.";
-			if(! errstack->empty()) {
-				code = 2;
-				reason = errstack->message();
+				// don't acknowledge the commit until it is on disk.  if the fsync
+				// was deferred, reply after the next group commit sync.
+			if (rval >= 0 && !(flags & NONDURABLE) && JobQueueCommitAwaitsSync()) {
+				dprintf( D_SYSCALLS, "\tflags = %d, rval = %d, reply deferred\n", flags, rval );
+				DeferCommitTransactionReply( Q_PEER, rval, terrno, std::move(errstack) );
+				return Q_REPLY_DEFERRED;
 			}
-
-			ClassAd reply;
-			reply.Assign( "ErrorCode", code );
-			reply.Assign( "ErrorReason", reason );
-			neg_on_error( putClassAd( syscall_sock, reply ) );
-		} else if( always_send_classad ) {
-			ClassAd reply;
-
-			std::string reason;
-			if(! errstack->empty()) {
-				reason = errstack->getFullText();
-				reply.Assign( "WarningReason", reason );
-			}
-
-			neg_on_error( putClassAd( syscall_sock, reply ) );
 		}
+		dprintf( D_SYSCALLS, "\tflags = %d, rval = %d, errno = %d\n", flags, rval, terrno );
 
-		neg_on_error( syscall_sock->end_of_message() );;
-		return 0;
+		return SendCommitTransactionReply( Q_PEER, rval, terrno, errstack.get() );
 	}
 
 	case CONDOR_GetAttributeFloat:
@@ -86,6 +86,8 @@
 #include "ClassAdLogPlugin.h"
 #endif
 #include <algorithm>
+#include <deque>
+#include <memory>
 #include "pccc.h"
 #include "shared_port_endpoint.h"
 #include "condor_auth_passwd.h"
@@ -279,6 +281,7 @@ schedd_runtime_probe WalkJobQ_clear_autocluster_id_runtime;
 schedd_runtime_probe WalkJobQ_add_runnable_local_jobs_runtime;
 schedd_runtime_probe WalkJobQ_fixAttrUser_runtime;
 schedd_runtime_probe WalkJobQ_updateSchedDInterval_runtime;
+schedd_runtime_probe WalkJobQ_query_cursor_runtime;
 
 int	WallClockCkptInterval = 0;
 int STARTD_CONTACT_TIMEOUT = 45;  // how long to potentially block
@@ -575,6 +578,10 @@ match_rec::match_rec( char const* the_claim_id, char const* p, PROC_ID* job_id,
 
 	keep_while_idle = 0;
 	idle_timer_deadline = 0;
+
+	match_time = _condor_debug_get_time_double();
+	claim_sent_time = 0;
+	claimed_time = 0;
 }
 
 void
@@ -776,6 +783,8 @@ Scheduler::Scheduler() :
 	checkReconnectQueue_tid = -1;
 	num_pending_startd_contacts = 0;
 	max_pending_startd_contacts = 0;
+	startd_contact_batch_size = 0;
+	claim_dslots_per_request = 1;
 
 	act_on_job_myself_queue.
 		registerHandlercpp( (ServiceDataHandlercpp)
@@ -1460,6 +1469,218 @@ Scheduler::updateSubmitterAd(SubmitterData &SubDat, ClassAd &pAd, DCCollector *c
 }
 
 
+// the jobs that count_jobs() found when it walked the job queue, counted the way
+// that the live counters count them, so that we can check the live counters.
+struct JobCountAudit {
+	int jobs {0};
+	LiveJobCounters schedd;
+	std::map<const OwnerInfo*, LiveJobCounters> owners;
+	std::map<const SubmitterData*, LiveJobCounters> submitters;
+};
+
+static int
+count_and_audit_a_job(JobQueueBase* ad, const JOB_ID_KEY& jid, void* pv)
+{
+	int rval = count_a_job(ad, jid, pv);
+
+	// count_a_job may have changed the status of the job, so we audit it afterwards
+	if (ad && ad->IsJob()) {
+		JobQueueJob * job = static_cast<JobQueueJob*>(ad);
+		JobCountAudit * audit = (JobCountAudit*)pv;
+		int universe = job->Universe();
+		int status = job->Status();
+		audit->jobs += 1;
+		IncrementLiveJobCounter(audit->schedd, universe, status, 1);
+		if (job->ownerinfo) {
+			IncrementLiveJobCounter(audit->owners[job->ownerinfo], universe, status, 1);
+		}
+		if (job->submitterdata) {
+			IncrementLiveJobCounter(audit->submitters[job->submitterdata], universe, status, 1);
+		}
+	}
+	return rval;
+}
+
+// check one set of live counters against what the walk of the job queue found, and fix it.
+// returns true if it was correct.
+static bool
+audit_live_counters(LiveJobCounters & live, const LiveJobCounters & counted, const char * what, const char * name)
+{
+	if (live == counted) {
+		return true;
+	}
+	dprintf(D_ALWAYS, "Live job counts for %s%s were wrong, correcting them: "
+		"Idle=%d (should be %d) Running=%d (%d) Held=%d (%d) Total=%d (%d)\n",
+		what, name ? name : "",
+		live.JobsIdle + live.SchedulerJobsIdle, counted.JobsIdle + counted.SchedulerJobsIdle,
+		live.JobsRunning + live.SchedulerJobsRunning, counted.JobsRunning + counted.SchedulerJobsRunning,
+		live.JobsHeld + live.SchedulerJobsHeld, counted.JobsHeld + counted.SchedulerJobsHeld,
+		live.total(), counted.total());
+	live = counted;
+	return false;
+}
+
+void
+Scheduler::audit_live_job_counters(JobCountAudit & audit)
+{
+	const LiveJobCounters none;
+	int wrong = 0;
+
+	if ( ! audit_live_counters(liveJobCounts, audit.schedd, "the schedd", nullptr)) { ++wrong; }
+
+	auto audit_owner = [&](OwnerInfo & owner) {
+		auto found = audit.owners.find(&owner);
+		const LiveJobCounters & counted = (found != audit.owners.end()) ? found->second : none;
+		if ( ! audit_live_counters(owner.live, counted, "owner ", owner.Name())) { ++wrong; }
+	};
+	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+	#ifdef USE_JOB_QUEUE_USERREC
+		audit_owner(*(it->second));
+	#else
+		audit_owner(it->second);
+	#endif
+	}
+	for (OwnerInfo * owni : zombieOwners) {
+		audit_owner(*owni);
+	}
+
+	for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
+		SubmitterData & SubDat = it->second;
+		auto found = audit.submitters.find(&SubDat);
+		const LiveJobCounters & counted = (found != audit.submitters.end()) ? found->second : none;
+		if ( ! audit_live_counters(SubDat.live, counted, "submitter ", SubDat.Name())) { ++wrong; }
+	}
+
+	dprintf(wrong ? D_ALWAYS : D_FULLDEBUG, "Audited the live job counters against %d jobs, %d of them were wrong\n",
+		audit.jobs, wrong);
+}
+
+// remember the job counts from a walk of the job queue, and the live counters at the time
+// so that count_jobs_from_live_counters() can add the changes since then.
+// This must be called before the match records are counted.
+void
+Scheduler::save_counted_jobs()
+{
+	m_counted.JobsIdle = JobsIdle;
+	m_counted.JobsRunning = JobsRunning;
+	m_counted.JobsHeld = JobsHeld;
+	m_counted.JobsTotalAds = JobsTotalAds;
+	m_counted.JobsRemoved = JobsRemoved;
+	m_counted.SchedUniverseJobsIdle = SchedUniverseJobsIdle;
+	m_counted.SchedUniverseJobsRunning = SchedUniverseJobsRunning;
+	m_counted.LocalUniverseJobsIdle = LocalUniverseJobsIdle;
+	m_counted.LocalUniverseJobsRunning = LocalUniverseJobsRunning;
+	m_live_counted = liveJobCounts;
+
+	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+	#ifdef USE_JOB_QUEUE_USERREC
+		OwnerInfo & Owner = *(it->second);
+	#else
+		OwnerInfo & Owner = it->second;
+	#endif
+		Owner.counted = Owner.num;
+		Owner.live_counted = Owner.live;
+	}
+	for (OwnerInfo * owni : zombieOwners) {
+		owni->counted = owni->num;
+		owni->live_counted = owni->live;
+	}
+	for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
+		SubmitterData & SubDat = it->second;
+		SubDat.counted = SubDat.num;
+		SubDat.flock_counted = SubDat.flock;
+		SubDat.live_counted = SubDat.live;
+	}
+}
+
+// add the change in the live counters since the last walk of the job queue to the
+// owner or submitter counters that the walk counted.  Idle and Held jobs of the local
+// universe are counted separately by the walk, but as Jobs by the live counters
+template <class Counters>
+static void
+add_live_job_changes(Counters & num, const LiveJobCounters & live, const LiveJobCounters & then)
+{
+	num.JobsIdle = MAX(0, num.JobsIdle + (live.JobsIdle - live.LocalJobsIdle) - (then.JobsIdle - then.LocalJobsIdle));
+	num.JobsHeld = MAX(0, num.JobsHeld + (live.JobsHeld - live.LocalJobsHeld) - (then.JobsHeld - then.LocalJobsHeld));
+	num.LocalJobsIdle = MAX(0, num.LocalJobsIdle + live.LocalJobsIdle - then.LocalJobsIdle);
+	num.LocalJobsRunning = MAX(0, num.LocalJobsRunning + live.LocalJobsRunning - then.LocalJobsRunning);
+	num.SchedulerJobsIdle = MAX(0, num.SchedulerJobsIdle + live.SchedulerJobsIdle - then.SchedulerJobsIdle);
+	num.SchedulerJobsRunning = MAX(0, num.SchedulerJobsRunning + live.SchedulerJobsRunning - then.SchedulerJobsRunning);
+	int added = live.total() - then.total();
+	num.JobsCounted = MAX(0, num.JobsCounted + added);
+	num.Hits = MAX(0, num.Hits + added);
+	// a record that has jobs in the queue must not look unused
+	if (live.total() > 0 && num.Hits < 1) {
+		num.Hits = 1;
+	}
+}
+
+// set the job counts without walking the job queue: start from the counts of the last walk
+// and add the changes in the live counters since then.  The counts that the live counters
+// don't track (multi-host and grid jobs, flocked idle jobs) stay as they were at the last walk.
+void
+Scheduler::count_jobs_from_live_counters(time_t now)
+{
+	const LiveJobCounters & live = liveJobCounts;
+	const LiveJobCounters & then = m_live_counted;
+
+	JobsIdle = MAX(0, m_counted.JobsIdle + (live.JobsIdle + live.SchedulerJobsIdle) - (then.JobsIdle + then.SchedulerJobsIdle));
+	JobsRunning = MAX(0, m_counted.JobsRunning + (live.JobsRunning + live.SchedulerJobsRunning) - (then.JobsRunning + then.SchedulerJobsRunning));
+	JobsHeld = MAX(0, m_counted.JobsHeld + (live.JobsHeld + live.SchedulerJobsHeld) - (then.JobsHeld + then.SchedulerJobsHeld));
+	JobsRemoved = MAX(0, m_counted.JobsRemoved + (live.JobsRemoved + live.SchedulerJobsRemoved) - (then.JobsRemoved + then.SchedulerJobsRemoved));
+	JobsTotalAds = MAX(0, m_counted.JobsTotalAds + live.total() - then.total());
+	SchedUniverseJobsIdle = MAX(0, m_counted.SchedUniverseJobsIdle + live.SchedulerJobsIdle - then.SchedulerJobsIdle);
+	SchedUniverseJobsRunning = MAX(0, m_counted.SchedUniverseJobsRunning + live.SchedulerJobsRunning - then.SchedulerJobsRunning);
+	LocalUniverseJobsIdle = MAX(0, m_counted.LocalUniverseJobsIdle + live.LocalJobsIdle - then.LocalJobsIdle);
+	LocalUniverseJobsRunning = MAX(0, m_counted.LocalUniverseJobsRunning + live.LocalJobsRunning - then.LocalJobsRunning);
+
+	auto count_owner = [&](OwnerInfo & Owner) {
+		Owner.num = Owner.counted;
+		add_live_job_changes(Owner.num, Owner.live, Owner.live_counted);
+		if (Owner.live.total() > 0) { Owner.LastHitTime = now; }
+	};
+	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+	#ifdef USE_JOB_QUEUE_USERREC
+		count_owner(*(it->second));
+	#else
+		count_owner(it->second);
+	#endif
+	}
+	for (OwnerInfo * owni : zombieOwners) {
+		count_owner(*owni);
+	}
+
+	for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
+		SubmitterData & SubDat = it->second;
+		SubDat.num = SubDat.counted;
+		add_live_job_changes(SubDat.num, SubDat.live, SubDat.live_counted);
+		// newly idle jobs are assumed to weigh what the idle jobs did at the last walk
+		double idle_weight = 1.0;
+		if (SubDat.counted.JobsIdle > 0) {
+			idle_weight = SubDat.counted.WeightedJobsIdle / SubDat.counted.JobsIdle;
+		}
+		SubDat.num.WeightedJobsIdle = MAX(0.0, SubDat.counted.WeightedJobsIdle +
+			idle_weight * (SubDat.num.JobsIdle - SubDat.counted.JobsIdle));
+		if (SubDat.live.total() > 0) { SubDat.LastHitTime = now; }
+
+		SubDat.flock = SubDat.flock_counted;
+		for (const auto &entry : FlockPools) {
+			SubDat.flock.insert({entry, SubmitterFlockCounters()});
+		}
+	}
+}
+
+void
+Scheduler::updateSubmitterLiveJobCounts(JobQueueJob * job, int old_status, int new_status)
+{
+	SubmitterData * SubDat = nullptr;
+	get_submitter_and_owner(job, SubDat);
+	if (SubDat) {
+		IncrementLiveJobCounter(SubDat->live, job->Universe(), old_status, -1);
+		IncrementLiveJobCounter(SubDat->live, job->Universe(), new_status, 1);
+	}
+}
+
 /*
 ** Examine the job queue to determine how many CONDOR jobs we currently have
 ** running, and how many individual users own them.
@@ -1476,34 +1697,42 @@ Scheduler::count_jobs()
 	time_t AbsentSubmitterUpdateRate = param_integer("ABSENT_SUBMITTER_UPDATE_RATE", 60*5); // 5 min
 	time_t AbsentOwnerLifetime = param_integer("ABSENT_OWNER_LIFETIME", 60*5);
 
-	JobsRunning = 0;
-	JobsIdle = 0;
-	JobsHeld = 0;
-	JobsTotalAds = 0;
-	JobsFlocked = 0;
-	JobsRemoved = 0;
-	SchedUniverseJobsIdle = 0;
-	SchedUniverseJobsRunning = 0;
-	LocalUniverseJobsIdle = 0;
-	LocalUniverseJobsRunning = 0;
-	stats.JobsRunning = 0;
-	stats.JobsRunningRuntimes = 0;
-	stats.JobsRunningSizes = 0;
-	stats.JobsUnmaterialized = 0;
-	scheduler.OtherPoolStats.ResetJobsRunning();
-
 	time_t current_time = time(0);
 
-	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
-	#ifdef USE_JOB_QUEUE_USERREC
-		OwnerInfo & Owner = *(it->second);
-	#else
-		OwnerInfo & Owner = it->second;
-	#endif
-		Owner.num.clear_counters();	// clear the jobs counters 
-	}
-	for (OwnerInfo * owni : zombieOwners) {
-		owni->num.clear_counters(); // clear refcounts for zombies also
+	// walk the job queue when asked to, or when it is time to audit the live job counters,
+	// otherwise the job counts are the counts from the last walk plus the changes in the
+	// live counters since then.
+	bool walk_job_queue = m_job_count_audit_needed || m_job_count_audit_interval <= 0 ||
+		(current_time - m_last_job_count_audit >= m_job_count_audit_interval);
+
+	JobsFlocked = 0;
+	if (walk_job_queue) {
+		JobsRunning = 0;
+		JobsIdle = 0;
+		JobsHeld = 0;
+		JobsTotalAds = 0;
+		JobsRemoved = 0;
+		SchedUniverseJobsIdle = 0;
+		SchedUniverseJobsRunning = 0;
+		LocalUniverseJobsIdle = 0;
+		LocalUniverseJobsRunning = 0;
+		stats.JobsRunning = 0;
+		stats.JobsRunningRuntimes = 0;
+		stats.JobsRunningSizes = 0;
+		stats.JobsUnmaterialized = 0;
+		scheduler.OtherPoolStats.ResetJobsRunning();
+
+		for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+		#ifdef USE_JOB_QUEUE_USERREC
+			OwnerInfo & Owner = *(it->second);
+		#else
+			OwnerInfo & Owner = it->second;
+		#endif
+			Owner.num.clear_counters();	// clear the jobs counters 
+		}
+		for (OwnerInfo * owni : zombieOwners) {
+			owni->num.clear_counters(); // clear refcounts for zombies also
+		}
 	}
 
 	FlockPools.clear();
@@ -1524,31 +1753,48 @@ Scheduler::count_jobs()
 		} else { cad->Delete(ATTR_EFFECTIVE_FLOCK_LIST); }
 	}
 
-	for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
-		SubmitterData & SubDat = it->second;
-		SubDat.num.clear_job_counters();	// clear the jobs counters 
-		SubDat.PrioSet.clear();
-		SubDat.flock.clear();
-		for (const auto &entry : FlockPools) {
-			SubDat.flock[entry] = SubmitterFlockCounters();
+	if (walk_job_queue) {
+		for (SubmitterDataMap::iterator it = Submitters.begin(); it != Submitters.end(); ++it) {
+			SubmitterData & SubDat = it->second;
+			SubDat.num.clear_job_counters();	// clear the jobs counters 
+			SubDat.PrioSet.clear();
+			SubDat.flock.clear();
+			for (const auto &entry : FlockPools) {
+				SubDat.flock[entry] = SubmitterFlockCounters();
+			}
 		}
 	}
 	SubmitterMap.Cleanup(time(NULL));
 
-	GridJobOwners.clear();
-
-		// Clear out the DedicatedScheduler's list of idle dedicated
-		// job cluster ids, since we're about to re-create it.
-	dedicated_scheduler.clearDedicatedClusters();
-
-		// inserts/finds an entry in Owners for each job
-		// updates SubmitterCounters: Hits, JobsIdle, WeightedJobsIdle & JobsHeld
-		// 10/8/2021 TJ - count_a_job now also sees cluster and jobset ads so it will update Owner records.
-		//    For job factories that have no materialized jobs it will potentially trigger new materialization
-	WalkJobQueueWith(WJQ_WITH_CLUSTERS | WJQ_WITH_JOBSETS, count_a_job, nullptr);
-
-	if (JobsSeenOnQueueWalk >= 0) {
-		TotalJobsCount = JobsSeenOnQueueWalk;
+	if (walk_job_queue) {
+		GridJobOwners.clear();
+
+			// Clear out the DedicatedScheduler's list of idle dedicated
+			// job cluster ids, since we're about to re-create it.
+		dedicated_scheduler.clearDedicatedClusters();
+
+			// inserts/finds an entry in Owners for each job
+			// updates SubmitterCounters: Hits, JobsIdle, WeightedJobsIdle & JobsHeld
+			// 10/8/2021 TJ - count_a_job now also sees cluster and jobset ads so it will update Owner records.
+			//    For job factories that have no materialized jobs it will potentially trigger new materialization
+			// count_and_audit_a_job also counts each job the way the live counters do so we can check them.
+			// the runtime is still published as that of count_a_job
+		JobCountAudit audit;
+		double audit_start = _condor_debug_get_time_double();
+		WalkJobQueueEntries(WJQ_WITH_CLUSTERS | WJQ_WITH_JOBSETS, count_and_audit_a_job, &audit, WalkJobQ_count_a_job_runtime);
+
+		if (JobsSeenOnQueueWalk >= 0) {
+			TotalJobsCount = JobsSeenOnQueueWalk;
+		}
+
+		audit_live_job_counters(audit);
+		save_counted_jobs();
+		m_last_job_count_audit = current_time;
+		m_job_count_audit_needed = false;
+		dprintf(D_FULLDEBUG, "count_jobs: walked %d jobs in the job queue in %.3f seconds\n",
+			audit.jobs, _condor_debug_get_time_double() - audit_start);
+	} else {
+		count_jobs_from_live_counters(current_time);
 	}
 
 	if( dedicated_scheduler.hasDedicatedClusters() ) {
@@ -1617,8 +1863,9 @@ Scheduler::count_jobs()
 	auto_free_ptr cred_dir_krb(param("SEC_CREDENTIAL_DIRECTORY_KRB"));
 	auto_free_ptr cred_dir_oauth(param("SEC_CREDENTIAL_DIRECTORY_OAUTH"));
 
-	// Look for owners with zero jobs and purge them
-	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); it != OwnersInfo.end(); ++it) {
+	// Look for owners with zero jobs and purge them.
+	// the Hits of owners are only counted for clusters and jobsets when we walk the job queue
+	for (OwnerInfoMap::iterator it = OwnersInfo.begin(); walk_job_queue && it != OwnersInfo.end(); ++it) {
 	#ifdef USE_JOB_QUEUE_USERREC
 		OwnerInfo & owner_info = *(it->second);
 	#else
@@ -1660,7 +1907,9 @@ Scheduler::count_jobs()
 		#endif
 		}
 	}
-	purgeZombieOwners();
+	if (walk_job_queue) {
+		purgeZombieOwners();
+	}
 
 	// set FlockLevel for owners
 	if (MaxFlockLevel) {
@@ -1758,6 +2007,7 @@ Scheduler::count_jobs()
 	time_t now = stats.Tick();
 	stats.JobsSubmitted = GetJobQueuedCount();
 	stats.Autoclusters = autocluster.getNumAutoclusters();
+	stats.UpdateHistoryWriterStats();
 
 	OtherPoolStats.Tick(now);
 	// because cad is really m_adSchedd which is persistent, we have to 
@@ -2032,9 +2282,12 @@ Scheduler::count_jobs()
 			// this is unxpected, we really should never get here with LastHitTime of 0, but in case
 			// we do. start the decay timer now.
 			SubDat.LastHitTime = current_time;
-		} else if (AbsentSubmitterLifetime && (current_time - SubDat.LastHitTime > AbsentSubmitterLifetime)) {
+		} else if (AbsentSubmitterLifetime && (current_time - SubDat.LastHitTime > AbsentSubmitterLifetime)
+			&& (m_job_count_audit_interval <= 0 || SubDat.live.total() == 0)) {
 			// Now that we've finished using Owner.Name, we can
 			// free it.  this marks the entry as unused
+			// (when the job queue is not walked every time, jobs that are still counted in the
+			// live counters point to this entry, so it must stay)
 			SubDat.name.clear();
 		}
 
@@ -2131,6 +2384,7 @@ int Scheduler::make_ad_list(
    stats.JobsSubmitted = GetJobQueuedCount();
    stats.ShadowsRunning = numShadows;
    stats.Autoclusters = autocluster.getNumAutoclusters();
+   stats.UpdateHistoryWriterStats();
 
    OtherPoolStats.Tick(now);
    // because cad is a copy of m_adSchedd which is persistent, we have to 
@@ -2630,12 +2884,13 @@ void LiveJobCounters::publish(ClassAd & ad, const char * prefix) const
 }
 
 static bool
-sendDone(Stream *stream, bool send_job_counts, LiveJobCounters* query_counts, const char * myname, LiveJobCounters* my_counts)
+sendDone(Stream *stream, bool send_job_counts, LiveJobCounters* query_counts, const char * myname, LiveJobCounters* my_counts, const ClassAd * extra_attrs=nullptr)
 {
 	ClassAd ad;
 	ad.Assign(ATTR_OWNER, 0);
 	ad.Assign(ATTR_ERROR_CODE, 0);
 	ad.Assign(ATTR_SERVER_TIME, time(nullptr));
+	if (extra_attrs) { ad.Update(*extra_attrs); }
 
 	if (send_job_counts) {
 		ad.Assign(ATTR_MY_TYPE, "Summary");
@@ -2664,13 +2919,12 @@ void IncrementLiveJobCounter(LiveJobCounters & num, int universe, int status, in
 			(&num.SchedulerJobsIdle)[status-1] += increment;
 		}
 		break;
-	/*
 	case CONDOR_UNIVERSE_LOCAL:
 		if (status > 0 && status <= HELD) {
 			(&num.LocalJobsIdle)[status-1] += increment;
 		}
-		break;
-	*/
+		// Local universe jobs are also counted as Jobs
+		[[fallthrough]];
 	default:
 		//dprintf(D_ALWAYS | D_BACKTRACE, "IncrementLiveJobCounter(%p, %d, %d, %d) for %d.%d (%p)\n", &num.JobsIdle, universe, status, increment, job->jid.cluster, job->jid.proc, job);
 		if (status > 0 && status <= HELD) {
@@ -2682,6 +2936,184 @@ void IncrementLiveJobCounter(LiveJobCounters & num, int universe, int status, in
 	}
 }
 
+// Server side state of a paged job query.  The first page takes a snapshot of the ids of
+// the job queue in (cluster,proc) order, and each page resumes where the page before it
+// stopped, so that paging through the whole queue walks it only once.  Between pages the
+// cursor matches ahead the ads of the next page while the client reads the current one.
+// A page that names a cursor that is gone (because it expired, or was made by a forked
+// query) starts a new snapshot from the watermark of the page before.
+struct JobQueryCursor {
+	int id {0};
+	time_t expires {0};
+	int iter_options {0};
+	std::string constraint;             // the requirements that the cursor matches
+	classad_shared_ptr<classad::ExprTree> requirements;
+	std::vector<JOB_ID_KEY> ids;        // snapshot of the ids in the queue, sorted
+	size_t pos {0};                     // ids before this have been matched
+	std::deque<JOB_ID_KEY> ready;       // matched ahead and not yet sent, matched again when sent
+
+	JobQueryCursor(classad_shared_ptr<classad::ExprTree> req, const std::string & constr, int opts)
+		: iter_options(opts), constraint(constr), requirements(req) {}
+
+	void Snapshot(const JOB_ID_KEY & after);
+	bool Exhausted() const { return ready.empty() && pos >= ids.size(); }
+	bool Matches(JobQueuePayload ad) const;
+	// return the next matching ad, or NULL when exhausted or timed_out
+	JobQueuePayload Next(int timeslice_ms, bool & timed_out);
+	// match ahead up to count ads for the next page
+	void MatchAhead(int count, int timeslice_ms);
+
+	static std::map<int, std::shared_ptr<JobQueryCursor>> cursors;
+	static int next_id;
+	static std::shared_ptr<JobQueryCursor> Find(int id, const std::string & constraint, int opts);
+	static void Save(std::shared_ptr<JobQueryCursor> & cursor);
+	static void Expire(time_t now);
+};
+
+std::map<int, std::shared_ptr<JobQueryCursor>> JobQueryCursor::cursors;
+int JobQueryCursor::next_id = 0;
+
+static JobQueuePayload
+LookupJobQueueAd(const JOB_ID_KEY & key)
+{
+	if (key.proc >= 0) return GetJobAd(key);
+	if (key.proc == CLUSTERID_qkey2) return GetClusterAd(key.cluster);
+	if (key.proc == JOBSETID_qkey2) return GetJobSetAd(key.cluster);
+	return nullptr;
+}
+
+static int
+AddJobQueryCursorId(JobQueueBase * /*ad*/, const JOB_ID_KEY & key, void * pv)
+{
+	auto * cursor = (JobQueryCursor*)pv;
+	// the snapshot is taken after the watermark, so only ids past it are kept
+	if (cursor->ids.empty() || cursor->ids.front() < key) {
+		cursor->ids.push_back(key);
+	}
+	return 0;
+}
+
+void
+JobQueryCursor::Snapshot(const JOB_ID_KEY & after)
+{
+	int with = 0;
+	if (iter_options & JOB_QUEUE_ITERATOR_OPT_INCLUDE_CLUSTERS) with |= WJQ_WITH_CLUSTERS;
+	if (iter_options & JOB_QUEUE_ITERATOR_OPT_INCLUDE_JOBSETS) with |= WJQ_WITH_JOBSETS;
+	if (iter_options & JOB_QUEUE_ITERATOR_OPT_NO_PROC_ADS) with |= WJQ_WITH_NO_JOBS;
+
+	// the first element is the watermark, to filter the walk against. it is removed below.
+	ids.clear();
+	ids.push_back(after);
+	WalkJobQueueEntries(with, AddJobQueryCursorId, this, WalkJobQ_query_cursor_runtime);
+	std::sort(ids.begin()+1, ids.end());
+	pos = 1;
+	ready.clear();
+}
+
+bool
+JobQueryCursor::Matches(JobQueuePayload ad) const
+{
+	classad::Value result;
+	bool matched = false;
+	return classad::ClassAd::EvaluateExpr(ad, requirements.get(), result, classad::Value::ValueType::NUMBER_VALUES) &&
+		result.IsBooleanValueEquiv(matched) && matched;
+}
+
+JobQueuePayload
+JobQueryCursor::Next(int timeslice_ms, bool & timed_out)
+{
+	timed_out = false;
+	while ( ! ready.empty()) {
+		JobQueuePayload ad = LookupJobQueueAd(ready.front());
+		ready.pop_front();
+		// skip ads that left the queue or stopped matching since they were matched ahead
+		if (ad && Matches(ad)) return ad;
+	}
+
+	Stopwatch sw;
+	int miss_count = 0;
+	while (pos < ids.size()) {
+		JobQueuePayload ad = LookupJobQueueAd(ids[pos++]);
+		if (ad && Matches(ad)) {
+			return ad;
+		}
+		// check the time only now and then, like the job queue filter_iterator does
+		if ( ! miss_count) { sw.start(); }
+		++miss_count;
+		if ((miss_count & 0x1FF) == 0 && (sw.get_ms() > timeslice_ms)) {
+			timed_out = true;
+			break;
+		}
+	}
+	return nullptr;
+}
+
+void
+JobQueryCursor::MatchAhead(int count, int timeslice_ms)
+{
+	double begin = _condor_debug_get_time_double();
+	while ((int)ready.size() < count && pos < ids.size()) {
+		const JOB_ID_KEY & key = ids[pos];
+		JobQueuePayload ad = LookupJobQueueAd(key);
+		if (ad && Matches(ad)) {
+			ready.push_back(key);
+		}
+		++pos;
+		if ((pos & 0x1FF) == 0 && (_condor_debug_get_time_double() - begin)*1000 > timeslice_ms) {
+			break;
+		}
+	}
+}
+
+void
+JobQueryCursor::Expire(time_t now)
+{
+	for (auto it = cursors.begin(); it != cursors.end(); ) {
+		if (it->second->expires <= now) {
+			it = cursors.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+std::shared_ptr<JobQueryCursor>
+JobQueryCursor::Find(int id, const std::string & constr, int opts)
+{
+	Expire(time(nullptr));
+	auto it = cursors.find(id);
+	if (it == cursors.end()) {
+		return nullptr;
+	}
+	// a cursor can only be continued by the same query
+	std::shared_ptr<JobQueryCursor> cursor = it->second;
+	if (cursor->constraint != constr || cursor->iter_options != opts) {
+		return nullptr;
+	}
+	return cursor;
+}
+
+void
+JobQueryCursor::Save(std::shared_ptr<JobQueryCursor> & cursor)
+{
+	time_t now = time(nullptr);
+	Expire(now);
+	if (cursor->id) { cursors.erase(cursor->id); }
+	size_t max_cursors = param_integer("SCHEDD_MAX_QUERY_CURSORS", 20, 0);
+	while ( ! cursors.empty() && cursors.size() >= max_cursors) {
+		cursors.erase(cursors.begin()); // forget the oldest cursor
+	}
+	if ( ! max_cursors) {
+		return;
+	}
+	if ( ! cursor->id) {
+		if (++next_id <= 0) next_id = 1;
+		cursor->id = next_id;
+	}
+	cursor->expires = now + param_integer("SCHEDD_QUERY_CURSOR_LIFETIME", 300, 1);
+	cursors[cursor->id] = cursor;
+}
+
 struct QueryJobAdsContinuation : Service {
 
 	classad_shared_ptr<classad::ExprTree> requirements;
@@ -2696,6 +3128,8 @@ struct QueryJobAdsContinuation : Service {
 	bool unfinished_eom;
 	bool registered_socket;
 	bool send_server_time;
+	std::shared_ptr<JobQueryCursor> cursor; // set for a paged query
+	JOB_ID_KEY last_sent {0,0};
 
 	QueryJobAdsContinuation(classad_shared_ptr<classad::ExprTree> requirements_, int limit, int timeslice_ms=0, int iter_opts=0, bool server_time=true);
 	int finish(Stream *);
@@ -2739,13 +3173,23 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 			return sendJobErrorAd(sock, 5, "Failed to write EOM to wire");
 		}
 	}
-	while ((it != end) && !has_backlog) {
-		JobQueuePayload ad = *it++;
+	while ((cursor ? (match_count < match_limit && ! cursor->Exhausted()) : (it != end)) && !has_backlog) {
+		JobQueuePayload ad = nullptr;
+		if (cursor) {
+			bool timed_out = false;
+			ad = cursor->Next(1000, timed_out);
+			if ( ! ad && ! timed_out) {
+				break; // no more matches
+			}
+		} else {
+			ad = *it++;
+		}
 		if (!ad) {
 			// Return to DC in case if our time ran out.
 			has_backlog = true;
 			break;
 		}
+		if (cursor) { last_sent = ad->jid; }
 		if (ad->IsJob()) {
 			JobQueueJob * job = dynamic_cast<JobQueueJob*>(ad);
 			IncrementLiveJobCounter(query_job_counts, job->Universe(), job->Status(), 1);
@@ -2795,6 +3239,10 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 			it = end;
 		}
 	}
+	if (has_backlog && cursor && ! unfinished_eom) {
+		// while we wait for the client to drain the socket, match ahead for the next page
+		cursor->MatchAhead(match_limit, 10);
+	}
 	if (has_backlog && !registered_socket) {
 		int retval = daemonCore->Register_Socket(stream, "Client Response",
 			(SocketHandlercpp)&QueryJobAdsContinuation::finish,
@@ -2809,7 +3257,24 @@ QueryJobAdsContinuation::finish(Stream *stream) {
 		const char * me = NULL;
 		LiveJobCounters * mine = NULL;
 		if ( ! my_name.empty()) { me = my_name.c_str(); mine = &my_job_counts; }
-		int rval = sendDone(sock, true, &query_job_counts, me, mine);
+		ClassAd page_ad;
+		if (cursor) {
+			// tell the client that it got a page, a schedd that can't page ignores the cursor
+			page_ad.Assign(ATTR_QUERY_Q_PAGED, true);
+		}
+		bool more_pages = cursor && ! cursor->Exhausted();
+		if (more_pages) {
+			// tell the client where the next page starts
+			page_ad.Assign(ATTR_QUERY_Q_CURSOR, cursor->id);
+			page_ad.Assign(ATTR_QUERY_Q_AFTER_JOB_ID, JOB_ID_KEY_BUF(last_sent).c_str());
+		} else if (cursor) {
+			JobQueryCursor::cursors.erase(cursor->id);
+		}
+		int rval = sendDone(sock, true, &query_job_counts, me, mine, cursor ? &page_ad : nullptr);
+		if (more_pages) {
+			// match the next page now, so that it is ready when the client asks for it
+			cursor->MatchAhead(match_limit, 100);
+		}
 		delete this;
 		return rval;
 	}
@@ -2967,7 +3432,36 @@ int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 		dprintf(dpf_level, "QUERY_JOB_ADS limit=%d, iter_options=0x%x\n", resultLimit, iter_options);
 	}
 
+	// a paged query names the cursor that the page before it returned, and the id of
+	// the last ad of that page.  paged queries need a limit to make pages.
+	std::shared_ptr<JobQueryCursor> cursor;
+	int cursor_id = 0;
+	std::string after_id;
+	bool paged = queryAd.LookupInteger(ATTR_QUERY_Q_CURSOR, cursor_id);
+	paged = queryAd.LookupString(ATTR_QUERY_Q_AFTER_JOB_ID, after_id) || paged;
+	if (paged && resultLimit > 0) {
+		std::string constraint;
+		ExprTreeToString(requirements, constraint);
+		if (cursor_id > 0) {
+			cursor = JobQueryCursor::Find(cursor_id, constraint, iter_options);
+		}
+		if ( ! cursor) {
+			JOB_ID_KEY after(0, 0); // ads with cluster 0 are not jobs
+			if ( ! after_id.empty() && ! after.set(after_id.c_str())) {
+				return sendJobErrorAd(stream, 6, "Invalid " ATTR_QUERY_Q_AFTER_JOB_ID);
+			}
+			cursor = std::make_shared<JobQueryCursor>(requirements_ptr, constraint, iter_options);
+			cursor->Snapshot(after);
+		}
+		JobQueryCursor::Save(cursor);
+		if (IsDebugCatAndVerbosity(dpf_level)) {
+			dprintf(dpf_level, "QUERY_JOB_ADS page of cursor %d after %s, %zu ids left\n",
+				cursor->id, after_id.c_str(), cursor->ids.size() - cursor->pos + cursor->ready.size());
+		}
+	}
+
 	QueryJobAdsContinuation *continuation = new QueryJobAdsContinuation(requirements_ptr, resultLimit, 1000, iter_options, send_server_time);
+	continuation->cursor = cursor;
 	int proj_err = mergeProjectionFromQueryAd(queryAd, ATTR_PROJECTION, continuation->projection, true);
 	if (proj_err < 0) {
 		delete continuation;
@@ -2988,7 +3482,9 @@ int Scheduler::command_query_job_ads(int cmd, Stream* stream)
 		continuation->summary_only = true;
 	}
 
-	ForkStatus fork_status = schedd_forker.NewJob();
+	// a page is a bounded amount of work, and the cursor must stay in this process
+	// for the next page, so paged queries are not forked
+	ForkStatus fork_status = cursor ? FORK_BUSY : schedd_forker.NewJob();
 	if (fork_status == FORK_PARENT)
 	{ // Successfully forked a child - as far as the schedd cares, this worked.
 	  // Throw away the socket and move on.
@@ -4148,7 +4644,13 @@ Scheduler::get_submitter_and_owner(JobQueueJob * job, SubmitterData * & submitte
 	}
 
 	// lookup/insert a submitterdata record for this submitter name and cache the resulting pointer in the job object.
+	// the live counts of the job move with it to the new submitter record
+	SubmitterData * old_submitterdata = job->submitterdata;
 	job->submitterdata = scheduler.insert_submitter(submitter);
+	if (job->submitterdata != old_submitterdata && job->IsJob()) {
+		if (old_submitterdata) { IncrementLiveJobCounter(old_submitterdata->live, job->Universe(), job->Status(), -1); }
+		if (job->submitterdata) { IncrementLiveJobCounter(job->submitterdata->live, job->Universe(), job->Status(), 1); }
+	}
 	if (job->submitterdata) {
 		job->dirty_flags &= ~JQJ_CACHE_DIRTY_SUBMITTERDATA;
 		job->submitterdata->isOwnerName = (owner == submitter);
@@ -4643,28 +5145,136 @@ PeriodicExprEval(JobQueueJob *jobad, const JOB_ID_KEY & /*jid*/, void * pvUser)
 	return 1;
 }
 
+/*
+Evaluate the periodic expressions of a job, then tell the periodic
+policy tracker when the job needs to be evaluated again.
+*/
+
+static int
+PeriodicExprEvalAndSchedule(JobQueueJob *jobad, const JOB_ID_KEY & jid, void * pvUser)
+{
+	PeriodicExprEval(jobad, jid, pvUser);
+
+	// the policy may have removed the job from the queue
+	JobQueueJob * job = GetJobAd(jid);
+	if (job && jid.proc >= 0) {
+		int status = -1;
+		bool responsible = ResponsibleForPeriodicExprs(job, status);
+		scheduler.periodicPolicy.JobEvaluated(*job, time(nullptr), responsible);
+	}
+	return 1;
+}
+
 /*
 For all of the jobs in the queue, evaluate the 
 periodic user policy expressions.
+When PERIODIC_EXPR_ON_CHANGE is true, all of the jobs are evaluated
+only every MAX_PERIODIC_EXPR_INTERVAL seconds, in between only the jobs
+that changed or whose time has come are evaluated.
 */
 
 void
 Scheduler::PeriodicExprHandler( int /* timerID */ )
 {
+	time_t now = time(nullptr);
+	if (periodicPolicy.Enabled() && now < m_next_full_periodic_expr_pass) {
+		PeriodicExprsForChangedJobs(now);
+		return;
+	}
+
 	PeriodicExprInterval.setStartTimeNow();
 
-	UserPolicy policy;
-	policy.Init();
-	WalkJobQueue2(PeriodicExprEval, &policy);
+	if (periodicPolicy.Enabled()) {
+		periodicPolicy.Clear();
+		WalkJobQueue3(PeriodicExprEvalAndSchedule, &periodicPolicy.Policy(), WalkJobQ_PeriodicExprEval_runtime);
+	} else {
+		UserPolicy policy;
+		policy.Init();
+		WalkJobQueue2(PeriodicExprEval, &policy);
+	}
 
 	PeriodicExprInterval.setFinishTimeNow();
 
 	unsigned int time_to_next_run = PeriodicExprInterval.getTimeToNextRun();
+	if (periodicPolicy.Enabled()) {
+		now = time(nullptr);
+		m_next_full_periodic_expr_pass = now + PeriodicExprInterval.getMaxInterval();
+		time_to_next_run = PeriodicExprDelay(now);
+	}
 	dprintf(D_FULLDEBUG,"Evaluated periodic expressions in %.3fs, "
 			"scheduling next run in %us\n",
 			PeriodicExprInterval.getLastDuration(),
 			time_to_next_run);
 	daemonCore->Reset_Timer( periodicid, time_to_next_run );
+	m_next_periodic_expr_run = now + time_to_next_run;
+}
+
+// seconds until the periodic expr timer should fire again when PERIODIC_EXPR_ON_CHANGE is true.
+int
+Scheduler::PeriodicExprDelay(time_t now)
+{
+	int delay = (int)MAX(0, m_next_full_periodic_expr_pass - now);
+	int due = periodicPolicy.SecondsToNextDue(now);
+	if (due >= 0 && due < delay) {
+		delay = due;
+	}
+	return MAX(1, delay);
+}
+
+/*
+Evaluate the periodic expressions of the jobs that changed since the last
+pass and of the jobs whose time has come.
+*/
+
+void
+Scheduler::PeriodicExprsForChangedJobs(time_t now)
+{
+	double begin = _condor_debug_get_time_double();
+	// don't block the schedd for longer than this, leave the rest for the next pass
+	const double max_time = 0.5;
+
+	std::vector<JOB_ID_KEY> jobs;
+	periodicPolicy.TakeDueJobs(now, jobs);
+
+	size_t num_evaluated = 0;
+	for (auto it = jobs.begin(); it != jobs.end(); ++it) {
+		if (num_evaluated && (_condor_debug_get_time_double() - begin) > max_time) {
+			for ( ; it != jobs.end(); ++it) {
+				periodicPolicy.JobChanged(*it);
+			}
+			break;
+		}
+		JobQueueJob * job = GetJobAd(*it);
+		if ( ! job) {
+			continue;
+		}
+		PeriodicExprEvalAndSchedule(job, *it, &periodicPolicy.Policy());
+		++num_evaluated;
+	}
+	double elapsed = _condor_debug_get_time_double() - begin;
+	WalkJobQ_PeriodicExprEval_runtime.Add(elapsed);
+
+	now = time(nullptr);
+	int delay = PeriodicExprDelay(now);
+	dprintf(D_FULLDEBUG, "Evaluated periodic expressions of %zu of %zu changed or due jobs in %.3fs, "
+			"%zu jobs waiting for a time, scheduling next run in %ds\n",
+			num_evaluated, jobs.size(), elapsed, periodicPolicy.NumScheduled(), delay);
+	daemonCore->Reset_Timer( periodicid, delay );
+	m_next_periodic_expr_run = now + delay;
+}
+
+void
+Scheduler::PeriodicExprsChanged(const JOB_ID_KEY & jid)
+{
+	if ( ! periodicPolicy.JobChanged(jid) || periodicid < 0) {
+		return;
+	}
+	// this is the first changed job since the last pass, so make sure that the timer fires soon
+	time_t now = time(nullptr);
+	if (m_next_periodic_expr_run > now + 1) {
+		daemonCore->Reset_Timer( periodicid, 1 );
+		m_next_periodic_expr_run = now + 1;
+	}
 }
 
 
@@ -7127,6 +7737,7 @@ Scheduler::actOnJobs(int, Stream* s)
 	time_t before = time(NULL);
 	if( needs_transaction ) {
 		CommitTransactionOrDieTrying();
+		SyncJobQueueLog();
 	}
 	time_t after = time(NULL);
 	if ( (after - before) > 5 ) {
@@ -7952,7 +8563,6 @@ Scheduler::negotiationFinished( char const *owner, char const *remote_pool, bool
 int
 Scheduler::negotiate(int /*command*/, Stream* s)
 {
-	int		job_index;
 	int		which_negotiator = 0; 		// >0 implies flocking
 	std::string remote_pool_buf;
 	char const *remote_pool = NULL;
@@ -8142,6 +8752,7 @@ Scheduler::negotiate(int /*command*/, Stream* s)
 		if ( autocluster.config(MinimalSigAttrs, sig_attrs_from_cm.c_str()) ) {
 			// clear out auto cluster id attributes
 			WalkJobQueue(clear_autocluster_id);
+			AutoClusterIdsCleared();
 			DirtyPrioRecArray(); // should rebuild PrioRecArray
 		}
 	}
@@ -8175,18 +8786,16 @@ Scheduler::negotiate(int /*command*/, Stream* s)
 	// std::string'ify owner to speed up comparisons in the loop
 	std::string owner_str(owner);
 
-	for(job_index = 0; job_index < N_PrioRecs && !skip_negotiation; job_index++) {
-		prio_rec *prec = &PrioRec[job_index];
-
-		// make sure job isn't flagged as not needing matching
-		if (prec->not_runnable || prec->matched)
-		{
-			continue;
-		}
+	// walk the idle jobs of this submitter (or of all submitters) in priority order.
+	// the index only has jobs that are idle right now, so we don't have to step over
+	// the jobs that started running or were held since the PrioRec array was built.
+	IdleJobIndex::Walker idle_jobs(IdleJobs, scheddsAreSubmitters ? nullptr : &owner_str);
 
-		// make sure owner matches what negotiator wants
+	for (const prio_rec *prec = idle_jobs.Next(); prec && !skip_negotiation; prec = idle_jobs.Next()) {
 
-		if (!scheddsAreSubmitters && owner_str != prec->submitter)
+		// make sure job isn't already matched
+		PROC_ID prec_id = prec->id;
+		if (AlreadyMatched(&prec_id))
 		{
 			continue;
 		}
@@ -8426,6 +9035,10 @@ Scheduler::contactStartd( ContactStartdArgs* args )
 		// past we did this fixup during the negotiation cycle, but now that
 		// we can get matches directly back from the startd, we need to do it
 		// here as well.
+	bool is_pslot = false;
+	if ( mrec->my_match_ad ) {
+		mrec->my_match_ad->LookupBool(ATTR_SLOT_PARTITIONABLE, is_pslot);
+	}
 	if ( jobAd && mrec && mrec->my_match_ad )
 	{
 		if ( !ScheddNegotiate::fixupPartitionableSlot(jobAd,mrec->my_match_ad) ) {
@@ -8476,6 +9089,27 @@ Scheduler::contactStartd( ContactStartdArgs* args )
 
 	this->num_pending_startd_contacts++;
 
+		// When claiming a dynamic slot from a partitionable slot, ask for
+		// more slots in the same request if there are idle jobs like this
+		// one that could use them.  Don't ask for more than we have room
+		// to start shadows for.  Jobs with concurrency limits are left to
+		// the negotiator, which accounts for the limits of each match.
+	int num_dslots = 1;
+	if ( is_pslot && claim_dslots_per_request > 1 && !mrec->is_dedicated && !mrec->m_claim_pslot &&
+		 !jobAd->Lookup(ATTR_CONCURRENCY_LIMITS) )
+	{
+		int shadows = numShadows + RunnableJobQueue.size() + num_pending_startd_contacts + startdContactQueue.size();
+		int max_extra = std::min(claim_dslots_per_request - 1, MaxJobsRunning - shadows);
+		num_dslots += CountRunnableJobsLike(PROC_ID(cluster, proc), mrec->user, max_extra);
+		if ( num_dslots > 1 ) {
+			dprintf( D_FULLDEBUG, "Requesting %d dynamic slots for %s\n", num_dslots, description.c_str() );
+		}
+	}
+
+	mrec->claim_sent_time = _condor_debug_get_time_double();
+	stats.ClaimQueueTime += (int64_t)((mrec->claim_sent_time - mrec->match_time) * 1000);
+	stats.ClaimRequestsSent += 1;
+
 	int deadline_timeout = -1;
 	if( RequestClaimTimeout > 0 ) {
 			// Add in a little slop time so that schedd has a chance
@@ -8491,7 +9125,8 @@ Scheduler::contactStartd( ContactStartdArgs* args )
 		scheduler.aliveInterval(), mrec->m_claim_pslot,
 		STARTD_CONTACT_TIMEOUT, // timeout on individual network ops
 		deadline_timeout,       // overall timeout on completing claim request
-		cb );
+		cb,
+		num_dslots );
 
 	delete jobAd;
 
@@ -8544,8 +9179,19 @@ Scheduler::claimedStartd( DCMsgCallback *cb ) {
 	// and copy over all of the job-related data.
 	// For now, delete the old match_rec. Eventually, we may want to keep
 	// it around (it should be for the claimed pslot).
+	// If we asked for more than one dynamic slot, the slots after the
+	// first one get match records of their own below.
+	double match_time = match->match_time;
+	double claim_sent_time = match->claim_sent_time;
+	std::vector<const ClaimStartdMsg::_slotClaimInfo*> extra_slots;
 	if (msg->have_claimed_slot_info()) {
+		bool first_slot = true;
 		for (auto & slotInfo : msg->claimed_slots()) {
+			if ( ! first_slot) {
+				extra_slots.push_back(&slotInfo);
+				continue;
+			}
+			first_slot = false;
 			if (slotInfo.claim_id != match->claim_id.claimId()) {
 				PROC_ID job_id(match->cluster, match->proc);
 				SetMrecJobID(match, -1, -1);
@@ -8561,37 +9207,78 @@ Scheduler::claimedStartd( DCMsgCallback *cb ) {
 				match->my_match_ad->CopyFrom(slotInfo.slot_ad);
 				match->my_match_ad->Update(match->m_added_attrs);
 			}
-
-			break; // TODO: remove this to handle more than a single slot in the claim reply
 		}
 	}
 
 	match->setStatus( M_CLAIMED );
+	match->match_time = match_time;
+	match->claim_sent_time = claim_sent_time;
+	match->claimed_time = _condor_debug_get_time_double();
+	if ( claim_sent_time > 0 ) {
+		stats.ClaimRequestTime += (int64_t)((match->claimed_time - claim_sent_time) * 1000);
+	}
+
+	// Each extra dynamic slot gets the best idle job of the same user that
+	// fits in it.  If there is none anymore, give the slot back to the startd.
+	std::vector<match_rec*> batched_matches;
+	for (auto * slotInfo : extra_slots) {
+		ClassAd slotAd(slotInfo->slot_ad);
+		slotAd.Update(match->m_added_attrs);
+
+		PROC_ID job_id(-1, -1);
+		if ( ! ExitWhenDone && ! match->is_dedicated ) {
+			FindRunnableJob(job_id, &slotAd, match->user);
+		}
+		match_rec *pre_existing = nullptr;
+		match_rec *extra = nullptr;
+		if (job_id.proc != -1) {
+			extra = AddMrec(slotInfo->claim_id.c_str(), match->peer, &job_id, &slotAd, match->user, match->m_pool.c_str(), &pre_existing);
+		}
+		if ( ! extra) {
+			if ( ! pre_existing) {
+				PROC_ID no_job(-1, -1);
+				match_rec unused(slotInfo->claim_id.c_str(), match->peer, &no_job, &slotAd, match->user, match->m_pool.c_str(), false);
+				dprintf(D_ALWAYS, "No job to run on extra claimed slot %s; relinquishing\n", unused.description());
+				send_vacate(&unused, RELEASE_CLAIM);
+			}
+			continue;
+		}
+		extra->setStatus( M_CLAIMED );
+		extra->match_time = match->match_time;
+		extra->claim_sent_time = match->claim_sent_time;
+		extra->claimed_time = match->claimed_time;
+		batched_matches.push_back(extra);
+		stats.ClaimsBatched += 1;
+	}
 
 	// now that we've completed authentication (if enabled),
 	// authorize this startd for READ operations
 	//
-	if ( match->auth_hole_id == NULL ) {
-		match->auth_hole_id = new std::string;
-		ASSERT(match->auth_hole_id != NULL);
+	batched_matches.insert(batched_matches.begin(), match);
+	for (match_rec *claimed : batched_matches) {
+		if ( claimed->auth_hole_id != NULL ) {
+			continue;
+		}
+		claimed->auth_hole_id = new std::string;
+		ASSERT(claimed->auth_hole_id != NULL);
 		if (msg->startd_fqu() && *msg->startd_fqu()) {
-			formatstr(*match->auth_hole_id, "%s/%s",
+			formatstr(*claimed->auth_hole_id, "%s/%s",
 			                            msg->startd_fqu(),
 			                            msg->startd_ip_addr());
 		}
 		else {
-			*match->auth_hole_id = msg->startd_ip_addr();
+			*claimed->auth_hole_id = msg->startd_ip_addr();
 		}
 		IpVerify* ipv = daemonCore->getSecMan()->getIpVerify();
-		if (!ipv->PunchHole(READ, *match->auth_hole_id)) {
+		if (!ipv->PunchHole(READ, *claimed->auth_hole_id)) {
 			dprintf(D_ALWAYS,
 			        "WARNING: IpVerify::PunchHole error for %s: "
 			            "job %d.%d may fail to execute\n",
-			        match->auth_hole_id->c_str(),
-			        match->cluster,
-			        match->proc);
-			delete match->auth_hole_id;
-			match->auth_hole_id = NULL;
+			        claimed->auth_hole_id->c_str(),
+			        claimed->cluster,
+			        claimed->proc);
+			delete claimed->auth_hole_id;
+			claimed->auth_hole_id = NULL;
 		}
 	}
 
@@ -8664,7 +9351,9 @@ Scheduler::claimedStartd( DCMsgCallback *cb ) {
 		dedicated_scheduler.handleDedicatedJobTimer( 0 );
 	}
 	else {
-		scheduler.StartJob( match );
+		for (match_rec *claimed : batched_matches) {
+			scheduler.StartJob( claimed );
+		}
 	}
 }
 
@@ -8716,11 +9405,22 @@ Scheduler::checkContactQueue( int /* timerID */ )
 		// Contact startds as long as (a) there are still entries in our
 		// queue, (b) there are not too many registered sockets in
 		// daemonCore, which ensures we do not run ourselves out
-		// of socket descriptors.
+		// of socket descriptors, (c) we have fewer than
+		// MAX_PENDING_STARTD_CONTACTS claim requests in flight.
+		// The requests are nonblocking, so we can keep many of them in flight,
+		// but we only send STARTD_CONTACT_BATCH_SIZE of them each time
+		// through here so that claim replies and shadows are serviced
+		// while a long queue of new matches is being worked through.
+	int contacted = 0;
 	while( !daemonCore->TooManyRegisteredSockets() &&
 		   (num_pending_startd_contacts < max_pending_startd_contacts
             || max_pending_startd_contacts <= 0) &&
 		   (!startdContactQueue.empty()) ) {
+		if( startd_contact_batch_size > 0 && contacted >= startd_contact_batch_size ) {
+				// come back for the rest after servicing other events
+			rescheduleContactQueue();
+			break;
+		}
 			// there's a pending registration in the queue:
 
 		args = startdContactQueue.front();
@@ -8729,6 +9429,7 @@ Scheduler::checkContactQueue( int /* timerID */ )
 				 "host=%s\n", args, args->sinful() ); 
 		contactStartd( args );
 		delete args;
+		++contacted;
 	}
 }
 
@@ -8996,6 +9697,7 @@ PostInitJobQueue()
 	if ( scheduler.autocluster.config(scheduler.MinimalSigAttrs) ) {
 		// clear out auto cluster id attributes
 		WalkJobQueue(clear_autocluster_id);
+		AutoClusterIdsCleared();
 	}
 
 		//
@@ -9172,6 +9874,14 @@ Scheduler::StartJob(match_rec *rec)
     }
     rec->idle_timer_deadline = 0;
 
+	if ( rec->claimed_time > 0 ) {
+			// first shadow for this match, record how long it took to get here
+		double now = _condor_debug_get_time_double();
+		stats.ClaimToShadowTime += (int64_t)((now - rec->claimed_time) * 1000);
+		stats.MatchToShadowTime += (int64_t)((now - rec->match_time) * 1000);
+		rec->claimed_time = 0;
+	}
+
 		// Now that the shadow has spawned, consider this match "ACTIVE"
 	rec->setStatus( M_ACTIVE );
 }
@@ -11584,6 +12294,8 @@ Scheduler::delete_shadow_rec( shadow_rec *rec )
 		shadowsByPid.erase(pid);
 	}
 	shadowsByProcID.erase(rec->job_id);
+		// with the shadow gone, the schedd may now be responsible for the job's policy
+	PeriodicExprsChanged(rec->job_id);
 	if ( rec->conn_fd != -1 ) {
 		close(rec->conn_fd);
 	}
@@ -13313,6 +14025,17 @@ Scheduler::Init()
 		// note: the special value 0 means 'unlimited'
 	max_pending_startd_contacts = param_integer( "MAX_PENDING_STARTD_CONTACTS", 0, 0 );
 
+		// Send at most this many claim requests each time the contact
+		// queue is serviced, then go back to daemonCore so that shadows,
+		// claim replies and queries are handled while a large batch of
+		// new matches is being claimed.  0 means no limit.
+	startd_contact_batch_size = param_integer( "STARTD_CONTACT_BATCH_SIZE", 100, 0 );
+
+		// When claiming a partitionable slot, ask the startd for up to
+		// this many dynamic slots if we have enough idle jobs that look
+		// like the matched job, so they can start without another match.
+	claim_dslots_per_request = param_integer( "SCHEDD_CLAIM_DSLOTS_PER_REQUEST", 1, 1 );
+
 
 #ifdef USE_VANILLA_START
 		// Start "vanilla" universe expression
@@ -13593,6 +14316,10 @@ Scheduler::Init()
 
 	PeriodicExprInterval.setTimeslice( param_double("PERIODIC_EXPR_TIMESLICE", 0.01,0,1) );
 
+	periodicPolicy.Config( param_boolean("PERIODIC_EXPR_ON_CHANGE", false),
+		param_integer("PERIODIC_EXPR_INTERVAL", 60) );
+	m_next_full_periodic_expr_pass = 0;
+
 	RequestClaimTimeout = param_integer("REQUEST_CLAIM_TIMEOUT",60*30);
 
 	int int_val = param_integer( "JOB_IS_FINISHED_INTERVAL", 0, 0 );
@@ -13805,6 +14532,8 @@ Scheduler::Init()
 	}
 	m_use_slot_weights = param_boolean("SCHEDD_USE_SLOT_WEIGHT", true);
 
+	m_job_count_audit_interval = param_integer("SCHEDD_JOB_COUNTS_AUDIT_INTERVAL", 0, 0);
+
 	char *sw = param("SCHEDD_SLOT_WEIGHT");
 	if (sw) {
 		ParseClassAdRvalExpr(sw, slotWeightOfJob);
@@ -14232,6 +14961,8 @@ void Scheduler::reconfig() {
 
 	RegisterTimers();			// reset timers
 
+		// a reconfig is how an admin asks for the live job counters to be audited now
+	needJobCountAudit();
 
 		// clear out auto cluster id attributes
 	if ( autocluster.config(MinimalSigAttrs) ) {
@@ -14372,6 +15103,9 @@ Scheduler::schedd_exit()
 		// we're leaking anything. 
 	DestroyJobQueue();
 
+		// write out the job ads that are still waiting for the history writer
+	StopJobHistoryWriter();
+
 		// Invalidate our classads at the collector, since we're now
 		// gone.  
 	invalidate_ads();
@@ -17911,6 +18645,7 @@ Scheduler::ExportJobs(ClassAd & result, std::set<int> & clusters, const char *ou
 	}
 
 	CommitTransactionOrDieTrying();
+	SyncJobQueueLog();
 
 	// flush changes, then close the log file
 	export_queue.FlushLog();
@@ -18145,6 +18880,7 @@ Scheduler::ImportExportedJobResults(ClassAd & result, const char * import_dir, c
 	}
 
 	CommitTransactionOrDieTrying();
+	SyncJobQueueLog();
 
 	result.Assign(ATTR_TOTAL_JOB_ADS, num_jobs);
 
@@ -18240,6 +18976,7 @@ Scheduler::UnexportJobs(ClassAd & result, std::set<int> & clusters, const OwnerI
 	}
 
 	CommitTransactionOrDieTrying();
+	SyncJobQueueLog();
 
 	result.Assign(ATTR_TOTAL_JOB_ADS, num_jobs);
 	result.Assign(ATTR_TOTAL_CLUSTER_ADS, (long)clusters.size());
@@ -24,6 +24,7 @@
 #include "condor_config.h"
 #include "classad_helpers.h"
 #include "qmgmt.h"
+#include "classadHistory.h"
 
 void ScheddStatistics::Reconfig()
 {
@@ -86,6 +87,23 @@ static const time_t default_job_hist_lifes[] = {
       (time_t) 8 * 24*60*60, (time_t)16 * 24*60*60,  //  8 Day  16 Day,
       };
 static const char default_lifes_set[] = "30Sec, 1Min, 3Min, 10Min, 30Min, 1Hr, 3Hr, 6Hr, 12Hr, 1Day, 2Day, 4Day, 8Day, 16Day";
+static const int64_t default_commit_hist_usecs[] = {
+      (int64_t)100,          (int64_t)300,           // 100us, 300us
+      (int64_t)1000,         (int64_t)3000,          //   1ms,   3ms
+      (int64_t)10000,        (int64_t)30000,         //  10ms,  30ms
+      (int64_t)100000,       (int64_t)300000,        // 100ms, 300ms
+      (int64_t)1000000,      (int64_t)3000000,       //    1s,    3s
+      (int64_t)10000000,                             //   10s
+      };
+static const char default_commit_set[] = "100us, 300us, 1ms, 3ms, 10ms, 30ms, 100ms, 300ms, 1s, 3s, 10s";
+static const int64_t default_claim_hist_msecs[] = {
+      (int64_t)10,           (int64_t)30,            //  10ms,  30ms
+      (int64_t)100,          (int64_t)300,           // 100ms, 300ms
+      (int64_t)1000,         (int64_t)3000,          //    1s,    3s
+      (int64_t)10000,        (int64_t)30000,         //   10s,   30s
+      (int64_t)100000,       (int64_t)300000,        //  100s,  300s
+      };
+static const char default_claim_set[] = "10ms, 30ms, 100ms, 300ms, 1s, 3s, 10s, 30s, 100s, 300s";
 
 void ScheddJobCounters::InitJobCounters(StatisticsPool &Pool, int base_verbosity)
 {
@@ -185,6 +203,12 @@ void ScheddStatistics::InitMain()
    InitJobCounters(Pool, IF_BASICPUB);
 
    JobsRestartReconnectsBadput.set_levels(default_job_hist_lifes, COUNTOF(default_job_hist_lifes));
+   JobQueueCommitLatency.set_levels(default_commit_hist_usecs, COUNTOF(default_commit_hist_usecs));
+   JobQueueSyncTime.set_levels(default_commit_hist_usecs, COUNTOF(default_commit_hist_usecs));
+   ClaimQueueTime.set_levels(default_claim_hist_msecs, COUNTOF(default_claim_hist_msecs));
+   ClaimRequestTime.set_levels(default_claim_hist_msecs, COUNTOF(default_claim_hist_msecs));
+   ClaimToShadowTime.set_levels(default_claim_hist_msecs, COUNTOF(default_claim_hist_msecs));
+   MatchToShadowTime.set_levels(default_claim_hist_msecs, COUNTOF(default_claim_hist_msecs));
 
    SCHEDD_STATS_ADD_RECENT(Pool, JobsSubmitted,        IF_BASICPUB);
    SCHEDD_STATS_ADD_RECENT(Pool, Autoclusters,         IF_BASICPUB);
@@ -204,6 +228,27 @@ void ScheddStatistics::InitMain()
    SCHEDD_STATS_ADD_VAL(Pool, JobsRestartReconnectsInterrupted, IF_BASICPUB);
    SCHEDD_STATS_ADD_VAL(Pool, JobsRestartReconnectsBadput, IF_BASICPUB);
 
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueCommitLatency,     IF_BASICPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueSyncTime,          IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueSyncs,             IF_VERBOSEPUB | IF_NONZERO);
+   SCHEDD_STATS_ADD_RECENT(Pool, JobQueueSyncedCommits,     IF_VERBOSEPUB | IF_NONZERO);
+
+   SCHEDD_STATS_ADD_RECENT(Pool, ClaimQueueTime,            IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, ClaimRequestTime,          IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, ClaimToShadowTime,         IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, MatchToShadowTime,         IF_BASICPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, ClaimRequestsSent,         IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, ClaimsBatched,             IF_VERBOSEPUB | IF_NONZERO);
+
+   SCHEDD_STATS_ADD_RECENT(Pool, HistoryAdsWritten,         IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, HistoryBytesWritten,       IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, HistoryWriteBatches,       IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_RECENT(Pool, HistoryWriteErrors,        IF_VERBOSEPUB | IF_NONZERO);
+   SCHEDD_STATS_ADD_RECENT(Pool, HistoryWriterStalls,       IF_BASICPUB | IF_NONZERO);
+   SCHEDD_STATS_ADD_RECENT(Pool, HistoryWriterStallTime,    IF_VERBOSEPUB | IF_NONZERO);
+   SCHEDD_STATS_ADD_VAL(Pool, HistoryWriterQueueDepth,      IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_VAL(Pool, HistoryWriterQueuePeak,       IF_VERBOSEPUB);
+
    // SCHEDD runtime stats for various expensive processes
    //
    SCHEDD_STATS_ADD_EXTERN_RUNTIME(Pool, BuildPrioRec,       IF_VERBOSEPUB);
@@ -222,6 +267,7 @@ void ScheddStatistics::InitMain()
    SCHEDD_STATS_ADD_EXTERN_RUNTIME(Pool, WalkJobQ_updateSchedDInterval,    IF_VERBOSEPUB);
    SCHEDD_STATS_ADD_EXTERN_RUNTIME(Pool, WalkJobQ_mark_idle,               IF_VERBOSEPUB);
    SCHEDD_STATS_ADD_EXTERN_RUNTIME(Pool, WalkJobQ_get_job_prio,            IF_VERBOSEPUB);
+   SCHEDD_STATS_ADD_EXTERN_RUNTIME(Pool, WalkJobQ_query_cursor,            IF_VERBOSEPUB);
 
    // timings for the autocluster code
    SCHEDD_STATS_ADD_EXTERN_RUNTIME(Pool, GetAutoCluster,           IF_VERBOSEPUB);
@@ -285,12 +331,30 @@ void ScheddStatistics::Publish(ClassAd & ad, const char * config) const
    this->Publish(ad, flags);
 }
 
+void ScheddStatistics::UpdateHistoryWriterStats()
+{
+   HistoryWriterStats hws;
+   GetJobHistoryWriterStats(hws);
+
+   // the writer counts from when the daemon started, assigning the totals adds what is new to the recent values
+   HistoryAdsWritten = hws.ads_written;
+   HistoryBytesWritten = hws.bytes_written;
+   HistoryWriteBatches = hws.batches;
+   HistoryWriteErrors = hws.write_errors;
+   HistoryWriterStalls = hws.stalls;
+   HistoryWriterStallTime = hws.stall_time;
+   HistoryWriterQueueDepth = hws.queue_depth;
+   HistoryWriterQueuePeak = hws.queue_peak;
+}
+
 void ScheddStatistics::Publish(ClassAd & ad, int flags) const
 {
    if ((flags & IF_PUBLEVEL) > 0) {
       ad.Assign("StatsLifetime", StatsLifetime);
       ad.Assign("JobsSizesHistogramBuckets", default_sizes_set);
       ad.Assign("JobsRuntimesHistogramBuckets", default_lifes_set);
+      ad.Assign("JobQueueCommitHistogramBuckets", default_commit_set);
+      ad.Assign("ClaimHistogramBuckets", default_claim_set);
       if (flags & IF_VERBOSEPUB)
          ad.Assign("StatsLastUpdateTime", StatsLastUpdateTime);
       if (flags & IF_RECENTPUB) {
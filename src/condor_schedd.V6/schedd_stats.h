@@ -133,6 +133,30 @@ typedef struct ScheddStatistics : public ScheddJobCounters {
    //stats_entry_recent<int> ShadowExceptions;     // number of times shadows have excepted
    stats_entry_recent<int> ShadowsReconnections; // number of times shadows have reconnected
 
+   // durable commits to the job queue log
+   stats_entry_recent_histogram<int64_t> JobQueueCommitLatency; // microseconds from the commit until it is on disk
+   stats_entry_recent_histogram<int64_t> JobQueueSyncTime;      // microseconds spent in each fsync
+   stats_entry_recent<int> JobQueueSyncs;          // fsyncs done for SCHEDD_JOB_QUEUE_GROUP_COMMIT
+   stats_entry_recent<int> JobQueueSyncedCommits;  // commits made durable by those fsyncs
+
+   // milliseconds spent in each stage from a match until the shadow for it is started
+   stats_entry_recent_histogram<int64_t> ClaimQueueTime;     // match until the claim request is sent to the startd
+   stats_entry_recent_histogram<int64_t> ClaimRequestTime;   // claim request sent until the startd replies
+   stats_entry_recent_histogram<int64_t> ClaimToShadowTime;  // claimed until the shadow is spawned
+   stats_entry_recent_histogram<int64_t> MatchToShadowTime;  // match until the shadow is spawned
+   stats_entry_recent<int> ClaimRequestsSent;     // claim requests sent to startds
+   stats_entry_recent<int> ClaimsBatched;         // extra slots claimed by requests for more than one slot
+
+   // writing of completed job ads to the history file, see HISTORY_WRITER_QUEUE_SIZE
+   stats_entry_recent<long long> HistoryAdsWritten;
+   stats_entry_recent<long long> HistoryBytesWritten;
+   stats_entry_recent<long long> HistoryWriteBatches;   // writes of one or more ads
+   stats_entry_recent<long long> HistoryWriteErrors;
+   stats_entry_recent<long long> HistoryWriterStalls;   // times a job ad waited for room in the writer queue
+   stats_entry_recent<double> HistoryWriterStallTime;   // seconds spent waiting for room in the writer queue
+   stats_entry_abs<int> HistoryWriterQueueDepth;        // job ads waiting to be written
+   stats_entry_abs<int> HistoryWriterQueuePeak;         // the most job ads that have been waiting at once
+
 
    // non-published values
    time_t InitTime;            // last time we init'ed the structure
@@ -150,6 +174,7 @@ typedef struct ScheddStatistics : public ScheddJobCounters {
    time_t Tick(time_t now=0); // call this when time may have changed to update StatsUpdateTime, etc.
    void Reconfig();
    void SetWindowSize(int window);
+   void UpdateHistoryWriterStats(); // copy the counters of the history file writer
    void Publish(ClassAd & ad) const;
    void Publish(ClassAd & ad, int flags) const;
    void Publish(ClassAd & ad, const char * config) const;
@@ -63,6 +63,7 @@
 #include "job_transforms.h"
 #include "history_queue.h"
 #include "live_job_counters.h"
+#include "periodic_policy.h"
 
 extern  int         STARTD_CONTACT_TIMEOUT;
 const	int			NEGOTIATOR_CONTACT_TIMEOUT = 30;
@@ -209,6 +210,12 @@ struct SubmitterData {
   bool isOwnerName; // the name of this submitter record is the same as the name of an owner record.
   bool absentUpdateSent;
   std::set<int> PrioSet; // Set of job priorities, used for JobPrioArray attr
+  LiveJobCounters live; // job counts that are always up-to-date with the committed job state
+  // the counters as of the last walk of the job queue by count_jobs, and live at that time.
+  // count_jobs passes that don't walk the job queue start from these.
+  SubmitterCounters counted;
+  std::unordered_map<std::string, SubmitterFlockCounters> flock_counted;
+  LiveJobCounters live_counted;
   SubmitterData() : LastHitTime(0), FlockLevel(0), OldFlockLevel(0), NegotiationTimestamp(0)
       , lastUpdateTime(0), isOwnerName(false), absentUpdateSent(false)  { }
 };
@@ -268,6 +275,8 @@ struct OwnerInfo {
   bool empty() const { return name.empty(); }
   RealOwnerCounters num; // job counts by OWNER rather than by submitter
   LiveJobCounters live; // job counts that are always up-to-date with the committed job state
+  RealOwnerCounters counted; // num and live as of the last walk of the job queue by count_jobs
+  LiveJobCounters live_counted;
   time_t LastHitTime; // records the last time we incremented num.Hit, use to expire OwnerInfo
   OwnerInfo() : LastHitTime(0) { }
 };
@@ -321,6 +330,14 @@ class match_rec
 	int keep_while_idle; // number of seconds to hold onto an idle claim
 	int idle_timer_deadline; // if the above is nonzero, abstime to hold claim
 
+		// when the match was made, when we sent the claim request to
+		// the startd and when the startd replied, for the ClaimQueueTime,
+		// ClaimRequestTime, ClaimToShadowTime and MatchToShadowTime statistics.
+		// cleared once the first shadow for the match is spawned.
+	double match_time;
+	double claim_sent_time;
+	double claimed_time;
+
 		// Set the mrec status to the given value (also updates
 		// entered_current_status)
 	void	setStatus( int stat );
@@ -717,6 +734,16 @@ class Scheduler : public Service
 	// live counters for running/held/idle jobs
 	LiveJobCounters liveJobCounts; // job counts that are always up-to-date with the committed job state
 
+	// ask for the next count_jobs() to walk the job queue and audit the live counters
+	void needJobCountAudit() { m_job_count_audit_needed = true; }
+	// move a job in the live counters of its submitter when its status changes
+	void updateSubmitterLiveJobCounts(JobQueueJob * job, int old_status, int new_status);
+
+	// when PERIODIC_EXPR_ON_CHANGE is true, decides which jobs the periodic policy is evaluated for
+	PeriodicPolicyTracker periodicPolicy;
+	// a policy attribute of the job changed, evaluate its periodic policy soon
+	void PeriodicExprsChanged(const JOB_ID_KEY & jid);
+
 	// the significant attributes that the schedd belives are absolutely required.
 	// This is NOT the effective set of sig attrs we get after we talk to negotiators
 	// it is the basic set needed for correct operation of the Schedd: Requirements,Rank,
@@ -815,6 +842,10 @@ private:
 	Timeslice       SchedDInterval;
 	Timeslice       PeriodicExprInterval;
 	int             periodicid;
+	time_t          m_next_periodic_expr_run {0};       // when the periodic expr timer will fire next
+	time_t          m_next_full_periodic_expr_pass {0}; // when to next evaluate all jobs, if PERIODIC_EXPR_ON_CHANGE
+	void            PeriodicExprsForChangedJobs(time_t now);
+	int             PeriodicExprDelay(time_t now);
 	int				QueueCleanInterval;
 	int             RequestClaimTimeout;
 	int				JobStartDelay;
@@ -884,6 +915,8 @@ private:
 	int				checkContactQueue_tid;	// DC Timer ID to check queue
 	int num_pending_startd_contacts;
 	int max_pending_startd_contacts;
+	int startd_contact_batch_size;  // claim requests to send per checkContactQueue() call
+	int claim_dslots_per_request;   // most dynamic slots to claim with one request
 
 		// If we we need to reconnect to disconnected starters, we
 		// stash the proc IDs in here while we read through the job
@@ -940,10 +973,26 @@ private:
 	ClassAd * slotWeightGuessAd;
 	bool			m_use_slot_weights;
 
+	// count_jobs() walks the job queue at most this often, in between it updates
+	// the job counts from the live counters.  0 means walk the job queue every time.
+	int				m_job_count_audit_interval {0};
+	time_t			m_last_job_count_audit {0};
+	bool			m_job_count_audit_needed {true};
+	// the schedd job counts as of the last walk of the job queue, and liveJobCounts at that time
+	struct {
+		int JobsIdle, JobsRunning, JobsHeld, JobsTotalAds, JobsRemoved;
+		int SchedUniverseJobsIdle, SchedUniverseJobsRunning;
+		int LocalUniverseJobsIdle, LocalUniverseJobsRunning;
+	} m_counted {};
+	LiveJobCounters m_live_counted;
+
 	// utility functions
 	void		sumAllSubmitterData(SubmitterData &all);
 	void		updateSubmitterAd(SubmitterData &submitterData, ClassAd &pAd, DCCollector *collector,  int flock_level, time_t time_now);
 	int			count_jobs();
+	void		count_jobs_from_live_counters(time_t now);
+	void		save_counted_jobs();
+	void		audit_live_job_counters(struct JobCountAudit & audit);
 	bool		fill_submitter_ad(ClassAd & pAd, const SubmitterData & Owner, const std::string &pool_name, int flock_level);
 	int			make_ad_list(ClassAdList & ads, ClassAd * pQueryAd=NULL);
 	int			handleMachineAdsQuery( Stream * stream, ClassAd & queryAd );
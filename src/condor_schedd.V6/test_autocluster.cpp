@@ -0,0 +1,225 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for giving autocluster ids to many jobs at once with several
+// threads (SCHEDD_AUTOCLUSTER_THREADS), checked against doing it one job at a time
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_attributes.h"
+#include "subsystem_info.h"
+
+#include "qmgmt.h"
+#include "autocluster.h"
+
+#include <memory>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+// the job queue is not linked into this test, autocluster.cpp needs only these from it
+void JobQueueBase::PopulateFromAd() {}
+void JobQueueJob::PopulateFromAd() {}
+JobQueueJob* GetJobAd(const PROC_ID& /*jid*/) { return nullptr; }
+void WalkJobQueue3(queue_job_scan_func /*fn*/, void* /*pv*/, schedd_runtime_probe & /*ftm*/) {}
+double last_autocluster_runtime;
+bool   last_autocluster_make_sig;
+int    last_autocluster_type = 0;
+
+static const char * SIG_ATTRS = "RequestCpus,RequestMemory,Owner,Requirements";
+
+typedef std::vector<std::unique_ptr<JobQueueJob>> JobList;
+
+// Jobs of a few shapes, so most share a signature with many others, and every
+// 97th job is different from all the rest.  Requirements refers to Wanted, which
+// is not a significant attribute but is part of the signature because of the reference.
+static void make_jobs(JobList & jobs, int first_cluster, int num_jobs)
+{
+	static const char * owners[] = { "alice", "bob", "carol", "dave" };
+	for (int ix = 0; ix < num_jobs; ++ix) {
+		auto job = std::make_unique<JobQueueJob>(JOB_ID_KEY(first_cluster + ix / 10, ix % 10));
+		job->Assign(ATTR_CLUSTER_ID, job->jid.cluster);
+		job->Assign(ATTR_PROC_ID, job->jid.proc);
+		job->Assign(ATTR_REQUEST_CPUS, (ix % 97 == 0) ? 100 + first_cluster + ix : 1 + ix % 3);
+		job->Assign(ATTR_REQUEST_MEMORY, 1024 * (1 + ix % 5));
+		job->Assign(ATTR_OWNER, owners[ix % 4]);
+		job->AssignExpr(ATTR_REQUIREMENTS, "TARGET.Memory >= MY.RequestMemory && Wanted");
+		job->Assign("Wanted", (ix % 7) != 0);
+		job->Assign("NotSignificant", ix);
+		jobs.push_back(std::move(job));
+	}
+}
+
+static void configure(AutoCluster & ac)
+{
+	classad::References basic_attrs;
+	ac.config(basic_attrs, SIG_ATTRS);
+}
+
+// give ids to jobs the way that the schedd does without threads
+static void assign_one_at_a_time(AutoCluster & ac, JobList & jobs, size_t first)
+{
+	for (size_t ix = first; ix < jobs.size(); ++ix) {
+		REQUIRE(ac.getAutoClusterid(jobs[ix].get()) >= 0);
+	}
+}
+
+static void assign_with_threads(AutoCluster & ac, JobList & jobs, size_t first, int num_threads)
+{
+	std::vector<JobQueueJob*> batch;
+	for (size_t ix = first; ix < jobs.size(); ++ix) {
+		batch.push_back(jobs[ix].get());
+	}
+	ac.getAutoClusterids(batch, num_threads);
+}
+
+// what makes jobs from make_jobs() different
+static std::string shape_of(JobQueueJob & job)
+{
+	int cpus = 0, memory = 0;
+	bool wanted = false;
+	std::string owner;
+	job.LookupInteger(ATTR_REQUEST_CPUS, cpus);
+	job.LookupInteger(ATTR_REQUEST_MEMORY, memory);
+	job.LookupString(ATTR_OWNER, owner);
+	job.LookupBool("Wanted", wanted);
+	return std::to_string(cpus) + "/" + std::to_string(memory) + "/" + owner + "/" + (wanted ? "1" : "0");
+}
+
+// both ways give each job the same id and the same list of attributes, the jobs that
+// are the same share an id, and the jobs that are different don't
+static void compare(JobList & single, JobList & threaded, AutoCluster & single_ac, AutoCluster & threaded_ac)
+{
+	REQUIRE(single.size() == threaded.size());
+	REQUIRE(single_ac.getNumAutoclusters() == threaded_ac.getNumAutoclusters());
+
+	int mismatched_ids = 0, mismatched_attrs = 0, missing = 0;
+	std::map<std::string, int> id_of_shape;
+	std::map<int, std::string> shape_of_id;
+	int wrong_sharing = 0;
+	for (size_t ix = 0; ix < single.size() && ix < threaded.size(); ++ix) {
+		JobQueueJob & one = *single[ix];
+		JobQueueJob & other = *threaded[ix];
+		int one_id = -1, other_id = -1;
+		std::string one_attrs, other_attrs;
+		if ( ! one.LookupInteger(ATTR_AUTO_CLUSTER_ID, one_id) ||
+			! other.LookupInteger(ATTR_AUTO_CLUSTER_ID, other_id) ||
+			! one.LookupString(ATTR_AUTO_CLUSTER_ATTRS, one_attrs) ||
+			! other.LookupString(ATTR_AUTO_CLUSTER_ATTRS, other_attrs)) {
+			++missing;
+			continue;
+		}
+		if (one_id != other_id || one.autocluster_id != other.autocluster_id || other.autocluster_id != other_id) {
+			++mismatched_ids;
+		}
+		if (one_attrs != other_attrs) {
+			++mismatched_attrs;
+		}
+
+		std::string shape = shape_of(other);
+		auto [sit, new_shape] = id_of_shape.emplace(shape, other_id);
+		auto [iit, new_id] = shape_of_id.emplace(other_id, shape);
+		if (sit->second != other_id || iit->second != shape || new_shape != new_id) {
+			++wrong_sharing;
+		}
+	}
+	REQUIRE(missing == 0);
+	REQUIRE(mismatched_ids == 0);
+	REQUIRE(mismatched_attrs == 0);
+	REQUIRE(wrong_sharing == 0);
+	REQUIRE((int)id_of_shape.size() == threaded_ac.getNumAutoclusters());
+}
+
+static void test_same_ids(int num_jobs, int num_threads)
+{
+	AutoCluster single_ac, threaded_ac;
+	configure(single_ac);
+	configure(threaded_ac);
+
+	JobList single, threaded;
+	make_jobs(single, 1, num_jobs);
+	make_jobs(threaded, 1, num_jobs);
+	assign_one_at_a_time(single_ac, single, 0);
+	assign_with_threads(threaded_ac, threaded, 0, num_threads);
+	compare(single, threaded, single_ac, threaded_ac);
+
+	// more jobs, some like the ones that already have ids and some new
+	size_t first = single.size();
+	make_jobs(single, 1 + num_jobs, num_jobs / 2);
+	make_jobs(threaded, 1 + num_jobs, num_jobs / 2);
+	assign_one_at_a_time(single_ac, single, first);
+	assign_with_threads(threaded_ac, threaded, first, num_threads);
+	compare(single, threaded, single_ac, threaded_ac);
+
+	// the attributes that went into the signature
+	std::string attrs;
+	REQUIRE(threaded[0]->LookupString(ATTR_AUTO_CLUSTER_ATTRS, attrs));
+	REQUIRE(attrs == "RequestCpus,RequestMemory,Owner,Requirements,Wanted");
+}
+
+// the jobs that already have an id keep it, and are counted as in use
+static void test_existing_ids()
+{
+	AutoCluster ac;
+	configure(ac);
+	JobList jobs;
+	make_jobs(jobs, 1, 300);
+	assign_with_threads(ac, jobs, 0, 4);
+	int id = -1;
+	REQUIRE(jobs[1]->LookupInteger(ATTR_AUTO_CLUSTER_ID, id));
+	REQUIRE(ac.getAutoClusterid(jobs[1].get()) == id);
+
+	// without significant attributes there are no ids to give
+	AutoCluster unconfigured;
+	JobList more;
+	make_jobs(more, 1000, 10);
+	assign_with_threads(unconfigured, more, 0, 4);
+	REQUIRE( ! more[0]->Lookup(ATTR_AUTO_CLUSTER_ID));
+	REQUIRE(unconfigured.getNumAutoclusters() == 0);
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	// fewer jobs than one thread takes at a time
+	test_same_ids(100, 4);
+	// several chunks for several threads
+	test_same_ids(3000, 4);
+	// one thread per core, and more jobs than are done in one batch
+	test_same_ids(40000, 0);
+	// a single thread
+	test_same_ids(1000, 1);
+	test_existing_ids();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
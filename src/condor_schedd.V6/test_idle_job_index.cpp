@@ -0,0 +1,234 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the schedd's index of idle jobs by submitter and autocluster
+
+#include "condor_common.h"
+#include "condor_debug.h"
+
+#include "idle_job_index.h"
+
+#include <algorithm>
+#include <random>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static prio_rec makeRec(const char * submitter, int cluster, int proc, int auto_cluster_id, int job_prio = 0)
+{
+	prio_rec rec;
+	rec.id.cluster = cluster;
+	rec.id.proc = proc;
+	rec.submitter = submitter;
+	rec.auto_cluster_id = auto_cluster_id;
+	rec.job_prio = job_prio;
+	return rec;
+}
+
+// the ids of the jobs that a walker returns, as "cluster.proc,..."
+static std::string walk(const IdleJobIndex & index, const char * submitter = nullptr)
+{
+	std::string sub(submitter ? submitter : "");
+	IdleJobIndex::Walker walker(index, submitter ? &sub : nullptr);
+	std::string result;
+	while (const prio_rec * rec = walker.Next()) {
+		if ( ! result.empty()) result += ",";
+		result += std::to_string(rec->id.cluster) + "." + std::to_string(rec->id.proc);
+	}
+	return result;
+}
+
+static std::string ids(const std::vector<prio_rec> & recs)
+{
+	std::string result;
+	for (const auto & rec : recs) {
+		if ( ! result.empty()) result += ",";
+		result += std::to_string(rec.id.cluster) + "." + std::to_string(rec.id.proc);
+	}
+	return result;
+}
+
+// the walker merges the autoclusters into the order of the sorted PrioRec array
+static void test_merge_order()
+{
+	std::mt19937 rng(42);
+	const char * submitters[] = {"alice@pool", "bob@pool", "carol@other.pool"};
+	std::vector<prio_rec> recs;
+	IdleJobIndex index;
+	for (int cluster = 1; cluster <= 40; ++cluster) {
+		const char * submitter = submitters[rng() % 3];
+		int procs = 1 + rng() % 8;
+		for (int proc = 0; proc < procs; ++proc) {
+			prio_rec rec = makeRec(submitter, cluster, proc, (int)(rng() % 5), (int)(rng() % 4) - 2);
+			rec.pre_job_prio1 = (rng() % 7 == 0) ? 1 : 0;
+			rec.post_job_prio2 = (int)(rng() % 2);
+			recs.push_back(rec);
+			index.Insert(rec);
+		}
+	}
+	REQUIRE(index.NumIdle() == recs.size());
+	REQUIRE(index.NumKnown() == recs.size());
+
+	std::vector<prio_rec> sorted(recs);
+	std::sort(sorted.begin(), sorted.end(), prio_compar{});
+	REQUIRE(walk(index) == ids(sorted));
+
+	for (const char * submitter : submitters) {
+		std::vector<prio_rec> mine;
+		for (const auto & rec : sorted) {
+			if (rec.submitter == submitter) mine.push_back(rec);
+		}
+		REQUIRE(walk(index, submitter) == ids(mine));
+	}
+	REQUIRE(walk(index, "nobody@pool") == "");
+}
+
+// re-inserting a job with a new priority or autocluster moves it
+static void test_insert_moves()
+{
+	IdleJobIndex index;
+	index.Insert(makeRec("a@pool", 1, 0, 1));
+	index.Insert(makeRec("a@pool", 1, 1, 1));
+	index.Insert(makeRec("a@pool", 2, 0, 2));
+	REQUIRE(walk(index) == "1.0,1.1,2.0");
+
+	index.Insert(makeRec("a@pool", 2, 0, 2, 10));
+	REQUIRE(walk(index) == "2.0,1.0,1.1");
+	REQUIRE(index.NumIdle() == 3);
+
+	index.Insert(makeRec("a@pool", 1, 1, 2));
+	REQUIRE(index.Jobs("a@pool", 1)->size() == 1);
+	REQUIRE(index.Jobs("a@pool", 2)->size() == 2);
+	REQUIRE(index.NumIdle() == 3);
+	REQUIRE(index.NumKnown() == 3);
+}
+
+// SkipAutoCluster drops the rest of the autocluster of the last job
+static void test_skip_autocluster()
+{
+	IdleJobIndex index;
+	for (int proc = 0; proc < 3; ++proc) {
+		index.Insert(makeRec("a@pool", 1, proc, 7));
+		index.Insert(makeRec("a@pool", 2, proc, 8));
+	}
+
+	IdleJobIndex::Walker walker(index, nullptr);
+	const prio_rec * rec = walker.Next();
+	REQUIRE(rec && rec->id.cluster == 1 && rec->id.proc == 0);
+	walker.SkipAutoCluster();
+	std::string rest;
+	while ((rec = walker.Next())) {
+		rest += std::to_string(rec->id.cluster) + "." + std::to_string(rec->id.proc) + " ";
+	}
+	REQUIRE(rest == "2.0 2.1 2.2 ");
+}
+
+// the transitions that job status changes make in DoSetAttributeCallbacks:
+// a job leaves the index when it stops being idle, and comes back in its old
+// place when it is idle again, until the next walk forgets it
+static void test_status_changes()
+{
+	IdleJobIndex index;
+	index.Insert(makeRec("a@pool", 1, 0, 1));
+	index.Insert(makeRec("a@pool", 1, 1, 1));
+	index.Insert(makeRec("a@pool", 1, 2, 1));
+
+	// idle -> running
+	index.JobNotIdle(JOB_ID_KEY(1, 1));
+	REQUIRE(walk(index) == "1.0,1.2");
+	REQUIRE(index.NumIdle() == 2);
+	REQUIRE(index.NumKnown() == 3);
+	// running -> held, the job was already out of the index
+	index.JobNotIdle(JOB_ID_KEY(1, 1));
+	REQUIRE(index.NumIdle() == 2);
+
+	// held -> idle, back in priority order
+	REQUIRE(index.JobIdle(JOB_ID_KEY(1, 1)));
+	REQUIRE(walk(index) == "1.0,1.1,1.2");
+	REQUIRE(index.NumIdle() == 3);
+	// a second idle does not add it twice
+	REQUIRE(index.JobIdle(JOB_ID_KEY(1, 1)));
+	REQUIRE(index.NumIdle() == 3);
+
+	// a job that was not in the index at the last walk waits for the next one
+	REQUIRE( ! index.JobIdle(JOB_ID_KEY(2, 0)));
+	REQUIRE(walk(index) == "1.0,1.1,1.2");
+
+	// the last idle job of an autocluster takes the autocluster out
+	index.JobNotIdle(JOB_ID_KEY(1, 0));
+	index.JobNotIdle(JOB_ID_KEY(1, 1));
+	index.JobNotIdle(JOB_ID_KEY(1, 2));
+	REQUIRE(index.Jobs("a@pool", 1) == nullptr);
+	REQUIRE(walk(index) == "");
+
+	// the next walk starts over
+	index.Clear();
+	REQUIRE(index.NumKnown() == 0);
+	REQUIRE( ! index.JobIdle(JOB_ID_KEY(1, 0)));
+}
+
+static void test_job_removed()
+{
+	IdleJobIndex index;
+	index.Insert(makeRec("a@pool", 1, 0, 1));
+	index.Insert(makeRec("a@pool", 1, 1, 1));
+	index.Insert(makeRec("b@pool", 2, 0, 3));
+
+	// removing an idle job
+	index.JobRemoved(JOB_ID_KEY(1, 0));
+	// submitters are ordered the way prio_compar orders them, not alphabetically
+	REQUIRE(walk(index) == "2.0,1.1");
+	REQUIRE(index.NumIdle() == 2);
+	REQUIRE(index.NumKnown() == 2);
+	REQUIRE( ! index.JobIdle(JOB_ID_KEY(1, 0)));
+
+	// removing a job that is not idle, it must not come back
+	index.JobNotIdle(JOB_ID_KEY(2, 0));
+	index.JobRemoved(JOB_ID_KEY(2, 0));
+	REQUIRE(index.NumKnown() == 1);
+	REQUIRE( ! index.JobIdle(JOB_ID_KEY(2, 0)));
+	REQUIRE(walk(index, "b@pool") == "");
+	REQUIRE(index.Jobs("b@pool", 3) == nullptr);
+
+	// removing a job that the index never saw
+	index.JobRemoved(JOB_ID_KEY(9, 9));
+	REQUIRE(index.NumIdle() == 1);
+	REQUIRE(walk(index) == "1.1");
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	test_merge_order();
+	test_insert_moves();
+	test_skip_autocluster();
+	test_status_changes();
+	test_job_removed();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
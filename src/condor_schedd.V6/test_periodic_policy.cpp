@@ -0,0 +1,325 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for finding when the periodic policy of a job may change, and for the timer wheel
+// that holds the jobs until then
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "subsystem_info.h"
+#include "compat_classad_util.h"
+
+#include "periodic_policy.h"
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static const time_t NOW = 1700000000;
+
+// what scanning an expression found
+struct Scanned {
+	time_t next {0};
+	bool unsolved {false};
+};
+
+// scan the expression against a job with the given attributes
+static Scanned scan(const char * expr_str, const char * job_attrs = "")
+{
+	Scanned result;
+	classad::ClassAd job;
+	std::string ad_str = std::string("[") + job_attrs + "]";
+	classad::ClassAdParser parser;
+	if ( ! parser.ParseClassAd(ad_str, job, true)) {
+		fprintf(stderr, "Failed to parse %s\n", ad_str.c_str());
+		++fail_count;
+	}
+
+	classad::ExprTree * expr = nullptr;
+	if (ParseClassAdRvalExpr(expr_str, expr) != 0 || ! expr) {
+		fprintf(stderr, "Failed to parse %s\n", expr_str);
+		++fail_count;
+		return result;
+	}
+	TimeThresholds thresholds(job, NOW);
+	thresholds.Scan(expr);
+	delete expr;
+	result.next = thresholds.next;
+	result.unsolved = thresholds.unsolved;
+	return result;
+}
+
+// comparisons of sums and differences of the time are solved
+static void test_comparisons()
+{
+	Scanned tt = scan("time() - EnteredCurrentStatus > 3600", "EnteredCurrentStatus = 1699999900");
+	REQUIRE(tt.next == NOW + 3500);
+	REQUIRE( ! tt.unsolved);
+
+	tt = scan("CurrentTime >= Deadline", "Deadline = 1700000050");
+	REQUIRE(tt.next == NOW + 50);
+	REQUIRE( ! tt.unsolved);
+
+	// the time on the right hand side
+	tt = scan("Deadline < time()", "Deadline = 1700000050");
+	REQUIRE(tt.next == NOW + 50);
+
+	// scaled by a constant
+	tt = scan("(time() - QDate) / 60 > 10", "QDate = 1700000000");
+	REQUIRE(tt.next == NOW + 600);
+	REQUIRE( ! tt.unsolved);
+	tt = scan("2 * time() > 2 * Deadline", "Deadline = 1700000020");
+	REQUIRE(tt.next == NOW + 20);
+
+	// negated
+	tt = scan("-time() < -Deadline", "Deadline = 1700000030");
+	REQUIRE(tt.next == NOW + 30);
+	REQUIRE( ! tt.unsolved);
+
+	// a threshold that has passed won't change the answer again
+	tt = scan("time() > Deadline", "Deadline = 1699999000");
+	REQUIRE(tt.next == 0);
+	REQUIRE( ! tt.unsolved);
+
+	// a fraction of a second is rounded up
+	tt = scan("time() > Deadline + 0.5", "Deadline = 1700000010");
+	REQUIRE(tt.next == NOW + 11);
+
+	// the time is followed through attributes of the job
+	tt = scan("Age > 100", "Age = time() - QDate; QDate = 1700000000");
+	REQUIRE(tt.next == NOW + 100);
+	REQUIRE( ! tt.unsolved);
+
+	// comparisons to an undefined value don't change until an attribute does
+	tt = scan("time() > Missing");
+	REQUIRE(tt.next == 0);
+	REQUIRE( ! tt.unsolved);
+
+	// expressions that don't use the time have no threshold
+	tt = scan("JobStatus == 5 && NumJobStarts > 3", "JobStatus = 2; NumJobStarts = 1");
+	REQUIRE(tt.next == 0);
+	REQUIRE( ! tt.unsolved);
+}
+
+// the earliest threshold of the comparisons in && || ! and function calls is found
+static void test_logic()
+{
+	Scanned tt = scan("(time() > A) && (time() < B)", "A = 1700000200; B = 1700000100");
+	REQUIRE(tt.next == NOW + 100);
+	REQUIRE( ! tt.unsolved);
+
+	tt = scan("(time() > A) || (JobStatus == 2 && time() > B)", "A = 1700000200; B = 1700000100; JobStatus = 2");
+	REQUIRE(tt.next == NOW + 100);
+	REQUIRE( ! tt.unsolved);
+
+	tt = scan("!(time() > A)", "A = 1700000070");
+	REQUIRE(tt.next == NOW + 70);
+	REQUIRE( ! tt.unsolved);
+
+	tt = scan("ifThenElse(time() > A, true, time() > B)", "A = 1700000300; B = 1700000040");
+	REQUIRE(tt.next == NOW + 40);
+	REQUIRE( ! tt.unsolved);
+
+	tt = scan("(time() > A) ? true : false", "A = 1700000080");
+	REQUIRE(tt.next == NOW + 80);
+}
+
+// other uses of the time are unsolved
+static void test_unsolvable()
+{
+	Scanned tt = scan("time() * time() > 5");
+	REQUIRE(tt.unsolved);
+
+	tt = scan("time() % 60 == 0");
+	REQUIRE(tt.unsolved);
+
+	tt = scan("Deadline / (time() - QDate) > 1", "Deadline = 100; QDate = 1");
+	REQUIRE(tt.unsolved);
+
+	tt = scan("time()");
+	REQUIRE(tt.unsolved);
+
+	tt = scan("member(time(), {1, 2})");
+	REQUIRE(tt.unsolved);
+
+	tt = scan("size({time()}) > 0");
+	REQUIRE(tt.unsolved);
+
+	tt = scan("formatTime(time(), \"%H\") == \"12\"");
+	REQUIRE(tt.unsolved);
+
+	// a solvable comparison next to an unsolvable one still has its threshold
+	tt = scan("(time() > A) || (time() % 60 == 0)", "A = 1700000090");
+	REQUIRE(tt.unsolved);
+	REQUIRE(tt.next == NOW + 90);
+}
+
+// attributes nested more deeply than the scan looks are unsolved, not ignored
+static void test_too_deep()
+{
+	std::string attrs;
+	const int chain = 20;
+	for (int ii = 0; ii < chain; ++ii) {
+		formatstr_cat(attrs, "A%d = A%d + 1; ", ii, ii + 1);
+	}
+	formatstr_cat(attrs, "A%d = time() - 1700000000", chain);
+
+	Scanned tt = scan("A0 > 100", attrs.c_str());
+	REQUIRE(tt.unsolved);
+	REQUIRE(tt.next == 0);
+
+	// the same, but only referred to by an expression that the scan doesn't compare
+	tt = scan("A0", attrs.c_str());
+	REQUIRE(tt.unsolved);
+
+	// a short chain is followed
+	tt = scan("A0 > 100", "A0 = A1 + 1; A1 = time() - 1700000000");
+	REQUIRE( ! tt.unsolved);
+	REQUIRE(tt.next == NOW + 99);
+}
+
+static std::string ids(const std::vector<JOB_ID_KEY> & jobs)
+{
+	std::string result;
+	for (const auto & jid : jobs) {
+		if ( ! result.empty()) result += ",";
+		formatstr_cat(result, "%d.%d", jid.cluster, jid.proc);
+	}
+	return result;
+}
+
+// jobs come out of the wheel when their time comes, and only then
+static void test_wheel()
+{
+	PeriodicPolicyTracker tracker;
+	tracker.Config(true, 60);
+	REQUIRE(tracker.Enabled());
+
+	// start the wheel at a known time
+	std::vector<JOB_ID_KEY> jobs;
+	time_t now = time(nullptr) + 1;
+	tracker.TakeDueJobs(now, jobs);
+	REQUIRE(jobs.empty());
+	REQUIRE(tracker.SecondsToNextDue(now) == -1);
+
+	tracker.Schedule(JOB_ID_KEY(1, 0), now + 5);
+	tracker.Schedule(JOB_ID_KEY(1, 1), now + 10);
+	REQUIRE(tracker.NumScheduled() == 2);
+	REQUIRE(tracker.SecondsToNextDue(now) == 5);
+
+	tracker.TakeDueJobs(now + 4, jobs);
+	REQUIRE(jobs.empty());
+	tracker.TakeDueJobs(now + 5, jobs);
+	REQUIRE(ids(jobs) == "1.0");
+	REQUIRE(tracker.NumScheduled() == 1);
+
+	// skipping past a due time still takes the job
+	tracker.TakeDueJobs(now + 20, jobs);
+	REQUIRE(ids(jobs) == "1.1");
+	REQUIRE(tracker.NumScheduled() == 0);
+	now += 20;
+
+	// scheduling a job again replaces its old time, earlier or later
+	tracker.Schedule(JOB_ID_KEY(2, 0), now + 5);
+	tracker.Schedule(JOB_ID_KEY(2, 0), now + 8);
+	tracker.Schedule(JOB_ID_KEY(2, 1), now + 8);
+	tracker.Schedule(JOB_ID_KEY(2, 1), now + 3);
+	REQUIRE(tracker.NumScheduled() == 2);
+	tracker.TakeDueJobs(now + 5, jobs);
+	REQUIRE(ids(jobs) == "2.1");
+	tracker.TakeDueJobs(now + 8, jobs);
+	REQUIRE(ids(jobs) == "2.0");
+	now += 8;
+
+	// a time that the wheel has passed makes the job due on the next pass
+	tracker.Schedule(JOB_ID_KEY(3, 0), now - 2);
+	REQUIRE(tracker.NumChanged() == 1);
+	REQUIRE(tracker.SecondsToNextDue(now) == 0);
+	tracker.TakeDueJobs(now, jobs);
+	REQUIRE(ids(jobs) == "3.0");
+
+	// times more than a turn of the wheel away wait for their turn
+	tracker.Schedule(JOB_ID_KEY(4, 0), now + 2000);
+	tracker.TakeDueJobs(now + 1500, jobs);
+	REQUIRE(jobs.empty());
+	REQUIRE(tracker.NumScheduled() == 1);
+	tracker.TakeDueJobs(now + 1999, jobs);
+	REQUIRE(jobs.empty());
+	tracker.TakeDueJobs(now + 2000, jobs);
+	REQUIRE(ids(jobs) == "4.0");
+	now += 2000;
+
+	// and are taken when the wheel jumps more than a turn
+	tracker.Schedule(JOB_ID_KEY(5, 0), now + 10);
+	tracker.Schedule(JOB_ID_KEY(5, 1), now + 3000);
+	tracker.TakeDueJobs(now + 5000, jobs);
+	REQUIRE(ids(jobs) == "5.0,5.1");
+	REQUIRE(tracker.NumScheduled() == 0);
+	now += 5000;
+
+	// changed jobs come out with the due jobs, sorted and only once
+	tracker.Schedule(JOB_ID_KEY(6, 2), now + 1);
+	tracker.Schedule(JOB_ID_KEY(6, 0), now + 1);
+	REQUIRE(tracker.JobChanged(JOB_ID_KEY(6, 1)));
+	REQUIRE( ! tracker.JobChanged(JOB_ID_KEY(6, 0)));
+	tracker.TakeDueJobs(now + 1, jobs);
+	REQUIRE(ids(jobs) == "6.0,6.1,6.2");
+	REQUIRE(tracker.NumChanged() == 0);
+	REQUIRE(tracker.SecondsToNextDue(now + 1) == -1);
+	now += 1;
+
+	// Clear() forgets everything
+	tracker.Schedule(JOB_ID_KEY(7, 0), now + 1);
+	tracker.JobChanged(JOB_ID_KEY(7, 1));
+	tracker.Clear();
+	REQUIRE(tracker.NumScheduled() == 0);
+	REQUIRE(tracker.NumChanged() == 0);
+	tracker.TakeDueJobs(now + 100, jobs);
+	REQUIRE(jobs.empty());
+
+	// when disabled, changes aren't tracked
+	tracker.Config(false, 60);
+	REQUIRE( ! tracker.JobChanged(JOB_ID_KEY(8, 0)));
+	REQUIRE(tracker.NumChanged() == 0);
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	test_comparisons();
+	test_logic();
+	test_unsolvable();
+	test_too_deep();
+	test_wheel();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
@@ -0,0 +1,354 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_classad.h"
+#include "classad_oldnew.h"
+#include "reli_sock.h"
+#include "subsystem_info.h"
+#include "condor_ver_info.h"
+#include "shortfile.h"
+#include "basename.h"
+
+#include <thread>
+
+//
+// Measures the throughput of sending ClassAds over CEDAR with the text
+// encoding and with the binary encoding, the way the collector answers a
+// query: many ads in one message, each preceded by a "more" int.  The ads
+// are sent by a thread over a socketpair and received with the options the
+// collector uses for updates (GET_CLASSAD_FAST | GET_CLASSAD_LAZY_PARSE).
+//
+//   bench_classad_wire.exe [num ads [ad file]]
+//
+// num ads is the number of ads to send for each measurement, the default is
+// 20000.  By default a typical slot ad and a typical job ad are measured, if
+// an ad file is given, the ads in it (in long form, separated by blank lines,
+// as from condor_status -long) are sent round robin instead.  For each set
+// of ads and each encoding a line like this is written to stdout
+//
+//   ads=slot encoding=binary count=20000 bytes_per_ad=1234 ads_per_sec=56789
+//
+
+static const char * slot_ad_text =
+	"MyType = \"Machine\"\n"
+	"TargetType = \"Job\"\n"
+	"Name = \"slot1_1@execute-042.example.com\"\n"
+	"Machine = \"execute-042.example.com\"\n"
+	"MyAddress = \"<10.0.3.42:9618?addrs=10.0.3.42-9618&alias=execute-042.example.com&noUDP&sock=startd_1873_2ac1>\"\n"
+	"Arch = \"X86_64\"\n"
+	"OpSys = \"LINUX\"\n"
+	"OpSysAndVer = \"AlmaLinux9\"\n"
+	"OpSysMajorVer = 9\n"
+	"OpSysName = \"AlmaLinux\"\n"
+	"CondorVersion = \"$CondorVersion: 24.1.0 2024-08-01 BuildID: 745110 PackageID: 24.1.0-1 $\"\n"
+	"CondorPlatform = \"$CondorPlatform: x86_64_AlmaLinux9 $\"\n"
+	"State = \"Claimed\"\n"
+	"Activity = \"Busy\"\n"
+	"EnteredCurrentState = 1722951043\n"
+	"EnteredCurrentActivity = 1722951045\n"
+	"SlotType = \"Dynamic\"\n"
+	"SlotTypeID = -1\n"
+	"SlotID = 1\n"
+	"SlotName = \"slot1\"\n"
+	"DynamicSlot = true\n"
+	"PartitionableSlot = false\n"
+	"Cpus = 4\n"
+	"Memory = 16384\n"
+	"Disk = 52428800\n"
+	"GPUs = 0\n"
+	"TotalCpus = 64.0\n"
+	"TotalMemory = 515706\n"
+	"TotalDisk = 1782579200\n"
+	"TotalSlots = 17\n"
+	"DetectedCpus = 64\n"
+	"DetectedMemory = 515706\n"
+	"LoadAvg = 3.98\n"
+	"CondorLoadAvg = 3.97\n"
+	"TotalLoadAvg = 61.23\n"
+	"TotalCondorLoadAvg = 60.5\n"
+	"KeyboardIdle = 1853209\n"
+	"ConsoleIdle = 1853209\n"
+	"Mips = 31562\n"
+	"KFlops = 2345671\n"
+	"HasFileTransfer = true\n"
+	"HasPerFileEncryption = true\n"
+	"HasJobDeferral = true\n"
+	"HasJICLocalConfig = true\n"
+	"HasJICLocalStdin = true\n"
+	"HasSelfCheckpointTransfers = true\n"
+	"HasSingularity = true\n"
+	"HasDocker = false\n"
+	"HasEncryptExecuteDirectory = true\n"
+	"FileSystemDomain = \"example.com\"\n"
+	"UidDomain = \"example.com\"\n"
+	"StarterAbilityList = \"HasFileTransfer,HasTDP,HasPerFileEncryption,HasReconnect,HasMPI,HasTDP,HasJobDeferral,HasJICLocalConfig,HasJICLocalStdin,HasPerFileEncryption,HasFileTransferPluginMethods,HasVM,HasSelfCheckpointTransfers\"\n"
+	"HasFileTransferPluginMethods = \"data,dav,davs,gdrive,http,https,onedrive,s3,box,ftp,file\"\n"
+	"Start = (isUndefined(TARGET.RequestGPUs) || TARGET.RequestGPUs == 0) && (TARGET.RequestMemory <= MY.Memory) && (MY.KeyboardIdle > 15 * 60 || MY.TotalSlots > 1)\n"
+	"Rank = 0.0\n"
+	"Requirements = START && (WithinResourceLimits)\n"
+	"WithinResourceLimits = (MY.Cpus > 0 && TARGET.RequestCpus <= MY.Cpus && MY.Memory > 0 && TARGET.RequestMemory <= MY.Memory && MY.Disk > 0 && TARGET.RequestDisk <= MY.Disk && (TARGET.RequestGPUs =?= undefined || MY.GPUs >= TARGET.RequestGPUs))\n"
+	"IsValidCheckpointPlatform = (TARGET.JobUniverse == 1 && MY.CheckpointPlatform =?= TARGET.LastCheckpointPlatform) || (TARGET.JobUniverse =!= 1)\n"
+	"CurrentRank = 0.0\n"
+	"RemoteUser = \"alice@example.com\"\n"
+	"RemoteOwner = \"alice@example.com\"\n"
+	"AccountingGroup = \"group_physics.alice@example.com\"\n"
+	"ClientMachine = \"submit-1.example.com\"\n"
+	"JobId = \"4213987.117\"\n"
+	"GlobalJobId = \"submit-1.example.com#4213987.117#1722950112\"\n"
+	"JobStart = 1722951045\n"
+	"JobUniverse = 5\n"
+	"ImageSize = 3456789\n"
+	"MonitorSelfAge = 1200\n"
+	"MonitorSelfCPUUsage = 0.12\n"
+	"MonitorSelfImageSize = 41236\n"
+	"MonitorSelfResidentSetSize = 18744\n"
+	"MonitorSelfTime = 1722951643\n"
+	"DaemonStartTime = 1721098111\n"
+	"LastHeardFrom = 1722951644\n"
+	"UpdateSequenceNumber = 1544\n"
+	"UpdatesTotal = 1545\n"
+	"UpdatesSequenced = 1544\n"
+	"UpdatesLost = 0\n"
+	"UpdatesHistory = \"00000000000000000000000000000000\"\n"
+	"TotalTimeClaimedBusy = 60601\n"
+	"TotalTimeUnclaimedIdle = 4125\n"
+	"RecentJobBusyTimeAvg = 3712.5\n"
+	"RecentJobDurationAvg = 3751.25\n"
+	"ExpectedMachineGracefulDrainingCompletion = 1722951644\n"
+	"ExpectedMachineQuickDrainingCompletion = 1722951644\n"
+	"MachineResources = \"Cpus Memory Disk Swap GPUs\"\n"
+	"ChildCpus = { }\n"
+	"CpuBusyTime = 0\n"
+	"CpuIsBusy = false\n"
+	"ClaimEndTime = 1723037445\n"
+	"MaxJobRetirementTime = 0\n"
+	"PslotRollupInformation = true\n"
+	"NumDynamicSlots = 0\n"
+	"SlotWeight = Cpus\n"
+	"Unhibernate = MY.MachineLastMatchTime =!= undefined\n"
+	"MachineLastMatchTime = 1722951043\n"
+	"StartdIpAddr = \"<10.0.3.42:9618?addrs=10.0.3.42-9618&alias=execute-042.example.com&noUDP&sock=startd_1873_2ac1>\"\n"
+	"AuthenticatedIdentity = \"condor@example.com\"\n"
+	"AuthenticationMethod = \"IDTOKENS\"\n";
+
+static const char * job_ad_text =
+	"MyType = \"Job\"\n"
+	"TargetType = \"Machine\"\n"
+	"ClusterId = 4213987\n"
+	"ProcId = 117\n"
+	"GlobalJobId = \"submit-1.example.com#4213987.117#1722950112\"\n"
+	"Owner = \"alice\"\n"
+	"User = \"alice@example.com\"\n"
+	"AccountingGroup = \"group_physics.alice\"\n"
+	"AcctGroup = \"group_physics\"\n"
+	"AcctGroupUser = \"alice\"\n"
+	"JobUniverse = 5\n"
+	"JobStatus = 2\n"
+	"JobPrio = 0\n"
+	"Cmd = \"/home/alice/analysis/run_analysis.sh\"\n"
+	"Arguments = \"--input dataset_117.root --output result_117.root --events 100000\"\n"
+	"Iwd = \"/home/alice/analysis\"\n"
+	"In = \"/dev/null\"\n"
+	"Out = \"logs/out.4213987.117\"\n"
+	"Err = \"logs/err.4213987.117\"\n"
+	"UserLog = \"/home/alice/analysis/logs/analysis.log\"\n"
+	"Environment = \"DATASET=117 OMP_NUM_THREADS=4\"\n"
+	"QDate = 1722950112\n"
+	"EnteredCurrentStatus = 1722951045\n"
+	"JobCurrentStartDate = 1722951045\n"
+	"JobStartDate = 1722951045\n"
+	"ShadowBday = 1722951045\n"
+	"NumJobStarts = 1\n"
+	"NumShadowStarts = 1\n"
+	"JobRunCount = 1\n"
+	"RequestCpus = 4\n"
+	"RequestMemory = ifthenelse(MemoryUsage =!= undefined, MAX({ MemoryUsage * 5 / 4, 4096 }), 4096)\n"
+	"RequestDisk = DiskUsage\n"
+	"DiskUsage = 2500000\n"
+	"DiskUsage_RAW = 2456123\n"
+	"ImageSize = 3456789\n"
+	"ImageSize_RAW = 3456789\n"
+	"MemoryUsage = ((ResidentSetSize + 1023) / 1024)\n"
+	"ResidentSetSize = 3012345\n"
+	"ResidentSetSize_RAW = 3012345\n"
+	"Requirements = (TARGET.Arch == \"X86_64\") && (TARGET.OpSys == \"LINUX\") && (TARGET.Disk >= RequestDisk) && (TARGET.Memory >= RequestMemory) && (TARGET.Cpus >= RequestCpus) && (TARGET.HasFileTransfer)\n"
+	"Rank = 0.0\n"
+	"PeriodicHold = false\n"
+	"PeriodicRelease = false\n"
+	"PeriodicRemove = (JobStatus == 5 && (time() - EnteredCurrentStatus) > 7 * 24 * 3600)\n"
+	"OnExitHold = false\n"
+	"OnExitRemove = true\n"
+	"LeaveJobInQueue = false\n"
+	"WantRemoteIO = true\n"
+	"WantRemoteSyscalls = false\n"
+	"WantCheckpoint = false\n"
+	"ShouldTransferFiles = \"YES\"\n"
+	"WhenToTransferOutput = \"ON_EXIT\"\n"
+	"TransferIn = false\n"
+	"TransferInput = \"dataset_117.root,config/analysis.json\"\n"
+	"TransferOutput = \"result_117.root\"\n"
+	"TransferInputSizeMB = 2398\n"
+	"StreamOut = false\n"
+	"StreamErr = false\n"
+	"BufferSize = 524288\n"
+	"BufferBlockSize = 32768\n"
+	"CumulativeSlotTime = 0\n"
+	"CumulativeSuspensionTime = 0\n"
+	"CommittedTime = 0\n"
+	"CommittedSlotTime = 0\n"
+	"RemoteWallClockTime = 0.0\n"
+	"RemoteUserCpu = 0.0\n"
+	"RemoteSysCpu = 0.0\n"
+	"ExitBySignal = false\n"
+	"CompletionDate = 0\n"
+	"LastSuspensionTime = 0\n"
+	"NumCkpts = 0\n"
+	"NumRestarts = 0\n"
+	"NumSystemHolds = 0\n"
+	"MaxHosts = 1\n"
+	"MinHosts = 1\n"
+	"CurrentHosts = 1\n"
+	"RemoteHost = \"slot1_1@execute-042.example.com\"\n"
+	"StartdPrincipal = \"execute-side@matchsession/10.0.3.42\"\n"
+	"LastMatchTime = 1722951043\n"
+	"LastJobLeaseRenewal = 1722951645\n"
+	"JobLeaseDuration = 2400\n"
+	"AutoClusterId = 12\n"
+	"AutoClusterAttrs = \"JobUniverse,LastCheckpointPlatform,NumCkpts,MachineLastMatchTime,RequestCpus,RequestDisk,RequestMemory,Requirements,NiceUser,ConcurrencyLimits\"\n"
+	"JobNotification = 0\n"
+	"NiceUser = false\n"
+	"CoreSize = 0\n"
+	"KillSig = \"SIGTERM\"\n"
+	"Submitter = \"alice@example.com\"\n";
+
+// parse ads in long form, separated by blank lines
+static void
+parse_ads(const char * text, std::vector<classad::ClassAd> & ads)
+{
+	ads.emplace_back();
+	for (const auto & line : StringTokenIterator(text, "\n")) {
+		if (line.find_first_not_of(" \t\r") == std::string::npos) {
+			if (ads.back().size()) { ads.emplace_back(); }
+			continue;
+		}
+		if ( ! InsertLongFormAttrValue(ads.back(), line.c_str(), true)) {
+			fprintf(stderr, "Failed to parse %s\n", line.c_str());
+			exit(1);
+		}
+	}
+	if ( ! ads.back().size()) { ads.pop_back(); }
+}
+
+// peer_version decides the encoding, putClassAd uses the binary encoding
+// only for peers that are new enough to read it
+static void
+measure(const char * label, const std::vector<classad::ClassAd> & ads, int count, const CondorVersionInfo & peer_version, const char * encoding)
+{
+	ReliSock sender, receiver;
+	if ( ! sender.connect_socketpair(receiver)) {
+		fprintf(stderr, "Failed to create a socketpair\n");
+		exit(1);
+	}
+	sender.set_peer_version(&peer_version);
+	receiver.set_peer_version(&peer_version);
+	sender.timeout(60);
+	receiver.timeout(60);
+
+	double begin = _condor_debug_get_time_double();
+
+	std::thread send_thread([&]() {
+		sender.encode();
+		for (int ii = 0; ii < count; ++ii) {
+			int more = 1;
+			if ( ! sender.code(more) || ! putClassAd(&sender, ads[ii % ads.size()])) {
+				fprintf(stderr, "Failed to send ad %d\n", ii);
+				exit(1);
+			}
+		}
+		int more = 0;
+		sender.code(more);
+		sender.end_of_message();
+	});
+
+	int received = 0;
+	receiver.decode();
+	for (;;) {
+		int more = 0;
+		if ( ! receiver.code(more)) {
+			fprintf(stderr, "Failed to receive after %d ads\n", received);
+			exit(1);
+		}
+		if ( ! more) { break; }
+		classad::ClassAd ad;
+		if ( ! getClassAdEx(&receiver, ad, GET_CLASSAD_FAST | GET_CLASSAD_LAZY_PARSE)) {
+			fprintf(stderr, "Failed to receive ad %d\n", received);
+			exit(1);
+		}
+		++received;
+	}
+	receiver.end_of_message();
+	send_thread.join();
+
+	double elapsed = _condor_debug_get_time_double() - begin;
+	double bytes = receiver.get_bytes_recvd();
+	printf("ads=%s encoding=%s count=%d bytes_per_ad=%.0f ads_per_sec=%.0f\n",
+		label, encoding, received, bytes / received, received / elapsed);
+	fflush(stdout);
+}
+
+int
+main(int argc, char * argv[])
+{
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config();
+
+	int count = (argc > 1) ? MAX(1, atoi(argv[1])) : 20000;
+
+	std::vector<std::pair<std::string, std::vector<classad::ClassAd>>> sets;
+	if (argc > 2) {
+		std::string text;
+		if ( ! htcondor::readShortFile(argv[2], text)) {
+			fprintf(stderr, "Failed to read %s\n", argv[2]);
+			return 1;
+		}
+		sets.emplace_back(condor_basename(argv[2]), std::vector<classad::ClassAd>());
+		parse_ads(text.c_str(), sets.back().second);
+		if (sets.back().second.empty()) {
+			fprintf(stderr, "No ads in %s\n", argv[2]);
+			return 1;
+		}
+	} else {
+		sets.emplace_back("slot", std::vector<classad::ClassAd>());
+		parse_ads(slot_ad_text, sets.back().second);
+		sets.emplace_back("job", std::vector<classad::ClassAd>());
+		parse_ads(job_ad_text, sets.back().second);
+	}
+
+	CondorVersionInfo text_peer(9, 0, 0);
+	CondorVersionInfo binary_peer;
+	for (const auto & [label, ads] : sets) {
+		measure(label.c_str(), ads, count, text_peer, "text");
+		measure(label.c_str(), ads, count, binary_peer, "binary");
+	}
+
+	return 0;
+}
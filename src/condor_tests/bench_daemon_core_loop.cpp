@@ -0,0 +1,192 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+
+#include "condor_daemon_core.h"
+#include "subsystem_info.h"
+
+#include <sys/resource.h>
+
+//
+// Measures the overhead of one pass through the DaemonCore event loop as
+// the number of registered pipes grows.  The registered pipes are idle,
+// one more pipe is written to by its own handler, so every pass through
+// the loop wakes up for exactly one ready pipe.
+//
+//   bench_daemon_core_loop.exe -t -p 0 [fd counts [wakeups]]
+//
+// fd counts is a comma separated list of the numbers of idle pipes to
+// measure with, in increasing order, the default is 0,100,1000,10000.
+// wakeups is the number of passes to time at each count, the default is
+// 10000.  Set DAEMON_CORE_USE_EPOLL to compare select() and epoll, e.g.
+//
+//   _CONDOR_DAEMON_CORE_USE_EPOLL=true bench_daemon_core_loop.exe -t -p 0
+//
+// For each count a line like this is written to stdout
+//
+//   fds=1000 wakeups=10000 epoll=1 usec_per_wakeup=3.21 setup_sec=0.012
+//
+
+static std::vector<int> fd_counts;
+static size_t fd_count_ix = 0;
+static int wakeups_wanted = 10000;
+static int wakeups = 0;
+static double wakeups_begin = 0.0;
+static double setup_sec = 0.0;
+
+static int ping_pipe[2] = { -1, -1 };
+static std::vector<int> idle_pipes;  // both ends of each idle pipe
+
+static int
+idle_handler(int /* pipe_end */)
+{
+	fprintf(stderr, "An idle pipe was ready, which should never happen\n");
+	DC_Exit(1);
+	return 0;
+}
+
+// register idle pipes until there are count of them. returns false if we run out of fds
+static bool
+add_idle_pipes(int count)
+{
+	while ((int)idle_pipes.size() / 2 < count) {
+		int ends[2];
+		if ( ! daemonCore->Create_Pipe(ends, true, false, true, true)) {
+			fprintf(stderr, "Failed to create idle pipe %d: %s\n", (int)idle_pipes.size() / 2, strerror(errno));
+			return false;
+		}
+		daemonCore->Register_Pipe(ends[0], "idle pipe", idle_handler, "idle_handler");
+		idle_pipes.push_back(ends[0]);
+		idle_pipes.push_back(ends[1]);
+	}
+	return true;
+}
+
+static void
+start_round()
+{
+	double begin = _condor_debug_get_time_double();
+	if ( ! add_idle_pipes(fd_counts[fd_count_ix])) {
+		DC_Exit(1);
+	}
+	setup_sec = _condor_debug_get_time_double() - begin;
+
+	wakeups = 0;
+	wakeups_begin = _condor_debug_get_time_double();
+	char ch = 'p';
+	daemonCore->Write_Pipe(ping_pipe[1], &ch, 1);
+}
+
+static int
+ping_handler(int pipe_end)
+{
+	char ch;
+	daemonCore->Read_Pipe(pipe_end, &ch, 1);
+
+	if (++wakeups < wakeups_wanted) {
+		daemonCore->Write_Pipe(ping_pipe[1], &ch, 1);
+		return 0;
+	}
+
+	double elapsed = _condor_debug_get_time_double() - wakeups_begin;
+	printf("fds=%d wakeups=%d epoll=%d usec_per_wakeup=%.2f setup_sec=%.3f\n",
+		fd_counts[fd_count_ix], wakeups, param_boolean("DAEMON_CORE_USE_EPOLL", false) ? 1 : 0,
+		elapsed * 1e6 / wakeups, setup_sec);
+	fflush(stdout);
+
+	if (++fd_count_ix < fd_counts.size()) {
+		start_round();
+	} else {
+		DC_Exit(0);
+	}
+	return 0;
+}
+
+int
+test_main( int argc, char ** argv ) {
+	const char * counts = (argc > 1) ? argv[1] : "0,100,1000,10000";
+	for (const auto & count : StringTokenIterator(counts)) {
+		fd_counts.push_back(atoi(count.c_str()));
+	}
+	if (argc > 2) {
+		wakeups_wanted = MAX(1, atoi(argv[2]));
+	}
+	if (fd_counts.empty()) {
+		fprintf(stderr, "usage: %s [fd counts [wakeups]]\n", argv[0]);
+		return 1;
+	}
+
+	if ( ! daemonCore->Create_Pipe(ping_pipe, true, false, true, true)) {
+		fprintf(stderr, "Failed to create the ping pipe\n");
+		return 1;
+	}
+	daemonCore->Register_Pipe(ping_pipe[0], "ping pipe", ping_handler, "ping_handler");
+
+	start_round();
+	return 0;
+}
+
+
+//
+// Stubs for daemon core.
+//
+
+void main_config() { }
+
+void main_pre_command_sock_init() { }
+
+void main_pre_dc_init( int /* argc */, char ** /* argv */ ) { }
+
+void main_shutdown_fast() { DC_Exit( 0 ); }
+
+void main_shutdown_graceful() { DC_Exit( 0 ); }
+
+void
+main_init( int argc, char ** argv ) {
+	int rv = test_main( argc, argv );
+	if( rv ) { DC_Exit( rv ); }
+}
+
+
+//
+// main()
+//
+int
+main( int argc, char * argv[] ) {
+	set_mySubSystem( "TOOL", false, SUBSYSTEM_TYPE_TOOL );
+
+	// each idle pipe takes two fds, so allow as many as we can
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	dc_main_init = & main_init;
+	dc_main_config = & main_config;
+	dc_main_shutdown_fast = & main_shutdown_fast;
+	dc_main_shutdown_graceful = & main_shutdown_graceful;
+	dc_main_pre_dc_init = & main_pre_dc_init;
+	dc_main_pre_command_sock_init = & main_pre_command_sock_init;
+
+	return dc_main( argc, argv );
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env pytest
+
+# Test that condor_convert_classad_log converts a ClassAd log from text to
+# binary and back without changing it.
+
+import re
+
+from ornithology import action
+
+import logging
+
+
+logger = logging.getLogger(__name__)
+logger.setLevel(logging.DEBUG)
+
+
+# a small job queue log, in the form that the text writer produces.
+# the writer puts a space after the op of a record with an empty body.
+TEXT_LOG = """107 1 CreationTimestamp 1700000000
+105{SP}
+101 0.0 Job Machine
+103 0.0 NextClusterNum 2
+106{SP}
+105{SP}
+101 01.-1 Job Machine
+103 01.-1 Owner "alice"
+103 01.-1 Cmd "/bin/sleep"
+103 01.-1 RequestCpus 1
+103 01.-1 RequestMemory ifThenElse(MemoryUsage =!= undefined,MemoryUsage,(ImageSize + 1023) / 1024)
+103 01.-1 Requirements (TARGET.Arch == "X86_64") && (TARGET.OpSys == "LINUX")
+101 1.0 Job Machine
+103 1.0 ProcId 0
+103 1.0 JobStatus 1
+103 1.0 OnExitRemove true
+103 1.0 WantCheckpoint false
+103 1.0 Args "with \\"quotes\\" and spaces"
+103 1.0 Iwd undefined
+103 1.0 Bad error
+103 1.0 QDate -1700000000
+104 1.0 Iwd
+106 #2024-01-02T03:04:05.678901
+105{SP}
+103 1.0 JobStatus 5
+102 1.0
+106{SP}
+""".replace("{SP}", " ")
+
+NUM_RECORDS = len(TEXT_LOG.splitlines())
+
+
+def convert(condor, *args):
+    p = condor.run_command(["condor_convert_classad_log", *args])
+    logger.debug(p.stdout)
+    logger.debug(p.stderr)
+    assert p.returncode == 0
+    m = re.search(r"Converted (\d+) records", p.stdout)
+    assert m is not None
+    return int(m.group(1))
+
+
+@action
+def the_logs(default_condor, test_dir):
+    text = test_dir / "job_queue.log"
+    text.write_text(TEXT_LOG)
+
+    logs = {
+        "text": text,
+        "binary": test_dir / "job_queue.bin",
+        "text2": test_dir / "job_queue.text2",
+        "binary2": test_dir / "job_queue.bin2",
+        "text3": test_dir / "job_queue.text3",
+    }
+    counts = {
+        "binary": convert(default_condor, "-binary", logs["text"].as_posix(), logs["binary"].as_posix()),
+        "text2": convert(default_condor, logs["binary"].as_posix(), logs["text2"].as_posix()),
+        "binary2": convert(default_condor, logs["text2"].as_posix(), logs["binary2"].as_posix()),
+        "text3": convert(default_condor, "-text", logs["binary2"].as_posix(), logs["text3"].as_posix()),
+    }
+    return logs, counts
+
+
+class TestConvertClassAdLog:
+
+    def test_all_records_converted(self, the_logs):
+        _, counts = the_logs
+        for name, count in counts.items():
+            assert count == NUM_RECORDS, name
+
+    def test_binary_is_binary(self, the_logs):
+        logs, _ = the_logs
+        assert logs["binary"].read_bytes()[:8] == b"\x89CALOG\r\n"
+        assert logs["binary"].stat().st_size < logs["text"].stat().st_size
+
+    def test_text_round_trip(self, the_logs):
+        logs, _ = the_logs
+        original = [line.rstrip() for line in logs["text"].read_text().splitlines()]
+        converted = [line.rstrip() for line in logs["text2"].read_text().splitlines()]
+        assert converted == original
+
+    def test_second_round_trip_is_identical(self, the_logs):
+        logs, _ = the_logs
+        assert logs["text3"].read_bytes() == logs["text2"].read_bytes()
@@ -0,0 +1,166 @@
+#!/usr/bin/env pytest
+
+# Test that condor_history finds the same jobs through the sidecar indexes
+# of the history files (HISTORY_INDEX) as it does by reading the files, and
+# that it skips the files whose completion dates can't match the constraint.
+#
+# Every job ad is written to its own history file: MAX_HISTORY_LOG is tiny,
+# so the schedd rotates the history file before each ad.  The jobs finish
+# a few seconds apart, so the rotated files get different names and the
+# jobs get different completion dates.
+
+import shutil
+import time
+
+from ornithology import (
+    action,
+    Condor,
+    ClusterState,
+)
+
+import logging
+
+
+logger = logging.getLogger(__name__)
+logger.setLevel(logging.DEBUG)
+
+
+NUM_CLUSTERS = 4
+
+
+@action
+def the_condor(test_dir):
+    with Condor(
+        local_dir=test_dir / "condor",
+        config={
+            "HISTORY_INDEX":            True,
+            "ENABLE_HISTORY_ROTATION":  True,
+            "MAX_HISTORY_LOG":          1,
+            "MAX_HISTORY_ROTATIONS":    NUM_CLUSTERS + 2,
+        },
+    ) as the_condor:
+        yield the_condor
+
+
+@action
+def the_clusters(the_condor, path_to_sleep):
+    clusters = []
+    for _ in range(NUM_CLUSTERS):
+        handle = the_condor.submit(
+            description={
+                "executable":               path_to_sleep,
+                "arguments":                0,
+                "transfer_executable":      False,
+                "should_transfer_files":    False,
+            },
+            count=1,
+        )
+        assert handle.wait(
+            condition=ClusterState.all_complete,
+            fail_condition=ClusterState.any_held,
+            timeout=120,
+        )
+        clusters.append(handle.clusterid)
+        # so that the next job finishes in a later second
+        time.sleep(2)
+    return clusters
+
+
+def run_history(condor, *args):
+    p = condor.run_command(["condor_history", *args])
+    logger.debug(p.stdout)
+    logger.debug(p.stderr)
+    assert p.returncode == 0
+    return p
+
+
+@action
+def the_history(the_condor, the_clusters):
+    # wait for the last job to leave the queue and get to the history file
+    deadline = time.time() + 60
+    while True:
+        p = run_history(the_condor, "-af", "ClusterId", "CompletionDate", "Owner")
+        rows = [line.split() for line in p.stdout.splitlines() if line.strip()]
+        if len(rows) >= NUM_CLUSTERS or time.time() > deadline:
+            break
+        time.sleep(1)
+    return {int(row[0]): (int(row[1]), row[2]) for row in rows}
+
+
+@action
+def the_owner(the_history):
+    return next(iter(the_history.values()))[1]
+
+
+@action
+def the_history_files(the_condor, the_history):
+    history = the_condor.run_command(["condor_config_val", "HISTORY"]).stdout.strip()
+    spool = the_condor.spool_dir
+    name = history.rsplit("/", 1)[-1]
+    return sorted(p for p in spool.iterdir() if p.name == name or p.name.startswith(name + "."))
+
+
+def index_of(path):
+    return path.parent / f".{path.name}.idx"
+
+
+@action
+def the_indexed_files(the_history_files):
+    return [path for path in the_history_files if index_of(path).exists()]
+
+
+@action
+def the_unindexed_history(test_dir, the_history_files):
+    # copies of the history files without their indexes
+    copy_dir = test_dir / "unindexed"
+    copy_dir.mkdir()
+    for path in the_history_files:
+        shutil.copy(path, copy_dir / path.name)
+    return copy_dir / "history"
+
+
+def both_ways(condor, unindexed, *args):
+    indexed = run_history(condor, "-diagnostic", *args, "-af", "ClusterId", "ProcId")
+    read = run_history(condor, "-search", unindexed.as_posix(), *args, "-af", "ClusterId", "ProcId")
+    return indexed, read
+
+
+class TestHistoryIndex:
+
+    def test_one_job_per_file(self, the_clusters, the_history, the_history_files):
+        assert sorted(the_history.keys()) == the_clusters
+        job_files = [path for path in the_history_files if path.stat().st_size > 0]
+        assert len(job_files) == NUM_CLUSTERS
+        # the indexes were rotated along with their history files
+        for path in job_files:
+            assert index_of(path).exists()
+
+    def test_owner_from_index(self, the_condor, the_owner, the_unindexed_history, the_indexed_files):
+        indexed, read = both_ways(the_condor, the_unindexed_history, the_owner)
+        assert indexed.stderr.count("Searching the index of") == len(the_indexed_files)
+        assert indexed.stdout.splitlines() == read.stdout.splitlines()
+        assert len(indexed.stdout.splitlines()) == NUM_CLUSTERS
+
+    def test_cluster_from_index(self, the_condor, the_clusters, the_unindexed_history):
+        cluster = str(the_clusters[1])
+        indexed, read = both_ways(the_condor, the_unindexed_history, cluster)
+        assert "Searching the index of" in indexed.stderr
+        assert indexed.stdout.splitlines() == read.stdout.splitlines()
+        assert indexed.stdout.splitlines() == [f"{cluster} 0"]
+
+    def test_skips_files_by_completion_date(self, the_condor, the_clusters, the_history,
+                                            the_owner, the_unindexed_history, the_indexed_files):
+        since = the_history[the_clusters[2]][0]
+        constraint = f"CompletionDate >= {since}"
+        indexed, read = both_ways(the_condor, the_unindexed_history, the_owner, "-constraint", constraint)
+        # only the files of the last two jobs can match, the rest are skipped by their indexes
+        assert indexed.stderr.count("Skipping history file") == len(the_indexed_files) - 2
+        assert indexed.stdout.splitlines() == read.stdout.splitlines()
+        expected = [f"{cluster} 0" for cluster in the_clusters[2:]]
+        assert sorted(indexed.stdout.splitlines()) == sorted(expected)
+
+    def test_skips_every_file(self, the_condor, the_owner, the_indexed_files, the_unindexed_history):
+        indexed, read = both_ways(the_condor, the_unindexed_history, the_owner, "-constraint", "CompletionDate < 1000")
+        assert indexed.stderr.count("Skipping history file") == len(the_indexed_files)
+        assert indexed.stdout.strip() == ""
+        assert read.stdout.strip() == ""
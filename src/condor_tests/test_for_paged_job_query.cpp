@@ -0,0 +1,127 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Query the jobs of the local schedd with DCSchedd::queryJobsPaged, and print
+// the id of each job that it returns.  After the given number of jobs, run a
+// command, so that a test can change the queue between the pages of a query.
+//
+// With -schedd-version, the schedd is taken to be of that version instead of
+// the one it reports, which decides whether the query is paged.
+//
+//   test_for_paged_job_query.exe [-schedd-version <x.y.z>] <page-size> <constraint> [<after-jobs> <command>]
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "condor_commands.h"
+#include "subsystem_info.h"
+#include "dc_schedd.h"
+#include "query_result_type.h"
+#include "condor_ver_info.h"
+
+struct PagedQueryState {
+	int jobs {0};
+	int run_after {-1};
+	const char * command {nullptr};
+};
+
+static bool
+print_job(void * pv, ClassAd * ad)
+{
+	auto * state = (PagedQueryState*)pv;
+	int cluster = -1, proc = -1;
+	ad->LookupInteger(ATTR_CLUSTER_ID, cluster);
+	ad->LookupInteger(ATTR_PROC_ID, proc);
+	printf("%d.%d\n", cluster, proc);
+	fflush(stdout);
+
+	if (++state->jobs == state->run_after && state->command) {
+		int rval = system(state->command);
+		printf("command exited %d\n", rval);
+		fflush(stdout);
+	}
+	return true;
+}
+
+int
+main(int argc, char * argv[])
+{
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config();
+	dprintf_set_tool_debug("TOOL", 0);
+
+	const char * schedd_version = nullptr;
+	if (argc > 2 && strcmp(argv[1], "-schedd-version") == 0) {
+		schedd_version = argv[2];
+		argv += 2;
+		argc -= 2;
+	}
+	if (argc != 3 && argc != 5) {
+		fprintf(stderr, "usage: %s [-schedd-version <x.y.z>] <page-size> <constraint> [<after-jobs> <command>]\n", argv[0]);
+		return 2;
+	}
+	int page_size = atoi(argv[1]);
+	PagedQueryState state;
+	if (argc == 5) {
+		state.run_after = atoi(argv[3]);
+		state.command = argv[4];
+	}
+
+	ClassAd request_ad;
+	std::string projection = ATTR_CLUSTER_ID "\n" ATTR_PROC_ID;
+	if (DCSchedd::makeJobsQueryAd(request_ad, argv[2], projection.c_str(), QueryFetchOpts::fetch_Jobs) != Q_OK) {
+		fprintf(stderr, "invalid constraint %s\n", argv[2]);
+		return 2;
+	}
+
+	std::unique_ptr<DCSchedd> schedd(new DCSchedd());
+	if (schedd_version) {
+		int major = 0, minor = 0, sub = 0;
+		if (sscanf(schedd_version, "%d.%d.%d", &major, &minor, &sub) != 3) {
+			fprintf(stderr, "invalid version %s\n", schedd_version);
+			return 2;
+		}
+		if ( ! schedd->locate()) {
+			fprintf(stderr, "can't find the schedd\n");
+			return 1;
+		}
+		ClassAd schedd_ad;
+		schedd_ad.InsertAttr(ATTR_NAME, schedd->name());
+		schedd_ad.InsertAttr(ATTR_MY_ADDRESS, schedd->addr());
+		schedd_ad.InsertAttr(ATTR_VERSION, CondorVersionInfo(major, minor, sub).get_version_stdstring());
+		schedd.reset(new DCSchedd(schedd_ad));
+	}
+	CondorError errstack;
+	ClassAd * summary_ad = nullptr;
+	int rval = schedd->queryJobsPaged(QUERY_JOB_ADS, request_ad, page_size, print_job, &state, 20, &errstack, &summary_ad);
+	if (rval != Q_OK) {
+		fprintf(stderr, "query failed %d: %s\n", rval, errstack.getFullText().c_str());
+		return 1;
+	}
+
+	long long total = -1;
+	if (summary_ad) {
+		summary_ad->LookupInteger("Jobs", total);
+		delete summary_ad;
+	}
+	printf("returned %d jobs, summary %lld jobs\n", state.jobs, total);
+	return 0;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env pytest
+
+# Test that with SCHEDD_JOB_QUEUE_GROUP_COMMIT the durable commits of
+# two clients that submit at the same time share one fsync of the job
+# queue log, and that both clients get their reply after it.
+
+import subprocess
+
+from ornithology import (
+    action,
+    Condor,
+)
+
+import logging
+
+
+logger = logging.getLogger(__name__)
+logger.setLevel(logging.DEBUG)
+
+
+@action
+def the_condor(test_dir):
+    local_dir = test_dir / "condor"
+
+    with Condor(
+        local_dir=local_dir,
+        config={
+            'SCHEDD_DEBUG':                             'D_FULLDEBUG',
+            'SCHEDD_JOB_QUEUE_GROUP_COMMIT':            True,
+            # long enough that both submits commit before the sync
+            'SCHEDD_JOB_QUEUE_GROUP_COMMIT_DELAY':      5,
+            'START':                                    False,
+        },
+    ) as the_condor:
+        yield the_condor
+
+
+@action
+def the_submit_files(test_dir, path_to_sleep):
+    files = []
+    for ii in range(2):
+        submit_file = test_dir / f"job{ii}.sub"
+        submit_file.write_text(
+f"""
+executable = {path_to_sleep}
+arguments = 1
+transfer_executable = false
+should_transfer_files = no
+queue
+"""
+        )
+        files.append(submit_file)
+    return files
+
+
+@action
+def the_submits(the_condor, the_submit_files):
+    with the_condor.use_config():
+        procs = [
+            subprocess.Popen(
+                ["condor_submit", submit_file.as_posix()],
+                stdout=subprocess.PIPE,
+                stderr=subprocess.STDOUT,
+            )
+            for submit_file in the_submit_files
+        ]
+        results = []
+        for proc in procs:
+            output, _ = proc.communicate(timeout=60)
+            logger.debug(output.decode())
+            results.append(proc.returncode)
+    return results
+
+
+@action
+def the_sync_messages(the_condor, the_submits):
+    messages = []
+    for message in the_condor.schedd_log.open().read():
+        if 'Synced ' in message and ' job queue commits in ' in message:
+            messages.append(str(message))
+    return messages
+
+
+class TestJobQueueGroupCommit:
+
+    def test_both_submits_succeed(self, the_submits):
+        assert the_submits == [0, 0]
+
+    def test_jobs_are_in_the_queue(self, the_condor, the_submits):
+        assert len(the_condor.query(projection=["ClusterId"])) == 2
+
+    def test_one_sync_replies_to_both(self, the_sync_messages):
+        assert any('replying to 2 clients' in message for message in the_sync_messages)
@@ -0,0 +1,167 @@
+#!/usr/bin/env pytest
+
+# Test paged job queries: that paging returns every job once and in order,
+# that condor_q pages when CONDOR_Q_PAGE_SIZE is set, and that changes to
+# the queue between pages are seen by the later pages. Schedds older than
+# 24.2.0 aren't asked for pages, so the tool claims the schedd is 24.2.0
+# for the paged queries; the schedd confirms paging in its summary ad.
+
+import os
+import subprocess
+from pathlib import Path
+
+from ornithology import (
+    action,
+    Condor,
+)
+
+import logging
+
+
+logger = logging.getLogger(__name__)
+logger.setLevel(logging.DEBUG)
+
+
+# built next to this test
+TOOL = Path("test_for_paged_job_query.exe").resolve()
+
+NUM_JOBS = 10
+PAGE_SIZE = 3
+PAGING_VERSION = "24.2.0"
+OLD_VERSION = "24.1.0"
+
+
+@action
+def the_condor(test_dir):
+    local_dir = test_dir / "condor"
+
+    with Condor(
+        local_dir=local_dir,
+        config={
+            'SCHEDD_DEBUG':     'D_COMMAND:2',
+            'START':            False,
+        },
+    ) as the_condor:
+        yield the_condor
+
+
+@action
+def the_cluster(the_condor, test_dir, path_to_sleep):
+    submit_file = test_dir / "paged.sub"
+    submit_file.write_text(
+f"""
+executable = {path_to_sleep}
+arguments = 1
+transfer_executable = false
+should_transfer_files = no
+My.Paged = true
+queue {NUM_JOBS}
+"""
+    )
+    p = the_condor.run_command(["condor_submit", submit_file.as_posix()])
+    assert p.returncode == 0
+    return int(the_condor.query(projection=["ClusterId"])[0]["ClusterId"])
+
+
+def run_tool(condor, *args):
+    with condor.use_config():
+        p = subprocess.run(
+            [TOOL.as_posix(), *args],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            universal_newlines=True,
+            timeout=60,
+        )
+    logger.debug(p.stdout)
+    logger.debug(p.stderr)
+    assert p.returncode == 0
+    return p.stdout.splitlines()
+
+
+def job_ids(lines):
+    return [line for line in lines if not line.startswith(("command", "returned"))]
+
+
+def page_messages(condor):
+    return [
+        str(message)
+        for message in condor.schedd_log.open().read()
+        if "QUERY_JOB_ADS page of cursor" in message
+    ]
+
+
+@action
+def the_paged_query(the_condor, the_cluster):
+    return run_tool(the_condor, "-schedd-version", PAGING_VERSION, str(PAGE_SIZE), "Paged")
+
+
+@action
+def the_old_schedd_query(the_condor, the_cluster, the_paged_query):
+    before = len(page_messages(the_condor))
+    lines = run_tool(the_condor, "-schedd-version", OLD_VERSION, str(PAGE_SIZE), "Paged")
+    return lines, len(page_messages(the_condor)) - before
+
+
+@action
+def the_paged_condor_q(the_condor, the_cluster):
+    with the_condor.use_config():
+        p = subprocess.run(
+            ["condor_q", "-allusers", "-af", "ClusterId", "ProcId"],
+            env={**os.environ, "_CONDOR_CONDOR_Q_PAGE_SIZE": str(PAGE_SIZE)},
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            universal_newlines=True,
+            timeout=60,
+        )
+    logger.debug(p.stdout)
+    assert p.returncode == 0
+    return [".".join(line.split()) for line in p.stdout.splitlines() if line.strip()]
+
+
+@action
+def the_changed_query(the_condor, the_cluster, the_paged_query, the_paged_condor_q):
+    # after the first page, job 4 stops matching and job 5 is removed. the schedd
+    # has already matched ahead the second page, so both have to be checked again.
+    command = (
+        f"condor_qedit {the_cluster}.4 Paged false && "
+        f"condor_rm {the_cluster}.5"
+    )
+    return run_tool(
+        the_condor, "-schedd-version", PAGING_VERSION,
+        str(PAGE_SIZE), "Paged && JobStatus =!= 3", str(PAGE_SIZE), command,
+    )
+
+
+@action
+def the_page_messages(the_condor, the_changed_query):
+    return page_messages(the_condor)
+
+
+class TestPagedJobQuery:
+
+    def test_every_job_once_in_order(self, the_cluster, the_paged_query):
+        expected = [f"{the_cluster}.{proc}" for proc in range(NUM_JOBS)]
+        assert job_ids(the_paged_query) == expected
+
+    def test_counts_summed_over_pages(self, the_paged_query):
+        assert the_paged_query[-1] == f"returned {NUM_JOBS} jobs, summary {NUM_JOBS} jobs"
+
+    def test_old_schedd_not_paged(self, the_cluster, the_old_schedd_query):
+        lines, pages = the_old_schedd_query
+        expected = [f"{the_cluster}.{proc}" for proc in range(NUM_JOBS)]
+        assert job_ids(lines) == expected
+        assert pages == 0
+
+    def test_condor_q_pages(self, the_cluster, the_paged_condor_q):
+        expected = [f"{the_cluster}.{proc}" for proc in range(NUM_JOBS)]
+        assert the_paged_condor_q == expected
+
+    def test_queries_were_paged(self, the_page_messages):
+        # ceil(10 / 3) pages for the first query and at least 3 for the last;
+        # condor_q pages too only if this build is new enough to ask for pages
+        assert len(the_page_messages) >= 4 + 3
+
+    def test_changes_between_pages(self, the_cluster, the_changed_query):
+        assert "command exited 0" in the_changed_query
+        expected = [f"{the_cluster}.{proc}" for proc in range(NUM_JOBS) if proc not in (4, 5)]
+        assert job_ids(the_changed_query) == expected
@@ -0,0 +1,92 @@
+#!/usr/bin/env pytest
+
+# Test that jobs which leave the idle state and come back to it are still
+# offered to the negotiator.  The schedd keeps an index of its idle jobs
+# that is updated as job status changes are committed, and negotiates from
+# that index instead of from the PrioRec array.
+
+from ornithology import (
+    action,
+    Condor,
+    ClusterState,
+)
+
+import logging
+
+
+logger = logging.getLogger(__name__)
+logger.setLevel(logging.DEBUG)
+
+
+@action
+def the_condor(test_dir):
+    local_dir = test_dir / "condor"
+
+    with Condor(
+        local_dir=local_dir,
+        config={
+            'NUM_CPUS':                     2,
+            'NEGOTIATOR_INTERVAL':          2,
+            'NEGOTIATOR_MIN_INTERVAL':      1,
+            'SCHEDD_INTERVAL':              2,
+        },
+    ) as the_condor:
+        yield the_condor
+
+
+def submit(condor, test_dir, path_to_sleep, name, seconds, count):
+    return condor.submit(
+        description={
+            "log":                      (test_dir / f"{name}.log").as_posix(),
+            "executable":               path_to_sleep,
+            "arguments":                str(seconds),
+            "transfer_executable":      False,
+            "should_transfer_files":    False,
+            "leave_in_queue":           True,
+        },
+        count=count,
+    )
+
+
+@action
+def the_released_jobs(the_condor, test_dir, path_to_sleep):
+    # held right after submit, so usually they are not idle when the index is rebuilt
+    handle = submit(the_condor, test_dir, path_to_sleep, "released", 1, 2)
+    handle.hold()
+    assert handle.wait(condition=ClusterState.all_held, timeout=60)
+    handle.release()
+    done = handle.wait(
+        condition=ClusterState.all_complete,
+        fail_condition=ClusterState.any_held,
+        timeout=120,
+    )
+    yield handle, done
+    handle.remove()
+
+
+@action
+def the_vacated_jobs(the_condor, test_dir, path_to_sleep, the_released_jobs):
+    # running -> idle -> running, the job comes back into the index in its old place
+    handle = submit(the_condor, test_dir, path_to_sleep, "vacated", 10, 2)
+    assert handle.wait(condition=ClusterState.all_running, timeout=120)
+    handle.vacate()
+    done = handle.wait(
+        condition=ClusterState.all_complete,
+        fail_condition=ClusterState.any_held,
+        timeout=180,
+    )
+    yield handle, done
+    handle.remove()
+
+
+class TestScheddIdleJobIndex:
+
+    def test_released_jobs_run(self, the_released_jobs):
+        _, done = the_released_jobs
+        assert done
+
+    def test_vacated_jobs_run_again(self, the_vacated_jobs):
+        handle, done = the_vacated_jobs
+        assert done
+        for ad in handle.query(projection=["NumJobStarts"]):
+            assert ad["NumJobStarts"] >= 2
@@ -0,0 +1,137 @@
+#!/usr/bin/env pytest
+
+# Test that the live job counters, which the schedd uses to count jobs between
+# walks of the job queue when SCHEDD_JOB_COUNTS_AUDIT_INTERVAL is set, agree
+# with what a full walk of the job queue counts after jobs are submitted,
+# held, released and removed.
+#
+# The audit interval is long, so the only walks of the job queue are the
+# ones that a condor_reconfig asks for.  Each walk checks the live counters
+# and logs how many of them were wrong.
+
+import time
+
+from ornithology import (
+    action,
+    Condor,
+)
+
+import logging
+
+
+logger = logging.getLogger(__name__)
+logger.setLevel(logging.DEBUG)
+
+
+NUM_JOBS = 6
+AUDITED = "Audited the live job counters against"
+
+
+@action
+def the_condor(test_dir):
+    with Condor(
+        local_dir=test_dir / "condor",
+        config={
+            "SCHEDD_JOB_COUNTS_AUDIT_INTERVAL": 3600,
+            "SCHEDD_INTERVAL":                  5,
+            "SCHEDD_DEBUG":                     "D_FULLDEBUG",
+            # keep the jobs idle
+            "START":                            False,
+        },
+    ) as the_condor:
+        yield the_condor
+
+
+@action
+def the_log(the_condor):
+    log = the_condor.schedd_log.open()
+    # the first count after the schedd starts walks the job queue
+    assert log.wait(condition=lambda msg: AUDITED in msg.message, timeout=60)
+    return log
+
+
+def wait_for_queue(condor, count):
+    deadline = time.time() + 60
+    while len(condor.query(projection=["ProcId"])) != count:
+        assert time.time() < deadline
+        time.sleep(1)
+
+
+def audit(condor, log):
+    """
+    Ask for a walk of the job queue and return the messages that it logged
+    about the live counters.
+    """
+    start = len(log.messages)
+    p = condor.run_command(["condor_reconfig", "-schedd"])
+    assert p.returncode == 0
+    assert log.wait(condition=lambda msg: AUDITED in msg.message, timeout=60)
+    messages = [msg.message for msg in log.messages[start:]]
+    logger.debug("\n".join(messages))
+    return [m for m in messages if AUDITED in m or "were wrong, correcting them" in m]
+
+
+@action
+def the_handle(the_condor, the_log, path_to_sleep):
+    return the_condor.submit(
+        description={
+            "executable":   path_to_sleep,
+            "arguments":    0,
+        },
+        count=NUM_JOBS,
+    )
+
+
+@action
+def the_submitted(the_condor, the_log, the_handle):
+    wait_for_queue(the_condor, NUM_JOBS)
+    return audit(the_condor, the_log)
+
+
+@action
+def the_held(the_condor, the_log, the_handle, the_submitted):
+    for job_id in the_handle.job_ids[:3]:
+        the_condor.run_command(["condor_hold", str(job_id)])
+    deadline = time.time() + 60
+    while len(the_condor.query(constraint="JobStatus == 5", projection=["ProcId"])) != 3:
+        assert time.time() < deadline
+        time.sleep(1)
+    return audit(the_condor, the_log)
+
+
+@action
+def the_released(the_condor, the_log, the_handle, the_held):
+    the_condor.run_command(["condor_release", str(the_handle.job_ids[0])])
+    deadline = time.time() + 60
+    while len(the_condor.query(constraint="JobStatus == 5", projection=["ProcId"])) != 2:
+        assert time.time() < deadline
+        time.sleep(1)
+    return audit(the_condor, the_log)
+
+
+@action
+def the_removed(the_condor, the_log, the_handle, the_released):
+    # one held job and one idle job
+    for job_id in (the_handle.job_ids[1], the_handle.job_ids[-1]):
+        the_condor.run_command(["condor_rm", str(job_id)])
+    wait_for_queue(the_condor, NUM_JOBS - 2)
+    return audit(the_condor, the_log)
+
+
+def assert_counters_right(messages, num_jobs):
+    assert messages == [f"{AUDITED} {num_jobs} jobs, 0 of them were wrong"]
+
+
+class TestScheddLiveJobCounts:
+
+    def test_after_submit(self, the_submitted):
+        assert_counters_right(the_submitted, NUM_JOBS)
+
+    def test_after_hold(self, the_held):
+        assert_counters_right(the_held, NUM_JOBS)
+
+    def test_after_release(self, the_released):
+        assert_counters_right(the_released, NUM_JOBS)
+
+    def test_after_remove(self, the_removed):
+        assert_counters_right(the_removed, NUM_JOBS - 2)
@@ -0,0 +1,315 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// Convert a ClassAd log (such as the job_queue.log of the schedd) between
+// the text and the binary formats, and measure how long each format takes
+// to replay.
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_mkstemp.h"
+#include "directory_util.h"
+#include "match_prefix.h"
+#include "classad_log.h"
+
+#include <chrono>
+
+static const char *MyName = "condor_convert_classad_log";
+
+static void
+usage(int rval)
+{
+	fprintf(stderr,
+		"Usage: %s [-binary | -text] <input-log> <output-log>\n"
+		"       %s -benchmark [-repeat <n>] <log>\n"
+		"\n"
+		"In the first form, convert the log to the other format, or to the format\n"
+		"given.  The output log must not exist.  Transactions are kept as they are.\n"
+		"\n"
+		"In the second form, copy the log to a temporary file in each format and\n"
+		"load each copy <n> times (default 3), showing the fastest time for each.\n",
+		MyName, MyName);
+	exit(rval);
+}
+
+static FILE *
+open_input(const char *filename, ClassAdBinaryLog &binary, bool &is_binary)
+{
+	FILE *fp = safe_fopen_wrapper_follow(filename, "rb");
+	if ( ! fp) {
+		fprintf(stderr, "Error: can't open %s: %s\n", filename, strerror(errno));
+		return NULL;
+	}
+	is_binary = ClassAdBinaryLog::IsBinaryLog(fp);
+	if (is_binary) {
+		std::string errmsg;
+		if ( ! binary.ReadHeader(fp, errmsg)) {
+			fprintf(stderr, "Error: %s: %s\n", filename, errmsg.c_str());
+			fclose(fp);
+			return NULL;
+		}
+	}
+	return fp;
+}
+
+// copy each record of the input to the output in the output's format.
+// returns the number of records copied or -1
+static long
+convert(FILE *in, ClassAdBinaryLog *in_binary, const char *in_name,
+	FILE *out, ClassAdBinaryLog *out_binary, const char *out_name)
+{
+	if (out_binary && out_binary->WriteHeader(out) < 0) {
+		fprintf(stderr, "Error: write to %s failed: %s\n", out_name, strerror(errno));
+		return -1;
+	}
+
+	long count = 0;
+	long long next_pos = ftell(in);
+	LogRecord *log;
+	while ((log = ReadClassAdLogEntry(in, count+1, DefaultMakeClassAdLogTableEntry, in_binary)) != NULL) {
+		next_pos = ftell(in);
+		int rval = WriteClassAdLogEntry(out, log, out_binary);
+		delete log;
+		if (rval < 0) {
+			fprintf(stderr, "Error: write to %s failed after %ld records: %s\n", out_name, count, strerror(errno));
+			return -1;
+		}
+		++count;
+	}
+	if (ftell(in) != next_pos) {
+		fprintf(stderr, "Warning: %s ends with an incomplete record at byte offset %lld, it was not copied\n",
+			in_name, next_pos);
+	}
+	if (fflush(out) != 0) {
+		fprintf(stderr, "Error: write to %s failed: %s\n", out_name, strerror(errno));
+		return -1;
+	}
+	return count;
+}
+
+static int
+convert_log(const char *in_name, const char *out_name, int want_binary)
+{
+	ClassAdBinaryLog in_binary, out_binary;
+	bool is_binary = false;
+	FILE *in = open_input(in_name, in_binary, is_binary);
+	if ( ! in) {
+		return 1;
+	}
+	bool to_binary = want_binary < 0 ? ! is_binary : want_binary > 0;
+
+	int fd = safe_open_wrapper_follow(out_name, O_WRONLY | O_CREAT | O_EXCL | O_LARGEFILE, 0600);
+	FILE *out = fd >= 0 ? fdopen(fd, "wb") : NULL;
+	if ( ! out) {
+		fprintf(stderr, "Error: can't create %s: %s\n", out_name, strerror(errno));
+		if (fd >= 0) close(fd);
+		fclose(in);
+		return 1;
+	}
+
+	long count = convert(in, is_binary ? &in_binary : NULL, in_name,
+		out, to_binary ? &out_binary : NULL, out_name);
+	fclose(in);
+	if (fclose(out) != 0 && count >= 0) {
+		fprintf(stderr, "Error: write to %s failed: %s\n", out_name, strerror(errno));
+		count = -1;
+	}
+	if (count < 0) {
+		unlink(out_name);
+		return 1;
+	}
+
+	printf("Converted %ld records of %s from %s to %s in %s\n", count, in_name,
+		is_binary ? "binary" : "text", to_binary ? "binary" : "text", out_name);
+	return 0;
+}
+
+// load the log into a table the way that ClassAdLog::InitLogFile does.
+// returns the time that it took in seconds, or a negative number on failure.
+static double
+replay(const char *filename, size_t &ads)
+{
+	HashTable<std::string,ClassAd*> table(hashFunction);
+	ClassAdLogTable<std::string,ClassAd*> la(table);
+	ClassAdBinaryLog binary;
+	bool is_binary = false;
+	unsigned long seq = 0;
+	time_t birthdate = 0;
+	bool is_clean = true, requires_cleaning = false;
+	std::string errmsg;
+
+	auto start = std::chrono::steady_clock::now();
+	FILE *fp = LoadClassAdLog(filename, la, DefaultMakeClassAdLogTableEntry,
+		seq, birthdate, is_clean, requires_cleaning, errmsg, binary, is_binary);
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if ( ! fp) {
+		fprintf(stderr, "Error: %s", errmsg.c_str());
+		elapsed = -1;
+	} else {
+		fclose(fp);
+	}
+
+	ads = table.getNumElements();
+	std::string key;
+	ClassAd *ad;
+	table.startIterations();
+	while (table.iterate(key, ad) == 1) {
+		delete ad;
+	}
+	return elapsed;
+}
+
+static bool
+make_copy(const char *in_name, FILE *in, ClassAdBinaryLog *in_binary, bool to_binary, std::string &copy_name)
+{
+	char *tmp_dir = temp_dir_path();
+	formatstr(copy_name, "%s/%s.XXXXXX", tmp_dir, to_binary ? "binary_log" : "text_log");
+	free(tmp_dir);
+
+	std::vector<char> path(copy_name.begin(), copy_name.end());
+	path.push_back(0);
+	int fd = condor_mkstemp(path.data());
+	if (fd < 0) {
+		fprintf(stderr, "Error: can't create a temporary file %s: %s\n", copy_name.c_str(), strerror(errno));
+		return false;
+	}
+	copy_name = path.data();
+	FILE *out = fdopen(fd, "wb");
+	if ( ! out) {
+		close(fd);
+		unlink(copy_name.c_str());
+		return false;
+	}
+
+	ClassAdBinaryLog out_binary;
+	fseek(in, in_binary ? ClassAdBinaryLog::HEADER_SIZE : 0, SEEK_SET);
+	long count = convert(in, in_binary, in_name, out, to_binary ? &out_binary : NULL, copy_name.c_str());
+	if (fclose(out) != 0 || count < 0) {
+		unlink(copy_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+static int
+benchmark(const char *filename, int repeat)
+{
+	ClassAdBinaryLog in_binary;
+	bool is_binary = false;
+	FILE *in = open_input(filename, in_binary, is_binary);
+	if ( ! in) {
+		return 1;
+	}
+
+	std::string copies[2];
+	for (int ix = 0; ix < 2; ++ix) {
+			// the names are learned again from the start of the input for each copy
+		in_binary.Reset();
+		if ( ! make_copy(filename, in, is_binary ? &in_binary : NULL, ix == 1, copies[ix])) {
+			if (ix) unlink(copies[0].c_str());
+			fclose(in);
+			return 1;
+		}
+	}
+	fclose(in);
+
+	const char *formats[2] = { "text", "binary" };
+	double best[2] = { -1, -1 };
+	size_t ads[2] = { 0, 0 };
+	int rval = 0;
+	for (int pass = 0; pass < repeat && ! rval; ++pass) {
+		for (int ix = 0; ix < 2; ++ix) {
+			struct stat st;
+			double secs = replay(copies[ix].c_str(), ads[ix]);
+			if (secs < 0) {
+				rval = 1;
+				break;
+			}
+			if (best[ix] < 0 || secs < best[ix]) {
+				best[ix] = secs;
+			}
+			if (pass == 0 && stat(copies[ix].c_str(), &st) == 0) {
+				printf("%-6s %12lld bytes %10zu ads\n", formats[ix], (long long)st.st_size, ads[ix]);
+			}
+		}
+	}
+
+	if ( ! rval) {
+		for (int ix = 0; ix < 2; ++ix) {
+			printf("%-6s replay %10.3f seconds (fastest of %d)\n", formats[ix], best[ix], repeat);
+		}
+		if (best[1] > 0) {
+			printf("binary replay is %.2f times as fast as text\n", best[0] / best[1]);
+		}
+	}
+
+	unlink(copies[0].c_str());
+	unlink(copies[1].c_str());
+	return rval;
+}
+
+int
+main(int argc, const char *argv[])
+{
+	int want_binary = -1; // -1 is the other format than the input
+	bool bench = false;
+	int repeat = 3;
+	bool debug = false;
+	std::vector<const char *> files;
+
+	for (int ix = 1; ix < argc; ++ix) {
+		const char *arg = argv[ix];
+		if (is_dash_arg_prefix(arg, "help", 1)) {
+			usage(0);
+		} else if (is_dash_arg_prefix(arg, "binary", 1)) {
+			want_binary = 1;
+		} else if (is_dash_arg_prefix(arg, "text", 1)) {
+			want_binary = 0;
+		} else if (is_dash_arg_prefix(arg, "benchmark", 2)) {
+			bench = true;
+		} else if (is_dash_arg_prefix(arg, "repeat", 1)) {
+			if (++ix >= argc || (repeat = atoi(argv[ix])) < 1) {
+				fprintf(stderr, "Error: -repeat requires a number greater than 0\n");
+				usage(1);
+			}
+		} else if (is_dash_arg_prefix(arg, "debug", 1)) {
+			debug = true;
+		} else if (arg[0] == '-' && arg[1]) {
+			fprintf(stderr, "Error: unknown option %s\n", arg);
+			usage(1);
+		} else {
+			files.push_back(arg);
+		}
+	}
+
+	set_priv_initialize();
+	config();
+	if (debug) {
+		dprintf_set_tool_debug("TOOL", 0);
+	}
+
+	if (bench) {
+		if (files.size() != 1) usage(1);
+		return benchmark(files[0], repeat);
+	}
+	if (files.size() != 2) usage(1);
+	return convert_log(files[0], files[1], want_binary);
+}
@@ -47,7 +47,12 @@
 #include "classad_helpers.h"
 #include "history_utils.h"
 #include "backward_file_reader.h"
+#include "history_index.h"
 #include <fcntl.h>  // for O_BINARY
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 void Usage(const char* name, int iExitCode=1);
 
@@ -115,6 +120,10 @@ static void readHistoryFromDirectory(const char* searchDirectory, const char* co
 static void readHistoryFromSingleFile(bool fileisuserlog, const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr);
 static void readHistoryFromFileOld(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr);
 static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr, bool read_backwards);
+static bool readHistoryFromIndex(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr);
+class HistoryFilePrefetcher;
+static void readHistoryFromPrefetcher(HistoryFilePrefetcher & prefetcher, size_t ix, const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr);
+static bool canUseHistoryIndex();
 static void printJobAds(ClassAdList & jobs);
 static void printJob(ClassAd & ad);
 
@@ -959,6 +968,29 @@ static void readHistoryRemote(classad::ExprTree *constraintExpr, bool want_start
 		ad.Assign(ATTR_PROJECTION, JoinAttrNames(projection, ","));
 	}
 
+	// The job ids and owners are already in the constraint, sending them separately lets
+	// the remote condor_history use the indexes of the history files to find them.
+	if ( ! jobIdFilterInfo.empty()) {
+		std::string ids;
+		for (const auto & item : jobIdFilterInfo) {
+			if ( ! ids.empty()) { ids += ' '; }
+			if (item.jid.proc >= 0) {
+				formatstr_cat(ids, "%d.%d", item.jid.cluster, item.jid.proc);
+			} else {
+				formatstr_cat(ids, "%d", item.jid.cluster);
+			}
+		}
+		ad.Assign(ATTR_HISTORY_JOB_ID_FILTER, ids);
+	}
+	if ( ! ownersList.empty()) {
+		std::string owners;
+		for (const auto & name : ownersList) {
+			if ( ! owners.empty()) { owners += ' '; }
+			owners += name;
+		}
+		ad.Assign(ATTR_HISTORY_OWNER_FILTER, owners);
+	}
+
 	Sock* sock;
 	if (!(sock = daemon.startCommand(history_cmd, Stream::reli_sock, 0))) {
 		fprintf(stderr, "Unable to send history command to remote %s;\n"
@@ -1021,6 +1053,57 @@ static void readHistoryRemote(classad::ExprTree *constraintExpr, bool want_start
 	printFooter();
 }
 
+// A job ad read from a history file by a HistoryFilePrefetcher thread
+struct PrefetchedHistoryAd {
+	std::string banner_line;        // the "*** " line that follows the ad
+	bool at_start {false};          // this is the first ad in the file
+	std::vector<std::string> exprs; // the lines of the ad, in reverse order
+};
+
+// Reads history files backwards on background threads, so that several files are read at once
+// while the ads of the first file are being printed.  The files are given to the threads in order
+// and the ads of each file are handed out in order through a queue that holds a few hundred ads,
+// so reading stays ahead of printing without using much memory.
+//
+// The threads only read lines and split them into ads.  The banners and ads are parsed by the
+// caller, because the classad parser reports errors through globals that are not thread safe.
+class HistoryFilePrefetcher {
+public:
+	HistoryFilePrefetcher(const std::vector<std::string> & files, int threads);
+	~HistoryFilePrefetcher();
+	HistoryFilePrefetcher(const HistoryFilePrefetcher&) = delete;
+	HistoryFilePrefetcher& operator=(const HistoryFilePrefetcher&) = delete;
+
+	// get the next ad of file number ix, last ad in the file first.  returns false when there
+	// are no more ads in the file, and sets error if the file could not be read.
+	bool Next(size_t ix, PrefetchedHistoryAd & ad, int & error);
+	// the caller is done with file number ix, stop reading it
+	void Done(size_t ix);
+
+private:
+	static const size_t MAX_QUEUED_ADS = 256;
+
+	struct FileState {
+		std::deque<PrefetchedHistoryAd> ads;
+		bool finished {false};
+		bool abandoned {false};
+		int error {0};
+	};
+
+	void Run();
+	void ReadFile(size_t ix);
+	bool Emit(size_t ix, PrefetchedHistoryAd & ad);
+
+	std::vector<std::string> m_files;
+	std::vector<FileState> m_state;
+	size_t m_next_file {0};
+	bool m_stop {false};
+	std::mutex m_mutex;
+	std::condition_variable m_ready;  // an ad, or the end of a file, is ready for the caller
+	std::condition_variable m_room;   // there is room in a queue, or reading should stop
+	std::vector<std::thread> m_threads;
+};
+
 static bool AddToClassAdList(void* pv, ClassAd* ad) {
 	ClassAdList * plist = (ClassAdList*)pv;
 	plist->Insert(ad);
@@ -1056,10 +1139,45 @@ static void readHistoryFromFiles(const char* matchFileName, const char* constrai
 	//Debugging code: Display found files in vector order
 	//for(auto file : historyFiles) { fprintf(stdout, "%s\n",file.c_str()); }
 
+	// Files that have an index that covers them can be searched by reading just the matching ads.
+	// The rest are read backwards ahead of time by HISTORY_READ_THREADS threads.
+	std::vector<bool> indexed(historyFiles.size(), false);
+	std::vector<std::string> scanFiles;
+	bool use_index = canUseHistoryIndex();
+	for (size_t ix = 0; ix < historyFiles.size(); ++ix) {
+		const char * file = historyFiles[ix].c_str();
+		if (use_index) {
+			StatInfo si(file);
+			indexed[ix] = si.Error() == SIGood && HistoryIndexCoversFile(file, si.GetFileSize());
+		}
+		if (diagnostic) {
+			fprintf(stderr, "%s history file %s\n", indexed[ix] ? "Searching the index of" : "Reading", file);
+		}
+		if ( ! indexed[ix]) { scanFiles.push_back(historyFiles[ix]); }
+	}
+
+	std::unique_ptr<HistoryFilePrefetcher> prefetcher;
+	int read_threads = param_integer("HISTORY_READ_THREADS", 4, 0);
+	if (backwards && read_threads > 0 && ! scanFiles.empty()) {
+		prefetcher.reset(new HistoryFilePrefetcher(scanFiles, read_threads));
+	}
+
 	// Read files for Ads in order
-	for(const auto &file : historyFiles) {
-		readHistoryFromFileEx(file.c_str(), constraint, constraintExpr, backwards);
+	size_t scan_ix = 0;
+	for (size_t ix = 0; ix < historyFiles.size(); ++ix) {
+		const char * file = historyFiles[ix].c_str();
+		if (indexed[ix]) {
+			// if the file changed since we checked its index, read all of it
+			if ( ! readHistoryFromIndex(file, constraint, constraintExpr)) {
+				readHistoryFromFileEx(file, constraint, constraintExpr, backwards);
+			}
+		} else if (prefetcher) {
+			readHistoryFromPrefetcher(*prefetcher, scan_ix++, file, constraint, constraintExpr);
+		} else {
+			readHistoryFromFileEx(file, constraint, constraintExpr, backwards);
+		}
 	}
+	prefetcher.reset();
 
 	printFooter();
 	return;
@@ -1074,7 +1192,7 @@ static void readHistoryFromFiles(const char* matchFileName, const char* constrai
 *	'*** AdType Key=Value Key=Value' -> 'AdType' return ' Key=value Key=Value'
 *	'*** Key=Value Key=Value' -> 'JOB' return 'Key=Value Key=Value'
 */
-static const char* getAdTypeFromBanner(std::string& banner, std::string& ad_type) {
+static const char* getAdTypeFromBanner(const std::string& banner, std::string& ad_type) {
 	//Get position of equal sign for first key=value pair
 	size_t pos_firstEql = banner.find("=");
 	if (pos_firstEql == std::string::npos) { return NULL; }
@@ -1112,6 +1230,7 @@ static const char* getAdTypeFromBanner(std::string& banner, std::string& ad_type
 }
 
 static bool parseBanner(BannerInfo& info, std::string banner);
+static bool bannerMatchesFilters(const BannerInfo& info, const std::deque<ClusterMatchInfo>& jobIds, const std::deque<std::string>& owners);
 
 //History source files that we expect to only contain 1 instance of a Job Ad
 static bool hasOneJobInstInFile() {
@@ -1338,6 +1457,28 @@ static void printJob(ClassAd & ad)
 	printCount++;
 }
 
+// convert a list of expressions, which is in reverse order because the file is read backwards,
+// into a classad.  returns false and sets bad_expr if an expression can't be parsed.
+//
+static bool insertExprsIntoAd(const std::vector<std::string> & exprs, ClassAd & ad, std::string & bad_expr)
+{
+	ad.rehash(521); // big enough to prevent regrowing hash table
+
+	for (size_t ix = exprs.size(); ix > 0; --ix) {
+		if ( ! ad.Insert(exprs[ix-1])) {
+			bad_expr = exprs[ix-1];
+			return false;
+		}
+	}
+	return true;
+}
+
+static void printMalformedAdWarning(const std::string & bad_expr)
+{
+	dprintf(D_ALWAYS,"condor_history: failed to create classad; bad expr = '%s'\n", bad_expr.c_str());
+	printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
+}
+
 // convert list of expressions into a classad
 //
 static void printJobIfConstraint(std::vector<std::string> & exprs, const char* constraint, ExprTree *constraintExpr, BannerInfo& banner)
@@ -1346,20 +1487,12 @@ static void printJobIfConstraint(std::vector<std::string> & exprs, const char* c
 		return;
 
 	ClassAd ad;
-	ad.rehash(521); // big enough to prevent regrowing hash table
-
-	size_t ix;
-
-	// convert lines vector into classad.
-	while ((ix = exprs.size()) > 0) {
-		if ( ! ad.Insert(exprs[ix-1])) {
-			const char * pexpr = exprs[ix-1].c_str();
-			dprintf(D_ALWAYS,"condor_history: failed to create classad; bad expr = '%s'\n", pexpr);
-			printf( "\t*** Warning: Bad history file; skipping malformed ad(s)\n" );
-			exprs.clear();
-			return;
-		}
-		exprs.pop_back();
+	std::string bad_expr;
+	bool ok = insertExprsIntoAd(exprs, ad, bad_expr);
+	exprs.clear();
+	if ( ! ok) {
+		printMalformedAdWarning(bad_expr);
+		return;
 	}
 	printJobIfConstraint(ad, constraint, constraintExpr, banner);
 }
@@ -1463,15 +1596,19 @@ static bool parseBanner(BannerInfo& info, std::string banner) {
 	//For testing output of banner
 	//fprintf(stdout,"Ad type: %s\n",info.ad_type.c_str());
 	//fprintf(stdout,"Parsed banner info: %s %d.%d | Comp: %ld | Epoch: %d\n",info.owner.c_str(),info.jid.cluster, info.jid.proc, info.completion, info.runId);
+	return bannerMatchesFilters(info, jobIdFilterInfo, ownersList);
+}
 
-	if(jobIdFilterInfo.empty() && ownersList.empty()) { return true; } //If no searches were specified then return true to print job ad
-	else if (info.jid.cluster <= 0 && !jobIdFilterInfo.empty()) { return true; } //If failed to get cluster info and we are searching for job id info return true
-	else if (info.owner.empty() && !ownersList.empty()) { return true; }//If failed to parse owner and we are searching for an owner return true
+// Check the parsed banner info against the job ids and owners that we are searching for
+static bool bannerMatchesFilters(const BannerInfo& info, const std::deque<ClusterMatchInfo>& jobIds, const std::deque<std::string>& owners) {
+	if(jobIds.empty() && owners.empty()) { return true; } //If no searches were specified then return true to print job ad
+	else if (info.jid.cluster <= 0 && !jobIds.empty()) { return true; } //If failed to get cluster info and we are searching for job id info return true
+	else if (info.owner.empty() && !owners.empty()) { return true; }//If failed to parse owner and we are searching for an owner return true
 
 	//Check to see if cluster exists in matching job info
-	for(auto& item : jobIdFilterInfo) { if(info.jid.cluster == item.jid.cluster){ return true; } }
+	for(auto& item : jobIds) { if(info.jid.cluster == item.jid.cluster){ return true; } }
 	//Check to see if owner is being searched for
-	for(auto& name : ownersList) { if(strcasecmp(info.owner.c_str(),name.c_str()) == MATCH){ return true; } }
+	for(auto& name : owners) { if(strcasecmp(info.owner.c_str(),name.c_str()) == MATCH){ return true; } }
 	//If here then no match
 	return false;
 }
@@ -1571,6 +1708,363 @@ static void readHistoryFromFileEx(const char *JobHistoryFileName, const char* co
 	reader.Close();
 }
 
+// add a line read from a history file to the expressions of an ad, unless it is empty or a comment
+static void addHistoryLine(std::vector<std::string> & exprs, const std::string & line)
+{
+	if ( ! line.empty()) {
+		const char * psz = line.c_str();
+		while (*psz == ' ' || *psz == '\t') ++psz;
+		if (*psz != '#') {
+			exprs.push_back(line);
+		}
+	}
+}
+
+static bool limitsReached()
+{
+	return (specifiedMatch > 0 && matchCount >= specifiedMatch) || (maxAds > 0 && adCount >= maxAds);
+}
+
+// The sidecar index written by the schedd or startd (see HISTORY_INDEX) has the job id, completion date
+// and owner of each ad, so when we are searching for job ids or owners we only need to read the ads
+// that might match.  Epoch files and ads of other types are not indexed.
+static bool canUseHistoryIndex()
+{
+	return backwards && hasOneJobInstInFile() &&
+		( ! jobIdFilterInfo.empty() || ! ownersList.empty()) &&
+		(filterAdTypes.contains("ALL") || filterAdTypes.contains("JOB"));
+}
+
+// Narrow lo and hi to the range of completion dates that the constraint can match, using its
+// top level CompletionDate comparisons with integers.  Other clauses are ignored, so the range
+// may be wider than what the constraint actually matches, but never narrower.
+static void getCompletionDateRange(classad::ExprTree * tree, long long & lo, long long & hi)
+{
+	tree = SkipExprParens(tree);
+	if ( ! tree || tree->GetKind() != classad::ExprTree::OP_NODE) {
+		return;
+	}
+	classad::Operation::OpKind op;
+	classad::ExprTree *t1, *t2, *t3;
+	((classad::Operation*)tree)->GetComponents(op, t1, t2, t3);
+	if (op == classad::Operation::LOGICAL_AND_OP) {
+		getCompletionDateRange(t1, lo, hi);
+		getCompletionDateRange(t2, lo, hi);
+		return;
+	}
+
+	std::string attr;
+	classad::Value val;
+	long long date = 0;
+	bool attr_first = ExprTreeIsAttrRef(SkipExprParens(t1), attr);
+	if ( ! attr_first && ! ExprTreeIsAttrRef(SkipExprParens(t2), attr)) {
+		return;
+	}
+	if (strcasecmp(attr.c_str(), ATTR_COMPLETION_DATE) != MATCH ||
+		! ExprTreeIsLiteral(SkipExprParens(attr_first ? t2 : t1), val) || ! val.IsIntegerValue(date)) {
+		return;
+	}
+	if ( ! attr_first) {
+		// n < CompletionDate is CompletionDate > n
+		switch (op) {
+		case classad::Operation::LESS_THAN_OP:        op = classad::Operation::GREATER_THAN_OP; break;
+		case classad::Operation::LESS_OR_EQUAL_OP:    op = classad::Operation::GREATER_OR_EQUAL_OP; break;
+		case classad::Operation::GREATER_THAN_OP:     op = classad::Operation::LESS_THAN_OP; break;
+		case classad::Operation::GREATER_OR_EQUAL_OP: op = classad::Operation::LESS_OR_EQUAL_OP; break;
+		default: break;
+		}
+	}
+	switch (op) {
+	case classad::Operation::LESS_THAN_OP:        hi = std::min(hi, date - 1); break;
+	case classad::Operation::LESS_OR_EQUAL_OP:    hi = std::min(hi, date); break;
+	case classad::Operation::GREATER_THAN_OP:     lo = std::max(lo, date + 1); break;
+	case classad::Operation::GREATER_OR_EQUAL_OP: lo = std::max(lo, date); break;
+	case classad::Operation::EQUAL_OP:
+	case classad::Operation::META_EQUAL_OP:
+		lo = std::max(lo, date);
+		hi = std::min(hi, date);
+		break;
+	default: break;
+	}
+}
+
+// Read the ads of a history file that its index says might match, last ad first.  This gives the
+// same results as readHistoryFromFileEx: ads that don't match are still checked against the completion
+// dates of the jobs we are searching for, using the values from the index instead of their banner lines.
+// Returns false without reading anything if the index doesn't cover the whole file.
+static bool readHistoryFromIndex(const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr)
+{
+	if (limitsReached()) {
+		return true;
+	}
+
+	int fd = safe_open_wrapper_follow(JobHistoryFileName, O_RDONLY | O_LARGEFILE, 0);
+	if (fd < 0) {
+		fprintf(stderr,"Error opening history file %s: %s\n", JobHistoryFileName, strerror(errno));
+		exit(1);
+	}
+
+	struct stat si;
+	HistoryIndexHeader hdr;
+	std::vector<HistoryIndexRecord> records;
+	if (fstat(fd, &si) < 0 || ! ReadHistoryIndex(JobHistoryFileName, si.st_size, hdr, records) ||
+		hdr.covered_from != 0 ||
+		(records.empty() ? 0 : records.back().offset + records.back().length) != si.st_size) {
+		close(fd);
+		return false;
+	}
+
+	std::set<uint32_t> owner_hashes;
+	for (const auto & name : ownersList) {
+		owner_hashes.insert(HistoryIndexOwnerHash(name.c_str()));
+	}
+
+	// When none of the completion dates in the file are in the range that the constraint can match,
+	// none of its ads need to be read.  The records are still walked to check the completion dates
+	// of the jobs we are searching for.  Ads read for -since might stop the search, so don't skip then.
+	bool skip_file = false;
+	if (constraintExpr && ! sinceExpr) {
+		long long lo = LLONG_MIN, hi = LLONG_MAX;
+		getCompletionDateRange(constraintExpr, lo, hi);
+		skip_file = true;
+		for (const auto & rec : records) {
+			// -1 means that the completion date was not known when the ad was written
+			if (rec.completion_date < 0 || (rec.completion_date >= lo && rec.completion_date <= hi)) {
+				skip_file = false;
+				break;
+			}
+		}
+		if (skip_file && diagnostic) {
+			fprintf(stderr, "Skipping history file %s, no completion dates in [%lld,%lld]\n",
+				JobHistoryFileName, lo, hi);
+		}
+	}
+
+	BannerInfo curr_banner;
+	std::string buf, line, banner_line;
+	std::vector<std::string> exprs;
+	for (size_t ix = records.size(); ix > 0; --ix) {
+		const HistoryIndexRecord & rec = records[ix-1];
+
+		BannerInfo rec_banner;
+		rec_banner.ad_type = "JOB";
+		if (rec.cluster > 0) { rec_banner.jid.cluster = rec.cluster; }
+		if (rec.proc >= 0) { rec_banner.jid.proc = rec.proc; }
+		rec_banner.completion = rec.completion_date;
+
+		// the same test as parseBanner, except that owners are compared by hash
+		bool may_match = (jobIdFilterInfo.empty() && ownersList.empty()) || owner_hashes.count(rec.owner_hash);
+		if ( ! may_match && ! jobIdFilterInfo.empty()) {
+			may_match = rec_banner.jid.cluster <= 0;
+			for (const auto & item : jobIdFilterInfo) {
+				if (item.jid.cluster == rec_banner.jid.cluster) { may_match = true; break; }
+			}
+		}
+		if (skip_file) { may_match = false; }
+
+		bool read_ad = false;
+		exprs.clear();
+		if (may_match) {
+			buf.resize(rec.length);
+			if (lseek(fd, rec.offset, SEEK_SET) < 0 || full_read(fd, &buf[0], rec.length) != (ssize_t)rec.length) {
+				fprintf(stderr,"Error reading history file %s: %s\n", JobHistoryFileName, strerror(errno));
+				exit(1);
+			}
+			// the ad is followed by its banner line, keep the lines in reverse order like readHistoryFromFileEx
+			banner_line.clear();
+			size_t end = buf.size();
+			while (end > 0) {
+				size_t begin = buf.rfind('\n', end - 1);
+				begin = (begin == std::string::npos) ? 0 : begin + 1;
+				line.assign(buf, begin, end - begin);
+				while ( ! line.empty() && (line.back() == '\n' || line.back() == '\r')) { line.pop_back(); }
+				if (banner_line.empty() && starts_with(line.c_str(), "*** ")) {
+					banner_line = line;
+				} else if ( ! banner_line.empty()) {
+					addHistoryLine(exprs, line);
+				}
+				end = begin;
+			}
+			// the owner hash matched, but it might be someone else's ad
+			read_ad = parseBanner(curr_banner, banner_line);
+		} else {
+			curr_banner = rec_banner;
+		}
+
+		if (read_ad && ! exprs.empty()) {
+			printJobIfConstraint(exprs, constraint, constraintExpr, curr_banner);
+		} else if (ix > 1 && cluster > 0 && checkMatchJobIdsFound(curr_banner, NULL, true)) {
+			// readHistoryFromFileEx does not check the first ad in the file unless it reads it
+			break;
+		}
+
+		if (limitsReached() || abort_transfer) {
+			break;
+		}
+	}
+
+	close(fd);
+	return true;
+}
+
+HistoryFilePrefetcher::HistoryFilePrefetcher(const std::vector<std::string> & files, int threads)
+	: m_files(files)
+	, m_state(files.size())
+{
+	int count = (int)std::min(files.size(), (size_t)threads);
+	for (int ix = 0; ix < count; ++ix) {
+		m_threads.emplace_back(&HistoryFilePrefetcher::Run, this);
+	}
+}
+
+HistoryFilePrefetcher::~HistoryFilePrefetcher()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stop = true;
+	}
+	m_room.notify_all();
+	for (auto & thread : m_threads) {
+		thread.join();
+	}
+}
+
+bool HistoryFilePrefetcher::Next(size_t ix, PrefetchedHistoryAd & ad, int & error)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	FileState & state = m_state[ix];
+	m_ready.wait(lock, [&state] { return ! state.ads.empty() || state.finished; });
+	if (state.ads.empty()) {
+		error = state.error;
+		return false;
+	}
+	bool was_full = state.ads.size() >= MAX_QUEUED_ADS;
+	ad = std::move(state.ads.front());
+	state.ads.pop_front();
+	if (was_full) {
+		m_room.notify_all();
+	}
+	return true;
+}
+
+void HistoryFilePrefetcher::Done(size_t ix)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_state[ix].abandoned = true;
+		m_state[ix].ads.clear();
+	}
+	m_room.notify_all();
+}
+
+void HistoryFilePrefetcher::Run()
+{
+	for (;;) {
+		size_t ix;
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			if (m_stop || m_next_file >= m_files.size()) {
+				return;
+			}
+			ix = m_next_file++;
+		}
+		ReadFile(ix);
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_state[ix].finished = true;
+		}
+		m_ready.notify_one();
+	}
+}
+
+// queue an ad for the caller.  returns false if the file is no longer wanted.
+bool HistoryFilePrefetcher::Emit(size_t ix, PrefetchedHistoryAd & ad)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	FileState & state = m_state[ix];
+	m_room.wait(lock, [this, &state] { return state.ads.size() < MAX_QUEUED_ADS || state.abandoned || m_stop; });
+	if (state.abandoned || m_stop) {
+		return false;
+	}
+	state.ads.push_back(std::move(ad));
+	lock.unlock();
+	m_ready.notify_one();
+	return true;
+}
+
+// the same reading as readHistoryFromFileEx, except that the ads are handed to the caller
+void HistoryFilePrefetcher::ReadFile(size_t ix)
+{
+	BackwardFileReader reader(m_files[ix], O_RDONLY);
+	if (reader.LastError()) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_state[ix].error = reader.LastError();
+		return;
+	}
+
+	std::string line;
+	std::string banner_line;
+	while (reader.PrevLine(line)) {
+		if (starts_with(line.c_str(), "*** ")) {
+			banner_line = line;
+			break;
+		}
+	}
+
+	PrefetchedHistoryAd ad;
+	ad.banner_line = banner_line;
+	while (reader.PrevLine(line)) {
+		if (starts_with(line.c_str(), "*** ")) {
+			if ( ! Emit(ix, ad)) {
+				return;
+			}
+			ad = PrefetchedHistoryAd();
+			ad.banner_line = line;
+		} else {
+			addHistoryLine(ad.exprs, line);
+		}
+	}
+
+	if ( ! ad.exprs.empty()) {
+		ad.at_start = true;
+		Emit(ix, ad);
+	}
+	reader.Close();
+}
+
+// Print the ads of a history file that is being read by a HistoryFilePrefetcher.  This does what the
+// loop in readHistoryFromFileEx does, with ads that have already been read.
+static void readHistoryFromPrefetcher(HistoryFilePrefetcher & prefetcher, size_t ix, const char *JobHistoryFileName, const char* constraint, ExprTree *constraintExpr)
+{
+	if (limitsReached()) {
+		prefetcher.Done(ix);
+		return;
+	}
+
+	PrefetchedHistoryAd rec;
+	BannerInfo curr_banner;
+	int error = 0;
+	while (prefetcher.Next(ix, rec, error)) {
+		bool read_ad = parseBanner(curr_banner, rec.banner_line);
+
+		if (read_ad && ! rec.exprs.empty()) {
+			printJobIfConstraint(rec.exprs, constraint, constraintExpr, curr_banner);
+		} else if ( ! rec.at_start && cluster > 0 && checkMatchJobIdsFound(curr_banner, NULL, true)) {
+			break;
+		}
+
+		if (limitsReached() || abort_transfer) {
+			break;
+		}
+	}
+	prefetcher.Done(ix);
+
+	if (error) {
+		fprintf(stderr,"Error opening history file %s: %s\n", JobHistoryFileName, strerror(error));
+		exit(1);
+	}
+}
+
 //PRAGMA_REMIND("tj: TODO fix to handle summary print format")
 static int set_print_mask_from_stream(
 	AttrListPrintMask & print_mask,
@@ -29,7 +29,7 @@ const char *EMPTY_CLASSAD_TYPE_NAME = "(empty)"; // normally in classad_log.h/cp
 #else
 #include "condor_common.h"
 #include "condor_io.h"
-extern const char *EMPTY_CLASSAD_TYPE_NAME; // defined in classad_log.cpp
+#include "classad_log.h"
 #endif
 
 #include "ClassAdLogEntry.h"
@@ -61,6 +61,9 @@ ClassAdLogParser::ClassAdLogParser()
 	m_close_fp = true;
 	nextOffset = 0;
 	job_queue_name[0] = '\0';
+#ifndef _NO_CONDOR_
+	m_binary = -1;
+#endif
 }
 
 ClassAdLogParser::~ClassAdLogParser()
@@ -131,6 +134,9 @@ ClassAdLogParser::closeFile() {
 		fclose(log_fp);
 	}
 	log_fp = NULL;
+#ifndef _NO_CONDOR_
+	m_binary = -1;
+#endif
 	return FILE_OP_SUCCESS;
 }
 
@@ -158,6 +164,15 @@ ClassAdLogParser::readLogEntry(int &op_type)
 {
 	int	rval;
 
+#ifndef _NO_CONDOR_
+	if (log_fp && m_binary < 0) {
+		m_binary = ClassAdBinaryLog::IsBinaryLog(log_fp) ? 1 : 0;
+	}
+	if (log_fp && m_binary > 0) {
+		return readBinaryLogEntry(op_type);
+	}
+#endif
+
     // move to the current offset
     if (log_fp && fseek(log_fp, nextOffset, SEEK_SET) != 0) {
         closeFile();
@@ -286,6 +301,104 @@ ClassAdLogParser::readLogEntry(int &op_type)
 	return FILE_READ_SUCCESS;
 }
 
+#ifndef _NO_CONDOR_
+FileOpErrCode
+ClassAdLogParser::readBinaryLogEntry(int &op_type)
+{
+	std::string errmsg;
+	if ( ! m_binary_log.CheckHeader(log_fp, errmsg)) {
+		dprintf(D_ALWAYS, "ClassAdLogParser: %s: %s\n", job_queue_name, errmsg.c_str());
+		closeFile();
+		return FILE_READ_ERROR;
+	}
+
+		// offset 0 is the start of the records, which follow the header
+	long offset = nextOffset < ClassAdBinaryLog::HEADER_SIZE ? ClassAdBinaryLog::HEADER_SIZE : nextOffset;
+	if (fseek(log_fp, offset, SEEK_SET) != 0) {
+		closeFile();
+		return FILE_READ_EOF;
+	}
+
+	const ConstructLogEntry &ctor = DefaultMakeClassAdLogTableEntry;
+	ClassAdBinaryLog::ReadStatus status;
+	LogRecord *log = m_binary_log.Read(log_fp, ctor, status, op_type);
+	if ( ! log && status == ClassAdBinaryLog::READ_UNKNOWN_NAME) {
+			// we started in the middle of the log, learn the names that were
+			// defined before this record and try again
+		if (m_binary_log.Rescan(log_fp, offset, ctor)) {
+			log = m_binary_log.Read(log_fp, ctor, status, op_type);
+		}
+	}
+	if ( ! log) {
+		if (status == ClassAdBinaryLog::READ_CORRUPT || status == ClassAdBinaryLog::READ_UNKNOWN_NAME) {
+				// as for a text log, a bad record is fatal if it is in a closed
+				// transaction, otherwise it is the end of the log
+			int op;
+			fseek(log_fp, offset + 1, SEEK_SET);
+			while (m_binary_log.Skip(log_fp, op)) {
+				if (op == CondorLogOp_EndTransaction) {
+					dprintf(D_ALWAYS, "Bad record with op=%d in corrupt logfile\n", op_type);
+					return FILE_FATAL_ERROR;
+				}
+			}
+			curCALogEntry.offset = nextOffset;
+		}
+		closeFile();
+		return FILE_READ_EOF;
+	}
+
+	lastCALogEntry.init(curCALogEntry.op_type);
+	lastCALogEntry = curCALogEntry;
+	curCALogEntry.init(op_type);
+	curCALogEntry.offset = nextOffset;
+
+	std::string buf;
+	switch (op_type) {
+	case CondorLogOp_LogHistoricalSequenceNumber: {
+		LogHistoricalSequenceNumber *hist = (LogHistoricalSequenceNumber *)log;
+		formatstr(buf, "%lu", hist->get_historical_sequence_number());
+		curCALogEntry.key = strdup(buf.c_str());
+		curCALogEntry.name = strdup("CreationTimestamp");
+		formatstr(buf, "%lu", (unsigned long)hist->get_timestamp());
+		curCALogEntry.value = strdup(buf.c_str());
+		break;
+	}
+	case CondorLogOp_NewClassAd:
+		curCALogEntry.key = strdup(log->get_key());
+		curCALogEntry.mytype = strdup(((LogNewClassAd *)log)->get_mytype());
+		curCALogEntry.targettype = strdup("");
+		break;
+	case CondorLogOp_DestroyClassAd:
+		curCALogEntry.key = strdup(log->get_key());
+		break;
+	case CondorLogOp_SetAttribute:
+		curCALogEntry.key = strdup(log->get_key());
+		curCALogEntry.name = strdup(((LogSetAttribute *)log)->get_name());
+		curCALogEntry.value = strdup(((LogSetAttribute *)log)->get_value());
+		break;
+	case CondorLogOp_DeleteAttribute:
+		curCALogEntry.key = strdup(log->get_key());
+		curCALogEntry.name = strdup(((LogDeleteAttribute *)log)->get_name());
+		break;
+	case CondorLogOp_EndTransaction: {
+		const char *comment = ((LogEndTransaction *)log)->get_comment();
+		if (comment) {
+			curCALogEntry.value = strdup(comment);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	delete log;
+
+	nextOffset = ftell(log_fp);
+	curCALogEntry.next_offset = nextOffset;
+
+	return FILE_READ_SUCCESS;
+}
+#endif
+
 /*!
 	\warning each pointer must be freed by a calling funtion
 */
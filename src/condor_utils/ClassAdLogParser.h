@@ -26,6 +26,7 @@
 #else
 #include "condor_common.h"
 #include "condor_io.h"
+#include "classad_log_binary.h"
 #endif
 
 enum ParserErrCode {    PARSER_FAILURE,
@@ -46,7 +47,8 @@ enum FileOpErrCode {    FILE_OPEN_ERROR,
 //! ClassAdLogParser
 /*! \brief Parser for ClassAd Log file
  *
- *  It actually reads and parses ClassAd Log file (job_queue.log)
+ *  It actually reads and parses ClassAd Log file (job_queue.log),
+ *  in either the text or the binary format.
  */
 class ClassAdLogParser
 {
@@ -121,6 +123,9 @@ private:
 	int 	readDeleteAttributeBody(FILE *fp);
 	int 	readBeginTransactionBody(FILE *fp);
 	int 	readEndTransactionBody(FILE *fp);
+#ifndef _NO_CONDOR_
+	FileOpErrCode readBinaryLogEntry(int &op_type);
+#endif
 		
 		//
 		// data
@@ -133,6 +138,11 @@ private:
 
 	FILE 	*log_fp;
 	bool	m_close_fp;	// are we responsible for closing log_fp?
+#ifndef _NO_CONDOR_
+	int		m_binary;	// format of log_fp: 1 binary, 0 text, -1 not known yet
+		// the names of the binary log, kept when the same log is opened again
+	ClassAdBinaryLog m_binary_log;
+#endif
 };
 
 #endif /* _CLASSADLOGPARSER_H_ */
@@ -170,8 +170,6 @@ ClassAdLogProber::probe(ClassAdLogEntry *curCALogEntry,
 	cur_probed_mod_time = filestat.st_mtime;
 	cur_probed_size = filestat.st_size;
 
-	ClassAdLogParser caLogParser;
-	
 	caLogParser.setFilePointer(job_queue_fp);
 	caLogParser.setNextOffset(0);
 	st = caLogParser.readLogEntry(op_type);
@@ -28,6 +28,9 @@
 #include "condor_common.h"
 #endif
 
+#include "ClassAdLogEntry.h"
+#include "ClassAdLogParser.h"
+
 enum ProbeResultType {  PROBE_ERROR, 
 						PROBE_FATAL_ERROR,
 						NO_CHANGE, 
@@ -91,6 +94,9 @@ private:
 	long int		cur_probed_creation_time;  //!< creation time of cur file 
 
 	ClassAdLogEntry	lastCALogEntry;		//!< last command (ClassAd Log Entry)
+		// kept from one probe to the next, so that a binary log isn't
+		// rescanned from the start every time
+	ClassAdLogParser caLogParser;
 
 };
 
@@ -33,6 +33,7 @@ KeyCacheEntry::KeyCacheEntry( const std::string& id_param, const std::string& ad
 	, _lease_interval(lease_interval)
 	, _lease_expiration(0)
 	, _lingering(false)
+	, _restored(false)
 {
 	if (_keys.empty()) {
 		_preferred_protocol = CONDOR_NO_PROTOCOL;
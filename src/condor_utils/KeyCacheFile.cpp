@@ -0,0 +1,487 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_attributes.h"
+#include "condor_base64.h"
+#include "condor_crypt.h"
+#include "condor_uid.h"
+#include "secure_file.h"
+#include "condor_fsync.h"
+#include "KeyCacheFile.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <memory>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+// The file is
+//    magic    8 bytes, also the additional authenticated data
+//    iv       12 bytes
+//    ciphertext
+//    tag      16 bytes
+// The plaintext has one line per session, each a ClassAd in the form
+// [ SessionId = "..."; Expiration = ...; SessionLease = ...; PreferredProtocol = ...;
+//   LastPeerVersion = "..."; Keys = { "protocol,duration,base64 key", ... }; Policy = [ ... ] ]
+
+#define KEYCACHE_FILE_MAGIC "HTCSESS1"
+#define KEYCACHE_FILE_MAGIC_LEN 8
+#define KEYCACHE_FILE_IV_LEN 12
+#define KEYCACHE_FILE_TAG_LEN 16
+
+namespace {
+
+// a string that is wiped when it goes away, for plaintext that holds keys
+struct wiped_string : public std::string {
+	~wiped_string() { if ( ! empty()) { OPENSSL_cleanse(&(*this)[0], size()); } }
+};
+
+// Read the key the file is encrypted with, creating the key file if create
+// is true and it does not exist.
+bool
+get_file_key(const char *key_file, bool create, unsigned char *key)
+{
+	void *buf = nullptr;
+	size_t len = 0;
+	if (read_secure_file(key_file, &buf, &len, true)) {
+		bool ok = len >= KEYCACHE_FILE_KEY_LEN;
+		if (ok) {
+			memcpy(key, buf, KEYCACHE_FILE_KEY_LEN);
+		} else {
+			dprintf(D_ALWAYS, "Session cache key file %s is too short\n", key_file);
+		}
+		OPENSSL_cleanse(buf, len);
+		free(buf);
+		return ok;
+	}
+	if ( ! create) {
+		dprintf(D_ALWAYS, "Failed to read session cache key file %s\n", key_file);
+		return false;
+	}
+
+		// Create the file exclusively, so that daemons starting at the
+		// same time do not overwrite each other's key.
+	int fd = -1;
+	{
+#ifdef WIN32
+		const int open_flags = O_WRONLY | O_CREAT | O_EXCL | O_BINARY;
+#else
+		const int open_flags = O_WRONLY | O_CREAT | O_EXCL;
+#endif
+		TemporaryPrivSentry sentry(PRIV_ROOT);
+		fd = safe_open_wrapper_follow(key_file, open_flags, 0600);
+	}
+	if (fd < 0) {
+		dprintf(D_ALWAYS, "Failed to create session cache key file %s: %s\n", key_file, strerror(errno));
+		return false;
+	}
+	close(fd);
+
+	std::unique_ptr<unsigned char, decltype(&free)> random_key(Condor_Crypt_Base::randomKey(KEYCACHE_FILE_KEY_LEN), &free);
+	if ( ! random_key || ! write_secure_file(key_file, random_key.get(), KEYCACHE_FILE_KEY_LEN, true)) {
+		dprintf(D_ALWAYS, "Failed to write session cache key file %s\n", key_file);
+		return false;
+	}
+	memcpy(key, random_key.get(), KEYCACHE_FILE_KEY_LEN);
+	OPENSSL_cleanse(random_key.get(), KEYCACHE_FILE_KEY_LEN);
+	dprintf(D_ALWAYS, "Created session cache key file %s\n", key_file);
+	return true;
+}
+
+} // namespace
+
+
+bool
+EncryptKeyCacheData(const unsigned char *key, const std::string &plaintext, std::string &output)
+{
+	std::unique_ptr<unsigned char, decltype(&free)> iv(Condor_Crypt_Base::randomKey(KEYCACHE_FILE_IV_LEN), &free);
+	std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+	if ( ! iv || ! ctx) {
+		return false;
+	}
+
+	output.assign(KEYCACHE_FILE_MAGIC, KEYCACHE_FILE_MAGIC_LEN);
+	output.append((const char *)iv.get(), KEYCACHE_FILE_IV_LEN);
+	size_t header_len = output.size();
+	output.resize(header_len + plaintext.size() + KEYCACHE_FILE_TAG_LEN);
+	unsigned char *out = (unsigned char *)&output[0];
+
+	int len = 0, final_len = 0;
+	if (1 != EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL) ||
+		1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, KEYCACHE_FILE_IV_LEN, NULL) ||
+		1 != EVP_EncryptInit_ex(ctx.get(), NULL, NULL, key, iv.get()) ||
+		1 != EVP_EncryptUpdate(ctx.get(), NULL, &len, out, KEYCACHE_FILE_MAGIC_LEN) ||
+		1 != EVP_EncryptUpdate(ctx.get(), out + header_len, &len, (const unsigned char *)plaintext.data(), (int)plaintext.size()) ||
+		1 != EVP_EncryptFinal_ex(ctx.get(), out + header_len + len, &final_len) ||
+		len + final_len != (int)plaintext.size() ||
+		1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, KEYCACHE_FILE_TAG_LEN, out + header_len + plaintext.size()))
+	{
+		return false;
+	}
+	return true;
+}
+
+bool
+DecryptKeyCacheData(const unsigned char *key, const unsigned char *data, size_t size, std::string &plaintext)
+{
+	const size_t header_len = KEYCACHE_FILE_MAGIC_LEN + KEYCACHE_FILE_IV_LEN;
+	if (size < header_len + KEYCACHE_FILE_TAG_LEN || memcmp(data, KEYCACHE_FILE_MAGIC, KEYCACHE_FILE_MAGIC_LEN) != 0 ||
+		size - header_len - KEYCACHE_FILE_TAG_LEN > INT_MAX) {
+		return false;
+	}
+	int cipher_len = (int)(size - header_len - KEYCACHE_FILE_TAG_LEN);
+
+	std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+	if ( ! ctx) {
+		return false;
+	}
+	plaintext.resize(cipher_len);
+	unsigned char *out = (unsigned char *)&plaintext[0];
+	unsigned char tag[KEYCACHE_FILE_TAG_LEN];
+	memcpy(tag, data + header_len + cipher_len, KEYCACHE_FILE_TAG_LEN);
+
+	int len = 0, final_len = 0;
+	if (1 != EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL) ||
+		1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, KEYCACHE_FILE_IV_LEN, NULL) ||
+		1 != EVP_DecryptInit_ex(ctx.get(), NULL, NULL, key, data + KEYCACHE_FILE_MAGIC_LEN) ||
+		1 != EVP_DecryptUpdate(ctx.get(), NULL, &len, data, KEYCACHE_FILE_MAGIC_LEN) ||
+		1 != EVP_DecryptUpdate(ctx.get(), out, &len, data + header_len, cipher_len) ||
+		1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, KEYCACHE_FILE_TAG_LEN, tag) ||
+		1 != EVP_DecryptFinal_ex(ctx.get(), out + len, &final_len))
+	{
+		return false;
+	}
+	plaintext.resize(len + final_len);
+	return true;
+}
+
+void
+UnparseKeyCacheEntry(const KeyCacheEntry &entry, std::string &line)
+{
+	classad::ClassAd ad;
+	ad.InsertAttr("SessionId", entry.id());
+	ad.InsertAttr("Expiration", (long long)entry.lifetimeExpiration());
+	ad.InsertAttr("SessionLease", entry.leaseInterval());
+	ad.InsertAttr("PreferredProtocol", (int)entry.getPreferredProtocol());
+	ad.InsertAttr("LastPeerVersion", entry.getLastPeerVersion());
+
+	std::vector<classad::ExprTree *> keys;
+	for (const auto &key : entry.keys()) {
+		char *b64 = condor_base64_encode(key.getKeyData(), (int)key.getKeyLength(), false);
+		wiped_string str;
+		formatstr(str, "%d,%d,%s", (int)key.getProtocol(), key.getDuration(), b64 ? b64 : "");
+		if (b64) {
+			OPENSSL_cleanse(b64, strlen(b64));
+			free(b64);
+		}
+		keys.push_back(classad::Literal::MakeString(str));
+	}
+	ad.Insert("Keys", classad::ExprList::MakeExprList(keys));
+	ad.Insert("Policy", entry.policy()->Copy());
+
+	classad::ClassAdUnParser unparser;
+	unparser.Unparse(line, &ad);
+}
+
+std::unique_ptr<KeyCacheEntry>
+ParseKeyCacheEntry(const char *line)
+{
+	classad::ClassAdParser parser;
+	std::unique_ptr<classad::ClassAd> ad(parser.ParseClassAd(line));
+	if ( ! ad) {
+		return nullptr;
+	}
+
+	std::string sid, peer_version;
+	long long expiration = 0;
+	int lease = 0, preferred = 0;
+	classad::ExprList *key_list = nullptr;
+	classad::ClassAd *policy = nullptr;
+	if ( ! ad->EvaluateAttrString("SessionId", sid) ||
+		! ad->EvaluateAttrNumber("Expiration", expiration) ||
+		! ad->EvaluateAttrNumber("SessionLease", lease) ||
+		! ad->EvaluateAttrNumber("PreferredProtocol", preferred) ||
+		! (key_list = dynamic_cast<classad::ExprList *>(ad->Lookup("Keys"))) ||
+		! (policy = dynamic_cast<classad::ClassAd *>(ad->Lookup("Policy"))))
+	{
+		return nullptr;
+	}
+	ad->EvaluateAttrString("LastPeerVersion", peer_version);
+
+	std::vector<KeyInfo> keys;
+	for (auto *expr : *key_list) {
+		auto *lit = dynamic_cast<classad::StringLiteral *>(expr);
+		if ( ! lit) {
+			return nullptr;
+		}
+		const char *cstr = lit->getCString();
+		int protocol = 0, duration = 0, pos = 0;
+		if (sscanf(cstr, "%d,%d,%n", &protocol, &duration, &pos) != 2 || pos == 0 ||
+			protocol <= CONDOR_NO_PROTOCOL || protocol > CONDOR_AESGCM) {
+			return nullptr;
+		}
+		unsigned char *key_data = nullptr;
+		int key_len = 0;
+		condor_base64_decode(cstr + pos, &key_data, &key_len, false);
+		if ( ! key_data || key_len <= 0) {
+			free(key_data);
+			return nullptr;
+		}
+		keys.emplace_back(key_data, key_len, (Protocol)protocol, duration);
+		OPENSSL_cleanse(key_data, key_len);
+		free(key_data);
+	}
+
+	auto entry = std::make_unique<KeyCacheEntry>(sid, "", keys, *policy, (time_t)expiration, lease);
+	// the copy still points at the ad it was nested in
+	entry->policy()->SetParentScope(nullptr);
+	entry->setPreferredProtocol((Protocol)preferred);
+	entry->setLastPeerVersion(peer_version);
+	entry->setRestoredFlag(true);
+	return entry;
+}
+
+
+KeyCacheFileWriter::~KeyCacheFileWriter()
+{
+	if (m_fd >= 0) {
+		close(m_fd);
+		unlink(m_tmp_file.c_str());
+	}
+	if ( ! m_plaintext.empty()) {
+		OPENSSL_cleanse(&m_plaintext[0], m_plaintext.size());
+	}
+	OPENSSL_cleanse(m_key, sizeof(m_key));
+}
+
+bool
+KeyCacheFileWriter::Prepare(const KeyCache &cache, const char *file, const char *key_file, size_t max_size)
+{
+	ASSERT(m_fd < 0 && m_file.empty());
+	if ( ! get_file_key(key_file, true, m_key)) {
+		return false;
+	}
+
+		// Only sessions that this daemon negotiated for incoming connections;
+		// sessions we created on behalf of others (family sessions, claim
+		// sessions) are recreated by whoever created them.
+	time_t now = time(nullptr);
+	std::vector<const KeyCacheEntry *> entries;
+	for (const auto &[sid, entry] : cache) {
+		bool negotiated = false;
+		entry.policy()->LookupBool(ATTR_SEC_NEGOTIATED_SESSION, negotiated);
+		if ( ! negotiated || ! entry.addr().empty() || entry.getLingerFlag() || entry.keys().empty()) {
+			continue;
+		}
+		if (entry.expiration() && entry.expiration() <= now) {
+			continue;
+		}
+		entries.push_back(&entry);
+	}
+
+		// keep the sessions that will live the longest, 0 means never expires.
+		// The lease is renewed whenever a session is used, so only the
+		// lifetime says how long a session can live.
+	std::sort(entries.begin(), entries.end(), [](const KeyCacheEntry *a, const KeyCacheEntry *b) {
+		time_t a_exp = a->lifetimeExpiration(), b_exp = b->lifetimeExpiration();
+		if ( ! a_exp || ! b_exp) {
+			return a_exp == 0 && b_exp != 0;
+		}
+		return a_exp > b_exp;
+	});
+
+	const size_t overhead = KEYCACHE_FILE_MAGIC_LEN + KEYCACHE_FILE_IV_LEN + KEYCACHE_FILE_TAG_LEN;
+	wiped_string line;
+	m_saved = 0;
+	m_candidates = entries.size();
+	for (const auto *entry : entries) {
+		line.clear();
+		UnparseKeyCacheEntry(*entry, line);
+		if (overhead + m_plaintext.size() + line.size() + 1 > max_size) {
+			break;
+		}
+		m_plaintext += line;
+		m_plaintext += '\n';
+		++m_saved;
+	}
+
+		// create the temp file here rather than in Write(), so that it is
+		// created with our priv state, which another thread can't rely on
+	m_file = file;
+	m_tmp_file = m_file + ".tmp";
+#ifdef WIN32
+	const int open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_BINARY;
+#else
+	const int open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+#endif
+	m_fd = safe_open_wrapper_follow(m_tmp_file.c_str(), open_flags, 0600);
+	if (m_fd < 0) {
+		dprintf(D_ALWAYS, "Failed to create session cache temp file %s: %s\n", m_tmp_file.c_str(), strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+bool
+KeyCacheFileWriter::Write()
+{
+	ASSERT(m_fd >= 0);
+	wiped_string data;
+	bool ok = EncryptKeyCacheData(m_key, m_plaintext, data);
+	OPENSSL_cleanse(m_key, sizeof(m_key));
+	OPENSSL_cleanse(&m_plaintext[0], m_plaintext.size());
+	m_plaintext.clear();
+	if ( ! ok) {
+		dprintf(D_ALWAYS, "Failed to encrypt the session cache for %s\n", m_file.c_str());
+		return false;
+	}
+	if (full_write(m_fd, data.data(), data.size()) != (ssize_t)data.size() ||
+		condor_fsync(m_fd, m_tmp_file.c_str()) < 0)
+	{
+		dprintf(D_ALWAYS, "Failed to write session cache temp file %s: %s\n", m_tmp_file.c_str(), strerror(errno));
+		return false;
+	}
+	m_size = data.size();
+	m_written = true;
+	return true;
+}
+
+bool
+KeyCacheFileWriter::Finish()
+{
+	ASSERT(m_fd >= 0);
+	close(m_fd);
+	m_fd = -1;
+	if ( ! m_written) {
+		unlink(m_tmp_file.c_str());
+		return false;
+	}
+#ifdef WIN32
+	bool renamed = MoveFileEx(m_tmp_file.c_str(), m_file.c_str(), MOVEFILE_REPLACE_EXISTING);
+	const char *err = renamed ? "" : GetLastErrorString(GetLastError());
+#else
+	bool renamed = rename(m_tmp_file.c_str(), m_file.c_str()) == 0;
+	const char *err = strerror(errno);
+#endif
+	if ( ! renamed) {
+		dprintf(D_ALWAYS, "Failed to rename session cache temp file %s to %s: %s\n",
+			m_tmp_file.c_str(), m_file.c_str(), err);
+		unlink(m_tmp_file.c_str());
+		return false;
+	}
+	dprintf(D_SECURITY, "Saved %zu of %zu sessions to %s (%zu bytes)\n", m_saved, m_candidates, m_file.c_str(), m_size);
+	return true;
+}
+
+
+bool
+SaveKeyCacheFile(const KeyCache &cache, const char *file, const char *key_file, size_t max_size)
+{
+	KeyCacheFileWriter writer;
+	if ( ! writer.Prepare(cache, file, key_file, max_size)) {
+		return false;
+	}
+	writer.Write();
+	return writer.Finish();
+}
+
+
+int
+LoadKeyCacheFile(KeyCache &cache, const char *file, const char *key_file)
+{
+	int fd = safe_open_wrapper_follow(file, O_RDONLY | _O_BINARY);
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			return 0;
+		}
+		dprintf(D_ALWAYS, "Failed to open session cache file %s: %s\n", file, strerror(errno));
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		dprintf(D_ALWAYS, "Failed to stat session cache file %s: %s\n", file, strerror(errno));
+		close(fd);
+		return -1;
+	}
+#ifndef WIN32
+		// the same checks read_secure_file() makes
+	if (st.st_uid != geteuid() || (st.st_mode & 077)) {
+		dprintf(D_ALWAYS, "Ignoring session cache file %s, it must be owned by uid %d and not accessible by others\n",
+			file, (int)geteuid());
+		close(fd);
+		return -1;
+	}
+#endif
+
+	unsigned char key[KEYCACHE_FILE_KEY_LEN];
+	if ( ! get_file_key(key_file, false, key)) {
+		close(fd);
+		return -1;
+	}
+
+	wiped_string plaintext;
+	bool ok = false;
+	size_t size = (size_t)st.st_size;
+#ifdef WIN32
+	std::string data(size, '\0');
+	ok = full_read(fd, &data[0], size) == (ssize_t)size &&
+		DecryptKeyCacheData(key, (const unsigned char *)data.data(), size, plaintext);
+#else
+	void *map = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	if (map != MAP_FAILED) {
+		ok = DecryptKeyCacheData(key, (const unsigned char *)map, size, plaintext);
+		munmap(map, size);
+	}
+#endif
+	close(fd);
+	OPENSSL_cleanse(key, sizeof(key));
+	if ( ! ok) {
+		dprintf(D_ALWAYS, "Ignoring session cache file %s, it could not be decrypted\n", file);
+		return -1;
+	}
+
+	time_t now = time(nullptr);
+	int restored = 0, expired = 0, bad = 0;
+	for (size_t pos = 0; pos < plaintext.size(); ) {
+		size_t eol = plaintext.find('\n', pos);
+		if (eol == std::string::npos) {
+			break;  // we always end the last line with a newline
+		}
+		plaintext[eol] = '\0';
+		auto entry = ParseKeyCacheEntry(&plaintext[pos]);
+		if ( ! entry) {
+			++bad;
+		} else if (entry->expiration() && entry->expiration() <= now) {
+			++expired;
+		} else if (cache.emplace(entry->id(), *entry).second) {
+			++restored;
+		}
+		pos = eol + 1;
+	}
+
+	dprintf(D_ALWAYS, "Restored %d sessions from %s (%d expired, %d unreadable)\n", restored, file, expired, bad);
+	return restored;
+}
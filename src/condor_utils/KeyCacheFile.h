@@ -0,0 +1,92 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef CONDOR_KEYCACHE_FILE_H_INCLUDE
+#define CONDOR_KEYCACHE_FILE_H_INCLUDE
+
+#include "KeyCache.h"
+
+#include <memory>
+
+// Saves the security sessions that a daemon negotiated for incoming
+// connections to a file, so that after a restart the daemon can resume them
+// instead of making every peer authenticate again.
+//
+// The file is encrypted with AES-256-GCM, with a key kept in key_file
+// (see SEC_SESSION_CACHE_KEY_FILE), which is created on first use.  Only
+// sessions that have not expired are saved, the ones that expire last
+// first, until the file would be larger than max_size bytes.  Sessions in
+// the file that have expired by the time it is loaded are skipped.
+//
+// The file is replaced atomically, so a crash while saving leaves the
+// previous file in place.  It is read by mapping it into memory.
+
+#define KEYCACHE_FILE_KEY_LEN 32
+
+// Saves the file in steps, so that a daemon can encrypt and write it on
+// another thread.  Prepare() and Finish() must be called on the daemon's
+// thread, since they read the key file and create and rename files with the
+// daemon's priv state.  Write() may be called on any thread.
+class KeyCacheFileWriter {
+public:
+	KeyCacheFileWriter() = default;
+	~KeyCacheFileWriter();
+	KeyCacheFileWriter(const KeyCacheFileWriter &) = delete;
+	KeyCacheFileWriter &operator=(const KeyCacheFileWriter &) = delete;
+
+	// serialize the sessions to save and create the temp file
+	bool Prepare(const KeyCache &cache, const char *file, const char *key_file, size_t max_size);
+	// encrypt the sessions into the temp file
+	bool Write();
+	// replace the file with the temp file if Write() succeeded
+	bool Finish();
+
+private:
+	std::string m_file;
+	std::string m_tmp_file;
+	std::string m_plaintext;
+	unsigned char m_key[KEYCACHE_FILE_KEY_LEN] {};
+	int m_fd {-1};
+	bool m_written {false};
+	size_t m_saved {0};
+	size_t m_candidates {0};
+	size_t m_size {0};
+};
+
+// all three steps of KeyCacheFileWriter, returns false (after logging why)
+// if the file could not be written
+bool SaveKeyCacheFile(const KeyCache &cache, const char *file, const char *key_file, size_t max_size);
+
+// Adds the sessions in the file to cache, marked as restored, skipping
+// sessions that are already in the cache.  Returns the number of sessions
+// added, or -1 (after logging why) if the file could not be read.  A file
+// that does not exist is not an error.
+int LoadKeyCacheFile(KeyCache &cache, const char *file, const char *key_file);
+
+// One session as a line of the file, without the newline.  Parsing returns
+// nullptr if the line is not a valid session.
+void UnparseKeyCacheEntry(const KeyCacheEntry &entry, std::string &line);
+std::unique_ptr<KeyCacheEntry> ParseKeyCacheEntry(const char *line);
+
+// The encryption of the whole file with a key of KEYCACHE_FILE_KEY_LEN bytes.
+// Decryption returns false if the data was not encrypted with key or was changed.
+bool EncryptKeyCacheData(const unsigned char *key, const std::string &plaintext, std::string &output);
+bool DecryptKeyCacheData(const unsigned char *key, const unsigned char *data, size_t size, std::string &plaintext);
+
+#endif
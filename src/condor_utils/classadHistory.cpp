@@ -26,12 +26,27 @@
 #include "directory.h"      // for StatInfo
 #include "util_lib_proto.h" // for rotate_file
 #include "iso_dates.h"
+#include "utc_time.h"
 #include "condor_email.h"
+#include "directory_util.h"
+#include "history_index.h"
+#include "truncate.h"
 
 #include "classadHistory.h"
 
-static FILE *HistoryFile_fp = NULL;
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
+static int HistoryFile_fd = -1;
 static int HistoryFile_RefCount = 0;
+static long long HistoryFile_size = -1;       // where the next ad will go, -1 if not known
+static long long HistoryFile_last_offset = 0; // offset of the last *** line in the history file
+static int HistoryIndex_fd = -1;
+static bool WriteHistoryIndex = false;
 
 char* JobHistoryFileName = NULL;
 char* JobHistoryParamName = NULL;
@@ -39,14 +54,94 @@ bool        DoHistoryRotation = true;
 char*       PerJobHistoryDir = NULL;
 static HistoryFileRotationInfo hri;
 
+// a job ad that is waiting to be written to the history file
+struct HistoryRecord {
+	std::string text;      // the ad as printed by sPrintAd
+	std::string owner;
+	int cluster {-1};
+	int proc {-1};
+	int completion {-1};
+};
+
+// Writes job ads to the history file from a background thread, so that the
+// schedd does not wait for the disk (or for rotation of the history file)
+// each time a job leaves the queue.  The ads are formatted by the caller and
+// queued, the writer takes all of the queued ads at once and writes them with
+// one check for rotation and one write to the history file.  The queue is
+// bounded, when it is full the caller waits for the writer.
+//
+// The writer thread only writes to the history file and its index through the
+// file descriptors that the daemon's thread opened.  Opening, rotating and
+// removing files is done by the daemon's thread as condor, after Drain() has
+// waited for the writer to finish with the current file, because the writer
+// can't know what priv state the daemon's thread is in.  The writer must be
+// stopped before any of the settings that it uses are changed.
+class HistoryWriter {
+public:
+	~HistoryWriter() { Stop(); }
+
+	void Start(int queue_size);
+	// write the queued ads and stop the thread
+	void Stop();
+	bool Running() const { return m_thread.joinable(); }
+
+	// queue an ad, waiting for room in the queue if it is full
+	void Push(HistoryRecord && rec);
+	// wait until every queued ad has been written
+	void Drain();
+	// the size of the ads that are queued or being written
+	size_t PendingBytes() {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		return m_pending_bytes;
+	}
+	// returns true once after the writer failed to write to the history file
+	bool TakeFailure();
+
+	// count ads written by the caller when the writer is not running
+	void CountWrite(size_t ads, size_t bytes, bool ok) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		CountWriteLocked(ads, bytes, ok);
+	}
+	void GetStats(HistoryWriterStats & stats) {
+		std::lock_guard<std::mutex> guard(m_mutex);
+		stats = m_stats;
+	}
+
+private:
+	void Run();
+	void CountWriteLocked(size_t ads, size_t bytes, bool ok);
+
+	std::mutex m_mutex;
+	std::condition_variable m_not_empty;
+	std::condition_variable m_not_full;
+	std::condition_variable m_idle;
+	std::vector<HistoryRecord> m_queue;
+	size_t m_max_queue {0};
+	size_t m_pending_bytes {0};
+	bool m_writing {false};
+	bool m_stop {false};
+	bool m_failed {false};
+	HistoryWriterStats m_stats;
+	std::thread m_thread;
+};
+
+static HistoryWriter historyWriter;
+
+static bool WriteHistoryRecords(int fd, std::vector<HistoryRecord> & records, size_t & bytes);
+static bool WriteHistoryBuffers(int fd, const std::vector<HistoryRecord> & records, const std::vector<std::string> & banners);
+static void OpenHistoryIndex();
+static bool ResetHistoryIndex(int fd, const char * index_file);
+static void AppendHistoryIndex(const std::vector<HistoryIndexRecord> & records);
+static void RemoveHistoryIndex(const char * history_file);
 static void RemoveExtraHistoryFiles(int max_backups, const char* filename);
 static int MaybeDeleteOneHistoryBackup(int max_backups, const char* original_filename);
 static bool IsHistoryFilename(const char* original_filename, const char *filename, time_t *backup_time);
+static bool HistoryRotationDue(const HistoryFileRotationInfo& fri, long long size_to_append, const char* filename);
 static void RotateHistory(bool isHistory, const char* filename, const char* new_path);
-static int findHistoryOffset(FILE *LogFile);
-static FILE* OpenHistoryFile();
+static long long findHistoryOffset(int fd, long long file_size);
+static int OpenHistoryFile();
 static void CloseJobHistoryFile();
-static void RelinquishHistoryFile(FILE *fp);
+static void RelinquishHistoryFile(int fd);
 
 // --------------------------------------------------------------------------
 // --------- PUBLIC FUNCTIONS (called by schedd, startd, etc) ---------------
@@ -55,6 +150,9 @@ static void RelinquishHistoryFile(FILE *fp);
 void
 InitJobHistoryFile(const char *history_param, const char *per_job_history_param) {
 
+	// the writer thread uses the settings below, so write out
+	// the ads that it has queued and stop it while we change them.
+	StopJobHistoryWriter();
 	CloseJobHistoryFile();
 	if( history_param ) {
 		free(JobHistoryParamName);
@@ -109,6 +207,30 @@ InitJobHistoryFile(const char *history_param, const char *per_job_history_param)
         }
     }
 
+	WriteHistoryIndex = param_boolean("HISTORY_INDEX", false);
+	if (JobHistoryFileName && !WriteHistoryIndex) {
+		// an index that we don't keep up to date would be wrong once we append to the history file
+		RemoveHistoryIndex(JobHistoryFileName);
+	}
+
+	int queue_size = param_integer("HISTORY_WRITER_QUEUE_SIZE", 0, 0);
+	if (JobHistoryFileName && queue_size > 0) {
+		dprintf(D_ALWAYS, "Writing the %s file from a background thread, queueing up to %d job ads\n",
+		        JobHistoryParamName, queue_size);
+		historyWriter.Start(queue_size);
+	}
+}
+
+void
+StopJobHistoryWriter()
+{
+	historyWriter.Stop();
+}
+
+void
+GetJobHistoryWriterStats(HistoryWriterStats & stats)
+{
+	historyWriter.GetStats(stats);
 }
 
 // --------------------------------------------------------------------------
@@ -134,63 +256,71 @@ AppendHistory(ClassAd* ad)
   }
   // First we serialize the ad. If history file rotation is on,
   // we'll need to know how big the ad is before we write it to the 
-  // history file. 
+  // history file.  This is done here even when the history writer
+  // thread is running, because the ad can't be used by another thread.
 
-  std::string ad_string;
-  int ad_size;
-  sPrintAd(ad_string, *ad, nullptr, include_env ? nullptr : &excludeAttrs);
-  ad_size = ad_string.length();
+  HistoryRecord rec;
+  sPrintAd(rec.text, *ad, nullptr, include_env ? nullptr : &excludeAttrs);
 
-  if (JobHistoryFileName && DoHistoryRotation) { MaybeRotateHistory(hri, ad_size, JobHistoryFileName); }
+  if (!ad->LookupInteger("ClusterId", rec.cluster)) {
+	  rec.cluster = -1;
+  }
+  if (!ad->LookupInteger("ProcId", rec.proc)) {
+	  rec.proc = -1;
+  }
+  if (!ad->LookupInteger("CompletionDate", rec.completion)) {
+	  rec.completion = -1;
+  }
+  if (!ad->LookupString("Owner", rec.owner)) {
+	  rec.owner = std::string("?");
+  }
 
-  FILE *LogFile = OpenHistoryFile();
-  if (!LogFile) {
-	  dprintf(D_ALWAYS,"ERROR saving to history file (%s): %s\n",
-			  JobHistoryFileName, strerror(errno));
-	  failed = true;
-  } else {
-	  int offset = findHistoryOffset(LogFile);
-	  if (fputs(ad_string.c_str(), LogFile) == EOF) {
-		  dprintf(D_ALWAYS, 
-				  "ERROR: failed to write job class ad to history file %s\n",
-				  JobHistoryFileName);
-		  failed = true;
-	  } else {
-		  int cluster, proc, completion;
-		  std::string owner;
+  {
+	  // the history file is opened and rotated as condor, never by the writer thread
+	  TemporaryPrivSentry sentry(PRIV_CONDOR);
 
-		  if (!ad->LookupInteger("ClusterId", cluster)) {
-			  cluster = -1;
+	  if (historyWriter.Running()) {
+		  // the writer must be done with the history file before it is renamed or reopened
+		  if (DoHistoryRotation &&
+			  HistoryRotationDue(hri, historyWriter.PendingBytes() + rec.text.size(), JobHistoryFileName)) {
+			  historyWriter.Drain();
+			  MaybeRotateHistory(hri, rec.text.size(), JobHistoryFileName);
 		  }
-		  if (!ad->LookupInteger("ProcId", proc)) {
-			  proc = -1;
+		  if (HistoryFile_fd < 0) {
+			  historyWriter.Drain();
+			  RelinquishHistoryFile(OpenHistoryFile());
 		  }
-		  if (!ad->LookupInteger("CompletionDate", completion)) {
-			  completion = -1;
+		  if (HistoryFile_fd < 0) {
+			  failed = true;
+			  historyWriter.CountWrite(1, 0, false);
+		  } else {
+			  historyWriter.Push(std::move(rec));
+			  // the writer can't send email, it leaves failures for us to report
+			  failed = historyWriter.TakeFailure();
+			  if (failed) {
+				  // May help to close the file and re-open it next time.
+				  historyWriter.Drain();
+				  CloseJobHistoryFile();
+			  }
 		  }
-		  if (!ad->LookupString("Owner", owner)) {
-			  owner = "?";
+	  } else {
+		  if (DoHistoryRotation) { MaybeRotateHistory(hri, rec.text.size(), JobHistoryFileName); }
+		  std::vector<HistoryRecord> records(1);
+		  records[0] = std::move(rec);
+		  size_t bytes = 0;
+		  int fd = OpenHistoryFile();
+		  failed = fd < 0 || !WriteHistoryRecords(fd, records, bytes);
+		  RelinquishHistoryFile(fd);
+		  if (failed) {
+			  // We failed to write to the history file for some reason. May help
+			  // to close it and attempt to re-open it next time.
+			  CloseJobHistoryFile();
 		  }
-		  fprintf(LogFile,
-                      "*** Offset = %d ClusterId = %d ProcId = %d Owner = \"%s\" CompletionDate = %d\n",
-				  offset, cluster, proc, owner.c_str(), completion);
-		  fflush( LogFile );
-      }
+		  historyWriter.CountWrite(records.size(), bytes, !failed);
+	  }
   }
 
-  // If we successfully obtained a handle to the history file,
-  // relinquish it now.  Note it is safe to call RelinquishHistoryFile
-  // even if OpenHistoryFile returned NULL.
-  RelinquishHistoryFile( LogFile );
-  LogFile = NULL;
-
   if ( failed ) {
-	  // We failed to write to the history file for some reason. May help
-	  // to close it and attempt to re-open it next time.
-	  // Note it is safe to call CloseJobHistoryFile() even if OpenHistoryFile
-	  // returned NULL.
-	  CloseJobHistoryFile();
-
 	  // Send email to the admin.
 	  if ( !sent_mail_about_bad_history ) {
 		  std::string msg;
@@ -298,40 +428,272 @@ WritePerJobHistoryFile(ClassAd* ad, bool useGjid)
 // ------ PRIVATE / STATIC FUNCTIONS (implementation specific to this module)
 // --------------------------------------------------------------------------
 
+void
+HistoryWriter::Start(int queue_size)
+{
+	Stop();
+	m_max_queue = queue_size;
+	m_stop = false;
+	m_stats.queue_size = queue_size;
+	dprintf_make_thread_safe();
+	m_thread = std::thread(&HistoryWriter::Run, this);
+}
+
+void
+HistoryWriter::Stop()
+{
+	if ( ! m_thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stop = true;
+	}
+	m_not_empty.notify_one();
+	m_thread.join();
+	m_stats.queue_size = 0;
+}
+
+void
+HistoryWriter::Push(HistoryRecord && rec)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_queue.size() >= m_max_queue) {
+		double begin = _condor_debug_get_time_double();
+		m_not_full.wait(lock, [this] { return m_queue.size() < m_max_queue; });
+		m_stats.stalls++;
+		m_stats.stall_time += _condor_debug_get_time_double() - begin;
+	}
+	m_pending_bytes += rec.text.size();
+	m_queue.push_back(std::move(rec));
+	m_stats.queue_depth = (int)m_queue.size();
+	if (m_stats.queue_depth > m_stats.queue_peak) {
+		m_stats.queue_peak = m_stats.queue_depth;
+	}
+	m_not_empty.notify_one();
+}
+
+void
+HistoryWriter::Drain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_queue.empty() && ! m_writing; });
+}
+
+bool
+HistoryWriter::TakeFailure()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	bool failed = m_failed;
+	m_failed = false;
+	return failed;
+}
+
+void
+HistoryWriter::CountWriteLocked(size_t ads, size_t bytes, bool ok)
+{
+	if (ok) {
+		m_stats.ads_written += ads;
+		m_stats.bytes_written += bytes;
+	} else {
+		m_stats.write_errors++;
+	}
+	m_stats.batches++;
+}
+
+void
+HistoryWriter::Run()
+{
+	std::vector<HistoryRecord> batch;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_not_empty.wait(lock, [this] { return m_stop || ! m_queue.empty(); });
+		if (m_queue.empty()) {
+			break; // stopping, and everything has been written
+		}
+		batch.swap(m_queue);
+		m_stats.queue_depth = 0;
+		m_writing = true;
+		// the daemon's thread only changes this while we are idle
+		int fd = HistoryFile_fd;
+		m_not_full.notify_all();
+		lock.unlock();
+
+		size_t bytes = 0;
+		size_t batch_bytes = 0;
+		for (const auto & rec : batch) {
+			batch_bytes += rec.text.size();
+		}
+		bool ok = WriteHistoryRecords(fd, batch, bytes);
+
+		lock.lock();
+		CountWriteLocked(batch.size(), bytes, ok);
+		if ( ! ok) {
+			m_failed = true;
+		}
+		batch.clear();
+		m_pending_bytes -= batch_bytes;
+		m_writing = false;
+		m_idle.notify_all();
+	}
+}
+
+// Write job ads to the end of the open history file, and their records to the index.
+// This is called by the writer thread when it is running, and by AppendHistory() when
+// it is not.  It only uses the open file descriptors, it never opens or renames a file.
+static bool
+WriteHistoryRecords(int fd, std::vector<HistoryRecord> & records, size_t & bytes)
+{
+	bytes = 0;
+
+		// We keep track of where the ads that we write go, but if the file
+		// was changed by someone else we must find the last line again.
+	struct stat si;
+	if (fstat(fd, &si) < 0) {
+		dprintf(D_ALWAYS,"ERROR checking size of history file (%s): %s\n",
+				JobHistoryFileName, strerror(errno));
+		return false;
+	}
+	if (si.st_size != HistoryFile_size) {
+		HistoryFile_size = si.st_size;
+		HistoryFile_last_offset = findHistoryOffset(fd, HistoryFile_size);
+		if (HistoryIndex_fd >= 0) {
+			// the index now covers only the ads written from here on
+			std::string index_file;
+			HistoryIndexFilename(JobHistoryFileName, index_file);
+			if ( ! ResetHistoryIndex(HistoryIndex_fd, index_file.c_str())) {
+				close(HistoryIndex_fd);
+				HistoryIndex_fd = -1;
+			}
+		}
+	}
+
+	// Each ad is followed by a line that has the offset of the line before it,
+	// so that condor_history can read the file backwards.
+	std::vector<std::string> banners(records.size());
+	std::vector<HistoryIndexRecord> index(records.size());
+	long long pos = HistoryFile_size;
+	long long last_offset = HistoryFile_last_offset;
+	for (size_t ix = 0; ix < records.size(); ++ix) {
+		const HistoryRecord & rec = records[ix];
+		formatstr(banners[ix],
+			"*** Offset = %lld ClusterId = %d ProcId = %d Owner = \"%s\" CompletionDate = %d\n",
+			last_offset, rec.cluster, rec.proc, rec.owner.c_str(), rec.completion);
+
+		HistoryIndexRecord & irec = index[ix];
+		irec.offset = pos;
+		irec.completion_date = rec.completion;
+		irec.cluster = rec.cluster;
+		irec.proc = rec.proc;
+		irec.length = (uint32_t)(rec.text.size() + banners[ix].size());
+		irec.owner_hash = HistoryIndexOwnerHash(rec.owner.c_str());
+
+		last_offset = pos + rec.text.size();
+		pos += irec.length;
+	}
+
+	bool ok = WriteHistoryBuffers(fd, records, banners);
+	if ( ! ok) {
+		dprintf(D_ALWAYS,
+				"ERROR: failed to write job class ad to history file %s: %s\n",
+				JobHistoryFileName, strerror(errno));
+	} else {
+		bytes = pos - HistoryFile_size;
+		HistoryFile_size = pos;
+		HistoryFile_last_offset = last_offset;
+		AppendHistoryIndex(index);
+	}
+	return ok;
+}
+
+// Write each ad followed by its banner line to the history file.
+static bool
+WriteHistoryBuffers(int fd, const std::vector<HistoryRecord> & records, const std::vector<std::string> & banners)
+{
+#ifdef WIN32
+	for (size_t ix = 0; ix < records.size(); ++ix) {
+		const std::string & text = records[ix].text;
+		if (full_write(fd, text.data(), text.size()) != (ssize_t)text.size() ||
+			full_write(fd, banners[ix].data(), banners[ix].size()) != (ssize_t)banners[ix].size()) {
+			return false;
+		}
+	}
+	return true;
+#else
+	std::vector<struct iovec> iov(records.size() * 2);
+	for (size_t ix = 0; ix < records.size(); ++ix) {
+		iov[ix*2].iov_base = const_cast<char*>(records[ix].text.data());
+		iov[ix*2].iov_len = records[ix].text.size();
+		iov[ix*2 + 1].iov_base = const_cast<char*>(banners[ix].data());
+		iov[ix*2 + 1].iov_len = banners[ix].size();
+	}
+
+	size_t first = 0;
+	while (first < iov.size()) {
+		int count = (int)MIN(iov.size() - first, (size_t)IOV_MAX);
+		ssize_t written = writev(fd, &iov[first], count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		// skip past what was written, which may end in the middle of a buffer
+		size_t left = written;
+		while (first < iov.size() && left >= iov[first].iov_len) {
+			left -= iov[first].iov_len;
+			++first;
+		}
+		if (left > 0) {
+			iov[first].iov_base = (char*)iov[first].iov_base + left;
+			iov[first].iov_len -= left;
+		}
+	}
+	return true;
+#endif
+}
+
 // Obtain a handle to the HISTORY file.  Note that each call to OpenHistoryFile()
-// that return non-NULL _MUST_ be paired with a call to RelinquishHistoryFile().
-static FILE *
+// that return >= 0 _MUST_ be paired with a call to RelinquishHistoryFile().
+// This is only called by the daemon's thread, while the writer thread is idle.
+static int
 OpenHistoryFile() {
 		// Note that we are passing O_LARGEFILE, which lets us deal
 		// with files that are larger than 2GB. On systems where
 		// O_LARGEFILE isn't defined, the Condor source defines it to
 		// be 0 which has no effect. So we'll take advantage of large
 		// files where we can, but not where we can't.
-	if( !HistoryFile_fp ) {
-		int fd = safe_open_wrapper_follow(JobHistoryFileName,
+	if( HistoryFile_fd < 0 ) {
+		HistoryFile_fd = safe_open_wrapper_follow(JobHistoryFileName,
                 O_RDWR|O_CREAT|O_APPEND|O_LARGEFILE|_O_NOINHERIT,
                 0644);
-		if( fd < 0 ) {
+		if( HistoryFile_fd < 0 ) {
 			dprintf(D_ALWAYS,"ERROR opening history file (%s): %s\n",
 					JobHistoryFileName, strerror(errno));
-			return NULL;
+			return -1;
 		}
-		HistoryFile_fp = fdopen(fd, "r+");
-		if ( !HistoryFile_fp ) {
-			dprintf(D_ALWAYS,"ERROR opening history file fp (%s): %s\n",
+		struct stat si;
+		if (fstat(HistoryFile_fd, &si) < 0) {
+			dprintf(D_ALWAYS,"ERROR checking size of history file (%s): %s\n",
 					JobHistoryFileName, strerror(errno));
-			// return now, because we CANNOT increment the refcount below on failure.
-			close(fd);
-			return NULL;
+			close(HistoryFile_fd);
+			HistoryFile_fd = -1;
+			return -1;
 		}
+		HistoryFile_size = si.st_size;
+		HistoryFile_last_offset = findHistoryOffset(HistoryFile_fd, HistoryFile_size);
+	}
+	if (WriteHistoryIndex && HistoryIndex_fd < 0) {
+		OpenHistoryIndex();
 	}
+
 	HistoryFile_RefCount++;
-	return HistoryFile_fp;
+	return HistoryFile_fd;
 }
 
 static void
-RelinquishHistoryFile(FILE *fp) {
-	if( fp ) {  // passing a NULL fp is allowed, but don't alter the refcount
+RelinquishHistoryFile(int fd) {
+	if( fd >= 0 ) {  // passing -1 is allowed, but don't alter the refcount
 		HistoryFile_RefCount--;
 	}
 		// keep the file open
@@ -340,9 +702,101 @@ RelinquishHistoryFile(FILE *fp) {
 static void
 CloseJobHistoryFile() {
 	ASSERT( HistoryFile_RefCount == 0 );
-	if( HistoryFile_fp ) {
-		fclose( HistoryFile_fp );
-		HistoryFile_fp = NULL;
+	if( HistoryFile_fd >= 0 ) {
+		close( HistoryFile_fd );
+		HistoryFile_fd = -1;
+	}
+	if( HistoryIndex_fd >= 0 ) {
+		close( HistoryIndex_fd );
+		HistoryIndex_fd = -1;
+	}
+	HistoryFile_size = -1;
+}
+
+// --------------------------------------------------------------------------
+// Open the index of the history file for appending.  An existing index is
+// kept if it ends where the history file ends, otherwise it is started over
+// and covers only the ads written from now on.
+// --------------------------------------------------------------------------
+static void
+OpenHistoryIndex()
+{
+	std::string index_file;
+	HistoryIndexFilename(JobHistoryFileName, index_file);
+
+	HistoryIndexHeader hdr;
+	std::vector<HistoryIndexRecord> records;
+	bool keep = false;
+	if (ReadHistoryIndex(JobHistoryFileName, HistoryFile_size, hdr, records)) {
+		long long end = records.empty() ? hdr.covered_from : records.back().offset + records.back().length;
+		StatInfo si(index_file.c_str());
+		keep = end == HistoryFile_size && si.Error() == SIGood &&
+			si.GetFileSize() == (filesize_t)(sizeof(hdr) + records.size() * sizeof(HistoryIndexRecord));
+	}
+
+	int flags = O_WRONLY|O_CREAT|O_APPEND|O_LARGEFILE|_O_NOINHERIT;
+	if ( ! keep) {
+		flags |= O_TRUNC;
+	}
+	int fd = safe_open_wrapper_follow(index_file.c_str(), flags, 0644);
+	if (fd < 0) {
+		dprintf(D_ALWAYS, "ERROR opening history index (%s): %s\n",
+				index_file.c_str(), strerror(errno));
+		return;
+	}
+	if ( ! keep && ! ResetHistoryIndex(fd, index_file.c_str())) {
+		close(fd);
+		unlink(index_file.c_str());
+		return;
+	}
+	HistoryIndex_fd = fd;
+}
+
+// Start the open index over at the current end of the history file.  This
+// only uses the file descriptor, so the writer thread can call it.  If it
+// fails, the index is left empty, which readers ignore.
+static bool
+ResetHistoryIndex(int fd, const char * index_file)
+{
+	HistoryIndexHeader hdr;
+	InitHistoryIndexHeader(hdr, HistoryFile_size);
+	if (ftruncate(fd, 0) < 0 ||
+		full_write(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+		dprintf(D_ALWAYS, "ERROR writing history index (%s): %s\n",
+				index_file, strerror(errno));
+		IGNORE_RETURN ftruncate(fd, 0);
+		return false;
+	}
+	dprintf(D_FULLDEBUG, "Started history index %s at offset %lld\n",
+			index_file, HistoryFile_size);
+	return true;
+}
+
+static void
+AppendHistoryIndex(const std::vector<HistoryIndexRecord> & records)
+{
+	if (HistoryIndex_fd < 0 || records.empty()) {
+		return;
+	}
+	ssize_t size = records.size() * sizeof(HistoryIndexRecord);
+	if (full_write(HistoryIndex_fd, records.data(), size) != size) {
+		dprintf(D_ALWAYS, "ERROR writing history index for %s, emptying it: %s\n",
+				JobHistoryFileName, strerror(errno));
+		// this may be the writer thread, which must not remove files
+		IGNORE_RETURN ftruncate(HistoryIndex_fd, 0);
+		close(HistoryIndex_fd);
+		HistoryIndex_fd = -1;
+	}
+}
+
+static void
+RemoveHistoryIndex(const char * history_file)
+{
+	std::string index_file;
+	HistoryIndexFilename(history_file, index_file);
+	if (unlink(index_file.c_str()) < 0 && errno != ENOENT) {
+		dprintf(D_ALWAYS, "Failed to remove history index %s: %s\n",
+				index_file.c_str(), strerror(errno));
 	}
 }
 
@@ -352,17 +806,33 @@ CloseJobHistoryFile() {
 // --------------------------------------------------------------------------
 void
 MaybeRotateHistory(const HistoryFileRotationInfo& fri, int size_to_append, const char* filename, const char* new_filepath)
+{
+	if (HistoryRotationDue(fri, size_to_append, filename)) {
+		// Writing the new ClassAd will make the history file too 
+		// big, so we will rotate the history file after removing
+		// extra history files. 
+		dprintf(D_ALWAYS, "Will rotate history file.\n");
+		if (!new_filepath) { RemoveExtraHistoryFiles(fri.NumberBackupHistoryFiles, filename); }
+		RotateHistory(fri.IsStandardHistory, filename, new_filepath);
+	}
+}
+
+// --------------------------------------------------------------------------
+// Decide if the history file must be rotated before size_to_append more
+// bytes are written to it.
+// --------------------------------------------------------------------------
+static bool
+HistoryRotationDue(const HistoryFileRotationInfo& fri, long long size_to_append, const char* filename)
 {
         StatInfo    history_stat_info(filename);
         filesize_t file_size = history_stat_info.GetFileSize();
+        bool mustRotate = false;
 
         if (history_stat_info.Error() == SINoFile) {
             ; // Do nothing, the history file doesn't exist
         } else if (history_stat_info.Error() != SIGood) {
             dprintf(D_ALWAYS, "Couldn't stat history file, will not rotate.\n");
         } else {
-			bool mustRotate = false;
-
             if (file_size + size_to_append > fri.MaxHistoryFileSize) {
 				mustRotate = true;
 			}
@@ -370,14 +840,16 @@ MaybeRotateHistory(const HistoryFileRotationInfo& fri, int size_to_append, const
 
 			if (fri.DoDailyHistoryRotation) {
 				time_t mod_tt = history_stat_info.GetModifyTime();
-				struct tm *mod_t = localtime(&mod_tt);
-				int mod_yday = mod_t->tm_yday;
-				int mod_year = mod_t->tm_year;
+				struct tm mod_t;
+				localtime_r(&mod_tt, &mod_t);
+				int mod_yday = mod_t.tm_yday;
+				int mod_year = mod_t.tm_year;
 
 				time_t now_tt = time(0);
-				struct tm *now_t = localtime(&now_tt);
-				int now_yday = now_t->tm_yday;
-				int now_year = now_t->tm_year;
+				struct tm now_t;
+				localtime_r(&now_tt, &now_t);
+				int now_yday = now_t.tm_yday;
+				int now_year = now_t.tm_year;
 
 				if ((now_yday > mod_yday) ||
 					(now_year > mod_year)) {
@@ -387,32 +859,24 @@ MaybeRotateHistory(const HistoryFileRotationInfo& fri, int size_to_append, const
 
 			if (fri.DoMonthlyHistoryRotation) {
 				time_t mod_tt = history_stat_info.GetModifyTime();
-				struct tm *mod_t = localtime(&mod_tt);
-				int mod_mon = mod_t->tm_mon;
-				int mod_year = mod_t->tm_year;
+				struct tm mod_t;
+				localtime_r(&mod_tt, &mod_t);
+				int mod_mon = mod_t.tm_mon;
+				int mod_year = mod_t.tm_year;
 
 				time_t now_tt = time(0);
-				struct tm *now_t = localtime(&now_tt);
-				int now_mon = now_t->tm_mon;
-				int now_year = now_t->tm_year;
+				struct tm now_t;
+				localtime_r(&now_tt, &now_t);
+				int now_mon = now_t.tm_mon;
+				int now_year = now_t.tm_year;
 
 				if ((now_mon > mod_mon) ||
 					(now_year > mod_year)) {
 					mustRotate = true;
 				}
 			}
-
-			if (mustRotate) {
-                // Writing the new ClassAd will make the history file too 
-                // big, so we will rotate the history file after removing
-                // extra history files. 
-                dprintf(D_ALWAYS, "Will rotate history file.\n");
-                if (!new_filepath) { RemoveExtraHistoryFiles(fri.NumberBackupHistoryFiles, filename); }
-                RotateHistory(fri.IsStandardHistory, filename, new_filepath);
-            }
         }
-    return;
-    
+    return mustRotate;
 }
 
 // --------------------------------------------------------------------------
@@ -484,6 +948,10 @@ MaybeDeleteOneHistoryBackup(int max_backups, const char* original_filename)
 			if (!dir.Remove_Current_File()) {
 				dprintf(D_ALWAYS, "Failed to delete %s\n", oldest_history_filename);
 				num_backups = 0; // prevent looping forever
+			} else {
+				std::string backup_filename;
+				dircat(history_dir.c_str(), oldest_history_filename, backup_filename);
+				RemoveHistoryIndex(backup_filename.c_str());
 			}
 		} else {
 			dprintf(D_ALWAYS, "Failed to find/delete %s\n", oldest_history_filename);
@@ -543,12 +1011,12 @@ RotateHistory(bool isHistory, const char* filename, const char* new_path)
     // readable, and it sorts nicely. So first we create a representation
     // for the current time.
     time_t     current_time;
-    struct tm  *local_time;
+    struct tm  local_time;
     char       iso_time[ISO8601_DateAndTimeBufferMax];
 
     current_time = time(NULL);
-    local_time = localtime(&current_time);
-    time_to_iso8601(iso_time, *local_time, ISO8601_BasicFormat, 
+    localtime_r(&current_time, &local_time);
+    time_to_iso8601(iso_time, local_time, ISO8601_BasicFormat, 
                                ISO8601_DateAndTime, false);
 
     // First, select a name for the rotated history file
@@ -569,6 +1037,18 @@ RotateHistory(bool isHistory, const char* filename, const char* new_path)
         dprintf(D_ALWAYS, "Failed to rotate history file to %s\n",
                 rotated_history_name.c_str());
         dprintf(D_ALWAYS, "Because rotation failed, the history file may get very large.\n");
+    } else if (isHistory) {
+        // the index goes with its history file
+        std::string index_file, rotated_index_file;
+        HistoryIndexFilename(filename, index_file);
+        HistoryIndexFilename(rotated_history_name.c_str(), rotated_index_file);
+        StatInfo index_stat_info(index_file.c_str());
+        if (index_stat_info.Error() == SIGood &&
+            rotate_file(index_file.c_str(), rotated_index_file.c_str())) {
+            dprintf(D_ALWAYS, "Failed to rotate history index to %s\n",
+                    rotated_index_file.c_str());
+            RemoveHistoryIndex(filename);
+        }
     }
 
     return;
@@ -576,27 +1056,22 @@ RotateHistory(bool isHistory, const char* filename, const char* new_path)
 
 // --------------------------------------------------------------------------
 // Figure out how far from the end the beginning of the last line in the
-// history file is. We assume that the file is open. We reset the file pointer
-// to the end of the file when we are done.
+// history file is. We assume that the file is open and file_size bytes long.
 // --------------------------------------------------------------------------
-static int
-findHistoryOffset(FILE *LogFile)
+static long long
+findHistoryOffset(int fd, long long file_size)
 {
-    int offset=0;
-    int file_size;
+    long long offset=0;
     const int JUMP = 200;
 
-    fseek(LogFile, 0, SEEK_END);
-    file_size = ftell(LogFile);
-    if (file_size == 0 || file_size == -1) {
+    if (file_size <= 0) {
         // If there is nothing in the file, the offset of the previous
         // line is 0. 
         offset = 0;
     } else {
         bool found = false;
-        char *buffer = (char *) malloc(JUMP + 1);
-        ASSERT( buffer )
-        int current_offset; 
+        char buffer[JUMP];
+        long long current_offset; 
 
         // We need to skip the last newline
         if (file_size > 1) {
@@ -605,25 +1080,26 @@ findHistoryOffset(FILE *LogFile)
 
         current_offset = file_size;
         while (!found) {
+            long long end_offset = current_offset;
             current_offset -= JUMP;
             if (current_offset < 0) {
                 current_offset = 0;
             }
-            memset(buffer, 0, JUMP+1);
-            if (fseek(LogFile, current_offset, SEEK_SET)) {
+            int len = (int)(end_offset - current_offset);
+            if (lseek(fd, current_offset, SEEK_SET) < 0) {
                 // We failed for some reason
                 offset = -1;
                 break;
             }
-            int n = fread(buffer, 1, JUMP, LogFile);
-            if (n < JUMP) {
+            int n = full_read(fd, buffer, len);
+            if (n < len) {
                 // We failed for some reason: we know we should 
                 // be able to read this much. 
                 offset = -1;
                 break;
             }
             // Look for the newline, backwards through this buffer
-            for (int i = JUMP-1; i >= 0; i--) {
+            for (int i = len-1; i >= 0; i--) {
                 if (buffer[i] == '\n') {
                     found = true;
                     offset = current_offset + i + 1;
@@ -639,13 +1115,7 @@ findHistoryOffset(FILE *LogFile)
                 break;
             }
         }
-		free(buffer);
     }
-	
-    fseek(LogFile, 0, SEEK_END);
+
     return offset;
 }
-
-
-
-
@@ -35,9 +35,28 @@ struct HistoryFileRotationInfo {
 	bool DoMonthlyHistoryRotation = false;
 };
 
+// Counters for the writing of the history file, accumulated since the daemon started.
+// When HISTORY_WRITER_QUEUE_SIZE is greater than 0, job ads are formatted by the caller of
+// AppendHistory() and written to the history file by a background thread.  When the queue
+// is full AppendHistory() waits for the writer, which is counted as a stall.
+struct HistoryWriterStats {
+	long long ads_written {0};
+	long long bytes_written {0};
+	long long batches {0};       // writes of one or more ads to the history file
+	long long write_errors {0};
+	long long stalls {0};        // times that AppendHistory() waited for room in the queue
+	double stall_time {0.0};     // seconds that AppendHistory() spent waiting
+	int queue_size {0};          // HISTORY_WRITER_QUEUE_SIZE, 0 if ads are written synchronously
+	int queue_depth {0};         // ads waiting to be written
+	int queue_peak {0};          // the most ads that have been waiting at once
+};
+
 void WritePerJobHistoryFile(ClassAd*, bool);
 void AppendHistory(ClassAd*);
 void InitJobHistoryFile(const char *, const char *);
+// write the ads waiting in the history writer queue and stop the writer thread
+void StopJobHistoryWriter();
+void GetJobHistoryWriterStats(HistoryWriterStats &);
 void MaybeRotateHistory(const HistoryFileRotationInfo&, int, const char*, const char* new_filepath = NULL);
 
 #endif
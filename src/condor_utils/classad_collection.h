@@ -114,6 +114,7 @@ public:
   bool AbortTransaction() { return ClassAdLog<K,AD>::AbortTransaction(); }
 
   bool InTransaction() { return ClassAdLog<K,AD>::InTransaction(); }
+  bool EmptyTransaction() { return ClassAdLog<K,AD>::EmptyTransaction(); }
 
   /** Get a list of all new keys created in this transaction
 	  @param new_keys List object to populate
@@ -149,6 +150,17 @@ public:
 		// This means doing both a flush and fsync.
   void ForceLog() { ClassAdLog<K,AD>::ForceLog(); }
 
+		// When group commit is on, durable commits are written but not
+		// fsynced until the next SyncLog(), which returns how many it synced.
+  void SetGroupCommit(bool enable) { ClassAdLog<K,AD>::SetGroupCommit(enable); }
+  bool GetGroupCommit() const { return ClassAdLog<K,AD>::GetGroupCommit(); }
+  int SyncLog() { return ClassAdLog<K,AD>::SyncLog(); }
+  int PendingSyncCount() const { return ClassAdLog<K,AD>::PendingSyncCount(); }
+
+		// Write the log in the binary format from the next rotation on.
+  void SetBinaryLog(bool binary) { ClassAdLog<K,AD>::SetBinaryLog(binary); }
+  bool IsBinaryLog() const { return ClassAdLog<K,AD>::IsBinaryLog(); }
+
   ///
   Transaction* getActiveTransaction() { return ClassAdLog<K,AD>::getActiveTransaction(); }
   ///
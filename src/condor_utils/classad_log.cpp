@@ -26,6 +26,7 @@
 #include "classad_merge.h"
 #include "condor_fsync.h"
 #include "condor_attributes.h"
+#include "classad/classadCache.h"
 
 #if defined(UNIX)
 #include "ClassAdLogPlugin.h"
@@ -70,7 +71,9 @@ FILE* LoadClassAdLog(
 	time_t & m_original_log_birthdate,
 	bool & is_clean,
 	bool & requires_successful_cleaning,
-	std::string & errmsg)
+	std::string & errmsg,
+	ClassAdBinaryLog & binary,
+	bool & is_binary)
 {
 	FILE* log_fp = NULL;
 	Transaction * active_transaction = NULL;
@@ -94,12 +97,36 @@ FILE* LoadClassAdLog(
 	is_clean = true; // was cleanly closed (until we find out otherwise)
 	requires_successful_cleaning = false;
 
+	// an existing log is read in the format it has, a new log is created in the requested format
+	if (ClassAdBinaryLog::IsBinaryLog(log_fp)) {
+		std::string hdrerr;
+		if ( ! binary.ReadHeader(log_fp, hdrerr)) {
+			formatstr(errmsg, "failed to read log %s: %s\n", filename, hdrerr.c_str());
+			fclose(log_fp); log_fp = NULL;
+			return NULL;
+		}
+		is_binary = true;
+	} else if (is_binary) {
+		fseek(log_fp, 0, SEEK_END);
+		if (ftell(log_fp) == 0) {
+			if (binary.WriteHeader(log_fp) < 0 || fflush(log_fp) != 0) {
+				formatstr(errmsg, "write to %s failed, errno = %d\n", filename, errno);
+				fclose(log_fp); log_fp = NULL;
+				return NULL;
+			}
+		} else {
+			is_binary = false;
+			fseek(log_fp, 0, SEEK_SET);
+		}
+	}
+	ClassAdBinaryLog *bin = is_binary ? &binary : NULL;
+
 	// Read all of the log records
 	LogRecord		*log_rec;
 	unsigned long count = 0;
-	long long next_log_entry_pos = 0;
+	long long next_log_entry_pos = ftell(log_fp);
     long long curr_log_entry_pos = 0;
-	while ((log_rec = ReadLogEntry(log_fp, 1+count, InstantiateLogEntry, maker)) != 0) {
+	while ((log_rec = ReadClassAdLogEntry(log_fp, 1+count, maker, bin)) != 0) {
         curr_log_entry_pos = next_log_entry_pos;
 		next_log_entry_pos = ftell(log_fp);
 		count++;
@@ -175,7 +202,7 @@ FILE* LoadClassAdLog(
 	}
 	if(!count) {
 		log_rec = new LogHistoricalSequenceNumber( historical_sequence_number, m_original_log_birthdate );
-		if (log_rec->Write(log_fp) < 0) {
+		if (WriteClassAdLogEntry(log_fp, log_rec, bin) < 0) {
 			formatstr(errmsg, "write to %s failed, errno = %d\n", filename, errno);
 			fclose(log_fp); log_fp = NULL;
 		}
@@ -254,7 +281,10 @@ bool TruncateClassAdLog(
 	FILE* &log_fp,                  // in,out
 	unsigned long & historical_sequence_number, // in,out
 	time_t & m_original_log_birthdate, // in,out
-	std::string & errmsg) // out
+	std::string & errmsg, // out
+	ClassAdBinaryLog & binary, // in,out
+	bool & is_binary, // in,out
+	bool want_binary) // in
 {
 	std::string tmp_log_filename;
 	int new_log_fd;
@@ -282,10 +312,11 @@ bool TruncateClassAdLog(
 	unsigned long future_sequence_number = historical_sequence_number + 1;
 
 	// flush our current state into the temp file,
-	// with a future value for sequence number
+	// with a future value for sequence number, in the format we want
+	ClassAdBinaryLog new_binary;
 	bool success = WriteClassAdLogState(new_log_fp, tmp_log_filename.c_str(),
 		future_sequence_number, m_original_log_birthdate,
-		la, maker, errmsg);
+		la, maker, errmsg, want_binary ? &new_binary : NULL);
 
 	fclose(log_fp);
 	log_fp = NULL;
@@ -321,7 +352,10 @@ bool TruncateClassAdLog(
 	}
 
 	// we successfully wrote and rotated, so we can update our sequence number
+	// and the format, further records are appended to the new log
 	historical_sequence_number = future_sequence_number;
+	binary = std::move(new_binary);
+	is_binary = want_binary;
 
 #ifndef WIN32
 	// POSIX does not provide any durability guarantees for rename().  Instead, we must
@@ -529,14 +563,20 @@ bool WriteClassAdLogState(
 	time_t m_original_log_birthdate, // in
 	LoggableClassAdTable & la,
 	const ConstructLogEntry& maker,
-	std::string & errmsg)
+	std::string & errmsg,
+	ClassAdBinaryLog * binary)
 {
 	LogRecord	*log=NULL;
 	ExprTree	*expr=NULL;
 
+	if (binary && binary->WriteHeader(fp) < 0) {
+		formatstr(errmsg, "write to %s failed, errno = %d", filename, errno);
+		return false;
+	}
+
 	// This must always be the first entry in the log.
 	log = new LogHistoricalSequenceNumber( historical_sequence_number, m_original_log_birthdate );
-	if (log->Write(fp) < 0) {
+	if (WriteClassAdLogEntry(fp, log, binary) < 0) {
 		formatstr(errmsg, "write to %s failed, errno = %d", filename, errno);
 		delete log;
 		return false;
@@ -549,7 +589,7 @@ bool WriteClassAdLogState(
 	la.startIterations();
 	while(la.nextIteration(key, ad)) {
 		log = new LogNewClassAd(key, GetMyTypeName(*ad), maker);
-		if (log->Write(fp) < 0) {
+		if (WriteClassAdLogEntry(fp, log, binary) < 0) {
 			formatstr(errmsg, "write to %s failed, errno = %d", filename, errno);
 			delete log;
 			return false;
@@ -568,7 +608,7 @@ bool WriteClassAdLogState(
 			if (expr) {
 				log = new LogSetAttribute(key, itr->first.c_str(),
 										  ExprTreeToString(expr));
-				if (log->Write(fp) < 0) {
+				if (WriteClassAdLogEntry(fp, log, binary) < 0) {
 					formatstr(errmsg, "write to %s failed, errno = %d", filename, errno);
 					delete log;
 					return false;
@@ -639,6 +679,26 @@ LogHistoricalSequenceNumber::WriteBody(FILE *fp)
 	return (fwrite(buf, 1, len, fp) < (unsigned)len) ? -1: len;
 }
 
+int
+LogHistoricalSequenceNumber::WriteBinaryBody(ClassAdBinaryLog &bin)
+{
+	bin.PutVarint(historical_sequence_number);
+	bin.PutVarint((uint64_t)timestamp);
+	return 0;
+}
+
+bool
+LogHistoricalSequenceNumber::ReadBinaryBody(ClassAdBinaryLog &bin)
+{
+	uint64_t seq, stamp;
+	if ( ! bin.GetVarint(seq) || ! bin.GetVarint(stamp)) {
+		return false;
+	}
+	historical_sequence_number = (unsigned long)seq;
+	timestamp = (time_t)stamp;
+	return true;
+}
+
 LogNewClassAd::LogNewClassAd(const char *k, const char *m, const ConstructLogEntry & c) : ctor(c)
 {
 	op_type = CondorLogOp_NewClassAd;
@@ -748,6 +808,23 @@ LogNewClassAd::WriteBody(FILE* fp)
 	return rval + rval1;
 }
 
+int
+LogNewClassAd::WriteBinaryBody(ClassAdBinaryLog &bin)
+{
+		// the binary format is newer than any reader that wants a TargetType
+	bin.PutString(key);
+	bin.PutString(mytype);
+	return 0;
+}
+
+bool
+LogNewClassAd::ReadBinaryBody(ClassAdBinaryLog &bin)
+{
+	free(key);
+	free(mytype);
+	return bin.GetString(key) && bin.GetString(mytype);
+}
+
 LogDestroyClassAd::LogDestroyClassAd(const char *k, const ConstructLogEntry & c) : ctor(c)
 {
 	op_type = CondorLogOp_DestroyClassAd;
@@ -824,7 +901,22 @@ LogSetAttribute::Play(void *data_structure)
 		return -1;
 
 	std::string attr(name);
-	if (ad->InsertViaCache(attr, value)) {
+	if ( ! value && value_expr) {
+			// a literal from a binary log, insert a copy of it rather than parsing it
+			// again, but share it through the expression cache as InsertViaCache() would
+		ExprTree *tree = value_expr->Copy();
+		if (classad::ClassAdGetExpressionCaching() && attr[0] != '\'' && classad::CachedExprEnvelope::cacheable(tree)) {
+			std::string rhs(get_value());
+			classad::CachedExprEnvelope *cached = classad::CachedExprEnvelope::check_hit(attr, rhs);
+			if (cached) {
+				delete tree;
+				tree = cached;
+			} else {
+				tree = classad::CachedExprEnvelope::cache(attr, tree, rhs);
+			}
+		}
+		rval = ad->Insert(attr, tree) ? TRUE : FALSE;
+	} else if (ad->InsertViaCache(attr, value)) {
 		rval = TRUE;
 	} else {
 		rval = FALSE;
@@ -836,7 +928,9 @@ LogSetAttribute::Play(void *data_structure)
 	}
 
 #if defined(UNIX)
-	ClassAdLogPluginManager::SetAttribute(key, name, value);
+	if ( ! ClassAdLogPluginManager::getPlugins().empty()) {
+		ClassAdLogPluginManager::SetAttribute(key, name, get_value());
+	}
 #endif
 
 	return rval;
@@ -847,6 +941,8 @@ LogSetAttribute::WriteBody(FILE* fp)
 {
 	int		rval, rval1, len;
 
+	get_value();
+
 	// Ensure no newlines sneak through (as they're a record seperator)
 	if( strchr(key, '\n') || strchr(name, '\n') || strchr(value, '\n') ) {
 		dprintf(D_ALWAYS, "Refusing attempt to add '%s' = '%s' to record '%s' as it contains a newline, which is not allowed.\n", name, value, key);
@@ -920,6 +1016,46 @@ LogSetAttribute::ReadBody(FILE* fp)
 	return rval + rval1;
 }
 
+int
+LogSetAttribute::WriteBinaryBody(ClassAdBinaryLog &bin)
+{
+		// newlines are no problem for the binary format, but the log must stay convertible to text
+	if (strchr(key, '\n') || strchr(name, '\n') || (value && strchr(value, '\n'))) {
+		dprintf(D_ALWAYS, "Refusing attempt to add '%s' = '%s' to record '%s' as it contains a newline, which is not allowed.\n", name, get_value(), key);
+		return -1;
+	}
+	bin.PutString(key);
+	bin.PutName(name);
+	bin.PutValue(value, value_expr);
+	return 0;
+}
+
+bool
+LogSetAttribute::ReadBinaryBody(ClassAdBinaryLog &bin)
+{
+	free(key);
+	free(name);
+	free(value);
+	if (value_expr) delete value_expr;
+	value_expr = NULL;
+	if ( ! bin.GetString(key) || ! bin.GetName(name) || ! bin.GetValue(value, value_expr)) {
+		return false;
+	}
+	if (value) {
+			// not a literal, so it must be parsed like a value in a text log
+		if (ParseClassAdRvalExpr(value, value_expr)) {
+			if (value_expr) delete value_expr;
+			value_expr = NULL;
+			if (param_boolean("CLASSAD_LOG_STRICT_PARSING", true)) {
+				return false;
+			} else {
+				dprintf(D_ALWAYS, "WARNING: strict classad parsing failed for expression: %s\n", value);
+			}
+		}
+	}
+	return true;
+}
+
 
 LogDeleteAttribute::LogDeleteAttribute(const char *k, const char *n)
 {
@@ -974,6 +1110,22 @@ LogDeleteAttribute::WriteBody(FILE* fp)
 	return rval1 + rval;
 }
 
+int
+LogDeleteAttribute::WriteBinaryBody(ClassAdBinaryLog &bin)
+{
+	bin.PutString(key);
+	bin.PutName(name);
+	return 0;
+}
+
+bool
+LogDeleteAttribute::ReadBinaryBody(ClassAdBinaryLog &bin)
+{
+	free(key);
+	free(name);
+	return bin.GetString(key) && bin.GetName(name);
+}
+
 int
 LogBeginTransaction::Play(void *){
 #if defined(UNIX)
@@ -1038,6 +1190,19 @@ LogEndTransaction::ReadBody( FILE* fp )
 	return( 1 );
 }
 
+bool
+LogEndTransaction::ReadBinaryBody(ClassAdBinaryLog &bin)
+{
+	free(comment);
+	if ( ! bin.GetString(comment)) {
+		return false;
+	}
+	if ( ! comment[0]) {
+		free(comment);
+	}
+	return true;
+}
+
 int
 LogDeleteAttribute::ReadBody(FILE* fp)
 {
@@ -1060,7 +1225,7 @@ LogDeleteAttribute::ReadBody(FILE* fp)
 #define	ATTRLIST_MAX_EXPRESSION 10240
 
 LogRecord	*
-InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLogEntry & ctor)
+CreateLogEntry(int type, const ConstructLogEntry & ctor)
 {
 	LogRecord	*log_rec;
 
@@ -1093,6 +1258,16 @@ InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLog
 		    return NULL;
 			break;
 	}
+	return log_rec;
+}
+
+LogRecord	*
+InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLogEntry & ctor)
+{
+	LogRecord	*log_rec = CreateLogEntry(type, ctor);
+	if ( ! log_rec) {
+		return NULL;
+	}
 
 	long long pos = ftell(fp);
 
@@ -1158,6 +1333,42 @@ InstantiateLogEntry(FILE *fp, unsigned long recnum, int type, const ConstructLog
 	return log_rec;
 }
 
+LogRecord *
+ReadClassAdLogEntry(FILE *fp, unsigned long recnum, const ConstructLogEntry & ctor, ClassAdBinaryLog * binary)
+{
+	if ( ! binary) {
+		return ReadLogEntry(fp, recnum, InstantiateLogEntry, ctor);
+	}
+
+	long long pos = ftell(fp);
+	ClassAdBinaryLog::ReadStatus status;
+	int op_type;
+	LogRecord *log_rec = binary->Read(fp, ctor, status, op_type);
+	if (log_rec || status == ClassAdBinaryLog::READ_EOF || status == ClassAdBinaryLog::READ_TRUNCATED) {
+			// a truncated record leaves the file at the end, which the caller
+			// detects as an unterminated log entry
+		return log_rec;
+	}
+
+		// a corrupt record.  as for a text log, this is fatal if it is inside a
+		// closed transaction, otherwise the rest of the log is ignored.
+	dprintf(D_ALWAYS | D_ERROR, "WARNING: Encountered corrupt log record %lu (byte offset %lld, type %d)\n", recnum, pos, op_type);
+	fseek(fp, pos + 1, SEEK_SET);
+	while (binary->Skip(fp, op_type)) {
+		if (op_type == CondorLogOp_EndTransaction) {
+			EXCEPT("Error: corrupt log record %lu (byte offset %lld) occurred inside closed transaction, recovery failed", recnum, pos);
+		}
+	}
+	fseek(fp, 0, SEEK_END);
+	return NULL;
+}
+
+int
+WriteClassAdLogEntry(FILE *fp, LogRecord *log, ClassAdBinaryLog * binary)
+{
+	return binary ? binary->Write(fp, log) : log->Write(fp);
+}
+
 #undef free
 
 // Force instantiation of the simple form of ClassAdLog, used the the Accountant
@@ -40,11 +40,17 @@
    The constructor will ignore any incomplete transactions written to the
    log.  The LogBeginTransaction and LogEndTransaction classes are used
    internally by ClassAdLog to delimit transactions in the on-disk log.
+
+   The log can also be kept in a binary format (see classad_log_binary.h)
+   that is faster to replay.  The format of an existing log is detected
+   when it is loaded, SetBinaryLog() chooses the format that it is written
+   in the next time it is rotated.
 */
 
 #include "condor_classad.h"
 #include "log.h"
 #include "log_transaction.h"
+#include "classad_log_binary.h"
 #include "stopwatch.h"
 
 extern const char *EMPTY_CLASSAD_TYPE_NAME;
@@ -148,6 +154,7 @@ public:
 	void CommitTransaction(const char * comment = NULL);
 	void CommitNondurableTransaction(const char * comment = NULL);
 	bool InTransaction() { return active_transaction != NULL; }
+	bool EmptyTransaction() { return !active_transaction || active_transaction->EmptyTransaction(); }
 	int SetTransactionTriggers(int mask);
 	int GetTransactionTriggers();
 
@@ -181,6 +188,27 @@ public:
 		// This means doing both a flush and fsync.
 	void ForceLog();
 
+		// Turn group commit on or off.  While it is on, durable
+		// transactions are written but not fsynced, they become durable
+		// at the next SyncLog() or ForceLog(), so that one fsync covers
+		// all of the commits since the last one.  Turning it off syncs
+		// any pending commits.
+	void SetGroupCommit(bool enable);
+	bool GetGroupCommit() const { return m_group_commit; }
+
+		// Force the commits that group commit deferred to disk.
+		// returns the number of commits that were made durable.
+	int SyncLog();
+
+		// number of durable commits waiting for SyncLog()
+	int PendingSyncCount() const { return m_pending_syncs; }
+
+		// Choose between the text and the binary format.  A log that is
+		// in the other format is converted when it is next rotated,
+		// including when InitLogFile() loads it.
+	void SetBinaryLog(bool binary) { m_want_binary = binary; }
+	bool IsBinaryLog() const { return m_is_binary; }
+
 	bool AdExistsInTableOrTransaction(const K& key);
 
 	// returns 1 and sets val if corresponding SetAttribute found
@@ -249,6 +277,12 @@ private:
 	unsigned long historical_sequence_number;
 	time_t m_original_log_birthdate;
 	int m_nondurable_level;
+	bool m_group_commit;
+	int m_pending_syncs;
+	bool m_want_binary;  // format to write the next time the log is rotated
+	bool m_is_binary;    // format of the log that is open
+	ClassAdBinaryLog m_binary;
+	ClassAdBinaryLog * binaryLog() { return m_is_binary ? &m_binary : NULL; }
 
 	bool SaveHistoricalLogs();
 };
@@ -265,6 +299,8 @@ public:
 private:
 	virtual int WriteBody(FILE *fp);
 	virtual int ReadBody(FILE *fp);
+	virtual int WriteBinaryBody(ClassAdBinaryLog &bin);
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &bin);
 
 	virtual char const *get_key() {return NULL;}
 
@@ -341,6 +377,8 @@ public:
 private:
 	virtual int WriteBody(FILE *fp);
 	virtual int ReadBody(FILE* fp);
+	virtual int WriteBinaryBody(ClassAdBinaryLog &bin);
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &bin);
 
 	const ConstructLogEntry & ctor;
 	char *key;
@@ -359,6 +397,8 @@ public:
 private:
 	virtual int WriteBody(FILE* fp) { size_t r=fwrite(key, sizeof(char), strlen(key), fp); return (r < strlen(key)) ? -1 : (int)r;}
 	virtual int ReadBody(FILE* fp);
+	virtual int WriteBinaryBody(ClassAdBinaryLog &bin) { bin.PutString(key); return 0; }
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &bin) { free(key); key = NULL; return bin.GetString(key); }
 
 	const ConstructLogEntry & ctor;
 	char *key;
@@ -372,12 +412,15 @@ public:
 	int Play(void *data_structure); // data_structure should be of type LoggableClassAdTable *
 	virtual char const *get_key() { return key; }
 	char const *get_name() { return name; }
-	char const *get_value() { return value; }
+		// a value read from a binary log may only have the expression, the text is made when it is asked for
+	char const *get_value() { if ( ! value && value_expr) { value = strdup(ExprTreeToString(value_expr)); } return value; }
     ExprTree* get_expr() { return value_expr; }
 
 private:
 	virtual int WriteBody(FILE* fp);
 	virtual int ReadBody(FILE* fp);
+	virtual int WriteBinaryBody(ClassAdBinaryLog &bin);
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &bin);
 
 	char *key;
 	char *name;
@@ -397,6 +440,8 @@ public:
 private:
 	virtual int WriteBody(FILE* fp);
 	virtual int ReadBody(FILE* fp);
+	virtual int WriteBinaryBody(ClassAdBinaryLog &bin);
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &bin);
 
 	char *key;
 	char *name;
@@ -434,6 +479,8 @@ public:
 private:
 	virtual int WriteBody(FILE* fp);
 	virtual int ReadBody(FILE* fp);
+	virtual int WriteBinaryBody(ClassAdBinaryLog &bin) { bin.PutString(comment); return 0; }
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &bin);
 
 	virtual char const *get_key() {return NULL;}
 	char * comment;
@@ -450,7 +497,10 @@ bool TruncateClassAdLog(
 	FILE* &log_fp,                  // in,out
 	unsigned long & historical_sequence_number, // in,out
 	time_t & m_original_log_birthdate, // in,out
-	std::string & errmsg);          // out
+	std::string & errmsg,           // out
+	ClassAdBinaryLog & binary,      // in,out: names of the binary log, replaced if the log is rotated
+	bool & is_binary,               // in: format of the log, out: format after rotation
+	bool want_binary);              // in: format to rotate to
 
 bool WriteClassAdLogState(
 	FILE *fp,                       // in
@@ -459,7 +509,8 @@ bool WriteClassAdLogState(
 	time_t original_log_birthdate,  // in
 	LoggableClassAdTable & la,      // in
 	const ConstructLogEntry& maker, // in
-	std::string & errmsg);          // out
+	std::string & errmsg,           // out
+	ClassAdBinaryLog * binary = NULL); // in: write the binary format rather than text
 
 FILE* LoadClassAdLog(
 	const char *filename,           // in
@@ -469,7 +520,9 @@ FILE* LoadClassAdLog(
 	time_t & m_original_log_birthdate, // in,out
 	bool & is_clean,  // out: true if log was shutdown cleanly
 	bool & requires_successful_cleaning, // out: true if log must be cleaned (i.e rotated) before it can be written to again.
-	std::string & errmsg);          // out, contains error or warning messages
+	std::string & errmsg,           // out, contains error or warning messages
+	ClassAdBinaryLog & binary,      // out: names of the binary log
+	bool & is_binary);              // in: format of a new log, out: format of the log
 
 int FlushClassAdLog(FILE* fp, bool force);
 
@@ -503,6 +556,17 @@ LogRecord* InstantiateLogEntry(
 	int type,
 	const ConstructLogEntry & ctor);
 
+// returns an empty log record of the given type, or NULL
+LogRecord* CreateLogEntry(int type, const ConstructLogEntry & ctor);
+
+// read or write a log record in the binary format if binary is not NULL, otherwise as text
+LogRecord* ReadClassAdLogEntry(
+	FILE* fp,
+	unsigned long recnum,
+	const ConstructLogEntry & ctor,
+	ClassAdBinaryLog * binary);
+int WriteClassAdLogEntry(FILE* fp, LogRecord* log, ClassAdBinaryLog * binary);
+
 // Templated member functions that call the helper functions with the correct arguments.
 //
 
@@ -522,10 +586,12 @@ ClassAdLog<K,AD>::InitLogFile(const char *filename,int max_historical_logs_arg)
 
 	ClassAdLogTable<K,AD> la(table); // this gives the ability to add & remove table items.
 
+	m_is_binary = m_want_binary; // the format of the log if it is new
 	log_fp = LoadClassAdLog(filename,
 		la, this->GetTableEntryMaker(),
 		historical_sequence_number, m_original_log_birthdate,
-		is_clean, requires_successful_cleaning, errmsg);
+		is_clean, requires_successful_cleaning, errmsg,
+		m_binary, m_is_binary);
 
 	if ( ! log_fp) {
 		dprintf(D_ALWAYS, "%s", errmsg.c_str());
@@ -533,7 +599,8 @@ ClassAdLog<K,AD>::InitLogFile(const char *filename,int max_historical_logs_arg)
 	} else if ( ! errmsg.empty()) {
 		dprintf(D_ALWAYS, "ClassAdLog %s has the following issues: %s\n", filename, errmsg.c_str());
 	}
-	if( !is_clean || requires_successful_cleaning ) {
+	bool wrong_format = m_is_binary != m_want_binary && ! open_read_only;
+	if( !is_clean || requires_successful_cleaning || wrong_format ) {
 		if (open_read_only && requires_successful_cleaning) {
 			StopLog();
 			dprintf(D_ALWAYS, "Log %s is corrupt and needs to be cleaned before restarting HTCondor", filename);
@@ -558,6 +625,10 @@ ClassAdLog<K,AD>::ClassAdLog(const ConstructLogEntry* maker)
 	, historical_sequence_number(0)
 	, m_original_log_birthdate(0)
 	, m_nondurable_level(0)
+	, m_group_commit(false)
+	, m_pending_syncs(0)
+	, m_want_binary(false)
+	, m_is_binary(false)
 {
 }
 
@@ -598,7 +669,7 @@ ClassAdLog<K,AD>::AppendLog(LogRecord *log)
 	} else {
 			//MD: using file pointer
 		if (log_fp!=NULL) {
-			if (log->Write(log_fp) < 0) {
+			if (WriteClassAdLogEntry(log_fp, log, binaryLog()) < 0) {
 				EXCEPT("write to %s failed, errno = %d", logFilename(), errno);
 			}
 			if( m_nondurable_level == 0 ) {
@@ -631,6 +702,29 @@ ClassAdLog<K,AD>::ForceLog()
 	if (err) {
 		EXCEPT("fsync of %s failed, errno = %d", logFilename(), err);
 	}
+	m_pending_syncs = 0;
+}
+
+template <typename K, typename AD>
+void
+ClassAdLog<K,AD>::SetGroupCommit(bool enable)
+{
+	if ( ! enable) {
+		SyncLog();
+	}
+	m_group_commit = enable;
+}
+
+template <typename K, typename AD>
+int
+ClassAdLog<K,AD>::SyncLog()
+{
+	int synced = m_pending_syncs;
+	if (synced > 0 && log_fp) {
+		ForceLog();
+	}
+	m_pending_syncs = 0;
+	return synced;
 }
 
 template <typename K, typename AD>
@@ -646,6 +740,9 @@ ClassAdLog<K,AD>::TruncLog()
 {
 	dprintf(D_ALWAYS,"About to rotate ClassAd log %s\n",logFilename());
 
+		// don't leave deferred commits in the log we are about to rotate away
+	SyncLog();
+
 	if(!SaveHistoricalLogs()) {
 		dprintf(D_ALWAYS,"Skipping log rotation, because saving of historical log failed for %s.\n",logFilename());
 		return false;
@@ -656,7 +753,7 @@ ClassAdLog<K,AD>::TruncLog()
 	bool rotated = TruncateClassAdLog(logFilename(),
 		la, this->GetTableEntryMaker(),
 		log_fp, historical_sequence_number, m_original_log_birthdate,
-		errmsg);
+		errmsg, m_binary, m_is_binary, m_want_binary);
 	if ( ! log_fp) {
 		// if after rotation, the log is no longer open, the the failure is fatal, and we must except
 		EXCEPT("%s", errmsg.c_str());
@@ -674,6 +771,7 @@ ClassAdLog<K,AD>::StopLog()
 {
 	AbortTransaction();
 	if (log_fp) {
+		SyncLog();
 		fclose(log_fp);
 		log_fp = NULL;
 	}
@@ -746,8 +844,13 @@ ClassAdLog<K,AD>::CommitTransaction(const char * comment /*=NULL*/)
 		log->set_comment(comment);
 		active_transaction->AppendLog(log);
 		bool nondurable = m_nondurable_level > 0;
+		if ( ! nondurable && m_group_commit) {
+				// write it now, fsync it at the next SyncLog()
+			nondurable = true;
+			++m_pending_syncs;
+		}
 		ClassAdLogTable<K,AD> la(table);
-		active_transaction->Commit(log_fp, logFilename(), &la, nondurable );
+		active_transaction->Commit(log_fp, logFilename(), &la, nondurable, binaryLog());
 	}
 	delete active_transaction;
 	active_transaction = NULL;
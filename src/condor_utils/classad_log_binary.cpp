@@ -0,0 +1,507 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_random_num.h"
+#include "classad_log.h"
+#include "classad_log_binary.h"
+
+#include <algorithm>
+#include <array>
+
+// the first byte is not ascii, so a text log can never start with the magic
+static const unsigned char BINARY_LOG_MAGIC[8] = { 0x89, 'C', 'A', 'L', 'O', 'G', '\r', '\n' };
+
+// a length larger than this is taken to be corruption rather than a record
+static const uint32_t MAX_RECORD_SIZE = 0x40000000;
+
+// the length and checksum that come before each record
+static const size_t RECORD_HEADER_SIZE = 8;
+
+static void
+put_le(unsigned char *p, uint64_t val, int bytes)
+{
+	for (int ix = 0; ix < bytes; ++ix) {
+		p[ix] = (unsigned char)(val >> (8*ix));
+	}
+}
+
+static uint64_t
+get_le(const unsigned char *p, int bytes)
+{
+	uint64_t val = 0;
+	for (int ix = 0; ix < bytes; ++ix) {
+		val |= (uint64_t)p[ix] << (8*ix);
+	}
+	return val;
+}
+
+// CRC-32 of the body of a record
+static uint32_t
+record_checksum(const char *data, size_t len)
+{
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> tbl;
+		for (uint32_t ix = 0; ix < 256; ++ix) {
+			uint32_t crc = ix;
+			for (int bit = 0; bit < 8; ++bit) {
+				crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : (crc >> 1);
+			}
+			tbl[ix] = crc;
+		}
+		return tbl;
+	}();
+
+	uint32_t crc = 0xFFFFFFFFu;
+	const unsigned char *p = (const unsigned char *)data;
+	for (size_t ix = 0; ix < len; ++ix) {
+		crc = table[(crc ^ p[ix]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+
+bool
+ClassAdBinaryLog::IsBinaryLog(FILE *fp)
+{
+	unsigned char magic[sizeof(BINARY_LOG_MAGIC)];
+	long pos = ftell(fp);
+	bool is_binary = false;
+	if (pos >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+		is_binary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+			memcmp(magic, BINARY_LOG_MAGIC, sizeof(magic)) == 0;
+		fseek(fp, pos, SEEK_SET);
+	}
+	return is_binary;
+}
+
+void
+ClassAdBinaryLog::Reset()
+{
+	m_names.clear();
+	m_indexes.clear();
+	m_file_id = 0;
+}
+
+int
+ClassAdBinaryLog::WriteHeader(FILE *fp)
+{
+	Reset();
+	m_file_id = ((uint64_t)time(NULL) << 32) ^ ((uint64_t)getpid() << 16) ^ get_random_uint_insecure();
+	if ( ! m_file_id) m_file_id = 1;
+
+	unsigned char hdr[HEADER_SIZE];
+	memcpy(hdr, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+	put_le(hdr + 8, VERSION, 4);
+	put_le(hdr + 12, m_file_id, 8);
+	if (fwrite(hdr, 1, sizeof(hdr), fp) < sizeof(hdr)) {
+		return -1;
+	}
+	return (int)sizeof(hdr);
+}
+
+bool
+ClassAdBinaryLog::ParseHeader(const unsigned char *hdr, size_t len, uint64_t &file_id, std::string &errmsg)
+{
+	if (len < (size_t)HEADER_SIZE || memcmp(hdr, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) != 0) {
+		errmsg = "not a binary ClassAd log";
+		return false;
+	}
+	int version = (int)get_le(hdr + 8, 4);
+	if (version != VERSION) {
+		formatstr(errmsg, "binary ClassAd log version %d is not the supported version %d", version, VERSION);
+		return false;
+	}
+	file_id = get_le(hdr + 12, 8);
+	return true;
+}
+
+bool
+ClassAdBinaryLog::ReadHeader(FILE *fp, std::string &errmsg)
+{
+	unsigned char hdr[HEADER_SIZE];
+	size_t len = fread(hdr, 1, sizeof(hdr), fp);
+	uint64_t file_id = 0;
+	if ( ! ParseHeader(hdr, len, file_id, errmsg)) {
+		return false;
+	}
+	Reset();
+	m_file_id = file_id;
+	return true;
+}
+
+bool
+ClassAdBinaryLog::CheckHeader(FILE *fp, std::string &errmsg)
+{
+	unsigned char hdr[HEADER_SIZE];
+	long pos = ftell(fp);
+	if (pos < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+		formatstr(errmsg, "seek failed, errno = %d", errno);
+		return false;
+	}
+	size_t len = fread(hdr, 1, sizeof(hdr), fp);
+	fseek(fp, pos, SEEK_SET);
+
+	uint64_t file_id = 0;
+	if ( ! ParseHeader(hdr, len, file_id, errmsg)) {
+		return false;
+	}
+	if (file_id != m_file_id) {
+		Reset();
+		m_file_id = file_id;
+	}
+	return true;
+}
+
+int
+ClassAdBinaryLog::Write(FILE *fp, LogRecord *log)
+{
+	m_buf.assign(RECORD_HEADER_SIZE, '\0');
+	PutByte((unsigned char)log->get_op_type());
+	if (log->WriteBinaryBody(*this) < 0) {
+		return -1;
+	}
+	size_t len = m_buf.size() - RECORD_HEADER_SIZE;
+	put_le((unsigned char *)&m_buf[0], len, 4);
+	put_le((unsigned char *)&m_buf[4], record_checksum(m_buf.data() + RECORD_HEADER_SIZE, len), 4);
+	if (fwrite(m_buf.data(), 1, m_buf.size(), fp) < m_buf.size()) {
+		return -1;
+	}
+	return (int)m_buf.size();
+}
+
+bool
+ClassAdBinaryLog::ReadRecord(FILE *fp, ReadStatus &status, uint32_t max_len)
+{
+	unsigned char hdr[RECORD_HEADER_SIZE];
+	size_t got = fread(hdr, 1, sizeof(hdr), fp);
+	if (got < sizeof(hdr)) {
+		status = got ? READ_TRUNCATED : READ_EOF;
+		return false;
+	}
+	uint32_t len = (uint32_t)get_le(hdr, 4);
+	if (len == 0 || len > MAX_RECORD_SIZE) {
+		status = READ_CORRUPT;
+		return false;
+	}
+	if (len > max_len) {
+		status = READ_TRUNCATED;
+		return false;
+	}
+	m_buf.resize(len);
+	if (fread(&m_buf[0], 1, len, fp) < len) {
+		status = READ_TRUNCATED;
+		return false;
+	}
+	if (record_checksum(m_buf.data(), len) != (uint32_t)get_le(hdr + 4, 4)) {
+		status = READ_CORRUPT;
+		return false;
+	}
+	m_pos = 0;
+	status = READ_OK;
+	return true;
+}
+
+LogRecord *
+ClassAdBinaryLog::Read(FILE *fp, const ConstructLogEntry &ctor, ReadStatus &status, int &op_type)
+{
+	op_type = CondorLogOp_Error;
+	if ( ! ReadRecord(fp, status)) {
+		return NULL;
+	}
+
+	unsigned char op = 0;
+	GetByte(op);
+	LogRecord *log = NULL;
+	if (valid_record_optype(op)) {
+		op_type = op;
+		log = CreateLogEntry(op_type, ctor);
+	}
+	if ( ! log) {
+		status = READ_CORRUPT;
+		return NULL;
+	}
+
+	m_unknown_name = false;
+	if ( ! log->ReadBinaryBody(*this) || ! AtEnd()) {
+		delete log;
+		status = m_unknown_name ? READ_UNKNOWN_NAME : READ_CORRUPT;
+		return NULL;
+	}
+	return log;
+}
+
+bool
+ClassAdBinaryLog::Skip(FILE *fp, int &op_type)
+{
+	op_type = CondorLogOp_Error;
+	long long pos = ftell(fp);
+	if (pos < 0 || fseek(fp, 0, SEEK_END) != 0) {
+		return false;
+	}
+	long long size = ftell(fp);
+
+		// only a record whose checksum matches is taken as the next one, so
+		// after a bad length or checksum look for it one byte at a time
+	for ( ; pos + (long long)RECORD_HEADER_SIZE <= size; ++pos) {
+		if (fseek(fp, pos, SEEK_SET) != 0) {
+			return false;
+		}
+		ReadStatus status;
+		uint32_t max_len = (uint32_t)std::min<long long>(size - pos - RECORD_HEADER_SIZE, MAX_RECORD_SIZE);
+		if (ReadRecord(fp, status, max_len)) {
+			unsigned char op = 0;
+			if (GetByte(op) && valid_record_optype(op)) {
+				op_type = op;
+			}
+			return true;
+		}
+	}
+	fseek(fp, 0, SEEK_END);
+	return false;
+}
+
+bool
+ClassAdBinaryLog::Rescan(FILE *fp, long long offset, const ConstructLogEntry &ctor)
+{
+	m_names.clear();
+	m_indexes.clear();
+	if (fseek(fp, HEADER_SIZE, SEEK_SET) != 0) {
+		return false;
+	}
+	while (ftell(fp) < offset) {
+		ReadStatus status;
+		int op_type;
+		LogRecord *log = Read(fp, ctor, status, op_type);
+		if ( ! log) {
+			return false;
+		}
+		delete log;
+	}
+	return ftell(fp) == offset;
+}
+
+void
+ClassAdBinaryLog::PutVarint(uint64_t val)
+{
+	while (val >= 0x80) {
+		m_buf.push_back((char)(val | 0x80));
+		val >>= 7;
+	}
+	m_buf.push_back((char)val);
+}
+
+void
+ClassAdBinaryLog::PutString(const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+	PutVarint(len);
+	m_buf.append(str ? str : "", len);
+}
+
+void
+ClassAdBinaryLog::PutName(const char *name)
+{
+	auto found = m_indexes.find(name);
+	if (found != m_indexes.end()) {
+		PutVarint(found->second);
+		return;
+	}
+	uint32_t index = (uint32_t)m_names.size();
+	m_names.emplace_back(name);
+	m_indexes.emplace(m_names.back(), index);
+	PutVarint(index);
+	PutString(name);
+}
+
+void
+ClassAdBinaryLog::PutValue(const char *text, const classad::ExprTree *expr)
+{
+	classad::Value val;
+	switch (expr ? expr->GetKind() : classad::ExprTree::OP_NODE) {
+	case classad::ExprTree::UNDEFINED_LITERAL:
+		PutByte(VALUE_UNDEFINED);
+		return;
+	case classad::ExprTree::ERROR_LITERAL:
+		PutByte(VALUE_ERROR);
+		return;
+	case classad::ExprTree::BOOLEAN_LITERAL: {
+		bool bval = false;
+		((const classad::Literal *)expr)->GetValue(val);
+		val.IsBooleanValue(bval);
+		PutByte(bval ? VALUE_TRUE : VALUE_FALSE);
+		return;
+	}
+	case classad::ExprTree::INTEGER_LITERAL: {
+		long long ival = 0;
+		((const classad::Literal *)expr)->GetValue(val);
+		val.IsIntegerValue(ival);
+		PutByte(VALUE_INTEGER);
+			// zigzag, so that small negative numbers are short too
+		PutVarint(((uint64_t)ival << 1) ^ (uint64_t)(ival >> 63));
+		return;
+	}
+	case classad::ExprTree::REAL_LITERAL: {
+		double dval = 0.0;
+		uint64_t bits;
+		((const classad::Literal *)expr)->GetValue(val);
+		val.IsRealValue(dval);
+		memcpy(&bits, &dval, sizeof(bits));
+		PutByte(VALUE_REAL);
+		m_buf.append(8, '\0');
+		put_le((unsigned char *)&m_buf[m_buf.size() - 8], bits, 8);
+		return;
+	}
+	case classad::ExprTree::STRING_LITERAL: {
+		std::string str;
+		((const classad::Literal *)expr)->GetValue(val);
+		val.IsStringValue(str);
+		PutByte(VALUE_STRING);
+		PutVarint(str.size());
+		m_buf.append(str);
+		return;
+	}
+	default:
+		PutByte(VALUE_EXPR);
+		PutString(text);
+		return;
+	}
+}
+
+bool
+ClassAdBinaryLog::GetByte(unsigned char &ch)
+{
+	if (m_pos >= m_buf.size()) {
+		return false;
+	}
+	ch = (unsigned char)m_buf[m_pos++];
+	return true;
+}
+
+bool
+ClassAdBinaryLog::GetVarint(uint64_t &val)
+{
+	val = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		unsigned char ch;
+		if ( ! GetByte(ch)) {
+			return false;
+		}
+		val |= (uint64_t)(ch & 0x7f) << shift;
+		if ( ! (ch & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool
+ClassAdBinaryLog::GetString(char *&str)
+{
+	uint64_t len;
+	if ( ! GetVarint(len) || len > m_buf.size() - m_pos) {
+		return false;
+	}
+	str = (char *)malloc(len + 1);
+	ASSERT(str);
+	memcpy(str, m_buf.data() + m_pos, len);
+	str[len] = 0;
+	m_pos += len;
+	return true;
+}
+
+bool
+ClassAdBinaryLog::GetName(char *&name)
+{
+	uint64_t index;
+	if ( ! GetVarint(index)) {
+		return false;
+	}
+	if (index < m_names.size()) {
+		name = strdup(m_names[index].c_str());
+		ASSERT(name);
+		return true;
+	}
+	if (index > m_names.size()) {
+		m_unknown_name = true;
+		return false;
+	}
+	if ( ! GetString(name)) {
+		return false;
+	}
+	m_names.emplace_back(name);
+	m_indexes.emplace(m_names.back(), (uint32_t)index);
+	return true;
+}
+
+bool
+ClassAdBinaryLog::GetValue(char *&text, classad::ExprTree *&expr)
+{
+	unsigned char tag;
+	text = NULL;
+	expr = NULL;
+	if ( ! GetByte(tag)) {
+		return false;
+	}
+	switch (tag) {
+	case VALUE_EXPR:
+		return GetString(text);
+	case VALUE_UNDEFINED:
+		expr = classad::Literal::MakeUndefined();
+		break;
+	case VALUE_ERROR:
+		expr = classad::Literal::MakeError();
+		break;
+	case VALUE_FALSE:
+	case VALUE_TRUE:
+		expr = classad::Literal::MakeBool(tag == VALUE_TRUE);
+		break;
+	case VALUE_INTEGER: {
+		uint64_t zz;
+		if ( ! GetVarint(zz)) {
+			return false;
+		}
+		expr = classad::Literal::MakeInteger((long long)(zz >> 1) ^ -(long long)(zz & 1));
+		break;
+	}
+	case VALUE_REAL: {
+		if (m_buf.size() - m_pos < 8) {
+			return false;
+		}
+		uint64_t bits = get_le((const unsigned char *)m_buf.data() + m_pos, 8);
+		double dval;
+		memcpy(&dval, &bits, sizeof(dval));
+		m_pos += 8;
+		expr = classad::Literal::MakeReal(dval);
+		break;
+	}
+	case VALUE_STRING: {
+		uint64_t len;
+		if ( ! GetVarint(len) || len > m_buf.size() - m_pos) {
+			return false;
+		}
+		expr = classad::Literal::MakeString(m_buf.data() + m_pos, len);
+		m_pos += len;
+		break;
+	}
+	default:
+		return false;
+	}
+	return expr != NULL;
+}
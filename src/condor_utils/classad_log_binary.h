@@ -0,0 +1,147 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _CLASSAD_LOG_BINARY_H
+#define _CLASSAD_LOG_BINARY_H
+
+#include "condor_common.h"
+#include "condor_classad.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class LogRecord;
+class ConstructLogEntry;
+
+/*
+   The binary format of a ClassAdLog.
+
+   The file starts with an 8 byte magic number, a 4 byte version and an 8
+   byte id that is chosen when the file is created.  After that each record
+   is a 4 byte length and a 4 byte CRC-32 of the record followed by that
+   many bytes: the op type of the record in one byte, and then the body of
+   the record.  Fixed size integers are little endian, lengths and other
+   integers in the body are varints, and a string is its length followed
+   by its bytes.
+
+   Attribute names are interned.  The first time that a name is written to
+   a file it is written as the next unused index followed by the name, after
+   that only the index is written.  So the names are known to a reader that
+   reads the file from the start, see Rescan() for one that doesn't.  The
+   names stay valid for as long as the file id doesn't change, so a reader
+   that comes back to the same file keeps them, see CheckHeader().
+
+   The value of a SetAttribute is written as a literal of a known type when
+   it is one, so that it can be replayed without parsing it, otherwise it is
+   written as the text of the expression.
+*/
+class ClassAdBinaryLog
+{
+public:
+	static const int VERSION = 2;
+	static const int HEADER_SIZE = 20;
+
+	enum ReadStatus {
+		READ_OK,
+		READ_EOF,          // no more records
+		READ_TRUNCATED,    // the file ends in the middle of a record
+		READ_CORRUPT,      // the record could not be decoded
+		READ_UNKNOWN_NAME, // the record uses a name that was defined before the offset where reading began
+	};
+
+	ClassAdBinaryLog() {}
+
+	// returns true if the file starts with the binary log magic number.
+	// the file position is not changed.
+	static bool IsBinaryLog(FILE *fp);
+
+	// forget the interned names, as for a new file
+	void Reset();
+
+	// start a new file by writing the header at the current position.
+	// returns the number of bytes written or -1
+	int WriteHeader(FILE *fp);
+	// read and check the header at the current position, for a reader that
+	// is going to read the whole file.
+	bool ReadHeader(FILE *fp, std::string &errmsg);
+	// check the header without changing the file position, and forget the
+	// interned names if they were learned from a different file.
+	bool CheckHeader(FILE *fp, std::string &errmsg);
+
+	// write a record, returns the number of bytes written or -1
+	int Write(FILE *fp, LogRecord *log);
+
+	// read the next record, returns NULL if status is not READ_OK.
+	// op_type is set to the type of the record when it is known.
+	LogRecord *Read(FILE *fp, const ConstructLogEntry &ctor, ReadStatus &status, int &op_type);
+
+	// skip the next record without decoding it, returns false at the end of the file.
+	// if there is no good record at the current position, this skips to the
+	// next place where the length and checksum of a record are good.
+	bool Skip(FILE *fp, int &op_type);
+
+	// learn the names defined before offset by reading the file from the start.
+	// the file is left positioned at offset.
+	bool Rescan(FILE *fp, long long offset, const ConstructLogEntry &ctor);
+
+	size_t NumNames() const { return m_names.size(); }
+
+	// used by LogRecord::WriteBinaryBody()
+	void PutByte(unsigned char ch) { m_buf.push_back((char)ch); }
+	void PutVarint(uint64_t val);
+	void PutString(const char *str);
+	void PutName(const char *name);
+	void PutValue(const char *text, const classad::ExprTree *expr);
+
+	// used by LogRecord::ReadBinaryBody(), these return false if the record is bad.
+	// strings are returned in memory from malloc.
+	bool GetByte(unsigned char &ch);
+	bool GetVarint(uint64_t &val);
+	bool GetString(char *&str);
+	bool GetName(char *&name);
+	// sets expr if the value is a literal, otherwise sets text
+	bool GetValue(char *&text, classad::ExprTree *&expr);
+	bool AtEnd() const { return m_pos == m_buf.size(); }
+
+private:
+	enum ValueTag {
+		VALUE_EXPR = 0,
+		VALUE_UNDEFINED,
+		VALUE_ERROR,
+		VALUE_FALSE,
+		VALUE_TRUE,
+		VALUE_INTEGER,
+		VALUE_REAL,
+		VALUE_STRING,
+	};
+
+	bool ReadRecord(FILE *fp, ReadStatus &status, uint32_t max_len = UINT32_MAX);
+	bool ParseHeader(const unsigned char *hdr, size_t len, uint64_t &file_id, std::string &errmsg);
+
+	std::vector<std::string> m_names;                    // by index
+	std::unordered_map<std::string, uint32_t> m_indexes; // by name
+	uint64_t m_file_id {0};  // of the file that the names are from
+	std::string m_buf;       // the record being written or read
+	size_t m_pos {0};        // read position in m_buf
+	bool m_unknown_name {false};
+};
+
+#endif
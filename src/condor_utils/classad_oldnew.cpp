@@ -26,7 +26,9 @@
 
 #include "classad/classad_distribution.h"
 #include "classad_oldnew.h"
+#include "classad_wire.h"
 #include "compat_classad.h"
+#include <memory>
 
 // local helper functions, options are one or more of PUT_CLASSAD_* flags
 int _putClassAd(Stream *sock, const classad::ClassAd& ad, int options,
@@ -50,10 +52,16 @@ bool getClassAd( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
-	// at least numExprs are coming, but we may add
-	// my, target, and a couple extra right away
-
-	ad.rehash(numExprs + 5);
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		if ( ! getClassAdWire(sock, ad, 0)) {
+			return false;
+		}
+		numExprs = 0;
+	} else {
+		// at least numExprs are coming, but we may add
+		// my, target, and a couple extra right away
+		ad.rehash(numExprs + 5);
+	}
 
 		// pack exprs into classad
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -227,11 +235,16 @@ bool getClassAdEx( Stream *sock, classad::ClassAd& ad, int options)
 		return false;
 	}
 
-	// at least numExprs are coming, but we may add
-	// my, target, and a couple extra right away
-	// Auth (id,method) update(total,seq,lost,history)
-
-	if ( ! (options & GET_CLASSAD_NO_CLEAR)) {
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		// the ad is in the binary encoding, there is nothing to parse
+		if ( ! getClassAdWire(sock, ad, options)) {
+			return false;
+		}
+		numExprs = 0;
+	} else if ( ! (options & GET_CLASSAD_NO_CLEAR)) {
+		// at least numExprs are coming, but we may add
+		// my, target, and a couple extra right away
+		// Auth (id,method) update(total,seq,lost,history)
 		ad.rehash(numExprs + 2 + 7);
 	}
 
@@ -397,6 +410,10 @@ getClassAdNoTypes( Stream *sock, classad::ClassAd& ad )
  		return false;
 	}
 
+	if (numExprs == CLASSAD_WIRE_MARKER) {
+		return getClassAdWire(sock, ad, 0);
+	}
+
 		// pack exprs into classad
 	buffer = "[";
 	for( int i = 0 ; i < numExprs ; i++ ) {
@@ -649,9 +666,14 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options,
 		send_server_time = true;
 	}
 
-	sock->encode( );
-	if( !sock->code( numExprs ) ) {
-		return false;
+	std::unique_ptr<ClassAdWireWriter> wire;
+	if (ClassAdWireUsable(sock)) {
+		wire.reset(new ClassAdWireWriter(sock));
+	} else {
+		sock->encode( );
+		if( !sock->code( numExprs ) ) {
+			return false;
+		}
 	}
 
 	for(int pass = 0; pass < 2; pass++){
@@ -703,6 +725,11 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options,
 				}
 			}
 
+			if (wire) {
+				wire->add(attr, expr, encrypt_it);
+				continue;
+			}
+
 			buf = attr;
 			buf += " = ";
 			unp.Unparse( buf, expr );
@@ -718,6 +745,16 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options,
 		}
 	}
 
+	if (wire) {
+		if (send_server_time) {
+			wire->addInteger(ATTR_SERVER_TIME, (long long)time(NULL));
+		}
+		if ( ! wire->finish()) {
+			return false;
+		}
+		return _putClassAdTrailingInfo(sock, ad, false, excludeTypes);
+	}
+
 	return _putClassAdTrailingInfo(sock, ad, send_server_time, excludeTypes);
 }
 
@@ -761,9 +798,14 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 	}
 
 
-	sock->encode( );
-	if( !sock->code( numExprs ) ) {
-		return false;
+	std::unique_ptr<ClassAdWireWriter> wire;
+	if (ClassAdWireUsable(sock)) {
+		wire.reset(new ClassAdWireWriter(sock));
+	} else {
+		sock->encode( );
+		if( !sock->code( numExprs ) ) {
+			return false;
+		}
 	}
 
 	std::string buf;
@@ -775,14 +817,20 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 			continue;
 
 		classad::ExprTree const *expr = ad.Lookup(*attr);
+		bool encrypt_it = ! crypto_is_noop &&
+			(ClassAdAttributeIsPrivateAny(*attr) ||
+			(encrypted_attrs && (encrypted_attrs->find(*attr) != encrypted_attrs->end())));
+
+		if (wire) {
+			wire->add(*attr, expr, encrypt_it);
+			continue;
+		}
+
 		buf = *attr;
 		buf += " = ";
 		unp.Unparse( buf, expr );
 
-		if ( ! crypto_is_noop &&
-			(ClassAdAttributeIsPrivateAny(*attr) ||
-			(encrypted_attrs && (encrypted_attrs->find(*attr) != encrypted_attrs->end())))
-		) {
+		if (encrypt_it) {
 			if (!sock->put(SECRET_MARKER)) {
 				return false;
 			}
@@ -795,5 +843,15 @@ int _putClassAd( Stream *sock, const classad::ClassAd& ad, int options, const cl
 		}
 	}
 
+	if (wire) {
+		if (send_server_time) {
+			wire->addInteger(ATTR_SERVER_TIME, (long long)time(NULL));
+		}
+		if ( ! wire->finish()) {
+			return false;
+		}
+		return _putClassAdTrailingInfo(sock, ad, false, excludeTypes);
+	}
+
 	return _putClassAdTrailingInfo(sock, ad, send_server_time, excludeTypes);
 }
@@ -0,0 +1,657 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "stream.h"
+#include "classad/classad_distribution.h"
+#include "classad_oldnew.h"
+#include "classad_wire.h"
+
+// the type of each node of an expression in the binary encoding
+enum {
+	WIRE_UNDEFINED = 1,
+	WIRE_ERROR,
+	WIRE_TRUE,
+	WIRE_FALSE,
+	WIRE_INTEGER,      // zigzag varint
+	WIRE_REAL,         // 8 bytes, little endian IEEE double
+	WIRE_STRING,       // varint length, bytes
+	WIRE_ABSTIME,      // zigzag varint seconds, zigzag varint offset
+	WIRE_RELTIME,      // 8 bytes, like WIRE_REAL
+	WIRE_ATTR,         // name
+	WIRE_ABS_ATTR,     // name, for .name
+	WIRE_SCOPED_ATTR,  // name, expression of the scope, for expr.name
+	WIRE_OP,           // byte OpKind, byte number of operands, operands
+	WIRE_FNCALL,       // name, varint number of arguments, arguments
+	WIRE_LIST,         // varint number of items, items
+	WIRE_CLASSAD,      // varint number of attributes, name and expression of each
+	WIRE_SECRET,       // only at the top level, the expression is the next secret
+	WIRE_TEXT,         // varint length, old ClassAd text of an expression we can't encode
+};
+
+// A name is sent as a varint: 0 for a new name that is added to the table,
+// 1 for a name that is not added, followed by the length and bytes of the
+// name, or the index in the table plus 2.
+#define WIRE_NAME_NEW      0
+#define WIRE_NAME_INLINE   1
+#define WIRE_NAME_INDEX    2
+
+// the most names either end will intern in a single message
+#define WIRE_MAX_NAMES     16384
+
+// deepest expression we will decode, so that a bad peer can't blow our stack
+#define WIRE_MAX_DEPTH     1000
+
+static void putVarint(std::string &buf, unsigned long long val)
+{
+	while (val >= 0x80) {
+		buf += (char)(val | 0x80);
+		val >>= 7;
+	}
+	buf += (char)val;
+}
+
+static void putSigned(std::string &buf, long long val)
+{
+	putVarint(buf, ((unsigned long long)val << 1) ^ (unsigned long long)(val >> 63));
+}
+
+static void putFixed(std::string &buf, unsigned long long val, int bytes)
+{
+	for (int ii = 0; ii < bytes; ++ii) {
+		buf += (char)(val >> (8 * ii));
+	}
+}
+
+static void putDouble(std::string &buf, double val)
+{
+	unsigned long long bits;
+	memcpy(&bits, &val, sizeof(bits));
+	putFixed(buf, bits, 8);
+}
+
+static void putString(std::string &buf, const std::string &str)
+{
+	putVarint(buf, str.size());
+	buf += str;
+}
+
+static bool ClassAdWire_enabled = false;
+
+void ClassAdWireReconfig()
+{
+	ClassAdWire_enabled = param_boolean("ENABLE_CLASSAD_BINARY_ENCODING", false);
+}
+
+bool ClassAdWireUsable(Stream *sock)
+{
+	if ( ! ClassAdWire_enabled) {
+		return false;
+	}
+	// 24.1.0 daemons and tools built before the binary encoding was added
+	// report the same version, so only a later release is known to read it
+	const CondorVersionInfo *ver = sock->get_peer_version();
+	return ver && ver->built_since_version(CLASSAD_WIRE_MIN_PEER_MAJOR, CLASSAD_WIRE_MIN_PEER_MINOR, CLASSAD_WIRE_MIN_PEER_SUB);
+}
+
+ClassAdWireWriter::ClassAdWireWriter(Stream *sock)
+	: m_sock(sock)
+	, m_state(sock->classad_wire_state())
+	, m_num_attrs(0)
+{
+	m_buf.reserve(16384);
+	m_buf += (char)CLASSAD_WIRE_VERSION;
+	putVarint(m_buf, m_state.put_names.size());
+	m_count_pos = m_buf.size();
+	putFixed(m_buf, 0, 4);   // num_attrs, filled in by finish()
+	putFixed(m_buf, 0, 4);   // num_secrets
+}
+
+void ClassAdWireWriter::putName(const std::string &name)
+{
+	auto it = m_state.put_names.find(name);
+	if (it != m_state.put_names.end()) {
+		putVarint(m_buf, it->second + WIRE_NAME_INDEX);
+		return;
+	}
+	if (m_state.put_names.size() < WIRE_MAX_NAMES) {
+		unsigned int index = m_state.put_names.size();
+		m_state.put_names.emplace(name, index);
+		putVarint(m_buf, WIRE_NAME_NEW);
+	} else {
+		putVarint(m_buf, WIRE_NAME_INLINE);
+	}
+	putString(m_buf, name);
+}
+
+void ClassAdWireWriter::putExpr(const classad::ExprTree *expr)
+{
+	expr = expr->self();   // look through cache envelopes
+
+	switch (expr->GetKind()) {
+	case classad::ExprTree::UNDEFINED_LITERAL:
+		m_buf += (char)WIRE_UNDEFINED;
+		break;
+	case classad::ExprTree::ERROR_LITERAL:
+		m_buf += (char)WIRE_ERROR;
+		break;
+	case classad::ExprTree::BOOLEAN_LITERAL:
+		m_buf += (char)(static_cast<const classad::BooleanLiteral*>(expr)->getBool() ? WIRE_TRUE : WIRE_FALSE);
+		break;
+	case classad::ExprTree::INTEGER_LITERAL:
+		m_buf += (char)WIRE_INTEGER;
+		putSigned(m_buf, static_cast<const classad::IntegerLiteral*>(expr)->getInteger());
+		break;
+	case classad::ExprTree::REAL_LITERAL:
+		m_buf += (char)WIRE_REAL;
+		putDouble(m_buf, static_cast<const classad::RealLiteral*>(expr)->getReal());
+		break;
+	case classad::ExprTree::STRING_LITERAL:
+		m_buf += (char)WIRE_STRING;
+		putString(m_buf, static_cast<const classad::StringLiteral*>(expr)->getString());
+		break;
+	case classad::ExprTree::ABSTIME_LITERAL: {
+		classad::abstime_t at = static_cast<const classad::AbstimeLiteral*>(expr)->getAbstime();
+		m_buf += (char)WIRE_ABSTIME;
+		putSigned(m_buf, at.secs);
+		putSigned(m_buf, at.offset);
+		break;
+	}
+	case classad::ExprTree::RELTIME_LITERAL:
+		m_buf += (char)WIRE_RELTIME;
+		putDouble(m_buf, static_cast<const classad::ReltimeLiteral*>(expr)->getReltime());
+		break;
+	case classad::ExprTree::ATTRREF_NODE: {
+		classad::ExprTree *scope = nullptr;
+		std::string name;
+		bool absolute = false;
+		static_cast<const classad::AttributeReference*>(expr)->GetComponents(scope, name, absolute);
+		if (scope) {
+			m_buf += (char)WIRE_SCOPED_ATTR;
+			putName(name);
+			putExpr(scope);
+		} else {
+			m_buf += (char)(absolute ? WIRE_ABS_ATTR : WIRE_ATTR);
+			putName(name);
+		}
+		break;
+	}
+	case classad::ExprTree::OP_NODE: {
+		classad::Operation::OpKind op = classad::Operation::__NO_OP__;
+		classad::ExprTree *args[3] = { nullptr, nullptr, nullptr };
+		static_cast<const classad::Operation*>(expr)->GetComponents(op, args[0], args[1], args[2]);
+		int num_args = args[2] ? 3 : (args[1] ? 2 : (args[0] ? 1 : 0));
+		m_buf += (char)WIRE_OP;
+		m_buf += (char)op;
+		m_buf += (char)num_args;
+		for (int ii = 0; ii < num_args; ++ii) {
+			putExpr(args[ii]);
+		}
+		break;
+	}
+	case classad::ExprTree::FN_CALL_NODE: {
+		std::string name;
+		std::vector<classad::ExprTree*> args;
+		static_cast<const classad::FunctionCall*>(expr)->GetComponents(name, args);
+		m_buf += (char)WIRE_FNCALL;
+		putName(name);
+		putVarint(m_buf, args.size());
+		for (const classad::ExprTree *arg : args) {
+			putExpr(arg);
+		}
+		break;
+	}
+	case classad::ExprTree::EXPR_LIST_NODE: {
+		const classad::ExprList *list = static_cast<const classad::ExprList*>(expr);
+		m_buf += (char)WIRE_LIST;
+		putVarint(m_buf, list->size());
+		for (const classad::ExprTree *item : *list) {
+			putExpr(item);
+		}
+		break;
+	}
+	case classad::ExprTree::CLASSAD_NODE: {
+		const classad::ClassAd *ad = static_cast<const classad::ClassAd*>(expr);
+		m_buf += (char)WIRE_CLASSAD;
+		putVarint(m_buf, ad->size());
+		for (const auto &[name, tree] : *ad) {
+			putName(name);
+			putExpr(tree);
+		}
+		break;
+	}
+	default: {
+		// a kind of node that this version doesn't know how to encode
+		classad::ClassAdUnParser unp;
+		unp.SetOldClassAd(true, true);
+		std::string text;
+		unp.Unparse(text, expr);
+		m_buf += (char)WIRE_TEXT;
+		putString(m_buf, text);
+		break;
+	}
+	}
+}
+
+void ClassAdWireWriter::add(const std::string &attr, const classad::ExprTree *expr, bool encrypt_it)
+{
+	putName(attr);
+	if (encrypt_it) {
+		classad::ClassAdUnParser unp;
+		unp.SetOldClassAd(true, true);
+		m_secrets.emplace_back();
+		unp.Unparse(m_secrets.back(), expr);
+		m_buf += (char)WIRE_SECRET;
+	} else {
+		putExpr(expr);
+	}
+	++m_num_attrs;
+}
+
+void ClassAdWireWriter::addInteger(const std::string &attr, long long value)
+{
+	putName(attr);
+	m_buf += (char)WIRE_INTEGER;
+	putSigned(m_buf, value);
+	++m_num_attrs;
+}
+
+bool ClassAdWireWriter::finish()
+{
+	for (int ii = 0; ii < 4; ++ii) {
+		m_buf[m_count_pos + ii] = (char)(m_num_attrs >> (8 * ii));
+		m_buf[m_count_pos + 4 + ii] = (char)(m_secrets.size() >> (8 * ii));
+	}
+
+	int marker = CLASSAD_WIRE_MARKER;
+	int len = (int)m_buf.size();
+	m_sock->encode();
+	if ( ! m_sock->code(marker) || ! m_sock->code(len) ||
+		m_sock->put_bytes(m_buf.data(), len) != len) {
+		return false;
+	}
+	for (const auto &secret : m_secrets) {
+		if ( ! m_sock->put_secret(secret.c_str())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+namespace {
+
+// the number of operands of op, the evaluator trusts that an operation has them all
+int operandCount(classad::Operation::OpKind op)
+{
+	switch (op) {
+	case classad::Operation::UNARY_PLUS_OP:
+	case classad::Operation::UNARY_MINUS_OP:
+	case classad::Operation::LOGICAL_NOT_OP:
+	case classad::Operation::BITWISE_NOT_OP:
+	case classad::Operation::PARENTHESES_OP:
+		return 1;
+	case classad::Operation::TERNARY_OP:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+// Decodes the block of bytes of one ad
+class ClassAdWireReader {
+public:
+	ClassAdWireReader(const std::string &buf, std::vector<std::string> &names)
+		: m_ptr((const unsigned char *)buf.data()), m_end(m_ptr + buf.size()), m_names(names) {}
+
+	bool getByte(unsigned char &val) {
+		if (m_ptr >= m_end) return false;
+		val = *m_ptr++;
+		return true;
+	}
+
+	bool getVarint(unsigned long long &val) {
+		val = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			unsigned char ch;
+			if ( ! getByte(ch)) return false;
+			val |= (unsigned long long)(ch & 0x7f) << shift;
+			if ( ! (ch & 0x80)) return true;
+		}
+		return false;
+	}
+
+	bool getSigned(long long &val) {
+		unsigned long long uval;
+		if ( ! getVarint(uval)) return false;
+		val = (long long)(uval >> 1) ^ -(long long)(uval & 1);
+		return true;
+	}
+
+	bool getFixed(unsigned long long &val, int bytes) {
+		if (m_end - m_ptr < bytes) return false;
+		val = 0;
+		for (int ii = 0; ii < bytes; ++ii) {
+			val |= (unsigned long long)m_ptr[ii] << (8 * ii);
+		}
+		m_ptr += bytes;
+		return true;
+	}
+
+	bool getDouble(double &val) {
+		unsigned long long bits;
+		if ( ! getFixed(bits, 8)) return false;
+		memcpy(&val, &bits, sizeof(val));
+		return true;
+	}
+
+	// returns a pointer to len bytes of string in the buffer
+	bool getString(const char *&str, size_t &len) {
+		unsigned long long ulen;
+		if ( ! getVarint(ulen) || ulen > (unsigned long long)(m_end - m_ptr)) return false;
+		str = (const char *)m_ptr;
+		len = (size_t)ulen;
+		m_ptr += len;
+		return true;
+	}
+
+	bool getName(std::string &name) {
+		unsigned long long ref;
+		if ( ! getVarint(ref)) return false;
+		if (ref >= WIRE_NAME_INDEX) {
+			ref -= WIRE_NAME_INDEX;
+			if (ref >= m_names.size()) return false;
+			name = m_names[ref];
+			return true;
+		}
+		const char *str;
+		size_t len;
+		if ( ! getString(str, len)) return false;
+		name.assign(str, len);
+		if (ref == WIRE_NAME_NEW) {
+			if (m_names.size() >= WIRE_MAX_NAMES) return false;
+			m_names.push_back(name);
+		}
+		return true;
+	}
+
+	// consume the next byte if it is tag
+	bool nextIs(unsigned char tag) {
+		if (m_ptr < m_end && *m_ptr == tag) {
+			++m_ptr;
+			return true;
+		}
+		return false;
+	}
+
+	// returns a new expression, or NULL if the bytes are bad
+	classad::ExprTree *getExpr(int depth);
+
+	bool atEnd() const { return m_ptr == m_end; }
+
+private:
+	const unsigned char *m_ptr;
+	const unsigned char *m_end;
+	std::vector<std::string> &m_names;
+};
+
+classad::ExprTree *ClassAdWireReader::getExpr(int depth)
+{
+	unsigned char tag;
+	if (depth > WIRE_MAX_DEPTH || ! getByte(tag)) {
+		return nullptr;
+	}
+
+	switch (tag) {
+	case WIRE_UNDEFINED:
+		return classad::Literal::MakeUndefined();
+	case WIRE_ERROR:
+		return classad::Literal::MakeError();
+	case WIRE_TRUE:
+	case WIRE_FALSE:
+		return classad::Literal::MakeBool(tag == WIRE_TRUE);
+	case WIRE_INTEGER: {
+		long long val;
+		if ( ! getSigned(val)) return nullptr;
+		return classad::Literal::MakeInteger(val);
+	}
+	case WIRE_REAL: {
+		double val;
+		if ( ! getDouble(val)) return nullptr;
+		return classad::Literal::MakeReal(val);
+	}
+	case WIRE_STRING: {
+		const char *str;
+		size_t len;
+		if ( ! getString(str, len)) return nullptr;
+		return classad::Literal::MakeString(str, len);
+	}
+	case WIRE_ABSTIME: {
+		long long secs, offset;
+		if ( ! getSigned(secs) || ! getSigned(offset)) return nullptr;
+		classad::abstime_t at;
+		at.secs = (time_t)secs;
+		at.offset = (int)offset;
+		return classad::Literal::MakeAbsTime(&at);
+	}
+	case WIRE_RELTIME: {
+		double secs;
+		if ( ! getDouble(secs)) return nullptr;
+		classad::Value val;
+		val.SetRelativeTimeValue(secs);
+		return classad::Literal::MakeLiteral(val);
+	}
+	case WIRE_ATTR:
+	case WIRE_ABS_ATTR: {
+		std::string name;
+		if ( ! getName(name)) return nullptr;
+		return classad::AttributeReference::MakeAttributeReference(nullptr, name, tag == WIRE_ABS_ATTR);
+	}
+	case WIRE_SCOPED_ATTR: {
+		std::string name;
+		if ( ! getName(name)) return nullptr;
+		classad::ExprTree *scope = getExpr(depth + 1);
+		if ( ! scope) return nullptr;
+		return classad::AttributeReference::MakeAttributeReference(scope, name, false);
+	}
+	case WIRE_OP: {
+		unsigned char op, num_args;
+		if ( ! getByte(op) || ! getByte(num_args) ||
+			op < classad::Operation::__FIRST_OP__ || op > classad::Operation::__LAST_OP__ ||
+			num_args != operandCount((classad::Operation::OpKind)op)) {
+			return nullptr;
+		}
+		classad::ExprTree *args[3] = { nullptr, nullptr, nullptr };
+		for (int ii = 0; ii < num_args; ++ii) {
+			args[ii] = getExpr(depth + 1);
+			if ( ! args[ii]) {
+				for (int jj = 0; jj < ii; ++jj) { delete args[jj]; }
+				return nullptr;
+			}
+		}
+		return classad::Operation::MakeOperation((classad::Operation::OpKind)op, args[0], args[1], args[2]);
+	}
+	case WIRE_FNCALL:
+	case WIRE_LIST: {
+		std::string name;
+		unsigned long long count;
+		if ((tag == WIRE_FNCALL && ! getName(name)) || ! getVarint(count) ||
+			count > (unsigned long long)(m_end - m_ptr)) {
+			return nullptr;
+		}
+		std::vector<classad::ExprTree*> items;
+		items.reserve(count);
+		for (unsigned long long ii = 0; ii < count; ++ii) {
+			classad::ExprTree *item = getExpr(depth + 1);
+			if ( ! item) {
+				for (auto *done : items) { delete done; }
+				return nullptr;
+			}
+			items.push_back(item);
+		}
+		if (tag == WIRE_FNCALL) {
+			return classad::FunctionCall::MakeFunctionCall(name, items);
+		}
+		return classad::ExprList::MakeExprList(items);
+	}
+	case WIRE_CLASSAD: {
+		unsigned long long count;
+		if ( ! getVarint(count) || count > (unsigned long long)(m_end - m_ptr)) {
+			return nullptr;
+		}
+		classad::ClassAd *ad = new classad::ClassAd();
+		std::string name;
+		for (unsigned long long ii = 0; ii < count; ++ii) {
+			classad::ExprTree *tree = nullptr;
+			if ( ! getName(name) || ! (tree = getExpr(depth + 1)) || ! ad->Insert(name, tree)) {
+				delete tree;
+				delete ad;
+				return nullptr;
+			}
+		}
+		return ad;
+	}
+	case WIRE_TEXT: {
+		const char *str;
+		size_t len;
+		if ( ! getString(str, len)) return nullptr;
+		classad::ClassAdParser parser;
+		parser.SetOldClassAd(true);
+		return parser.ParseExpression(std::string(str, len));
+	}
+	}
+
+	return nullptr;
+}
+
+} // namespace
+
+// insert an expression that we decoded into the ad.  Decoded expressions are
+// not shared through the ClassAd cache the way getClassAdEx() shares the ones it
+// parses: the cache is keyed on the text of the expression, and making that key
+// would cost as much as the parse that the binary encoding saves.  The wire bytes
+// can't be the key either, interned names make them depend on the message.
+static bool insertWireExpr(classad::ClassAd &ad, const std::string &attr, classad::ExprTree *tree)
+{
+	if ( ! ad.Insert(attr, tree)) {
+		delete tree;
+		return false;
+	}
+	return true;
+}
+
+bool getClassAdWire(Stream *sock, classad::ClassAd &ad, int options)
+{
+	bool use_cache = ! (options & GET_CLASSAD_NO_CACHE) && classad::ClassAdGetExpressionCaching();
+
+	int len = 0;
+	if ( ! sock->code(len) || len < 0) {
+		dprintf(D_FULLDEBUG, "getClassAd FAILED to get length of binary ad\n");
+		return false;
+	}
+	// read in chunks so that a bad length can't make us allocate more than was sent
+	std::string buf;
+	while ((int)buf.size() < len) {
+		int chunk = MIN(len - (int)buf.size(), 65536);
+		size_t pos = buf.size();
+		buf.resize(pos + chunk);
+		if (sock->get_bytes(&buf[pos], chunk) != chunk) {
+			dprintf(D_FULLDEBUG, "getClassAd FAILED to get %d bytes of binary ad\n", len);
+			return false;
+		}
+	}
+
+	std::vector<std::string> &names = sock->classad_wire_state().get_names;
+	ClassAdWireReader reader(buf, names);
+
+	unsigned char version = 0;
+	unsigned long long names_base = 0, num_attrs = 0, num_secrets = 0;
+	if ( ! reader.getByte(version) || ! reader.getVarint(names_base) ||
+		! reader.getFixed(num_attrs, 4) || ! reader.getFixed(num_secrets, 4)) {
+		dprintf(D_ALWAYS, "getClassAd FAILED, binary ad is too short\n");
+		return false;
+	}
+	if (version != CLASSAD_WIRE_VERSION) {
+		dprintf(D_ALWAYS, "getClassAd FAILED, binary ad has unknown version %d\n", (int)version);
+		return false;
+	}
+	if (names_base != names.size()) {
+		dprintf(D_ALWAYS, "getClassAd FAILED, binary ad expects %llu names, we have %zu\n", names_base, names.size());
+		return false;
+	}
+
+	if (num_attrs > buf.size()) {
+		dprintf(D_ALWAYS, "getClassAd FAILED, binary ad is malformed\n");
+		return false;
+	}
+	ad.rehash(num_attrs + 2 + 7);
+
+	std::string attr;
+	std::vector<std::string> secret_attrs;
+	for (unsigned long long ii = 0; ii < num_attrs; ++ii) {
+		if ( ! reader.getName(attr) || attr.empty()) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to decode name of attribute %llu of binary ad\n", ii);
+			return false;
+		}
+		if (reader.nextIs(WIRE_SECRET)) {
+			// the expression is sent after the ad
+			secret_attrs.push_back(attr);
+			continue;
+		}
+		classad::ExprTree *tree = reader.getExpr(0);
+		if ( ! tree) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to decode %s in binary ad\n", attr.c_str());
+			return false;
+		}
+		if ( ! insertWireExpr(ad, attr, tree)) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to insert %s\n", attr.c_str());
+			return false;
+		}
+	}
+	if ( ! reader.atEnd() || secret_attrs.size() != num_secrets) {
+		dprintf(D_ALWAYS, "getClassAd FAILED, binary ad is malformed\n");
+		return false;
+	}
+
+	for (const auto &secret_attr : secret_attrs) {
+		const char *rhs = nullptr;
+		int cb = 0;
+		if ( ! sock->get_secret(rhs, cb) || ! rhs) {
+			dprintf(D_FULLDEBUG, "getClassAd Failed to read encrypted ClassAd expression.\n");
+			return false;
+		}
+		bool inserted;
+		if (use_cache) {
+			inserted = ad.InsertViaCache(secret_attr, rhs);
+		} else {
+			classad::ClassAdParser parser;
+			parser.SetOldClassAd(true);
+			classad::ExprTree *tree = parser.ParseExpression(rhs);
+			inserted = tree && ad.Insert(secret_attr, tree);
+		}
+		if ( ! inserted) {
+			dprintf(D_ALWAYS, "getClassAd FAILED to insert secret %s\n", secret_attr.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,111 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _CLASSAD_WIRE_H
+#define _CLASSAD_WIRE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The binary encoding of ClassAds on a CEDAR stream.
+//
+// putClassAd() normally sends each attribute as a "name = expr" string that the
+// receiver must lex and parse.  When the peer is known (from the security
+// handshake) to be at least CLASSAD_WIRE_MIN_PEER_* and
+// ENABLE_CLASSAD_BINARY_ENCODING is true (it is false by default), it
+// sends CLASSAD_WIRE_MARKER in place of the attribute count instead, followed
+// by the whole ad as a single block of bytes:
+//
+//    version       byte, CLASSAD_WIRE_VERSION
+//    names_base    varint, the number of names the sender has interned so far
+//    num_attrs     4 bytes, little endian
+//    num_secrets   4 bytes, little endian
+//    num_attrs times: name, expression
+//
+// Literals are sent as typed values, other expressions as their tree, so the
+// receiver doesn't run the ClassAd parser, except for a kind of expression node
+// that the sender can't encode, which is sent as text.  Attribute names, including the names
+// in attribute references, are interned: the first time a name is sent it is
+// sent in full, after that by its index in the table.  The tables of both ends
+// are forgotten at the end of each CEDAR message, so an ad never depends on a
+// message that came before it, and a socket can be handed to another process
+// between messages.  Attributes that must be encrypted are sent as text with
+// put_secret() after the block of bytes, in the order they appear in the ad.
+//
+// getClassAd() and friends accept both encodings, whatever the peer version.
+
+#define CLASSAD_WIRE_MARKER  (-0x43414457)   // "CADW", never a valid attribute count
+#define CLASSAD_WIRE_VERSION 1
+// the first release whose daemons and tools read the binary encoding
+#define CLASSAD_WIRE_MIN_PEER_MAJOR 24
+#define CLASSAD_WIRE_MIN_PEER_MINOR 2
+#define CLASSAD_WIRE_MIN_PEER_SUB   0
+
+namespace classad {
+	class ClassAd;
+	class ExprTree;
+}
+class Stream;
+
+// Interned attribute names of one direction of a stream for the current message.
+class ClassAdWireState {
+public:
+	void clear() { put_names.clear(); get_names.clear(); }
+
+	std::unordered_map<std::string, unsigned int> put_names;
+	std::vector<std::string> get_names;
+};
+
+// Builds the binary encoding of one ad, see putClassAd() in classad_oldnew.cpp.
+class ClassAdWireWriter {
+public:
+	explicit ClassAdWireWriter(Stream *sock);
+
+	// add an attribute, encrypted attributes are sent as secrets by finish()
+	void add(const std::string &attr, const classad::ExprTree *expr, bool encrypt_it);
+	void addInteger(const std::string &attr, long long value);
+
+	// send the marker, the ad and its secrets
+	bool finish();
+
+private:
+	void putName(const std::string &name);
+	void putExpr(const classad::ExprTree *expr);
+
+	Stream *m_sock;
+	ClassAdWireState &m_state;
+	std::string m_buf;
+	std::vector<std::string> m_secrets;
+	unsigned int m_num_attrs;
+	size_t m_count_pos;     // position of num_attrs in m_buf
+};
+
+// returns true if putClassAd() should use the binary encoding on sock
+bool ClassAdWireUsable(Stream *sock);
+
+// re-read ENABLE_CLASSAD_BINARY_ENCODING, called by ClassAdReconfig()
+void ClassAdWireReconfig();
+
+// Read an ad in the binary encoding, after its CLASSAD_WIRE_MARKER has been read.
+// options are GET_CLASSAD_* flags, only GET_CLASSAD_NO_CACHE is used.  The ad is
+// not cleared first.
+bool getClassAdWire(Stream *sock, classad::ClassAd &ad, int options);
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "condor_classad.h"
 #include "classad_oldnew.h"
+#include "classad_wire.h"
 #include "condor_attributes.h"
 #include "classad/xmlSink.h"
 #include "condor_config.h"
@@ -68,6 +69,7 @@ void ClassAdReconfig()
 	classad::SetOldClassAdSemantics( !ClassAd_strictEvaluation );
 
 	classad::ClassAdSetExpressionCaching( param_boolean( "ENABLE_CLASSAD_CACHING", false ) );
+	ClassAdWireReconfig();
 
 	char *new_libs = param( "CLASSAD_USER_LIBS" );
 	if ( new_libs ) {
@@ -157,8 +157,6 @@ bool IsATargetMatch( ClassAd *my, ClassAd *target, const char * targetType );
 // but does *NOT* care about TargetType
 bool IsAConstraintMatch( ClassAd *query, ClassAd *target );
 
-bool ParallelIsAMatch(ClassAd *ad1, std::vector<ClassAd*> &candidates, std::vector<ClassAd*> &matches, int threads, bool halfMatch = false);
-
 void AddClassAdXMLFileHeader(std::string &buffer);
 void AddClassAdXMLFileFooter(std::string &buffer);
 
@@ -55,6 +55,7 @@ CondorQ(void)
 	scheddBirthdate = 0;
 	useDefaultingOperator(false);
 	requestservertime = false;
+	page_size = 0;
 }
 
 void CondorQ::useDefaultingOperator(bool enable)
@@ -320,6 +321,9 @@ CondorQ::fetchQueueFromHostAndProcessV2(const char *host,
 		}
 	}
 
+	if (page_size > 0 && match_limit < 0 && (fetch_opts & ~QueryFetchOpts::fetch_MyJobs) == QueryFetchOpts::fetch_Jobs) {
+		return schedd.queryJobsPaged(cmd, request_ad, page_size, process_func, process_func_data, connect_timeout, errstack, psummary_ad);
+	}
 	return schedd.queryJobs(cmd, request_ad, process_func, process_func_data, connect_timeout, errstack, psummary_ad);
 }
 
@@ -111,6 +111,10 @@ class CondorQ
 
 	void requestServerTime(bool request) { requestservertime = request; }
 
+	// fetch the jobs in pages of this many ads, 0 to fetch them all at once.
+	// only used for queries of jobs that have no match limit.
+	void setPageSize(int size) { page_size = size; }
+
   private:
 	GenericQuery query;
 	
@@ -128,6 +132,7 @@ class CondorQ
 	char schedd[MAXSCHEDDLEN];
 	bool defaulting_operator;
 	bool requestservertime;
+	int page_size;
 	time_t scheddBirthdate;
 	
 	// helper functions
@@ -248,9 +248,30 @@ htcondor::discover_token()
 #endif
 }
 
+htcondor::SciTokenConfig
+htcondor::scitoken_config_from_params()
+{
+	SciTokenConfig config;
+	param(config.audience, "SCITOKENS_SERVER_AUDIENCE");
+	config.allow_foreign_token_types = param_boolean("SEC_SCITOKENS_ALLOW_FOREIGN_TOKEN_TYPES", false);
+	if (config.allow_foreign_token_types) {
+		param(config.foreign_token_issuers, "SEC_SCITOKENS_FOREIGN_TOKEN_ISSUERS");
+	}
+	return config;
+}
+
 bool
 htcondor::validate_scitoken(const std::string &scitoken_str, std::string &issuer, std::string &subject,
 	long long &expiry, std::vector<std::string> &bounding_set, std::vector<std::string> &groups, std::vector<std::string> &scopes, std::string &jti, int ident, CondorError &err)
+{
+	return validate_scitoken(scitoken_str, issuer, subject, expiry, bounding_set, groups, scopes, jti,
+		scitoken_config_from_params(), ident, err);
+}
+
+bool
+htcondor::validate_scitoken(const std::string &scitoken_str, std::string &issuer, std::string &subject,
+	long long &expiry, std::vector<std::string> &bounding_set, std::vector<std::string> &groups, std::vector<std::string> &scopes, std::string &jti,
+	const SciTokenConfig &config, int ident, CondorError &err)
 {
 	if (!htcondor::init_scitokens()) {
 		err.pushf("SCITOKENS", 1, "Failed to open SciTokens library.");
@@ -278,13 +299,12 @@ htcondor::validate_scitoken(const std::string &scitoken_str, std::string &issuer
 	Acl *acls = nullptr;
 	std::vector<std::string> audiences;
 	std::vector<const char *> audience_ptr;
-	std::string audience_string;
 	bool foreign_token = false;
-	if (param(audience_string, "SCITOKENS_SERVER_AUDIENCE")) {
-		for (auto& aud: StringTokenIterator(audience_string)) {
-			audiences.emplace_back(aud);
-			audience_ptr.push_back(audiences.back().c_str());
-		}
+	for (auto& aud: StringTokenIterator(config.audience)) {
+		audiences.emplace_back(aud);
+	}
+	for (auto& aud: audiences) {
+		audience_ptr.push_back(aud.c_str());
 	}
 	audience_ptr.push_back(nullptr);
 	long long expiry_value;
@@ -325,13 +345,11 @@ htcondor::validate_scitoken(const std::string &scitoken_str, std::string &issuer
 		return false;
 	} else if ((*enforcer_generate_acls_ptr)(enf, token, &acls, &err_msg)) {
 		bool allow_foreign_token = false;
-		if (param_boolean("SEC_SCITOKENS_ALLOW_FOREIGN_TOKEN_TYPES", false)) {
-			std::string foreign_issuers;
-			param(foreign_issuers, "SEC_SCITOKENS_FOREIGN_TOKEN_ISSUERS");
-			if (foreign_issuers == "*") {
+		if (config.allow_foreign_token_types) {
+			if (config.foreign_token_issuers == "*") {
 				allow_foreign_token = true;
 			} else {
-				for (auto& s: StringTokenIterator(foreign_issuers)) {
+				for (auto& s: StringTokenIterator(config.foreign_token_issuers)) {
 					if (s == iss) {
 						allow_foreign_token = true;
 						break;
@@ -13,6 +13,17 @@ namespace htcondor {
 bool
 init_scitokens();
 
+	// The configuration that validate_scitoken() uses.
+struct SciTokenConfig {
+	std::string audience;                   // SCITOKENS_SERVER_AUDIENCE
+	bool allow_foreign_token_types{false};  // SEC_SCITOKENS_ALLOW_FOREIGN_TOKEN_TYPES
+	std::string foreign_token_issuers;      // SEC_SCITOKENS_FOREIGN_TOKEN_ISSUERS
+};
+
+	// Read the SciTokenConfig from the config.
+SciTokenConfig
+scitoken_config_from_params();
+
 	// Validate a given scitoken and populate the output variables (issuer,
 	// subject, expiry, bounding_set) with the corresponding information
 	// from the token.
@@ -23,6 +34,15 @@ validate_scitoken(const std::string &scitoken_str, std::string &issuer, std::str
 	long long &expiry, std::vector<std::string> &bounding_set, std::vector<std::string> &groups,
 	std::vector<std::string> &scopes, std::string &jti, int ident, CondorError &err);
 
+	// The same, but with the given configuration rather than the config.
+	// This doesn't call param(), so once init_scitokens() has been called,
+	// it may be called from a thread other than the main thread.
+bool
+validate_scitoken(const std::string &scitoken_str, std::string &issuer, std::string &subject,
+	long long &expiry, std::vector<std::string> &bounding_set, std::vector<std::string> &groups,
+	std::vector<std::string> &scopes, std::string &jti, const SciTokenConfig &config,
+	int ident, CondorError &err);
+
 	// Determine the value of the current token from the process's environment.
 	// Follows the WLCG Bearer Token Discovery schema.
 	// On error or no token discovered, returns the empty string.
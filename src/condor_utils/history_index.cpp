@@ -0,0 +1,157 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "basename.h"
+#include "directory_util.h"
+
+#include "history_index.h"
+
+void
+HistoryIndexFilename(const char * history_file, std::string & index_file)
+{
+	std::string dir = condor_dirname(history_file);
+	std::string name = ".";
+	name += condor_basename(history_file);
+	name += ".idx";
+	index_file.clear();
+	dircat(dir.c_str(), name.c_str(), index_file);
+}
+
+uint32_t
+HistoryIndexOwnerHash(const char * owner)
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for (const unsigned char * p = (const unsigned char *)owner; *p; ++p) {
+		hash ^= (unsigned char)tolower(*p);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void
+InitHistoryIndexHeader(HistoryIndexHeader & hdr, int64_t covered_from)
+{
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, HISTORY_INDEX_MAGIC, sizeof(hdr.magic));
+	hdr.version = HISTORY_INDEX_VERSION;
+	hdr.record_size = sizeof(HistoryIndexRecord);
+	hdr.covered_from = covered_from;
+}
+
+// check the header of an index, and that it belongs to a history file of history_size bytes
+static bool
+CheckHistoryIndexHeader(const HistoryIndexHeader & hdr, const char * index_file, const char * history_file, int64_t history_size)
+{
+	if (memcmp(hdr.magic, HISTORY_INDEX_MAGIC, sizeof(hdr.magic)) != 0 ||
+			hdr.version != HISTORY_INDEX_VERSION || hdr.record_size != sizeof(HistoryIndexRecord)) {
+		dprintf(D_FULLDEBUG, "History index %s has an unknown format, ignoring it\n", index_file);
+		return false;
+	}
+	if (hdr.covered_from < 0 || hdr.covered_from > history_size) {
+		dprintf(D_FULLDEBUG, "History index %s does not belong to %s, ignoring it\n", index_file, history_file);
+		return false;
+	}
+	return true;
+}
+
+bool
+HistoryIndexCoversFile(const char * history_file, int64_t history_size)
+{
+	std::string index_file;
+	HistoryIndexFilename(history_file, index_file);
+	int fd = safe_open_wrapper_follow(index_file.c_str(), O_RDONLY | O_LARGEFILE | _O_NOINHERIT);
+	if (fd < 0) {
+		return false;
+	}
+
+	bool covers = false;
+	HistoryIndexHeader hdr;
+	HistoryIndexRecord last;
+	struct stat si;
+	if (full_read(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+		CheckHistoryIndexHeader(hdr, index_file.c_str(), history_file, history_size) &&
+		hdr.covered_from == 0 &&
+		fstat(fd, &si) == 0 &&
+		(si.st_size - sizeof(hdr)) % sizeof(HistoryIndexRecord) == 0)
+	{
+		if (si.st_size == sizeof(hdr)) {
+			covers = history_size == 0;
+		} else if (lseek(fd, si.st_size - sizeof(last), SEEK_SET) >= 0 &&
+			full_read(fd, &last, sizeof(last)) == (ssize_t)sizeof(last)) {
+			covers = last.offset + last.length == history_size;
+		}
+	}
+
+	close(fd);
+	return covers;
+}
+
+bool
+ReadHistoryIndex(const char * history_file, int64_t history_size,
+	HistoryIndexHeader & hdr, std::vector<HistoryIndexRecord> & records)
+{
+	records.clear();
+
+	std::string index_file;
+	HistoryIndexFilename(history_file, index_file);
+	int fd = safe_open_wrapper_follow(index_file.c_str(), O_RDONLY | O_LARGEFILE | _O_NOINHERIT);
+	if (fd < 0) {
+		return false;
+	}
+
+	bool ok = false;
+	struct stat si;
+	if (full_read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+		dprintf(D_FULLDEBUG, "History index %s is too short, ignoring it\n", index_file.c_str());
+	} else if ( ! CheckHistoryIndexHeader(hdr, index_file.c_str(), history_file, history_size)) {
+		// already logged
+	} else if (fstat(fd, &si) < 0) {
+		dprintf(D_FULLDEBUG, "Failed to stat history index %s: %s\n", index_file.c_str(), strerror(errno));
+	} else {
+		size_t count = (si.st_size - sizeof(hdr)) / sizeof(HistoryIndexRecord);
+		records.resize(count);
+		ssize_t want = count * sizeof(HistoryIndexRecord);
+		ssize_t got = count ? full_read(fd, records.data(), want) : 0;
+		if (got < 0) {
+			dprintf(D_FULLDEBUG, "Failed to read history index %s: %s\n", index_file.c_str(), strerror(errno));
+			records.clear();
+		} else {
+			records.resize(got / sizeof(HistoryIndexRecord));
+
+			// the records must follow each other from covered_from, and every ad must be in the history file
+			int64_t end = hdr.covered_from;
+			size_t good = 0;
+			for (const auto & rec : records) {
+				if (rec.offset != end || end + rec.length > history_size) {
+					break;
+				}
+				end += rec.length;
+				++good;
+			}
+			records.resize(good);
+			ok = true;
+		}
+	}
+
+	close(fd);
+	return ok;
+}
@@ -0,0 +1,85 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef _HISTORY_INDEX_H
+#define _HISTORY_INDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The sidecar index of a history file.
+//
+// When HISTORY_INDEX is true, the daemon that writes a history file also writes a
+// small binary file next to it with one fixed size record for each job ad that it
+// appends, so that condor_history can find ads by job id, owner or completion date
+// without reading the whole history file.  The index of history file DIR/NAME is
+// DIR/.NAME.idx, the leading dot keeps it from looking like a rotated history file,
+// and it is renamed and deleted along with its history file.
+//
+// The index starts with a header followed by the records in the order of the ads in
+// the history file.  An index may cover only part of its history file: ads before
+// covered_from were written before the index was, and ads after the end of the last
+// record were written after the daemon last wrote the index.  Readers must read those
+// parts of the history file themselves.  The index is written in the byte order of the
+// machine that writes it, it is not meant to be copied to other machines.
+
+#define HISTORY_INDEX_MAGIC    "HIX1"
+#define HISTORY_INDEX_VERSION  1
+
+struct HistoryIndexHeader {
+	char     magic[4];        // HISTORY_INDEX_MAGIC, not null terminated
+	uint32_t version;         // HISTORY_INDEX_VERSION
+	uint32_t record_size;     // sizeof(HistoryIndexRecord)
+	uint32_t reserved;
+	int64_t  covered_from;    // offset in the history file of the first ad that is indexed
+};
+
+struct HistoryIndexRecord {
+	int64_t  offset;          // offset of the ad in the history file
+	int64_t  completion_date; // CompletionDate of the job, or -1
+	int32_t  cluster;
+	int32_t  proc;
+	uint32_t length;          // bytes of the ad, including its *** banner line
+	uint32_t owner_hash;      // HistoryIndexOwnerHash() of the Owner of the job
+};
+
+// set index_file to the name of the index of history_file
+void HistoryIndexFilename(const char * history_file, std::string & index_file);
+
+// hash of an owner name for HistoryIndexRecord::owner_hash, ignoring case because
+// condor_history matches owners without case.  Different owners may have the same
+// hash, so readers must check the Owner of the ads that they find.
+uint32_t HistoryIndexOwnerHash(const char * owner);
+
+// fill in a header for a new index that starts covering the history file at covered_from
+void InitHistoryIndexHeader(HistoryIndexHeader & hdr, int64_t covered_from);
+
+// Returns true if the index of history_file covers all history_size bytes of it, so that
+// the whole file can be searched by reading just the index.  Only the header and the
+// last record of the index are read.
+bool HistoryIndexCoversFile(const char * history_file, int64_t history_size);
+
+// Read the index of history_file, which is history_size bytes long.  Records for ads
+// that are not entirely in the history file are dropped.  Returns false if there is no
+// index or it can't be used, in which case the whole history file must be read.
+bool ReadHistoryIndex(const char * history_file, int64_t history_size,
+	HistoryIndexHeader & hdr, std::vector<HistoryIndexRecord> & records);
+
+#endif
@@ -129,6 +129,10 @@ int HistoryHelperQueue::command_handler(int cmd, Stream* stream)
 		searchDir = false;
 	}
 
+	std::string job_id_filter, owner_filter;
+	queryAd.EvaluateAttrString(ATTR_HISTORY_JOB_ID_FILTER, job_id_filter);
+	queryAd.EvaluateAttrString(ATTR_HISTORY_OWNER_FILTER, owner_filter);
+
 	if (m_requests >= m_max_requests) {
 		if (m_queue.size() > 1000) {
 			return sendHistoryErrorAd(stream, 9, "Cowardly refusing to queue more than 1000 requests.");
@@ -140,6 +144,8 @@ int HistoryHelperQueue::command_handler(int cmd, Stream* stream)
 		state.m_searchForwards = searchForwards;
 		state.m_scanLimit = scanLimit;
 		state.m_adTypeFilter = ad_type_filter;
+		state.m_jobIdFilter = job_id_filter;
+		state.m_ownerFilter = owner_filter;
 		m_queue.push_back(state);
 		return KEEP_STREAM;
 	} else {
@@ -149,6 +155,8 @@ int HistoryHelperQueue::command_handler(int cmd, Stream* stream)
 		state.m_searchForwards = searchForwards;
 		state.m_scanLimit = scanLimit;
 		state.m_adTypeFilter = ad_type_filter;
+		state.m_jobIdFilter = job_id_filter;
+		state.m_ownerFilter = owner_filter;
 		return launcher(state);
 	}
 }
@@ -163,6 +171,29 @@ int HistoryHelperQueue::reaper(int, int) {
 	return TRUE;
 }
 
+// Make condor_history arguments for the job ids and owners that the client is searching for, so that
+// condor_history can use the indexes of the history files to find them.  condor_history ORs these
+// together, so if any of them would not be taken as a job id or owner none of them can be passed.
+static bool getHistoryFilterArgs(const HistoryHelperState &state, std::vector<std::string> &filter_args)
+{
+	for (const auto &id : StringTokenIterator(state.m_jobIdFilter)) {
+		int cluster, proc;
+		const char * pend = nullptr;
+		if ( ! StrIsProcId(id.c_str(), cluster, proc, &pend) || *pend || cluster <= 0) {
+			return false;
+		}
+		filter_args.push_back(id);
+	}
+	for (const auto &owner : StringTokenIterator(state.m_ownerFilter)) {
+		// anything that starts with a digit or a dash would be taken as a job id or an option
+		if (isdigit((unsigned char)owner[0]) || owner[0] == '-') {
+			return false;
+		}
+		filter_args.push_back(owner);
+	}
+	return true;
+}
+
 int HistoryHelperQueue::launcher(const HistoryHelperState &state) {
 
 	auto_free_ptr history_helper(param("HISTORY_HELPER"));
@@ -232,6 +263,14 @@ int HistoryHelperQueue::launcher(const HistoryHelperState &state) {
 			args.AppendArg("-type");
 			args.AppendArg(state.m_adTypeFilter);
 		}
+		std::vector<std::string> filter_args;
+		if (getHistoryFilterArgs(state, filter_args)) {
+			for (const auto &arg : filter_args) {
+				args.AppendArg(arg);
+			}
+		} else {
+			dprintf(D_FULLDEBUG, "Ignoring unusable job id or owner filter of history query\n");
+		}
 		//Here we tell condor_history where to search for history files/directories
 		std::string searchKnob = "HISTORY";
 		if (state.m_searchdir) {
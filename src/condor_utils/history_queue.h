@@ -44,6 +44,8 @@ public:
 	const std::string & MatchCount() const { return m_match; }
 	const std::string & RecordSrc() const { return m_recordSrc; }
 	std::string m_adTypeFilter{};
+	std::string m_jobIdFilter{};   // job ids and owners that the client is searching for,
+	std::string m_ownerFilter{};   // they are also in the requirements
 	std::string m_scanLimit{};
 	bool m_streamresults{false};
 	bool m_searchdir{false};
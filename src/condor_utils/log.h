@@ -34,8 +34,14 @@
    log.  The Play() method is defined to perform the operation on
    the data structure passed in as an argument.  The argument is of
    type (void *) for generality.
+
+   A log can also be written in the binary format of ClassAdBinaryLog (see
+   classad_log_binary.h), which frames each record itself and calls
+   WriteBinaryBody and ReadBinaryBody for the body.
 */
 
+class ClassAdBinaryLog;
+
 #define CondorLogOp_NewClassAd			101
 #define CondorLogOp_DestroyClassAd		102
 #define CondorLogOp_SetAttribute		103
@@ -65,6 +71,8 @@ public:
 
 	virtual char const *get_key() = 0;
 
+	friend class ClassAdBinaryLog;
+
 protected:
 	int op_type;	/* This is the type of operation being performed */
 
@@ -72,6 +80,9 @@ private:
 	int WriteHeader(FILE *fp) const;
 	virtual int WriteBody(FILE *) { return 0; }
 	int WriteTail(FILE *fp);
+		// the body in the binary format, ReadBinaryBody returns false if the body is bad
+	virtual int WriteBinaryBody(ClassAdBinaryLog &) { return 0; }
+	virtual bool ReadBinaryBody(ClassAdBinaryLog &) { return true; }
 };
 
 class ConstructLogEntry
@@ -20,6 +20,7 @@
 
 #include "condor_common.h"
 #include "log_transaction.h"
+#include "classad_log_binary.h"
 #include "condor_debug.h"
 #include "condor_fsync.h"
 
@@ -43,7 +44,7 @@ Transaction::~Transaction()
 }
 
 void
-Transaction::Commit(FILE* fp, const char *filename, LoggableClassAdTable *data_structure, bool nondurable)
+Transaction::Commit(FILE* fp, const char *filename, LoggableClassAdTable *data_structure, bool nondurable, ClassAdBinaryLog *binary)
 {
 	int fd;
 
@@ -59,7 +60,8 @@ Transaction::Commit(FILE* fp, const char *filename, LoggableClassAdTable *data_s
 
 	for( auto *log: ordered_op_log) {
 		if ( fp != nullptr ) {
-			if ( log->Write( fp ) < 0 ) {
+			int rval = binary ? binary->Write( fp, log ) : log->Write( fp );
+			if ( rval < 0 ) {
 				EXCEPT( "write to %s failed, errno = %d", filename, errno );
 			}
 		}
@@ -47,7 +47,8 @@ class Transaction {
 public:
 	Transaction();
 	~Transaction();
-	void Commit(FILE* fp, const char *filename, LoggableClassAdTable *data_structure, bool nondurable=false);
+		// the records are written in the binary format if binary is not NULL
+	void Commit(FILE* fp, const char *filename, LoggableClassAdTable *data_structure, bool nondurable=false, ClassAdBinaryLog *binary=NULL);
 	void AppendLog(LogRecord *);
 	LogRecord *FirstEntry(char const *key);
 	LogRecord *NextEntry();
@@ -0,0 +1,231 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#include "condor_common.h"
+#include "condor_debug.h"
+
+#include "match_thread_pool.h"
+
+#include <chrono>
+
+// each thread gets about this many chunks, so there is something left to steal
+// when the threads run at different speeds
+static const size_t CHUNKS_PER_THREAD = 16;
+static const size_t MAX_CHUNK_SIZE = 64;
+
+static double
+now_seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+MatchThreadPoolStats &
+MatchThreadPoolStats::operator+=(const MatchThreadPoolStats &other)
+{
+	threads = MAX(threads, other.threads);
+	calls += other.calls;
+	candidates += other.candidates;
+	steals += other.steals;
+	wall_time += other.wall_time;
+	busy_time += other.busy_time;
+	return *this;
+}
+
+MatchThreadPool::~MatchThreadPool()
+{
+	stop();
+}
+
+void
+MatchThreadPool::stop()
+{
+	if ( ! m_threads.empty()) {
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_stopping = true;
+		}
+		m_start_cv.notify_all();
+		for (auto & thr : m_threads) {
+			thr.join();
+		}
+		m_threads.clear();
+	}
+	m_stopping = false;
+}
+
+void
+MatchThreadPool::resize(int threads)
+{
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (threads == this->threads()) {
+		return;
+	}
+
+	stop();
+	m_workers.clear();
+	for (int id = 0; id < threads; ++id) {
+		m_workers.emplace_back(new Worker);
+	}
+	for (int id = 1; id < threads; ++id) {
+		m_threads.emplace_back(&MatchThreadPool::helperMain, this, id, m_generation);
+	}
+	dprintf(D_FULLDEBUG, "MatchThreadPool: %d threads\n", threads);
+}
+
+void
+MatchThreadPool::helperMain(int id, unsigned long seen)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_start_cv.wait(lock, [&]{ return m_stopping || m_generation != seen; });
+		if (m_stopping) {
+			break;
+		}
+		seen = m_generation;
+		lock.unlock();
+
+		work(id);
+
+		lock.lock();
+		if (--m_running == 0) {
+			m_done_cv.notify_one();
+		}
+	}
+}
+
+void
+MatchThreadPool::matchChunk(Worker &w, size_t chunk)
+{
+	const std::vector<ClassAd*> &candidates = *m_candidates;
+	size_t begin = chunk * m_chunk_size;
+	size_t end = MIN(begin + m_chunk_size, candidates.size());
+	for (size_t ix = begin; ix < end; ++ix) {
+		w.mad.ReplaceRightAd(candidates[ix]);
+		bool result = m_half_match ? w.mad.rightMatchesLeft() : w.mad.symmetricMatch();
+		w.mad.RemoveRightAd();
+		m_matched[ix] = result;
+	}
+}
+
+void
+MatchThreadPool::work(int id)
+{
+	Worker &w = *m_workers[id];
+	double start = now_seconds();
+	size_t chunk;
+
+	while ((chunk = w.next.fetch_add(1)) < w.end) {
+		matchChunk(w, chunk);
+	}
+
+		// out of work, help the other threads finish theirs
+	size_t num = m_workers.size();
+	for (size_t ix = 1; ix < num; ++ix) {
+		Worker &victim = *m_workers[(id + ix) % num];
+		while ((chunk = victim.next.fetch_add(1)) < victim.end) {
+			matchChunk(w, chunk);
+			++w.steals;
+		}
+	}
+
+	w.busy = now_seconds() - start;
+}
+
+bool
+MatchThreadPool::match(ClassAd *ad, const std::vector<ClassAd*> &candidates, std::vector<ClassAd*> &matches,
+	bool halfMatch, MatchThreadPoolStats *stats)
+{
+	if (m_workers.empty()) {
+		resize(1);
+	}
+	if (candidates.empty()) {
+		return false;
+	}
+
+	double start = now_seconds();
+	size_t num = m_workers.size();
+	m_candidates = &candidates;
+	m_half_match = halfMatch;
+	m_matched.assign(candidates.size(), 0);
+	m_chunk_size = candidates.size() / (num * CHUNKS_PER_THREAD);
+	m_chunk_size = MAX((size_t)1, MIN(m_chunk_size, MAX_CHUNK_SIZE));
+
+		// give each thread an equal range of the chunks
+	size_t chunks = (candidates.size() + m_chunk_size - 1) / m_chunk_size;
+	size_t first = 0;
+	for (size_t id = 0; id < num; ++id) {
+		Worker &w = *m_workers[id];
+		size_t last = first + chunks / num + (id < chunks % num ? 1 : 0);
+		w.next = first;
+		w.end = last;
+		w.busy = 0.0;
+		w.steals = 0;
+		w.left.ChainToAd(ad);
+		w.mad.ReplaceLeftAd(&w.left);
+		first = last;
+	}
+
+	if (num > 1) {
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_running = (int)num - 1;
+			++m_generation;
+		}
+		m_start_cv.notify_all();
+	}
+
+	work(0);
+
+	if (num > 1) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done_cv.wait(lock, [this]{ return m_running == 0; });
+	}
+
+	double busy = 0.0;
+	long long steals = 0;
+	for (auto & w : m_workers) {
+		w->mad.RemoveLeftAd();
+		w->left.Unchain();
+		busy += w->busy;
+		steals += w->steals;
+	}
+	m_candidates = NULL;
+
+	size_t matched = matches.size();
+	for (size_t ix = 0; ix < candidates.size(); ++ix) {
+		if (m_matched[ix]) {
+			matches.push_back(candidates[ix]);
+		}
+	}
+
+	if (stats) {
+		MatchThreadPoolStats call;
+		call.threads = (int)num;
+		call.calls = 1;
+		call.candidates = candidates.size();
+		call.steals = steals;
+		call.wall_time = now_seconds() - start;
+		call.busy_time = busy;
+		*stats += call;
+	}
+
+	return matches.size() > matched;
+}
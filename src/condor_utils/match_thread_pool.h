@@ -0,0 +1,113 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+#ifndef __MATCH_THREAD_POOL_H__
+#define __MATCH_THREAD_POOL_H__
+
+#include "condor_classad.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Timing of the calls to MatchThreadPool::match(), accumulated over calls
+struct MatchThreadPoolStats {
+	int threads {0};          // threads that matched, including the caller
+	long long calls {0};
+	long long candidates {0};
+	long long steals {0};     // chunks matched by a thread other than the one they were given to
+	double wall_time {0.0};   // seconds from the start of each call to its end
+	double busy_time {0.0};   // seconds spent matching, summed over all of the threads
+
+	// how many times faster than one thread doing the same work, and that per thread
+	double speedup() const { return wall_time > 0.0 ? busy_time / wall_time : 0.0; }
+	double efficiency() const { return threads > 0 ? speedup() / threads : 0.0; }
+
+	void clear() { *this = MatchThreadPoolStats(); }
+	MatchThreadPoolStats & operator+=(const MatchThreadPoolStats &other);
+};
+
+// A persistent set of threads that match one ad against a list of candidate ads.
+//
+// The candidates are split into chunks and each thread is given an equal range
+// of chunks.  A thread that finishes its own range takes chunks from the ranges
+// of the other threads, so a few expensive candidates don't leave the other
+// threads idle.  The calling thread matches too, the pool has threads-1 helpers
+// that sleep between calls.
+//
+// Each thread has its own MatchClassAd, and matches an empty ad chained to the
+// ad being matched, so the ad is shared by all of the threads and is not copied
+// or modified.  The candidates are put into a MatchClassAd by one thread at a time.
+class MatchThreadPool
+{
+public:
+	MatchThreadPool() = default;
+	~MatchThreadPool();
+	MatchThreadPool(const MatchThreadPool&) = delete;
+	MatchThreadPool& operator=(const MatchThreadPool&) = delete;
+
+	// set the number of threads that match, including the caller.
+	// must not be called while match() is running.
+	void resize(int threads);
+	int threads() const { return (int)m_workers.size(); }
+
+	// match ad against each of the candidates and append the candidates that
+	// match to matches, in the order they have in candidates.  if halfMatch is
+	// true only the Requirements of ad are checked.  returns true if any match.
+	// if stats is not NULL, the timing of this call is added to it.
+	bool match(ClassAd *ad, const std::vector<ClassAd*> &candidates, std::vector<ClassAd*> &matches,
+		bool halfMatch, MatchThreadPoolStats *stats = NULL);
+
+private:
+	// padded so that the cursors of different threads are not in the same cache line
+	struct alignas(64) Worker {
+		classad::MatchClassAd mad;
+		ClassAd left;                   // chained to the ad being matched
+		std::atomic<size_t> next {0};   // next chunk in this thread's range
+		size_t end {0};                 // end of this thread's range
+		double busy {0.0};
+		long long steals {0};
+	};
+
+	void stop();
+	void helperMain(int id, unsigned long seen);
+	void work(int id);
+	void matchChunk(Worker &w, size_t chunk);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;   // [0] is used by the calling thread
+	std::vector<std::thread> m_threads;               // helpers for m_workers[1..]
+
+	std::mutex m_mutex;
+	std::condition_variable m_start_cv;
+	std::condition_variable m_done_cv;
+	unsigned long m_generation {0};   // guarded by m_mutex, advanced for each call
+	int m_running {0};                // guarded by m_mutex, helpers still working
+	bool m_stopping {false};          // guarded by m_mutex
+
+	// the current call, set before the helpers are started
+	const std::vector<ClassAd*> *m_candidates {NULL};
+	std::vector<unsigned char> m_matched;
+	size_t m_chunk_size {1};
+	bool m_half_match {false};
+};
+
+#endif // __MATCH_THREAD_POOL_H__
@@ -25,6 +25,10 @@
 #include "selector.h"
 #include "condor_threads.h"
 
+#ifdef CONDOR_HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifndef SELECTOR_USE_POLL
 // TODO: actually use WSAPoll (and it's POLL* constants)
 #undef POLLIN
@@ -52,10 +56,30 @@ int poll(struct fake_pollfd *, int, int)
 #  define MY_FD_ISSET	FD_ISSET
 #endif
 
+// bits of interest in an fd, for the m_want and m_registered tables used with epoll
+static const unsigned char SEL_READ = 0x01;
+static const unsigned char SEL_WRITE = 0x02;
+static const unsigned char SEL_EXCEPT = 0x04;
+static const unsigned char SEL_INTEREST = SEL_READ | SEL_WRITE | SEL_EXCEPT;
+static const unsigned char SEL_LISTED = 0x80; // fd is in m_want_fds
+
+static unsigned char
+interest_bit( Selector::IO_FUNC interest )
+{
+	switch( interest ) {
+	case Selector::IO_READ: return SEL_READ;
+	case Selector::IO_WRITE: return SEL_WRITE;
+	case Selector::IO_EXCEPT: return SEL_EXCEPT;
+	}
+	return 0;
+}
+
 int Selector::_fd_select_size = -1;
 
 Selector::Selector()
 {
+	m_epfd = -1;
+
 #if defined(WIN32)
 		// On Windows, we can't treat fd_set as an open-ended bit array.
 		// fd_set can take up to FD_SETSIZE sockets (not any socket whose
@@ -82,6 +106,11 @@ Selector::Selector()
 Selector::~Selector()
 {
 	free( read_fds );
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd >= 0 ) {
+		close( m_epfd );
+	}
+#endif
 }
 
 void
@@ -146,11 +175,69 @@ Selector::reset()
 #endif
 	memset(&m_poll, '\0', sizeof(m_poll));
 
+	for ( int fd : m_want_fds ) {
+		m_want[fd] = 0;
+	}
+	m_want_fds.clear();
+
 	if (IsDebugLevel(D_DAEMONCORE)) {
 		dprintf(D_DAEMONCORE | D_VERBOSE, "selector %p resetting\n", this);
 	}
 }
 
+bool
+Selector::use_epoll()
+{
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd >= 0 ) {
+		return true;
+	}
+	m_epfd = epoll_create1( EPOLL_CLOEXEC );
+	if ( m_epfd < 0 ) {
+		dprintf( D_ALWAYS, "Selector: epoll_create1 failed, will use select(): %s (errno=%d)\n",
+				 strerror(errno), errno );
+		return false;
+	}
+	m_epoll_thread = std::this_thread::get_id();
+	reset();
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool
+Selector::using_epoll() const
+{
+	return m_epfd >= 0;
+}
+
+void
+Selector::forget_fd( int fd )
+{
+	if ( m_epfd < 0 || fd < 0 ) {
+		return;
+	}
+#ifdef CONDOR_HAVE_EPOLL
+		// the registration belongs to the open file rather than the fd
+		// number, so once the fd is closed, a copy of it that stays open
+		// keeps the registration alive where EPOLL_CTL_DEL can't reach it.
+		// so remove it now if we can, before the caller closes the fd.
+	if ( std::this_thread::get_id() == m_epoll_thread ) {
+		if ( (size_t)fd < m_registered.size() && m_registered[fd] ) {
+			(void) epoll_ctl( m_epfd, EPOLL_CTL_DEL, fd, NULL );
+			m_registered[fd] = 0;
+		}
+		if ( (size_t)fd < m_ready.size() ) {
+			m_ready[fd] = 0;
+		}
+		return;
+	}
+#endif
+	std::lock_guard<std::mutex> guard( m_forget_mutex );
+	m_forget_fds.push_back( fd );
+}
+
 int
 Selector::fd_select_size()
 {
@@ -211,6 +298,24 @@ Selector::add_fd( int fd, IO_FUNC interest )
 	if( fd > max_fd ) {
 		max_fd = fd;
 	}
+
+	if ( m_epfd >= 0 ) {
+			// there is no limit on the fds that epoll can watch, we just
+			// note what is wanted, execute() tells epoll about changes.
+		if ( fd < 0 ) {
+			EXCEPT( "Selector::add_fd(): fd %d is not valid", fd );
+		}
+		if ( (size_t)fd >= m_want.size() ) {
+			m_want.resize( fd + 1, 0 );
+		}
+		if ( ! (m_want[fd] & SEL_LISTED) ) {
+			m_want[fd] = SEL_LISTED;
+			m_want_fds.push_back( fd );
+		}
+		m_want[fd] |= interest_bit( interest );
+		return;
+	}
+
 #if !defined(WIN32)
 	if ( fd < 0 || fd >= fd_select_size() ) {
 		EXCEPT( "Selector::add_fd(): fd %d outside valid range 0-%d",
@@ -285,6 +390,13 @@ Selector::add_fd( int fd, IO_FUNC interest )
 void
 Selector::delete_fd( int fd, IO_FUNC interest )
 {
+	if ( m_epfd >= 0 ) {
+		if ( fd >= 0 && (size_t)fd < m_want.size() ) {
+			m_want[fd] &= ~interest_bit( interest );
+		}
+		return;
+	}
+
 #if !defined(WIN32)
 	if ( fd < 0 || fd >= fd_select_size() ) {
 		EXCEPT( "Selector::delete_fd(): fd %d outside valid range 0-%d",
@@ -346,6 +458,22 @@ Selector::execute()
 	struct timeval timeout_copy;
 	struct timeval	*tp;
 
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd >= 0 ) {
+		if ( epoll_sync() ) {
+			int timeout_ms = -1;
+			if ( timeout_wanted ) {
+				long long ms = (long long)timeout.tv_sec * 1000 + (timeout.tv_usec + 999) / 1000;
+				timeout_ms = (int)MAX( 0LL, MIN( ms, (long long)INT_MAX ) );
+			}
+			epoll_execute( timeout_ms );
+			return;
+		}
+			// epoll did not take one of the fds, use select() from now on
+		epoll_stop();
+	}
+#endif
+
 	if ( m_single_shot == SINGLE_SHOT_SKIP ) {
 		memcpy( read_fds, save_read_fds, fd_set_size * sizeof(fd_set) );
 		memcpy( write_fds, save_write_fds, fd_set_size * sizeof(fd_set) );
@@ -418,6 +546,10 @@ Selector::fd_ready( int fd, IO_FUNC interest )
 		);
 	}
 
+	if ( m_epfd >= 0 ) {
+		return fd >= 0 && (size_t)fd < m_ready.size() && (m_ready[fd] & interest_bit( interest ));
+	}
+
 #if !defined(WIN32)
 	// on UNIX, make sure the value of fd makes sense
 	//
@@ -477,6 +609,12 @@ Selector::display()
 	//   poll() is used to query a single fd. Currently, it's only
 	//   called in DaemonCore::Driver(), where we should always be
 	//   in select() mode.
+#ifdef CONDOR_HAVE_EPOLL
+	if ( m_epfd >= 0 ) {
+		epoll_display();
+		return;
+	}
+#endif
 	init_fd_sets();
 
 	switch( state ) {
@@ -527,6 +665,200 @@ Selector::display()
 
 }
 
+#ifdef CONDOR_HAVE_EPOLL
+
+static uint32_t
+epoll_events_for( unsigned char bits )
+{
+	uint32_t events = 0;
+	if ( bits & SEL_READ ) { events |= EPOLLIN; }
+	if ( bits & SEL_WRITE ) { events |= EPOLLOUT; }
+	if ( bits & SEL_EXCEPT ) { events |= EPOLLPRI; }
+	return events;
+}
+
+// Bring the epoll registrations in line with the fds wanted since reset().
+// Only fds that are new, gone or wanted differently than last time cost
+// a system call.  Returns false if epoll would not take one of the fds.
+bool
+Selector::epoll_sync()
+{
+		// fds forgotten by other threads.  they lose their registration
+		// when the last copy is closed, and the fd may already be reused.
+	std::vector<int> forget;
+	{
+		std::lock_guard<std::mutex> guard( m_forget_mutex );
+		forget.swap( m_forget_fds );
+	}
+	for ( int fd : forget ) {
+		if ( (size_t)fd < m_registered.size() && m_registered[fd] ) {
+			(void) epoll_ctl( m_epfd, EPOLL_CTL_DEL, fd, NULL );
+			m_registered[fd] = 0;
+		}
+	}
+
+	for ( int fd : m_registered_fds ) {
+		if ( ! m_registered[fd] ) {
+			continue;
+		}
+		if ( (size_t)fd < m_want.size() && (m_want[fd] & SEL_INTEREST) ) {
+			continue;
+		}
+		if ( epoll_ctl( m_epfd, EPOLL_CTL_DEL, fd, NULL ) < 0 && errno != ENOENT && errno != EBADF ) {
+			dprintf( D_ALWAYS, "Selector: epoll_ctl failed to remove fd %d: %s (errno=%d)\n",
+					 fd, strerror(errno), errno );
+			return false;
+		}
+		m_registered[fd] = 0;
+	}
+
+	m_registered_fds.clear();
+	for ( int fd : m_want_fds ) {
+		unsigned char bits = m_want[fd] & SEL_INTEREST;
+		if ( ! bits ) {
+			continue;
+		}
+		if ( (size_t)fd >= m_registered.size() ) {
+			m_registered.resize( fd + 1, 0 );
+		}
+		if ( m_registered[fd] != bits ) {
+			struct epoll_event ev;
+			memset( &ev, 0, sizeof(ev) );
+			ev.events = epoll_events_for( bits );
+			ev.data.fd = fd;
+			int op = m_registered[fd] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+			int rc = epoll_ctl( m_epfd, op, fd, &ev );
+			if ( rc < 0 && op == EPOLL_CTL_MOD && errno == ENOENT ) {
+				rc = epoll_ctl( m_epfd, EPOLL_CTL_ADD, fd, &ev );
+			} else if ( rc < 0 && op == EPOLL_CTL_ADD && errno == EEXIST ) {
+				rc = epoll_ctl( m_epfd, EPOLL_CTL_MOD, fd, &ev );
+			}
+			if ( rc < 0 ) {
+				dprintf( D_ALWAYS, "Selector: epoll_ctl failed to add fd %d: %s (errno=%d)\n",
+						 fd, strerror(errno), errno );
+				return false;
+			}
+			m_registered[fd] = bits;
+		}
+		m_registered_fds.push_back( fd );
+	}
+	return true;
+}
+
+void
+Selector::epoll_execute( int timeout_ms )
+{
+	for ( int fd : m_ready_fds ) {
+		m_ready[fd] = 0;
+	}
+	m_ready_fds.clear();
+
+	size_t max_events = MAX( (size_t)1, m_registered_fds.size() );
+	if ( m_events.size() < max_events ) {
+		m_events.resize( max_events );
+	}
+
+	start_thread_safe("select");
+	int nfds = epoll_wait( m_epfd, m_events.data(), (int)max_events, timeout_ms );
+	_select_errno = errno;
+	stop_thread_safe("select");
+	_select_retval = nfds;
+
+	if ( nfds < 0 ) {
+		state = (_select_errno == EINTR) ? SIGNALLED : FAILED;
+		return;
+	}
+	_select_errno = 0;
+
+	if ( m_ready.size() < m_registered.size() ) {
+		m_ready.resize( m_registered.size(), 0 );
+	}
+	for ( int ix = 0; ix < nfds; ++ix ) {
+		int fd = m_events[ix].data.fd;
+		uint32_t events = m_events[ix].events;
+		unsigned char bits = 0;
+			// like select(), report errors and hangups as readable and writable
+		if ( events & (EPOLLIN | EPOLLERR | EPOLLHUP) ) { bits |= SEL_READ; }
+		if ( events & (EPOLLOUT | EPOLLERR | EPOLLHUP) ) { bits |= SEL_WRITE; }
+		if ( events & EPOLLPRI ) { bits |= SEL_EXCEPT; }
+		bits &= m_registered[fd];
+		if ( bits ) {
+			m_ready[fd] = bits;
+			m_ready_fds.push_back( fd );
+		}
+	}
+
+	state = nfds ? FDS_READY : TIMED_OUT;
+}
+
+// stop using epoll, and set up the fd_sets for select() from the fds wanted since reset()
+void
+Selector::epoll_stop()
+{
+	close( m_epfd );
+	m_epfd = -1;
+	m_registered.clear();
+	m_registered_fds.clear();
+	m_ready.clear();
+	m_ready_fds.clear();
+	{
+		std::lock_guard<std::mutex> guard( m_forget_mutex );
+		m_forget_fds.clear();
+	}
+
+	m_single_shot = SINGLE_SHOT_SKIP;
+	init_fd_sets();
+	for ( int fd : m_want_fds ) {
+		if ( m_want[fd] & SEL_READ ) { add_fd( fd, IO_READ ); }
+		if ( m_want[fd] & SEL_WRITE ) { add_fd( fd, IO_WRITE ); }
+		if ( m_want[fd] & SEL_EXCEPT ) { add_fd( fd, IO_EXCEPT ); }
+	}
+}
+
+void
+Selector::epoll_display()
+{
+	static const char * state_names[] = { "VIRGIN", "FDS_READY", "TIMED_OUT", "SIGNALLED", "FAILED" };
+	dprintf( D_ALWAYS, "State = %s (epoll)\n", state_names[state] );
+	dprintf( D_ALWAYS, "max_fd = %d\n", max_fd );
+
+	const char * names[] = { "\tRead", "\tWrite", "\tExcept" };
+	const unsigned char bits[] = { SEL_READ, SEL_WRITE, SEL_EXCEPT };
+	dprintf( D_ALWAYS, "Selection FD's\n" );
+	for ( int ix = 0; ix < 3; ++ix ) {
+		int count = 0;
+		dprintf( D_ALWAYS, "%s {", names[ix] );
+		for ( int fd : m_want_fds ) {
+			if ( m_want[fd] & bits[ix] ) {
+				dprintf( D_ALWAYS | D_NOHEADER, "%d ", fd );
+				++count;
+			}
+		}
+		dprintf( D_ALWAYS | D_NOHEADER, "} = %d\n", count );
+	}
+	if ( state == FDS_READY ) {
+		dprintf( D_ALWAYS, "Ready FD's\n" );
+		for ( int ix = 0; ix < 3; ++ix ) {
+			int count = 0;
+			dprintf( D_ALWAYS, "%s {", names[ix] );
+			for ( int fd : m_ready_fds ) {
+				if ( m_ready[fd] & bits[ix] ) {
+					dprintf( D_ALWAYS | D_NOHEADER, "%d ", fd );
+					++count;
+				}
+			}
+			dprintf( D_ALWAYS | D_NOHEADER, "} = %d\n", count );
+		}
+	}
+	if( timeout_wanted ) {
+		dprintf( D_ALWAYS, "Timeout = %ld.%06ld seconds\n", (long) timeout.tv_sec, (long) timeout.tv_usec );
+	} else {
+		dprintf( D_ALWAYS, "Timeout not wanted\n" );
+	}
+}
+
+#endif
+
 void
 display_fd_set( const char *msg, fd_set *set, int max, bool try_dup )
 {
@@ -23,6 +23,14 @@
 
 #include "condor_common.h"
 
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef CONDOR_HAVE_EPOLL
+struct epoll_event;
+#endif
+
 #ifdef UNIX
 #define SELECTOR_USE_POLL
 #include <poll.h>
@@ -66,9 +74,35 @@ public:
 	bool fd_ready( int fd, IO_FUNC interest );
 	void display();
 
+		// Keep the fds registered with epoll between calls to execute(),
+		// rather than passing all of them to select() every time.  After
+		// this, reset() and add_fd() just note which fds are wanted, and
+		// execute() changes the epoll registrations of the fds that are
+		// wanted differently than last time.  This is meant for a Selector
+		// that is used over and over with mostly the same fds, like the
+		// one in DaemonCore::Driver().  Returns false if epoll is not
+		// available, in which case select() is used as usual.
+	bool use_epoll();
+	bool using_epoll() const;
+
+		// The fd is about to be closed, or has been closed and may be
+		// reused for something else, so forget its epoll registration.
+		// On the thread that called use_epoll(), the registration is
+		// removed right away, which must happen before the fd is closed
+		// if another copy of it stays open.  From other threads, it is
+		// removed by the next execute().  Does nothing if not using epoll.
+	void forget_fd( int fd );
+
 private:
 
 	void init_fd_sets();
+#ifdef CONDOR_HAVE_EPOLL
+	std::vector<struct epoll_event> m_events;
+	void epoll_execute( int timeout_ms );
+	bool epoll_sync();
+	void epoll_stop();
+	void epoll_display();
+#endif
 
 	enum SINGLE_SHOT {
 		SINGLE_SHOT_VIRGIN, SINGLE_SHOT_OK, SINGLE_SHOT_SKIP
@@ -92,6 +126,19 @@ private:
 #else
 	struct fake_pollfd m_poll;
 #endif
+
+		// state used when using epoll.  the vectors are indexed by fd
+		// and hold SEL_* bits
+	int		m_epfd;
+	std::vector<unsigned char> m_want;        // interest wanted since reset()
+	std::vector<int>           m_want_fds;    // fds that have m_want bits
+	std::vector<unsigned char> m_registered;  // interest registered with epoll
+	std::vector<int>           m_registered_fds;
+	std::vector<unsigned char> m_ready;       // ready fds from the last execute()
+	std::vector<int>           m_ready_fds;
+	std::vector<int>           m_forget_fds;  // fds passed to forget_fd() from other threads, guarded by m_forget_mutex
+	std::mutex                 m_forget_mutex;
+	std::thread::id            m_epoll_thread; // the thread that called use_epoll()
 };
 
 void display_fd_set( const char *msg, fd_set *set, int max,
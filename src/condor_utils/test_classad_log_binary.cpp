@@ -0,0 +1,468 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the binary format of a ClassAdLog, and for converting
+// a log between the text and binary formats.
+
+#include "condor_common.h"
+#include "condor_config.h"
+#include "condor_debug.h"
+#include "subsystem_info.h"
+#include "classad_log.h"
+#include "classad_log_binary.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static std::string
+temp_log_name(const char * tag)
+{
+	std::string name;
+	formatstr(name, "test_classad_log_binary.%d.%s", (int)getpid(), tag);
+	return name;
+}
+
+// the records of a small job queue log, one transaction after another
+static std::vector<LogRecord*>
+make_records()
+{
+	std::vector<LogRecord*> recs;
+	recs.push_back(new LogHistoricalSequenceNumber(7, 1700000000));
+	recs.push_back(new LogBeginTransaction());
+	recs.push_back(new LogNewClassAd("0.0", "Job"));
+	recs.push_back(new LogSetAttribute("0.0", "NextClusterNum", "2"));
+	recs.push_back(new LogEndTransaction());
+	recs.push_back(new LogBeginTransaction());
+	recs.push_back(new LogNewClassAd("1.0", "Job"));
+	recs.push_back(new LogSetAttribute("1.0", "Owner", "\"alice\""));
+	recs.push_back(new LogSetAttribute("1.0", "Args", "\"with \\\"quotes\\\" and spaces\""));
+	recs.push_back(new LogSetAttribute("1.0", "JobStatus", "1"));
+	recs.push_back(new LogSetAttribute("1.0", "QDate", "-1700000000"));
+	recs.push_back(new LogSetAttribute("1.0", "Rank", "2.5"));
+	recs.push_back(new LogSetAttribute("1.0", "Tiny", "1.0E-300"));
+	recs.push_back(new LogSetAttribute("1.0", "OnExitRemove", "true"));
+	recs.push_back(new LogSetAttribute("1.0", "WantCheckpoint", "false"));
+	recs.push_back(new LogSetAttribute("1.0", "Iwd", "undefined"));
+	recs.push_back(new LogSetAttribute("1.0", "Bad", "error"));
+	recs.push_back(new LogSetAttribute("1.0", "Requirements", "(TARGET.Arch == \"X86_64\") && (TARGET.Memory >= RequestMemory)"));
+	recs.push_back(new LogSetAttribute("1.0", "List", "{ 1, \"two\", [ a = 3 ] }"));
+	recs.push_back(new LogDeleteAttribute("1.0", "Iwd"));
+	LogEndTransaction * end = new LogEndTransaction();
+	end->set_comment("2024-01-02T03:04:05.678901");
+	recs.push_back(end);
+	recs.push_back(new LogBeginTransaction());
+	recs.push_back(new LogNewClassAd("1.1", "Job"));
+	recs.push_back(new LogSetAttribute("1.1", "JobStatus", "2"));
+	recs.push_back(new LogSetAttribute("1.0", "JobStatus", "5"));
+	recs.push_back(new LogEndTransaction());
+	recs.push_back(new LogBeginTransaction());
+	recs.push_back(new LogDestroyClassAd("1.1"));
+	recs.push_back(new LogEndTransaction());
+	return recs;
+}
+
+static void
+free_records(std::vector<LogRecord*> & recs)
+{
+	for (auto * rec : recs) { delete rec; }
+	recs.clear();
+}
+
+static bool
+write_log(const std::string & name, const std::vector<LogRecord*> & recs, ClassAdBinaryLog * binary)
+{
+	FILE * fp = safe_fopen_wrapper_follow(name.c_str(), "wb");
+	if ( ! fp) {
+		return false;
+	}
+	bool ok = ! binary || binary->WriteHeader(fp) == ClassAdBinaryLog::HEADER_SIZE;
+	for (auto * rec : recs) {
+		if ( ! ok) break;
+		ok = WriteClassAdLogEntry(fp, rec, binary) > 0;
+	}
+	return fclose(fp) == 0 && ok;
+}
+
+// copy each record to a new log in the other format, like condor_convert_classad_log does
+static long
+convert_log(const std::string & in_name, const std::string & out_name)
+{
+	FILE * in = safe_fopen_wrapper_follow(in_name.c_str(), "rb");
+	FILE * out = safe_fopen_wrapper_follow(out_name.c_str(), "wb");
+	if ( ! in || ! out) {
+		if (in) fclose(in);
+		if (out) fclose(out);
+		return -1;
+	}
+	ClassAdBinaryLog in_binary, out_binary;
+	bool in_is_binary = ClassAdBinaryLog::IsBinaryLog(in);
+	std::string errmsg;
+	if (in_is_binary && ! in_binary.ReadHeader(in, errmsg)) {
+		fclose(in); fclose(out);
+		return -1;
+	}
+	ClassAdBinaryLog * out_bin = in_is_binary ? NULL : &out_binary;
+	long count = 0;
+	if (out_bin && out_bin->WriteHeader(out) < 0) { count = -1; }
+	LogRecord * rec;
+	while (count >= 0 && (rec = ReadClassAdLogEntry(in, count+1, DefaultMakeClassAdLogTableEntry, in_is_binary ? &in_binary : NULL)) != NULL) {
+		if (WriteClassAdLogEntry(out, rec, out_bin) < 0) { count = -1; }
+		else { ++count; }
+		delete rec;
+	}
+	fclose(in);
+	if (fclose(out) != 0) count = -1;
+	return count;
+}
+
+typedef std::map<std::string, std::map<std::string, std::string>> LogContents;
+
+// replay the log and return each ad as a map of attribute names to unparsed values
+static bool
+load_log(const std::string & name, LogContents & contents, unsigned long & seq, bool & is_binary)
+{
+	HashTable<std::string,ClassAd*> table(hashFunction);
+	ClassAdLogTable<std::string,ClassAd*> la(table);
+	ClassAdBinaryLog binary;
+	time_t birthdate = 0;
+	bool is_clean = true, requires_cleaning = false;
+	std::string errmsg;
+	is_binary = false;
+	FILE * fp = LoadClassAdLog(name.c_str(), la, DefaultMakeClassAdLogTableEntry,
+		seq, birthdate, is_clean, requires_cleaning, errmsg, binary, is_binary);
+	if ( ! fp) {
+		fprintf(stderr, "could not load %s: %s\n", name.c_str(), errmsg.c_str());
+		return false;
+	}
+	fclose(fp);
+
+	contents.clear();
+	std::string key;
+	ClassAd * ad;
+	table.startIterations();
+	while (table.iterate(key, ad) == 1) {
+		auto & attrs = contents[key];
+		for (auto & [attr, expr] : *ad) {
+			attrs[attr] = ExprTreeToString(expr);
+		}
+		delete ad;
+	}
+	return ! requires_cleaning;
+}
+
+static void
+test_replay_matches_text()
+{
+	std::string text_name = temp_log_name("text");
+	std::string bin_name = temp_log_name("bin");
+	std::vector<LogRecord*> recs = make_records();
+	ClassAdBinaryLog binary;
+	REQUIRE(write_log(text_name, recs, NULL));
+	REQUIRE(write_log(bin_name, recs, &binary));
+	free_records(recs);
+
+	// each name is written once
+	REQUIRE(binary.NumNames() == 13);
+
+	LogContents text_ads, bin_ads;
+	unsigned long text_seq = 0, bin_seq = 0;
+	bool is_binary = true;
+	REQUIRE(load_log(text_name, text_ads, text_seq, is_binary));
+	REQUIRE( ! is_binary);
+	REQUIRE(load_log(bin_name, bin_ads, bin_seq, is_binary));
+	REQUIRE(is_binary);
+
+	REQUIRE(text_seq == 7 && bin_seq == 7);
+	REQUIRE(text_ads.size() == 2);
+	REQUIRE(text_ads == bin_ads);
+	REQUIRE(bin_ads["1.0"]["JobStatus"] == "5");
+	REQUIRE(bin_ads["1.0"]["QDate"] == "-1700000000");
+	REQUIRE(bin_ads["1.0"]["Owner"] == "\"alice\"");
+	REQUIRE(bin_ads["1.0"]["Args"] == "\"with \\\"quotes\\\" and spaces\"");
+	REQUIRE(bin_ads["1.0"]["OnExitRemove"] == "true");
+	REQUIRE(bin_ads["1.0"]["Bad"] == "error");
+	REQUIRE(bin_ads["1.0"].count("Iwd") == 0);
+	REQUIRE(bin_ads.count("1.1") == 0);
+
+	unlink(text_name.c_str());
+	unlink(bin_name.c_str());
+}
+
+static void
+test_literals()
+{
+	std::string name = temp_log_name("literals");
+	const char * values[] = {
+		"0", "-1", "9223372036854775807", "-9223372036854775807", "2.5", "-0.125", "1.0E-300",
+		"\"\"", "\"a string\"", "true", "false", "undefined", "error", "A + 1", "{ 1, 2 }",
+	};
+	std::vector<LogRecord*> recs;
+	for (const char * value : values) {
+		recs.push_back(new LogSetAttribute("1.0", "Attr", value));
+	}
+	ClassAdBinaryLog writer;
+	REQUIRE(write_log(name, recs, &writer));
+
+	FILE * fp = safe_fopen_wrapper_follow(name.c_str(), "rb");
+	REQUIRE(fp != NULL);
+	if ( ! fp) return;
+	ClassAdBinaryLog reader;
+	std::string errmsg;
+	REQUIRE(reader.ReadHeader(fp, errmsg));
+	for (size_t ix = 0; ix < recs.size(); ++ix) {
+		ClassAdBinaryLog::ReadStatus status;
+		int op_type = 0;
+		LogRecord * rec = reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+		REQUIRE(rec && status == ClassAdBinaryLog::READ_OK && op_type == CondorLogOp_SetAttribute);
+		if ( ! rec) break;
+		LogSetAttribute * set = (LogSetAttribute *)rec;
+		LogSetAttribute * orig = (LogSetAttribute *)recs[ix];
+		REQUIRE(MATCH == strcmp(set->get_key(), "1.0"));
+		REQUIRE(MATCH == strcmp(set->get_name(), "Attr"));
+		REQUIRE(set->get_expr() && orig->get_expr() && set->get_expr()->SameAs(orig->get_expr()));
+		if (set->get_expr() && ! set->get_expr()->SameAs(orig->get_expr())) {
+			fprintf(stderr, "    %s came back as %s\n", values[ix], set->get_value());
+		}
+		delete rec;
+	}
+	ClassAdBinaryLog::ReadStatus status;
+	int op_type = 0;
+	REQUIRE(reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type) == NULL);
+	REQUIRE(status == ClassAdBinaryLog::READ_EOF);
+	fclose(fp);
+	free_records(recs);
+	unlink(name.c_str());
+}
+
+// a reader that starts after the names were defined has to learn them first
+static void
+test_read_from_middle()
+{
+	std::string name = temp_log_name("middle");
+	std::vector<LogRecord*> recs = make_records();
+	ClassAdBinaryLog writer;
+	REQUIRE(write_log(name, recs, &writer));
+
+	// find the offset of the last SetAttribute
+	FILE * fp = safe_fopen_wrapper_follow(name.c_str(), "rb");
+	REQUIRE(fp != NULL);
+	if ( ! fp) return;
+	ClassAdBinaryLog reader;
+	std::string errmsg;
+	REQUIRE(reader.ReadHeader(fp, errmsg));
+	long long offset = -1;
+	for (;;) {
+		long long pos = ftell(fp);
+		ClassAdBinaryLog::ReadStatus status;
+		int op_type = 0;
+		LogRecord * rec = reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+		if ( ! rec) break;
+		if (op_type == CondorLogOp_SetAttribute) offset = pos;
+		delete rec;
+	}
+	REQUIRE(offset > 0);
+
+	ClassAdBinaryLog late;
+	REQUIRE(late.CheckHeader(fp, errmsg));
+	fseek(fp, offset, SEEK_SET);
+	ClassAdBinaryLog::ReadStatus status;
+	int op_type = 0;
+	LogRecord * rec = late.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+	REQUIRE(rec == NULL && status == ClassAdBinaryLog::READ_UNKNOWN_NAME);
+	delete rec;
+	REQUIRE(late.Rescan(fp, offset, DefaultMakeClassAdLogTableEntry));
+	rec = late.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+	REQUIRE(rec && status == ClassAdBinaryLog::READ_OK);
+	if (rec) {
+		REQUIRE(MATCH == strcmp(((LogSetAttribute *)rec)->get_name(), "JobStatus"));
+	}
+	delete rec;
+
+	// the names are kept while the file is the same
+	REQUIRE(late.CheckHeader(fp, errmsg));
+	REQUIRE(late.NumNames() == reader.NumNames());
+
+	fclose(fp);
+	free_records(recs);
+	unlink(name.c_str());
+}
+
+// write records, returning the offset of each
+static std::vector<long long>
+write_records_at(FILE * fp, ClassAdBinaryLog & binary, const std::vector<LogRecord*> & recs)
+{
+	std::vector<long long> offsets;
+	for (auto * rec : recs) {
+		offsets.push_back(ftell(fp));
+		WriteClassAdLogEntry(fp, rec, &binary);
+	}
+	offsets.push_back(ftell(fp));
+	return offsets;
+}
+
+static void
+test_corrupt_records()
+{
+	std::string name = temp_log_name("corrupt");
+	std::vector<LogRecord*> recs;
+	recs.push_back(new LogBeginTransaction());
+	recs.push_back(new LogSetAttribute("1.0", "A", "1"));
+	recs.push_back(new LogSetAttribute("1.0", "B", "\"some text to damage\""));
+	recs.push_back(new LogSetAttribute("1.0", "C", "3"));
+
+	// bytes that look like an EndTransaction record, but whose checksum is wrong.
+	// these are put after a record with a bad length.
+	const unsigned char fake_end[] = {
+		1, 0, 0, 0,               // length
+		0x12, 0x34, 0x56, 0x78,   // checksum
+		CondorLogOp_EndTransaction,
+	};
+
+	FILE * fp = safe_fopen_wrapper_follow(name.c_str(), "w+b");
+	REQUIRE(fp != NULL);
+	if ( ! fp) return;
+	ClassAdBinaryLog writer;
+	REQUIRE(writer.WriteHeader(fp) > 0);
+	std::vector<long long> offsets = write_records_at(fp, writer, recs);
+	long long bad_length_at = ftell(fp);
+	const unsigned char bad_length[] = { 0xff, 0xff, 0xff, 0x7f, 0, 0, 0, 0 };
+	fwrite(bad_length, 1, sizeof(bad_length), fp);
+	fwrite(fake_end, 1, sizeof(fake_end), fp);
+	long long last_at = ftell(fp);
+	LogSetAttribute last("1.0", "D", "4");
+	WriteClassAdLogEntry(fp, &last, &writer);
+
+	// damage a byte in the body of the record that sets B
+	fseek(fp, offsets[2] + 12, SEEK_SET);
+	int ch = fgetc(fp);
+	fseek(fp, offsets[2] + 12, SEEK_SET);
+	fputc(ch ^ 0x20, fp);
+	fflush(fp);
+
+	ClassAdBinaryLog reader;
+	std::string errmsg;
+	fseek(fp, 0, SEEK_SET);
+	REQUIRE(reader.ReadHeader(fp, errmsg));
+	ClassAdBinaryLog::ReadStatus status;
+	int op_type = 0;
+	LogRecord * rec = reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+	REQUIRE(rec && op_type == CondorLogOp_BeginTransaction);
+	delete rec;
+	rec = reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+	REQUIRE(rec && op_type == CondorLogOp_SetAttribute);
+	delete rec;
+
+	// the checksum catches the damaged byte
+	rec = reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+	REQUIRE(rec == NULL && status == ClassAdBinaryLog::READ_CORRUPT);
+
+	// skipping from just after the start of the bad record finds the next good one
+	fseek(fp, offsets[2] + 1, SEEK_SET);
+	REQUIRE(reader.Skip(fp, op_type));
+	REQUIRE(op_type == CondorLogOp_SetAttribute);
+	REQUIRE(ftell(fp) == offsets[4]);
+
+	// a bad length is corrupt
+	rec = reader.Read(fp, DefaultMakeClassAdLogTableEntry, status, op_type);
+	REQUIRE(rec == NULL && status == ClassAdBinaryLog::READ_CORRUPT);
+	REQUIRE(offsets[4] == bad_length_at);
+
+	// and the fake EndTransaction after it is not taken for a record
+	fseek(fp, bad_length_at + 1, SEEK_SET);
+	REQUIRE(reader.Skip(fp, op_type));
+	REQUIRE(op_type == CondorLogOp_SetAttribute);
+	REQUIRE(ftell(fp) > last_at);
+	REQUIRE( ! reader.Skip(fp, op_type));
+
+	// a whole log with these records loads, the bad records end it
+	fclose(fp);
+	LogContents ads;
+	unsigned long seq = 0;
+	bool is_binary = false;
+	load_log(name, ads, seq, is_binary);
+	REQUIRE(is_binary);
+	REQUIRE(ads.empty());
+
+	free_records(recs);
+	unlink(name.c_str());
+}
+
+static void
+test_convert_round_trip()
+{
+	std::string text_name = temp_log_name("text");
+	std::string bin_name = temp_log_name("bin");
+	std::string text2_name = temp_log_name("text2");
+	std::string bin2_name = temp_log_name("bin2");
+	std::vector<LogRecord*> recs = make_records();
+	long num_recs = (long)recs.size();
+	REQUIRE(write_log(text_name, recs, NULL));
+	free_records(recs);
+
+	REQUIRE(convert_log(text_name, bin_name) == num_recs);
+	REQUIRE(convert_log(bin_name, text2_name) == num_recs);
+	REQUIRE(convert_log(text2_name, bin2_name) == num_recs);
+
+	LogContents ads[4];
+	const std::string * names[4] = { &text_name, &bin_name, &text2_name, &bin2_name };
+	for (int ix = 0; ix < 4; ++ix) {
+		unsigned long seq = 0;
+		bool is_binary = false;
+		REQUIRE(load_log(*names[ix], ads[ix], seq, is_binary));
+		REQUIRE(is_binary == (ix % 2 == 1));
+		REQUIRE(seq == 7);
+	}
+	REQUIRE(ads[0].size() == 2);
+	REQUIRE(ads[1] == ads[0]);
+	REQUIRE(ads[2] == ads[0]);
+	REQUIRE(ads[3] == ads[0]);
+
+	for (auto * name : names) {
+		unlink(name->c_str());
+	}
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	test_replay_matches_text();
+	test_literals();
+	test_read_from_middle();
+	test_corrupt_records();
+	test_convert_round_trip();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
@@ -0,0 +1,349 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for sending ClassAds over CEDAR in the text and binary encodings
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_classad.h"
+#include "condor_attributes.h"
+#include "classad_oldnew.h"
+#include "classad_wire.h"
+#include "reli_sock.h"
+#include "subsystem_info.h"
+#include "condor_ver_info.h"
+#include "CryptKey.h"
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static const CondorVersionInfo text_peer(9, 0, 0);
+static const CondorVersionInfo binary_peer(CLASSAD_WIRE_MIN_PEER_MAJOR, CLASSAD_WIRE_MIN_PEER_MINOR, CLASSAD_WIRE_MIN_PEER_SUB);
+
+// a connected pair of sockets whose peers are the given version
+struct SockPair {
+	explicit SockPair(const CondorVersionInfo & peer) {
+		if ( ! sender.connect_socketpair(receiver)) {
+			fprintf(stderr, "Failed to create a socketpair\n");
+			exit(1);
+		}
+		sender.set_peer_version(&peer);
+		receiver.set_peer_version(&peer);
+		sender.timeout(20);
+		receiver.timeout(20);
+	}
+	ReliSock sender;
+	ReliSock receiver;
+};
+
+// every attribute of the ad as "name = expr\n" in new ClassAd syntax, so that
+// the type of each literal shows, sorted by name
+static std::string dump(const classad::ClassAd & ad)
+{
+	classad::ClassAdUnParser unp;
+	std::map<std::string, std::string, classad::CaseIgnLTStr> attrs;
+	for (const auto & [name, tree] : ad) {
+		unp.Unparse(attrs[name], tree);
+	}
+	std::string result;
+	for (const auto & [name, text] : attrs) {
+		result += name + " = " + text + "\n";
+	}
+	return result;
+}
+
+static classad::ClassAd makeAd(const char * text)
+{
+	classad::ClassAd ad;
+	initAdFromString(text, ad);
+	return ad;
+}
+
+// send the ads in one message and receive them with the given GET_CLASSAD_* options,
+// returns true if the sender used the binary encoding
+static bool roundTrip(SockPair & pair, const std::vector<classad::ClassAd> & ads, std::vector<classad::ClassAd> & got, int options = 0)
+{
+	pair.sender.encode();
+	for (const auto & ad : ads) {
+		REQUIRE(putClassAd(&pair.sender, ad));
+	}
+	// names are only interned by the binary encoding
+	bool binary = ! pair.sender.classad_wire_state().put_names.empty();
+	REQUIRE(pair.sender.end_of_message());
+	REQUIRE(pair.sender.classad_wire_state().put_names.empty());
+
+	got.clear();
+	pair.receiver.decode();
+	for (size_t ii = 0; ii < ads.size(); ++ii) {
+		got.emplace_back();
+		REQUIRE(getClassAdEx(&pair.receiver, got.back(), options));
+	}
+	REQUIRE(pair.receiver.end_of_message());
+	REQUIRE(pair.receiver.classad_wire_state().get_names.empty());
+	return binary;
+}
+
+static classad::ClassAd literalsAd()
+{
+	classad::ClassAd ad = makeAd(
+		"Int = 42\n"
+		"NegInt = -9223372036854775807\n"
+		"Real = 1.0\n"
+		"SmallReal = 3.5e-300\n"
+		"Str = \"a \\\"quoted\\\" string\\\\ with\\ttabs\"\n"
+		"Empty = \"\"\n"
+		"Yes = true\n"
+		"No = false\n"
+		"Undef = undefined\n"
+		"Err = error\n");
+	classad::abstime_t at;
+	at.secs = 1722951043;
+	at.offset = -18000;
+	ad.Insert("Abs", classad::Literal::MakeAbsTime(&at));
+	classad::Value rel;
+	rel.SetRelativeTimeValue((time_t)3725);
+	ad.Insert("Rel", classad::Literal::MakeLiteral(rel));
+	return ad;
+}
+
+static classad::ClassAd nestedAd()
+{
+	return makeAd(
+		"Requirements = (TARGET.Memory >= MY.RequestMemory) && (TARGET.Arch == \"X86_64\" || !isUndefined(Other))\n"
+		"Ternary = Cpus > 1 ? Cpus * 2 : -Cpus\n"
+		"Bits = ~(Mask & 0xff) | (Mask << 2) ^ 7\n"
+		"Parens = ((1 + 2) * 3)\n"
+		"Meta = Foo =?= undefined || Foo =!= Bar\n"
+		"Call = strcat(\"a\", string(Int), substr(Name, 1, 2))\n"
+		"List = { 1, \"two\", { 3.0, Four }, [ A = 5; B = A + 1 ] }\n"
+		"Nested = [ Inner = [ X = 1; Y = .X ]; Z = Inner.X ]\n"
+		"Select = Nested.Inner.Y\n"
+		"Subscript = List[1]\n"
+		"Absolute = .Requirements\n");
+}
+
+// every literal keeps its value and type through both encodings
+static void test_literals()
+{
+	classad::ClassAd ad = literalsAd();
+	for (const CondorVersionInfo * peer : { &text_peer, &binary_peer }) {
+		SockPair pair(*peer);
+		std::vector<classad::ClassAd> got;
+		bool binary = roundTrip(pair, { ad }, got);
+		REQUIRE(binary == (peer == &binary_peer));
+		REQUIRE(dump(got[0]) == dump(ad));
+
+		// the values are compared by dump(), these check their types
+		long long ival = 0;
+		REQUIRE(got[0].EvaluateAttrInt("NegInt", ival) && ival == -9223372036854775807LL);
+		classad::Value val;
+		REQUIRE(got[0].EvaluateAttr("Real", val) && val.GetType() == classad::Value::REAL_VALUE);
+		REQUIRE(got[0].EvaluateAttr("Abs", val) && val.GetType() == classad::Value::ABSOLUTE_TIME_VALUE);
+		if (binary) {
+			// the text encoding sends these as calls to absTime() and relTime()
+			REQUIRE(got[0].Lookup("Abs")->GetKind() == classad::ExprTree::ABSTIME_LITERAL);
+			REQUIRE(got[0].Lookup("Rel")->GetKind() == classad::ExprTree::RELTIME_LITERAL);
+		}
+	}
+}
+
+// expressions keep their structure, and evaluate the same, through both encodings
+static void test_nested_expressions()
+{
+	classad::ClassAd ad = nestedAd();
+	ad.InsertAttr("Memory", 2048);
+	ad.InsertAttr("RequestMemory", 1024);
+	ad.InsertAttr("Arch", "X86_64");
+	ad.InsertAttr("Cpus", 4);
+	ad.InsertAttr("Mask", 0x1234);
+	ad.InsertAttr("Name", "slot1");
+	for (const CondorVersionInfo * peer : { &text_peer, &binary_peer }) {
+		SockPair pair(*peer);
+		std::vector<classad::ClassAd> got;
+		roundTrip(pair, { ad }, got);
+		REQUIRE(dump(got[0]) == dump(ad));
+		for (const auto & [name, tree] : ad) {
+			classad::Value want, have;
+			ad.EvaluateAttr(name, want);
+			got[0].EvaluateAttr(name, have);
+			REQUIRE(want.SameAs(have));
+		}
+	}
+}
+
+// the receiver parses ads the same way with and without the ClassAd cache
+static void test_options()
+{
+	classad::ClassAd ad = literalsAd();
+	ad.Update(nestedAd());
+	bool caching = classad::ClassAdGetExpressionCaching();
+	classad::ClassAdSetExpressionCaching(true);
+	for (int options : { 0, GET_CLASSAD_NO_CACHE, GET_CLASSAD_FAST | GET_CLASSAD_LAZY_PARSE }) {
+		SockPair pair(binary_peer);
+		std::vector<classad::ClassAd> got;
+		REQUIRE(roundTrip(pair, { ad, ad }, got, options));
+		REQUIRE(dump(got[0]) == dump(ad));
+		REQUIRE(dump(got[1]) == dump(ad));
+	}
+	classad::ClassAdSetExpressionCaching(caching);
+}
+
+// names are interned for the rest of a message, and forgotten at its end
+static void test_interned_names()
+{
+	classad::ClassAd ad = makeAd(
+		"SomeLongAttributeName = 1\n"
+		"Other = SomeLongAttributeName + 1\n"
+		"Ref = [ SomeLongAttributeName = 2 ].SomeLongAttributeName\n");
+
+	SockPair pair(binary_peer);
+	pair.sender.encode();
+	REQUIRE(putClassAd(&pair.sender, ad));
+	size_t names = pair.sender.classad_wire_state().put_names.size();
+	REQUIRE(names == 3);
+	REQUIRE(putClassAd(&pair.sender, ad));
+	// the second ad sent no new names, only their indexes
+	REQUIRE(pair.sender.classad_wire_state().put_names.size() == names);
+	REQUIRE(pair.sender.end_of_message());
+
+	pair.receiver.decode();
+	for (int ii = 0; ii < 2; ++ii) {
+		classad::ClassAd got;
+		REQUIRE(getClassAd(&pair.receiver, got));
+		REQUIRE(dump(got) == dump(ad));
+	}
+	REQUIRE(pair.receiver.classad_wire_state().get_names.size() == names);
+	REQUIRE(pair.receiver.end_of_message());
+
+	// the next message starts with empty tables on both ends
+	std::vector<classad::ClassAd> got;
+	REQUIRE(roundTrip(pair, { ad }, got));
+	REQUIRE(dump(got[0]) == dump(ad));
+
+	// an ad with more names than either end will intern
+	classad::ClassAd big;
+	for (int ii = 0; ii < 20000; ++ii) {
+		big.InsertAttr("Attr" + std::to_string(ii), ii);
+	}
+	roundTrip(pair, { big }, got);
+	REQUIRE(got[0].size() == big.size());
+	REQUIRE(dump(got[0]) == dump(big));
+}
+
+// private attributes are sent with put_secret() after the block of the ad
+static void test_secrets()
+{
+	classad::ClassAd ad = literalsAd();
+	ad.InsertAttr(ATTR_CLAIM_ID, "<10.0.0.1:9618>#1722951043#1#...");
+	ad.InsertAttr(ATTR_CAPABILITY, "secret capability");
+	ad.InsertAttr("Public", "not a secret");
+	classad::References encrypted;
+	encrypted.insert("Int");
+
+	const unsigned char key_data[24] = "0123456789abcdefghijklm";
+	for (const CondorVersionInfo * peer : { &text_peer, &binary_peer }) {
+		SockPair pair(*peer);
+		// able to encrypt, but not encrypting by default
+		KeyInfo key(key_data, sizeof(key_data), CONDOR_3DES, 0);
+		REQUIRE(pair.sender.set_crypto_key(false, &key));
+		REQUIRE(pair.receiver.set_crypto_key(false, &key));
+		REQUIRE( ! pair.sender.prepare_crypto_for_secret_is_noop());
+
+		std::vector<classad::ClassAd> got;
+		roundTrip(pair, { ad }, got);
+		REQUIRE(dump(got[0]) == dump(ad));
+
+		// only the attributes that are sent are encrypted
+		pair.sender.encode();
+		REQUIRE(putClassAd(&pair.sender, ad, 0, nullptr, &encrypted));
+		REQUIRE(putClassAd(&pair.sender, ad, PUT_CLASSAD_NO_PRIVATE));
+		REQUIRE(pair.sender.end_of_message());
+		pair.receiver.decode();
+		classad::ClassAd all, some;
+		REQUIRE(getClassAd(&pair.receiver, all));
+		REQUIRE(getClassAd(&pair.receiver, some));
+		REQUIRE(pair.receiver.end_of_message());
+		REQUIRE(dump(all) == dump(ad));
+		REQUIRE(some.Lookup(ATTR_CLAIM_ID) == nullptr);
+		REQUIRE(some.Lookup(ATTR_CAPABILITY) == nullptr);
+		REQUIRE(some.size() == ad.size() - 2);
+	}
+}
+
+// ENABLE_CLASSAD_BINARY_ENCODING is read at reconfig, not for each ad
+static void test_reconfig()
+{
+	SockPair pair(binary_peer);
+	REQUIRE(ClassAdWireUsable(&pair.sender));
+	param_insert("ENABLE_CLASSAD_BINARY_ENCODING", "false");
+	REQUIRE(ClassAdWireUsable(&pair.sender));
+	ClassAdWireReconfig();
+	REQUIRE( ! ClassAdWireUsable(&pair.sender));
+
+	std::vector<classad::ClassAd> got;
+	classad::ClassAd ad = nestedAd();
+	REQUIRE( ! roundTrip(pair, { ad }, got));
+	REQUIRE(dump(got[0]) == dump(ad));
+
+	param_insert("ENABLE_CLASSAD_BINARY_ENCODING", "true");
+	ClassAdWireReconfig();
+	REQUIRE(ClassAdWireUsable(&pair.sender));
+	SockPair old_pair(text_peer);
+	REQUIRE( ! ClassAdWireUsable(&old_pair.sender));
+	// daemons from before the binary encoding report this version too
+	const CondorVersionInfo same_version(24, 1, 0);
+	SockPair same_pair(same_version);
+	REQUIRE( ! ClassAdWireUsable(&same_pair.sender));
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	// off by default
+	ClassAdWireReconfig();
+	{
+		SockPair pair(binary_peer);
+		REQUIRE( ! ClassAdWireUsable(&pair.sender));
+	}
+	param_insert("ENABLE_CLASSAD_BINARY_ENCODING", "true");
+	ClassAdWireReconfig();
+
+	test_literals();
+	test_nested_expressions();
+	test_options();
+	test_interned_names();
+	test_secrets();
+	test_reconfig();
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
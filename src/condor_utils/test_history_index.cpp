@@ -0,0 +1,361 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the sidecar indexes of history files, written by AppendHistory()
+// both directly and from the background history writer
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "subsystem_info.h"
+#include "condor_classad.h"
+#include "directory.h"
+#include "directory_util.h"
+#include "classadHistory.h"
+#include "history_index.h"
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static const int NUM_ADS = 8;
+static const int FIRST_CLUSTER = 10;
+static const char * OWNERS[] = { "alice", "BOBBY" };
+
+// an ad as it is found by reading the history file
+struct HistoryAd {
+	int64_t offset;
+	uint32_t length;
+	int cluster;
+	int proc;
+	std::string owner;
+	int64_t completion;
+};
+
+static void make_job_ad(ClassAd & ad, int ix)
+{
+	ad.Assign("ClusterId", FIRST_CLUSTER + ix);
+	ad.Assign("ProcId", 0);
+	ad.Assign("Owner", OWNERS[ix % 2]);
+	// the last job has no CompletionDate
+	if (ix != NUM_ADS - 1) {
+		ad.Assign("CompletionDate", 1000 + ix * 10);
+	}
+	ad.Assign("Cmd", std::string(150, 'x'));
+}
+
+static bool read_file(const std::string & path, std::string & contents)
+{
+	contents.clear();
+	FILE * fp = safe_fopen_wrapper_follow(path.c_str(), "r");
+	if ( ! fp) {
+		return false;
+	}
+	char buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		contents.append(buf, len);
+	}
+	fclose(fp);
+	return true;
+}
+
+// find the ads in a history file by their *** banner lines
+static void read_history_ads(const std::string & path, std::vector<HistoryAd> & ads)
+{
+	ads.clear();
+	std::string contents;
+	REQUIRE(read_file(path, contents));
+
+	size_t start = 0, pos = 0;
+	while (pos < contents.size()) {
+		size_t eol = contents.find('\n', pos);
+		if (eol == std::string::npos) {
+			break;
+		}
+		if (contents.compare(pos, 4, "*** ") == 0) {
+			HistoryAd ad;
+			long long offset, completion;
+			char owner[64];
+			REQUIRE(sscanf(contents.c_str() + pos,
+				"*** Offset = %lld ClusterId = %d ProcId = %d Owner = \"%63[^\"]\" CompletionDate = %lld",
+				&offset, &ad.cluster, &ad.proc, owner, &completion) == 5);
+			ad.offset = start;
+			ad.length = (uint32_t)(eol + 1 - start);
+			ad.owner = owner;
+			ad.completion = completion;
+			ads.push_back(ad);
+			start = eol + 1;
+		}
+		pos = eol + 1;
+	}
+	// nothing after the last banner
+	REQUIRE(start == contents.size());
+}
+
+// the history file and its rotations, oldest first
+static void list_history_files(const std::string & dir, std::vector<std::string> & files)
+{
+	files.clear();
+	Directory d(dir.c_str());
+	const char * name;
+	while ((name = d.Next())) {
+		if (starts_with(name, "history.")) {
+			files.push_back(d.GetFullPath());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	std::string current;
+	dircat(dir.c_str(), "history", current);
+	files.push_back(current);
+}
+
+// the index of each history file has a record for each ad in the file, at the ad's
+// offset, and with its job id, owner and completion date
+static void check_index(const std::string & history_file, std::vector<HistoryAd> & ads)
+{
+	read_history_ads(history_file, ads);
+	StatInfo si(history_file.c_str());
+	REQUIRE(si.Error() == SIGood);
+	int64_t size = si.GetFileSize();
+
+	std::string index_file;
+	HistoryIndexFilename(history_file.c_str(), index_file);
+	StatInfo isi(index_file.c_str());
+	REQUIRE(isi.Error() == SIGood);
+
+	HistoryIndexHeader hdr;
+	std::vector<HistoryIndexRecord> records;
+	REQUIRE(ReadHistoryIndex(history_file.c_str(), size, hdr, records));
+	REQUIRE(hdr.covered_from == 0);
+	REQUIRE(HistoryIndexCoversFile(history_file.c_str(), size));
+	REQUIRE(isi.GetFileSize() == (filesize_t)(sizeof(hdr) + records.size() * sizeof(HistoryIndexRecord)));
+
+	REQUIRE(records.size() == ads.size());
+	if (records.size() != ads.size()) {
+		return;
+	}
+	int64_t min_completion = INT64_MAX, max_completion = -1;
+	int64_t min_record_completion = INT64_MAX, max_record_completion = -1;
+	for (size_t ix = 0; ix < ads.size(); ++ix) {
+		const HistoryAd & ad = ads[ix];
+		const HistoryIndexRecord & rec = records[ix];
+		REQUIRE(rec.offset == ad.offset);
+		REQUIRE(rec.length == ad.length);
+		REQUIRE(rec.cluster == ad.cluster);
+		REQUIRE(rec.proc == ad.proc);
+		REQUIRE(rec.completion_date == ad.completion);
+		REQUIRE(rec.owner_hash == HistoryIndexOwnerHash(ad.owner.c_str()));
+		if (ad.completion >= 0) {
+			min_completion = MIN(min_completion, ad.completion);
+			max_completion = MAX(max_completion, ad.completion);
+		}
+		if (rec.completion_date >= 0) {
+			min_record_completion = MIN(min_record_completion, rec.completion_date);
+			max_record_completion = MAX(max_record_completion, rec.completion_date);
+		}
+	}
+	REQUIRE(min_record_completion == min_completion);
+	REQUIRE(max_record_completion == max_completion);
+
+	// an index that is longer than what is in the history file only has the ads that are there
+	const HistoryIndexRecord & last = records.back();
+	REQUIRE( ! HistoryIndexCoversFile(history_file.c_str(), size - 1));
+	REQUIRE(ReadHistoryIndex(history_file.c_str(), last.offset + last.length - 1, hdr, records));
+	REQUIRE(records.size() == ads.size() - 1);
+}
+
+// write the ads to a history file that is rotated once, and check the indexes of both files
+static void test_write(const std::string & dir, int queue_size)
+{
+	REQUIRE(mkdir(dir.c_str(), 0755) == 0);
+	std::string history;
+	dircat(dir.c_str(), "history", history);
+
+	// room for 4 ads, so that the history file is rotated once, in the middle of the ads
+	ClassAd sample;
+	make_job_ad(sample, 0);
+	std::string text, banner;
+	sPrintAd(text, sample);
+	formatstr(banner, "*** Offset = %d ClusterId = %d ProcId = 0 Owner = \"%s\" CompletionDate = %d\n",
+		1000, FIRST_CLUSTER, OWNERS[0], 1000);
+	size_t ad_size = text.size() + banner.size();
+	std::string max_log = std::to_string(3 * ad_size + text.size() + ad_size / 2);
+
+	param_insert("HISTORY", history.c_str());
+	param_insert("HISTORY_INDEX", "true");
+	param_insert("ENABLE_HISTORY_ROTATION", "true");
+	param_insert("MAX_HISTORY_LOG", max_log.c_str());
+	param_insert("MAX_HISTORY_ROTATIONS", "4");
+	param_insert("HISTORY_WRITER_QUEUE_SIZE", std::to_string(queue_size).c_str());
+	InitJobHistoryFile("HISTORY", "PER_JOB_HISTORY_DIR");
+
+	for (int ix = 0; ix < NUM_ADS; ++ix) {
+		ClassAd ad;
+		make_job_ad(ad, ix);
+		AppendHistory(&ad);
+	}
+	StopJobHistoryWriter();
+
+	HistoryWriterStats stats;
+	GetJobHistoryWriterStats(stats);
+	REQUIRE(stats.write_errors == 0);
+
+	std::vector<std::string> files;
+	list_history_files(dir, files);
+	REQUIRE(files.size() == 2);
+
+	std::vector<int> clusters;
+	int64_t last_completion = -1;
+	for (const auto & file : files) {
+		std::vector<HistoryAd> ads;
+		check_index(file, ads);
+		REQUIRE( ! ads.empty());
+		for (const auto & ad : ads) {
+			clusters.push_back(ad.cluster);
+			// the rotated file only has jobs that completed before the jobs in the current file
+			if (ad.completion >= 0) {
+				REQUIRE(ad.completion > last_completion);
+				last_completion = ad.completion;
+			}
+		}
+	}
+	std::vector<int> expected;
+	for (int ix = 0; ix < NUM_ADS; ++ix) {
+		expected.push_back(FIRST_CLUSTER + ix);
+	}
+	REQUIRE(clusters == expected);
+}
+
+// an index is started over when the history file was changed by someone else
+static void test_changed_history(const std::string & dir)
+{
+	std::string history;
+	dircat(dir.c_str(), "history", history);
+	StatInfo before(history.c_str());
+	REQUIRE(before.Error() == SIGood);
+
+	FILE * fp = safe_fopen_wrapper_follow(history.c_str(), "a");
+	REQUIRE(fp != nullptr);
+	if ( ! fp) {
+		return;
+	}
+	fprintf(fp, "ClusterId = 99\n*** Offset = 0 ClusterId = 99 ProcId = 0 Owner = \"carol\" CompletionDate = 0\n");
+	fclose(fp);
+	StatInfo changed(history.c_str());
+	int64_t changed_size = changed.GetFileSize();
+	REQUIRE(changed_size > before.GetFileSize());
+
+	// the old index is still good for the ads that it has, but it doesn't cover the file
+	HistoryIndexHeader hdr;
+	std::vector<HistoryIndexRecord> records;
+	REQUIRE( ! HistoryIndexCoversFile(history.c_str(), changed_size));
+	REQUIRE(ReadHistoryIndex(history.c_str(), changed_size, hdr, records));
+	REQUIRE( ! records.empty());
+
+	// not rotated, so that the ad goes after the change
+	param_insert("ENABLE_HISTORY_ROTATION", "false");
+	param_insert("HISTORY_WRITER_QUEUE_SIZE", "0");
+	InitJobHistoryFile("HISTORY", "PER_JOB_HISTORY_DIR");
+	ClassAd ad;
+	make_job_ad(ad, 0);
+	ad.Assign("ClusterId", 100);
+	AppendHistory(&ad);
+	StopJobHistoryWriter();
+
+	StatInfo after(history.c_str());
+	int64_t size = after.GetFileSize();
+	REQUIRE(ReadHistoryIndex(history.c_str(), size, hdr, records));
+	REQUIRE(hdr.covered_from == changed_size);
+	REQUIRE(records.size() == 1);
+	if (records.size() == 1) {
+		REQUIRE(records[0].offset == changed_size);
+		REQUIRE(records[0].offset + records[0].length == size);
+		REQUIRE(records[0].cluster == 100);
+	}
+	// readers must read the start of the file themselves
+	REQUIRE( ! HistoryIndexCoversFile(history.c_str(), size));
+
+	// the history file still reads the same way
+	std::vector<HistoryAd> ads;
+	read_history_ads(history, ads);
+	REQUIRE( ! ads.empty() && ads.back().cluster == 100 && ads.back().offset == changed_size);
+}
+
+static void test_names_and_hashes()
+{
+	std::string index_file;
+	HistoryIndexFilename("/var/lib/condor/spool/history", index_file);
+	REQUIRE(index_file == "/var/lib/condor/spool/.history.idx");
+	HistoryIndexFilename("/var/lib/condor/spool/history.20240102T030405", index_file);
+	REQUIRE(index_file == "/var/lib/condor/spool/.history.20240102T030405.idx");
+
+	REQUIRE(HistoryIndexOwnerHash("alice") == HistoryIndexOwnerHash("ALICE"));
+	REQUIRE(HistoryIndexOwnerHash("alice") != HistoryIndexOwnerHash("bob"));
+
+	HistoryIndexHeader hdr;
+	InitHistoryIndexHeader(hdr, 1234);
+	REQUIRE(memcmp(hdr.magic, HISTORY_INDEX_MAGIC, sizeof(hdr.magic)) == 0);
+	REQUIRE(hdr.version == HISTORY_INDEX_VERSION);
+	REQUIRE(hdr.record_size == sizeof(HistoryIndexRecord));
+	REQUIRE(hdr.covered_from == 1234);
+
+	// no index at all
+	HistoryIndexHeader none;
+	std::vector<HistoryIndexRecord> records;
+	REQUIRE( ! ReadHistoryIndex("/nonexistent/history", 0, none, records));
+	REQUIRE( ! HistoryIndexCoversFile("/nonexistent/history", 0));
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	char tmpl[] = "/tmp/test_history_index.XXXXXX";
+	const char * tmp = mkdtemp(tmpl);
+	if ( ! tmp) {
+		fprintf(stderr, "Failed to make a temporary directory: %s\n", strerror(errno));
+		return 1;
+	}
+	std::string direct_dir, writer_dir;
+	dircat(tmp, "direct", direct_dir);
+	dircat(tmp, "writer", writer_dir);
+
+	test_names_and_hashes();
+	test_write(direct_dir, 0);
+	test_write(writer_dir, 3);
+	test_changed_history(writer_dir);
+
+	Directory dir(tmp);
+	dir.Remove_Entire_Directory();
+	rmdir(tmp);
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
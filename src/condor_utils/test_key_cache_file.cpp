@@ -0,0 +1,290 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the file that saves security sessions across restarts
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "condor_attributes.h"
+#include "subsystem_info.h"
+#include "directory.h"
+#include "KeyCacheFile.h"
+
+#include <thread>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+static std::string test_dir;
+
+static KeyInfo makeKey(Protocol protocol, int len, unsigned char fill)
+{
+	std::vector<unsigned char> data(len);
+	for (int ii = 0; ii < len; ++ii) {
+		data[ii] = (unsigned char)(fill + ii);
+	}
+	return KeyInfo(data.data(), len, protocol, 0);
+}
+
+static KeyCacheEntry makeEntry(const char * sid, time_t expiration, bool negotiated = true, const char * addr = "")
+{
+	ClassAd policy;
+	policy.InsertAttr(ATTR_SEC_NEGOTIATED_SESSION, negotiated);
+	policy.InsertAttr(ATTR_SEC_USER, "alice@example.com");
+	policy.InsertAttr(ATTR_SEC_VALID_COMMANDS, "60008,60011,1111");
+	policy.AssignExpr("Limits", "[ Max = 5; Over = Max > 3 ]");
+	std::vector<KeyInfo> keys;
+	keys.push_back(makeKey(CONDOR_AESGCM, 32, 1));
+	keys.push_back(makeKey(CONDOR_BLOWFISH, 16, 100));
+	KeyCacheEntry entry(sid, addr, keys, policy, expiration, 3600);
+	entry.setLastPeerVersion("$CondorVersion: 24.1.0 2024-08-01 $");
+	return entry;
+}
+
+static bool sameKeys(const std::vector<KeyInfo> & a, const std::vector<KeyInfo> & b)
+{
+	if (a.size() != b.size()) return false;
+	for (size_t ii = 0; ii < a.size(); ++ii) {
+		if (a[ii].getProtocol() != b[ii].getProtocol() ||
+			a[ii].getDuration() != b[ii].getDuration() ||
+			a[ii].getKeyLength() != b[ii].getKeyLength() ||
+			memcmp(a[ii].getKeyData(), b[ii].getKeyData(), a[ii].getKeyLength()) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void test_entry_round_trip()
+{
+	time_t expiration = time(nullptr) + 86400;
+	KeyCacheEntry entry = makeEntry("host:1234:1722951043:1", expiration);
+	entry.setPreferredProtocol(CONDOR_BLOWFISH);
+
+	std::string line;
+	UnparseKeyCacheEntry(entry, line);
+	REQUIRE(line.find('\n') == std::string::npos);
+
+	auto parsed = ParseKeyCacheEntry(line.c_str());
+	REQUIRE(parsed);
+	if ( ! parsed) return;
+	REQUIRE(parsed->id() == entry.id());
+	REQUIRE(parsed->addr().empty());
+	REQUIRE(parsed->lifetimeExpiration() == expiration);
+	REQUIRE(parsed->leaseInterval() == 3600);
+	REQUIRE(parsed->getPreferredProtocol() == CONDOR_BLOWFISH);
+	REQUIRE(parsed->getLastPeerVersion() == entry.getLastPeerVersion());
+	REQUIRE(parsed->getRestoredFlag());
+	REQUIRE( ! entry.getRestoredFlag());
+	REQUIRE(sameKeys(parsed->keys(), entry.keys()));
+
+	// the policy is a copy that no longer points at the ad of the line
+	REQUIRE(parsed->policy()->SameAs(entry.policy()));
+	REQUIRE(parsed->policy()->GetParentScope() == nullptr);
+	bool over = false;
+	auto * limits = dynamic_cast<classad::ClassAd *>(parsed->policy()->Lookup("Limits"));
+	REQUIRE(limits && limits->EvaluateAttrBool("Over", over) && over);
+
+	// a session that never expires
+	KeyCacheEntry forever = makeEntry("forever", 0);
+	line.clear();
+	UnparseKeyCacheEntry(forever, line);
+	parsed = ParseKeyCacheEntry(line.c_str());
+	REQUIRE(parsed && parsed->lifetimeExpiration() == 0);
+}
+
+static void test_entry_parse_errors()
+{
+	KeyCacheEntry entry = makeEntry("sid", time(nullptr) + 100);
+	std::string good;
+	UnparseKeyCacheEntry(entry, good);
+	REQUIRE(ParseKeyCacheEntry(good.c_str()));
+
+	REQUIRE( ! ParseKeyCacheEntry(""));
+	REQUIRE( ! ParseKeyCacheEntry("not a classad"));
+	REQUIRE( ! ParseKeyCacheEntry(good.substr(0, good.size() / 2).c_str()));
+
+	// each required attribute, taken out or given the wrong type
+	for (const char * attr : { "SessionId", "Expiration", "SessionLease", "PreferredProtocol", "Keys", "Policy" }) {
+		classad::ClassAdParser parser;
+		std::unique_ptr<classad::ClassAd> ad(parser.ParseClassAd(good));
+		classad::ClassAdUnParser unparser;
+		std::string line;
+
+		ad->Delete(attr);
+		unparser.Unparse(line, ad.get());
+		REQUIRE( ! ParseKeyCacheEntry(line.c_str()));
+
+		ad->AssignExpr(attr, strcmp(attr, "SessionId") == 0 ? "42" : "\"wrong\"");
+		line.clear();
+		unparser.Unparse(line, ad.get());
+		REQUIRE( ! ParseKeyCacheEntry(line.c_str()));
+	}
+
+	// bad keys
+	for (const char * keys : { "{ 42 }", "{ \"3,0\" }", "{ \"9,0,AAAA\" }", "{ \"0,0,AAAA\" }", "{ \"3,0,\" }", "{ \"three,0,AAAA\" }" }) {
+		classad::ClassAdParser parser;
+		std::unique_ptr<classad::ClassAd> ad(parser.ParseClassAd(good));
+		ad->AssignExpr("Keys", keys);
+		std::string line;
+		classad::ClassAdUnParser unparser;
+		unparser.Unparse(line, ad.get());
+		REQUIRE( ! ParseKeyCacheEntry(line.c_str()));
+	}
+}
+
+static void test_encrypt_decrypt()
+{
+	unsigned char key[KEYCACHE_FILE_KEY_LEN], other_key[KEYCACHE_FILE_KEY_LEN];
+	for (int ii = 0; ii < KEYCACHE_FILE_KEY_LEN; ++ii) {
+		key[ii] = (unsigned char)ii;
+		other_key[ii] = (unsigned char)(ii + 1);
+	}
+
+	for (const std::string & plaintext : { std::string(), std::string("one line\n"), std::string(100000, 'x') }) {
+		std::string data, data2, got;
+		REQUIRE(EncryptKeyCacheData(key, plaintext, data));
+		REQUIRE(data.size() > plaintext.size());
+		REQUIRE(plaintext.empty() || data.find(plaintext) == std::string::npos);
+		REQUIRE(DecryptKeyCacheData(key, (const unsigned char *)data.data(), data.size(), got));
+		REQUIRE(got == plaintext);
+
+		// a new IV each time
+		REQUIRE(EncryptKeyCacheData(key, plaintext, data2));
+		REQUIRE(data2 != data);
+
+		REQUIRE( ! DecryptKeyCacheData(other_key, (const unsigned char *)data.data(), data.size(), got));
+		REQUIRE( ! DecryptKeyCacheData(key, (const unsigned char *)data.data(), data.size() - 1, got));
+		REQUIRE( ! DecryptKeyCacheData(key, (const unsigned char *)data.data(), 20, got));
+
+		// a change to any byte, in the magic, the IV, the ciphertext or the tag
+		bool all_rejected = true;
+		for (size_t pos : { (size_t)0, (size_t)9, data.size() / 2, data.size() - 1 }) {
+			std::string bad = data;
+			bad[pos] ^= 0x01;
+			if (DecryptKeyCacheData(key, (const unsigned char *)bad.data(), bad.size(), got)) {
+				all_rejected = false;
+			}
+		}
+		REQUIRE(all_rejected);
+	}
+}
+
+// the steps of KeyCacheFileWriter, with Write() on another thread, then load
+static void test_save_and_load()
+{
+	std::string file = test_dir + DIR_DELIM_STRING + "sessions";
+	std::string key_file = test_dir + DIR_DELIM_STRING + "sessions_key";
+	time_t now = time(nullptr);
+
+	KeyCache cache;
+	cache.emplace("long", makeEntry("long", now + 10000));
+	cache.emplace("short", makeEntry("short", now + 1000));
+	cache.emplace("forever", makeEntry("forever", 0));
+	cache.emplace("expired", makeEntry("expired", now - 10));
+	cache.emplace("not_negotiated", makeEntry("not_negotiated", now + 1000, false));
+	cache.emplace("outgoing", makeEntry("outgoing", now + 1000, true, "<127.0.0.1:9618>"));
+	KeyCacheEntry lingering = makeEntry("lingering", now + 1000);
+	lingering.setLingerFlag(true);
+	cache.emplace("lingering", lingering);
+
+	{
+		KeyCacheFileWriter writer;
+		REQUIRE(writer.Prepare(cache, file.c_str(), key_file.c_str(), 1024 * 1024));
+		bool written = false;
+		std::thread thread([&]() { written = writer.Write(); });
+		thread.join();
+		REQUIRE(written);
+		REQUIRE(writer.Finish());
+	}
+
+	KeyCache loaded;
+	REQUIRE(LoadKeyCacheFile(loaded, file.c_str(), key_file.c_str()) == 3);
+	REQUIRE(loaded.size() == 3);
+	REQUIRE(loaded.count("long") && loaded.count("short") && loaded.count("forever"));
+	if (loaded.count("long")) {
+		REQUIRE(loaded.at("long").getRestoredFlag());
+		REQUIRE(sameKeys(loaded.at("long").keys(), cache.at("long").keys()));
+	}
+	// sessions that are already in the cache are left alone
+	REQUIRE(LoadKeyCacheFile(loaded, file.c_str(), key_file.c_str()) == 0);
+
+	// the sessions that will live the longest are kept when the file is too small
+	std::string line;
+	UnparseKeyCacheEntry(cache.at("long"), line);
+	REQUIRE(SaveKeyCacheFile(cache, file.c_str(), key_file.c_str(), 36 + 2 * (line.size() + 1)));
+	loaded.clear();
+	REQUIRE(LoadKeyCacheFile(loaded, file.c_str(), key_file.c_str()) == 2);
+	REQUIRE(loaded.count("forever") && loaded.count("long"));
+
+	// a failed write leaves the old file in place and no temp file
+	{
+		KeyCacheFileWriter writer;
+		REQUIRE(writer.Prepare(KeyCache(), file.c_str(), key_file.c_str(), 1024 * 1024));
+		REQUIRE( ! writer.Finish());
+	}
+	struct stat st;
+	REQUIRE(stat((file + ".tmp").c_str(), &st) != 0);
+	loaded.clear();
+	REQUIRE(LoadKeyCacheFile(loaded, file.c_str(), key_file.c_str()) == 2);
+
+	// a file written with another key is ignored
+	std::string other_key_file = key_file + "2";
+	REQUIRE(SaveKeyCacheFile(cache, (file + "2").c_str(), other_key_file.c_str(), 1024 * 1024));
+	REQUIRE(LoadKeyCacheFile(loaded, (file + "2").c_str(), key_file.c_str()) == -1);
+
+	// no file is not an error
+	REQUIRE(LoadKeyCacheFile(loaded, (file + "3").c_str(), key_file.c_str()) == 0);
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	char dir_template[] = "/tmp/test_key_cache_file.XXXXXX";
+	if ( ! mkdtemp(dir_template)) {
+		fprintf(stderr, "Failed to create a temp directory\n");
+		return 1;
+	}
+	test_dir = dir_template;
+
+	test_entry_round_trip();
+	test_entry_parse_errors();
+	test_encrypt_decrypt();
+	test_save_and_load();
+
+	Directory dir(test_dir.c_str());
+	dir.Remove_Entire_Directory();
+	rmdir(test_dir.c_str());
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
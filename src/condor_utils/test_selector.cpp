@@ -0,0 +1,199 @@
+/***************************************************************
+ *
+ * Copyright (C) 2024, Condor Team, Computer Sciences Department,
+ * University of Wisconsin-Madison, WI.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you
+ * may not use this file except in compliance with the License.  You may
+ * obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ***************************************************************/
+
+// unit tests for the Selector when it keeps its fds registered with epoll
+
+#include "condor_common.h"
+#include "condor_debug.h"
+#include "condor_config.h"
+#include "subsystem_info.h"
+#include "selector.h"
+
+#include <thread>
+
+static int fail_count = 0;
+
+#define REQUIRE( condition ) \
+	if(! ( condition )) { \
+		fprintf( stderr, "Failed %5d: %s\n", __LINE__, #condition ); \
+		++fail_count; \
+	}
+
+// wait for the read ends, without blocking.  returns true if any is ready
+static bool poll_read(Selector & selector, std::initializer_list<int> fds)
+{
+	selector.reset();
+	for (int fd : fds) {
+		selector.add_fd(fd, Selector::IO_READ);
+	}
+	selector.set_timeout(0);
+	selector.execute();
+	return selector.has_ready();
+}
+
+static void put_byte(int fd)
+{
+	char ch = 'x';
+	REQUIRE(write(fd, &ch, 1) == 1);
+}
+
+static void get_byte(int fd)
+{
+	char ch = 0;
+	REQUIRE(read(fd, &ch, 1) == 1);
+}
+
+// the registrations last between passes, and follow what is wanted
+static void test_registrations(Selector & selector)
+{
+	int p1[2], p2[2];
+	REQUIRE(pipe(p1) == 0);
+	REQUIRE(pipe(p2) == 0);
+
+	REQUIRE( ! poll_read(selector, {p1[0], p2[0]}));
+	REQUIRE(selector.timed_out());
+
+	put_byte(p2[1]);
+	REQUIRE(poll_read(selector, {p1[0], p2[0]}));
+	REQUIRE(selector.fd_ready(p2[0], Selector::IO_READ));
+	REQUIRE( ! selector.fd_ready(p1[0], Selector::IO_READ));
+
+	// an fd that is no longer wanted isn't reported
+	REQUIRE( ! poll_read(selector, {p1[0]}));
+
+	get_byte(p2[0]);
+	REQUIRE( ! poll_read(selector, {p1[0], p2[0]}));
+
+	// write interest
+	selector.reset();
+	selector.add_fd(p1[1], Selector::IO_WRITE);
+	selector.set_timeout(0);
+	selector.execute();
+	REQUIRE(selector.fd_ready(p1[1], Selector::IO_WRITE));
+	REQUIRE( ! selector.fd_ready(p1[1], Selector::IO_READ));
+
+	for (int fd : {p1[0], p1[1], p2[0], p2[1]}) {
+		selector.forget_fd(fd);
+		close(fd);
+	}
+}
+
+// an fd number that is closed and reused gets only the new file's events, even when
+// a copy of the old fd keeps the old file open
+static void test_close_then_reuse(Selector & selector)
+{
+	int old_pipe[2];
+	REQUIRE(pipe(old_pipe) == 0);
+	int old_fd = old_pipe[0];
+	int copy = dup(old_fd);
+	REQUIRE(copy >= 0);
+
+	REQUIRE( ! poll_read(selector, {old_fd}));
+
+	// close it the way DaemonCore does, forgetting it first
+	selector.forget_fd(old_fd);
+	close(old_fd);
+
+	// the old file is ready, through the copy
+	put_byte(old_pipe[1]);
+
+	int new_pipe[2];
+	REQUIRE(pipe(new_pipe) == 0);
+	REQUIRE(new_pipe[0] == old_fd);
+
+	// the new file isn't ready, so nothing is
+	REQUIRE( ! poll_read(selector, {new_pipe[0]}));
+	REQUIRE( ! selector.fd_ready(new_pipe[0], Selector::IO_READ));
+
+	put_byte(new_pipe[1]);
+	REQUIRE(poll_read(selector, {new_pipe[0]}));
+	REQUIRE(selector.fd_ready(new_pipe[0], Selector::IO_READ));
+	get_byte(new_pipe[0]);
+	REQUIRE( ! poll_read(selector, {new_pipe[0]}));
+
+	for (int fd : {new_pipe[0], new_pipe[1]}) {
+		selector.forget_fd(fd);
+		close(fd);
+	}
+	close(copy);
+	close(old_pipe[1]);
+}
+
+// forgetting an fd from another thread takes effect on the next pass
+static void test_forget_from_thread(Selector & selector)
+{
+	int p[2];
+	REQUIRE(pipe(p) == 0);
+	REQUIRE( ! poll_read(selector, {p[0]}));
+
+	std::thread forgetter([&selector, &p]() { selector.forget_fd(p[0]); });
+	forgetter.join();
+
+	// still wanted, so registered again
+	put_byte(p[1]);
+	REQUIRE(poll_read(selector, {p[0]}));
+	REQUIRE(selector.fd_ready(p[0], Selector::IO_READ));
+	get_byte(p[0]);
+
+	// forgotten from a thread, then closed and reused before the next pass
+	std::thread forgetter2([&selector, &p]() { selector.forget_fd(p[0]); });
+	forgetter2.join();
+	int old_fd = p[0];
+	close(p[0]);
+
+	int q[2];
+	REQUIRE(pipe(q) == 0);
+	REQUIRE(q[0] == old_fd);
+	REQUIRE( ! poll_read(selector, {q[0]}));
+	put_byte(q[1]);
+	REQUIRE(poll_read(selector, {q[0]}));
+	REQUIRE(selector.fd_ready(q[0], Selector::IO_READ));
+
+	for (int fd : {q[0], q[1], p[1]}) {
+		selector.forget_fd(fd);
+		close(fd);
+	}
+}
+
+int main( int /*argc*/, const char ** /*argv*/)
+{
+	// init the config subsystem, but without reading any config files
+	set_mySubSystem("TOOL", false, SUBSYSTEM_TYPE_TOOL);
+	config_host(NULL, CONFIG_OPT_USE_THIS_ROOT_CONFIG, "ONLY_ENV");
+
+	Selector selector;
+	if ( ! selector.use_epoll()) {
+		printf("epoll is not available, nothing to test\n");
+		printf("No errors detected\n");
+		return 0;
+	}
+	REQUIRE(selector.using_epoll());
+
+	test_registrations(selector);
+	test_close_then_reuse(selector);
+	test_forget_from_thread(selector);
+	REQUIRE(selector.using_epoll());
+
+	if (fail_count) {
+		fprintf(stderr, "%d failures\n", fail_count);
+	} else {
+		printf("No errors detected\n");
+	}
+	return fail_count;
+}
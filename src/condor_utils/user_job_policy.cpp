@@ -203,6 +203,22 @@ void UserPolicy::Config()
 
 }
 
+void UserPolicy::GetSystemPeriodicExprs(std::vector<ExprTree*> & exprs) const
+{
+#ifdef ENABLE_JOB_POLICY_LISTS
+	for (const auto * policies : { &m_sys_periodic_holds, &m_sys_periodic_releases, &m_sys_periodic_removes, &m_sys_periodic_vacates }) {
+		for (const auto & policy : *policies) {
+			ExprTree * expr = policy.Expr();
+			if (expr) exprs.push_back(expr);
+		}
+	}
+#else
+	if (m_sys_periodic_hold) exprs.push_back(m_sys_periodic_hold);
+	if (m_sys_periodic_release) exprs.push_back(m_sys_periodic_release);
+	if (m_sys_periodic_remove) exprs.push_back(m_sys_periodic_remove);
+#endif
+}
+
 void UserPolicy::ResetTriggers()
 {
 	m_fire_expr_val = -1;
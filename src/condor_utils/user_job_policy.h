@@ -283,6 +283,11 @@ class UserPolicy
 		   occurred, then false is returned. */
 		bool FiringReason(std::string & reason, int & reason_code, int & reason_subcode);
 
+		/* Append the configured system periodic policy expressions, so that
+		   callers can see what they refer to.  The expressions are owned by
+		   this object and are valid until the next Init(). */
+		void GetSystemPeriodicExprs(std::vector<ExprTree*> & exprs) const;
+
 	private: /* functions */
 		/* This function inserts six of the seven (all but TimerRemove) user
 			job policy expressions with default values into the classad if they